@@ -1,10 +1,13 @@
 #cmakedefine HAVE_LIBINTL_H
 #cmakedefine HAVE_SYS_RESOURCE_H
+#cmakedefine HAVE_SYS_SENDFILE_H
 #cmakedefine HAVE_FLOCK
 #cmakedefine HAVE_LANGINFO_CODESET
 #cmakedefine HAVE_BACKTRACE
 #cmakedefine ICONV_2ARG_IS_CONST 1
 #cmakedefine HAVE_MALLINFO
+#cmakedefine HAVE_MALLOC_USABLE_SIZE
+#cmakedefine HAVE_POSIX_SPAWNP
 #cmakedefine HAVE_EAT_NEWLINE_GLITCH
 #cmakedefine HAVE_ASPELL_VERSION_STRING
 #cmakedefine HAVE_ENCHANT_GET_VERSION
@@ -26,10 +26,14 @@ SET(WEECHAT_SOURCES
 ./src/core/wee-list.h
 ./src/core/wee-log.c
 ./src/core/wee-log.h
+./src/core/wee-memory.c
+./src/core/wee-memory.h
 ./src/core/wee-network.c
 ./src/core/wee-network.h
 ./src/core/wee-proxy.c
 ./src/core/wee-proxy.h
+./src/core/wee-resolve.c
+./src/core/wee-resolve.h
 ./src/core/wee-secure.c
 ./src/core/wee-secure.h
 ./src/core/wee-string.c
@@ -152,6 +156,8 @@ SET(WEECHAT_SOURCES
 ./src/plugins/irc/irc-ctcp.h
 ./src/plugins/irc/irc-debug.c
 ./src/plugins/irc/irc-debug.h
+./src/plugins/irc/irc-flood.c
+./src/plugins/irc/irc-flood.h
 ./src/plugins/irc/irc.h
 ./src/plugins/irc/irc-ignore.c
 ./src/plugins/irc/irc-ignore.h
@@ -179,16 +185,24 @@ SET(WEECHAT_SOURCES
 ./src/plugins/irc/irc-sasl.h
 ./src/plugins/irc/irc-server.c
 ./src/plugins/irc/irc-server.h
+./src/plugins/irc/irc-tls.c
+./src/plugins/irc/irc-tls.h
 ./src/plugins/logger/logger-buffer.c
 ./src/plugins/logger/logger-buffer.h
 ./src/plugins/logger/logger.c
 ./src/plugins/logger/logger-config.c
 ./src/plugins/logger/logger-config.h
 ./src/plugins/logger/logger.h
+./src/plugins/logger/logger-index.c
+./src/plugins/logger/logger-index.h
 ./src/plugins/logger/logger-info.c
 ./src/plugins/logger/logger-info.h
+./src/plugins/logger/logger-rotate.c
+./src/plugins/logger/logger-rotate.h
 ./src/plugins/logger/logger-tail.c
 ./src/plugins/logger/logger-tail.h
+./src/plugins/logger/logger-writer.c
+./src/plugins/logger/logger-writer.h
 ./src/plugins/lua/weechat-lua-api.c
 ./src/plugins/lua/weechat-lua-api.h
 ./src/plugins/lua/weechat-lua.c
@@ -241,6 +255,8 @@ SET(WEECHAT_SOURCES
 ./src/plugins/relay/relay-websocket.h
 ./src/plugins/relay/weechat/relay-weechat.c
 ./src/plugins/relay/weechat/relay-weechat.h
+./src/plugins/relay/weechat/relay-weechat-batch.c
+./src/plugins/relay/weechat/relay-weechat-batch.h
 ./src/plugins/relay/weechat/relay-weechat-msg.c
 ./src/plugins/relay/weechat/relay-weechat-msg.h
 ./src/plugins/relay/weechat/relay-weechat-nicklist.c
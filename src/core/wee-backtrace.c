@@ -177,3 +177,39 @@ weechat_backtrace ()
 
     weechat_backtrace_printf ("======= End of  backtrace =======");
 }
+
+/*
+ * Writes a backtrace (saved with function "backtrace") in WeeChat log file
+ * only (symbols are not resolved with addr2line, to keep it fast).
+ */
+
+void
+weechat_backtrace_log (void **trace, int trace_size)
+{
+#ifdef HAVE_BACKTRACE
+    char **symbols;
+    int i;
+
+    symbols = backtrace_symbols (trace, trace_size);
+
+    log_printf ("======= WeeChat backtrace =======");
+    for (i = 0; i < trace_size; i++)
+    {
+        if (symbols)
+            log_printf ("%03d  %s", i + 1, symbols[i]);
+        else
+            log_printf ("%03d  %p", i + 1, trace[i]);
+    }
+    log_printf ("======= End of  backtrace =======");
+
+    if (symbols)
+        free (symbols);
+#else
+    /* make C compiler happy */
+    (void) trace;
+    (void) trace_size;
+
+    log_printf ("  No backtrace info (no debug info available or no "
+                "backtrace possible on your system).");
+#endif
+}
@@ -23,5 +23,6 @@
 #define BACKTRACE_MAX 128
 
 extern void weechat_backtrace ();
+extern void weechat_backtrace_log (void **trace, int trace_size);
 
 #endif /* WEECHAT_BACKTACE_H */
@@ -1650,6 +1650,8 @@ COMMAND_CALLBACK(debug)
 {
     struct t_config_option *ptr_option;
     struct t_weechat_plugin *ptr_plugin;
+    char *error;
+    long number;
     int debug;
 
     /* make C compiler happy */
@@ -1731,6 +1733,42 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "hooks-time") == 0)
+    {
+        if (argc > 2)
+        {
+            if (string_strcasecmp (argv[2], "enable") == 0)
+            {
+                hook_stats_enable (1);
+                gui_chat_printf (NULL,
+                                 _("Statistics on hooks enabled"));
+            }
+            else if (string_strcasecmp (argv[2], "disable") == 0)
+            {
+                hook_stats_enable (0);
+                gui_chat_printf (NULL,
+                                 _("Statistics on hooks disabled"));
+            }
+            else if (string_strcasecmp (argv[2], "reset") == 0)
+            {
+                hook_stats_reset ();
+                gui_chat_printf (NULL,
+                                 _("Statistics on hooks reset"));
+            }
+            else
+            {
+                error = NULL;
+                number = strtol (argv[2], &error, 10);
+                if (!error || error[0] || (number < 1))
+                    return WEECHAT_RC_ERROR;
+                debug_hooks_time ((int)number);
+            }
+        }
+        else
+            debug_hooks_time (20);
+        return WEECHAT_RC_OK;
+    }
+
     if (string_strcasecmp (argv[1], "infolists") == 0)
     {
         debug_infolists ();
@@ -1745,6 +1783,19 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "loop") == 0)
+    {
+        if ((argc > 2) && (string_strcasecmp (argv[2], "reset") == 0))
+        {
+            debug_loop_reset ();
+            gui_chat_printf (NULL,
+                             _("Statistics on main loop reset"));
+        }
+        else
+            debug_loop ();
+        return WEECHAT_RC_OK;
+    }
+
     if (string_strcasecmp (argv[1], "memory") == 0)
     {
         debug_memory ();
@@ -4257,11 +4308,10 @@ command_plugin_list (const char *name, int full)
                         hook_found = 1;
                         gui_chat_printf (NULL,
                                          _("      socket: %d, address: %s, "
-                                           "port: %d, child pid: %d"),
+                                           "port: %d"),
                                          HOOK_CONNECT(ptr_hook, sock),
                                          HOOK_CONNECT(ptr_hook, address),
-                                         HOOK_CONNECT(ptr_hook, port),
-                                         HOOK_CONNECT(ptr_hook, child_pid));
+                                         HOOK_CONNECT(ptr_hook, port));
                     }
                 }
 
@@ -5558,6 +5608,7 @@ command_set_display_option_list (const char *message, const char *search,
         {
             section_displayed = 0;
 
+            config_file_section_sort_options (ptr_section);
             for (ptr_option = ptr_section->options; ptr_option;
                  ptr_option = ptr_option->next_option)
             {
@@ -6153,6 +6204,9 @@ COMMAND_CALLBACK(upgrade)
     if (secure_passphrase)
         setenv (SECURE_ENV_PASSPHRASE, secure_passphrase, 1);
 
+    /* the timer of main loop watchdog would be kept by the new binary */
+    debug_loop_watchdog_disarm ();
+
     /* execute binary */
     exec_args[0] = ptr_binary;
     exec_args[3] = strdup (weechat_home);
@@ -7118,27 +7172,38 @@ command_init ()
            " || dump [<plugin>]"
            " || buffer|color|infolists|memory|tags|term|windows"
            " || mouse|cursor [verbose]"
-           " || hdata [free]"),
-        N_("     list: list plugins with debug levels\n"
-           "      set: set debug level for plugin\n"
-           "   plugin: name of plugin (\"core\" for WeeChat core)\n"
-           "    level: debug level for plugin (0 = disable debug)\n"
-           "     dump: save memory dump in WeeChat log file (same dump is "
+           " || hdata [free]"
+           " || hooks-time [enable|disable|reset|<count>]"
+           " || loop [reset]"),
+        N_("      list: list plugins with debug levels\n"
+           "       set: set debug level for plugin\n"
+           "    plugin: name of plugin (\"core\" for WeeChat core)\n"
+           "     level: debug level for plugin (0 = disable debug)\n"
+           "      dump: save memory dump in WeeChat log file (same dump is "
            "written when WeeChat crashes)\n"
-           "   buffer: dump buffer content with hexadecimal values in log file\n"
-           "    color: display infos about current color pairs\n"
-           "   cursor: toggle debug for cursor mode\n"
-           "     dirs: display directories\n"
-           "    hdata: display infos about hdata (with free: remove all hdata "
+           "    buffer: dump buffer content with hexadecimal values in log file\n"
+           "     color: display infos about current color pairs\n"
+           "    cursor: toggle debug for cursor mode\n"
+           "      dirs: display directories\n"
+           "     hdata: display infos about hdata (with free: remove all hdata "
            "in memory)\n"
-           "    hooks: display infos about hooks\n"
-           "infolists: display infos about infolists\n"
-           "     libs: display infos about external libraries used\n"
-           "   memory: display infos about memory usage\n"
-           "    mouse: toggle debug for mouse\n"
-           "     tags: display tags for lines\n"
-           "     term: display infos about terminal\n"
-           "  windows: display windows tree"),
+           "     hooks: display infos about hooks\n"
+           "hooks-time: display time spent in hook callbacks (sorted by total "
+           "time, only the first \"count\" hooks are displayed, default is "
+           "20), enable/disable statistics or reset them (statistics are "
+           "disabled by default)\n"
+           " infolists: display infos about infolists\n"
+           "      libs: display infos about external libraries used\n"
+           "      loop: display latency of main loop (time spent in timers, "
+           "file descriptors, refresh of screen and wait), with percentiles; "
+           "reset: reset statistics\n"
+           "    memory: display infos about memory usage and memory allocated "
+           "per plugin and subsystem (see option "
+           "weechat.startup.memory_accounting)\n"
+           "     mouse: toggle debug for mouse\n"
+           "      tags: display tags for lines\n"
+           "      term: display infos about terminal\n"
+           "   windows: display windows tree"),
         "list"
         " || set %(plugins_names)|core"
         " || dump %(plugins_names)|core"
@@ -7148,8 +7213,10 @@ command_init ()
         " || dirs"
         " || hdata free"
         " || hooks"
+        " || hooks-time enable|disable|reset"
         " || infolists"
         " || libs"
+        " || loop reset"
         " || memory"
         " || mouse verbose"
         " || tags"
@@ -683,6 +683,7 @@ completion_list_add_config_options_cb (void *data,
         for (ptr_section = ptr_config->sections; ptr_section;
              ptr_section = ptr_section->next_section)
         {
+            config_file_section_sort_options (ptr_section);
             for (ptr_option = ptr_section->options; ptr_option;
                  ptr_option = ptr_option->next_option)
             {
@@ -35,6 +35,7 @@
 
 #include "weechat.h"
 #include "wee-config-file.h"
+#include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-infolist.h"
@@ -58,6 +59,69 @@ char *config_boolean_false[] = { "off", "no", "n", "false", "f", "0", NULL };
 void config_file_option_free_data (struct t_config_option *option);
 
 
+/*
+ * Creates a hashtable to search sections or options by name.
+ *
+ * Returns pointer to new hashtable, NULL if error.
+ */
+
+struct t_hashtable *
+config_file_index_new (int size)
+{
+    return hashtable_new (size,
+                          WEECHAT_HASHTABLE_STRING,
+                          WEECHAT_HASHTABLE_POINTER,
+                          &hashtable_hash_key_string_case_cb,
+                          &hashtable_keycmp_string_case_cb);
+}
+
+/*
+ * Copies an item in another hashtable (callback used to grow a hashtable).
+ */
+
+void
+config_file_index_copy_cb (void *data, struct t_hashtable *hashtable,
+                           const void *key, const void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    hashtable_set ((struct t_hashtable *)data, key, value);
+}
+
+/*
+ * Adds a section or option in a hashtable (the hashtable is created if
+ * needed, and replaced by a bigger one when it contains too many items).
+ */
+
+void
+config_file_index_add (struct t_hashtable **index, const char *name,
+                       void *pointer)
+{
+    struct t_hashtable *new_index;
+
+    if (!*index)
+    {
+        *index = config_file_index_new (CONFIG_FILE_INDEX_SIZE);
+        if (!*index)
+            return;
+    }
+
+    if ((*index)->items_count >= (*index)->size * 2)
+    {
+        new_index = config_file_index_new ((*index)->size * 4);
+        if (new_index)
+        {
+            hashtable_map (*index, &config_file_index_copy_cb, new_index);
+            hashtable_free (*index);
+            *index = new_index;
+        }
+    }
+
+    hashtable_set (*index, name, pointer);
+}
+
+
 /*
  * Searches for a configuration file.
  */
@@ -135,6 +199,7 @@ config_file_new (struct t_weechat_plugin *plugin, const char *name,
         new_config_file->callback_reload_data = callback_reload_data;
         new_config_file->sections = NULL;
         new_config_file->last_section = NULL;
+        new_config_file->index_sections = NULL;
 
         new_config_file->prev_config = last_config_file;
         new_config_file->next_config = NULL;
@@ -215,6 +280,8 @@ config_file_new_section (struct t_config_file *config_file, const char *name,
         new_section->callback_delete_option_data = callback_delete_option_data;
         new_section->options = NULL;
         new_section->last_option = NULL;
+        new_section->index_options = NULL;
+        new_section->options_unsorted = 0;
 
         new_section->prev_section = config_file->last_section;
         new_section->next_section = NULL;
@@ -223,6 +290,9 @@ config_file_new_section (struct t_config_file *config_file, const char *name,
         else
             config_file->sections = new_section;
         config_file->last_section = new_section;
+
+        config_file_index_add (&config_file->index_sections,
+                               new_section->name, new_section);
     }
 
     return new_section;
@@ -243,6 +313,9 @@ config_file_search_section (struct t_config_file *config_file,
     if (!config_file || !section_name)
         return NULL;
 
+    if (config_file->index_sections)
+        return hashtable_get (config_file->index_sections, section_name);
+
     for (ptr_section = config_file->sections; ptr_section;
          ptr_section = ptr_section->next_section)
     {
@@ -336,72 +409,134 @@ config_file_hook_config_exec (struct t_config_option *option)
 }
 
 /*
- * Searches for position of option in section (to keep options sorted by name).
+ * Merges two lists of options sorted by name (links "next_option" are used,
+ * links "prev_option" are set later).
+ *
+ * Returns the first option of merged list.
  */
 
 struct t_config_option *
-config_file_option_find_pos (struct t_config_section *section, const char *name)
+config_file_option_merge (struct t_config_option *list1,
+                          struct t_config_option *list2)
 {
-    struct t_config_option *ptr_option;
+    struct t_config_option *first, **ptr_last;
 
-    if (section && name)
+    first = NULL;
+    ptr_last = &first;
+    while (list1 && list2)
     {
-        for (ptr_option = section->options; ptr_option;
-             ptr_option = ptr_option->next_option)
+        /* "<=" to keep order of options with same name */
+        if (string_strcasecmp (list1->name, list2->name) <= 0)
         {
-            if (string_strcasecmp (name, ptr_option->name) < 0)
-                return ptr_option;
+            *ptr_last = list1;
+            list1 = list1->next_option;
         }
+        else
+        {
+            *ptr_last = list2;
+            list2 = list2->next_option;
+        }
+        ptr_last = &((*ptr_last)->next_option);
     }
+    *ptr_last = (list1) ? list1 : list2;
 
-    /* position not found (we will add to the end of list) */
-    return NULL;
+    return first;
 }
 
 /*
- * Inserts an option in section (keeping options sorted by name).
+ * Sorts options of a section by name, if some options were added at the end
+ * of list (merge sort, O(n log n)).
+ *
+ * This function must be called before options of a section are listed in
+ * order (for example to write them in file or display them).
  */
 
 void
-config_file_option_insert_in_section (struct t_config_option *option)
+config_file_section_sort_options (struct t_config_section *section)
 {
-    struct t_config_option *pos_option;
+    struct t_config_option *lists[64], *ptr_option, *next_option, *prev_option;
+    int i, count;
 
-    if (!option || !option->section)
+    if (!section || !section->options_unsorted)
         return;
 
-    if (option->section->options)
+    /*
+     * bottom-up merge sort: lists[i] is empty or a sorted list with
+     * 2^i options
+     */
+    count = 0;
+    for (ptr_option = section->options; ptr_option; ptr_option = next_option)
     {
-        pos_option = config_file_option_find_pos (option->section,
-                                                  option->name);
-        if (pos_option)
-        {
-            /* insert option into the list (before option found) */
-            option->prev_option = pos_option->prev_option;
-            option->next_option = pos_option;
-            if (pos_option->prev_option)
-                (pos_option->prev_option)->next_option = option;
-            else
-                (option->section)->options = option;
-            pos_option->prev_option = option;
-        }
-        else
+        next_option = ptr_option->next_option;
+        ptr_option->next_option = NULL;
+        for (i = 0; (i < count) && lists[i]; i++)
         {
-            /* add option to end of section */
-            option->prev_option = (option->section)->last_option;
-            option->next_option = NULL;
-            (option->section)->last_option->next_option = option;
-            (option->section)->last_option = option;
+            ptr_option = config_file_option_merge (lists[i], ptr_option);
+            lists[i] = NULL;
         }
+        if (i == 64)
+            i--;
+        if (i >= count)
+            count = i + 1;
+        lists[i] = ptr_option;
     }
-    else
+    ptr_option = NULL;
+    for (i = 0; i < count; i++)
+    {
+        if (lists[i])
+            ptr_option = config_file_option_merge (lists[i], ptr_option);
+    }
+
+    /* rebuild links "prev_option" and last option */
+    section->options = ptr_option;
+    prev_option = NULL;
+    for (ptr_option = section->options; ptr_option;
+         ptr_option = ptr_option->next_option)
+    {
+        ptr_option->prev_option = prev_option;
+        prev_option = ptr_option;
+    }
+    section->last_option = prev_option;
+
+    section->options_unsorted = 0;
+}
+
+/*
+ * Inserts an option in section.
+ *
+ * The option is always added at the end of list; if its name is lower than
+ * the name of last option, the section is flagged "unsorted" and options
+ * will be sorted only when they are listed (so that adding many options is
+ * not quadratic).
+ */
+
+void
+config_file_option_insert_in_section (struct t_config_option *option)
+{
+    struct t_config_section *ptr_section;
+
+    if (!option || !option->section)
+        return;
+
+    ptr_section = option->section;
+
+    if (ptr_section->last_option
+        && (string_strcasecmp (option->name,
+                               ptr_section->last_option->name) < 0))
     {
-        /* first option for section */
-        option->prev_option = NULL;
-        option->next_option = NULL;
-        (option->section)->options = option;
-        (option->section)->last_option = option;
+        ptr_section->options_unsorted = 1;
     }
+
+    /* add option to end of section */
+    option->prev_option = ptr_section->last_option;
+    option->next_option = NULL;
+    if (ptr_section->last_option)
+        (ptr_section->last_option)->next_option = option;
+    else
+        ptr_section->options = option;
+    ptr_section->last_option = option;
+
+    config_file_index_add (&ptr_section->index_options, option->name, option);
 }
 
 /*
@@ -719,24 +854,24 @@ config_file_search_option (struct t_config_file *config_file,
     struct t_config_section *ptr_section;
     struct t_config_option *ptr_option;
 
+    if (!option_name)
+        return NULL;
+
     if (section)
     {
-        for (ptr_option = section->options; ptr_option;
-             ptr_option = ptr_option->next_option)
-        {
-            if (string_strcasecmp (ptr_option->name, option_name) == 0)
-                return ptr_option;
-        }
+        if (section->index_options)
+            return hashtable_get (section->index_options, option_name);
     }
     else if (config_file)
     {
         for (ptr_section = config_file->sections; ptr_section;
              ptr_section = ptr_section->next_section)
         {
-            for (ptr_option = ptr_section->options; ptr_option;
-                 ptr_option = ptr_option->next_option)
+            if (ptr_section->index_options)
             {
-                if (string_strcasecmp (ptr_option->name, option_name) == 0)
+                ptr_option = hashtable_get (ptr_section->index_options,
+                                            option_name);
+                if (ptr_option)
                     return ptr_option;
             }
         }
@@ -766,32 +901,31 @@ config_file_search_section_option (struct t_config_file *config_file,
     *section_found = NULL;
     *option_found = NULL;
 
+    if (!option_name)
+        return;
+
     if (section)
     {
-        for (ptr_option = section->options; ptr_option;
-             ptr_option = ptr_option->next_option)
+        ptr_option = config_file_search_option (config_file, section,
+                                                option_name);
+        if (ptr_option)
         {
-            if (string_strcasecmp (ptr_option->name, option_name) == 0)
-            {
-                *section_found = section;
-                *option_found = ptr_option;
-                return;
-            }
+            *section_found = section;
+            *option_found = ptr_option;
         }
     }
     else if (config_file)
     {
+        /* the option found in the last section is returned */
         for (ptr_section = config_file->sections; ptr_section;
              ptr_section = ptr_section->next_section)
         {
-            for (ptr_option = ptr_section->options; ptr_option;
-                 ptr_option = ptr_option->next_option)
+            ptr_option = config_file_search_option (config_file, ptr_section,
+                                                    option_name);
+            if (ptr_option)
             {
-                if (string_strcasecmp (ptr_option->name, option_name) == 0)
-                {
-                    *section_found = ptr_section;
-                    *option_found = ptr_option;
-                }
+                *section_found = ptr_section;
+                *option_found = ptr_option;
             }
         }
     }
@@ -1516,6 +1650,11 @@ config_file_option_rename (struct t_config_option *option,
         /* remove option from list */
         if (option->section)
         {
+            if (option->section->index_options)
+            {
+                hashtable_remove (option->section->index_options,
+                                  option->name);
+            }
             if (option->prev_option)
                 (option->prev_option)->next_option = option->next_option;
             if (option->next_option)
@@ -2120,6 +2259,7 @@ config_file_write_internal (struct t_config_file *config_file,
             if (!string_iconv_fprintf (config_file->file,
                                        "\n[%s]\n", ptr_section->name))
                 goto error;
+            config_file_section_sort_options (ptr_section);
             for (ptr_option = ptr_section->options; ptr_option;
                  ptr_option = ptr_option->next_option)
             {
@@ -2435,6 +2575,13 @@ config_file_read_internal (struct t_config_file *config_file, int reload)
     config_file->file = NULL;
     free (filename);
 
+    /* options created while reading file are sorted only once */
+    for (ptr_section = config_file->sections; ptr_section;
+         ptr_section = ptr_section->next_section)
+    {
+        config_file_section_sort_options (ptr_section);
+    }
+
     return WEECHAT_CONFIG_READ_OK;
 }
 
@@ -2543,6 +2690,10 @@ config_file_option_free (struct t_config_option *option)
 
     ptr_section = option->section;
 
+    /* remove option from section (before name is freed) */
+    if (ptr_section && ptr_section->index_options)
+        hashtable_remove (ptr_section->index_options, option->name);
+
     /* free data */
     config_file_option_free_data (option);
 
@@ -2599,6 +2750,10 @@ config_file_section_free (struct t_config_section *section)
 
     /* free data */
     config_file_section_free_options (section);
+    if (section->index_options)
+        hashtable_free (section->index_options);
+    if (ptr_config->index_sections && section->name)
+        hashtable_remove (ptr_config->index_sections, section->name);
     if (section->name)
         free (section->name);
 
@@ -2638,6 +2793,8 @@ config_file_free (struct t_config_file *config_file)
     {
         config_file_section_free (config_file->sections);
     }
+    if (config_file->index_sections)
+        hashtable_free (config_file->index_sections);
     if (config_file->name)
         free (config_file->name);
     if (config_file->filename)
@@ -2834,6 +2991,7 @@ config_file_add_to_infolist (struct t_infolist *infolist,
         for (ptr_section = ptr_config->sections; ptr_section;
              ptr_section = ptr_section->next_section)
         {
+            config_file_section_sort_options (ptr_section);
             for (ptr_option = ptr_section->options; ptr_option;
                  ptr_option = ptr_option->next_option)
             {
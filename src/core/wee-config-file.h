@@ -36,8 +36,12 @@
 #define CONFIG_BOOLEAN_FALSE  0
 #define CONFIG_BOOLEAN_TRUE   1
 
+/* initial size of hashtables used to search sections and options by name */
+#define CONFIG_FILE_INDEX_SIZE 32
+
 struct t_weelist;
 struct t_infolist;
+struct t_hashtable;
 
 struct t_config_option;
 
@@ -54,6 +58,8 @@ struct t_config_file
     void *callback_reload_data;            /* data sent to callback         */
     struct t_config_section *sections;     /* config sections               */
     struct t_config_section *last_section; /* last config section           */
+    struct t_hashtable *index_sections;    /* sections by name (case is     */
+                                           /* ignored)                      */
     struct t_config_file *prev_config;     /* link to previous config file  */
     struct t_config_file *next_config;     /* link to next config file      */
 };
@@ -94,8 +100,14 @@ struct t_config_section
      struct t_config_section *section,
      struct t_config_option *option);
     void *callback_delete_option_data;     /* data sent to delete callback  */
-    struct t_config_option *options;       /* options in section            */
+    struct t_config_option *options;       /* options in section (sorted by */
+                                           /* name, see options_unsorted)   */
     struct t_config_option *last_option;   /* last option in section        */
+    struct t_hashtable *index_options;     /* options by name (case is      */
+                                           /* ignored)                      */
+    int options_unsorted;                  /* 1 if options were added at    */
+                                           /* the end of list and must be   */
+                                           /* sorted before being listed    */
     struct t_config_section *prev_section; /* link to previous section      */
     struct t_config_section *next_section; /* link to next section          */
 };
@@ -178,6 +190,7 @@ extern struct t_config_section *config_file_new_section (struct t_config_file *c
                                                                                        struct t_config_section *section,
                                                                                        struct t_config_option *option),
                                                          void *callback_delete_option_data);
+extern void config_file_section_sort_options (struct t_config_section *section);
 extern struct t_config_section *config_file_search_section (struct t_config_file *config_file,
                                                             const char *section_name);
 extern struct t_config_option *config_file_new_option (struct t_config_file *config_file,
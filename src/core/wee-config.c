@@ -44,6 +44,7 @@
 #include "wee-util.h"
 #include "wee-list.h"
 #include "wee-proxy.h"
+#include "wee-resolve.h"
 #include "wee-string.h"
 #include "wee-version.h"
 #include "../gui/gui-bar.h"
@@ -75,6 +76,7 @@ struct t_config_option *config_startup_command_after_plugins;
 struct t_config_option *config_startup_command_before_plugins;
 struct t_config_option *config_startup_display_logo;
 struct t_config_option *config_startup_display_version;
+struct t_config_option *config_startup_memory_accounting;
 struct t_config_option *config_startup_sys_rlimit;
 
 /* config, look & feel section */
@@ -170,6 +172,7 @@ struct t_config_option *config_look_scroll_page_percent;
 struct t_config_option *config_look_search_text_not_found_alert;
 struct t_config_option *config_look_separator_horizontal;
 struct t_config_option *config_look_separator_vertical;
+struct t_config_option *config_look_stall_threshold;
 struct t_config_option *config_look_tab_width;
 struct t_config_option *config_look_time_format;
 struct t_config_option *config_look_window_auto_zoom;
@@ -263,9 +266,11 @@ struct t_config_option *config_history_max_visited_buffers;
 /* config, network section */
 
 struct t_config_option *config_network_connection_timeout;
+struct t_config_option *config_network_dns_cache_ttl;
 struct t_config_option *config_network_gnutls_ca_file;
 struct t_config_option *config_network_gnutls_handshake_timeout;
 struct t_config_option *config_network_proxy_curl;
+struct t_config_option *config_network_url_max_transfers;
 
 /* config, plugin section */
 
@@ -832,6 +837,21 @@ config_change_nick_colors (void *data, struct t_config_option *option)
     gui_color_buffer_display ();
 }
 
+/*
+ * Callback for changes on option "weechat.network.dns_cache_ttl".
+ */
+
+void
+config_change_network_dns_cache_ttl (void *data,
+                                     struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) option;
+
+    resolve_cache_flush ();
+}
+
 /*
  * Callback for changes on option "weechat.network.gnutls_ca_file".
  */
@@ -2032,6 +2052,14 @@ config_weechat_init_options ()
         "display_version", "boolean",
         N_("display WeeChat version at startup"),
         NULL, 0, 0, "on", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_startup_memory_accounting = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "memory_accounting", "boolean",
+        N_("count memory allocated by some subsystems (lines, nicklist, "
+           "hashtables, infolists, hdata, queues of messages) per plugin, "
+           "displayed by /debug memory (note: changes take effect at next "
+           "start of WeeChat)"),
+        NULL, 0, 0, "off", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     config_startup_sys_rlimit = config_file_new_option (
         weechat_config_file, ptr_section,
         "sys_rlimit", "string",
@@ -2689,6 +2717,15 @@ config_weechat_init_options ()
            "width on screen must be exactly one char"),
         NULL, 0, 0, "", NULL, 0,
         &config_check_separator, NULL, &config_change_buffers, NULL, NULL, NULL);
+    config_look_stall_threshold = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "stall_threshold", "integer",
+        N_("delay (in milliseconds) for an iteration of main loop (timers, "
+           "file descriptors and refresh of screen) above which it is "
+           "considered as a stall: the stall is written in WeeChat log file, "
+           "with the hook running and a backtrace (0 = disable stall "
+           "detection); see /debug loop"),
+        NULL, 0, 60000, "0", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     config_look_tab_width = config_file_new_option (
         weechat_config_file, ptr_section,
         "tab_width", "integer",
@@ -3298,9 +3335,16 @@ config_weechat_init_options ()
     config_network_connection_timeout = config_file_new_option (
         weechat_config_file, ptr_section,
         "connection_timeout", "integer",
-        N_("timeout (in seconds) for connection to a remote host (made in a "
-           "child process)"),
+        N_("timeout (in seconds) for connection to a remote host (including "
+           "resolution of name, dialog with proxy and SSL handshake)"),
         NULL, 1, INT_MAX, "60", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_network_dns_cache_ttl = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "dns_cache_ttl", "integer",
+        N_("time (in seconds) to keep the addresses of a resolved name in "
+           "cache (shared by all connections); 0 = disable cache"),
+        NULL, 0, 3600, "60", NULL, 0, NULL, NULL,
+        &config_change_network_dns_cache_ttl, NULL, NULL, NULL);
     config_network_gnutls_ca_file = config_file_new_option (
         weechat_config_file, ptr_section,
         "gnutls_ca_file", "string",
@@ -3321,6 +3365,13 @@ config_weechat_init_options ()
            "proxy must be defined with command /proxy"),
         NULL, 0, 0, "", NULL, 0,
         &config_check_proxy_curl, NULL, NULL, NULL, NULL, NULL);
+    config_network_url_max_transfers = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "url_max_transfers", "integer",
+        N_("max number of URL transfers running at same time (in scripts "
+           "calling function hook_process with \"url:...\"); other transfers "
+           "are queued"),
+        NULL, 1, 1024, "16", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* plugin */
     ptr_section = config_file_new_section (weechat_config_file, "plugin",
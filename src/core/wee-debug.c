@@ -29,6 +29,8 @@
 #endif
 #include <string.h>
 #include <time.h>
+#include <signal.h>
+#include <sys/time.h>
 #include <gcrypt.h>
 #include <curl/curl.h>
 #include <zlib.h>
@@ -37,15 +39,22 @@
 #include <gnutls/gnutls.h>
 #endif
 
+#ifdef HAVE_BACKTRACE
+#include <execinfo.h>
+#endif
+
 #include "weechat.h"
 #include "wee-backtrace.h"
+#include "wee-config.h"
 #include "wee-config-file.h"
+#include "wee-debug.h"
 #include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-infolist.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-proxy.h"
 #include "wee-string.h"
 #include "../gui/gui-bar.h"
@@ -63,6 +72,27 @@
 
 int debug_dump_active = 0;
 
+/* latency of main loop */
+char *debug_loop_phase_string[DEBUG_LOOP_NUM_PHASES] =
+{ "timer", "fd", "refresh", "wait", "busy" };
+struct t_debug_histogram debug_loop_histograms[DEBUG_LOOP_NUM_PHASES];
+long debug_loop_stalls = 0;            /* number of stalls in main loop     */
+time_t debug_loop_start_time = 0;      /* start time of loop statistics     */
+int debug_loop_phase = DEBUG_LOOP_PHASE_TIMER; /* current phase of loop     */
+struct timeval debug_loop_tv_phase;    /* start time of current phase       */
+struct timeval debug_loop_tv_busy;     /* start time of current iteration   */
+long long debug_loop_time_phases[DEBUG_LOOP_NUM_PHASES]; /* usec in phases  */
+
+/* watchdog of main loop (used to detect stalls) */
+int debug_loop_watchdog_init = 0;      /* 1 if SIGALRM handler is set       */
+int debug_loop_watchdog_armed = 0;     /* 1 if watchdog timer is armed      */
+volatile sig_atomic_t debug_loop_watchdog_fired = 0; /* 1 if timer expired  */
+int debug_loop_watchdog_phase = 0;     /* phase when watchdog expired       */
+struct t_hook *debug_loop_watchdog_hook = NULL; /* hook running at expiry   */
+void *debug_loop_watchdog_trace[BACKTRACE_MAX]; /* backtrace at expiry      */
+int debug_loop_watchdog_trace_size = 0; /* size of backtrace                */
+time_t debug_loop_last_backtrace = 0;  /* time of last backtrace logged     */
+
 
 /*
  * Writes dump of data to WeeChat log file.
@@ -101,6 +131,8 @@ debug_dump (int crash)
 
     infolist_print_log ();
 
+    memory_print_log ();
+
     hook_print_log ();
 
     config_file_print_log ();
@@ -234,6 +266,49 @@ debug_windows_tree ()
     debug_windows_tree_display (gui_windows_tree, 1);
 }
 
+/*
+ * Displays memory allocated per plugin and subsystem (if memory accounting
+ * is enabled).
+ */
+
+void
+debug_memory_tags ()
+{
+    struct t_memory_tag *ptr_tag;
+    long objects;
+    long long bytes;
+
+    gui_chat_printf (NULL, "");
+    if (!memory_accounting)
+    {
+        gui_chat_printf (NULL,
+                         _("Memory accounting is disabled (see option "
+                           "weechat.startup.memory_accounting)"));
+        return;
+    }
+
+    gui_chat_printf (NULL, _("Memory allocated per plugin and subsystem:"));
+    for (ptr_tag = memory_tags; ptr_tag; ptr_tag = ptr_tag->next_tag)
+    {
+        if (!ptr_tag->prev_tag
+            || (strcmp (ptr_tag->prev_tag->plugin_name,
+                        ptr_tag->plugin_name) != 0))
+        {
+            memory_tags_total (ptr_tag->plugin_name, &objects, &bytes);
+            gui_chat_printf (NULL, "  %s: %ld objects, %lld bytes",
+                             ptr_tag->plugin_name, objects, bytes);
+        }
+        gui_chat_printf (NULL,
+                         "    %-10s: %10ld objects, %12lld bytes "
+                         "(peak: %lld)",
+                         ptr_tag->name, ptr_tag->objects, ptr_tag->bytes,
+                         ptr_tag->bytes_peak);
+    }
+    memory_tags_total (NULL, &objects, &bytes);
+    gui_chat_printf (NULL, _("  Total: %ld objects, %lld bytes"),
+                     objects, bytes);
+}
+
 /*
  * Displays information about dynamic memory allocation.
  */
@@ -263,6 +338,8 @@ debug_memory ()
                      _("Memory usage not available (function \"mallinfo\" not "
                        "found)"));
 #endif
+
+    debug_memory_tags ();
 }
 
 /*
@@ -408,6 +485,120 @@ debug_hooks ()
     gui_chat_printf (NULL, "%17s:%5d", "total", num_hooks_total);
 }
 
+/*
+ * Compares two hooks by total time spent in callback (for qsort, the hook
+ * with the highest time is first).
+ */
+
+int
+debug_hooks_time_cmp_cb (const void *hook1, const void *hook2)
+{
+    long time1, time2;
+
+    time1 = (*((struct t_hook **)hook1))->stats_time_total;
+    time2 = (*((struct t_hook **)hook2))->stats_time_total;
+
+    if (time1 > time2)
+        return -1;
+    if (time1 < time2)
+        return 1;
+    return 0;
+}
+
+/*
+ * Displays time spent in hook callbacks (only hooks with highest total time
+ * are displayed, "count" is the max number of hooks displayed).
+ */
+
+void
+debug_hooks_time (int count)
+{
+    struct t_hook *ptr_hook, **hooks;
+    struct tm *local_time;
+    char str_plugin[512], str_time[128];
+    int i, num_hooks;
+
+    gui_chat_printf (NULL, "");
+
+    if (!hook_stats_enabled)
+    {
+        gui_chat_printf (NULL,
+                         "statistics on hooks are disabled (you can enable "
+                         "them with: /debug hooks-time enable)");
+        return;
+    }
+
+    num_hooks = 0;
+    for (i = 0; i < HOOK_NUM_TYPES; i++)
+    {
+        for (ptr_hook = weechat_hooks[i]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted && (ptr_hook->stats_calls > 0))
+                num_hooks++;
+        }
+    }
+
+    local_time = localtime (&hook_stats_start_time);
+    if (!local_time
+        || (strftime (str_time, sizeof (str_time),
+                      "%Y-%m-%d %H:%M:%S", local_time) == 0))
+    {
+        str_time[0] = '\0';
+    }
+    gui_chat_printf (NULL, "time spent in hook callbacks (since %s):",
+                     str_time);
+
+    if (num_hooks == 0)
+    {
+        gui_chat_printf (NULL, "  (no hook called)");
+        return;
+    }
+
+    hooks = malloc (num_hooks * sizeof (*hooks));
+    if (!hooks)
+        return;
+
+    num_hooks = 0;
+    for (i = 0; i < HOOK_NUM_TYPES; i++)
+    {
+        for (ptr_hook = weechat_hooks[i]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (!ptr_hook->deleted && (ptr_hook->stats_calls > 0))
+                hooks[num_hooks++] = ptr_hook;
+        }
+    }
+    qsort (hooks, num_hooks, sizeof (*hooks), &debug_hooks_time_cmp_cb);
+
+    gui_chat_printf (NULL, "  %10s %9s %9s %9s  %-14s %s",
+                     "total (ms)", "calls", "avg (us)", "max (us)", "type",
+                     "plugin: description");
+    for (i = 0; (i < num_hooks) && ((count <= 0) || (i < count)); i++)
+    {
+        ptr_hook = hooks[i];
+        snprintf (str_plugin, sizeof (str_plugin), "%s%s%s",
+                  plugin_get_name (ptr_hook->plugin),
+                  (ptr_hook->subplugin) ? "/" : "",
+                  (ptr_hook->subplugin) ? ptr_hook->subplugin : "");
+        gui_chat_printf (NULL, "  %10ld %9ld %9ld %9ld  %-14s %s: %s",
+                         ptr_hook->stats_time_total / 1000,
+                         ptr_hook->stats_calls,
+                         ptr_hook->stats_time_total / ptr_hook->stats_calls,
+                         ptr_hook->stats_time_max,
+                         hook_type_string[ptr_hook->type],
+                         str_plugin,
+                         hook_get_description (ptr_hook));
+    }
+    if (num_hooks > i)
+    {
+        gui_chat_printf (NULL, "  (%d other hooks not displayed)",
+                         num_hooks - i);
+    }
+
+    free (hooks);
+}
+
 /*
  * Displays a list of infolists in memory.
  */
@@ -418,7 +609,7 @@ debug_infolists ()
     struct t_infolist *ptr_infolist;
     struct t_infolist_item *ptr_item;
     struct t_infolist_var *ptr_var;
-    int i, count, count_items, count_vars, size_structs, size_data;
+    int i, j, count, count_items, count_vars, size_structs, size_data;
     int total_items, total_vars, total_size;
 
     count = 0;
@@ -448,38 +639,35 @@ debug_infolists ()
             count_vars = 0;
             size_structs = sizeof (*ptr_infolist);
             size_data = 0;
+            size_structs += ptr_infolist->schema_size *
+                sizeof (*ptr_infolist->schema);
+            for (j = 0; j < ptr_infolist->schema_count; j++)
+            {
+                size_data += strlen (ptr_infolist->schema[j].name);
+            }
             for (ptr_item = ptr_infolist->items; ptr_item;
                  ptr_item = ptr_item->next_item)
             {
                 count_items++;
                 total_items++;
-                size_structs += sizeof (*ptr_item);
-                for (ptr_var = ptr_item->vars; ptr_var;
-                     ptr_var = ptr_var->next_var)
+                size_structs += sizeof (*ptr_item) +
+                    (ptr_item->vars_size * sizeof (*ptr_item->vars));
+                for (j = 0; j < ptr_item->vars_count; j++)
                 {
+                    ptr_var = &ptr_item->vars[j];
                     count_vars++;
                     total_vars++;
-                    size_structs += sizeof (*ptr_var);
-                    if (ptr_var->value)
+                    switch (ptr_var->type)
                     {
-                        switch (ptr_var->type)
-                        {
-                            case INFOLIST_INTEGER:
-                                size_data += sizeof (int);
-                                break;
-                            case INFOLIST_STRING:
-                                size_data += strlen ((char *)(ptr_var->value));
-                                break;
-                            case INFOLIST_POINTER:
-                                size_data += sizeof (void *);
-                                break;
-                            case INFOLIST_BUFFER:
-                                size_data += ptr_var->size;
-                                break;
-                            case INFOLIST_TIME:
-                                size_data += sizeof (time_t);
-                                break;
-                        }
+                        case INFOLIST_STRING:
+                            if (ptr_var->value.string)
+                                size_data += strlen (ptr_var->value.string);
+                            break;
+                        case INFOLIST_BUFFER:
+                            size_data += ptr_var->size;
+                            break;
+                        default:
+                            break;
                     }
                 }
             }
@@ -577,6 +765,532 @@ debug_directories ()
     gui_chat_printf (NULL, "  locale: %s", LOCALEDIR);
 }
 
+/*
+ * Resets a histogram.
+ */
+
+void
+debug_histogram_reset (struct t_debug_histogram *histogram)
+{
+    memset (histogram, 0, sizeof (*histogram));
+}
+
+/*
+ * Returns index of bucket for a value in a histogram.
+ *
+ * Values below DEBUG_HISTOGRAM_SUB_COUNT have their own bucket, then each
+ * power of 2 is split in DEBUG_HISTOGRAM_SUB_COUNT buckets (so the relative
+ * error on a value is at most 1/DEBUG_HISTOGRAM_SUB_COUNT).
+ */
+
+int
+debug_histogram_index (long long value)
+{
+    long long value2;
+    int msb, shift, index;
+
+    if (value < DEBUG_HISTOGRAM_SUB_COUNT)
+        return (value < 0) ? 0 : (int)value;
+
+    msb = 0;
+    value2 = value;
+    while (value2 >>= 1)
+    {
+        msb++;
+    }
+    shift = msb - DEBUG_HISTOGRAM_SUB_BITS;
+    index = ((shift + 1) * DEBUG_HISTOGRAM_SUB_COUNT)
+        + (int)((value >> shift) - DEBUG_HISTOGRAM_SUB_COUNT);
+
+    return (index >= DEBUG_HISTOGRAM_BUCKETS) ?
+        DEBUG_HISTOGRAM_BUCKETS - 1 : index;
+}
+
+/*
+ * Returns the highest value in a bucket of histogram.
+ */
+
+long long
+debug_histogram_bucket_max (int index)
+{
+    int group, shift;
+
+    group = index / DEBUG_HISTOGRAM_SUB_COUNT;
+    if (group == 0)
+        return index;
+
+    shift = group - 1;
+    return (((long long)(DEBUG_HISTOGRAM_SUB_COUNT
+                         + (index % DEBUG_HISTOGRAM_SUB_COUNT)) << shift)
+            + (1LL << shift) - 1);
+}
+
+/*
+ * Adds a value in a histogram.
+ */
+
+void
+debug_histogram_add (struct t_debug_histogram *histogram, long long value)
+{
+    if (value < 0)
+        value = 0;
+
+    if ((histogram->count == 0) || (value < histogram->min))
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+    histogram->count++;
+    histogram->total += value;
+    histogram->buckets[debug_histogram_index (value)]++;
+}
+
+/*
+ * Returns value at a given percentile (between 0 and 100) in a histogram
+ * (highest value of the bucket found, limited to min/max values added).
+ */
+
+long long
+debug_histogram_percentile (struct t_debug_histogram *histogram,
+                            double percentile)
+{
+    long long target, count, value;
+    int i;
+
+    if (histogram->count == 0)
+        return 0;
+
+    if (percentile < 0)
+        percentile = 0;
+    if (percentile > 100)
+        percentile = 100;
+
+    target = (long long)((percentile * histogram->count / 100) + 0.999999);
+    if (target < 1)
+        target = 1;
+
+    count = 0;
+    for (i = 0; i < DEBUG_HISTOGRAM_BUCKETS; i++)
+    {
+        count += histogram->buckets[i];
+        if (count >= target)
+        {
+            /* last bucket contains all values above the max of histogram */
+            if (i == DEBUG_HISTOGRAM_BUCKETS - 1)
+                return histogram->max;
+            value = debug_histogram_bucket_max (i);
+            if (value < histogram->min)
+                value = histogram->min;
+            if (value > histogram->max)
+                value = histogram->max;
+            return value;
+        }
+    }
+
+    return histogram->max;
+}
+
+/*
+ * Returns difference between two times (in microseconds).
+ */
+
+long long
+debug_loop_time_diff (struct timeval *tv1, struct timeval *tv2)
+{
+    return ((long long)(tv2->tv_sec - tv1->tv_sec) * 1000000LL)
+        + (tv2->tv_usec - tv1->tv_usec);
+}
+
+/*
+ * Callback for signal SIGALRM: the watchdog of main loop has expired (an
+ * iteration of main loop is too long), the backtrace is saved (it will be
+ * written in log file at the end of iteration).
+ */
+
+void
+debug_loop_watchdog_cb (int signum)
+{
+    /* make C compiler happy */
+    (void) signum;
+
+    if (debug_loop_watchdog_fired)
+        return;
+
+    debug_loop_watchdog_fired = 1;
+    debug_loop_watchdog_phase = debug_loop_phase;
+    debug_loop_watchdog_hook = hook_main_loop_running;
+#ifdef HAVE_BACKTRACE
+    debug_loop_watchdog_trace_size = backtrace (debug_loop_watchdog_trace,
+                                                BACKTRACE_MAX);
+#endif
+}
+
+/*
+ * Arms the watchdog of main loop: signal SIGALRM is received if the
+ * iteration lasts more than "delay" milliseconds.
+ */
+
+void
+debug_loop_watchdog_arm (int delay)
+{
+    struct sigaction act;
+    struct itimerval timer;
+
+    if (!debug_loop_watchdog_init)
+    {
+        sigemptyset (&act.sa_mask);
+        act.sa_flags = SA_RESTART;
+        act.sa_handler = &debug_loop_watchdog_cb;
+        sigaction (SIGALRM, &act, NULL);
+#ifdef HAVE_BACKTRACE
+        /*
+         * first call to backtrace may allocate memory (load of libgcc), so
+         * it is done here and not in the signal handler
+         */
+        (void) backtrace (debug_loop_watchdog_trace, 1);
+#endif
+        debug_loop_watchdog_init = 1;
+    }
+
+    debug_loop_watchdog_fired = 0;
+    debug_loop_watchdog_hook = NULL;
+    debug_loop_watchdog_trace_size = 0;
+
+    memset (&timer, 0, sizeof (timer));
+    timer.it_value.tv_sec = delay / 1000;
+    timer.it_value.tv_usec = (delay % 1000) * 1000;
+    if (setitimer (ITIMER_REAL, &timer, NULL) == 0)
+        debug_loop_watchdog_armed = 1;
+}
+
+/*
+ * Disarms the watchdog of main loop.
+ *
+ * This must be called before executing a new binary (the timer is kept
+ * by execve).
+ */
+
+void
+debug_loop_watchdog_disarm ()
+{
+    struct itimerval timer;
+
+    if (!debug_loop_watchdog_armed)
+        return;
+
+    memset (&timer, 0, sizeof (timer));
+    setitimer (ITIMER_REAL, &timer, NULL);
+    debug_loop_watchdog_armed = 0;
+}
+
+/*
+ * Writes a stall of main loop in WeeChat log file: time spent in each phase,
+ * hook running when the watchdog expired and backtrace (at most one
+ * backtrace per minute is written).
+ */
+
+void
+debug_loop_stall (long long time_busy)
+{
+    struct t_hook *ptr_hook;
+    time_t now;
+
+    debug_loop_stalls++;
+
+    log_printf ("Main loop stall: %lld ms (timer: %lld ms, fd: %lld ms, "
+                "refresh: %lld ms)",
+                time_busy / 1000,
+                debug_loop_time_phases[DEBUG_LOOP_PHASE_TIMER] / 1000,
+                debug_loop_time_phases[DEBUG_LOOP_PHASE_FD] / 1000,
+                debug_loop_time_phases[DEBUG_LOOP_PHASE_REFRESH] / 1000);
+
+    if (!debug_loop_watchdog_fired)
+        return;
+
+    ptr_hook = debug_loop_watchdog_hook;
+    if (ptr_hook && hook_valid (ptr_hook))
+    {
+        log_printf ("  running in phase \"%s\": %s hook (plugin: %s): %s",
+                    debug_loop_phase_string[debug_loop_watchdog_phase],
+                    hook_type_string[ptr_hook->type],
+                    plugin_get_name (ptr_hook->plugin),
+                    hook_get_description (ptr_hook));
+    }
+    else
+    {
+        log_printf ("  running in phase \"%s\"",
+                    debug_loop_phase_string[debug_loop_watchdog_phase]);
+    }
+
+    now = time (NULL);
+    if ((debug_loop_watchdog_trace_size > 0)
+        && (now >= debug_loop_last_backtrace + 60))
+    {
+        weechat_backtrace_log (debug_loop_watchdog_trace,
+                               debug_loop_watchdog_trace_size);
+        debug_loop_last_backtrace = now;
+    }
+}
+
+/*
+ * Starts a phase of main loop.
+ */
+
+void
+debug_loop_phase_start (int phase)
+{
+    debug_loop_phase = phase;
+    gettimeofday (&debug_loop_tv_phase, NULL);
+}
+
+/*
+ * Ends current phase of main loop (started with debug_loop_phase_start).
+ */
+
+void
+debug_loop_phase_end ()
+{
+    struct timeval tv_now;
+    long long diff;
+
+    gettimeofday (&tv_now, NULL);
+    diff = debug_loop_time_diff (&debug_loop_tv_phase, &tv_now);
+    if (diff < 0)
+        diff = 0;
+
+    debug_histogram_add (&debug_loop_histograms[debug_loop_phase], diff);
+    debug_loop_time_phases[debug_loop_phase] += diff;
+}
+
+/*
+ * Ends an iteration of main loop (just before waiting for activity): checks
+ * if the iteration is a stall and starts the wait phase.
+ */
+
+void
+debug_loop_wait_start ()
+{
+    long long time_busy;
+    int i, threshold;
+
+    gettimeofday (&debug_loop_tv_phase, NULL);
+    debug_loop_phase = DEBUG_LOOP_PHASE_WAIT;
+
+    debug_loop_watchdog_disarm ();
+
+    if (debug_loop_tv_busy.tv_sec != 0)
+    {
+        time_busy = debug_loop_time_diff (&debug_loop_tv_busy,
+                                          &debug_loop_tv_phase);
+        if (time_busy < 0)
+            time_busy = 0;
+        debug_histogram_add (&debug_loop_histograms[DEBUG_LOOP_PHASE_BUSY],
+                             time_busy);
+        threshold = CONFIG_INTEGER(config_look_stall_threshold);
+        if ((threshold > 0) && (time_busy >= (long long)threshold * 1000))
+            debug_loop_stall (time_busy);
+    }
+
+    for (i = 0; i < DEBUG_LOOP_NUM_PHASES; i++)
+    {
+        debug_loop_time_phases[i] = 0;
+    }
+}
+
+/*
+ * Ends the wait phase of main loop and starts a new iteration (arms the
+ * watchdog if the stall detection is enabled).
+ */
+
+void
+debug_loop_wait_end ()
+{
+    long long time_wait;
+    int threshold;
+
+    gettimeofday (&debug_loop_tv_busy, NULL);
+    time_wait = debug_loop_time_diff (&debug_loop_tv_phase,
+                                      &debug_loop_tv_busy);
+    debug_histogram_add (&debug_loop_histograms[DEBUG_LOOP_PHASE_WAIT],
+                         time_wait);
+
+    threshold = CONFIG_INTEGER(config_look_stall_threshold);
+    if (threshold > 0)
+        debug_loop_watchdog_arm (threshold);
+}
+
+/*
+ * Resets statistics on main loop.
+ */
+
+void
+debug_loop_reset ()
+{
+    int i;
+
+    for (i = 0; i < DEBUG_LOOP_NUM_PHASES; i++)
+    {
+        debug_histogram_reset (&debug_loop_histograms[i]);
+    }
+    debug_loop_stalls = 0;
+    debug_loop_start_time = time (NULL);
+}
+
+/*
+ * Returns info "loop_latency".
+ *
+ * Format of arguments is: "phase,value", where phase is one of:
+ * timer/fd/refresh/wait/busy (default is "busy") and value is one of:
+ * count/min/avg/max/stalls/pNN (NN is a percentile, for example "p99" or
+ * "p99.9"); if value is not given, all values are returned.
+ *
+ * Returns NULL if arguments are invalid.
+ */
+
+const char *
+debug_loop_info (const char *arguments)
+{
+    static char value[512];
+    struct t_debug_histogram *ptr_histogram;
+    char *phase, *error;
+    const char *pos;
+    double percentile;
+    int i, index_phase;
+
+    index_phase = DEBUG_LOOP_PHASE_BUSY;
+    pos = NULL;
+
+    if (arguments && arguments[0])
+    {
+        pos = strchr (arguments, ',');
+        phase = (pos) ?
+            string_strndup (arguments, pos - arguments) : strdup (arguments);
+        if (!phase)
+            return NULL;
+        index_phase = -1;
+        for (i = 0; i < DEBUG_LOOP_NUM_PHASES; i++)
+        {
+            if (string_strcasecmp (debug_loop_phase_string[i], phase) == 0)
+            {
+                index_phase = i;
+                break;
+            }
+        }
+        free (phase);
+        if (index_phase < 0)
+            return NULL;
+        if (pos)
+            pos++;
+    }
+
+    ptr_histogram = &debug_loop_histograms[index_phase];
+
+    if (!pos || !pos[0])
+    {
+        snprintf (value, sizeof (value),
+                  "count=%lld min=%lld avg=%lld p50=%lld p90=%lld p99=%lld "
+                  "p99.9=%lld max=%lld stalls=%ld",
+                  ptr_histogram->count,
+                  ptr_histogram->min,
+                  (ptr_histogram->count > 0) ?
+                  ptr_histogram->total / ptr_histogram->count : 0,
+                  debug_histogram_percentile (ptr_histogram, 50),
+                  debug_histogram_percentile (ptr_histogram, 90),
+                  debug_histogram_percentile (ptr_histogram, 99),
+                  debug_histogram_percentile (ptr_histogram, 99.9),
+                  ptr_histogram->max,
+                  debug_loop_stalls);
+        return value;
+    }
+
+    if (string_strcasecmp (pos, "count") == 0)
+        snprintf (value, sizeof (value), "%lld", ptr_histogram->count);
+    else if (string_strcasecmp (pos, "min") == 0)
+        snprintf (value, sizeof (value), "%lld", ptr_histogram->min);
+    else if (string_strcasecmp (pos, "avg") == 0)
+    {
+        snprintf (value, sizeof (value), "%lld",
+                  (ptr_histogram->count > 0) ?
+                  ptr_histogram->total / ptr_histogram->count : 0);
+    }
+    else if (string_strcasecmp (pos, "max") == 0)
+        snprintf (value, sizeof (value), "%lld", ptr_histogram->max);
+    else if (string_strcasecmp (pos, "stalls") == 0)
+        snprintf (value, sizeof (value), "%ld", debug_loop_stalls);
+    else if ((pos[0] == 'p') || (pos[0] == 'P'))
+    {
+        error = NULL;
+        percentile = strtod (pos + 1, &error);
+        if (!error || error[0] || (percentile < 0) || (percentile > 100))
+            return NULL;
+        snprintf (value, sizeof (value), "%lld",
+                  debug_histogram_percentile (ptr_histogram, percentile));
+    }
+    else
+        return NULL;
+
+    return value;
+}
+
+/*
+ * Displays latency of main loop (time spent in each phase).
+ */
+
+void
+debug_loop ()
+{
+    struct t_debug_histogram *ptr_histogram;
+    struct tm *local_time;
+    char str_time[128];
+    int i;
+
+    local_time = localtime (&debug_loop_start_time);
+    if (!local_time
+        || (strftime (str_time, sizeof (str_time),
+                      "%Y-%m-%d %H:%M:%S", local_time) == 0))
+    {
+        str_time[0] = '\0';
+    }
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     "main loop latency (since %s, values in microseconds):",
+                     str_time);
+    gui_chat_printf (NULL, "  %-8s %10s %9s %9s %9s %9s %9s %9s %9s",
+                     "phase", "count", "min", "avg", "p50", "p90", "p99",
+                     "p99.9", "max");
+    for (i = 0; i < DEBUG_LOOP_NUM_PHASES; i++)
+    {
+        ptr_histogram = &debug_loop_histograms[i];
+        gui_chat_printf (NULL,
+                         "  %-8s %10lld %9lld %9lld %9lld %9lld %9lld %9lld "
+                         "%9lld",
+                         debug_loop_phase_string[i],
+                         ptr_histogram->count,
+                         ptr_histogram->min,
+                         (ptr_histogram->count > 0) ?
+                         ptr_histogram->total / ptr_histogram->count : 0,
+                         debug_histogram_percentile (ptr_histogram, 50),
+                         debug_histogram_percentile (ptr_histogram, 90),
+                         debug_histogram_percentile (ptr_histogram, 99),
+                         debug_histogram_percentile (ptr_histogram, 99.9),
+                         ptr_histogram->max);
+    }
+    if (CONFIG_INTEGER(config_look_stall_threshold) > 0)
+    {
+        gui_chat_printf (NULL,
+                         "stalls (iterations longer than %d ms): %ld "
+                         "(details in WeeChat log file)",
+                         CONFIG_INTEGER(config_look_stall_threshold),
+                         debug_loop_stalls);
+    }
+    else
+    {
+        gui_chat_printf (NULL,
+                         "stall detection is disabled (see option "
+                         "weechat.look.stall_threshold)");
+    }
+}
+
 /*
  * Hooks signals for debug.
  */
@@ -591,4 +1305,6 @@ debug_init ()
      */
     hook_signal (NULL, "2000|debug_dump", &debug_dump_cb, NULL);
     hook_signal (NULL, "2000|debug_libs", &debug_libs_cb, NULL);
+
+    debug_loop_reset ();
 }
@@ -22,13 +22,62 @@
 
 struct t_gui_window_tree;
 
+/* histogram: log-linear buckets (like HDR histograms), values in usec */
+
+#define DEBUG_HISTOGRAM_SUB_BITS  3
+#define DEBUG_HISTOGRAM_SUB_COUNT (1 << DEBUG_HISTOGRAM_SUB_BITS)
+#define DEBUG_HISTOGRAM_MAX_BITS  40
+#define DEBUG_HISTOGRAM_BUCKETS                                         \
+    ((DEBUG_HISTOGRAM_MAX_BITS - DEBUG_HISTOGRAM_SUB_BITS + 1)          \
+     * DEBUG_HISTOGRAM_SUB_COUNT)
+
+/* phases of main loop (measured with histograms) */
+
+enum t_debug_loop_phase
+{
+    DEBUG_LOOP_PHASE_TIMER = 0,        /* execution of timers               */
+    DEBUG_LOOP_PHASE_FD,               /* execution of fd callbacks         */
+    DEBUG_LOOP_PHASE_REFRESH,          /* refresh of screen                 */
+    DEBUG_LOOP_PHASE_WAIT,             /* wait for activity (select)        */
+    DEBUG_LOOP_PHASE_BUSY,             /* iteration, without wait           */
+    /* number of phases */
+    DEBUG_LOOP_NUM_PHASES,
+};
+
+struct t_debug_histogram
+{
+    long long count;                   /* number of values                  */
+    long long total;                   /* sum of values                     */
+    long long min;                     /* min value                         */
+    long long max;                     /* max value                         */
+    long long buckets[DEBUG_HISTOGRAM_BUCKETS]; /* count of values/bucket   */
+};
+
+extern char *debug_loop_phase_string[];
+extern struct t_debug_histogram debug_loop_histograms[];
+extern long debug_loop_stalls;
+
 extern void debug_sigsegv ();
 extern void debug_windows_tree ();
 extern void debug_memory ();
 extern void debug_hdata ();
 extern void debug_hooks ();
+extern void debug_hooks_time (int count);
 extern void debug_infolists ();
 extern void debug_directories ();
+extern void debug_histogram_reset (struct t_debug_histogram *histogram);
+extern void debug_histogram_add (struct t_debug_histogram *histogram,
+                                 long long value);
+extern long long debug_histogram_percentile (struct t_debug_histogram *histogram,
+                                             double percentile);
+extern void debug_loop_phase_start (int phase);
+extern void debug_loop_phase_end ();
+extern void debug_loop_wait_start ();
+extern void debug_loop_wait_end ();
+extern void debug_loop_watchdog_disarm ();
+extern void debug_loop_reset ();
+extern const char *debug_loop_info (const char *arguments);
+extern void debug_loop ();
 extern void debug_init ();
 
 #endif /* WEECHAT_DEBUG_H */
@@ -32,6 +32,7 @@
 #include "wee-infolist.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-string.h"
 #include "../plugins/plugin.h"
 
@@ -175,6 +176,62 @@ hashtable_keycmp_default_cb (struct t_hashtable *hashtable,
     return rc;
 }
 
+/*
+ * Hashes a string key, ignoring case (for chars A-Z only, like function
+ * string_strcasecmp).
+ *
+ * This callback can be used for hashtables with string keys, with callback
+ * "hashtable_keycmp_string_case_cb".
+ *
+ * Returns the hash of the key.
+ */
+
+unsigned long long
+hashtable_hash_key_string_case_cb (struct t_hashtable *hashtable,
+                                   const void *key)
+{
+    unsigned long long hash;
+    const char *ptr_string;
+    int c;
+
+    /* make C compiler happy */
+    (void) hashtable;
+
+    hash = 5381;
+    for (ptr_string = (const char *)key; ptr_string[0]; ptr_string++)
+    {
+        c = (int)(ptr_string[0]);
+        if ((c >= 'A') && (c <= 'Z'))
+            c += ('a' - 'A');
+        hash ^= (hash << 5) + (hash >> 2) + c;
+    }
+
+    return hash;
+}
+
+/*
+ * Compares two string keys, ignoring case.
+ *
+ * Returns:
+ *   < 0: key1 < key2
+ *     0: key1 == key2
+ *   > 0: key1 > key2
+ */
+
+int
+hashtable_keycmp_string_case_cb (struct t_hashtable *hashtable,
+                                 const void *key1, const void *key2)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+
+    /* fast path: keys are often exactly the same */
+    if (strcmp ((const char *)key1, (const char *)key2) == 0)
+        return 0;
+
+    return string_strcasecmp ((const char *)key1, (const char *)key2);
+}
+
 /*
  * Creates a new hashtable.
  *
@@ -193,6 +250,7 @@ hashtable_new (int size,
                t_hashtable_keycmp *callback_keycmp)
 {
     struct t_hashtable *new_hashtable;
+    struct t_memory_tag *memory_tag;
     int i, type_keys_int, type_values_int;
 
     if (size <= 0)
@@ -209,17 +267,21 @@ hashtable_new (int size,
     if ((type_keys_int == HASHTABLE_BUFFER) && (!callback_hash_key || !callback_keycmp))
         return NULL;
 
-    new_hashtable = malloc (sizeof (*new_hashtable));
+    memory_tag = memory_tag_get (NULL, "hashtable");
+
+    new_hashtable = memory_malloc (memory_tag, sizeof (*new_hashtable));
     if (new_hashtable)
     {
+        new_hashtable->memory_tag = memory_tag;
         new_hashtable->size = size;
         new_hashtable->type_keys = type_keys_int;
         new_hashtable->type_values = type_values_int;
-        new_hashtable->htable = malloc (size * sizeof (*(new_hashtable->htable)));
+        new_hashtable->htable = memory_malloc (
+            memory_tag, size * sizeof (*(new_hashtable->htable)));
         new_hashtable->keys_values = NULL;
         if (!new_hashtable->htable)
         {
-            free (new_hashtable);
+            memory_free (memory_tag, new_hashtable);
             return NULL;
         }
         for (i = 0; i < size; i++)
@@ -406,7 +468,7 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
     }
 
     /* create new item */
-    new_item = malloc (sizeof (*new_item));
+    new_item = memory_malloc (hashtable->memory_tag, sizeof (*new_item));
     if (!new_item)
         return NULL;
 
@@ -927,7 +989,7 @@ hashtable_get_keys_values (struct t_hashtable *hashtable,
 
     if (hashtable->keys_values)
     {
-        free (hashtable->keys_values);
+        memory_free (hashtable->memory_tag, hashtable->keys_values);
         hashtable->keys_values = NULL;
     }
 
@@ -942,7 +1004,7 @@ hashtable_get_keys_values (struct t_hashtable *hashtable,
         return hashtable->keys_values;
 
     /* build string */
-    hashtable->keys_values = malloc (length + 1);
+    hashtable->keys_values = memory_malloc (hashtable->memory_tag, length + 1);
     if (!hashtable->keys_values)
         return NULL;
     hashtable->keys_values[0] = '\0';
@@ -1125,7 +1187,7 @@ hashtable_remove_item (struct t_hashtable *hashtable,
     if (hashtable->htable[hash] == item)
         hashtable->htable[hash] = item->next_item;
 
-    free (item);
+    memory_free (hashtable->memory_tag, item);
 
     hashtable->items_count--;
 }
@@ -1180,10 +1242,10 @@ hashtable_free (struct t_hashtable *hashtable)
         return;
 
     hashtable_remove_all (hashtable);
-    free (hashtable->htable);
+    memory_free (hashtable->memory_tag, hashtable->htable);
     if (hashtable->keys_values)
-        free (hashtable->keys_values);
-    free (hashtable);
+        memory_free (hashtable->memory_tag, hashtable->keys_values);
+    memory_free (hashtable->memory_tag, hashtable);
 }
 
 /*
@@ -1198,6 +1260,7 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
 
     log_printf ("");
     log_printf ("[hashtable %s (addr:0x%lx)]", name, hashtable);
+    log_printf ("  memory_tag . . . . . . : 0x%lx", hashtable->memory_tag);
     log_printf ("  size . . . . . . . . . : %d",    hashtable->size);
     log_printf ("  htable . . . . . . . . : 0x%lx", hashtable->htable);
     log_printf ("  items_count. . . . . . : %d",    hashtable->items_count);
@@ -22,6 +22,7 @@
 
 struct t_hashtable;
 struct t_infolist_item;
+struct t_memory_tag;
 
 typedef unsigned long long (t_hashtable_hash_key)(struct t_hashtable *hashtable,
                                                   const void *key);
@@ -92,6 +93,7 @@ struct t_hashtable_item
 
 struct t_hashtable
 {
+    struct t_memory_tag *memory_tag;   /* tag for memory accounting         */
     int size;                          /* hashtable size                    */
     struct t_hashtable_item **htable;  /* table to map hashes with linked   */
                                        /* lists                             */
@@ -113,6 +115,11 @@ struct t_hashtable
 };
 
 extern unsigned long long hashtable_hash_key_djb2 (const char *string);
+extern unsigned long long hashtable_hash_key_string_case_cb (struct t_hashtable *hashtable,
+                                                            const void *key);
+extern int hashtable_keycmp_string_case_cb (struct t_hashtable *hashtable,
+                                            const void *key1,
+                                            const void *key2);
 extern struct t_hashtable *hashtable_new (int size,
                                           const char *type_keys,
                                           const char *type_values,
@@ -31,6 +31,7 @@
 #include "wee-eval.h"
 #include "wee-hashtable.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-string.h"
 #include "../plugins/plugin.h"
 
@@ -52,39 +53,43 @@ char *hdata_type_string[9] =
  */
 
 void
-hdata_free_var (struct t_hashtable *hashtable,
-                const void *key, void *value)
+hdata_free_var (struct t_hdata *hdata, struct t_hdata_var *var)
 {
-    struct t_hdata_var *var;
+    if (var->array_size)
+        memory_free (hdata->memory_tag, var->array_size);
+    if (var->hdata_name)
+        memory_free (hdata->memory_tag, var->hdata_name);
+    memory_free (hdata->memory_tag, var);
+}
+
+/*
+ * Frees a hdata variable (callback called for each variable in hdata).
+ */
 
+void
+hdata_free_var_map_cb (void *data, struct t_hashtable *hashtable,
+                       const void *key, const void *value)
+{
     /* make C compiler happy */
     (void) hashtable;
     (void) key;
 
-    var = (struct t_hdata_var *)value;
-    if (var)
-    {
-        if (var->array_size)
-            free (var->array_size);
-        if (var->hdata_name)
-            free (var->hdata_name);
-        free (var);
-    }
+    hdata_free_var ((struct t_hdata *)data, (struct t_hdata_var *)value);
 }
 
 /*
- * Frees a hdata list.
+ * Frees a hdata list (callback called for each list in hdata).
  */
 
 void
-hdata_free_list (struct t_hashtable *hashtable,
-                 const void *key, void *value)
+hdata_free_list_map_cb (void *data, struct t_hashtable *hashtable,
+                        const void *key, const void *value)
 {
     /* make C compiler happy */
     (void) hashtable;
     (void) key;
 
-    free (value);
+    memory_free (((struct t_hdata *)data)->memory_tag, (void *)value);
 }
 
 /*
@@ -104,29 +109,31 @@ hdata_new (struct t_weechat_plugin *plugin, const char *hdata_name,
            void *callback_update_data)
 {
     struct t_hdata *new_hdata;
+    struct t_memory_tag *memory_tag;
 
     if (!hdata_name || !hdata_name[0])
         return NULL;
 
-    new_hdata = malloc (sizeof (*new_hdata));
+    memory_tag = memory_tag_get_plugin (plugin, "hdata");
+
+    new_hdata = memory_malloc (memory_tag, sizeof (*new_hdata));
     if (new_hdata)
     {
-        new_hdata->name = strdup (hdata_name);
+        new_hdata->memory_tag = memory_tag;
+        new_hdata->name = memory_strdup (memory_tag, hdata_name);
         new_hdata->plugin = plugin;
-        new_hdata->var_prev = (var_prev) ? strdup (var_prev) : NULL;
-        new_hdata->var_next = (var_next) ? strdup (var_next) : NULL;
+        new_hdata->var_prev = memory_strdup (memory_tag, var_prev);
+        new_hdata->var_next = memory_strdup (memory_tag, var_next);
         new_hdata->hash_var = hashtable_new (32,
                                              WEECHAT_HASHTABLE_STRING,
                                              WEECHAT_HASHTABLE_POINTER,
                                              NULL,
                                              NULL);
-        new_hdata->hash_var->callback_free_value = &hdata_free_var;
         new_hdata->hash_list = hashtable_new (32,
                                               WEECHAT_HASHTABLE_STRING,
                                               WEECHAT_HASHTABLE_POINTER,
                                               NULL,
                                               NULL);
-        new_hdata->hash_list->callback_free_value = &hdata_free_list;
         hashtable_set (weechat_hdata, hdata_name, new_hdata);
         new_hdata->create_allowed = create_allowed;
         new_hdata->delete_allowed = delete_allowed;
@@ -147,19 +154,24 @@ hdata_new_var (struct t_hdata *hdata, const char *name, int offset, int type,
                int update_allowed, const char *array_size,
                const char *hdata_name)
 {
-    struct t_hdata_var *var;
+    struct t_hdata_var *var, *ptr_var;
 
     if (!hdata || !name)
         return;
 
-    var = malloc (sizeof (*var));
+    var = memory_malloc (hdata->memory_tag, sizeof (*var));
     if (var)
     {
         var->offset = offset;
         var->type = type;
         var->update_allowed = update_allowed;
-        var->array_size = (array_size && array_size[0]) ? strdup (array_size) : NULL;
-        var->hdata_name = (hdata_name && hdata_name[0]) ? strdup (hdata_name) : NULL;
+        var->array_size = (array_size && array_size[0]) ?
+            memory_strdup (hdata->memory_tag, array_size) : NULL;
+        var->hdata_name = (hdata_name && hdata_name[0]) ?
+            memory_strdup (hdata->memory_tag, hdata_name) : NULL;
+        ptr_var = hashtable_get (hdata->hash_var, name);
+        if (ptr_var)
+            hdata_free_var (hdata, ptr_var);
         hashtable_set (hdata->hash_var, name, var);
     }
 }
@@ -172,16 +184,19 @@ void
 hdata_new_list (struct t_hdata *hdata, const char *name, void *pointer,
                 int flags)
 {
-    struct t_hdata_list *list;
+    struct t_hdata_list *list, *ptr_list;
 
     if (!hdata || !name)
         return;
 
-    list = malloc (sizeof (*list));
+    list = memory_malloc (hdata->memory_tag, sizeof (*list));
     if (list)
     {
         list->pointer = pointer;
         list->flags = flags;
+        ptr_list = hashtable_get (hdata->hash_list, name);
+        if (ptr_list)
+            memory_free (hdata->memory_tag, ptr_list);
         hashtable_set (hdata->hash_list, name, list);
     }
 }
@@ -1063,17 +1078,23 @@ void
 hdata_free (struct t_hdata *hdata)
 {
     if (hdata->hash_var)
+    {
+        hashtable_map (hdata->hash_var, &hdata_free_var_map_cb, hdata);
         hashtable_free (hdata->hash_var);
+    }
     if (hdata->var_prev)
-        free (hdata->var_prev);
+        memory_free (hdata->memory_tag, hdata->var_prev);
     if (hdata->var_next)
-        free (hdata->var_next);
+        memory_free (hdata->memory_tag, hdata->var_next);
     if (hdata->hash_list)
+    {
+        hashtable_map (hdata->hash_list, &hdata_free_list_map_cb, hdata);
         hashtable_free (hdata->hash_list);
+    }
     if (hdata->name)
-        free (hdata->name);
+        memory_free (hdata->memory_tag, hdata->name);
 
-    free (hdata);
+    memory_free (hdata->memory_tag, hdata);
 }
 
 /*
@@ -1181,6 +1202,7 @@ hdata_print_log_map_cb (void *data, struct t_hashtable *hashtable,
     log_printf ("[hdata (addr:0x%lx)]", ptr_hdata);
     log_printf ("  name . . . . . . . . . : '%s'",  ptr_hdata->name);
     log_printf ("  plugin . . . . . . . . : 0x%lx", ptr_hdata->plugin);
+    log_printf ("  memory_tag . . . . . . : 0x%lx", ptr_hdata->memory_tag);
     log_printf ("  var_prev . . . . . . . : '%s'",  ptr_hdata->var_prev);
     log_printf ("  var_next . . . . . . . : '%s'",  ptr_hdata->var_next);
     log_printf ("  hash_var . . . . . . . : 0x%lx (hashtable: '%s')",
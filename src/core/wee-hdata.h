@@ -28,6 +28,8 @@
 #define HDATA_LIST(__name, __flags)                                     \
     hdata_new_list (hdata, #__name, &(__name), __flags);
 
+struct t_memory_tag;
+
 struct t_hdata_var
 {
     int offset;                        /* offset                            */
@@ -48,6 +50,7 @@ struct t_hdata
     char *name;                        /* name of hdata                     */
     struct t_weechat_plugin *plugin;   /* plugin which created this hdata   */
                                        /* (NULL if created by WeeChat)      */
+    struct t_memory_tag *memory_tag;   /* tag for memory accounting         */
     char *var_prev;                    /* name of var with pointer to       */
                                        /* previous element in list          */
     char *var_next;                    /* name of var with pointer to       */
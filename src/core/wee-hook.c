@@ -33,6 +33,9 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#ifdef HAVE_POSIX_SPAWNP
+#include <spawn.h>
+#endif
 #include <fcntl.h>
 #include <errno.h>
 
@@ -69,7 +72,18 @@ struct t_hook *last_weechat_hook[HOOK_NUM_TYPES]; /* last hook              */
 int hook_exec_recursion = 0;           /* 1 when a hook is executed         */
 time_t hook_last_system_time = 0;      /* used to detect system clock skew  */
 int real_delete_pending = 0;           /* 1 if some hooks must be deleted   */
+int hook_stats_enabled = 0;            /* 1 if time in callbacks is measured*/
+time_t hook_stats_start_time = 0;      /* start time of statistics          */
+struct t_hook *hook_main_loop_running = NULL; /* timer/fd hook running      */
+struct t_hook **hook_timer_heap = NULL; /* timers sorted by next execution  */
+                                        /* (binary min-heap)                */
+int hook_timer_heap_size = 0;          /* size of array "hook_timer_heap"   */
+int hook_timer_heap_count = 0;         /* number of timers in heap          */
+int hook_process_sigchld_pipe[2] = { -1, -1 }; /* pipe written on SIGCHLD   */
+struct t_hook *hook_process_sigchld_hook_fd = NULL; /* fd hook on the pipe  */
+
 
+extern char **environ;
 
 void hook_process_run (struct t_hook *hook_process);
 
@@ -318,6 +332,9 @@ hook_init_data (struct t_hook *hook, struct t_weechat_plugin *plugin,
     hook->priority = priority;
     hook->callback_data = callback_data;
     hook->hook_data = NULL;
+    hook->stats_calls = 0;
+    hook->stats_time_total = 0;
+    hook->stats_time_max = 0;
 
     if (weechat_debug_core >= 2)
     {
@@ -361,6 +378,136 @@ hook_valid (struct t_hook *hook)
     return 0;
 }
 
+/*
+ * Adds time spent in a hook callback to statistics of hook (called only if
+ * statistics are enabled, with macros HOOK_STATS_START/HOOK_STATS_END).
+ */
+
+void
+hook_stats_add (struct t_hook *hook, struct timeval *tv_start)
+{
+    struct timeval tv_end;
+    long time_usec;
+
+    gettimeofday (&tv_end, NULL);
+
+    time_usec = ((tv_end.tv_sec - tv_start->tv_sec) * 1000000) +
+        (tv_end.tv_usec - tv_start->tv_usec);
+    if (time_usec < 0)
+        time_usec = 0;
+
+    hook->stats_calls++;
+    hook->stats_time_total += time_usec;
+    if (time_usec > hook->stats_time_max)
+        hook->stats_time_max = time_usec;
+}
+
+/*
+ * Resets statistics of all hooks.
+ */
+
+void
+hook_stats_reset ()
+{
+    int type;
+    struct t_hook *ptr_hook;
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            ptr_hook->stats_calls = 0;
+            ptr_hook->stats_time_total = 0;
+            ptr_hook->stats_time_max = 0;
+        }
+    }
+
+    hook_stats_start_time = time (NULL);
+}
+
+/*
+ * Enables/disables statistics on time spent in hook callbacks.
+ *
+ * When statistics are enabled, they are reset.
+ */
+
+void
+hook_stats_enable (int enable)
+{
+    if (enable && !hook_stats_enabled)
+        hook_stats_reset ();
+
+    hook_stats_enabled = (enable) ? 1 : 0;
+}
+
+/*
+ * Returns a short description of a hook: command name for a command, signal
+ * for a signal, interval for a timer, ...
+ *
+ * Note: result is a static string, it must not be freed.
+ */
+
+const char *
+hook_get_description (struct t_hook *hook)
+{
+    static char str_description[64];
+
+    if (!hook || !hook->hook_data)
+        return "";
+
+    switch (hook->type)
+    {
+        case HOOK_TYPE_COMMAND:
+            return HOOK_COMMAND(hook, command);
+        case HOOK_TYPE_COMMAND_RUN:
+            return HOOK_COMMAND_RUN(hook, command);
+        case HOOK_TYPE_TIMER:
+            snprintf (str_description, sizeof (str_description),
+                      "%ld ms", HOOK_TIMER(hook, interval));
+            return str_description;
+        case HOOK_TYPE_FD:
+            snprintf (str_description, sizeof (str_description),
+                      "fd %d", HOOK_FD(hook, fd));
+            return str_description;
+        case HOOK_TYPE_PROCESS:
+            return HOOK_PROCESS(hook, command);
+        case HOOK_TYPE_CONNECT:
+            return HOOK_CONNECT(hook, address);
+        case HOOK_TYPE_PRINT:
+            return (HOOK_PRINT(hook, buffer)) ?
+                HOOK_PRINT(hook, buffer)->full_name : "*";
+        case HOOK_TYPE_SIGNAL:
+            return HOOK_SIGNAL(hook, signal);
+        case HOOK_TYPE_HSIGNAL:
+            return HOOK_HSIGNAL(hook, signal);
+        case HOOK_TYPE_CONFIG:
+            return HOOK_CONFIG(hook, option);
+        case HOOK_TYPE_COMPLETION:
+            return HOOK_COMPLETION(hook, completion_item);
+        case HOOK_TYPE_MODIFIER:
+            return HOOK_MODIFIER(hook, modifier);
+        case HOOK_TYPE_INFO:
+            return HOOK_INFO(hook, info_name);
+        case HOOK_TYPE_INFO_HASHTABLE:
+            return HOOK_INFO_HASHTABLE(hook, info_name);
+        case HOOK_TYPE_INFOLIST:
+            return HOOK_INFOLIST(hook, infolist_name);
+        case HOOK_TYPE_HDATA:
+            return HOOK_HDATA(hook, hdata_name);
+        case HOOK_TYPE_FOCUS:
+            return HOOK_FOCUS(hook, area);
+        case HOOK_NUM_TYPES:
+            /*
+             * this constant is used to count types only,
+             * it is never used as type
+             */
+            break;
+    }
+
+    return "";
+}
+
 /*
  * Starts a hook exec.
  */
@@ -667,6 +814,7 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
                    struct t_weechat_plugin *plugin, const char *string)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     struct t_hook *hook_plugin, *hook_other_plugin, *hook_other_plugin2;
     char **argv, **argv_eol, *ptr_command_name;
     int argc, rc, count_other_plugin;
@@ -768,8 +916,10 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
             {
                 /* execute the command! */
                 ptr_hook->running++;
+                HOOK_STATS_START(tv_stats);
                 rc = (int) (HOOK_COMMAND(ptr_hook, callback))
                     (ptr_hook->callback_data, buffer, argc, argv, argv_eol);
+                HOOK_STATS_END(ptr_hook, tv_stats);
                 ptr_hook->running--;
                 if (rc == WEECHAT_RC_ERROR)
                     rc = 0;
@@ -837,6 +987,7 @@ int
 hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     int rc, hook_matching, length;
     char *command2;
     const char *ptr_command;
@@ -879,9 +1030,11 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
             if (hook_matching)
             {
                 ptr_hook->running = 1;
+                HOOK_STATS_START(tv_stats);
                 rc = (HOOK_COMMAND_RUN(ptr_hook, callback)) (ptr_hook->callback_data,
                                                              buffer,
                                                              ptr_command);
+                HOOK_STATS_END(ptr_hook, tv_stats);
                 ptr_hook->running = 0;
                 if (rc == WEECHAT_RC_OK_EAT)
                 {
@@ -901,6 +1054,151 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Compares next execution of timers at two positions in heap.
+ *
+ * Returns:
+ *   < 0: timer at index1 must be executed before timer at index2
+ *     0: same date
+ *   > 0: timer at index1 must be executed after timer at index2
+ */
+
+int
+hook_timer_heap_cmp (int index1, int index2)
+{
+    return util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[index1], next_exec),
+                             &HOOK_TIMER(hook_timer_heap[index2], next_exec));
+}
+
+/*
+ * Swaps two timers in heap.
+ */
+
+void
+hook_timer_heap_swap (int index1, int index2)
+{
+    struct t_hook *ptr_hook;
+
+    ptr_hook = hook_timer_heap[index1];
+    hook_timer_heap[index1] = hook_timer_heap[index2];
+    hook_timer_heap[index2] = ptr_hook;
+    HOOK_TIMER(hook_timer_heap[index1], heap_index) = index1;
+    HOOK_TIMER(hook_timer_heap[index2], heap_index) = index2;
+}
+
+/*
+ * Moves a timer up in heap (when its next execution is earlier than its
+ * parent's one).
+ */
+
+void
+hook_timer_heap_sift_up (int index)
+{
+    int parent;
+
+    while (index > 0)
+    {
+        parent = (index - 1) / 2;
+        if (hook_timer_heap_cmp (index, parent) >= 0)
+            break;
+        hook_timer_heap_swap (index, parent);
+        index = parent;
+    }
+}
+
+/*
+ * Moves a timer down in heap (when its next execution is later than its
+ * children's ones).
+ */
+
+void
+hook_timer_heap_sift_down (int index)
+{
+    int child;
+
+    while (1)
+    {
+        child = (2 * index) + 1;
+        if (child >= hook_timer_heap_count)
+            break;
+        if ((child + 1 < hook_timer_heap_count)
+            && (hook_timer_heap_cmp (child + 1, child) < 0))
+        {
+            child++;
+        }
+        if (hook_timer_heap_cmp (child, index) >= 0)
+            break;
+        hook_timer_heap_swap (index, child);
+        index = child;
+    }
+}
+
+/*
+ * Adds a timer in heap.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+hook_timer_heap_add (struct t_hook *hook)
+{
+    struct t_hook **new_heap;
+    int new_size;
+
+    if (hook_timer_heap_count == hook_timer_heap_size)
+    {
+        new_size = (hook_timer_heap_size > 0) ? hook_timer_heap_size * 2 : 64;
+        new_heap = realloc (hook_timer_heap, new_size * sizeof (*new_heap));
+        if (!new_heap)
+            return 0;
+        hook_timer_heap = new_heap;
+        hook_timer_heap_size = new_size;
+    }
+
+    hook_timer_heap[hook_timer_heap_count] = hook;
+    HOOK_TIMER(hook, heap_index) = hook_timer_heap_count;
+    hook_timer_heap_count++;
+    hook_timer_heap_sift_up (hook_timer_heap_count - 1);
+
+    return 1;
+}
+
+/*
+ * Removes a timer from heap (nothing is done if the timer is not in heap).
+ */
+
+void
+hook_timer_heap_remove (struct t_hook *hook)
+{
+    int index;
+
+    index = HOOK_TIMER(hook, heap_index);
+    if ((index < 0) || (index >= hook_timer_heap_count))
+        return;
+
+    HOOK_TIMER(hook, heap_index) = -1;
+    hook_timer_heap_count--;
+    if (index < hook_timer_heap_count)
+    {
+        /* move last timer at the position of removed timer */
+        hook_timer_heap[index] = hook_timer_heap[hook_timer_heap_count];
+        HOOK_TIMER(hook_timer_heap[index], heap_index) = index;
+        if ((index > 0) && (hook_timer_heap_cmp (index, (index - 1) / 2) < 0))
+            hook_timer_heap_sift_up (index);
+        else
+            hook_timer_heap_sift_down (index);
+    }
+
+    if (hook_timer_heap_count == 0)
+    {
+        free (hook_timer_heap);
+        hook_timer_heap = NULL;
+        hook_timer_heap_size = 0;
+    }
+}
+
 /*
  * Initializes a timer hook.
  */
@@ -991,9 +1289,17 @@ hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
     new_hook_timer->interval = interval;
     new_hook_timer->align_second = align_second;
     new_hook_timer->remaining_calls = max_calls;
+    new_hook_timer->heap_index = -1;
 
     hook_timer_init (new_hook);
 
+    if (!hook_timer_heap_add (new_hook))
+    {
+        free (new_hook_timer);
+        free (new_hook);
+        return NULL;
+    }
+
     hook_add_to_list (new_hook);
 
     return new_hook;
@@ -1011,6 +1317,7 @@ hook_timer_check_system_clock ()
     time_t now;
     long diff_time;
     struct t_hook *ptr_hook;
+    int i;
 
     now = time (NULL);
 
@@ -1036,6 +1343,12 @@ hook_timer_check_system_clock ()
             if (!ptr_hook->deleted)
                 hook_timer_init (ptr_hook);
         }
+
+        /* dates have changed: rebuild the heap */
+        for (i = (hook_timer_heap_count / 2) - 1; i >= 0; i--)
+        {
+            hook_timer_heap_sift_down (i);
+        }
     }
 
     hook_last_system_time = now;
@@ -1048,38 +1361,23 @@ hook_timer_check_system_clock ()
 void
 hook_timer_time_to_next (struct timeval *tv_timeout)
 {
-    struct t_hook *ptr_hook;
-    int found;
     struct timeval tv_now;
     long diff_usec;
 
     hook_timer_check_system_clock ();
 
-    found = 0;
-    tv_timeout->tv_sec = 0;
-    tv_timeout->tv_usec = 0;
-
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
-    {
-        if (!ptr_hook->deleted
-            && (!found
-                || (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec), tv_timeout) < 0)))
-        {
-            found = 1;
-            tv_timeout->tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-            tv_timeout->tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
-        }
-    }
-
     /* no timeout found, return 2 seconds by default */
-    if (!found)
+    if (hook_timer_heap_count == 0)
     {
         tv_timeout->tv_sec = 2;
         tv_timeout->tv_usec = 0;
         return;
     }
 
+    /* first timer in heap is the next one to execute */
+    tv_timeout->tv_sec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_sec;
+    tv_timeout->tv_usec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_usec;
+
     gettimeofday (&tv_now, NULL);
 
     /* next timeout is past date! */
@@ -1118,30 +1416,54 @@ hook_timer_time_to_next (struct timeval *tv_timeout)
 void
 hook_timer_exec ()
 {
-    struct timeval tv_time;
-    struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_time, tv_stats;
+    struct t_hook *ptr_hook, **timers;
+    int i, count;
 
     hook_timer_check_system_clock ();
 
     gettimeofday (&tv_time, NULL);
 
+    if ((hook_timer_heap_count == 0)
+        || (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                              &tv_time) > 0))
+    {
+        return;
+    }
+
+    /*
+     * remove expired timers from heap (they are added again after execution
+     * with their new date, so that each timer is executed one time max)
+     */
+    timers = malloc (hook_timer_heap_count * sizeof (*timers));
+    if (!timers)
+        return;
+    count = 0;
+    while ((hook_timer_heap_count > 0)
+           && (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                                 &tv_time) <= 0))
+    {
+        timers[count++] = hook_timer_heap[0];
+        hook_timer_heap_remove (hook_timer_heap[0]);
+    }
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_TIMER];
-    while (ptr_hook)
+    for (i = 0; i < count; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = timers[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                  &tv_time) <= 0))
+        if (!ptr_hook->deleted && !ptr_hook->running)
         {
             ptr_hook->running = 1;
+            hook_main_loop_running = ptr_hook;
+            HOOK_STATS_START(tv_stats);
             (void) (HOOK_TIMER(ptr_hook, callback))
                 (ptr_hook->callback_data,
                  (HOOK_TIMER(ptr_hook, remaining_calls) > 0) ?
                   HOOK_TIMER(ptr_hook, remaining_calls) - 1 : -1);
+            HOOK_STATS_END(ptr_hook, tv_stats);
+            hook_main_loop_running = NULL;
             ptr_hook->running = 0;
             if (!ptr_hook->deleted)
             {
@@ -1160,9 +1482,12 @@ hook_timer_exec ()
             }
         }
 
-        ptr_hook = next_hook;
+        if (!ptr_hook->deleted && (HOOK_TIMER(ptr_hook, heap_index) < 0))
+            hook_timer_heap_add (ptr_hook);
     }
 
+    free (timers);
+
     hook_exec_end ();
 }
 
@@ -1302,6 +1627,7 @@ void
 hook_fd_exec (fd_set *read_fds, fd_set *write_fds, fd_set *exception_fds)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
 
     hook_exec_start ();
 
@@ -1320,8 +1646,12 @@ hook_fd_exec (fd_set *read_fds, fd_set *write_fds, fd_set *exception_fds)
                     && (FD_ISSET(HOOK_FD(ptr_hook, fd), exception_fds)))))
         {
             ptr_hook->running = 1;
+            hook_main_loop_running = ptr_hook;
+            HOOK_STATS_START(tv_stats);
             (void) (HOOK_FD(ptr_hook, callback)) (ptr_hook->callback_data,
                                                   HOOK_FD(ptr_hook, fd));
+            HOOK_STATS_END(ptr_hook, tv_stats);
+            hook_main_loop_running = NULL;
             ptr_hook->running = 0;
         }
 
@@ -1382,7 +1712,11 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
     new_hook_process->options = (options) ? hashtable_dup (options) : NULL;
     new_hook_process->detached = (options && hashtable_has_key (options,
                                                                 "detached"));
+    new_hook_process->line_buffered = (options
+                                       && hashtable_has_key (options,
+                                                             "line_buffered"));
     new_hook_process->timeout = timeout;
+    new_hook_process->output_paused = 0;
     new_hook_process->child_read[HOOK_PROCESS_STDIN] = -1;
     new_hook_process->child_read[HOOK_PROCESS_STDOUT] = -1;
     new_hook_process->child_read[HOOK_PROCESS_STDERR] = -1;
@@ -1394,6 +1728,7 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
     new_hook_process->hook_fd[HOOK_PROCESS_STDOUT] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDERR] = NULL;
     new_hook_process->hook_timer = NULL;
+    new_hook_process->url_transfer = NULL;
     new_hook_process->buffer[HOOK_PROCESS_STDIN] = NULL;
     new_hook_process->buffer[HOOK_PROCESS_STDOUT] = stdout_buffer;
     new_hook_process->buffer[HOOK_PROCESS_STDERR] = stderr_buffer;
@@ -1448,6 +1783,95 @@ hook_process (struct t_weechat_plugin *plugin,
                                    callback, callback_data);
 }
 
+/*
+ * Builds arguments of command executed by a process hook: arguments are read
+ * in options "arg1", "arg2", ... or the command is split like the shell does.
+ *
+ * Note: result must be freed after use with function string_free_split.
+ */
+
+char **
+hook_process_get_args (struct t_hook *hook_process)
+{
+    char **exec_args, *arg0, str_arg[64];
+    const char *ptr_arg;
+    int i, num_args;
+
+    num_args = 0;
+    if (HOOK_PROCESS(hook_process, options))
+    {
+        /*
+         * count number of arguments given in the hashtable options,
+         * keys are: "arg1", "arg2", ...
+         */
+        while (1)
+        {
+            snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
+            ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                     str_arg);
+            if (!ptr_arg)
+                break;
+            num_args++;
+        }
+    }
+    if (num_args > 0)
+    {
+        /*
+         * if at least one argument was found in hashtable option, the
+         * "command" contains only path to binary (without arguments), and
+         * the arguments are in hashtable
+         */
+        exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
+        if (exec_args)
+        {
+            exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
+            for (i = 1; i <= num_args; i++)
+            {
+                snprintf (str_arg, sizeof (str_arg), "arg%d", i);
+                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                         str_arg);
+                exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
+            }
+            exec_args[num_args + 1] = NULL;
+        }
+    }
+    else
+    {
+        /*
+         * if no arguments were found in hashtable, make an automatic split
+         * of command, like the shell does
+         */
+        exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
+                                        NULL);
+    }
+
+    if (exec_args)
+    {
+        if (!exec_args[0])
+        {
+            string_free_split (exec_args);
+            return NULL;
+        }
+        arg0 = string_expand_home (exec_args[0]);
+        if (arg0)
+        {
+            free (exec_args[0]);
+            exec_args[0] = arg0;
+        }
+        if (weechat_debug_core >= 1)
+        {
+            log_printf ("hook_process, command='%s'",
+                        HOOK_PROCESS(hook_process, command));
+            for (i = 0; exec_args[i]; i++)
+            {
+                log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
+            }
+        }
+    }
+
+    return exec_args;
+}
+
 /*
  * Child process for hook process: executes command and returns string result
  * into pipe for WeeChat process.
@@ -1456,9 +1880,8 @@ hook_process (struct t_weechat_plugin *plugin,
 void
 hook_process_child (struct t_hook *hook_process)
 {
-    char **exec_args, *arg0, str_arg[64];
-    const char *ptr_url, *ptr_arg;
-    int rc, i, num_args;
+    char **exec_args;
+    int rc;
     FILE *f;
 
     /* read stdin from parent, if a pipe was defined */
@@ -1513,233 +1936,677 @@ hook_process_child (struct t_hook *hook_process)
 
     rc = EXIT_FAILURE;
 
-    if (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) == 0)
+    /* launch command */
+    exec_args = hook_process_get_args (hook_process);
+    if (exec_args)
+        execvp (exec_args[0], exec_args);
+
+    /* should not be executed if execvp was OK */
+    if (exec_args)
+        string_free_split (exec_args);
+    fprintf (stderr, "Error with command '%s'\n",
+             HOOK_PROCESS(hook_process, command));
+
+    fflush (stdout);
+    fflush (stderr);
+
+    _exit (rc);
+}
+
+#ifdef HAVE_POSIX_SPAWNP
+/*
+ * Executes command of a process hook with posix_spawnp: unlike fork, the
+ * memory of WeeChat is not duplicated (page tables are not copied), so the
+ * time to start the command does not depend on the memory used by WeeChat.
+ *
+ * Returns pid of child process, -1 if error (errno is set).
+ */
+
+pid_t
+hook_process_spawn (struct t_hook *hook_process)
+{
+    posix_spawn_file_actions_t file_actions;
+    char **exec_args;
+    pid_t pid;
+    int rc, i;
+
+    exec_args = hook_process_get_args (hook_process);
+    if (!exec_args)
     {
-        /* get URL output (on stdout or file, depending on options) */
-        ptr_url = HOOK_PROCESS(hook_process, command) + 4;
-        while (ptr_url[0] == ' ')
-        {
-            ptr_url++;
-        }
-        rc = weeurl_download (ptr_url, HOOK_PROCESS(hook_process, options));
+        errno = EINVAL;
+        return -1;
     }
-    else
+
+    rc = posix_spawn_file_actions_init (&file_actions);
+    if (rc != 0)
     {
-        /* launch command */
-        num_args = 0;
-        if (HOOK_PROCESS(hook_process, options))
+        string_free_split (exec_args);
+        errno = rc;
+        return -1;
+    }
+
+    /* stdin: pipe from parent (if defined) or "/dev/null" */
+    if (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]) >= 0)
+    {
+        posix_spawn_file_actions_adddup2 (
+            &file_actions,
+            HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]),
+            STDIN_FILENO);
+    }
+    else
+    {
+        posix_spawn_file_actions_addopen (&file_actions, STDIN_FILENO,
+                                          "/dev/null", O_RDONLY, 0);
+    }
+
+    /* stdout/stderr: pipes to parent or "/dev/null" (detached mode) */
+    if (HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]) >= 0)
+    {
+        posix_spawn_file_actions_adddup2 (
+            &file_actions,
+            HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]),
+            STDOUT_FILENO);
+    }
+    else
+    {
+        posix_spawn_file_actions_addopen (&file_actions, STDOUT_FILENO,
+                                          "/dev/null", O_WRONLY, 0);
+    }
+    if (HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]) >= 0)
+    {
+        posix_spawn_file_actions_adddup2 (
+            &file_actions,
+            HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]),
+            STDERR_FILENO);
+    }
+    else
+    {
+        posix_spawn_file_actions_addopen (&file_actions, STDERR_FILENO,
+                                          "/dev/null", O_WRONLY, 0);
+    }
+
+    /* close pipes in child (the duplicated fds are kept) */
+    for (i = 0; i < 3; i++)
+    {
+        if (HOOK_PROCESS(hook_process, child_read[i]) >= 0)
         {
-            /*
-             * count number of arguments given in the hashtable options,
-             * keys are: "arg1", "arg2", ...
-             */
-            while (1)
-            {
-                snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
-                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                         str_arg);
-                if (!ptr_arg)
-                    break;
-                num_args++;
-            }
+            posix_spawn_file_actions_addclose (
+                &file_actions, HOOK_PROCESS(hook_process, child_read[i]));
         }
-        if (num_args > 0)
+        if (HOOK_PROCESS(hook_process, child_write[i]) >= 0)
         {
-            /*
-             * if at least one argument was found in hashtable option, the
-             * "command" contains only path to binary (without arguments), and
-             * the arguments are in hashtable
-             */
-            exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
-            if (exec_args)
-            {
-                exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
-                for (i = 1; i <= num_args; i++)
-                {
-                    snprintf (str_arg, sizeof (str_arg), "arg%d", i);
-                    ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                             str_arg);
-                    exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
-                }
-                exec_args[num_args + 1] = NULL;
-            }
+            posix_spawn_file_actions_addclose (
+                &file_actions, HOOK_PROCESS(hook_process, child_write[i]));
         }
-        else
+    }
+
+    rc = posix_spawnp (&pid, exec_args[0], &file_actions, NULL, exec_args,
+                       environ);
+
+    posix_spawn_file_actions_destroy (&file_actions);
+    string_free_split (exec_args);
+
+    if (rc != 0)
+    {
+        errno = rc;
+        return -1;
+    }
+
+    return pid;
+}
+#endif /* HAVE_POSIX_SPAWNP */
+
+/*
+ * Checks if command of a process hook can be started with posix_spawnp
+ * (instead of fork).
+ *
+ * Returns:
+ *   1: posix_spawnp can be used
+ *   0: fork must be used
+ */
+
+int
+hook_process_use_spawn (struct t_hook *hook_process)
+{
+#ifdef HAVE_POSIX_SPAWNP
+    const char *ptr_value;
+
+    /* fork is required to drop privileges of a setuid binary */
+    if (getuid () != geteuid ())
+        return 0;
+
+    if (HOOK_PROCESS(hook_process, options))
+    {
+        ptr_value = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                   "spawn");
+        if (ptr_value && (strcmp (ptr_value, "fork") == 0))
+            return 0;
+    }
+
+    return 1;
+#else
+    /* make C compiler happy */
+    (void) hook_process;
+
+    return 0;
+#endif /* HAVE_POSIX_SPAWNP */
+}
+
+/*
+ * Sends buffers (stdout/stderr) to callback.
+ */
+
+void
+hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
+{
+    struct timeval tv_stats;
+    int size;
+
+    /* add '\0' at end of stdout and stderr */
+    size = HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]);
+    if (size > 0)
+        HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT])[size] = '\0';
+    size = HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]);
+    if (size > 0)
+        HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR])[size] = '\0';
+
+    /* send buffers to callback */
+    HOOK_STATS_START(tv_stats);
+    (void) (HOOK_PROCESS(hook_process, callback))
+        (hook_process->callback_data,
+         HOOK_PROCESS(hook_process, command),
+         callback_rc,
+         (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) > 0) ?
+         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT]) : NULL,
+         (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) > 0) ?
+         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR]) : NULL);
+    HOOK_STATS_END(hook_process, tv_stats);
+
+    /* reset size for stdout and stderr */
+    HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) = 0;
+    HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) = 0;
+}
+
+/*
+ * Adds some data to buffer (stdout or stderr).
+ */
+
+void
+hook_process_add_to_buffer (struct t_hook *hook_process, int index_buffer,
+                            const char *buffer, int size)
+{
+    if (HOOK_PROCESS(hook_process, buffer_size[index_buffer]) + size > HOOK_PROCESS_BUFFER_SIZE)
+        hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_RUNNING);
+
+    memcpy (HOOK_PROCESS(hook_process, buffer[index_buffer]) +
+            HOOK_PROCESS(hook_process, buffer_size[index_buffer]),
+            buffer, size);
+    HOOK_PROCESS(hook_process, buffer_size[index_buffer]) += size;
+}
+
+/*
+ * Sends complete lines of a buffer (stdout or stderr) to callback, one line
+ * per call (line-buffered mode); the incomplete line at the end of buffer is
+ * kept, unless the buffer is full.
+ */
+
+void
+hook_process_send_lines (struct t_hook *hook_process, int index_buffer)
+{
+    struct timeval tv_stats;
+    char *ptr_buffer, *pos, saved_char;
+    int size, start, length;
+
+    ptr_buffer = HOOK_PROCESS(hook_process, buffer[index_buffer]);
+    size = HOOK_PROCESS(hook_process, buffer_size[index_buffer]);
+    start = 0;
+
+    while (start < size)
+    {
+        pos = memchr (ptr_buffer + start, '\n', size - start);
+        if (!pos)
+            break;
+        length = pos - (ptr_buffer + start) + 1;
+        saved_char = ptr_buffer[start + length];
+        ptr_buffer[start + length] = '\0';
+        HOOK_STATS_START(tv_stats);
+        (void) (HOOK_PROCESS(hook_process, callback))
+            (hook_process->callback_data,
+             HOOK_PROCESS(hook_process, command),
+             WEECHAT_HOOK_PROCESS_RUNNING,
+             (index_buffer == HOOK_PROCESS_STDOUT) ? ptr_buffer + start : NULL,
+             (index_buffer == HOOK_PROCESS_STDERR) ? ptr_buffer + start : NULL);
+        HOOK_STATS_END(hook_process, tv_stats);
+        /* hook (and its buffers) freed by callback? */
+        if (hook_process->deleted)
+            return;
+        ptr_buffer[start + length] = saved_char;
+        start += length;
+    }
+
+    if (start > 0)
+    {
+        memmove (ptr_buffer, ptr_buffer + start, size - start);
+        HOOK_PROCESS(hook_process, buffer_size[index_buffer]) = size - start;
+    }
+
+    /* line too long for buffer: send it anyway */
+    if (HOOK_PROCESS(hook_process, buffer_size[index_buffer]) >=
+        HOOK_PROCESS_BUFFER_SIZE)
+    {
+        hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_RUNNING);
+    }
+}
+
+/*
+ * Sends data received in a buffer (stdout or stderr) to callback if needed:
+ * complete lines in line-buffered mode, otherwise all buffers when the size
+ * reaches "buffer_flush".
+ */
+
+void
+hook_process_flush_buffer (struct t_hook *hook_process, int index_buffer)
+{
+    if (HOOK_PROCESS(hook_process, line_buffered))
+    {
+        hook_process_send_lines (hook_process, index_buffer);
+    }
+    else if (HOOK_PROCESS(hook_process, buffer_size[index_buffer]) >=
+             HOOK_PROCESS(hook_process, buffer_flush))
+    {
+        hook_process_send_buffers (hook_process,
+                                   WEECHAT_HOOK_PROCESS_RUNNING);
+    }
+}
+
+/*
+ * Reads process output (stdout or stderr) from child process.
+ *
+ * Returns number of bytes read, 0 if end of data or error.
+ */
+
+int
+hook_process_child_read (struct t_hook *hook_process, int fd,
+                         int index_buffer, struct t_hook **hook_fd)
+{
+    char buffer[4096];
+    int num_read;
+
+    if (hook_process->deleted)
+        return 0;
+
+    num_read = read (fd, buffer, sizeof (buffer) - 1);
+    if (num_read > 0)
+    {
+        hook_process_add_to_buffer (hook_process, index_buffer,
+                                    buffer, num_read);
+        hook_process_flush_buffer (hook_process, index_buffer);
+        return num_read;
+    }
+
+    if ((num_read == 0)
+        || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+    {
+        /* end of data: the pipe is closed (it must not be hooked again) */
+        if (*hook_fd)
         {
-            /*
-             * if no arguments were found in hashtable, make an automatic split
-             * of command, like the shell does
-             */
-            exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
-                                            NULL);
+            unhook (*hook_fd);
+            *hook_fd = NULL;
         }
+        close (HOOK_PROCESS(hook_process, child_read[index_buffer]));
+        HOOK_PROCESS(hook_process, child_read[index_buffer]) = -1;
+    }
 
-        if (exec_args)
+    return 0;
+}
+
+/*
+ * Reads process output (stdout) from child process.
+ */
+
+int
+hook_process_child_read_stdout_cb (void *arg_hook_process, int fd)
+{
+    struct t_hook *hook_process;
+
+    hook_process = (struct t_hook *)arg_hook_process;
+    hook_process_child_read (hook_process, fd, HOOK_PROCESS_STDOUT,
+                             &(HOOK_PROCESS(hook_process, hook_fd[HOOK_PROCESS_STDOUT])));
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Reads process output (stderr) from child process.
+ */
+
+int
+hook_process_child_read_stderr_cb (void *arg_hook_process, int fd)
+{
+    struct t_hook *hook_process;
+
+    hook_process = (struct t_hook *)arg_hook_process;
+    hook_process_child_read (hook_process, fd, HOOK_PROCESS_STDERR,
+                             &(HOOK_PROCESS(hook_process, hook_fd[HOOK_PROCESS_STDERR])));
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Pauses or resumes reading of child output (stdout/stderr): when paused, the
+ * pipes are not read any more, so the child is blocked when they are full.
+ */
+
+void
+hook_process_pause_output (struct t_hook *hook_process, int pause)
+{
+    int i;
+
+    if (pause == HOOK_PROCESS(hook_process, output_paused))
+        return;
+
+    HOOK_PROCESS(hook_process, output_paused) = pause;
+
+    for (i = HOOK_PROCESS_STDOUT; i <= HOOK_PROCESS_STDERR; i++)
+    {
+        if (pause)
         {
-            arg0 = string_expand_home (exec_args[0]);
-            if (arg0)
-            {
-                free (exec_args[0]);
-                exec_args[0] = arg0;
-            }
-            if (weechat_debug_core >= 1)
+            if (HOOK_PROCESS(hook_process, hook_fd[i]))
             {
-                log_printf ("hook_process, command='%s'",
-                            HOOK_PROCESS(hook_process, command));
-                for (i = 0; exec_args[i]; i++)
-                {
-                    log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
-                }
+                unhook (HOOK_PROCESS(hook_process, hook_fd[i]));
+                HOOK_PROCESS(hook_process, hook_fd[i]) = NULL;
             }
-            execvp (exec_args[0], exec_args);
         }
+        else if ((HOOK_PROCESS(hook_process, child_read[i]) >= 0)
+                 && !HOOK_PROCESS(hook_process, hook_fd[i]))
+        {
+            HOOK_PROCESS(hook_process, hook_fd[i]) =
+                hook_fd (hook_process->plugin,
+                         HOOK_PROCESS(hook_process, child_read[i]),
+                         1, 0, 0,
+                         (i == HOOK_PROCESS_STDOUT) ?
+                         &hook_process_child_read_stdout_cb :
+                         &hook_process_child_read_stderr_cb,
+                         hook_process);
+        }
+    }
+}
 
-        /* should not be executed if execvp was OK */
-        if (exec_args)
-            string_free_split (exec_args);
-        fprintf (stderr, "Error with command '%s'\n",
-                 HOOK_PROCESS(hook_process, command));
+/*
+ * Ends a process hook after its child has died (status is the status
+ * returned by waitpid): reads data still in pipes, sends buffers to callback
+ * and removes the hook.
+ */
+
+void
+hook_process_child_end (struct t_hook *hook_process, int status)
+{
+    int i;
+
+    /* child is already reaped: it must not be killed/waited in unhook */
+    HOOK_PROCESS(hook_process, child_pid) = 0;
+
+    /* read data written by child before its end (pipes are non-blocking) */
+    for (i = HOOK_PROCESS_STDOUT; i <= HOOK_PROCESS_STDERR; i++)
+    {
+        while (!hook_process->deleted
+               && (HOOK_PROCESS(hook_process, child_read[i]) >= 0)
+               && (hook_process_child_read (
+                       hook_process,
+                       HOOK_PROCESS(hook_process, child_read[i]),
+                       i,
+                       &(HOOK_PROCESS(hook_process, hook_fd[i]))) > 0))
+        {
+        }
     }
 
-    fflush (stdout);
-    fflush (stderr);
+    if (hook_process->deleted)
+        return;
 
-    _exit (rc);
+    /* child terminated normally: exit code, otherwise killed by a signal */
+    hook_process_send_buffers (hook_process,
+                               (WIFEXITED(status)) ?
+                               WEXITSTATUS(status) : WEECHAT_HOOK_PROCESS_ERROR);
+    unhook (hook_process);
+}
+
+/*
+ * Timer callback for timeout of child process: kills the child.
+ */
+
+int
+hook_process_timer_cb (void *arg_hook_process, int remaining_calls)
+{
+    struct t_hook *hook_process;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    hook_process = (struct t_hook *)arg_hook_process;
+
+    if (hook_process->deleted)
+        return WEECHAT_RC_OK;
+
+    /* timer is automatically removed after this call */
+    HOOK_PROCESS(hook_process, hook_timer) = NULL;
+
+    hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_ERROR);
+    if (hook_process->deleted)
+        return WEECHAT_RC_OK;
+    if (weechat_debug_core >= 1)
+    {
+        gui_chat_printf (NULL,
+                         _("End of command '%s', timeout reached (%.1fs)"),
+                         HOOK_PROCESS(hook_process, command),
+                         ((float)HOOK_PROCESS(hook_process, timeout)) / 1000);
+    }
+    kill (HOOK_PROCESS(hook_process, child_pid), SIGKILL);
+    usleep (1000);
+    unhook (hook_process);
+
+    return WEECHAT_RC_OK;
 }
 
 /*
- * Sends buffers (stdout/stderr) to callback.
+ * Timer callback used to report an error found when process starts (the
+ * command could not be executed): the output (error message) is sent to
+ * callback with exit code EXIT_FAILURE, like a child unable to execute the
+ * command.
  */
 
-void
-hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
+int
+hook_process_error_timer_cb (void *arg_hook_process, int remaining_calls)
 {
-    int size;
+    struct t_hook *hook_process;
 
-    /* add '\0' at end of stdout and stderr */
-    size = HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]);
-    if (size > 0)
-        HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT])[size] = '\0';
-    size = HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]);
-    if (size > 0)
-        HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR])[size] = '\0';
+    /* make C compiler happy */
+    (void) remaining_calls;
 
-    /* send buffers to callback */
-    (void) (HOOK_PROCESS(hook_process, callback))
-        (hook_process->callback_data,
-         HOOK_PROCESS(hook_process, command),
-         callback_rc,
-         (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) > 0) ?
-         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT]) : NULL,
-         (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) > 0) ?
-         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR]) : NULL);
+    hook_process = (struct t_hook *)arg_hook_process;
 
-    /* reset size for stdout and stderr */
-    HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) = 0;
-    HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) = 0;
+    if (hook_process->deleted)
+        return WEECHAT_RC_OK;
+
+    /* timer is automatically removed after this call */
+    HOOK_PROCESS(hook_process, hook_timer) = NULL;
+
+    hook_process_send_buffers (hook_process, EXIT_FAILURE);
+    if (hook_process->deleted)
+        return WEECHAT_RC_OK;
+    unhook (hook_process);
+
+    return WEECHAT_RC_OK;
 }
 
 /*
- * Adds some data to buffer (stdout or stderr).
+ * Signal handler for SIGCHLD: wakes up main loop by writing in a pipe
+ * (the children are reaped in main loop, by hook_process_sigchld_read_cb).
  */
 
 void
-hook_process_add_to_buffer (struct t_hook *hook_process, int index_buffer,
-                            const char *buffer, int size)
+hook_process_sigchld (int signum)
 {
-    if (HOOK_PROCESS(hook_process, buffer_size[index_buffer]) + size > HOOK_PROCESS_BUFFER_SIZE)
-        hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_RUNNING);
+    int saved_errno, num_written;
 
-    memcpy (HOOK_PROCESS(hook_process, buffer[index_buffer]) +
-            HOOK_PROCESS(hook_process, buffer_size[index_buffer]),
-            buffer, size);
-    HOOK_PROCESS(hook_process, buffer_size[index_buffer]) += size;
+    /* make C compiler happy */
+    (void) signum;
+
+    saved_errno = errno;
+    if (hook_process_sigchld_pipe[1] >= 0)
+    {
+        num_written = write (hook_process_sigchld_pipe[1], "c", 1);
+        (void) num_written;
+    }
+    errno = saved_errno;
 }
 
 /*
- * Reads process output (stdout or stderr) from child process.
+ * Reaps children of process hooks which have died (called when SIGCHLD has
+ * been received).
  */
 
-void
-hook_process_child_read (struct t_hook *hook_process, int fd,
-                         int index_buffer, struct t_hook **hook_fd)
+int
+hook_process_sigchld_read_cb (void *data, int fd)
 {
-    char buffer[4096];
-    int num_read;
+    struct t_hook *ptr_hook, *next_hook;
+    char buffer[64];
+    int status;
 
-    if (hook_process->deleted)
-        return;
+    /* make C compiler happy */
+    (void) data;
 
-    num_read = read (fd, buffer, sizeof (buffer) - 1);
-    if (num_read > 0)
+    /* empty the pipe (many signals can be received before this call) */
+    while (read (fd, buffer, sizeof (buffer)) > 0)
     {
-        hook_process_add_to_buffer (hook_process, index_buffer,
-                                    buffer, num_read);
-        if (HOOK_PROCESS(hook_process, buffer_size[index_buffer]) >=
-            HOOK_PROCESS(hook_process, buffer_flush))
-        {
-            hook_process_send_buffers (hook_process,
-                                       WEECHAT_HOOK_PROCESS_RUNNING);
-        }
     }
-    else if (num_read == 0)
+
+    hook_exec_start ();
+
+    ptr_hook = weechat_hooks[HOOK_TYPE_PROCESS];
+    while (ptr_hook)
     {
-        unhook (*hook_fd);
-        *hook_fd = NULL;
+        next_hook = ptr_hook->next_hook;
+
+        if (!ptr_hook->deleted
+            && (HOOK_PROCESS(ptr_hook, child_pid) > 0)
+            && (waitpid (HOOK_PROCESS(ptr_hook, child_pid),
+                         &status, WNOHANG) > 0))
+        {
+            hook_process_child_end (ptr_hook, status);
+        }
+
+        ptr_hook = next_hook;
     }
+
+    hook_exec_end ();
+
+    return WEECHAT_RC_OK;
 }
 
 /*
- * Reads process output (stdout) from child process.
+ * Installs the SIGCHLD handler and the fd hook on the pipe written by this
+ * handler (done once, before the first fork).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
  */
 
 int
-hook_process_child_read_stdout_cb (void *arg_hook_process, int fd)
+hook_process_sigchld_init ()
 {
-    struct t_hook *hook_process;
+    struct sigaction act;
+    int i, flags;
 
-    hook_process = (struct t_hook *)arg_hook_process;
-    hook_process_child_read (hook_process, fd, HOOK_PROCESS_STDOUT,
-                             &(HOOK_PROCESS(hook_process, hook_fd[HOOK_PROCESS_STDOUT])));
-    return WEECHAT_RC_OK;
+    if (hook_process_sigchld_hook_fd
+        && hook_valid (hook_process_sigchld_hook_fd))
+    {
+        return 1;
+    }
+
+    if (hook_process_sigchld_pipe[0] < 0)
+    {
+        if (pipe (hook_process_sigchld_pipe) < 0)
+        {
+            hook_process_sigchld_pipe[0] = -1;
+            hook_process_sigchld_pipe[1] = -1;
+            return 0;
+        }
+        for (i = 0; i < 2; i++)
+        {
+            flags = fcntl (hook_process_sigchld_pipe[i], F_GETFL);
+            fcntl (hook_process_sigchld_pipe[i], F_SETFL, flags | O_NONBLOCK);
+            fcntl (hook_process_sigchld_pipe[i], F_SETFD, FD_CLOEXEC);
+        }
+        memset (&act, 0, sizeof (act));
+        sigemptyset (&act.sa_mask);
+        act.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+        act.sa_handler = &hook_process_sigchld;
+        sigaction (SIGCHLD, &act, NULL);
+    }
+
+    hook_process_sigchld_hook_fd = hook_fd (NULL,
+                                            hook_process_sigchld_pipe[0],
+                                            1, 0, 0,
+                                            &hook_process_sigchld_read_cb,
+                                            NULL);
+
+    return (hook_process_sigchld_hook_fd) ? 1 : 0;
 }
 
 /*
- * Reads process output (stderr) from child process.
+ * Receives data from an URL transfer.
  */
 
-int
-hook_process_child_read_stderr_cb (void *arg_hook_process, int fd)
+void
+hook_process_url_data_cb (void *arg_hook_process, const char *buffer,
+                          int size)
 {
     struct t_hook *hook_process;
+    int size_chunk;
 
     hook_process = (struct t_hook *)arg_hook_process;
-    hook_process_child_read (hook_process, fd, HOOK_PROCESS_STDERR,
-                             &(HOOK_PROCESS(hook_process, hook_fd[HOOK_PROCESS_STDERR])));
-    return WEECHAT_RC_OK;
+
+    if (hook_process->deleted || HOOK_PROCESS(hook_process, detached))
+        return;
+
+    while (size > 0)
+    {
+        size_chunk = (size > 4096) ? 4096 : size;
+        hook_process_add_to_buffer (hook_process, HOOK_PROCESS_STDOUT,
+                                    buffer, size_chunk);
+        hook_process_flush_buffer (hook_process, HOOK_PROCESS_STDOUT);
+        if (hook_process->deleted)
+            return;
+        buffer += size_chunk;
+        size -= size_chunk;
+    }
 }
 
 /*
- * Checks if child process is still alive.
+ * Sends end of URL transfer to callback.
  */
 
-int
-hook_process_timer_cb (void *arg_hook_process, int remaining_calls)
+void
+hook_process_url_end_cb (void *arg_hook_process, int rc, const char *error)
 {
     struct t_hook *hook_process;
-    int status, rc;
-
-    /* make C compiler happy */
-    (void) remaining_calls;
 
     hook_process = (struct t_hook *)arg_hook_process;
 
+    /* the transfer is freed after this call */
+    HOOK_PROCESS(hook_process, url_transfer) = NULL;
+
     if (hook_process->deleted)
-        return WEECHAT_RC_OK;
+        return;
 
-    if (remaining_calls == 0)
+    if (error && !HOOK_PROCESS(hook_process, detached))
+    {
+        hook_process_add_to_buffer (hook_process, HOOK_PROCESS_STDERR,
+                                    error, strlen (error));
+    }
+    if (rc == 5)
     {
-        hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_ERROR);
+        /* timeout reached: same return code as a process killed */
+        rc = WEECHAT_HOOK_PROCESS_ERROR;
         if (weechat_debug_core >= 1)
         {
             gui_chat_printf (NULL,
@@ -1747,53 +2614,80 @@ hook_process_timer_cb (void *arg_hook_process, int remaining_calls)
                              HOOK_PROCESS(hook_process, command),
                              ((float)HOOK_PROCESS(hook_process, timeout)) / 1000);
         }
-        kill (HOOK_PROCESS(hook_process, child_pid), SIGKILL);
-        usleep (1000);
-        unhook (hook_process);
     }
-    else
+    hook_process_send_buffers (hook_process, rc);
+    unhook (hook_process);
+}
+
+/*
+ * Downloads URL for a process hook with command "url:..." (in WeeChat
+ * process, without fork).
+ */
+
+void
+hook_process_url_run (struct t_hook *hook_process)
+{
+    const char *ptr_url;
+    int rc;
+
+    /* get URL output (on stdout or file, depending on options) */
+    ptr_url = HOOK_PROCESS(hook_process, command) + 4;
+    while (ptr_url[0] == ' ')
     {
-        if (waitpid (HOOK_PROCESS(hook_process, child_pid),
-                     &status, WNOHANG) > 0)
-        {
-            if (WIFEXITED(status))
-            {
-                /* child terminated normally */
-                rc = WEXITSTATUS(status);
-                hook_process_send_buffers (hook_process, rc);
-                unhook (hook_process);
-            }
-            else if (WIFSIGNALED(status))
-            {
-                /* child terminated by a signal */
-                hook_process_send_buffers (hook_process,
-                                           WEECHAT_HOOK_PROCESS_ERROR);
-                unhook (hook_process);
-            }
-        }
+        ptr_url++;
     }
 
-    return WEECHAT_RC_OK;
+    HOOK_PROCESS(hook_process, url_transfer) =
+        weeurl_transfer_new (ptr_url,
+                             HOOK_PROCESS(hook_process, options),
+                             HOOK_PROCESS(hook_process, timeout),
+                             &hook_process_url_data_cb,
+                             &hook_process_url_end_cb,
+                             hook_process,
+                             &rc);
+    if (!HOOK_PROCESS(hook_process, url_transfer))
+    {
+        (void) (HOOK_PROCESS(hook_process, callback))
+            (hook_process->callback_data,
+             HOOK_PROCESS(hook_process, command),
+             rc,
+             NULL, NULL);
+        unhook (hook_process);
+    }
 }
 
 /*
  * Executes process command in child, and read data in current process,
  * with fd hook.
+ *
+ * For command "url:...", the URL is downloaded in current process.
  */
 
 void
 hook_process_run (struct t_hook *hook_process)
 {
-    int pipes[3][2], timeout, max_calls, rc, i;
-    long interval;
+    int pipes[3][2], rc, flags, i;
+#ifdef HAVE_POSIX_SPAWNP
+    char str_error[1024];
+#endif /* HAVE_POSIX_SPAWNP */
     pid_t pid;
 
+    if (strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) == 0)
+    {
+        hook_process_url_run (hook_process);
+        return;
+    }
+
     for (i = 0; i < 3; i++)
     {
         pipes[i][0] = -1;
         pipes[i][1] = -1;
     }
 
+    /* the end of child is detected with signal SIGCHLD (no polling) */
+    if (!hook_process_sigchld_init ())
+        goto error;
+
     /* create pipe for stdin (only if stdin was given in options) */
     if (HOOK_PROCESS(hook_process, options)
         && hashtable_has_key (HOOK_PROCESS(hook_process, options), "stdin"))
@@ -1818,26 +2712,57 @@ hook_process_run (struct t_hook *hook_process)
         HOOK_PROCESS(hook_process, child_write[i]) = pipes[i][1];
     }
 
-    /* fork */
-    switch (pid = fork ())
+    if (hook_process_use_spawn (hook_process))
     {
-        /* fork failed */
-        case -1:
-            (void) (HOOK_PROCESS(hook_process, callback))
-                (hook_process->callback_data,
-                 HOOK_PROCESS(hook_process, command),
-                 WEECHAT_HOOK_PROCESS_ERROR,
-                 NULL, NULL);
-            unhook (hook_process);
+#ifdef HAVE_POSIX_SPAWNP
+        pid = hook_process_spawn (hook_process);
+        if (pid < 0)
+        {
+            /* same result as a child unable to execute the command */
+            if (!HOOK_PROCESS(hook_process, detached))
+            {
+                snprintf (str_error, sizeof (str_error),
+                          "Error with command '%s'\n",
+                          HOOK_PROCESS(hook_process, command));
+                hook_process_add_to_buffer (hook_process,
+                                            HOOK_PROCESS_STDERR,
+                                            str_error, strlen (str_error));
+            }
+            /*
+             * error is reported to callback by a timer (the callback is
+             * never called before function hook_process returns)
+             */
+            HOOK_PROCESS(hook_process, hook_timer) =
+                hook_timer (hook_process->plugin, 1, 0, 1,
+                            &hook_process_error_timer_cb,
+                            hook_process);
             return;
-        /* child process */
-        case 0:
-            rc = setuid (getuid ());
-            (void) rc;
-            hook_process_child (hook_process);
-            /* never executed */
-            _exit (EXIT_SUCCESS);
-            break;
+        }
+#endif /* HAVE_POSIX_SPAWNP */
+    }
+    else
+    {
+        /* fork */
+        switch (pid = fork ())
+        {
+            /* fork failed */
+            case -1:
+                (void) (HOOK_PROCESS(hook_process, callback))
+                    (hook_process->callback_data,
+                     HOOK_PROCESS(hook_process, command),
+                     WEECHAT_HOOK_PROCESS_ERROR,
+                     NULL, NULL);
+                unhook (hook_process);
+                return;
+            /* child process */
+            case 0:
+                rc = setuid (getuid ());
+                (void) rc;
+                hook_process_child (hook_process);
+                /* never executed */
+                _exit (EXIT_SUCCESS);
+                break;
+        }
     }
 
     /* parent process */
@@ -1858,6 +2783,20 @@ hook_process_run (struct t_hook *hook_process)
         HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]) = -1;
     }
 
+    /*
+     * read fds are non-blocking, so that data still in pipes can be read
+     * when the child has died
+     */
+    for (i = HOOK_PROCESS_STDOUT; i <= HOOK_PROCESS_STDERR; i++)
+    {
+        if (HOOK_PROCESS(hook_process, child_read[i]) >= 0)
+        {
+            flags = fcntl (HOOK_PROCESS(hook_process, child_read[i]), F_GETFL);
+            fcntl (HOOK_PROCESS(hook_process, child_read[i]), F_SETFL,
+                   flags | O_NONBLOCK);
+        }
+    }
+
     if (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDOUT]) >= 0)
     {
         HOOK_PROCESS(hook_process, hook_fd[HOOK_PROCESS_STDOUT]) =
@@ -1878,28 +2817,14 @@ hook_process_run (struct t_hook *hook_process)
                      hook_process);
     }
 
-    timeout = HOOK_PROCESS(hook_process, timeout);
-    interval = 100;
-    max_calls = 0;
-    if (timeout > 0)
+    if (HOOK_PROCESS(hook_process, timeout) > 0)
     {
-        if (timeout <= 100)
-        {
-            interval = timeout;
-            max_calls = 1;
-        }
-        else
-        {
-            interval = 100;
-            max_calls = timeout / 100;
-            if (timeout % 100 == 0)
-                max_calls++;
-        }
+        HOOK_PROCESS(hook_process, hook_timer) =
+            hook_timer (hook_process->plugin,
+                        HOOK_PROCESS(hook_process, timeout), 0, 1,
+                        &hook_process_timer_cb,
+                        hook_process);
     }
-    HOOK_PROCESS(hook_process, hook_timer) = hook_timer (hook_process->plugin,
-                                                         interval, 0, max_calls,
-                                                         &hook_process_timer_cb,
-                                                         hook_process);
     return;
 
 error:
@@ -1919,7 +2844,7 @@ error:
 }
 
 /*
- * Hooks a connection to a peer (using fork).
+ * Hooks a connection to a peer (without blocking).
  *
  * Returns pointer to new hook, NULL if error.
  */
@@ -1933,9 +2858,7 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
 {
     struct t_hook *new_hook;
     struct t_hook_connect *new_hook_connect;
-#ifdef HOOK_CONNECT_MAX_SOCKETS
     int i;
-#endif
 
 #ifndef HAVE_GNUTLS
     /* make C compiler happy */
@@ -1978,28 +2901,35 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
 #endif
     new_hook_connect->local_hostname = (local_hostname) ?
         strdup (local_hostname) : NULL;
-    new_hook_connect->child_read = -1;
-    new_hook_connect->child_write = -1;
-    new_hook_connect->child_recv = -1;
-    new_hook_connect->child_send = -1;
-    new_hook_connect->child_pid = 0;
-    new_hook_connect->hook_child_timer = NULL;
+    new_hook_connect->resolve_remote = NULL;
+    new_hook_connect->resolve_local = NULL;
+    new_hook_connect->resolve_peer = NULL;
+    new_hook_connect->res_remote = NULL;
+    new_hook_connect->res_local = NULL;
+    new_hook_connect->res_peer = NULL;
+    new_hook_connect->addresses = NULL;
+    new_hook_connect->num_addresses = 0;
+    new_hook_connect->next_address = 0;
+    for (i = 0; i < HOOK_CONNECT_MAX_ATTEMPTS; i++)
+    {
+        new_hook_connect->attempt_sock[i] = -1;
+        new_hook_connect->attempt_address[i] = -1;
+        new_hook_connect->attempt_hook_fd[i] = NULL;
+    }
+    new_hook_connect->hook_attempt_timer = NULL;
+    new_hook_connect->status = WEECHAT_HOOK_CONNECT_OK;
+    new_hook_connect->proxy_dialog = NULL;
+    new_hook_connect->ip_address = NULL;
+    new_hook_connect->hook_timer = NULL;
     new_hook_connect->hook_fd = NULL;
     new_hook_connect->handshake_hook_fd = NULL;
     new_hook_connect->handshake_hook_timer = NULL;
     new_hook_connect->handshake_fd_flags = 0;
     new_hook_connect->handshake_ip_address = NULL;
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-    for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-    {
-        new_hook_connect->sock_v4[i] = -1;
-        new_hook_connect->sock_v6[i] = -1;
-    }
-#endif
 
     hook_add_to_list (new_hook);
 
-    network_connect_with_fork (new_hook);
+    network_connect_start (new_hook);
 
     return new_hook;
 }
@@ -2151,6 +3081,7 @@ void
 hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     char *prefix_no_color, *message_no_color;
 
     if (!line->data->message || !line->data->message[0])
@@ -2191,6 +3122,7 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
             {
                 /* run callback */
                 ptr_hook->running = 1;
+                HOOK_STATS_START(tv_stats);
                 (void) (HOOK_PRINT(ptr_hook, callback))
                     (ptr_hook->callback_data, buffer, line->data->date,
                      line->data->tags_count,
@@ -2198,6 +3130,7 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
                      (int)line->data->displayed, (int)line->data->highlight,
                      (HOOK_PRINT(ptr_hook, strip_colors)) ? prefix_no_color : line->data->prefix,
                      (HOOK_PRINT(ptr_hook, strip_colors)) ? message_no_color : line->data->message);
+                HOOK_STATS_END(ptr_hook, tv_stats);
                 ptr_hook->running = 0;
             }
         }
@@ -2262,6 +3195,7 @@ int
 hook_signal_send (const char *signal, const char *type_data, void *signal_data)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     int rc;
 
     rc = WEECHAT_RC_OK;
@@ -2278,8 +3212,10 @@ hook_signal_send (const char *signal, const char *type_data, void *signal_data)
             && (string_match (signal, HOOK_SIGNAL(ptr_hook, signal), 0)))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             rc = (HOOK_SIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_data, signal, type_data, signal_data);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
@@ -2343,6 +3279,7 @@ int
 hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     int rc;
 
     rc = WEECHAT_RC_OK;
@@ -2359,8 +3296,10 @@ hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
             && (string_match (signal, HOOK_HSIGNAL(ptr_hook, signal), 0)))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             rc = (HOOK_HSIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_data, signal, hashtable);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
@@ -2425,6 +3364,7 @@ void
 hook_config_exec (const char *option, const char *value)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
 
     hook_exec_start ();
 
@@ -2439,8 +3379,10 @@ hook_config_exec (const char *option, const char *value)
                 || (string_match (option, HOOK_CONFIG(ptr_hook, option), 0))))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             (void) (HOOK_CONFIG(ptr_hook, callback))
                 (ptr_hook->callback_data, option, value);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
         }
 
@@ -2530,6 +3472,7 @@ hook_completion_exec (struct t_weechat_plugin *plugin,
                       struct t_gui_completion *completion)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
 
     /* make C compiler happy */
     (void) plugin;
@@ -2547,8 +3490,10 @@ hook_completion_exec (struct t_weechat_plugin *plugin,
                                    completion_item) == 0))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             (void) (HOOK_COMPLETION(ptr_hook, callback))
                 (ptr_hook->callback_data, completion_item, buffer, completion);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
         }
 
@@ -2608,6 +3553,7 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                     const char *modifier_data, const char *string)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     char *new_msg, *message_modified;
 
     /* make C compiler happy */
@@ -2634,9 +3580,11 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                                    modifier) == 0))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             new_msg = (HOOK_MODIFIER(ptr_hook, callback))
                 (ptr_hook->callback_data, modifier, modifier_data,
                  message_modified);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             /* empty string returned => message dropped */
@@ -2717,6 +3665,7 @@ hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
                const char *arguments)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     const char *value;
 
     /* make C compiler happy */
@@ -2738,8 +3687,10 @@ hook_info_get (struct t_weechat_plugin *plugin, const char *info_name,
                                    info_name) == 0))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             value = (HOOK_INFO(ptr_hook, callback))
                 (ptr_hook->callback_data, info_name, arguments);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -2814,6 +3765,7 @@ hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
                          struct t_hashtable *hashtable)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     struct t_hashtable *value;
 
     /* make C compiler happy */
@@ -2835,8 +3787,10 @@ hook_info_get_hashtable (struct t_weechat_plugin *plugin, const char *info_name,
                                    info_name) == 0))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             value = (HOOK_INFO_HASHTABLE(ptr_hook, callback))
                 (ptr_hook->callback_data, info_name, hashtable);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -2910,6 +3864,7 @@ hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
                    void *pointer, const char *arguments)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     struct t_infolist *value;
 
     /* make C compiler happy */
@@ -2931,8 +3886,10 @@ hook_infolist_get (struct t_weechat_plugin *plugin, const char *infolist_name,
                                    infolist_name) == 0))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             value = (HOOK_INFOLIST(ptr_hook, callback))
                 (ptr_hook->callback_data, infolist_name, pointer, arguments);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3000,6 +3957,7 @@ struct t_hdata *
 hook_hdata_get (struct t_weechat_plugin *plugin, const char *hdata_name)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     struct t_hdata *value;
 
     /* make C compiler happy */
@@ -3027,9 +3985,11 @@ hook_hdata_get (struct t_weechat_plugin *plugin, const char *hdata_name)
             && (strcmp (HOOK_HDATA(ptr_hook, hdata_name), hdata_name) == 0))
         {
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             value = (HOOK_HDATA(ptr_hook, callback))
                 (ptr_hook->callback_data,
                  HOOK_HDATA(ptr_hook, hdata_name));
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
 
             hook_exec_end ();
@@ -3145,6 +4105,7 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
                      struct t_hashtable *hashtable_focus2)
 {
     struct t_hook *ptr_hook, *next_hook;
+    struct timeval tv_stats;
     struct t_hashtable *hashtable1, *hashtable2, *hashtable_ret;
     const char *focus1_chat, *focus1_bar_item_name, *keys;
     char **list_keys, *new_key;
@@ -3178,8 +4139,10 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
         {
             /* run callback for focus #1 */
             ptr_hook->running = 1;
+            HOOK_STATS_START(tv_stats);
             hashtable_ret = (HOOK_FOCUS(ptr_hook, callback))
                 (ptr_hook->callback_data, hashtable1);
+            HOOK_STATS_END(ptr_hook, tv_stats);
             ptr_hook->running = 0;
             if (hashtable_ret)
             {
@@ -3200,8 +4163,10 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
             if (hashtable2)
             {
                 ptr_hook->running = 1;
+                HOOK_STATS_START(tv_stats);
                 hashtable_ret = (HOOK_FOCUS(ptr_hook, callback))
                     (ptr_hook->callback_data, hashtable2);
+                HOOK_STATS_END(ptr_hook, tv_stats);
                 ptr_hook->running = 0;
                 if (hashtable_ret)
                 {
@@ -3304,6 +4269,17 @@ hook_set (struct t_hook *hook, const char *property, const char *value)
             HOOK_PROCESS(hook, child_write[HOOK_PROCESS_STDIN]) = -1;
         }
     }
+    else if (string_strcasecmp (property, "output_pause") == 0)
+    {
+        if (!hook->deleted
+            && (hook->type == HOOK_TYPE_PROCESS))
+        {
+            /* pause/resume reading of child output */
+            hook_process_pause_output (hook,
+                                       (value && (strcmp (value, "1") == 0)) ?
+                                       1 : 0);
+        }
+    }
     else if (string_strcasecmp (property, "signal") == 0)
     {
         if (!hook->deleted
@@ -3411,6 +4387,7 @@ unhook (struct t_hook *hook)
                     free (HOOK_COMMAND_RUN(hook, command));
                 break;
             case HOOK_TYPE_TIMER:
+                hook_timer_heap_remove (hook);
                 break;
             case HOOK_TYPE_FD:
                 break;
@@ -3427,6 +4404,8 @@ unhook (struct t_hook *hook)
                     unhook (HOOK_PROCESS(hook, hook_fd[HOOK_PROCESS_STDERR]));
                 if (HOOK_PROCESS(hook, hook_timer))
                     unhook (HOOK_PROCESS(hook, hook_timer));
+                if (HOOK_PROCESS(hook, url_transfer))
+                    weeurl_transfer_free (HOOK_PROCESS(hook, url_transfer));
                 if (HOOK_PROCESS(hook, child_pid) > 0)
                 {
                     kill (HOOK_PROCESS(hook, child_pid), SIGKILL);
@@ -3462,8 +4441,9 @@ unhook (struct t_hook *hook)
 #endif
                 if (HOOK_CONNECT(hook, local_hostname))
                     free (HOOK_CONNECT(hook, local_hostname));
-                if (HOOK_CONNECT(hook, hook_child_timer))
-                    unhook (HOOK_CONNECT(hook, hook_child_timer));
+                network_connect_free (hook);
+                if (HOOK_CONNECT(hook, hook_timer))
+                    unhook (HOOK_CONNECT(hook, hook_timer));
                 if (HOOK_CONNECT(hook, hook_fd))
                     unhook (HOOK_CONNECT(hook, hook_fd));
                 if (HOOK_CONNECT(hook, handshake_hook_fd))
@@ -3472,28 +4452,6 @@ unhook (struct t_hook *hook)
                     unhook (HOOK_CONNECT(hook, handshake_hook_timer));
                 if (HOOK_CONNECT(hook, handshake_ip_address))
                     free (HOOK_CONNECT(hook, handshake_ip_address));
-                if (HOOK_CONNECT(hook, child_pid) > 0)
-                {
-                    kill (HOOK_CONNECT(hook, child_pid), SIGKILL);
-                    waitpid (HOOK_CONNECT(hook, child_pid), NULL, 0);
-                }
-                if (HOOK_CONNECT(hook, child_read) != -1)
-                    close (HOOK_CONNECT(hook, child_read));
-                if (HOOK_CONNECT(hook, child_write) != -1)
-                    close (HOOK_CONNECT(hook, child_write));
-                if (HOOK_CONNECT(hook, child_recv) != -1)
-                    close (HOOK_CONNECT(hook, child_recv));
-                if (HOOK_CONNECT(hook, child_send) != -1)
-                    close (HOOK_CONNECT(hook, child_send));
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-                for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-                {
-                    if (HOOK_CONNECT(hook, sock_v4[i]) != -1)
-                        close (HOOK_CONNECT(hook, sock_v4[i]));
-                    if (HOOK_CONNECT(hook, sock_v6[i]) != -1)
-                        close (HOOK_CONNECT(hook, sock_v6[i]));
-                }
-#endif
                 break;
             case HOOK_TYPE_PRINT:
                 if (HOOK_PRINT(hook, tags_array))
@@ -3636,6 +4594,51 @@ unhook_all ()
     }
 }
 
+/*
+ * Returns hdata for hook.
+ */
+
+struct t_hdata *
+hook_hdata_hook_cb (void *data, const char *hdata_name)
+{
+    struct t_hdata *hdata;
+    char str_list[128];
+    int i;
+
+    /* make C compiler happy */
+    (void) data;
+
+    hdata = hdata_new (NULL, hdata_name, "prev_hook", "next_hook",
+                       0, 0, NULL, NULL);
+    if (hdata)
+    {
+        HDATA_VAR(struct t_hook, plugin, POINTER, 0, NULL, "plugin");
+        HDATA_VAR(struct t_hook, subplugin, STRING, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, type, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, deleted, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, running, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, priority, INTEGER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, callback_data, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, hook_data, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, stats_calls, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, stats_time_total, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, stats_time_max, LONG, 0, NULL, NULL);
+        HDATA_VAR(struct t_hook, prev_hook, POINTER, 0, NULL, hdata_name);
+        HDATA_VAR(struct t_hook, next_hook, POINTER, 0, NULL, hdata_name);
+        for (i = 0; i < HOOK_NUM_TYPES; i++)
+        {
+            snprintf (str_list, sizeof (str_list),
+                      "weechat_hooks_%s", hook_type_string[i]);
+            hdata_new_list (hdata, str_list, &weechat_hooks[i],
+                            WEECHAT_HDATA_LIST_CHECK_POINTERS);
+            snprintf (str_list, sizeof (str_list),
+                      "last_weechat_hook_%s", hook_type_string[i]);
+            hdata_new_list (hdata, str_list, &last_weechat_hook[i], 0);
+        }
+    }
+    return hdata;
+}
+
 /*
  * Adds a hook in an infolist.
  *
@@ -3764,6 +4767,10 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
                 if (!infolist_new_var_integer (ptr_item, "detached", HOOK_PROCESS(hook, detached)))
                     return 0;
+                if (!infolist_new_var_integer (ptr_item, "line_buffered", HOOK_PROCESS(hook, line_buffered)))
+                    return 0;
+                if (!infolist_new_var_integer (ptr_item, "output_paused", HOOK_PROCESS(hook, output_paused)))
+                    return 0;
                 if (!infolist_new_var_integer (ptr_item, "timeout", (int)(HOOK_PROCESS(hook, timeout))))
                     return 0;
                 if (!infolist_new_var_integer (ptr_item, "child_read_stdin", HOOK_PROCESS(hook, child_read[HOOK_PROCESS_STDIN])))
@@ -3815,17 +4822,17 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
 #endif
                 if (!infolist_new_var_string (ptr_item, "local_hostname", HOOK_CONNECT(hook, local_hostname)))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_read", HOOK_CONNECT(hook, child_read)))
+                if (!infolist_new_var_integer (ptr_item, "num_addresses", HOOK_CONNECT(hook, num_addresses)))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_write", HOOK_CONNECT(hook, child_write)))
+                if (!infolist_new_var_integer (ptr_item, "next_address", HOOK_CONNECT(hook, next_address)))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_recv", HOOK_CONNECT(hook, child_recv)))
+                if (!infolist_new_var_pointer (ptr_item, "hook_attempt_timer", HOOK_CONNECT(hook, hook_attempt_timer)))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_send", HOOK_CONNECT(hook, child_send)))
+                if (!infolist_new_var_integer (ptr_item, "status", HOOK_CONNECT(hook, status)))
                     return 0;
-                if (!infolist_new_var_integer (ptr_item, "child_pid", HOOK_CONNECT(hook, child_pid)))
+                if (!infolist_new_var_string (ptr_item, "ip_address", HOOK_CONNECT(hook, ip_address)))
                     return 0;
-                if (!infolist_new_var_pointer (ptr_item, "hook_child_timer", HOOK_CONNECT(hook, hook_child_timer)))
+                if (!infolist_new_var_pointer (ptr_item, "hook_timer", HOOK_CONNECT(hook, hook_timer)))
                     return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_fd", HOOK_CONNECT(hook, hook_fd)))
                     return 0;
@@ -4120,6 +5127,76 @@ hook_add_to_infolist (struct t_infolist *infolist, struct t_hook *pointer,
     return 1;
 }
 
+/*
+ * Adds statistics of hooks in an infolist (only hooks with at least one call
+ * of callback since statistics have been enabled or reset).
+ *
+ * Argument "arguments" can be a hook type.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hook_stats_add_to_infolist (struct t_infolist *infolist,
+                            const char *arguments)
+{
+    struct t_hook *ptr_hook;
+    struct t_infolist_item *ptr_item;
+    int type, type_int;
+
+    if (!infolist)
+        return 0;
+
+    type_int = (arguments && arguments[0]) ?
+        hook_search_type (arguments) : -1;
+
+    for (type = 0; type < HOOK_NUM_TYPES; type++)
+    {
+        if ((type_int >= 0) && (type_int != type))
+            continue;
+        for (ptr_hook = weechat_hooks[type]; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            if (ptr_hook->deleted || (ptr_hook->stats_calls == 0))
+                continue;
+            ptr_item = infolist_new_item (infolist);
+            if (!ptr_item)
+                return 0;
+            if (!infolist_new_var_pointer (ptr_item, "pointer", ptr_hook))
+                return 0;
+            if (!infolist_new_var_string (ptr_item, "plugin_name",
+                                          plugin_get_name (ptr_hook->plugin)))
+                return 0;
+            if (!infolist_new_var_string (ptr_item, "subplugin",
+                                          ptr_hook->subplugin))
+                return 0;
+            if (!infolist_new_var_string (ptr_item, "type",
+                                          hook_type_string[type]))
+                return 0;
+            if (!infolist_new_var_string (ptr_item, "description",
+                                          hook_get_description (ptr_hook)))
+                return 0;
+            if (!infolist_new_var_integer (ptr_item, "calls",
+                                           ptr_hook->stats_calls))
+                return 0;
+            if (!infolist_new_var_integer (ptr_item, "time_total_ms",
+                                           ptr_hook->stats_time_total / 1000))
+                return 0;
+            if (!infolist_new_var_integer (ptr_item, "time_avg_us",
+                                           ptr_hook->stats_time_total /
+                                           ptr_hook->stats_calls))
+                return 0;
+            if (!infolist_new_var_integer (ptr_item, "time_max_us",
+                                           ptr_hook->stats_time_max))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
 /*
  * Prints hooks in WeeChat log file (usually for crash dump).
  */
@@ -4149,6 +5226,9 @@ hook_print_log ()
             log_printf ("  running . . . . . . . . : %d",    ptr_hook->running);
             log_printf ("  priority. . . . . . . . : %d",    ptr_hook->priority);
             log_printf ("  callback_data . . . . . : 0x%lx", ptr_hook->callback_data);
+            log_printf ("  stats_calls . . . . . . : %ld",   ptr_hook->stats_calls);
+            log_printf ("  stats_time_total. . . . : %ld",   ptr_hook->stats_time_total);
+            log_printf ("  stats_time_max. . . . . : %ld",   ptr_hook->stats_time_max);
             switch (ptr_hook->type)
             {
                 case HOOK_TYPE_COMMAND:
@@ -4224,6 +5304,7 @@ hook_print_log ()
                                     HOOK_TIMER(ptr_hook, next_exec.tv_sec),
                                     text_time);
                         log_printf ("    next_exec.tv_usec . . : %ld",   HOOK_TIMER(ptr_hook, next_exec.tv_usec));
+                        log_printf ("    heap_index. . . . . . : %d",    HOOK_TIMER(ptr_hook, heap_index));
                     }
                     break;
                 case HOOK_TYPE_FD:
@@ -4247,6 +5328,8 @@ hook_print_log ()
                                     hashtable_get_string (HOOK_PROCESS(ptr_hook, options),
                                                           "keys_values"));
                         log_printf ("    detached. . . . . . . : %d",    HOOK_PROCESS(ptr_hook, detached));
+                        log_printf ("    line_buffered . . . . : %d",    HOOK_PROCESS(ptr_hook, line_buffered));
+                        log_printf ("    output_paused . . . . : %d",    HOOK_PROCESS(ptr_hook, output_paused));
                         log_printf ("    timeout . . . . . . . : %ld",   HOOK_PROCESS(ptr_hook, timeout));
                         log_printf ("    child_read[stdin] . . : %d",    HOOK_PROCESS(ptr_hook, child_read[HOOK_PROCESS_STDIN]));
                         log_printf ("    child_write[stdin]. . : %d",    HOOK_PROCESS(ptr_hook, child_write[HOOK_PROCESS_STDIN]));
@@ -4259,6 +5342,7 @@ hook_print_log ()
                         log_printf ("    hook_fd[stdout] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDOUT]));
                         log_printf ("    hook_fd[stderr] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDERR]));
                         log_printf ("    hook_timer. . . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_timer));
+                        log_printf ("    url_transfer. . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, url_transfer));
                     }
                     break;
                 case HOOK_TYPE_CONNECT:
@@ -4278,24 +5362,25 @@ hook_print_log ()
                         log_printf ("    gnutls_priorities . . : '%s'",  HOOK_CONNECT(ptr_hook, gnutls_priorities));
 #endif
                         log_printf ("    local_hostname. . . . : '%s'",  HOOK_CONNECT(ptr_hook, local_hostname));
-                        log_printf ("    child_read. . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_read));
-                        log_printf ("    child_write . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_write));
-                        log_printf ("    child_recv. . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_recv));
-                        log_printf ("    child_send. . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_send));
-                        log_printf ("    child_pid . . . . . . : %d",    HOOK_CONNECT(ptr_hook, child_pid));
-                        log_printf ("    hook_child_timer. . . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_child_timer));
+                        log_printf ("    resolve_remote. . . . : 0x%lx", HOOK_CONNECT(ptr_hook, resolve_remote));
+                        log_printf ("    resolve_local . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, resolve_local));
+                        log_printf ("    resolve_peer. . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, resolve_peer));
+                        log_printf ("    num_addresses . . . . : %d",    HOOK_CONNECT(ptr_hook, num_addresses));
+                        log_printf ("    next_address. . . . . : %d",    HOOK_CONNECT(ptr_hook, next_address));
+                        for (i = 0; i < HOOK_CONNECT_MAX_ATTEMPTS; i++)
+                        {
+                            log_printf ("    attempt_sock[%d]. . . : %d", i, HOOK_CONNECT(ptr_hook, attempt_sock[i]));
+                        }
+                        log_printf ("    hook_attempt_timer. . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_attempt_timer));
+                        log_printf ("    status. . . . . . . . : %d",    HOOK_CONNECT(ptr_hook, status));
+                        log_printf ("    proxy_dialog. . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, proxy_dialog));
+                        log_printf ("    ip_address. . . . . . : '%s'",  HOOK_CONNECT(ptr_hook, ip_address));
+                        log_printf ("    hook_timer. . . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_timer));
                         log_printf ("    hook_fd . . . . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_fd));
                         log_printf ("    handshake_hook_fd . . : 0x%lx", HOOK_CONNECT(ptr_hook, handshake_hook_fd));
                         log_printf ("    handshake_hook_timer. : 0x%lx", HOOK_CONNECT(ptr_hook, handshake_hook_timer));
                         log_printf ("    handshake_fd_flags. . : %d",    HOOK_CONNECT(ptr_hook, handshake_fd_flags));
                         log_printf ("    handshake_ip_address. : '%s'",  HOOK_CONNECT(ptr_hook, handshake_ip_address));
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-                        for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-                        {
-                            log_printf ("    sock_v4[%d]. . . . . . : '%d'", HOOK_CONNECT(ptr_hook, sock_v4[i]));
-                            log_printf ("    sock_v6[%d]. . . . . . : '%d'", HOOK_CONNECT(ptr_hook, sock_v6[i]));
-                        }
-#endif
                     }
                     break;
                 case HOOK_TYPE_PRINT:
@@ -27,18 +27,12 @@
 #include <gnutls/gnutls.h>
 #endif
 
-#if defined(__CYGWIN__) || defined(__APPLE__) || defined(__MACH__)
-/*
- * For the connect hook, when this is defined an array of sockets will
- * be passed from the parent process to the child process instead of using
- * SCM_RIGHTS to pass a socket back from the child process to parent process.
- *
- * This allows connections to work on Windows but it limits the number of
- * IPs that can be attempted each time.
- */
-#define HOOK_CONNECT_MAX_SOCKETS 4
-#endif
+/* max number of connection attempts in progress (for connect hook) */
+#define HOOK_CONNECT_MAX_ATTEMPTS 4
+/* delay before next connection attempt (in milliseconds) */
+#define HOOK_CONNECT_ATTEMPT_DELAY 250
 
+struct addrinfo;
 struct t_gui_bar;
 struct t_gui_buffer;
 struct t_gui_line;
@@ -47,6 +41,9 @@ struct t_gui_window;
 struct t_weelist;
 struct t_hashtable;
 struct t_infolist;
+struct t_url_transfer;
+struct t_resolve_request;
+struct t_network_proxy_dialog;
 
 /* hook types */
 
@@ -57,7 +54,7 @@ enum t_hook_type
     HOOK_TYPE_TIMER,                   /* timer                             */
     HOOK_TYPE_FD,                      /* socket of file descriptor         */
     HOOK_TYPE_PROCESS,                 /* sub-process (fork)                */
-    HOOK_TYPE_CONNECT,                 /* connect to peer with fork         */
+    HOOK_TYPE_CONNECT,                 /* connect to peer                   */
     HOOK_TYPE_PRINT,                   /* printed message                   */
     HOOK_TYPE_SIGNAL,                  /* signal                            */
     HOOK_TYPE_HSIGNAL,                 /* signal (using hashtable)          */
@@ -112,6 +109,20 @@ enum t_hook_type
 #define HOOK_HDATA(hook, var) (((struct t_hook_hdata *)hook->hook_data)->var)
 #define HOOK_FOCUS(hook, var) (((struct t_hook_focus *)hook->hook_data)->var)
 
+/*
+ * macros to measure time spent in a hook callback (only if stats are enabled,
+ * with "/debug hooks-time enable"); if stats are disabled, tv_sec is set to 0
+ * so that nothing is done at the end of callback
+ */
+#define HOOK_STATS_START(__tv)                                          \
+    if (hook_stats_enabled)                                             \
+        gettimeofday (&(__tv), NULL);                                   \
+    else                                                                \
+        (__tv).tv_sec = 0
+#define HOOK_STATS_END(__hook, __tv)                                    \
+    if ((__tv).tv_sec != 0)                                             \
+        hook_stats_add (__hook, &(__tv))
+
 struct t_hook
 {
     /* data common to all hooks */
@@ -129,6 +140,12 @@ struct t_hook
 
     /* hook data (depends on hook type) */
     void *hook_data;                   /* hook specific data                */
+
+    /* statistics (only if enabled, see "/debug hooks-time") */
+    long stats_calls;                  /* number of calls of callback       */
+    long stats_time_total;             /* total time in callback (in usec)  */
+    long stats_time_max;               /* max time in callback (in usec)    */
+
     struct t_hook *prev_hook;          /* link to previous hook             */
     struct t_hook *next_hook;          /* link to next hook                 */
 };
@@ -187,6 +204,8 @@ struct t_hook_timer
     int remaining_calls;               /* calls remaining (0 = unlimited)   */
     struct timeval last_exec;          /* last time hook was executed       */
     struct timeval next_exec;          /* next scheduled execution          */
+    int heap_index;                    /* index in heap of timers (-1 if    */
+                                       /* not in heap)                      */
 };
 
 /* hook fd */
@@ -214,12 +233,15 @@ struct t_hook_process
     char *command;                     /* command executed by child         */
     struct t_hashtable *options;       /* options for process (see doc)     */
     int detached;                      /* detached mode (background)        */
+    int line_buffered;                 /* 1 = send output line by line      */
     long timeout;                      /* timeout (ms) (0 = no timeout)     */
+    int output_paused;                 /* 1 if stdout/stderr are not read   */
     int child_read[3];                 /* read stdin/out/err data from child*/
     int child_write[3];                /* write stdin/out/err data for child*/
     pid_t child_pid;                   /* pid of child process              */
     struct t_hook *hook_fd[3];         /* hook fd for stdin/out/err         */
-    struct t_hook *hook_timer;         /* timer to check if child has died  */
+    struct t_hook *hook_timer;         /* timer for timeout/error of child */
+    struct t_url_transfer *url_transfer; /* URL transfer (command "url:...")*/
     char *buffer[3];                   /* buffers for child stdin/out/err   */
     int buffer_size[3];                /* size of child stdin/out/err       */
     int buffer_flush;                  /* bytes to flush output buffers     */
@@ -261,21 +283,28 @@ struct t_hook_connect
     char *gnutls_priorities;           /* GnuTLS priorities                 */
 #endif
     char *local_hostname;              /* force local hostname (optional)   */
-    int child_read;                    /* to read data in pipe from child   */
-    int child_write;                   /* to write data in pipe for child   */
-    int child_recv;                    /* to read data from child socket    */
-    int child_send;                    /* to write data to child socket     */
-    pid_t child_pid;                   /* pid of child process (connecting) */
-    struct t_hook *hook_child_timer;   /* timer for child process timeout   */
-    struct t_hook *hook_fd;            /* pointer to fd hook                */
+    struct t_resolve_request *resolve_remote; /* resolution of peer/proxy  */
+    struct t_resolve_request *resolve_local;  /* resolution of local host  */
+    struct t_resolve_request *resolve_peer;   /* resolution of peer (socks4)*/
+    struct addrinfo *res_remote;       /* addresses of peer (or proxy)      */
+    struct addrinfo *res_local;        /* addresses of local hostname       */
+    struct addrinfo *res_peer;         /* addresses of peer (socks4 proxy)  */
+    struct addrinfo **addresses;       /* addresses to try (sorted)         */
+    int num_addresses;                 /* number of addresses to try        */
+    int next_address;                  /* index of next address to try      */
+    int attempt_sock[HOOK_CONNECT_MAX_ATTEMPTS]; /* sockets connecting      */
+    int attempt_address[HOOK_CONNECT_MAX_ATTEMPTS]; /* address (index)      */
+    struct t_hook *attempt_hook_fd[HOOK_CONNECT_MAX_ATTEMPTS]; /* fd hooks  */
+    struct t_hook *hook_attempt_timer; /* timer to start next attempt       */
+    int status;                        /* status of last failed attempt     */
+    struct t_network_proxy_dialog *proxy_dialog; /* dialog with proxy       */
+    char *ip_address;                  /* IP address of peer (connected)    */
+    struct t_hook *hook_timer;         /* timer for connection timeout      */
+    struct t_hook *hook_fd;            /* fd hook (dialog with proxy)       */
     struct t_hook *handshake_hook_fd;  /* fd hook for handshake             */
     struct t_hook *handshake_hook_timer; /* timer for handshake timeout     */
     int handshake_fd_flags;            /* socket flags saved for handshake  */
     char *handshake_ip_address;        /* ip address (used for handshake)   */
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-    int sock_v4[HOOK_CONNECT_MAX_SOCKETS];  /* IPv4 sockets for connecting  */
-    int sock_v6[HOOK_CONNECT_MAX_SOCKETS];  /* IPv6 sockets for connecting  */
-#endif
 };
 
 /* hook print */
@@ -430,11 +459,20 @@ struct t_hook_focus
 extern char *hook_type_string[];
 extern struct t_hook *weechat_hooks[];
 extern struct t_hook *last_weechat_hook[];
+extern int hook_stats_enabled;
+extern time_t hook_stats_start_time;
+extern struct t_hook *hook_main_loop_running;
+extern struct t_hook **hook_timer_heap;
+extern int hook_timer_heap_count;
 
 /* hook functions */
 
 extern void hook_init ();
 extern int hook_valid (struct t_hook *hook);
+extern void hook_stats_add (struct t_hook *hook, struct timeval *tv_start);
+extern void hook_stats_enable (int enable);
+extern void hook_stats_reset ();
+extern const char *hook_get_description (struct t_hook *hook);
 extern struct t_hook *hook_command (struct t_weechat_plugin *plugin,
                                     const char *command,
                                     const char *description,
@@ -595,6 +633,10 @@ extern void hook_set (struct t_hook *hook, const char *property,
 extern void unhook (struct t_hook *hook);
 extern void unhook_all_plugin (struct t_weechat_plugin *plugin);
 extern void unhook_all ();
+extern struct t_hdata *hook_hdata_hook_cb (void *data,
+                                           const char *hdata_name);
+extern int hook_stats_add_to_infolist (struct t_infolist *infolist,
+                                       const char *arguments);
 extern int hook_add_to_infolist (struct t_infolist *infolist,
                                  struct t_hook *hook,
                                  const char *arguments);
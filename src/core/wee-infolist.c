@@ -27,9 +27,12 @@
 #include <string.h>
 
 #include "weechat.h"
+#include "wee-hashtable.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-string.h"
 #include "wee-infolist.h"
+#include "../plugins/plugin.h"
 
 
 struct t_infolist *weechat_infolists = NULL;
@@ -46,14 +49,24 @@ struct t_infolist *
 infolist_new (struct t_weechat_plugin *plugin)
 {
     struct t_infolist *new_infolist;
+    struct t_memory_tag *memory_tag;
 
-    new_infolist = malloc (sizeof (*new_infolist));
+    memory_tag = memory_tag_get_plugin (plugin, "infolist");
+
+    new_infolist = memory_malloc (memory_tag, sizeof (*new_infolist));
     if (new_infolist)
     {
         new_infolist->plugin = plugin;
+        new_infolist->memory_tag = memory_tag;
         new_infolist->items = NULL;
         new_infolist->last_item = NULL;
         new_infolist->ptr_item = NULL;
+        new_infolist->schema = NULL;
+        new_infolist->schema_count = 0;
+        new_infolist->schema_size = 0;
+        new_infolist->schema_index = NULL;
+        new_infolist->schema_fields = NULL;
+        new_infolist->schema_fields_count = 0;
 
         new_infolist->prev_infolist = last_weechat_infolist;
         new_infolist->next_infolist = NULL;
@@ -105,11 +118,27 @@ infolist_new_item (struct t_infolist *infolist)
 {
     struct t_infolist_item *new_item;
 
-    new_item = malloc (sizeof (*new_item));
+    if (!infolist)
+        return NULL;
+
+    new_item = memory_malloc (infolist->memory_tag, sizeof (*new_item));
     if (new_item)
     {
+        new_item->infolist = infolist;
+
+        /* allocate variables for all variables of schema */
         new_item->vars = NULL;
-        new_item->last_var = NULL;
+        new_item->vars_count = 0;
+        new_item->vars_size = 0;
+        if (infolist->schema_count > 0)
+        {
+            new_item->vars = memory_malloc (infolist->memory_tag,
+                                            infolist->schema_count *
+                                            sizeof (*new_item->vars));
+            if (new_item->vars)
+                new_item->vars_size = infolist->schema_count;
+        }
+        new_item->vars_in_schema_order = 1;
         new_item->fields = NULL;
 
         new_item->prev_item = infolist->last_item;
@@ -124,6 +153,154 @@ infolist_new_item (struct t_infolist *infolist)
     return new_item;
 }
 
+/*
+ * Searches for a variable name in schema of infolist (case is ignored).
+ *
+ * The hashtable used to search names is built on first call.
+ *
+ * Returns index of variable in schema, -1 if not found.
+ */
+
+int
+infolist_schema_search (struct t_infolist *infolist, const char *name)
+{
+    int i, *ptr_index;
+
+    if (!infolist->schema_index)
+    {
+        infolist->schema_index = hashtable_new (
+            (infolist->schema_count > 16) ? infolist->schema_count * 2 : 32,
+            WEECHAT_HASHTABLE_STRING,
+            WEECHAT_HASHTABLE_INTEGER,
+            &hashtable_hash_key_string_case_cb,
+            &hashtable_keycmp_string_case_cb);
+        if (!infolist->schema_index)
+            return -1;
+        for (i = 0; i < infolist->schema_count; i++)
+        {
+            /* if a name is many times in schema, the first one is used */
+            if (!hashtable_has_key (infolist->schema_index,
+                                    infolist->schema[i].name))
+            {
+                hashtable_set (infolist->schema_index,
+                               infolist->schema[i].name, &i);
+            }
+        }
+    }
+
+    ptr_index = hashtable_get (infolist->schema_index, name);
+
+    return (ptr_index) ? *ptr_index : -1;
+}
+
+/*
+ * Adds a variable name in schema of infolist.
+ *
+ * Returns index of variable in schema, -1 if error.
+ */
+
+int
+infolist_schema_add (struct t_infolist *infolist, const char *name,
+                     enum t_infolist_type type)
+{
+    struct t_infolist_schema_var *new_schema;
+    int new_size, index;
+
+    if (infolist->schema_count == infolist->schema_size)
+    {
+        new_size = (infolist->schema_size > 0) ?
+            infolist->schema_size * 2 : 16;
+        new_schema = memory_realloc (infolist->memory_tag, infolist->schema,
+                                     new_size * sizeof (*new_schema));
+        if (!new_schema)
+            return -1;
+        infolist->schema = new_schema;
+        infolist->schema_size = new_size;
+    }
+
+    index = infolist->schema_count;
+    infolist->schema[index].name = memory_strdup (infolist->memory_tag,
+                                                  name);
+    if (!infolist->schema[index].name)
+        return -1;
+    infolist->schema[index].type = type;
+    infolist->schema_count++;
+
+    if (infolist->schema_index
+        && !hashtable_has_key (infolist->schema_index, name))
+    {
+        hashtable_set (infolist->schema_index, name, &index);
+    }
+
+    return index;
+}
+
+/*
+ * Creates a new variable in an item (value is not set).
+ *
+ * Note: the pointer returned is valid until another variable is created in
+ * the same item.
+ *
+ * Returns pointer to new variable, NULL if error.
+ */
+
+struct t_infolist_var *
+infolist_item_new_var (struct t_infolist_item *item, const char *name,
+                       enum t_infolist_type type)
+{
+    struct t_infolist *ptr_infolist;
+    struct t_infolist_var *new_vars, *new_var;
+    int position, index, new_size;
+
+    ptr_infolist = item->infolist;
+    position = item->vars_count;
+
+    /*
+     * search variable in schema: if the item has same variables as
+     * previous items, the name is at same position in schema
+     */
+    if ((position < ptr_infolist->schema_count)
+        && (strcmp (ptr_infolist->schema[position].name, name) == 0))
+    {
+        index = position;
+    }
+    else
+    {
+        index = (item == ptr_infolist->items) ?
+            -1 : infolist_schema_search (ptr_infolist, name);
+        if (index < 0)
+            index = infolist_schema_add (ptr_infolist, name, type);
+        if (index < 0)
+            return NULL;
+    }
+
+    if (item->vars_count == item->vars_size)
+    {
+        new_size = (item->vars_size > 0) ? item->vars_size * 2 : 16;
+        if (new_size < ptr_infolist->schema_count)
+            new_size = ptr_infolist->schema_count;
+        new_vars = memory_realloc (ptr_infolist->memory_tag, item->vars,
+                                   new_size * sizeof (*new_vars));
+        if (!new_vars)
+            return NULL;
+        item->vars = new_vars;
+        item->vars_size = new_size;
+    }
+
+    if ((index != position) || (ptr_infolist->schema[index].type != type))
+        item->vars_in_schema_order = 0;
+
+    new_var = &item->vars[position];
+    new_var->name = ptr_infolist->schema[index].name;
+    new_var->index = index;
+    new_var->type = type;
+    new_var->value.pointer = NULL;
+    new_var->size = 0;
+    item->vars_count++;
+
+    return new_var;
+}
+
 /*
  * Creates a new integer variable in an item.
  *
@@ -139,23 +316,9 @@ infolist_new_var_integer (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_item_new_var (item, name, INFOLIST_INTEGER);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_INTEGER;
-        new_var->value = malloc (sizeof (int));
-        if (new_var->value)
-            *((int *)new_var->value) = value;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.integer = value;
 
     return new_var;
 }
@@ -175,21 +338,10 @@ infolist_new_var_string (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_item_new_var (item, name, INFOLIST_STRING);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_STRING;
-        new_var->value = (value) ? strdup (value) : NULL;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.string = memory_strdup (item->infolist->memory_tag,
+                                               value);
 
     return new_var;
 }
@@ -209,21 +361,9 @@ infolist_new_var_pointer (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_item_new_var (item, name, INFOLIST_POINTER);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_POINTER;
-        new_var->value = pointer;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.pointer = pointer;
 
     return new_var;
 }
@@ -243,23 +383,14 @@ infolist_new_var_buffer (struct t_infolist_item *item,
     if (!item || !name || !name[0] || (size <= 0))
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_item_new_var (item, name, INFOLIST_BUFFER);
     if (new_var)
     {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_BUFFER;
-        new_var->value = malloc (size);
-        if (new_var->value)
-            memcpy (new_var->value, pointer, size);
+        new_var->value.pointer = memory_malloc (item->infolist->memory_tag,
+                                                size);
+        if (new_var->value.pointer)
+            memcpy (new_var->value.pointer, pointer, size);
         new_var->size = size;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
     }
 
     return new_var;
@@ -280,23 +411,9 @@ infolist_new_var_time (struct t_infolist_item *item,
     if (!item || !name || !name[0])
         return NULL;
 
-    new_var = malloc (sizeof (*new_var));
+    new_var = infolist_item_new_var (item, name, INFOLIST_TIME);
     if (new_var)
-    {
-        new_var->name = strdup (name);
-        new_var->type = INFOLIST_TIME;
-        new_var->value = malloc (sizeof (time_t));
-        if (new_var->value)
-            *((time_t *)new_var->value) = time;
-
-        new_var->prev_var = item->last_var;
-        new_var->next_var = NULL;
-        if (item->vars)
-            item->last_var->next_var = new_var;
-        else
-            item->vars = new_var;
-        item->last_var = new_var;
-    }
+        new_var->value.time = time;
 
     return new_var;
 }
@@ -354,16 +471,26 @@ infolist_reset_item_cursor (struct t_infolist *infolist)
 struct t_infolist_var *
 infolist_search_var (struct t_infolist *infolist, const char *name)
 {
-    struct t_infolist_var *ptr_var;
+    struct t_infolist_item *ptr_item;
+    int index, i;
 
     if (!infolist || !infolist->ptr_item || !name || !name[0])
         return NULL;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
+    index = infolist_schema_search (infolist, name);
+    if (index < 0)
+        return NULL;
+
+    ptr_item = infolist->ptr_item;
+
+    /* fast path: variables of item are in schema order */
+    if (ptr_item->vars_in_schema_order)
+        return (index < ptr_item->vars_count) ? &ptr_item->vars[index] : NULL;
+
+    for (i = 0; i < ptr_item->vars_count; i++)
     {
-        if (string_strcasecmp (ptr_var->name, name) == 0)
-            return ptr_var;
+        if (ptr_item->vars[i].index == index)
+            return &ptr_item->vars[i];
     }
 
     /* variable not found */
@@ -371,89 +498,107 @@ infolist_search_var (struct t_infolist *infolist, const char *name)
 }
 
 /*
- * Gets list of fields for current infolist item.
+ * Builds list of fields for an item.
+ *
+ * Note: result must be freed after use.
  */
 
-const char *
-infolist_fields (struct t_infolist *infolist)
+char *
+infolist_item_build_fields (struct t_infolist_item *item)
 {
-    struct t_infolist_var *ptr_var;
-    int length;
-
-    if (!infolist || !infolist->ptr_item)
-        return NULL;
-
-    /* list of fields already asked ? if yes, just return string */
-    if (infolist->ptr_item->fields)
-        return infolist->ptr_item->fields;
+    char *fields;
+    int i, length;
 
     length = 0;
-    for (ptr_var = infolist->ptr_item->vars;
-         ptr_var; ptr_var = ptr_var->next_var)
+    for (i = 0; i < item->vars_count; i++)
     {
-        length += strlen (ptr_var->name) + 3;
+        length += strlen (item->vars[i].name) + 3;
     }
 
-    infolist->ptr_item->fields = malloc (length + 1);
-    if (!infolist->ptr_item->fields)
+    fields = memory_malloc (item->infolist->memory_tag, length + 1);
+    if (!fields)
         return NULL;
 
-    infolist->ptr_item->fields[0] = '\0';
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
+    fields[0] = '\0';
+    for (i = 0; i < item->vars_count; i++)
     {
-        switch (ptr_var->type)
+        switch (item->vars[i].type)
         {
             case INFOLIST_INTEGER:
-                strcat (infolist->ptr_item->fields, "i:");
+                strcat (fields, "i:");
                 break;
             case INFOLIST_STRING:
-                strcat (infolist->ptr_item->fields, "s:");
+                strcat (fields, "s:");
                 break;
             case INFOLIST_POINTER:
-                strcat (infolist->ptr_item->fields, "p:");
+                strcat (fields, "p:");
                 break;
             case INFOLIST_BUFFER:
-                strcat (infolist->ptr_item->fields, "b:");
+                strcat (fields, "b:");
                 break;
             case INFOLIST_TIME:
-                strcat (infolist->ptr_item->fields, "t:");
+                strcat (fields, "t:");
                 break;
         }
-        strcat (infolist->ptr_item->fields, ptr_var->name);
-        if (ptr_var->next_var)
-            strcat (infolist->ptr_item->fields, ",");
+        strcat (fields, item->vars[i].name);
+        if (i < item->vars_count - 1)
+            strcat (fields, ",");
     }
 
-    return infolist->ptr_item->fields;
+    return fields;
 }
 
 /*
- * Gets integer value for a variable in current infolist item.
+ * Gets list of fields for current infolist item.
+ *
+ * The list is shared by all items having same variables as the first item
+ * asked with variables in schema order (variables are only added at the end
+ * of schema, so this list never changes).
  */
 
-int
-infolist_integer (struct t_infolist *infolist, const char *var)
+const char *
+infolist_fields (struct t_infolist *infolist)
 {
-    struct t_infolist_var *ptr_var;
+    struct t_infolist_item *ptr_item;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
-        return 0;
+    if (!infolist || !infolist->ptr_item)
+        return NULL;
+
+    ptr_item = infolist->ptr_item;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
+    /* list of fields already asked ? if yes, just return string */
+    if (ptr_item->fields)
+        return ptr_item->fields;
+
+    if (ptr_item->vars_in_schema_order)
     {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
+        if (!infolist->schema_fields)
         {
-            if (ptr_var->type == INFOLIST_INTEGER)
-                return *((int *)ptr_var->value);
-            else
-                return 0;
+            infolist->schema_fields = infolist_item_build_fields (ptr_item);
+            infolist->schema_fields_count = ptr_item->vars_count;
         }
+        if (ptr_item->vars_count == infolist->schema_fields_count)
+            return infolist->schema_fields;
     }
 
-    /* variable not found */
-    return 0;
+    ptr_item->fields = infolist_item_build_fields (ptr_item);
+
+    return ptr_item->fields;
+}
+
+/*
+ * Gets integer value for a variable in current infolist item.
+ */
+
+int
+infolist_integer (struct t_infolist *infolist, const char *var)
+{
+    struct t_infolist_var *ptr_var;
+
+    ptr_var = infolist_search_var (infolist, var);
+
+    return (ptr_var && (ptr_var->type == INFOLIST_INTEGER)) ?
+        ptr_var->value.integer : 0;
 }
 
 /*
@@ -465,23 +610,10 @@ infolist_string (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
-        return NULL;
-
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_STRING)
-                return (char *)ptr_var->value;
-            else
-                return NULL;
-        }
-    }
+    ptr_var = infolist_search_var (infolist, var);
 
-    /* variable not found */
-    return NULL;
+    return (ptr_var && (ptr_var->type == INFOLIST_STRING)) ?
+        ptr_var->value.string : NULL;
 }
 
 /*
@@ -493,23 +625,10 @@ infolist_pointer (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
-        return NULL;
-
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_POINTER)
-                return ptr_var->value;
-            else
-                return NULL;
-        }
-    }
+    ptr_var = infolist_search_var (infolist, var);
 
-    /* variable not found */
-    return NULL;
+    return (ptr_var && (ptr_var->type == INFOLIST_POINTER)) ?
+        ptr_var->value.pointer : NULL;
 }
 
 /*
@@ -524,26 +643,12 @@ infolist_buffer (struct t_infolist *infolist, const char *var,
 {
     struct t_infolist_var *ptr_var;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
+    ptr_var = infolist_search_var (infolist, var);
+    if (!ptr_var || (ptr_var->type != INFOLIST_BUFFER))
         return NULL;
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_BUFFER)
-            {
-                *size = ptr_var->size;
-                return ptr_var->value;
-            }
-            else
-                return NULL;
-        }
-    }
-
-    /* variable not found */
-    return NULL;
+    *size = ptr_var->size;
+    return ptr_var->value.pointer;
 }
 
 /*
@@ -555,64 +660,10 @@ infolist_time (struct t_infolist *infolist, const char *var)
 {
     struct t_infolist_var *ptr_var;
 
-    if (!infolist || !infolist->ptr_item || !var || !var[0])
-        return 0;
+    ptr_var = infolist_search_var (infolist, var);
 
-    for (ptr_var = infolist->ptr_item->vars; ptr_var;
-         ptr_var = ptr_var->next_var)
-    {
-        if (string_strcasecmp (ptr_var->name, var) == 0)
-        {
-            if (ptr_var->type == INFOLIST_TIME)
-                return *((time_t *)ptr_var->value);
-            else
-                return 0;
-        }
-    }
-
-    /* variable not found */
-    return 0;
-}
-
-/*
- * Frees a variable in item.
- */
-
-void
-infolist_var_free (struct t_infolist_item *item,
-                   struct t_infolist_var *var)
-{
-    struct t_infolist_var *new_vars;
-
-    /* remove var */
-    if (item->last_var == var)
-        item->last_var = var->prev_var;
-    if (var->prev_var)
-    {
-        (var->prev_var)->next_var = var->next_var;
-        new_vars = item->vars;
-    }
-    else
-        new_vars = var->next_var;
-
-    if (var->next_var)
-        (var->next_var)->prev_var = var->prev_var;
-
-    /* free data */
-    if (var->name)
-        free (var->name);
-    if (((var->type == INFOLIST_INTEGER)
-         || (var->type == INFOLIST_STRING)
-         || (var->type == INFOLIST_BUFFER)
-         || (var->type == INFOLIST_TIME))
-        && var->value)
-    {
-        free (var->value);
-    }
-
-    free (var);
-
-    item->vars = new_vars;
+    return (ptr_var && (ptr_var->type == INFOLIST_TIME)) ?
+        ptr_var->value.time : 0;
 }
 
 /*
@@ -624,6 +675,7 @@ infolist_item_free (struct t_infolist *infolist,
                     struct t_infolist_item *item)
 {
     struct t_infolist_item *new_items;
+    int i;
 
     /* remove var */
     if (infolist->last_item == item)
@@ -640,14 +692,21 @@ infolist_item_free (struct t_infolist *infolist,
         (item->next_item)->prev_item = item->prev_item;
 
     /* free data */
-    while (item->vars)
+    for (i = 0; i < item->vars_count; i++)
     {
-        infolist_var_free (item, item->vars);
+        if (((item->vars[i].type == INFOLIST_STRING)
+             || (item->vars[i].type == INFOLIST_BUFFER))
+            && item->vars[i].value.pointer)
+        {
+            memory_free (infolist->memory_tag, item->vars[i].value.pointer);
+        }
     }
+    if (item->vars)
+        memory_free (infolist->memory_tag, item->vars);
     if (item->fields)
-        free (item->fields);
+        memory_free (infolist->memory_tag, item->fields);
 
-    free (item);
+    memory_free (infolist->memory_tag, item);
 
     infolist->items = new_items;
 }
@@ -660,6 +719,7 @@ void
 infolist_free (struct t_infolist *infolist)
 {
     struct t_infolist *new_weechat_infolists;
+    int i;
 
     /* remove list */
     if (last_weechat_infolist == infolist)
@@ -680,8 +740,18 @@ infolist_free (struct t_infolist *infolist)
     {
         infolist_item_free (infolist, infolist->items);
     }
+    for (i = 0; i < infolist->schema_count; i++)
+    {
+        memory_free (infolist->memory_tag, infolist->schema[i].name);
+    }
+    if (infolist->schema)
+        memory_free (infolist->memory_tag, infolist->schema);
+    if (infolist->schema_index)
+        hashtable_free (infolist->schema_index);
+    if (infolist->schema_fields)
+        memory_free (infolist->memory_tag, infolist->schema_fields);
 
-    free (infolist);
+    memory_free (infolist->memory_tag, infolist);
 
     weechat_infolists = new_weechat_infolists;
 }
@@ -715,6 +785,7 @@ infolist_print_log ()
     struct t_infolist *ptr_infolist;
     struct t_infolist_item *ptr_item;
     struct t_infolist_var *ptr_var;
+    int i;
 
     for (ptr_infolist = weechat_infolists; ptr_infolist;
          ptr_infolist = ptr_infolist->next_infolist)
@@ -722,9 +793,16 @@ infolist_print_log ()
         log_printf ("");
         log_printf ("[infolist (addr:0x%lx)]", ptr_infolist);
         log_printf ("  plugin . . . . . . . . : 0x%lx", ptr_infolist->plugin);
+        log_printf ("  memory_tag . . . . . . : 0x%lx", ptr_infolist->memory_tag);
         log_printf ("  items. . . . . . . . . : 0x%lx", ptr_infolist->items);
         log_printf ("  last_item. . . . . . . : 0x%lx", ptr_infolist->last_item);
         log_printf ("  ptr_item . . . . . . . : 0x%lx", ptr_infolist->ptr_item);
+        log_printf ("  schema . . . . . . . . : 0x%lx", ptr_infolist->schema);
+        log_printf ("  schema_count . . . . . : %d",    ptr_infolist->schema_count);
+        log_printf ("  schema_size. . . . . . : %d",    ptr_infolist->schema_size);
+        log_printf ("  schema_index . . . . . : 0x%lx", ptr_infolist->schema_index);
+        log_printf ("  schema_fields. . . . . : '%s'",  ptr_infolist->schema_fields);
+        log_printf ("  schema_fields_count. . : %d",    ptr_infolist->schema_fields_count);
         log_printf ("  prev_infolist. . . . . : 0x%lx", ptr_infolist->prev_infolist);
         log_printf ("  next_infolist. . . . . : 0x%lx", ptr_infolist->next_infolist);
 
@@ -733,39 +811,41 @@ infolist_print_log ()
         {
             log_printf ("");
             log_printf ("    [item (addr:0x%lx)]", ptr_item);
+            log_printf ("      infolist . . . . . . . : 0x%lx", ptr_item->infolist);
             log_printf ("      vars . . . . . . . . . : 0x%lx", ptr_item->vars);
-            log_printf ("      last_var . . . . . . . : 0x%lx", ptr_item->last_var);
+            log_printf ("      vars_count . . . . . . : %d",    ptr_item->vars_count);
+            log_printf ("      vars_size. . . . . . . : %d",    ptr_item->vars_size);
+            log_printf ("      vars_in_schema_order . : %d",    ptr_item->vars_in_schema_order);
             log_printf ("      prev_item. . . . . . . : 0x%lx", ptr_item->prev_item);
             log_printf ("      next_item. . . . . . . : 0x%lx", ptr_item->next_item);
 
-            for (ptr_var = ptr_item->vars; ptr_var;
-                 ptr_var = ptr_var->next_var)
+            for (i = 0; i < ptr_item->vars_count; i++)
             {
+                ptr_var = &ptr_item->vars[i];
                 log_printf ("");
                 log_printf ("      [var (addr:0x%lx)]", ptr_var);
                 log_printf ("        name . . . . . . . . : '%s'", ptr_var->name);
+                log_printf ("        index. . . . . . . . : %d",   ptr_var->index);
                 log_printf ("        type . . . . . . . . : %d",   ptr_var->type);
                 switch (ptr_var->type)
                 {
                     case INFOLIST_INTEGER:
-                        log_printf ("        value (integer). . . : %d",    *((int *)ptr_var->value));
+                        log_printf ("        value (integer). . . : %d",    ptr_var->value.integer);
                         break;
                     case INFOLIST_STRING:
-                        log_printf ("        value (string) . . . : '%s'",  (char *)ptr_var->value);
+                        log_printf ("        value (string) . . . : '%s'",  ptr_var->value.string);
                         break;
                     case INFOLIST_POINTER:
-                        log_printf ("        value (pointer). . . : 0x%lx", ptr_var->value);
+                        log_printf ("        value (pointer). . . : 0x%lx", ptr_var->value.pointer);
                         break;
                     case INFOLIST_BUFFER:
-                        log_printf ("        value (buffer) . . . : 0x%lx", ptr_var->value);
+                        log_printf ("        value (buffer) . . . : 0x%lx", ptr_var->value.pointer);
                         log_printf ("        size of buffer . . . : %d",    ptr_var->size);
                         break;
                     case INFOLIST_TIME:
-                        log_printf ("        value (time) . . . . : %ld", *((time_t *)ptr_var->value));
+                        log_printf ("        value (time) . . . . : %ld", ptr_var->value.time);
                         break;
                 }
-                log_printf ("        prev_var . . . . . . : 0x%lx", ptr_var->prev_var);
-                log_printf ("        next_var . . . . . . : 0x%lx", ptr_var->next_var);
             }
         }
     }
@@ -20,6 +20,11 @@
 #ifndef WEECHAT_INFOLIST_H
 #define WEECHAT_INFOLIST_H 1
 
+#include <time.h>
+
+struct t_hashtable;
+struct t_memory_tag;
+
 /* list structures */
 
 enum t_infolist_type
@@ -31,20 +36,47 @@ enum t_infolist_type
     INFOLIST_TIME,
 };
 
+/*
+ * Variables of items are stored in an array (one per item), and names of
+ * variables are shared by all items of infolist: the infolist has a schema
+ * (list of names/types, built with the first item), and each variable has
+ * the index of its name in schema.
+ *
+ * A hashtable (name -> index in schema) is built on first search of a
+ * variable, so that the search of a variable in an item is fast:
+ * in most cases, all items have the same variables, in the same order as
+ * schema, so the variable is directly read at index in array.
+ */
+
 struct t_infolist_var
 {
-    char *name;                        /* variable name                     */
+    char *name;                        /* variable name (in schema)         */
+    int index;                         /* index of variable in schema       */
     enum t_infolist_type type;         /* type: int, string, ...            */
-    void *value;                       /* pointer to value                  */
+    union
+    {
+        int integer;                   /* value for type integer            */
+        char *string;                  /* value for type string             */
+        void *pointer;                 /* value for type pointer/buffer     */
+        time_t time;                   /* value for type time               */
+    } value;                           /* value of variable                 */
     int size;                          /* for type buffer                   */
-    struct t_infolist_var *prev_var;   /* link to previous variable         */
-    struct t_infolist_var *next_var;   /* link to next variable             */
+};
+
+struct t_infolist_schema_var
+{
+    char *name;                        /* variable name                     */
+    enum t_infolist_type type;         /* type: int, string, ...            */
 };
 
 struct t_infolist_item
 {
+    struct t_infolist *infolist;       /* infolist containing this item     */
     struct t_infolist_var *vars;       /* item variables                    */
-    struct t_infolist_var *last_var;   /* last variable                     */
+    int vars_count;                    /* number of variables               */
+    int vars_size;                     /* size of array "vars"              */
+    int vars_in_schema_order;          /* 1 if variables have same order    */
+                                       /* and types as in schema            */
     char *fields;                      /* fields list (NULL if never asked) */
     struct t_infolist_item *prev_item; /* link to previous item             */
     struct t_infolist_item *next_item; /* link to next item                 */
@@ -54,9 +86,19 @@ struct t_infolist
 {
     struct t_weechat_plugin *plugin;   /* plugin which created this infolist*/
                                        /* (NULL if created by WeeChat)      */
+    struct t_memory_tag *memory_tag;   /* tag for memory accounting         */
     struct t_infolist_item *items;     /* link to items                     */
     struct t_infolist_item *last_item; /* last variable                     */
     struct t_infolist_item *ptr_item;  /* pointer to current item           */
+    struct t_infolist_schema_var *schema; /* names/types of variables       */
+    int schema_count;                  /* number of variables in schema     */
+    int schema_size;                   /* size of array "schema"            */
+    struct t_hashtable *schema_index;  /* name -> index in schema (built    */
+                                       /* on first search of a variable)    */
+    char *schema_fields;               /* fields list shared by items with  */
+                                       /* vars in schema order (NULL if     */
+                                       /* never asked)                      */
+    int schema_fields_count;           /* number of vars in schema_fields   */
     struct t_infolist *prev_infolist;  /* link to previous list             */
     struct t_infolist *next_infolist;  /* link to next list                 */
 };
@@ -0,0 +1,371 @@
+/*
+ * wee-memory.c - accounting of memory allocated per plugin and subsystem
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Memory accounting is enabled at startup (option
+ * weechat.startup.memory_accounting). When it is disabled, function
+ * memory_tag_get returns NULL and the wrappers below only call malloc/free.
+ *
+ * The tag must be resolved when the owner of allocations is created and kept
+ * in the owner (for example a buffer or a hashtable), so that a block is
+ * always freed with the tag used to allocate it.
+ *
+ * The size of blocks is read with malloc_usable_size (when available), so
+ * that no header is added to blocks and the size does not have to be given
+ * when a block is freed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_MALLOC_USABLE_SIZE
+#include <malloc.h>
+#endif
+
+#include "weechat.h"
+#include "wee-memory.h"
+#include "wee-config.h"
+#include "wee-infolist.h"
+#include "wee-log.h"
+#include "../plugins/plugin.h"
+
+
+#ifdef HAVE_MALLOC_USABLE_SIZE
+#define MEMORY_SIZE(__pointer) ((long long)malloc_usable_size (__pointer))
+#else
+#define MEMORY_SIZE(__pointer) 0
+#endif
+
+int memory_accounting = 0;             /* 1 if memory accounting enabled    */
+struct t_memory_tag *memory_tags = NULL;     /* list of tags                */
+struct t_memory_tag *last_memory_tag = NULL; /* last tag                    */
+
+
+/*
+ * Searches a tag, or creates it if not found (tags are sorted by plugin name
+ * and name).
+ *
+ * If plugin_name is NULL, "core" is used.
+ *
+ * Returns pointer to tag, NULL if memory accounting is disabled or if error.
+ */
+
+struct t_memory_tag *
+memory_tag_get (const char *plugin_name, const char *name)
+{
+    struct t_memory_tag *ptr_tag, *new_tag;
+    int rc;
+
+    if (!memory_accounting || !name)
+        return NULL;
+
+    if (!plugin_name)
+        plugin_name = PLUGIN_CORE;
+
+    for (ptr_tag = memory_tags; ptr_tag; ptr_tag = ptr_tag->next_tag)
+    {
+        rc = strcmp (ptr_tag->plugin_name, plugin_name);
+        if (rc == 0)
+            rc = strcmp (ptr_tag->name, name);
+        if (rc == 0)
+            return ptr_tag;
+        if (rc > 0)
+            break;
+    }
+
+    new_tag = malloc (sizeof (*new_tag));
+    if (!new_tag)
+        return NULL;
+    new_tag->plugin_name = strdup (plugin_name);
+    new_tag->name = strdup (name);
+    if (!new_tag->plugin_name || !new_tag->name)
+    {
+        if (new_tag->plugin_name)
+            free (new_tag->plugin_name);
+        if (new_tag->name)
+            free (new_tag->name);
+        free (new_tag);
+        return NULL;
+    }
+    new_tag->objects = 0;
+    new_tag->bytes = 0;
+    new_tag->bytes_peak = 0;
+
+    /* insert tag before ptr_tag (or at the end if ptr_tag is NULL) */
+    if (ptr_tag)
+    {
+        new_tag->prev_tag = ptr_tag->prev_tag;
+        new_tag->next_tag = ptr_tag;
+        if (ptr_tag->prev_tag)
+            (ptr_tag->prev_tag)->next_tag = new_tag;
+        else
+            memory_tags = new_tag;
+        ptr_tag->prev_tag = new_tag;
+    }
+    else
+    {
+        new_tag->prev_tag = last_memory_tag;
+        new_tag->next_tag = NULL;
+        if (last_memory_tag)
+            last_memory_tag->next_tag = new_tag;
+        else
+            memory_tags = new_tag;
+        last_memory_tag = new_tag;
+    }
+
+    return new_tag;
+}
+
+/*
+ * Searches a tag for a plugin (NULL for core), or creates it if not found.
+ *
+ * Returns pointer to tag, NULL if memory accounting is disabled or if error.
+ */
+
+struct t_memory_tag *
+memory_tag_get_plugin (struct t_weechat_plugin *plugin, const char *name)
+{
+    if (!memory_accounting)
+        return NULL;
+
+    return memory_tag_get (plugin_get_name (plugin), name);
+}
+
+/*
+ * Adds a block to a tag.
+ */
+
+void
+memory_tag_add (struct t_memory_tag *tag, void *pointer)
+{
+    tag->objects++;
+    tag->bytes += MEMORY_SIZE(pointer);
+    if (tag->bytes > tag->bytes_peak)
+        tag->bytes_peak = tag->bytes;
+}
+
+/*
+ * Allocates a block of memory, counted in tag (if not NULL).
+ */
+
+void *
+memory_malloc (struct t_memory_tag *tag, size_t size)
+{
+    void *pointer;
+
+    pointer = malloc (size);
+    if (pointer && tag)
+        memory_tag_add (tag, pointer);
+
+    return pointer;
+}
+
+/*
+ * Reallocates a block of memory, counted in tag (if not NULL).
+ *
+ * The block must have been allocated with the same tag (or pointer is NULL).
+ */
+
+void *
+memory_realloc (struct t_memory_tag *tag, void *pointer, size_t size)
+{
+    void *new_pointer;
+    long long old_size;
+
+    if (!tag)
+        return realloc (pointer, size);
+
+    old_size = (pointer) ? MEMORY_SIZE(pointer) : 0;
+    new_pointer = realloc (pointer, size);
+    if (!new_pointer)
+        return NULL;
+
+    if (!pointer)
+    {
+        memory_tag_add (tag, new_pointer);
+    }
+    else
+    {
+        tag->bytes += MEMORY_SIZE(new_pointer) - old_size;
+        if (tag->bytes > tag->bytes_peak)
+            tag->bytes_peak = tag->bytes;
+    }
+
+    return new_pointer;
+}
+
+/*
+ * Duplicates a string, counted in tag (if not NULL).
+ */
+
+char *
+memory_strdup (struct t_memory_tag *tag, const char *string)
+{
+    char *new_string;
+    size_t length;
+
+    if (!string)
+        return NULL;
+
+    if (!tag)
+        return strdup (string);
+
+    length = strlen (string) + 1;
+    new_string = memory_malloc (tag, length);
+    if (new_string)
+        memcpy (new_string, string, length);
+
+    return new_string;
+}
+
+/*
+ * Frees a block of memory allocated with the same tag (or with a NULL tag).
+ */
+
+void
+memory_free (struct t_memory_tag *tag, void *pointer)
+{
+    if (!pointer)
+        return;
+
+    if (tag)
+    {
+        tag->objects--;
+        tag->bytes -= MEMORY_SIZE(pointer);
+    }
+
+    free (pointer);
+}
+
+/*
+ * Computes total of objects/bytes for a plugin (or all tags if plugin_name
+ * is NULL).
+ */
+
+void
+memory_tags_total (const char *plugin_name, long *objects, long long *bytes)
+{
+    struct t_memory_tag *ptr_tag;
+
+    *objects = 0;
+    *bytes = 0;
+
+    for (ptr_tag = memory_tags; ptr_tag; ptr_tag = ptr_tag->next_tag)
+    {
+        if (!plugin_name || (strcmp (ptr_tag->plugin_name, plugin_name) == 0))
+        {
+            *objects += ptr_tag->objects;
+            *bytes += ptr_tag->bytes;
+        }
+    }
+}
+
+/*
+ * Adds a tag in an infolist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+memory_add_to_infolist (struct t_infolist *infolist, struct t_memory_tag *tag)
+{
+    struct t_infolist_item *ptr_item;
+    char value[32];
+
+    if (!infolist || !tag)
+        return 0;
+
+    ptr_item = infolist_new_item (infolist);
+    if (!ptr_item)
+        return 0;
+
+    if (!infolist_new_var_string (ptr_item, "plugin_name", tag->plugin_name))
+        return 0;
+    if (!infolist_new_var_string (ptr_item, "name", tag->name))
+        return 0;
+    if (!infolist_new_var_integer (ptr_item, "objects", tag->objects))
+        return 0;
+    /* bytes are stored as strings (they may not fit in an integer) */
+    snprintf (value, sizeof (value), "%lld", tag->bytes);
+    if (!infolist_new_var_string (ptr_item, "bytes", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lld", tag->bytes_peak);
+    if (!infolist_new_var_string (ptr_item, "bytes_peak", value))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Prints memory tags in WeeChat log file (usually for crash dump).
+ */
+
+void
+memory_print_log ()
+{
+    struct t_memory_tag *ptr_tag;
+
+    log_printf ("");
+    log_printf ("[memory accounting (enabled: %d)]", memory_accounting);
+    for (ptr_tag = memory_tags; ptr_tag; ptr_tag = ptr_tag->next_tag)
+    {
+        log_printf ("  %s/%s: objects: %ld, bytes: %lld, bytes_peak: %lld",
+                    ptr_tag->plugin_name, ptr_tag->name, ptr_tag->objects,
+                    ptr_tag->bytes, ptr_tag->bytes_peak);
+    }
+}
+
+/*
+ * Initializes memory accounting (called after read of WeeChat options).
+ */
+
+void
+memory_init ()
+{
+    memory_accounting = CONFIG_BOOLEAN(config_startup_memory_accounting);
+}
+
+/*
+ * Frees all memory tags.
+ */
+
+void
+memory_end ()
+{
+    struct t_memory_tag *ptr_next_tag;
+
+    while (memory_tags)
+    {
+        ptr_next_tag = memory_tags->next_tag;
+        free (memory_tags->plugin_name);
+        free (memory_tags->name);
+        free (memory_tags);
+        memory_tags = ptr_next_tag;
+    }
+    last_memory_tag = NULL;
+    memory_accounting = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_MEMORY_H
+#define WEECHAT_MEMORY_H 1
+
+#include <stddef.h>
+
+struct t_infolist;
+struct t_weechat_plugin;
+
+/*
+ * tag for memory accounting: live objects/bytes allocated by a subsystem
+ * (tags are never freed, so pointers can be kept in structures)
+ */
+
+struct t_memory_tag
+{
+    char *plugin_name;                 /* plugin name ("core" for WeeChat)  */
+    char *name;                        /* tag name (subsystem)              */
+    long objects;                      /* number of live objects            */
+    long long bytes;                   /* number of live bytes (0 if size   */
+                                       /* of blocks is not available)       */
+    long long bytes_peak;              /* max value of "bytes"              */
+    struct t_memory_tag *prev_tag;     /* link to previous tag              */
+    struct t_memory_tag *next_tag;     /* link to next tag                  */
+};
+
+/* memory variables */
+
+extern int memory_accounting;
+extern struct t_memory_tag *memory_tags;
+extern struct t_memory_tag *last_memory_tag;
+
+/* memory functions */
+
+extern struct t_memory_tag *memory_tag_get (const char *plugin_name,
+                                            const char *name);
+extern struct t_memory_tag *memory_tag_get_plugin (struct t_weechat_plugin *plugin,
+                                                   const char *name);
+extern void *memory_malloc (struct t_memory_tag *tag, size_t size);
+extern void *memory_realloc (struct t_memory_tag *tag, void *pointer,
+                             size_t size);
+extern char *memory_strdup (struct t_memory_tag *tag, const char *string);
+extern void memory_free (struct t_memory_tag *tag, void *pointer);
+extern void memory_tags_total (const char *plugin_name, long *objects,
+                               long long *bytes);
+extern int memory_add_to_infolist (struct t_infolist *infolist,
+                                   struct t_memory_tag *tag);
+extern void memory_print_log ();
+extern void memory_init ();
+extern void memory_end ();
+
+#endif /* WEECHAT_MEMORY_H */
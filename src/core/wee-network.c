@@ -26,10 +26,8 @@
 #include "config.h"
 #endif
 
-/* _XPG4_2 is needed on SunOS for macros like CMSG_SPACE */
 /* __EXTENSIONS__ is needed on SunOS for constants like NI_MAXHOST */
 #ifdef __sun
-#define _XPG4_2
 #define __EXTENSIONS__
 #endif
 
@@ -44,10 +42,6 @@
 #include <netdb.h>
 #include <errno.h>
 #include <gcrypt.h>
-#include <sys/time.h>
-#if defined(__OpenBSD__)
-#include <sys/uio.h>
-#endif
 
 #ifdef HAVE_GNUTLS
 #include <gnutls/gnutls.h>
@@ -59,6 +53,7 @@
 #include "wee-hook.h"
 #include "wee-config.h"
 #include "wee-proxy.h"
+#include "wee-resolve.h"
 #include "wee-string.h"
 #include "../plugins/plugin.h"
 
@@ -69,6 +64,8 @@ int network_init_gnutls_ok = 0;
 gnutls_certificate_credentials_t gnutls_xcred; /* GnuTLS client credentials */
 #endif
 
+void network_connect_attempt_next (struct t_hook *hook_connect);
+
 
 /*
  * Initializes gcrypt.
@@ -231,69 +228,6 @@ network_recv_with_retry (int sock, void *buffer, int length, int flags)
     return total_recv;
 }
 
-/*
- * Establishes a connection and authenticates with a HTTP proxy.
- *
- * WARNING: this function is blocking, it must be called only in a forked
- * process.
- *
- * Returns:
- *   1: OK
- *   0: error
- */
-
-int
-network_pass_httpproxy (struct t_proxy *proxy, int sock, const char *address,
-                        int port)
-{
-    char buffer[256], authbuf[128], authbuf_base64[512], *username, *password;
-    int length;
-
-    if (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])
-        && CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])[0])
-    {
-        /* authentication */
-        username = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
-                                    NULL, NULL, NULL);
-        if (!username)
-            return 0;
-        password = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_PASSWORD]),
-                                    NULL, NULL, NULL);
-        if (!password)
-        {
-            free (username);
-            return 0;
-        }
-        snprintf (authbuf, sizeof (authbuf), "%s:%s", username, password);
-        free (username);
-        free (password);
-        string_encode_base64 (authbuf, strlen (authbuf), authbuf_base64);
-        length = snprintf (buffer, sizeof (buffer),
-                           "CONNECT %s:%d HTTP/1.0\r\nProxy-Authorization: "
-                           "Basic %s\r\n\r\n",
-                           address, port, authbuf_base64);
-    }
-    else
-    {
-        /* no authentication */
-        length = snprintf (buffer, sizeof (buffer),
-                           "CONNECT %s:%d HTTP/1.0\r\n\r\n", address, port);
-    }
-
-    if (network_send_with_retry (sock, buffer, length, 0) != length)
-        return 0;
-
-    /* success result must be like: "HTTP/1.0 200 OK" */
-    if (network_recv_with_retry (sock, buffer, sizeof (buffer), 0) < 12)
-        return 0;
-
-    if (memcmp (buffer, "HTTP/", 5) || memcmp (buffer + 9, "200", 3))
-        return 0;
-
-    /* connection OK */
-    return 1;
-}
-
 /*
  * Resolves a hostname to its IP address (works with IPv4 and IPv6).
  *
@@ -340,225 +274,333 @@ network_resolve (const char *hostname, char *ip, int *version)
 }
 
 /*
- * Establishes a connection and authenticates with a socks4 proxy.
- *
- * The socks4 protocol is explained here: http://en.wikipedia.org/wiki/SOCKS
- *
- * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * Creates a dialog with a proxy, to connect to address/port.
  *
- * Returns:
- *   1: OK
- *   0: error
+ * Returns pointer to new dialog, NULL if error.
  */
 
-int
-network_pass_socks4proxy (struct t_proxy *proxy, int sock, const char *address,
-                          int port)
+struct t_network_proxy_dialog *
+network_proxy_dialog_new (struct t_proxy *proxy, const char *address, int port)
 {
-    struct t_network_socks4 socks4;
-    unsigned char buffer[24];
-    char ip_addr[NI_MAXHOST], *username;
-    int length;
-
-    username = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
-                                NULL, NULL, NULL);
-    if (!username)
-        return 0;
-
-    socks4.version = 4;
-    socks4.method = 1;
-    socks4.port = htons (port);
-    network_resolve (address, ip_addr, NULL);
-    socks4.address = inet_addr (ip_addr);
-    strncpy (socks4.user, username, sizeof (socks4.user) - 1);
+    struct t_network_proxy_dialog *new_dialog;
+    const char *ptr_username, *ptr_password;
+
+    if (!proxy || !address)
+        return NULL;
+
+    new_dialog = malloc (sizeof (*new_dialog));
+    if (!new_dialog)
+        return NULL;
+
+    ptr_username = CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]);
+    ptr_password = CONFIG_STRING(proxy->options[PROXY_OPTION_PASSWORD]);
+
+    new_dialog->type = CONFIG_INTEGER(proxy->options[PROXY_OPTION_TYPE]);
+    new_dialog->username = eval_expression ((ptr_username) ? ptr_username : "",
+                                            NULL, NULL, NULL);
+    new_dialog->password = eval_expression ((ptr_password) ? ptr_password : "",
+                                            NULL, NULL, NULL);
+    new_dialog->address = strdup (address);
+    new_dialog->port = port;
+    new_dialog->ipv4 = INADDR_NONE;
+    new_dialog->step = 0;
+    new_dialog->send_length = 0;
+    new_dialog->send_pos = 0;
+    new_dialog->recv_min = 0;
+    new_dialog->recv_max = 0;
+    new_dialog->recv_length = 0;
+
+    if (!new_dialog->username || !new_dialog->password
+        || !new_dialog->address)
+    {
+        network_proxy_dialog_free (new_dialog);
+        return NULL;
+    }
 
-    free (username);
+    return new_dialog;
+}
 
-    length = 8 + strlen (socks4.user) + 1;
-    if (network_send_with_retry (sock, (char *) &socks4, length, 0) != length)
-        return 0;
+/*
+ * Sets next step of a dialog with a proxy: data to send (already in buffer)
+ * and data to receive.
+ *
+ * Returns NETWORK_PROXY_DIALOG_CONTINUE.
+ */
 
-    if (network_recv_with_retry (sock, buffer, sizeof (buffer), 0) < 2)
-        return 0;
+int
+network_proxy_dialog_next (struct t_network_proxy_dialog *dialog, int step,
+                           int send_length, int recv_min, int recv_max)
+{
+    if (send_length >= NETWORK_PROXY_DIALOG_BUFFER_SIZE)
+        send_length = NETWORK_PROXY_DIALOG_BUFFER_SIZE - 1;
 
-    /* connection OK */
-    if ((buffer[0] == 0) && (buffer[1] == 90))
-        return 1;
+    dialog->step = step;
+    dialog->send_length = send_length;
+    dialog->send_pos = 0;
+    dialog->recv_min = recv_min;
+    dialog->recv_max = recv_max;
+    dialog->recv_length = 0;
 
-    /* connection failed */
-    return 0;
+    return NETWORK_PROXY_DIALOG_CONTINUE;
 }
 
 /*
- * Establishes a connection and authenticates with a socks5 proxy.
- *
- * The socks5 protocol is explained in RFC 1928.
- * The socks5 authentication with username/pass is explained in RFC 1929.
- *
- * WARNING: this function is blocking, it must be called only in a forked
- * process.
+ * Runs next step of dialog with a HTTP proxy.
  *
  * Returns:
- *   1: OK
- *   0: error
+ *   NETWORK_PROXY_DIALOG_CONTINUE: data must be sent/received
+ *   NETWORK_PROXY_DIALOG_OK: connection OK
+ *   NETWORK_PROXY_DIALOG_ERROR: error
  */
 
 int
-network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
-                          int port)
+network_proxy_dialog_step_http (struct t_network_proxy_dialog *dialog)
 {
-    struct t_network_socks5 socks5;
-    unsigned char buffer[288];
-    int username_len, password_len, addr_len, addr_buffer_len;
-    unsigned char *addr_buffer;
-    char *username, *password;
-
-    socks5.version = 5;
-    socks5.nmethods = 1;
-
-    if (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])
-        && CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])[0])
-        socks5.method = 2; /* with authentication */
-    else
-        socks5.method = 0; /* without authentication */
-
-    if (network_send_with_retry (sock, (char *) &socks5, sizeof (socks5), 0) < (int)sizeof (socks5))
-        return 0;
-
-    /* server socks5 must respond with 2 bytes */
-    if (network_recv_with_retry (sock, buffer, 2, 0) < 2)
-        return 0;
+    char authbuf[128], authbuf_base64[512];
+    int length;
 
-    if (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])
-        && CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME])[0])
+    if (dialog->step == 0)
     {
-        /*
-         * with authentication
-         *   -> socks server must respond with :
-         *       - socks version (buffer[0]) = 5 => socks5
-         *       - socks method  (buffer[1]) = 2 => authentication
-         */
-
-        if (buffer[0] != 5 || buffer[1] != 2)
-            return 0;
-
-        /* authentication as in RFC 1929 */
-        username = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_USERNAME]),
-                                    NULL, NULL, NULL);
-        if (!username)
-            return 0;
-        password = eval_expression (CONFIG_STRING(proxy->options[PROXY_OPTION_PASSWORD]),
-                                    NULL, NULL, NULL);
-        if (!password)
+        if (dialog->username[0])
+        {
+            /* authentication */
+            snprintf (authbuf, sizeof (authbuf), "%s:%s",
+                      dialog->username, dialog->password);
+            string_encode_base64 (authbuf, strlen (authbuf), authbuf_base64);
+            length = snprintf ((char *)dialog->buffer, sizeof (dialog->buffer),
+                               "CONNECT %s:%d HTTP/1.0\r\nProxy-Authorization: "
+                               "Basic %s\r\n\r\n",
+                               dialog->address, dialog->port, authbuf_base64);
+        }
+        else
         {
-            free (username);
-            return 0;
+            /* no authentication */
+            length = snprintf ((char *)dialog->buffer, sizeof (dialog->buffer),
+                               "CONNECT %s:%d HTTP/1.0\r\n\r\n",
+                               dialog->address, dialog->port);
         }
-        username_len = strlen (username);
-        password_len = strlen (password);
+        return network_proxy_dialog_next (dialog, 1, length, 12, 256);
+    }
 
-        /* make username/password buffer */
-        buffer[0] = 1;
-        buffer[1] = (unsigned char) username_len;
-        memcpy (buffer + 2, username, username_len);
-        buffer[2 + username_len] = (unsigned char) password_len;
-        memcpy (buffer + 3 + username_len, password, password_len);
+    /* success result must be like: "HTTP/1.0 200 OK" */
+    if (memcmp (dialog->buffer, "HTTP/", 5)
+        || memcmp (dialog->buffer + 9, "200", 3))
+    {
+        return NETWORK_PROXY_DIALOG_ERROR;
+    }
 
-        free (username);
-        free (password);
+    /* connection OK */
+    return NETWORK_PROXY_DIALOG_OK;
+}
 
-        if (network_send_with_retry (sock, buffer, 3 + username_len + password_len, 0) < 3 + username_len + password_len)
-            return 0;
+/*
+ * Runs next step of dialog with a socks4 proxy.
+ *
+ * The socks4 protocol is explained here: http://en.wikipedia.org/wiki/SOCKS
+ *
+ * Returns:
+ *   NETWORK_PROXY_DIALOG_CONTINUE: data must be sent/received
+ *   NETWORK_PROXY_DIALOG_OK: connection OK
+ *   NETWORK_PROXY_DIALOG_ERROR: error
+ */
 
-        /* server socks5 must respond with 2 bytes */
-        if (network_recv_with_retry (sock, buffer, 2, 0) < 2)
-            return 0;
+int
+network_proxy_dialog_step_socks4 (struct t_network_proxy_dialog *dialog)
+{
+    struct t_network_socks4 socks4;
+    int length;
 
-        /* buffer[1] = auth state, must be 0 for success */
-        if (buffer[1] != 0)
-            return 0;
-    }
-    else
+    if (dialog->step == 0)
     {
-        /*
-         * without authentication
-         *   -> socks server must respond with :
-         *       - socks version (buffer[0]) = 5 => socks5
-         *       - socks method  (buffer[1]) = 0 => no authentication
-         */
-        if (!((buffer[0] == 5) && (buffer[1] == 0)))
-            return 0;
+        memset (&socks4, 0, sizeof (socks4));
+        socks4.version = 4;
+        socks4.method = 1;
+        socks4.port = htons (dialog->port);
+        socks4.address = dialog->ipv4;
+        strncpy (socks4.user, dialog->username, sizeof (socks4.user) - 1);
+        length = 8 + strlen (socks4.user) + 1;
+        memcpy (dialog->buffer, &socks4, length);
+        return network_proxy_dialog_next (dialog, 1, length, 8, 8);
     }
 
-    /* authentication successful then giving address/port to connect */
-    addr_len = strlen(address);
-    addr_buffer_len = 4 + 1 + addr_len + 2;
-    addr_buffer = malloc (addr_buffer_len * sizeof(*addr_buffer));
-    if (!addr_buffer)
-        return 0;
-    addr_buffer[0] = 5;   /* version 5 */
-    addr_buffer[1] = 1;   /* command: 1 for connect */
-    addr_buffer[2] = 0;   /* reserved */
-    addr_buffer[3] = 3;   /* address type : ipv4 (1), domainname (3), ipv6 (4) */
-    addr_buffer[4] = (unsigned char) addr_len;
-    memcpy (addr_buffer + 5, address, addr_len); /* server address */
-    *((unsigned short *) (addr_buffer + 5 + addr_len)) = htons (port); /* server port */
-
-    if (network_send_with_retry (sock, addr_buffer, addr_buffer_len, 0) < addr_buffer_len)
-    {
-        free (addr_buffer);
-        return 0;
-    }
-    free (addr_buffer);
+    /* connection OK */
+    if ((dialog->buffer[0] == 0) && (dialog->buffer[1] == 90))
+        return NETWORK_PROXY_DIALOG_OK;
 
-    /* dialog with proxy server */
-    if (network_recv_with_retry (sock, buffer, 4, 0) < 4)
-        return 0;
+    /* connection failed */
+    return NETWORK_PROXY_DIALOG_ERROR;
+}
 
-    if (!((buffer[0] == 5) && (buffer[1] == 0)))
-        return 0;
+/*
+ * Runs next step of dialog with a socks5 proxy.
+ *
+ * The socks5 protocol is explained in RFC 1928.
+ * The socks5 authentication with username/pass is explained in RFC 1929.
+ *
+ * Returns:
+ *   NETWORK_PROXY_DIALOG_CONTINUE: data must be sent/received
+ *   NETWORK_PROXY_DIALOG_OK: connection OK
+ *   NETWORK_PROXY_DIALOG_ERROR: error
+ */
+
+int
+network_proxy_dialog_step_socks5 (struct t_network_proxy_dialog *dialog)
+{
+    struct t_network_socks5 socks5;
+    unsigned char *buffer;
+    unsigned short port;
+    int username_len, password_len, addr_len;
+
+    buffer = dialog->buffer;
 
-    /* buffer[3] = address type */
-    switch (buffer[3])
+    switch (dialog->step)
     {
+        case 0:
+            socks5.version = 5;
+            socks5.nmethods = 1;
+            socks5.method = (dialog->username[0]) ?
+                2 : /* with authentication */
+                0;  /* without authentication */
+            memcpy (buffer, &socks5, sizeof (socks5));
+            /* server socks5 must respond with 2 bytes */
+            return network_proxy_dialog_next (dialog, 1, sizeof (socks5),
+                                              2, 2);
         case 1:
+            if (dialog->username[0])
+            {
+                /*
+                 * with authentication
+                 *   -> socks server must respond with :
+                 *       - socks version (buffer[0]) = 5 => socks5
+                 *       - socks method  (buffer[1]) = 2 => authentication
+                 */
+                if ((buffer[0] != 5) || (buffer[1] != 2))
+                    return NETWORK_PROXY_DIALOG_ERROR;
+
+                /* authentication as in RFC 1929 */
+                username_len = strlen (dialog->username);
+                if (username_len > 255)
+                    username_len = 255;
+                password_len = strlen (dialog->password);
+                if (password_len > 255)
+                    password_len = 255;
+                buffer[0] = 1;
+                buffer[1] = (unsigned char) username_len;
+                memcpy (buffer + 2, dialog->username, username_len);
+                buffer[2 + username_len] = (unsigned char) password_len;
+                memcpy (buffer + 3 + username_len, dialog->password,
+                        password_len);
+                /* server socks5 must respond with 2 bytes */
+                return network_proxy_dialog_next (
+                    dialog, 2, 3 + username_len + password_len, 2, 2);
+            }
             /*
-             * ipv4
-             * server socks return server bound address and port
-             * address of 4 bytes and port of 2 bytes (= 6 bytes)
+             * without authentication
+             *   -> socks server must respond with :
+             *       - socks version (buffer[0]) = 5 => socks5
+             *       - socks method  (buffer[1]) = 0 => no authentication
              */
-            if (network_recv_with_retry (sock, buffer, 6, 0) < 6)
-                return 0;
+            if (!((buffer[0] == 5) && (buffer[1] == 0)))
+                return NETWORK_PROXY_DIALOG_ERROR;
+            break;
+        case 2:
+            /* buffer[1] = auth state, must be 0 for success */
+            if (buffer[1] != 0)
+                return NETWORK_PROXY_DIALOG_ERROR;
             break;
         case 3:
+            if (!((buffer[0] == 5) && (buffer[1] == 0)))
+                return NETWORK_PROXY_DIALOG_ERROR;
             /*
-             * domainname
-             * server socks return server bound address and port
+             * buffer[3] = address type; server socks returns server bound
+             * address and port (2 bytes)
              */
-            /* read address length */
-            if (network_recv_with_retry (sock, buffer, 1, 0) < 1)
-                return 0;
-            addr_len = buffer[0];
-            /* read address + port = addr_len + 2 */
-            if (network_recv_with_retry (sock, buffer, addr_len + 2, 0) < addr_len + 2)
-                return 0;
-            break;
+            switch (buffer[3])
+            {
+                case 1:
+                    /* ipv4: address of 4 bytes */
+                    return network_proxy_dialog_next (dialog, 5, 0, 6, 6);
+                case 3:
+                    /* domainname: read address length */
+                    return network_proxy_dialog_next (dialog, 4, 0, 1, 1);
+                case 4:
+                    /* ipv6: address of 16 bytes */
+                    return network_proxy_dialog_next (dialog, 5, 0, 18, 18);
+            }
+            return NETWORK_PROXY_DIALOG_ERROR;
         case 4:
-            /*
-             * ipv6
-             * server socks return server bound address and port
-             * address of 16 bytes and port of 2 bytes (= 18 bytes)
-             */
-            if (network_recv_with_retry (sock, buffer, 18, 0) < 18)
-                return 0;
-            break;
+            /* domainname: read address + port */
+            addr_len = buffer[0];
+            return network_proxy_dialog_next (dialog, 5, 0,
+                                              addr_len + 2, addr_len + 2);
         default:
-            return 0;
+            /* connection OK */
+            return NETWORK_PROXY_DIALOG_OK;
     }
 
-    /* connection OK */
-    return 1;
+    /* authentication successful then giving address/port to connect */
+    addr_len = strlen (dialog->address);
+    if (addr_len > 255)
+        addr_len = 255;
+    buffer[0] = 5;   /* version 5 */
+    buffer[1] = 1;   /* command: 1 for connect */
+    buffer[2] = 0;   /* reserved */
+    buffer[3] = 3;   /* address type : ipv4 (1), domainname (3), ipv6 (4) */
+    buffer[4] = (unsigned char) addr_len;
+    memcpy (buffer + 5, dialog->address, addr_len); /* server address */
+    port = htons (dialog->port);
+    memcpy (buffer + 5 + addr_len, &port, 2); /* server port */
+
+    return network_proxy_dialog_next (dialog, 3, 4 + 1 + addr_len + 2, 4, 4);
+}
+
+/*
+ * Runs next step of dialog with a proxy: reads data received (if step > 0)
+ * and builds data to send.
+ *
+ * Returns:
+ *   NETWORK_PROXY_DIALOG_CONTINUE: data must be sent/received
+ *   NETWORK_PROXY_DIALOG_OK: connection OK
+ *   NETWORK_PROXY_DIALOG_ERROR: error
+ */
+
+int
+network_proxy_dialog_step (struct t_network_proxy_dialog *dialog)
+{
+    if (!dialog)
+        return NETWORK_PROXY_DIALOG_ERROR;
+
+    switch (dialog->type)
+    {
+        case PROXY_TYPE_HTTP:
+            return network_proxy_dialog_step_http (dialog);
+        case PROXY_TYPE_SOCKS4:
+            return network_proxy_dialog_step_socks4 (dialog);
+        case PROXY_TYPE_SOCKS5:
+            return network_proxy_dialog_step_socks5 (dialog);
+    }
+
+    return NETWORK_PROXY_DIALOG_ERROR;
+}
+
+/*
+ * Frees a dialog with a proxy.
+ */
+
+void
+network_proxy_dialog_free (struct t_network_proxy_dialog *dialog)
+{
+    if (!dialog)
+        return;
+
+    if (dialog->username)
+        free (dialog->username);
+    if (dialog->password)
+        free (dialog->password);
+    if (dialog->address)
+        free (dialog->address);
+
+    free (dialog);
 }
 
 /*
@@ -575,28 +617,58 @@ network_pass_socks5proxy (struct t_proxy *proxy, int sock, const char *address,
 int
 network_pass_proxy (const char *proxy, int sock, const char *address, int port)
 {
-    int rc;
     struct t_proxy *ptr_proxy;
-
-    rc = 0;
+    struct t_network_proxy_dialog *dialog;
+    char ip_addr[NI_MAXHOST];
+    int rc, num_recv;
 
     ptr_proxy = proxy_search (proxy);
-    if (ptr_proxy)
+    if (!ptr_proxy)
+        return 0;
+
+    dialog = network_proxy_dialog_new (ptr_proxy, address, port);
+    if (!dialog)
+        return 0;
+
+    if (dialog->type == PROXY_TYPE_SOCKS4)
+    {
+        if (network_resolve (address, ip_addr, NULL))
+            dialog->ipv4 = inet_addr (ip_addr);
+    }
+
+    rc = network_proxy_dialog_step (dialog);
+    while (rc == NETWORK_PROXY_DIALOG_CONTINUE)
     {
-        switch (CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_TYPE]))
+        if ((dialog->send_length > 0)
+            && (network_send_with_retry (sock, dialog->buffer,
+                                         dialog->send_length,
+                                         0) != dialog->send_length))
         {
-            case PROXY_TYPE_HTTP:
-                rc = network_pass_httpproxy (ptr_proxy, sock, address, port);
-                break;
-            case PROXY_TYPE_SOCKS4:
-                rc = network_pass_socks4proxy (ptr_proxy, sock, address, port);
-                break;
-            case PROXY_TYPE_SOCKS5:
-                rc = network_pass_socks5proxy (ptr_proxy, sock, address, port);
+            rc = NETWORK_PROXY_DIALOG_ERROR;
+            break;
+        }
+        while (dialog->recv_length < dialog->recv_min)
+        {
+            num_recv = network_recv_with_retry (
+                sock,
+                dialog->buffer + dialog->recv_length,
+                dialog->recv_max - dialog->recv_length,
+                0);
+            if (num_recv <= 0)
                 break;
+            dialog->recv_length += num_recv;
+        }
+        if (dialog->recv_length < dialog->recv_min)
+        {
+            rc = NETWORK_PROXY_DIALOG_ERROR;
+            break;
         }
+        rc = network_proxy_dialog_step (dialog);
     }
-    return rc;
+
+    network_proxy_dialog_free (dialog);
+
+    return (rc == NETWORK_PROXY_DIALOG_OK) ? 1 : 0;
 }
 
 /*
@@ -733,505 +805,46 @@ error:
 }
 
 /*
- * Connects to peer in a child process.
+ * Calls callback of connect hook with an error, then removes the hook.
  */
 
 void
-network_connect_child (struct t_hook *hook_connect)
+network_connect_error (struct t_hook *hook_connect, int status,
+                       const char *error)
 {
-    struct t_proxy *ptr_proxy;
-    struct addrinfo hints, *res_local, *res_remote, *ptr_res, *ptr_loc;
-    char port[NI_MAXSERV + 1];
-    char status_str[2], *ptr_address, *status_with_string;
-    char remote_address[NI_MAXHOST + 1];
-    char status_without_string[1 + 5 + 1];
-    const char *error;
-    int rc, length, num_written;
-    int sock, set, flags;
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-    int j;
-#else
-    struct msghdr msg;
-    struct cmsghdr *cmsg;
-    char msg_buf[CMSG_SPACE(sizeof (sock))];
-    struct iovec iov[1];
-    char iov_data[1] = { 0 };
-#endif
-    /*
-     * indicates that something is wrong with whichever group of
-     * servers is being tried first after connecting, so start at
-     * a different offset to increase the chance of success
-     */
-    int retry, rand_num, i;
-    int num_groups, tmp_num_groups, num_hosts, tmp_host;
-    struct addrinfo **res_reorder;
-    int last_af;
-    struct timeval tv_time;
+    (void) (HOOK_CONNECT(hook_connect, callback))
+        (hook_connect->callback_data, status, 0, -1, error, NULL);
+    unhook (hook_connect);
+}
 
-    res_local = NULL;
-    res_remote = NULL;
-    res_reorder = NULL;
-    port[0] = '\0';
+/*
+ * Timer callback for timeout of connection.
+ */
 
-    status_str[1] = '\0';
-    status_with_string = NULL;
+int
+network_connect_timer_cb (void *arg_hook_connect, int remaining_calls)
+{
+    struct t_hook *hook_connect;
 
-    ptr_address = NULL;
+    /* make C compiler happy */
+    (void) remaining_calls;
 
-    gettimeofday (&tv_time, NULL);
-    srand ((tv_time.tv_sec * tv_time.tv_usec) ^ getpid ());
+    hook_connect = (struct t_hook *)arg_hook_connect;
 
-    ptr_proxy = NULL;
-    if (HOOK_CONNECT(hook_connect, proxy)
-        && HOOK_CONNECT(hook_connect, proxy)[0])
-    {
-        ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
-        if (!ptr_proxy)
-        {
-            /* proxy not found */
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%c00000", '0' + WEECHAT_HOOK_CONNECT_PROXY_ERROR);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-            (void) num_written;
-            goto end;
-        }
-    }
+    HOOK_CONNECT(hook_connect, hook_timer) = NULL;
 
-    /* get info about peer */
-    memset (&hints, 0, sizeof (hints));
-    hints.ai_socktype = SOCK_STREAM;
-#ifdef AI_ADDRCONFIG
-    hints.ai_flags = AI_ADDRCONFIG;
-#endif
-    if (ptr_proxy)
-    {
-        hints.ai_family = (CONFIG_BOOLEAN(ptr_proxy->options[PROXY_OPTION_IPV6])) ?
-            AF_UNSPEC : AF_INET;
-        snprintf (port, sizeof (port), "%d", CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_PORT]));
-        rc = getaddrinfo (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_ADDRESS]),
-                          port, &hints, &res_remote);
-    }
-    else
-    {
-        hints.ai_family = HOOK_CONNECT(hook_connect, ipv6) ? AF_UNSPEC : AF_INET;
-        snprintf (port, sizeof (port), "%d", HOOK_CONNECT(hook_connect, port));
-        rc = getaddrinfo (HOOK_CONNECT(hook_connect, address), port, &hints, &res_remote);
-    }
+    network_connect_error (hook_connect, WEECHAT_HOOK_CONNECT_TIMEOUT, NULL);
 
-    if (rc != 0)
-    {
-        /* address not found */
-        status_with_string = NULL;
-        error = gai_strerror (rc);
-        if (error)
-        {
-            length = 1 + 5 + strlen (error) + 1;
-            status_with_string = malloc (length);
-            if (status_with_string)
-            {
-                snprintf (status_with_string, length, "%c%05d%s",
-                          '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND,
-                          (int)strlen (error), error);
-            }
-        }
-        if (status_with_string)
-        {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_with_string, strlen (status_with_string));
-        }
-        else
-        {
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%c00000", '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-        }
-        (void) num_written;
-        goto end;
-    }
+    return WEECHAT_RC_OK;
+}
 
-    if (!res_remote)
-    {
-        /* address not found */
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
-    }
-
-    /* set local hostname/IP if asked by user */
-    if (HOOK_CONNECT(hook_connect, local_hostname)
-        && HOOK_CONNECT(hook_connect, local_hostname[0]))
-    {
-        memset (&hints, 0, sizeof (hints));
-        hints.ai_family = AF_UNSPEC;
-        hints.ai_socktype = SOCK_STREAM;
-#ifdef AI_ADDRCONFIG
-        hints.ai_flags = AI_ADDRCONFIG;
-#endif
-        rc = getaddrinfo (HOOK_CONNECT(hook_connect, local_hostname),
-                          NULL, &hints, &res_local);
-        if (rc != 0)
-        {
-            /* address not found */
-            status_with_string = NULL;
-            error = gai_strerror (rc);
-            if (error)
-            {
-                length = 1 + 5 + strlen (error) + 1;
-                status_with_string = malloc (length);
-                if (status_with_string)
-                {
-                    snprintf (status_with_string, length, "%c%05d%s",
-                              '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR,
-                              (int)strlen (error), error);
-                }
-            }
-            if (status_with_string)
-            {
-                num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                     status_with_string, strlen (status_with_string));
-            }
-            else
-            {
-                snprintf (status_without_string, sizeof (status_without_string),
-                          "%c00000", '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR);
-                num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                     status_without_string, strlen (status_without_string));
-            }
-            (void) num_written;
-            goto end;
-        }
-
-        if (!res_local)
-        {
-            /* address not found */
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%c00000", '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-            (void) num_written;
-            goto end;
-        }
-    }
-
-    /* res_local != NULL now indicates that bind() is required */
-
-    /*
-     * count all the groups of hosts by tracking family, e.g.
-     * 0 = [2001:db8::1, 2001:db8::2,
-     * 1 =  192.0.2.1, 192.0.2.2,
-     * 2 =  2002:c000:201::1, 2002:c000:201::2]
-     */
-    last_af = AF_UNSPEC;
-    num_groups = 0;
-    num_hosts = 0;
-    for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
-    {
-        if (ptr_res->ai_family != last_af)
-            if (last_af != AF_UNSPEC)
-                num_groups++;
-
-        num_hosts++;
-        last_af = ptr_res->ai_family;
-    }
-    if (last_af != AF_UNSPEC)
-        num_groups++;
-
-    res_reorder = malloc (sizeof (*res_reorder) * num_hosts);
-    if (!res_reorder)
-    {
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_MEMORY_ERROR);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
-    }
-
-    /* reorder groups */
-    retry = HOOK_CONNECT(hook_connect, retry);
-    if (num_groups > 0)
-    {
-        retry %= num_groups;
-        i = 0;
-
-        last_af = AF_UNSPEC;
-        tmp_num_groups = 0;
-        tmp_host = i; /* start of current group */
-
-        /* top of list */
-        for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
-        {
-            if (ptr_res->ai_family != last_af)
-            {
-                if (last_af != AF_UNSPEC)
-                    tmp_num_groups++;
-
-                tmp_host = i;
-            }
-
-            if (tmp_num_groups >= retry)
-            {
-                /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
-                if (rand_num == i)
-                    res_reorder[i++] = ptr_res;
-                else
-                {
-                    res_reorder[i++] = res_reorder[rand_num];
-                    res_reorder[rand_num] = ptr_res;
-                }
-            }
-
-            last_af = ptr_res->ai_family;
-        }
-
-        last_af = AF_UNSPEC;
-        tmp_num_groups = 0;
-        tmp_host = i; /* start of current group */
-
-        /* remainder of list */
-        for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
-        {
-            if (ptr_res->ai_family != last_af)
-            {
-                if (last_af != AF_UNSPEC)
-                    tmp_num_groups++;
-
-                tmp_host = i;
-            }
-
-            if (tmp_num_groups < retry)
-            {
-                /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
-                if (rand_num == i)
-                    res_reorder[i++] = ptr_res;
-                else
-                {
-                    res_reorder[i++] = res_reorder[rand_num];
-                    res_reorder[rand_num] = ptr_res;
-                }
-            }
-            else
-                break;
-
-            last_af = ptr_res->ai_family;
-        }
-    }
-    else
-    {
-        /* no IP addresses found (all AF_UNSPEC) */
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
-    }
-
-    status_str[0] = '0' + WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND;
-
-    /* try all IP addresses found, stop when connection is OK */
-    sock = -1;
-    for (i = 0; i < num_hosts; i++)
-    {
-        ptr_res = res_reorder[i];
-
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-        /* use pre-created socket pool */
-        sock = -1;
-        for (j = 0; j < HOOK_CONNECT_MAX_SOCKETS; j++)
-        {
-            if (ptr_res->ai_family == AF_INET)
-            {
-                sock = HOOK_CONNECT(hook_connect, sock_v4[j]);
-                if (sock != -1)
-                {
-                    HOOK_CONNECT(hook_connect, sock_v4[j]) = -1;
-                    break;
-                }
-            }
-            else if (ptr_res->ai_family == AF_INET6)
-            {
-                sock = HOOK_CONNECT(hook_connect, sock_v6[j]);
-                if (sock != -1)
-                {
-                    HOOK_CONNECT(hook_connect, sock_v6[j]) = -1;
-                    break;
-                }
-            }
-        }
-        if (sock < 0)
-            continue;
-#else
-        /* create a socket */
-        sock = socket (ptr_res->ai_family,
-                       ptr_res->ai_socktype,
-                       ptr_res->ai_protocol);
-#endif
-        if (sock < 0)
-        {
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_SOCKET_ERROR;
-            continue;
-        }
-
-        /* set SO_REUSEADDR option for socket */
-        set = 1;
-        setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, (void *) &set, sizeof (set));
-
-        /* set SO_KEEPALIVE option for socket */
-        set = 1;
-        setsockopt (sock, SOL_SOCKET, SO_KEEPALIVE, (void *) &set, sizeof (set));
-
-        /* set flag O_NONBLOCK on socket */
-        flags = fcntl (sock, F_GETFL);
-        if (flags == -1)
-            flags = 0;
-        fcntl (sock, F_SETFL, flags | O_NONBLOCK);
-
-        if (res_local)
-        {
-            rc = -1;
-
-            /* bind local hostname/IP if asked by user */
-            for (ptr_loc = res_local; ptr_loc; ptr_loc = ptr_loc->ai_next)
-            {
-                if (ptr_loc->ai_family != ptr_res->ai_family)
-                    continue;
-
-                rc = bind (sock, ptr_loc->ai_addr, ptr_loc->ai_addrlen);
-                if (rc < 0)
-                    continue;
-            }
-
-            if (rc < 0)
-            {
-                status_str[0] = '0' + WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR;
-                close (sock);
-                sock = -1;
-                continue;
-            }
-        }
-
-        /* connect to peer */
-        if (network_connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen))
-        {
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_OK;
-            rc = getnameinfo (ptr_res->ai_addr, ptr_res->ai_addrlen,
-                              remote_address, sizeof (remote_address),
-                              NULL, 0, NI_NUMERICHOST);
-            if (rc == 0)
-                ptr_address = remote_address;
-            break;
-        }
-        else
-        {
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
-            close (sock);
-            sock = -1;
-        }
-    }
-
-    HOOK_CONNECT(hook_connect, sock) = sock;
-
-    if (ptr_proxy && status_str[0] == '0' + WEECHAT_HOOK_CONNECT_OK)
-    {
-        if (!network_pass_proxy (HOOK_CONNECT(hook_connect, proxy),
-                                 HOOK_CONNECT(hook_connect, sock),
-                                 HOOK_CONNECT(hook_connect, address),
-                                 HOOK_CONNECT(hook_connect, port)))
-        {
-            /* proxy fails to connect to peer */
-            status_str[0] = '0' + WEECHAT_HOOK_CONNECT_PROXY_ERROR;
-        }
-    }
-
-    if (status_str[0] == '0' + WEECHAT_HOOK_CONNECT_OK)
-    {
-        status_with_string = NULL;
-        if (ptr_address)
-        {
-            length = strlen (status_str) + 5 + strlen (ptr_address) + 1;
-            status_with_string = malloc (length);
-            if (status_with_string)
-            {
-                snprintf (status_with_string, length, "%s%05d%s",
-                          status_str, (int)strlen (ptr_address), ptr_address);
-            }
-        }
-
-        if (status_with_string)
-        {
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_with_string, strlen (status_with_string));
-            (void) num_written;
-        }
-        else
-        {
-            snprintf (status_without_string, sizeof (status_without_string),
-                      "%s00000", status_str);
-            num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                                 status_without_string, strlen (status_without_string));
-            (void) num_written;
-        }
-
-        /* send the socket to the parent process */
-#ifndef HOOK_CONNECT_MAX_SOCKETS
-        memset (&msg, 0, sizeof (msg));
-        msg.msg_control = msg_buf;
-        msg.msg_controllen = sizeof (msg_buf);
-
-        /* send 1 byte of data (not required on Linux, required by BSD/OSX) */
-        memset (iov, 0, sizeof (iov));
-        iov[0].iov_base = iov_data;
-        iov[0].iov_len = 1;
-        msg.msg_iov = iov;
-        msg.msg_iovlen = 1;
-
-        cmsg = CMSG_FIRSTHDR(&msg);
-        cmsg->cmsg_level = SOL_SOCKET;
-        cmsg->cmsg_type = SCM_RIGHTS;
-        cmsg->cmsg_len = CMSG_LEN(sizeof (sock));
-        memcpy(CMSG_DATA(cmsg), &sock, sizeof (sock));
-        msg.msg_controllen = cmsg->cmsg_len;
-        num_written = sendmsg (HOOK_CONNECT(hook_connect, child_send), &msg, 0);
-        (void) num_written;
-#else
-        num_written = write (HOOK_CONNECT(hook_connect, child_write), &sock, sizeof (sock));
-        (void) num_written;
-#endif
-    }
-    else
-    {
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%s00000", status_str);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-    }
-
-end:
-    if (status_with_string)
-        free (status_with_string);
-    if (res_reorder)
-        free (res_reorder);
-    if (res_local)
-        freeaddrinfo (res_local);
-    if (res_remote)
-        freeaddrinfo (res_remote);
-}
-
-/*
- * Timer callback for timeout of child process.
- */
+/*
+ * Timer callback used to report an error found when connection starts (the
+ * callback is never called before function hook_connect returns).
+ */
 
 int
-network_connect_child_timer_cb (void *arg_hook_connect, int remaining_calls)
+network_connect_error_timer_cb (void *arg_hook_connect, int remaining_calls)
 {
     struct t_hook *hook_connect;
 
@@ -1240,13 +853,10 @@ network_connect_child_timer_cb (void *arg_hook_connect, int remaining_calls)
 
     hook_connect = (struct t_hook *)arg_hook_connect;
 
-    HOOK_CONNECT(hook_connect, hook_child_timer) = NULL;
+    HOOK_CONNECT(hook_connect, hook_timer) = NULL;
 
-    (void) (HOOK_CONNECT(hook_connect, callback))
-        (hook_connect->callback_data,
-         WEECHAT_HOOK_CONNECT_TIMEOUT,
-         0, -1, NULL, NULL);
-    unhook (hook_connect);
+    network_connect_error (hook_connect, HOOK_CONNECT(hook_connect, status),
+                           NULL);
 
     return WEECHAT_RC_OK;
 }
@@ -1362,262 +972,784 @@ network_connect_gnutls_handshake_timer_cb (void *arg_hook_connect,
 #endif
 
 /*
- * Reads connection progress from child process.
+ * Connection to peer is OK: starts GnuTLS handshake (if SSL asked), or calls
+ * callback of connect hook.
  */
 
-int
-network_connect_child_read_cb (void *arg_hook_connect, int fd)
+void
+network_connect_ok (struct t_hook *hook_connect)
 {
-    struct t_hook *hook_connect;
-    char buffer[1], buf_size[6], *cb_error, *cb_ip_address, *error;
-    int num_read;
-    long size_msg;
 #ifdef HAVE_GNUTLS
     int rc, direction;
-#endif
-    int sock;
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-    int i;
-#else
-    struct msghdr msg;
-    struct cmsghdr *cmsg;
-    char msg_buf[CMSG_SPACE(sizeof (sock))];
-    struct iovec iov[1];
-    char iov_data[1];
-#endif
-
-    /* make C compiler happy */
-    (void) fd;
-
-    hook_connect = (struct t_hook *)arg_hook_connect;
-
-    cb_error = NULL;
-    cb_ip_address = NULL;
-    sock = -1;
 
-    num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                     buffer, sizeof (buffer));
-    if (num_read == sizeof (buffer))
+    if (HOOK_CONNECT(hook_connect, gnutls_sess))
     {
-        if (buffer[0] - '0' == WEECHAT_HOOK_CONNECT_OK)
+        /*
+         * the socket needs to be non-blocking since the call to
+         * gnutls_handshake can block
+         */
+        HOOK_CONNECT(hook_connect, handshake_fd_flags) =
+            fcntl (HOOK_CONNECT(hook_connect, sock), F_GETFL);
+        if (HOOK_CONNECT(hook_connect, handshake_fd_flags) == -1)
+            HOOK_CONNECT(hook_connect, handshake_fd_flags) = 0;
+        fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
+               HOOK_CONNECT(hook_connect, handshake_fd_flags) | O_NONBLOCK);
+        gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
+                                  (gnutls_transport_ptr_t) ((ptrdiff_t) HOOK_CONNECT(hook_connect, sock)));
+        if (HOOK_CONNECT(hook_connect, gnutls_dhkey_size) > 0)
         {
-            /* connection OK, read IP address */
-            buf_size[5] = '\0';
-            num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                             buf_size, 5);
-            if (num_read == 5)
-            {
-                error = NULL;
-                size_msg = strtol (buf_size, &error, 10);
-                if (error && !error[0] && (size_msg > 0))
-                {
-                    cb_ip_address = malloc (size_msg + 1);
-                    if (cb_ip_address)
-                    {
-                        num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                                         cb_ip_address, size_msg);
-                        if (num_read == size_msg)
-                            cb_ip_address[size_msg] = '\0';
-                        else
-                        {
-                            free (cb_ip_address);
-                            cb_ip_address = NULL;
-                        }
-                    }
-                }
-            }
-
-#ifndef HOOK_CONNECT_MAX_SOCKETS
-            /* receive the socket from the child process */
-            memset (&msg, 0, sizeof (msg));
-            msg.msg_control = msg_buf;
-            msg.msg_controllen = sizeof (msg_buf);
-
-            /* recv 1 byte of data (not required on Linux, required by BSD/OSX) */
-            memset (iov, 0, sizeof (iov));
-            iov[0].iov_base = iov_data;
-            iov[0].iov_len = 1;
-            msg.msg_iov = iov;
-            msg.msg_iovlen = 1;
-
-            if (recvmsg (HOOK_CONNECT(hook_connect, child_recv), &msg, 0) >= 0)
-            {
-                cmsg = CMSG_FIRSTHDR(&msg);
-                if (cmsg != NULL
-                    && cmsg->cmsg_level == SOL_SOCKET
-                    && cmsg->cmsg_type == SCM_RIGHTS
-                    && cmsg->cmsg_len >= sizeof (sock))
-                {
-                    memcpy(&sock, CMSG_DATA(cmsg), sizeof (sock));
-                }
-            }
-#else
-            num_read = read (HOOK_CONNECT(hook_connect, child_read), &sock, sizeof (sock));
-            (void) num_read;
-
-            /* prevent unhook process from closing the socket */
-            for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
-            {
-                if (HOOK_CONNECT(hook_connect, sock_v4[i]) == sock)
-                    HOOK_CONNECT(hook_connect, sock_v4[i]) = -1;
-
-                if (HOOK_CONNECT(hook_connect, sock_v6[i]) == sock)
-                    HOOK_CONNECT(hook_connect, sock_v6[i]) = -1;
-            }
-#endif
-
-            HOOK_CONNECT(hook_connect, sock) = sock;
-
-#ifdef HAVE_GNUTLS
-            if (HOOK_CONNECT(hook_connect, gnutls_sess))
-            {
-                /*
-                 * the socket needs to be non-blocking since the call to
-                 * gnutls_handshake can block
-                 */
-                HOOK_CONNECT(hook_connect, handshake_fd_flags) =
-                    fcntl (HOOK_CONNECT(hook_connect, sock), F_GETFL);
-                if (HOOK_CONNECT(hook_connect, handshake_fd_flags) == -1)
-                    HOOK_CONNECT(hook_connect, handshake_fd_flags) = 0;
-                fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
-                       HOOK_CONNECT(hook_connect, handshake_fd_flags) | O_NONBLOCK);
-                gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
-                                          (gnutls_transport_ptr_t) ((ptrdiff_t) HOOK_CONNECT(hook_connect, sock)));
-                if (HOOK_CONNECT(hook_connect, gnutls_dhkey_size) > 0)
-                {
-                    gnutls_dh_set_prime_bits (*HOOK_CONNECT(hook_connect, gnutls_sess),
-                                              (unsigned int) HOOK_CONNECT(hook_connect, gnutls_dhkey_size));
-                }
-                rc = gnutls_handshake (*HOOK_CONNECT(hook_connect, gnutls_sess));
-                if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
-                {
-                    /*
-                     * gnutls was unable to proceed with the handshake without
-                     * blocking: non fatal error, we just have to wait for an
-                     * event about handshake
-                     */
-                    unhook (HOOK_CONNECT(hook_connect, hook_fd));
-                    HOOK_CONNECT(hook_connect, hook_fd) = NULL;
-                    direction = gnutls_record_get_direction (*HOOK_CONNECT(hook_connect, gnutls_sess));
-                    HOOK_CONNECT(hook_connect, handshake_ip_address) = cb_ip_address;
-                    HOOK_CONNECT(hook_connect, handshake_hook_fd) =
-                        hook_fd (hook_connect->plugin,
-                                 HOOK_CONNECT(hook_connect, sock),
-                                 (!direction ? 1 : 0), (direction  ? 1 : 0), 0,
-                                 &network_connect_gnutls_handshake_fd_cb,
-                                 hook_connect);
-                    HOOK_CONNECT(hook_connect, handshake_hook_timer) =
-                        hook_timer (hook_connect->plugin,
-                                    CONFIG_INTEGER(config_network_gnutls_handshake_timeout) * 1000,
-                                    0, 1,
-                                    &network_connect_gnutls_handshake_timer_cb,
-                                    hook_connect);
-                    return WEECHAT_RC_OK;
-                }
-                else if (rc != GNUTLS_E_SUCCESS)
-                {
-                    (void) (HOOK_CONNECT(hook_connect, callback))
-                        (hook_connect->callback_data,
-                         WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
-                         rc, sock,
-                         gnutls_strerror (rc),
-                         cb_ip_address);
-                    unhook (hook_connect);
-                    if (cb_ip_address)
-                        free (cb_ip_address);
-                    return WEECHAT_RC_OK;
-                }
-                fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
-                       HOOK_CONNECT(hook_connect, handshake_fd_flags));
-#if LIBGNUTLS_VERSION_NUMBER < 0x02090a
-                /*
-                 * gnutls only has the gnutls_certificate_set_verify_function()
-                 * function since version 2.9.10. We need to call our verify
-                 * function manually after the handshake for old gnutls versions
-                 */
-                if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
-                {
-                    (void) (HOOK_CONNECT(hook_connect, callback))
-                        (hook_connect->callback_data,
-                         WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
-                         rc, sock,
-                         "Error in the certificate.",
-                         cb_ip_address);
-                    unhook (hook_connect);
-                    if (cb_ip_address)
-                        free (cb_ip_address);
-                    return WEECHAT_RC_OK;
-                }
-#endif
-            }
-#endif
+            gnutls_dh_set_prime_bits (*HOOK_CONNECT(hook_connect, gnutls_sess),
+                                      (unsigned int) HOOK_CONNECT(hook_connect, gnutls_dhkey_size));
         }
-        else
+        rc = gnutls_handshake (*HOOK_CONNECT(hook_connect, gnutls_sess));
+        if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
         {
-            /* connection error, read error */
-            buf_size[5] = '\0';
-            num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                             buf_size, 5);
-            if (num_read == 5)
-            {
-                error = NULL;
-                size_msg = strtol (buf_size, &error, 10);
-                if (error && !error[0] && (size_msg > 0))
-                {
-                    cb_error = malloc (size_msg + 1);
-                    if (cb_error)
-                    {
-                        num_read = read (HOOK_CONNECT(hook_connect, child_read),
-                                         cb_error, size_msg);
-                        if (num_read == size_msg)
-                            cb_error[size_msg] = '\0';
-                        else
-                        {
-                            free (cb_error);
-                            cb_error = NULL;
-                        }
-                    }
-                }
-            }
+            /*
+             * gnutls was unable to proceed with the handshake without
+             * blocking: non fatal error, we just have to wait for an
+             * event about handshake
+             */
+            direction = gnutls_record_get_direction (*HOOK_CONNECT(hook_connect, gnutls_sess));
+            HOOK_CONNECT(hook_connect, handshake_ip_address) =
+                HOOK_CONNECT(hook_connect, ip_address);
+            HOOK_CONNECT(hook_connect, ip_address) = NULL;
+            HOOK_CONNECT(hook_connect, handshake_hook_fd) =
+                hook_fd (hook_connect->plugin,
+                         HOOK_CONNECT(hook_connect, sock),
+                         (!direction ? 1 : 0), (direction  ? 1 : 0), 0,
+                         &network_connect_gnutls_handshake_fd_cb,
+                         hook_connect);
+            HOOK_CONNECT(hook_connect, handshake_hook_timer) =
+                hook_timer (hook_connect->plugin,
+                            CONFIG_INTEGER(config_network_gnutls_handshake_timeout) * 1000,
+                            0, 1,
+                            &network_connect_gnutls_handshake_timer_cb,
+                            hook_connect);
+            return;
         }
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_data, buffer[0] - '0', 0,
-             sock, cb_error, cb_ip_address);
-        unhook (hook_connect);
-    }
-    else
-    {
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_data, WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-             0, sock, cb_error, cb_ip_address);
-        unhook (hook_connect);
+        else if (rc != GNUTLS_E_SUCCESS)
+        {
+            (void) (HOOK_CONNECT(hook_connect, callback))
+                (hook_connect->callback_data,
+                 WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
+                 rc, HOOK_CONNECT(hook_connect, sock),
+                 gnutls_strerror (rc),
+                 HOOK_CONNECT(hook_connect, ip_address));
+            unhook (hook_connect);
+            return;
+        }
+        fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
+               HOOK_CONNECT(hook_connect, handshake_fd_flags));
+#if LIBGNUTLS_VERSION_NUMBER < 0x02090a
+        /*
+         * gnutls only has the gnutls_certificate_set_verify_function()
+         * function since version 2.9.10. We need to call our verify
+         * function manually after the handshake for old gnutls versions
+         */
+        if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
+        {
+            (void) (HOOK_CONNECT(hook_connect, callback))
+                (hook_connect->callback_data,
+                 WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
+                 rc, HOOK_CONNECT(hook_connect, sock),
+                 "Error in the certificate.",
+                 HOOK_CONNECT(hook_connect, ip_address));
+            unhook (hook_connect);
+            return;
+        }
+#endif
     }
+#endif
 
-    if (cb_error)
-        free (cb_error);
-    if (cb_ip_address)
-        free (cb_ip_address);
-
-    return WEECHAT_RC_OK;
+    (void) (HOOK_CONNECT(hook_connect, callback))
+        (hook_connect->callback_data, WEECHAT_HOOK_CONNECT_OK, 0,
+         HOOK_CONNECT(hook_connect, sock), NULL,
+         HOOK_CONNECT(hook_connect, ip_address));
+    unhook (hook_connect);
 }
 
 /*
- * Connects with fork (called by hook_connect() only!).
+ * Callback for dialog with proxy (socket connected to proxy).
  */
 
-void
-network_connect_with_fork (struct t_hook *hook_connect)
+int
+network_connect_proxy_fd_cb (void *arg_hook_connect, int fd)
 {
-    int child_pipe[2], rc;
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-    int i;
-#else
-    int child_socket[2];
-#endif
+    struct t_hook *hook_connect;
+    struct t_network_proxy_dialog *dialog;
+    int num, rc;
+
+    hook_connect = (struct t_hook *)arg_hook_connect;
+    dialog = HOOK_CONNECT(hook_connect, proxy_dialog);
+
+    if (dialog->send_pos < dialog->send_length)
+    {
+        num = send (fd, dialog->buffer + dialog->send_pos,
+                    dialog->send_length - dialog->send_pos, 0);
+        if ((num < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                          || (errno == EINTR)))
+        {
+            return WEECHAT_RC_OK;
+        }
+        if (num <= 0)
+        {
+            network_connect_error (hook_connect,
+                                   WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+            return WEECHAT_RC_OK;
+        }
+        dialog->send_pos += num;
+        if (dialog->send_pos >= dialog->send_length)
+        {
+            HOOK_FD(HOOK_CONNECT(hook_connect, hook_fd), flags) =
+                HOOK_FD_FLAG_READ;
+        }
+        return WEECHAT_RC_OK;
+    }
+
+    num = recv (fd, dialog->buffer + dialog->recv_length,
+                dialog->recv_max - dialog->recv_length, 0);
+    if ((num < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                      || (errno == EINTR)))
+    {
+        return WEECHAT_RC_OK;
+    }
+    if (num <= 0)
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+        return WEECHAT_RC_OK;
+    }
+    dialog->recv_length += num;
+    if (dialog->recv_length < dialog->recv_min)
+        return WEECHAT_RC_OK;
+
+    rc = network_proxy_dialog_step (dialog);
+    switch (rc)
+    {
+        case NETWORK_PROXY_DIALOG_CONTINUE:
+            HOOK_FD(HOOK_CONNECT(hook_connect, hook_fd), flags) =
+                (dialog->send_length > 0) ?
+                HOOK_FD_FLAG_WRITE : HOOK_FD_FLAG_READ;
+            break;
+        case NETWORK_PROXY_DIALOG_OK:
+            unhook (HOOK_CONNECT(hook_connect, hook_fd));
+            HOOK_CONNECT(hook_connect, hook_fd) = NULL;
+            network_proxy_dialog_free (dialog);
+            HOOK_CONNECT(hook_connect, proxy_dialog) = NULL;
+            network_connect_ok (hook_connect);
+            break;
+        default:
+            network_connect_error (hook_connect,
+                                   WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+            break;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Stops all connection attempts in progress (except the socket "sock", which
+ * is kept open).
+ */
+
+void
+network_connect_attempt_stop (struct t_hook *hook_connect, int sock)
+{
+    int i;
+
+    for (i = 0; i < HOOK_CONNECT_MAX_ATTEMPTS; i++)
+    {
+        if (HOOK_CONNECT(hook_connect, attempt_hook_fd[i]))
+        {
+            unhook (HOOK_CONNECT(hook_connect, attempt_hook_fd[i]));
+            HOOK_CONNECT(hook_connect, attempt_hook_fd[i]) = NULL;
+        }
+        if ((HOOK_CONNECT(hook_connect, attempt_sock[i]) >= 0)
+            && (HOOK_CONNECT(hook_connect, attempt_sock[i]) != sock))
+        {
+            close (HOOK_CONNECT(hook_connect, attempt_sock[i]));
+        }
+        HOOK_CONNECT(hook_connect, attempt_sock[i]) = -1;
+        HOOK_CONNECT(hook_connect, attempt_address[i]) = -1;
+    }
+
+    if (HOOK_CONNECT(hook_connect, hook_attempt_timer))
+    {
+        unhook (HOOK_CONNECT(hook_connect, hook_attempt_timer));
+        HOOK_CONNECT(hook_connect, hook_attempt_timer) = NULL;
+    }
+}
+
+/*
+ * Connection to an address is OK: stops other attempts, then starts dialog
+ * with proxy (if a proxy is used) or GnuTLS handshake.
+ */
+
+void
+network_connect_attempt_ok (struct t_hook *hook_connect, int sock,
+                            struct addrinfo *address)
+{
+    struct t_proxy *ptr_proxy;
+    struct t_network_proxy_dialog *dialog;
+    struct addrinfo *ptr_peer;
+    char ip_address[NI_MAXHOST + 1];
+
+    network_connect_attempt_stop (hook_connect, sock);
+
+    HOOK_CONNECT(hook_connect, sock) = sock;
+    if (getnameinfo (address->ai_addr, address->ai_addrlen,
+                     ip_address, sizeof (ip_address),
+                     NULL, 0, NI_NUMERICHOST) == 0)
+    {
+        HOOK_CONNECT(hook_connect, ip_address) = strdup (ip_address);
+    }
+
+    if (!HOOK_CONNECT(hook_connect, proxy)
+        || !HOOK_CONNECT(hook_connect, proxy)[0])
+    {
+        network_connect_ok (hook_connect);
+        return;
+    }
+
+    /* start dialog with proxy */
+    ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+    dialog = network_proxy_dialog_new (ptr_proxy,
+                                       HOOK_CONNECT(hook_connect, address),
+                                       HOOK_CONNECT(hook_connect, port));
+    if (!dialog)
+    {
+        close (sock);
+        HOOK_CONNECT(hook_connect, sock) = -1;
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+        return;
+    }
+    for (ptr_peer = HOOK_CONNECT(hook_connect, res_peer); ptr_peer;
+         ptr_peer = ptr_peer->ai_next)
+    {
+        if (ptr_peer->ai_family == AF_INET)
+        {
+            dialog->ipv4 = ((struct sockaddr_in *)ptr_peer->ai_addr)->sin_addr.s_addr;
+            break;
+        }
+    }
+
+    /* the socket is closed by network_connect_free if dialog fails */
+    HOOK_CONNECT(hook_connect, proxy_dialog) = dialog;
+
+    if (network_proxy_dialog_step (dialog) != NETWORK_PROXY_DIALOG_CONTINUE)
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+        return;
+    }
+    HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
+                                                   sock, 0, 1, 0,
+                                                   &network_connect_proxy_fd_cb,
+                                                   hook_connect);
+    if (!HOOK_CONNECT(hook_connect, hook_fd))
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_MEMORY_ERROR, NULL);
+    }
+}
+
+/*
+ * Callback for a connection attempt (socket writable: connection is
+ * established or has failed).
+ */
+
+int
+network_connect_attempt_fd_cb (void *arg_hook_connect, int fd)
+{
+    struct t_hook *hook_connect;
+    int i, index, value;
+    socklen_t len;
+
+    hook_connect = (struct t_hook *)arg_hook_connect;
+
+    for (i = 0; i < HOOK_CONNECT_MAX_ATTEMPTS; i++)
+    {
+        if (HOOK_CONNECT(hook_connect, attempt_sock[i]) == fd)
+            break;
+    }
+    if (i >= HOOK_CONNECT_MAX_ATTEMPTS)
+        return WEECHAT_RC_OK;
+
+    index = HOOK_CONNECT(hook_connect, attempt_address[i]);
+    unhook (HOOK_CONNECT(hook_connect, attempt_hook_fd[i]));
+    HOOK_CONNECT(hook_connect, attempt_hook_fd[i]) = NULL;
+    HOOK_CONNECT(hook_connect, attempt_sock[i]) = -1;
+    HOOK_CONNECT(hook_connect, attempt_address[i]) = -1;
+
+    /* SO_ERROR is 0 if connect is OK (see man connect) */
+    value = -1;
+    len = sizeof (value);
+    if ((getsockopt (fd, SOL_SOCKET, SO_ERROR, &value, &len) == 0)
+        && (value == 0))
+    {
+        network_connect_attempt_ok (hook_connect, fd,
+                                    HOOK_CONNECT(hook_connect, addresses)[index]);
+    }
+    else
+    {
+        close (fd);
+        HOOK_CONNECT(hook_connect, status) =
+            WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
+        network_connect_attempt_next (hook_connect);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Timer callback to start next connection attempt (if previous attempts are
+ * still in progress).
+ */
+
+int
+network_connect_attempt_timer_cb (void *arg_hook_connect, int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    network_connect_attempt_next ((struct t_hook *)arg_hook_connect);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Starts a connection attempt on next address.
+ *
+ * Attempts are not blocking: a new attempt is started every
+ * HOOK_CONNECT_ATTEMPT_DELAY milliseconds, or immediately when an attempt
+ * fails, and the first attempt which succeeds is used.
+ */
+
+void
+network_connect_attempt_next (struct t_hook *hook_connect)
+{
+    struct addrinfo *ptr_res, *ptr_loc;
+    int i, index, sock, set, flags, rc, running;
+
+    /* search a free slot for a new attempt */
+    for (i = 0; i < HOOK_CONNECT_MAX_ATTEMPTS; i++)
+    {
+        if (HOOK_CONNECT(hook_connect, attempt_sock[i]) < 0)
+            break;
+    }
+
+    while ((i < HOOK_CONNECT_MAX_ATTEMPTS)
+           && (HOOK_CONNECT(hook_connect, next_address) <
+               HOOK_CONNECT(hook_connect, num_addresses)))
+    {
+        index = HOOK_CONNECT(hook_connect, next_address)++;
+        ptr_res = HOOK_CONNECT(hook_connect, addresses)[index];
+
+        /* create a socket */
+        sock = socket (ptr_res->ai_family, ptr_res->ai_socktype,
+                       ptr_res->ai_protocol);
+        if (sock < 0)
+        {
+            HOOK_CONNECT(hook_connect, status) =
+                WEECHAT_HOOK_CONNECT_SOCKET_ERROR;
+            continue;
+        }
+
+        /* set SO_REUSEADDR option for socket */
+        set = 1;
+        setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, (void *) &set, sizeof (set));
+
+        /* set SO_KEEPALIVE option for socket */
+        set = 1;
+        setsockopt (sock, SOL_SOCKET, SO_KEEPALIVE, (void *) &set, sizeof (set));
+
+        /* set flag O_NONBLOCK on socket */
+        flags = fcntl (sock, F_GETFL);
+        if (flags == -1)
+            flags = 0;
+        fcntl (sock, F_SETFL, flags | O_NONBLOCK);
+
+        if (HOOK_CONNECT(hook_connect, res_local))
+        {
+            rc = -1;
+
+            /* bind local hostname/IP if asked by user */
+            for (ptr_loc = HOOK_CONNECT(hook_connect, res_local); ptr_loc;
+                 ptr_loc = ptr_loc->ai_next)
+            {
+                if (ptr_loc->ai_family != ptr_res->ai_family)
+                    continue;
+
+                rc = bind (sock, ptr_loc->ai_addr, ptr_loc->ai_addrlen);
+                if (rc == 0)
+                    break;
+            }
+
+            if (rc < 0)
+            {
+                HOOK_CONNECT(hook_connect, status) =
+                    WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR;
+                close (sock);
+                continue;
+            }
+        }
+
+        /* connect to peer */
+        if (connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen) == 0)
+        {
+            network_connect_attempt_ok (hook_connect, sock, ptr_res);
+            return;
+        }
+        if (errno != EINPROGRESS)
+        {
+            HOOK_CONNECT(hook_connect, status) =
+                WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
+            close (sock);
+            continue;
+        }
+
+        /* wait for connection (socket will be writable) */
+        HOOK_CONNECT(hook_connect, attempt_hook_fd[i]) =
+            hook_fd (hook_connect->plugin, sock, 0, 1, 0,
+                     &network_connect_attempt_fd_cb, hook_connect);
+        if (!HOOK_CONNECT(hook_connect, attempt_hook_fd[i]))
+        {
+            HOOK_CONNECT(hook_connect, status) =
+                WEECHAT_HOOK_CONNECT_MEMORY_ERROR;
+            close (sock);
+            continue;
+        }
+        HOOK_CONNECT(hook_connect, attempt_sock[i]) = sock;
+        HOOK_CONNECT(hook_connect, attempt_address[i]) = index;
+        break;
+    }
+
+    running = 0;
+    for (i = 0; i < HOOK_CONNECT_MAX_ATTEMPTS; i++)
+    {
+        if (HOOK_CONNECT(hook_connect, attempt_sock[i]) >= 0)
+            running++;
+    }
+
+    if (HOOK_CONNECT(hook_connect, next_address) >=
+        HOOK_CONNECT(hook_connect, num_addresses))
+    {
+        /* no more address to try */
+        if (HOOK_CONNECT(hook_connect, hook_attempt_timer))
+        {
+            unhook (HOOK_CONNECT(hook_connect, hook_attempt_timer));
+            HOOK_CONNECT(hook_connect, hook_attempt_timer) = NULL;
+        }
+        if (running == 0)
+        {
+            network_connect_error (hook_connect,
+                                   HOOK_CONNECT(hook_connect, status), NULL);
+        }
+    }
+    else if (!HOOK_CONNECT(hook_connect, hook_attempt_timer))
+    {
+        HOOK_CONNECT(hook_connect, hook_attempt_timer) =
+            hook_timer (hook_connect->plugin, HOOK_CONNECT_ATTEMPT_DELAY, 0, 0,
+                        &network_connect_attempt_timer_cb, hook_connect);
+    }
+}
+
+/*
+ * Builds the sorted list of addresses to try.
+ *
+ * Groups of addresses (by family) are rotated according to retry count and
+ * addresses are shuffled inside each group, then families are interleaved
+ * (like "happy eyeballs", RFC 6555), so that an unreachable IPv6 network does
+ * not delay connection with IPv4 (or vice versa).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (memory)
+ */
+
+int
+network_connect_sort_addresses (struct t_hook *hook_connect)
+{
+    /*
+     * indicates that something is wrong with whichever group of
+     * servers is being tried first after connecting, so start at
+     * a different offset to increase the chance of success
+     */
+    int retry, rand_num, i, j, index_same, index_other;
+    int num_groups, tmp_num_groups, num_hosts, tmp_host, first_af;
+    struct addrinfo **res_reorder, **addresses, *ptr_res;
+    int last_af;
+
+    /*
+     * count all the groups of hosts by tracking family, e.g.
+     * 0 = [2001:db8::1, 2001:db8::2,
+     * 1 =  192.0.2.1, 192.0.2.2,
+     * 2 =  2002:c000:201::1, 2002:c000:201::2]
+     */
+    last_af = AF_UNSPEC;
+    num_groups = 0;
+    num_hosts = 0;
+    for (ptr_res = HOOK_CONNECT(hook_connect, res_remote); ptr_res;
+         ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
+            if (last_af != AF_UNSPEC)
+                num_groups++;
+
+        num_hosts++;
+        last_af = ptr_res->ai_family;
+    }
+    if (last_af != AF_UNSPEC)
+        num_groups++;
+
+    HOOK_CONNECT(hook_connect, num_addresses) = 0;
+    HOOK_CONNECT(hook_connect, next_address) = 0;
+
+    if (num_groups == 0)
+    {
+        /* no IP addresses found (all AF_UNSPEC) */
+        return 1;
+    }
+
+    res_reorder = malloc (sizeof (*res_reorder) * num_hosts);
+    if (!res_reorder)
+        return 0;
+    addresses = malloc (sizeof (*addresses) * num_hosts);
+    if (!addresses)
+    {
+        free (res_reorder);
+        return 0;
+    }
+
+    /* reorder groups */
+    retry = HOOK_CONNECT(hook_connect, retry);
+    retry %= num_groups;
+    i = 0;
+
+    last_af = AF_UNSPEC;
+    tmp_num_groups = 0;
+    tmp_host = i; /* start of current group */
+
+    /* top of list */
+    for (ptr_res = HOOK_CONNECT(hook_connect, res_remote); ptr_res;
+         ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
+        {
+            if (last_af != AF_UNSPEC)
+                tmp_num_groups++;
+
+            tmp_host = i;
+        }
+
+        if (tmp_num_groups >= retry)
+        {
+            /* shuffle while adding */
+            rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
+            if (rand_num == i)
+                res_reorder[i++] = ptr_res;
+            else
+            {
+                res_reorder[i++] = res_reorder[rand_num];
+                res_reorder[rand_num] = ptr_res;
+            }
+        }
+
+        last_af = ptr_res->ai_family;
+    }
+
+    last_af = AF_UNSPEC;
+    tmp_num_groups = 0;
+    tmp_host = i; /* start of current group */
+
+    /* remainder of list */
+    for (ptr_res = HOOK_CONNECT(hook_connect, res_remote); ptr_res;
+         ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
+        {
+            if (last_af != AF_UNSPEC)
+                tmp_num_groups++;
+
+            tmp_host = i;
+        }
+
+        if (tmp_num_groups < retry)
+        {
+            /* shuffle while adding */
+            rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
+            if (rand_num == i)
+                res_reorder[i++] = ptr_res;
+            else
+            {
+                res_reorder[i++] = res_reorder[rand_num];
+                res_reorder[rand_num] = ptr_res;
+            }
+        }
+        else
+            break;
+
+        last_af = ptr_res->ai_family;
+    }
+
+    /*
+     * interleave families: first address keeps its family, then alternate
+     * with the other family (order inside each family is kept)
+     */
+    first_af = res_reorder[0]->ai_family;
+    index_same = 0;
+    index_other = 0;
+    j = 0;
+    while (j < i)
+    {
+        while ((index_same < i)
+               && (res_reorder[index_same]->ai_family != first_af))
+        {
+            index_same++;
+        }
+        if (index_same < i)
+            addresses[j++] = res_reorder[index_same++];
+        while ((index_other < i)
+               && (res_reorder[index_other]->ai_family == first_af))
+        {
+            index_other++;
+        }
+        if (index_other < i)
+            addresses[j++] = res_reorder[index_other++];
+    }
+
+    free (res_reorder);
+
+    HOOK_CONNECT(hook_connect, addresses) = addresses;
+    HOOK_CONNECT(hook_connect, num_addresses) = i;
+
+    return 1;
+}
+
+/*
+ * Starts connection attempts when all names are resolved.
+ */
+
+void
+network_connect_resolved (struct t_hook *hook_connect)
+{
+    if (HOOK_CONNECT(hook_connect, resolve_remote)
+        || HOOK_CONNECT(hook_connect, resolve_local)
+        || HOOK_CONNECT(hook_connect, resolve_peer))
+    {
+        /* some names are still being resolved */
+        return;
+    }
+
+    if (!network_connect_sort_addresses (hook_connect))
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_MEMORY_ERROR, NULL);
+        return;
+    }
+
+    HOOK_CONNECT(hook_connect, status) =
+        WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND;
+
+    network_connect_attempt_next (hook_connect);
+}
+
+/*
+ * Callback for resolution of peer (or proxy).
+ */
+
+void
+network_connect_resolve_remote_cb (void *data, int rc, struct addrinfo *result)
+{
+    struct t_hook *hook_connect;
+
+    hook_connect = (struct t_hook *)data;
+
+    HOOK_CONNECT(hook_connect, resolve_remote) = NULL;
+
+    if ((rc != 0) || !result)
+    {
+        /* address not found */
+        resolve_free_addrinfo (result);
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND,
+                               (rc != 0) ? gai_strerror (rc) : NULL);
+        return;
+    }
+
+    HOOK_CONNECT(hook_connect, res_remote) = result;
+
+    network_connect_resolved (hook_connect);
+}
+
+/*
+ * Callback for resolution of local hostname.
+ */
+
+void
+network_connect_resolve_local_cb (void *data, int rc, struct addrinfo *result)
+{
+    struct t_hook *hook_connect;
+
+    hook_connect = (struct t_hook *)data;
+
+    HOOK_CONNECT(hook_connect, resolve_local) = NULL;
+
+    if ((rc != 0) || !result)
+    {
+        /* address not found */
+        resolve_free_addrinfo (result);
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR,
+                               (rc != 0) ? gai_strerror (rc) : NULL);
+        return;
+    }
+
+    HOOK_CONNECT(hook_connect, res_local) = result;
+
+    network_connect_resolved (hook_connect);
+}
+
+/*
+ * Callback for resolution of peer when a socks4 proxy is used (an error is
+ * not fatal here: proxy will refuse connection).
+ */
+
+void
+network_connect_resolve_peer_cb (void *data, int rc, struct addrinfo *result)
+{
+    struct t_hook *hook_connect;
+
+    /* make C compiler happy */
+    (void) rc;
+
+    hook_connect = (struct t_hook *)data;
+
+    HOOK_CONNECT(hook_connect, resolve_peer) = NULL;
+    HOOK_CONNECT(hook_connect, res_peer) = result;
+
+    network_connect_resolved (hook_connect);
+}
+
+/*
+ * Starts connection to peer (called by hook_connect() only!).
+ *
+ * Everything is done in WeeChat process, without blocking: names are resolved
+ * by threads (see wee-resolve.c), then non-blocking connections are made on
+ * sockets, dialog with proxy and GnuTLS handshake use fd hooks.
+ */
+
+void
+network_connect_start (struct t_hook *hook_connect)
+{
+    struct t_proxy *ptr_proxy;
+    char port[NI_MAXSERV + 1];
+    int status;
 #ifdef HAVE_GNUTLS
+    int rc;
     const char *pos_error;
 #endif
-    pid_t pid;
 
 #ifdef HAVE_GNUTLS
     /* initialize GnuTLS if SSL asked */
@@ -1649,80 +1781,153 @@ network_connect_with_fork (struct t_hook *hook_connect)
                                 gnutls_xcred);
         gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
                                   (gnutls_transport_ptr_t) ((unsigned long) HOOK_CONNECT(hook_connect, sock)));
+        /* caller can set data of a previous session (to resume it) */
+        if (HOOK_CONNECT(hook_connect, gnutls_cb))
+        {
+            (void) (HOOK_CONNECT(hook_connect, gnutls_cb))
+                (hook_connect->callback_data,
+                 *HOOK_CONNECT(hook_connect, gnutls_sess), NULL, 0,
+                 NULL, 0, NULL,
+                 WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_SESSION);
+        }
     }
 #endif
 
-    /* create pipe for child process */
-    if (pipe (child_pipe) < 0)
+    status = WEECHAT_HOOK_CONNECT_OK;
+
+    ptr_proxy = NULL;
+    if (HOOK_CONNECT(hook_connect, proxy)
+        && HOOK_CONNECT(hook_connect, proxy)[0])
     {
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_data,
-             WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-             0, -1, NULL, NULL);
-        unhook (hook_connect);
-        return;
+        ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+        if (!ptr_proxy)
+        {
+            /* proxy not found */
+            status = WEECHAT_HOOK_CONNECT_PROXY_ERROR;
+        }
     }
-    HOOK_CONNECT(hook_connect, child_read) = child_pipe[0];
-    HOOK_CONNECT(hook_connect, child_write) = child_pipe[1];
 
-#ifndef HOOK_CONNECT_MAX_SOCKETS
-    /* create socket for child process */
-    if (socketpair (AF_LOCAL, SOCK_DGRAM, 0, child_socket) < 0)
+    /* resolve peer (or proxy) */
+    if (status == WEECHAT_HOOK_CONNECT_OK)
     {
-        (void) (HOOK_CONNECT(hook_connect, callback))
-            (hook_connect->callback_data,
-             WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-             0, -1, NULL, NULL);
-        unhook (hook_connect);
+        if (ptr_proxy)
+        {
+            snprintf (port, sizeof (port), "%d",
+                      CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_PORT]));
+            HOOK_CONNECT(hook_connect, resolve_remote) =
+                resolve_new (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_ADDRESS]),
+                             port,
+                             (CONFIG_BOOLEAN(ptr_proxy->options[PROXY_OPTION_IPV6])) ?
+                             AF_UNSPEC : AF_INET,
+                             &network_connect_resolve_remote_cb,
+                             hook_connect);
+        }
+        else
+        {
+            snprintf (port, sizeof (port), "%d",
+                      HOOK_CONNECT(hook_connect, port));
+            HOOK_CONNECT(hook_connect, resolve_remote) =
+                resolve_new (HOOK_CONNECT(hook_connect, address),
+                             port,
+                             (HOOK_CONNECT(hook_connect, ipv6)) ?
+                             AF_UNSPEC : AF_INET,
+                             &network_connect_resolve_remote_cb,
+                             hook_connect);
+        }
+        if (!HOOK_CONNECT(hook_connect, resolve_remote))
+            status = WEECHAT_HOOK_CONNECT_MEMORY_ERROR;
+    }
+
+    /* resolve local hostname/IP if asked by user */
+    if ((status == WEECHAT_HOOK_CONNECT_OK)
+        && HOOK_CONNECT(hook_connect, local_hostname)
+        && HOOK_CONNECT(hook_connect, local_hostname)[0])
+    {
+        HOOK_CONNECT(hook_connect, resolve_local) =
+            resolve_new (HOOK_CONNECT(hook_connect, local_hostname),
+                         NULL, AF_UNSPEC,
+                         &network_connect_resolve_local_cb,
+                         hook_connect);
+        if (!HOOK_CONNECT(hook_connect, resolve_local))
+            status = WEECHAT_HOOK_CONNECT_MEMORY_ERROR;
+    }
+
+    /* resolve peer (IPv4) for a socks4 proxy */
+    if ((status == WEECHAT_HOOK_CONNECT_OK)
+        && ptr_proxy
+        && (CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_TYPE]) == PROXY_TYPE_SOCKS4))
+    {
+        HOOK_CONNECT(hook_connect, resolve_peer) =
+            resolve_new (HOOK_CONNECT(hook_connect, address),
+                         NULL, AF_INET,
+                         &network_connect_resolve_peer_cb,
+                         hook_connect);
+        if (!HOOK_CONNECT(hook_connect, resolve_peer))
+            status = WEECHAT_HOOK_CONNECT_MEMORY_ERROR;
+    }
+
+    if (status != WEECHAT_HOOK_CONNECT_OK)
+    {
+        /* error is reported to callback as soon as possible (by a timer) */
+        HOOK_CONNECT(hook_connect, status) = status;
+        HOOK_CONNECT(hook_connect, hook_timer) = hook_timer (hook_connect->plugin,
+                                                             1, 0, 1,
+                                                             &network_connect_error_timer_cb,
+                                                             hook_connect);
         return;
     }
-    HOOK_CONNECT(hook_connect, child_recv) = child_socket[0];
-    HOOK_CONNECT(hook_connect, child_send) = child_socket[1];
-#else
-    for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
+
+    HOOK_CONNECT(hook_connect, hook_timer) = hook_timer (hook_connect->plugin,
+                                                         CONFIG_INTEGER(config_network_connection_timeout) * 1000,
+                                                         0, 1,
+                                                         &network_connect_timer_cb,
+                                                         hook_connect);
+}
+
+/*
+ * Frees data used by connection (called when connect hook is removed).
+ */
+
+void
+network_connect_free (struct t_hook *hook_connect)
+{
+    resolve_cancel (HOOK_CONNECT(hook_connect, resolve_remote));
+    HOOK_CONNECT(hook_connect, resolve_remote) = NULL;
+    resolve_cancel (HOOK_CONNECT(hook_connect, resolve_local));
+    HOOK_CONNECT(hook_connect, resolve_local) = NULL;
+    resolve_cancel (HOOK_CONNECT(hook_connect, resolve_peer));
+    HOOK_CONNECT(hook_connect, resolve_peer) = NULL;
+
+    network_connect_attempt_stop (hook_connect, -1);
+
+    if (HOOK_CONNECT(hook_connect, proxy_dialog))
     {
-        HOOK_CONNECT(hook_connect, sock_v4[i]) = socket (AF_INET, SOCK_STREAM, 0);
-        HOOK_CONNECT(hook_connect, sock_v6[i]) = socket (AF_INET6, SOCK_STREAM, 0);
+        /* dialog with proxy not finished: socket was not sent to callback */
+        network_proxy_dialog_free (HOOK_CONNECT(hook_connect, proxy_dialog));
+        HOOK_CONNECT(hook_connect, proxy_dialog) = NULL;
+        if (HOOK_CONNECT(hook_connect, sock) >= 0)
+        {
+            close (HOOK_CONNECT(hook_connect, sock));
+            HOOK_CONNECT(hook_connect, sock) = -1;
+        }
     }
-#endif
 
-    switch (pid = fork ())
+    if (HOOK_CONNECT(hook_connect, addresses))
     {
-        /* fork failed */
-        case -1:
-            (void) (HOOK_CONNECT(hook_connect, callback))
-                (hook_connect->callback_data,
-                 WEECHAT_HOOK_CONNECT_MEMORY_ERROR,
-                 0, -1, NULL, NULL);
-            unhook (hook_connect);
-            return;
-        /* child process */
-        case 0:
-            rc = setuid (getuid ());
-            (void) rc;
-            close (HOOK_CONNECT(hook_connect, child_read));
-#ifndef HOOK_CONNECT_MAX_SOCKETS
-            close (HOOK_CONNECT(hook_connect, child_recv));
-#endif
-            network_connect_child (hook_connect);
-            _exit (EXIT_SUCCESS);
+        free (HOOK_CONNECT(hook_connect, addresses));
+        HOOK_CONNECT(hook_connect, addresses) = NULL;
+    }
+    HOOK_CONNECT(hook_connect, num_addresses) = 0;
+    HOOK_CONNECT(hook_connect, next_address) = 0;
+    resolve_free_addrinfo (HOOK_CONNECT(hook_connect, res_remote));
+    HOOK_CONNECT(hook_connect, res_remote) = NULL;
+    resolve_free_addrinfo (HOOK_CONNECT(hook_connect, res_local));
+    HOOK_CONNECT(hook_connect, res_local) = NULL;
+    resolve_free_addrinfo (HOOK_CONNECT(hook_connect, res_peer));
+    HOOK_CONNECT(hook_connect, res_peer) = NULL;
+    if (HOOK_CONNECT(hook_connect, ip_address))
+    {
+        free (HOOK_CONNECT(hook_connect, ip_address));
+        HOOK_CONNECT(hook_connect, ip_address) = NULL;
     }
-    /* parent process */
-    HOOK_CONNECT(hook_connect, child_pid) = pid;
-    close (HOOK_CONNECT(hook_connect, child_write));
-    HOOK_CONNECT(hook_connect, child_write) = -1;
-#ifndef HOOK_CONNECT_MAX_SOCKETS
-    close (HOOK_CONNECT(hook_connect, child_send));
-    HOOK_CONNECT(hook_connect, child_send) = -1;
-#endif
-    HOOK_CONNECT(hook_connect, hook_child_timer) = hook_timer (hook_connect->plugin,
-                                                               CONFIG_INTEGER(config_network_connection_timeout) * 1000,
-                                                               0, 1,
-                                                               &network_connect_child_timer_cb,
-                                                               hook_connect);
-    HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
-                                                   HOOK_CONNECT(hook_connect, child_read),
-                                                   1, 0, 0,
-                                                   &network_connect_child_read_cb,
-                                                   hook_connect);
 }
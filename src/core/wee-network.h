@@ -24,6 +24,7 @@
 #include <sys/socket.h>
 
 struct t_hook;
+struct t_proxy;
 
 struct t_network_socks4
 {
@@ -43,16 +44,53 @@ struct t_network_socks5
                           /*              auth(user/pass) (2), ...          */
 };
 
+/* return codes of network_proxy_dialog_step */
+#define NETWORK_PROXY_DIALOG_ERROR    0
+#define NETWORK_PROXY_DIALOG_CONTINUE 1
+#define NETWORK_PROXY_DIALOG_OK       2
+
+#define NETWORK_PROXY_DIALOG_BUFFER_SIZE 1024
+
+/*
+ * dialog with a proxy (HTTP, socks4 or socks5), without I/O: each step
+ * reads the data received in buffer and builds data to send (if any), then
+ * the caller sends "send_length" bytes and receives at least "recv_min" bytes
+ * (and at most "recv_max") before calling next step
+ */
+
+struct t_network_proxy_dialog
+{
+    int type;                          /* proxy type (PROXY_TYPE_xxx)       */
+    char *username;                    /* username (evaluated)              */
+    char *password;                    /* password (evaluated)              */
+    char *address;                     /* address of peer                   */
+    int port;                          /* port of peer                      */
+    unsigned int ipv4;                 /* IPv4 of peer (socks4 only)        */
+    int step;                          /* current step of dialog            */
+    unsigned char buffer[NETWORK_PROXY_DIALOG_BUFFER_SIZE]; /* data         */
+    int send_length;                   /* number of bytes to send           */
+    int send_pos;                      /* number of bytes already sent      */
+    int recv_min;                      /* min number of bytes to receive    */
+    int recv_max;                      /* max number of bytes to receive    */
+    int recv_length;                   /* number of bytes received          */
+};
+
 extern int network_init_gnutls_ok;
 
 extern void network_init_gcrypt ();
 extern void network_set_gnutls_ca_file ();
 extern void network_init_gnutls ();
 extern void network_end ();
+extern struct t_network_proxy_dialog *network_proxy_dialog_new (struct t_proxy *proxy,
+                                                                const char *address,
+                                                                int port);
+extern int network_proxy_dialog_step (struct t_network_proxy_dialog *dialog);
+extern void network_proxy_dialog_free (struct t_network_proxy_dialog *dialog);
 extern int network_pass_proxy (const char *proxy, int sock,
                                const char *address, int port);
 extern int network_connect_to (const char *proxy, struct sockaddr *address,
                                socklen_t address_length);
-extern void network_connect_with_fork (struct t_hook *hook_connect);
+extern void network_connect_start (struct t_hook *hook_connect);
+extern void network_connect_free (struct t_hook *hook_connect);
 
 #endif /* WEECHAT_NETWORK_H */
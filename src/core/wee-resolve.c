@@ -0,0 +1,615 @@
+/*
+ * wee-resolve.c - asynchronous resolution of names (with threads)
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Names are resolved with getaddrinfo (which is blocking) in a small pool of
+ * threads. Threads only call getaddrinfo: requests are created, cancelled and
+ * completed in main thread, which is woken up by a pipe watched with a fd
+ * hook. Results are kept in a cache for a few seconds (option
+ * weechat.network.dns_cache_ttl), so that many servers on same network are
+ * resolved only once.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#include "weechat.h"
+#include "wee-resolve.h"
+#include "wee-config.h"
+#include "wee-hook.h"
+#include "../plugins/plugin.h"
+
+
+pthread_mutex_t resolve_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t resolve_cond = PTHREAD_COND_INITIALIZER;
+
+/* these variables are protected by the mutex */
+struct t_resolve_request *resolve_queue = NULL;  /* requests to resolve     */
+struct t_resolve_request *last_resolve_queue = NULL;
+struct t_resolve_request *resolve_done = NULL;   /* requests resolved       */
+struct t_resolve_request *last_resolve_done = NULL;
+int resolve_threads = 0;               /* number of threads                 */
+int resolve_threads_idle = 0;          /* number of threads waiting         */
+int resolve_pipe[2] = { -1, -1 };      /* pipe to wake up main thread       */
+int resolve_ending = 0;                /* 1 if threads must stop            */
+
+/* these variables are used only in main thread */
+struct t_hook *resolve_hook_fd = NULL; /* fd hook on pipe                   */
+struct t_resolve_cache *resolve_cache = NULL; /* cache of results           */
+
+
+/*
+ * Duplicates a list of addresses (returned by getaddrinfo).
+ *
+ * Each address is allocated with its sockaddr, and canonical names are not
+ * copied.
+ *
+ * Note: result must be freed after use with resolve_free_addrinfo.
+ */
+
+struct addrinfo *
+resolve_dup_addrinfo (struct addrinfo *addrinfo)
+{
+    struct addrinfo *ptr_addrinfo, *new_addrinfo, *result, *last;
+
+    result = NULL;
+    last = NULL;
+
+    for (ptr_addrinfo = addrinfo; ptr_addrinfo;
+         ptr_addrinfo = ptr_addrinfo->ai_next)
+    {
+        new_addrinfo = malloc (sizeof (*new_addrinfo) + ptr_addrinfo->ai_addrlen);
+        if (!new_addrinfo)
+        {
+            resolve_free_addrinfo (result);
+            return NULL;
+        }
+        memcpy (new_addrinfo, ptr_addrinfo, sizeof (*new_addrinfo));
+        new_addrinfo->ai_addr = (struct sockaddr *)(new_addrinfo + 1);
+        memcpy (new_addrinfo->ai_addr, ptr_addrinfo->ai_addr,
+                ptr_addrinfo->ai_addrlen);
+        new_addrinfo->ai_canonname = NULL;
+        new_addrinfo->ai_next = NULL;
+        if (last)
+            last->ai_next = new_addrinfo;
+        else
+            result = new_addrinfo;
+        last = new_addrinfo;
+    }
+
+    return result;
+}
+
+/*
+ * Frees a list of addresses returned by resolve_dup_addrinfo.
+ */
+
+void
+resolve_free_addrinfo (struct addrinfo *addrinfo)
+{
+    struct addrinfo *ptr_next;
+
+    while (addrinfo)
+    {
+        ptr_next = addrinfo->ai_next;
+        free (addrinfo);
+        addrinfo = ptr_next;
+    }
+}
+
+/*
+ * Frees a request.
+ */
+
+void
+resolve_request_free (struct t_resolve_request *request)
+{
+    if (request->hostname)
+        free (request->hostname);
+    if (request->service)
+        free (request->service);
+    if (request->key)
+        free (request->key);
+    if (request->result)
+    {
+        if (request->result_cached)
+            resolve_free_addrinfo (request->result);
+        else
+            freeaddrinfo (request->result);
+    }
+    free (request);
+}
+
+/*
+ * Adds a request at the end of a list (the mutex must be locked).
+ */
+
+void
+resolve_list_add (struct t_resolve_request **list,
+                  struct t_resolve_request **last,
+                  struct t_resolve_request *request)
+{
+    request->next_request = NULL;
+    if (*last)
+        (*last)->next_request = request;
+    else
+        *list = request;
+    *last = request;
+}
+
+/*
+ * Adds a request in list of requests resolved and wakes up main thread (the
+ * mutex must be locked).
+ */
+
+void
+resolve_add_done (struct t_resolve_request *request)
+{
+    int num_written;
+
+    resolve_list_add (&resolve_done, &last_resolve_done, request);
+    if (resolve_pipe[1] >= 0)
+    {
+        num_written = write (resolve_pipe[1], "1", 1);
+        (void) num_written;
+    }
+}
+
+/*
+ * Resolves names (function executed by threads).
+ */
+
+void *
+resolve_thread (void *arg)
+{
+    struct t_resolve_request *request;
+    struct addrinfo hints, *result;
+    int rc;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&resolve_mutex);
+
+    while (1)
+    {
+        while (!resolve_queue && !resolve_ending)
+        {
+            resolve_threads_idle++;
+            pthread_cond_wait (&resolve_cond, &resolve_mutex);
+            resolve_threads_idle--;
+        }
+        if (resolve_ending)
+            break;
+
+        /* take first request in queue */
+        request = resolve_queue;
+        resolve_queue = request->next_request;
+        if (!resolve_queue)
+            last_resolve_queue = NULL;
+        request->next_request = NULL;
+        request->running = 1;
+
+        pthread_mutex_unlock (&resolve_mutex);
+
+        memset (&hints, 0, sizeof (hints));
+        hints.ai_family = request->family;
+        hints.ai_socktype = SOCK_STREAM;
+#ifdef AI_ADDRCONFIG
+        hints.ai_flags = AI_ADDRCONFIG;
+#endif
+        result = NULL;
+        rc = getaddrinfo (request->hostname, request->service, &hints,
+                          &result);
+
+        pthread_mutex_lock (&resolve_mutex);
+
+        request->rc = rc;
+        request->result = (rc == 0) ? result : NULL;
+        if (resolve_ending)
+            resolve_request_free (request);
+        else
+            resolve_add_done (request);
+    }
+
+    resolve_threads--;
+
+    pthread_mutex_unlock (&resolve_mutex);
+
+    return NULL;
+}
+
+/*
+ * Searches a result in cache (expired entries are removed).
+ *
+ * Returns pointer to entry found, NULL if not found.
+ */
+
+struct t_resolve_cache *
+resolve_cache_search (const char *key)
+{
+    struct t_resolve_cache *ptr_cache, *prev_cache, *next_cache;
+    time_t now;
+
+    now = time (NULL);
+
+    prev_cache = NULL;
+    ptr_cache = resolve_cache;
+    while (ptr_cache)
+    {
+        next_cache = ptr_cache->next_cache;
+        if (now >= ptr_cache->expire)
+        {
+            if (prev_cache)
+                prev_cache->next_cache = next_cache;
+            else
+                resolve_cache = next_cache;
+            free (ptr_cache->key);
+            resolve_free_addrinfo (ptr_cache->result);
+            free (ptr_cache);
+        }
+        else
+        {
+            if (strcmp (ptr_cache->key, key) == 0)
+                return ptr_cache;
+            prev_cache = ptr_cache;
+        }
+        ptr_cache = next_cache;
+    }
+
+    /* not found */
+    return NULL;
+}
+
+/*
+ * Adds a result in cache (if enabled).
+ */
+
+void
+resolve_cache_add (const char *key, struct addrinfo *result)
+{
+    struct t_resolve_cache *new_cache;
+
+    if ((CONFIG_INTEGER(config_network_dns_cache_ttl) <= 0)
+        || resolve_cache_search (key))
+    {
+        return;
+    }
+
+    new_cache = malloc (sizeof (*new_cache));
+    if (!new_cache)
+        return;
+    new_cache->key = strdup (key);
+    new_cache->result = resolve_dup_addrinfo (result);
+    if (!new_cache->key || !new_cache->result)
+    {
+        if (new_cache->key)
+            free (new_cache->key);
+        resolve_free_addrinfo (new_cache->result);
+        free (new_cache);
+        return;
+    }
+    new_cache->expire = time (NULL) +
+        CONFIG_INTEGER(config_network_dns_cache_ttl);
+    new_cache->next_cache = resolve_cache;
+    resolve_cache = new_cache;
+}
+
+/*
+ * Removes all entries from cache.
+ */
+
+void
+resolve_cache_flush ()
+{
+    struct t_resolve_cache *ptr_next_cache;
+
+    while (resolve_cache)
+    {
+        ptr_next_cache = resolve_cache->next_cache;
+        free (resolve_cache->key);
+        resolve_free_addrinfo (resolve_cache->result);
+        free (resolve_cache);
+        resolve_cache = ptr_next_cache;
+    }
+}
+
+/*
+ * Sends results of requests resolved to callbacks (called in main thread
+ * when pipe is readable).
+ */
+
+int
+resolve_pipe_read_cb (void *data, int fd)
+{
+    struct t_resolve_request *list, *ptr_next_request;
+    struct addrinfo *result;
+    char buffer[64];
+
+    /* make C compiler happy */
+    (void) data;
+
+    while (read (fd, buffer, sizeof (buffer)) > 0)
+    {
+    }
+
+    pthread_mutex_lock (&resolve_mutex);
+    list = resolve_done;
+    resolve_done = NULL;
+    last_resolve_done = NULL;
+    pthread_mutex_unlock (&resolve_mutex);
+
+    while (list)
+    {
+        ptr_next_request = list->next_request;
+        if (!list->cancelled)
+        {
+            if ((list->rc == 0) && list->result && !list->result_cached)
+                resolve_cache_add (list->key, list->result);
+            result = (list->rc == 0) ?
+                resolve_dup_addrinfo (list->result) : NULL;
+            (list->callback) (list->callback_data, list->rc, result);
+        }
+        resolve_request_free (list);
+        list = ptr_next_request;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Initializes pipe and fd hook (first time a request is made).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+resolve_init ()
+{
+    int i, flags;
+
+    if (resolve_hook_fd)
+        return 1;
+
+    if (resolve_ending || (pipe (resolve_pipe) < 0))
+        return 0;
+
+    for (i = 0; i < 2; i++)
+    {
+        flags = fcntl (resolve_pipe[i], F_GETFL);
+        if (flags == -1)
+            flags = 0;
+        fcntl (resolve_pipe[i], F_SETFL, flags | O_NONBLOCK);
+        fcntl (resolve_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    resolve_hook_fd = hook_fd (NULL, resolve_pipe[0], 1, 0, 0,
+                               &resolve_pipe_read_cb, NULL);
+    if (!resolve_hook_fd)
+    {
+        close (resolve_pipe[0]);
+        close (resolve_pipe[1]);
+        resolve_pipe[0] = -1;
+        resolve_pipe[1] = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Resolves a name (asynchronously): the callback is always called later, in
+ * main thread (even if result is found in cache).
+ *
+ * Returns pointer to new request, NULL if error.
+ */
+
+struct t_resolve_request *
+resolve_new (const char *hostname, const char *service, int family,
+             t_resolve_callback *callback, void *callback_data)
+{
+    struct t_resolve_request *new_request;
+    struct t_resolve_cache *ptr_cache;
+    pthread_t thread;
+    pthread_attr_t attr;
+    int length, threads;
+
+    if (!hostname || !callback || !resolve_init ())
+        return NULL;
+
+    new_request = malloc (sizeof (*new_request));
+    if (!new_request)
+        return NULL;
+
+    new_request->hostname = strdup (hostname);
+    new_request->service = (service) ? strdup (service) : NULL;
+    new_request->family = family;
+    length = 16 + ((service) ? strlen (service) : 0) + strlen (hostname) + 1;
+    new_request->key = malloc (length);
+    if (new_request->key)
+    {
+        snprintf (new_request->key, length, "%d/%s/%s",
+                  family, (service) ? service : "", hostname);
+    }
+    new_request->callback = callback;
+    new_request->callback_data = callback_data;
+    new_request->running = 0;
+    new_request->cancelled = 0;
+    new_request->rc = 0;
+    new_request->result = NULL;
+    new_request->result_cached = 0;
+    new_request->next_request = NULL;
+
+    if (!new_request->hostname || (service && !new_request->service)
+        || !new_request->key)
+    {
+        resolve_request_free (new_request);
+        return NULL;
+    }
+
+    /* result in cache? */
+    ptr_cache = resolve_cache_search (new_request->key);
+    if (ptr_cache)
+    {
+        new_request->result = resolve_dup_addrinfo (ptr_cache->result);
+        new_request->result_cached = 1;
+        if (new_request->result)
+        {
+            pthread_mutex_lock (&resolve_mutex);
+            resolve_add_done (new_request);
+            pthread_mutex_unlock (&resolve_mutex);
+            return new_request;
+        }
+    }
+
+    pthread_mutex_lock (&resolve_mutex);
+
+    resolve_list_add (&resolve_queue, &last_resolve_queue, new_request);
+
+    /* start a new thread if all threads are busy */
+    if ((resolve_threads_idle == 0)
+        && (resolve_threads < RESOLVE_MAX_THREADS))
+    {
+        pthread_attr_init (&attr);
+        pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create (&thread, &attr, &resolve_thread, NULL) == 0)
+            resolve_threads++;
+        pthread_attr_destroy (&attr);
+    }
+
+    pthread_cond_signal (&resolve_cond);
+
+    threads = resolve_threads;
+
+    pthread_mutex_unlock (&resolve_mutex);
+
+    if (threads == 0)
+    {
+        /* no thread at all: unable to resolve name */
+        resolve_cancel (new_request);
+        return NULL;
+    }
+
+    return new_request;
+}
+
+/*
+ * Cancels a request: the callback will not be called.
+ */
+
+void
+resolve_cancel (struct t_resolve_request *request)
+{
+    struct t_resolve_request *ptr_request, *prev_request;
+
+    if (!request)
+        return;
+
+    pthread_mutex_lock (&resolve_mutex);
+
+    /* request still in queue? then remove it and free it */
+    prev_request = NULL;
+    for (ptr_request = resolve_queue; ptr_request;
+         ptr_request = ptr_request->next_request)
+    {
+        if (ptr_request == request)
+        {
+            if (prev_request)
+                prev_request->next_request = request->next_request;
+            else
+                resolve_queue = request->next_request;
+            if (last_resolve_queue == request)
+                last_resolve_queue = prev_request;
+            resolve_request_free (request);
+            pthread_mutex_unlock (&resolve_mutex);
+            return;
+        }
+        prev_request = ptr_request;
+    }
+
+    /* request running or resolved: it will be freed in main thread */
+    request->cancelled = 1;
+
+    pthread_mutex_unlock (&resolve_mutex);
+}
+
+/*
+ * Stops threads and frees all requests and cache.
+ *
+ * This function must be called after removal of all hooks (the fd hook on
+ * pipe is not removed here). Threads still running getaddrinfo free their
+ * request and exit.
+ */
+
+void
+resolve_end ()
+{
+    struct t_resolve_request *ptr_next_request;
+
+    pthread_mutex_lock (&resolve_mutex);
+
+    resolve_ending = 1;
+
+    while (resolve_queue)
+    {
+        ptr_next_request = resolve_queue->next_request;
+        resolve_request_free (resolve_queue);
+        resolve_queue = ptr_next_request;
+    }
+    last_resolve_queue = NULL;
+    while (resolve_done)
+    {
+        ptr_next_request = resolve_done->next_request;
+        resolve_request_free (resolve_done);
+        resolve_done = ptr_next_request;
+    }
+    last_resolve_done = NULL;
+
+    if (resolve_pipe[0] >= 0)
+    {
+        close (resolve_pipe[0]);
+        close (resolve_pipe[1]);
+        resolve_pipe[0] = -1;
+        resolve_pipe[1] = -1;
+    }
+
+    pthread_cond_broadcast (&resolve_cond);
+
+    pthread_mutex_unlock (&resolve_mutex);
+
+    resolve_hook_fd = NULL;
+
+    resolve_cache_flush ();
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RESOLVE_H
+#define WEECHAT_RESOLVE_H 1
+
+#include <time.h>
+
+/* number of threads used to resolve names */
+#define RESOLVE_MAX_THREADS 4
+
+struct addrinfo;
+
+/*
+ * callback called (in main thread) when a name is resolved; "rc" is the
+ * return code of getaddrinfo and "result" must be freed by the callback with
+ * resolve_free_addrinfo (the request itself is freed after the callback)
+ */
+
+typedef void (t_resolve_callback)(void *data, int rc,
+                                  struct addrinfo *result);
+
+struct t_resolve_request
+{
+    char *hostname;                    /* name to resolve                   */
+    char *service;                     /* service (port), can be NULL       */
+    int family;                        /* family (AF_INET, AF_UNSPEC, ...)  */
+    char *key;                         /* key in cache                      */
+    t_resolve_callback *callback;      /* callback (called in main thread)  */
+    void *callback_data;               /* data sent to callback             */
+    int running;                       /* 1 if resolved by a thread         */
+    int cancelled;                     /* 1 if request was cancelled        */
+    int rc;                            /* return code of getaddrinfo        */
+    struct addrinfo *result;           /* result of getaddrinfo             */
+    int result_cached;                 /* 1 if result comes from cache      */
+    struct t_resolve_request *next_request; /* link to next request         */
+};
+
+struct t_resolve_cache
+{
+    char *key;                         /* hostname, service and family      */
+    struct addrinfo *result;           /* addresses (copy)                  */
+    time_t expire;                     /* end of validity                   */
+    struct t_resolve_cache *next_cache; /* link to next entry               */
+};
+
+extern struct t_resolve_cache *resolve_cache;
+
+extern struct addrinfo *resolve_dup_addrinfo (struct addrinfo *addrinfo);
+extern void resolve_free_addrinfo (struct addrinfo *addrinfo);
+extern struct t_resolve_request *resolve_new (const char *hostname,
+                                              const char *service,
+                                              int family,
+                                              t_resolve_callback *callback,
+                                              void *callback_data);
+extern void resolve_cancel (struct t_resolve_request *request);
+extern void resolve_cache_flush ();
+extern void resolve_end ();
+
+#endif /* WEECHAT_RESOLVE_H */
@@ -28,8 +28,11 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "weechat.h"
 #include "wee-upgrade-file.h"
@@ -175,6 +178,75 @@ upgrade_file_write_buffer (struct t_upgrade_file *upgrade_file, void *pointer,
     return 1;
 }
 
+/*
+ * Loads content of an upgrade file (for reading): the file is mapped in
+ * memory (or read in a buffer if mmap is not possible).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_load (struct t_upgrade_file *upgrade_file)
+{
+    struct stat st;
+    ssize_t num_read;
+    long pos;
+    int fd;
+
+    fd = open (upgrade_file->filename, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    if ((fstat (fd, &st) != 0) || !S_ISREG(st.st_mode))
+    {
+        close (fd);
+        return 0;
+    }
+
+    upgrade_file->data_size = (long)st.st_size;
+    if (upgrade_file->data_size > 0)
+    {
+        upgrade_file->data = mmap (NULL, upgrade_file->data_size, PROT_READ,
+                                   MAP_PRIVATE, fd, 0);
+        if (upgrade_file->data != MAP_FAILED)
+        {
+            upgrade_file->data_mmap = 1;
+        }
+        else
+        {
+            /* mmap not possible: read the whole file */
+            upgrade_file->data = malloc (upgrade_file->data_size);
+            if (!upgrade_file->data)
+            {
+                close (fd);
+                return 0;
+            }
+            pos = 0;
+            while (pos < upgrade_file->data_size)
+            {
+                num_read = read (fd, upgrade_file->data + pos,
+                                 upgrade_file->data_size - pos);
+                if (num_read < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    break;
+                }
+                if (num_read == 0)
+                    break;
+                pos += num_read;
+            }
+            upgrade_file->data_size = pos;
+        }
+    }
+
+    close (fd);
+
+    return 1;
+}
+
 /*
  * Creates an upgrade file.
  *
@@ -206,13 +278,27 @@ upgrade_file_new (const char *filename, int write)
         snprintf (new_upgrade_file->filename, length, "%s/%s.upgrade",
                   weechat_home, filename);
 
-        /* open file in read or write mode */
+        new_upgrade_file->file = NULL;
+        new_upgrade_file->data = NULL;
+        new_upgrade_file->data_size = 0;
+        new_upgrade_file->data_pos = 0;
+        new_upgrade_file->data_mmap = 0;
+
+        /*
+         * open file in write mode (with a large buffer), or load content
+         * of file in read mode
+         */
         if (write)
+        {
             new_upgrade_file->file = fopen (new_upgrade_file->filename, "wb");
-        else
-            new_upgrade_file->file = fopen (new_upgrade_file->filename, "rb");
-
-        if (!new_upgrade_file->file)
+            if (new_upgrade_file->file)
+            {
+                setvbuf (new_upgrade_file->file, NULL, _IOFBF,
+                         UPGRADE_FILE_BUFFER_SIZE);
+            }
+        }
+        if ((write && !new_upgrade_file->file)
+            || (!write && !upgrade_file_load (new_upgrade_file)))
         {
             free (new_upgrade_file->filename);
             free (new_upgrade_file);
@@ -228,9 +314,12 @@ upgrade_file_new (const char *filename, int write)
             upgrade_file_write_string (new_upgrade_file, UPGRADE_SIGNATURE);
         }
 
-        /* init positions */
+        /* init positions and callbacks */
         new_upgrade_file->last_read_pos = 0;
         new_upgrade_file->last_read_length = 0;
+        new_upgrade_file->callback_read = NULL;
+        new_upgrade_file->callback_read_block = NULL;
+        new_upgrade_file->callback_read_data = NULL;
 
         /* add upgrade file to list of upgrade files */
         new_upgrade_file->prev_upgrade = last_upgrade_file;
@@ -401,7 +490,89 @@ upgrade_file_write_object (struct t_upgrade_file *upgrade_file, int object_id,
 }
 
 /*
- * Reads an integer in upgrade file.
+ * Creates a new block of objects for writing.
+ *
+ * Argument "columns" is a list of variables with types, separated by
+ * commas, like fields of an infolist (for example: "i:y,t:date,s:message");
+ * allowed types are: "i" (integer), "t" (time) and "s" (string).
+ *
+ * Values must be added row by row, in the order of columns; the block is
+ * written in file each time UPGRADE_BLOCK_MAX_ROWS rows are added, and the
+ * remaining rows must be written with function upgrade_file_block_write.
+ *
+ * Returns pointer to new block, NULL if error.
+ */
+
+struct t_upgrade_block *
+upgrade_file_block_new (struct t_upgrade_file *upgrade_file, int object_id,
+                        const char *columns)
+{
+    struct t_upgrade_block *new_block;
+    char **argv;
+    int i, argc, type;
+
+    if (!upgrade_file || !columns)
+        return NULL;
+
+    argv = string_split (columns, ",", 0, 0, &argc);
+    if (!argv)
+        return NULL;
+
+    new_block = malloc (sizeof (*new_block));
+    if (!new_block)
+    {
+        string_free_split (argv);
+        return NULL;
+    }
+    new_block->upgrade_file = upgrade_file;
+    new_block->object_id = object_id;
+    new_block->num_columns = 0;
+    new_block->columns = calloc (argc, sizeof (*new_block->columns));
+    new_block->num_rows = 0;
+    new_block->current_column = 0;
+    new_block->current_row = 0;
+    if (!new_block->columns)
+    {
+        string_free_split (argv);
+        free (new_block);
+        return NULL;
+    }
+
+    for (i = 0; i < argc; i++)
+    {
+        switch (argv[i][0])
+        {
+            case 'i':
+                type = INFOLIST_INTEGER;
+                break;
+            case 's':
+                type = INFOLIST_STRING;
+                break;
+            case 't':
+                type = INFOLIST_TIME;
+                break;
+            default:
+                type = -1;
+                break;
+        }
+        if ((type < 0) || (argv[i][1] != ':') || !argv[i][2])
+        {
+            string_free_split (argv);
+            upgrade_file_block_free (new_block);
+            return NULL;
+        }
+        new_block->columns[i].name = strdup (argv[i] + 2);
+        new_block->columns[i].type = type;
+        new_block->num_columns++;
+    }
+
+    string_free_split (argv);
+
+    return new_block;
+}
+
+/*
+ * Adds a value in current column of a block.
  *
  * Returns:
  *   1: OK
@@ -409,24 +580,265 @@ upgrade_file_write_object (struct t_upgrade_file *upgrade_file, int object_id,
  */
 
 int
-upgrade_file_read_integer (struct t_upgrade_file *upgrade_file, int *value)
+upgrade_file_block_add_value (struct t_upgrade_block *block, int type,
+                              const void *value1, int size1,
+                              const void *value2, int size2)
 {
-    upgrade_file->last_read_pos = ftell (upgrade_file->file);
-    upgrade_file->last_read_length = sizeof (*value);
+    struct t_upgrade_block_column *ptr_column;
+    char *new_data;
+    int new_alloc;
 
-    if (value)
+    if (!block || (block->num_columns == 0))
+        return 0;
+
+    ptr_column = &(block->columns[block->current_column]);
+    if (ptr_column->type != type)
+        return 0;
+
+    if (ptr_column->size + size1 + size2 > ptr_column->alloc)
     {
-        if (fread ((void *)value, sizeof (*value), 1, upgrade_file->file) <= 0)
+        new_alloc = (ptr_column->alloc > 0) ? ptr_column->alloc * 2 : 4096;
+        while (ptr_column->size + size1 + size2 > new_alloc)
+        {
+            new_alloc *= 2;
+        }
+        new_data = realloc (ptr_column->data, new_alloc);
+        if (!new_data)
             return 0;
+        ptr_column->data = new_data;
+        ptr_column->alloc = new_alloc;
     }
-    else
+    memcpy (ptr_column->data + ptr_column->size, value1, size1);
+    ptr_column->size += size1;
+    if (value2 && (size2 > 0))
+    {
+        memcpy (ptr_column->data + ptr_column->size, value2, size2);
+        ptr_column->size += size2;
+    }
+
+    /* end of row? */
+    block->current_column++;
+    if (block->current_column >= block->num_columns)
     {
-        if (fseek (upgrade_file->file, sizeof (*value), SEEK_CUR) < 0)
+        block->current_column = 0;
+        block->num_rows++;
+        if (block->num_rows >= UPGRADE_BLOCK_MAX_ROWS)
+            return upgrade_file_block_write (block);
+    }
+
+    return 1;
+}
+
+/*
+ * Adds an integer in current column of a block.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_block_add_integer (struct t_upgrade_block *block, int value)
+{
+    return upgrade_file_block_add_value (block, INFOLIST_INTEGER,
+                                         &value, sizeof (value), NULL, 0);
+}
+
+/*
+ * Adds a time in current column of a block.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_block_add_time (struct t_upgrade_block *block, time_t value)
+{
+    return upgrade_file_block_add_value (block, INFOLIST_TIME,
+                                         &value, sizeof (value), NULL, 0);
+}
+
+/*
+ * Adds a string in current column of a block (string can be NULL).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_block_add_string (struct t_upgrade_block *block,
+                               const char *value)
+{
+    int length;
+
+    if (!value)
+    {
+        length = -1;
+        return upgrade_file_block_add_value (block, INFOLIST_STRING,
+                                             &length, sizeof (length),
+                                             NULL, 0);
+    }
+
+    /* the final '\0' is written, so that strings can be read in place */
+    length = strlen (value);
+    return upgrade_file_block_add_value (block, INFOLIST_STRING,
+                                         &length, sizeof (length),
+                                         value, length + 1);
+}
+
+/*
+ * Writes rows of a block in upgrade file (rows are then removed from
+ * block, so the block can be used again).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_block_write (struct t_upgrade_block *block)
+{
+    struct t_upgrade_file *upgrade_file;
+    int i;
+
+    if (!block)
+        return 0;
+
+    upgrade_file = block->upgrade_file;
+
+    if (block->current_column != 0)
+    {
+        UPGRADE_ERROR(_("write - block"), "incomplete row");
+        return 0;
+    }
+
+    if (block->num_rows == 0)
+        return 1;
+
+    if (!upgrade_file_write_integer (upgrade_file, UPGRADE_TYPE_BLOCK))
+    {
+        UPGRADE_ERROR(_("write - object type"), "block");
+        return 0;
+    }
+    if (!upgrade_file_write_integer (upgrade_file, block->object_id))
+    {
+        UPGRADE_ERROR(_("write - object id"), "");
+        return 0;
+    }
+
+    /* write names and types of columns */
+    if (!upgrade_file_write_integer (upgrade_file, block->num_columns))
+    {
+        UPGRADE_ERROR(_("write - block"), "number of columns");
+        return 0;
+    }
+    for (i = 0; i < block->num_columns; i++)
+    {
+        if (!upgrade_file_write_string (upgrade_file, block->columns[i].name))
+        {
+            UPGRADE_ERROR(_("write - variable name"), "");
+            return 0;
+        }
+        if (!upgrade_file_write_integer (upgrade_file, block->columns[i].type))
+        {
+            UPGRADE_ERROR(_("write - infolist type"), "");
+            return 0;
+        }
+    }
+
+    /* write values, column by column */
+    if (!upgrade_file_write_integer (upgrade_file, block->num_rows))
+    {
+        UPGRADE_ERROR(_("write - block"), "number of rows");
+        return 0;
+    }
+    for (i = 0; i < block->num_columns; i++)
+    {
+        if (!upgrade_file_write_buffer (upgrade_file, block->columns[i].data,
+                                        block->columns[i].size))
+        {
+            UPGRADE_ERROR(_("write - variable"), block->columns[i].name);
             return 0;
+        }
+        block->columns[i].size = 0;
+    }
+
+    block->num_rows = 0;
+
+    return 1;
+}
+
+/*
+ * Frees a block.
+ */
+
+void
+upgrade_file_block_free (struct t_upgrade_block *block)
+{
+    int i;
+
+    if (!block)
+        return;
+
+    if (block->columns)
+    {
+        for (i = 0; i < block->num_columns; i++)
+        {
+            if (block->columns[i].name)
+                free (block->columns[i].name);
+            if (block->columns[i].data)
+                free (block->columns[i].data);
+        }
+        free (block->columns);
+    }
+
+    free (block);
+}
+
+/*
+ * Reads data in upgrade file (if "data" is NULL, data is skipped).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_read_data (struct t_upgrade_file *upgrade_file, void *data,
+                        int size)
+{
+    upgrade_file->last_read_pos = upgrade_file->data_pos;
+    upgrade_file->last_read_length = size;
+
+    if ((size < 0)
+        || (size > upgrade_file->data_size - upgrade_file->data_pos))
+    {
+        return 0;
     }
+
+    if (data && (size > 0))
+        memcpy (data, upgrade_file->data + upgrade_file->data_pos, size);
+    upgrade_file->data_pos += size;
+
     return 1;
 }
 
+/*
+ * Reads an integer in upgrade file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_read_integer (struct t_upgrade_file *upgrade_file, int *value)
+{
+    return upgrade_file_read_data (upgrade_file, value, sizeof (*value));
+}
+
 /*
  * Reads a string in upgrade file.
  *
@@ -449,19 +861,19 @@ upgrade_file_read_string (struct t_upgrade_file *upgrade_file, char **string)
     if (!upgrade_file_read_integer (upgrade_file, &length))
         return 0;
 
-    upgrade_file->last_read_pos = ftell (upgrade_file->file);
-    upgrade_file->last_read_length = length;
-
     if (string)
     {
         if (length == 0)
             return 1;
 
+        if (length < 0)
+            return 0;
+
         (*string) = malloc (length + 1);
         if (!(*string))
             return 0;
 
-        if (fread ((void *)(*string), length, 1, upgrade_file->file) <= 0)
+        if (!upgrade_file_read_data (upgrade_file, *string, length))
         {
             free (*string);
             *string = NULL;
@@ -471,7 +883,7 @@ upgrade_file_read_string (struct t_upgrade_file *upgrade_file, char **string)
     }
     else
     {
-        if (fseek (upgrade_file->file, length, SEEK_CUR) < 0)
+        if (!upgrade_file_read_data (upgrade_file, NULL, length))
             return 0;
     }
     return 1;
@@ -524,21 +936,10 @@ upgrade_file_read_buffer (struct t_upgrade_file *upgrade_file,
 
     if (*size > 0)
     {
-        upgrade_file->last_read_pos = ftell (upgrade_file->file);
-        upgrade_file->last_read_length = *size;
-
         *buffer = malloc (*size);
 
-        if (*buffer)
-        {
-            if (fread (*buffer, *size, 1, upgrade_file->file) <= 0)
-                return 0;
-        }
-        else
-        {
-            if (fseek (upgrade_file->file, *size, SEEK_CUR) < 0)
-                return 0;
-        }
+        if (!upgrade_file_read_data (upgrade_file, *buffer, *size))
+            return 0;
     }
 
     return 1;
@@ -555,23 +956,336 @@ upgrade_file_read_buffer (struct t_upgrade_file *upgrade_file,
 int
 upgrade_file_read_time (struct t_upgrade_file *upgrade_file, time_t *time)
 {
-    upgrade_file->last_read_pos = ftell (upgrade_file->file);
-    upgrade_file->last_read_length = sizeof (*time);
+    return upgrade_file_read_data (upgrade_file, time, sizeof (*time));
+}
+
+/*
+ * Searches a column in a block.
+ *
+ * Returns index of column, -1 if not found.
+ */
 
-    if (time)
+int
+upgrade_file_block_column (struct t_upgrade_block *block, const char *name)
+{
+    int i;
+
+    if (!block || !name)
+        return -1;
+
+    for (i = 0; i < block->num_columns; i++)
     {
-        if (fread ((void *)time, sizeof (*time), 1, upgrade_file->file) <= 0)
-            return 0;
+        if (strcmp (block->columns[i].name, name) == 0)
+            return i;
     }
-    else
+
+    /* column not found */
+    return -1;
+}
+
+/*
+ * Moves to next row of a block read in upgrade file (values of row are read
+ * with functions upgrade_file_block_integer/time/string).
+ *
+ * Returns:
+ *   1: OK
+ *   0: no more rows (or error)
+ */
+
+int
+upgrade_file_block_next_row (struct t_upgrade_block *block)
+{
+    struct t_upgrade_file *upgrade_file;
+    struct t_upgrade_block_column *ptr_column;
+    int i, length;
+
+    if (!block || (block->current_row >= block->num_rows))
+        return 0;
+
+    upgrade_file = block->upgrade_file;
+
+    for (i = 0; i < block->num_columns; i++)
+    {
+        ptr_column = &(block->columns[i]);
+        switch (ptr_column->type)
+        {
+            case INFOLIST_INTEGER:
+                if (ptr_column->ptr_read_end - ptr_column->ptr_read
+                    < (int)sizeof (ptr_column->value_integer))
+                {
+                    goto error;
+                }
+                memcpy (&(ptr_column->value_integer), ptr_column->ptr_read,
+                        sizeof (ptr_column->value_integer));
+                ptr_column->ptr_read += sizeof (ptr_column->value_integer);
+                break;
+            case INFOLIST_TIME:
+                if (ptr_column->ptr_read_end - ptr_column->ptr_read
+                    < (int)sizeof (ptr_column->value_time))
+                {
+                    goto error;
+                }
+                memcpy (&(ptr_column->value_time), ptr_column->ptr_read,
+                        sizeof (ptr_column->value_time));
+                ptr_column->ptr_read += sizeof (ptr_column->value_time);
+                break;
+            case INFOLIST_STRING:
+                if (ptr_column->ptr_read_end - ptr_column->ptr_read
+                    < (int)sizeof (length))
+                {
+                    goto error;
+                }
+                memcpy (&length, ptr_column->ptr_read, sizeof (length));
+                ptr_column->ptr_read += sizeof (length);
+                if (length < 0)
+                {
+                    ptr_column->value_string = NULL;
+                }
+                else
+                {
+                    if ((ptr_column->ptr_read_end - ptr_column->ptr_read
+                         < length + 1)
+                        || (ptr_column->ptr_read[length] != '\0'))
+                    {
+                        goto error;
+                    }
+                    ptr_column->value_string = ptr_column->ptr_read;
+                    ptr_column->ptr_read += length + 1;
+                }
+                break;
+            default:
+                goto error;
+        }
+    }
+
+    block->current_row++;
+
+    return 1;
+
+error:
+    UPGRADE_ERROR(_("read - block"), block->columns[i].name);
+    block->current_row = block->num_rows;
+    return 0;
+}
+
+/*
+ * Gets integer value of a column in current row of a block.
+ */
+
+int
+upgrade_file_block_integer (struct t_upgrade_block *block, int column)
+{
+    if (!block || (column < 0) || (column >= block->num_columns)
+        || (block->columns[column].type != INFOLIST_INTEGER))
+    {
+        return 0;
+    }
+
+    return block->columns[column].value_integer;
+}
+
+/*
+ * Gets time value of a column in current row of a block.
+ */
+
+time_t
+upgrade_file_block_time (struct t_upgrade_block *block, int column)
+{
+    if (!block || (column < 0) || (column >= block->num_columns)
+        || (block->columns[column].type != INFOLIST_TIME))
+    {
+        return 0;
+    }
+
+    return block->columns[column].value_time;
+}
+
+/*
+ * Gets string value of a column in current row of a block.
+ *
+ * Note: the string is in the upgrade file content, it is valid until the
+ * upgrade file is closed.
+ */
+
+const char *
+upgrade_file_block_string (struct t_upgrade_block *block, int column)
+{
+    if (!block || (column < 0) || (column >= block->num_columns)
+        || (block->columns[column].type != INFOLIST_STRING))
+    {
+        return NULL;
+    }
+
+    return block->columns[column].value_string;
+}
+
+/*
+ * Calls read callback for each row of a block (used when no block callback
+ * is defined): each row is sent as an infolist with one item.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_read_block_rows (struct t_upgrade_file *upgrade_file,
+                              struct t_upgrade_block *block)
+{
+    struct t_infolist *infolist;
+    struct t_infolist_item *item;
+    int i, rc;
+
+    while (upgrade_file_block_next_row (block))
     {
-        if (fseek (upgrade_file->file, sizeof (*time), SEEK_CUR) < 0)
+        infolist = infolist_new (NULL);
+        if (!infolist)
+        {
+            UPGRADE_ERROR(_("read - infolist creation"), "");
+            return 0;
+        }
+        item = infolist_new_item (infolist);
+        if (!item)
+        {
+            infolist_free (infolist);
+            UPGRADE_ERROR(_("read - infolist item creation"), "");
+            return 0;
+        }
+        for (i = 0; i < block->num_columns; i++)
+        {
+            switch (block->columns[i].type)
+            {
+                case INFOLIST_INTEGER:
+                    infolist_new_var_integer (item, block->columns[i].name,
+                                              block->columns[i].value_integer);
+                    break;
+                case INFOLIST_TIME:
+                    infolist_new_var_time (item, block->columns[i].name,
+                                           block->columns[i].value_time);
+                    break;
+                case INFOLIST_STRING:
+                    infolist_new_var_string (item, block->columns[i].name,
+                                             block->columns[i].value_string);
+                    break;
+            }
+        }
+        rc = (int)(upgrade_file->callback_read) (upgrade_file->callback_read_data,
+                                                 upgrade_file,
+                                                 block->object_id,
+                                                 infolist);
+        infolist_free (infolist);
+        if (rc == WEECHAT_RC_ERROR)
             return 0;
     }
 
     return 1;
 }
 
+/*
+ * Reads a block in upgrade file (type "block" has already been read) and
+ * calls block callback (or read callback for each row).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_read_block (struct t_upgrade_file *upgrade_file)
+{
+    struct t_upgrade_block *block;
+    int i, rc, size;
+
+    block = calloc (1, sizeof (*block));
+    if (!block)
+    {
+        UPGRADE_ERROR(_("read - block"), "");
+        return 0;
+    }
+    block->upgrade_file = upgrade_file;
+
+    rc = 0;
+
+    if (!upgrade_file_read_integer (upgrade_file, &block->object_id))
+    {
+        UPGRADE_ERROR(_("read - object id"), "");
+        goto end;
+    }
+
+    /* read names and types of columns */
+    if (!upgrade_file_read_integer (upgrade_file, &block->num_columns)
+        || (block->num_columns <= 0))
+    {
+        block->num_columns = 0;
+        UPGRADE_ERROR(_("read - block"), "number of columns");
+        goto end;
+    }
+    block->columns = calloc (block->num_columns, sizeof (*block->columns));
+    if (!block->columns)
+    {
+        block->num_columns = 0;
+        UPGRADE_ERROR(_("read - block"), "");
+        goto end;
+    }
+    for (i = 0; i < block->num_columns; i++)
+    {
+        if (!upgrade_file_read_string (upgrade_file, &block->columns[i].name)
+            || !block->columns[i].name)
+        {
+            UPGRADE_ERROR(_("read - variable name"), "");
+            goto end;
+        }
+        if (!upgrade_file_read_integer (upgrade_file, &block->columns[i].type))
+        {
+            UPGRADE_ERROR(_("read - variable type"), "");
+            goto end;
+        }
+    }
+
+    /* values of columns are read in place */
+    if (!upgrade_file_read_integer (upgrade_file, &block->num_rows)
+        || (block->num_rows < 0))
+    {
+        UPGRADE_ERROR(_("read - block"), "number of rows");
+        goto end;
+    }
+    for (i = 0; i < block->num_columns; i++)
+    {
+        if (!upgrade_file_read_integer (upgrade_file, &size))
+        {
+            UPGRADE_ERROR(_("read - variable"), block->columns[i].name);
+            goto end;
+        }
+        block->columns[i].ptr_read = upgrade_file->data + upgrade_file->data_pos;
+        if (!upgrade_file_read_data (upgrade_file, NULL, size))
+        {
+            UPGRADE_ERROR(_("read - variable"), block->columns[i].name);
+            goto end;
+        }
+        block->columns[i].ptr_read_end = upgrade_file->data + upgrade_file->data_pos;
+    }
+
+    rc = 1;
+
+    if (upgrade_file->callback_read_block)
+    {
+        if ((int)(upgrade_file->callback_read_block) (upgrade_file->callback_read_data,
+                                                      upgrade_file,
+                                                      block->object_id,
+                                                      block) == WEECHAT_RC_ERROR)
+            rc = 0;
+    }
+    else if (upgrade_file->callback_read)
+    {
+        rc = upgrade_file_read_block_rows (upgrade_file, block);
+    }
+
+end:
+    upgrade_file_block_free (block);
+
+    return rc;
+}
+
 /*
  * Reads an object in upgrade file and calls read callback.
  *
@@ -599,13 +1313,19 @@ upgrade_file_read_object (struct t_upgrade_file *upgrade_file)
 
     if (!upgrade_file_read_integer (upgrade_file, &type))
     {
-        if (feof (upgrade_file->file))
+        if (upgrade_file->data_pos >= upgrade_file->data_size)
             rc = 1;
         else
             UPGRADE_ERROR(_("read - object type"), "");
         goto end;
     }
 
+    if (type == UPGRADE_TYPE_BLOCK)
+    {
+        rc = upgrade_file_read_block (upgrade_file);
+        goto end;
+    }
+
     if (type != UPGRADE_TYPE_OBJECT_START)
     {
         UPGRADE_ERROR(_("read - bad object type ('object start' expected)"), "");
@@ -724,6 +1444,24 @@ end:
     return rc;
 }
 
+/*
+ * Sets callback called when reading a block of objects (if not set, the read
+ * callback is called for each object of block).
+ *
+ * This function must be called before upgrade_file_read.
+ */
+
+void
+upgrade_file_set_callback_block (struct t_upgrade_file *upgrade_file,
+                                 int (*callback_read_block)(void *data,
+                                                            struct t_upgrade_file *upgrade_file,
+                                                            int object_id,
+                                                            struct t_upgrade_block *block))
+{
+    if (upgrade_file)
+        upgrade_file->callback_read_block = callback_read_block;
+}
+
 /*
  * Reads an upgrade file.
  *
@@ -755,7 +1493,9 @@ upgrade_file_read (struct t_upgrade_file *upgrade_file,
         return 0;
     }
 
-    if (!signature || (strcmp (signature, UPGRADE_SIGNATURE) != 0))
+    if (!signature
+        || ((strcmp (signature, UPGRADE_SIGNATURE) != 0)
+            && (strcmp (signature, UPGRADE_SIGNATURE_V2_2) != 0)))
     {
         UPGRADE_ERROR(_("read - bad signature (upgrade file format may have "
                         "changed since last version)"), "");
@@ -766,7 +1506,7 @@ upgrade_file_read (struct t_upgrade_file *upgrade_file,
 
     free (signature);
 
-    while (!feof (upgrade_file->file))
+    while (upgrade_file->data_pos < upgrade_file->data_size)
     {
         if (!upgrade_file_read_object (upgrade_file))
             return 0;
@@ -782,6 +1522,23 @@ upgrade_file_read (struct t_upgrade_file *upgrade_file,
 void
 upgrade_file_close (struct t_upgrade_file *upgrade_file)
 {
-    if (upgrade_file && upgrade_file->file)
+    if (!upgrade_file)
+        return;
+
+    if (upgrade_file->file)
+    {
         fclose (upgrade_file->file);
+        upgrade_file->file = NULL;
+    }
+    if (upgrade_file->data)
+    {
+        if (upgrade_file->data_mmap)
+            munmap (upgrade_file->data, upgrade_file->data_size);
+        else
+            free (upgrade_file->data);
+        upgrade_file->data = NULL;
+        upgrade_file->data_size = 0;
+        upgrade_file->data_pos = 0;
+        upgrade_file->data_mmap = 0;
+    }
 }
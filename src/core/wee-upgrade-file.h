@@ -20,7 +20,18 @@
 #ifndef WEECHAT_UPGRADE_FILE_H
 #define WEECHAT_UPGRADE_FILE_H 1
 
-#define UPGRADE_SIGNATURE "===== WeeChat Upgrade file v2.2 - binary, do not edit! ====="
+#include <stdio.h>
+#include <time.h>
+
+#define UPGRADE_SIGNATURE "===== WeeChat Upgrade file v2.3 - binary, do not edit! ====="
+/* files written by older versions can still be read (no blocks) */
+#define UPGRADE_SIGNATURE_V2_2 "===== WeeChat Upgrade file v2.2 - binary, do not edit! ====="
+
+/* size of buffer used to write upgrade file */
+#define UPGRADE_FILE_BUFFER_SIZE (256 * 1024)
+
+/* max rows in a block (a block is written when this number is reached) */
+#define UPGRADE_BLOCK_MAX_ROWS 4096
 
 #define UPGRADE_ERROR(msg1, msg2)                                       \
     upgrade_file_error(upgrade_file, msg1, msg2, __FILE__, __LINE__)
@@ -32,12 +43,48 @@ enum t_upgrade_type
     UPGRADE_TYPE_OBJECT_START = 0,
     UPGRADE_TYPE_OBJECT_END,
     UPGRADE_TYPE_OBJECT_VAR,
+    UPGRADE_TYPE_BLOCK,
+};
+
+/*
+ * A block contains many objects with same variables (for example buffer
+ * lines): the names and types of variables (columns) are written once, then
+ * values of each column are written together.
+ */
+
+struct t_upgrade_block_column
+{
+    char *name;                            /* name of column                */
+    int type;                              /* INFOLIST_INTEGER/STRING/TIME  */
+    char *data;                            /* values (write)                */
+    int size;                              /* size of values                */
+    int alloc;                             /* allocated size for values     */
+    const char *ptr_read;                  /* next value to read (read)     */
+    const char *ptr_read_end;              /* end of values (read)          */
+    int value_integer;                     /* value in current row (read)   */
+    time_t value_time;                     /* value in current row (read)   */
+    const char *value_string;              /* value in current row (read)   */
+};
+
+struct t_upgrade_block
+{
+    struct t_upgrade_file *upgrade_file;   /* upgrade file                  */
+    int object_id;                         /* object id                     */
+    int num_columns;                       /* number of columns             */
+    struct t_upgrade_block_column *columns; /* columns                      */
+    int num_rows;                          /* number of rows in block       */
+    int current_column;                    /* next column to add (write)    */
+    int current_row;                       /* current row (read)            */
 };
 
 struct t_upgrade_file
 {
     char *filename;                        /* filename with path            */
-    FILE *file;                            /* file pointer                  */
+    FILE *file;                            /* file pointer (write)          */
+    char *data;                            /* content of file (read)        */
+    long data_size;                        /* size of content (read)        */
+    long data_pos;                         /* position in content (read)    */
+    int data_mmap;                         /* 1 if content is mapped        */
     long last_read_pos;                    /* last read position            */
     int last_read_length;                  /* last read length              */
     int (*callback_read)                   /* callback called when reading  */
@@ -45,7 +92,12 @@ struct t_upgrade_file
      struct t_upgrade_file *upgrade_file,
      int object_id,
      struct t_infolist *infolist);
-    void *callback_read_data;              /* data sent to callback         */
+    int (*callback_read_block)             /* callback called when reading  */
+    (void *data,                           /* a block (optional: if NULL,   */
+     struct t_upgrade_file *upgrade_file,  /* callback_read is called for   */
+     int object_id,                        /* each row)                     */
+     struct t_upgrade_block *block);
+    void *callback_read_data;              /* data sent to callbacks        */
     struct t_upgrade_file *prev_upgrade;   /* link to previous upgrade file */
     struct t_upgrade_file *next_upgrade;   /* link to next upgrade file     */
 };
@@ -55,6 +107,31 @@ extern struct t_upgrade_file *upgrade_file_new (const char *filename,
 extern int upgrade_file_write_object (struct t_upgrade_file *upgrade_file,
                                       int object_id,
                                       struct t_infolist *infolist);
+extern struct t_upgrade_block *upgrade_file_block_new (struct t_upgrade_file *upgrade_file,
+                                                       int object_id,
+                                                       const char *columns);
+extern int upgrade_file_block_add_integer (struct t_upgrade_block *block,
+                                           int value);
+extern int upgrade_file_block_add_time (struct t_upgrade_block *block,
+                                        time_t value);
+extern int upgrade_file_block_add_string (struct t_upgrade_block *block,
+                                          const char *value);
+extern int upgrade_file_block_write (struct t_upgrade_block *block);
+extern void upgrade_file_block_free (struct t_upgrade_block *block);
+extern int upgrade_file_block_column (struct t_upgrade_block *block,
+                                      const char *name);
+extern int upgrade_file_block_next_row (struct t_upgrade_block *block);
+extern int upgrade_file_block_integer (struct t_upgrade_block *block,
+                                       int column);
+extern time_t upgrade_file_block_time (struct t_upgrade_block *block,
+                                       int column);
+extern const char *upgrade_file_block_string (struct t_upgrade_block *block,
+                                              int column);
+extern void upgrade_file_set_callback_block (struct t_upgrade_file *upgrade_file,
+                                             int (*callback_read_block)(void *data,
+                                                                        struct t_upgrade_file *upgrade_file,
+                                                                        int object_id,
+                                                                        struct t_upgrade_block *block));
 extern int upgrade_file_read (struct t_upgrade_file *upgrade_file,
                               int (*callback_read)(void *data,
                                                    struct t_upgrade_file *upgrade_file,
@@ -108,6 +108,154 @@ upgrade_weechat_save_history (struct t_upgrade_file *upgrade_file,
     return 1;
 }
 
+/*
+ * Saves lines of a buffer in a block of WeeChat upgrade file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_save_buffer_lines (struct t_upgrade_block *block,
+                                   struct t_gui_buffer *buffer)
+{
+    struct t_gui_line *ptr_line;
+    char *tags, *new_tags;
+    int i, length, tags_alloc, rc;
+
+    tags_alloc = 256;
+    tags = malloc (tags_alloc);
+    if (!tags)
+        return 0;
+
+    rc = 1;
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        /* build string with tags (the same string is used for all lines) */
+        length = 1;
+        for (i = 0; i < ptr_line->data->tags_count; i++)
+        {
+            length += strlen (ptr_line->data->tags_array[i]) + 1;
+        }
+        if (length > tags_alloc)
+        {
+            new_tags = realloc (tags, length);
+            if (!new_tags)
+            {
+                rc = 0;
+                break;
+            }
+            tags = new_tags;
+            tags_alloc = length;
+        }
+        tags[0] = '\0';
+        length = 0;
+        for (i = 0; i < ptr_line->data->tags_count; i++)
+        {
+            if (i > 0)
+                tags[length++] = ',';
+            strcpy (tags + length, ptr_line->data->tags_array[i]);
+            length += strlen (ptr_line->data->tags_array[i]);
+        }
+
+        rc = upgrade_file_block_add_integer (block, ptr_line->data->y)
+            && upgrade_file_block_add_time (block, ptr_line->data->date)
+            && upgrade_file_block_add_time (block,
+                                            ptr_line->data->date_printed)
+            && upgrade_file_block_add_string (
+                block, (ptr_line->data->tags_count > 0) ? tags : NULL)
+            && upgrade_file_block_add_string (block, ptr_line->data->prefix)
+            && upgrade_file_block_add_string (block, ptr_line->data->message)
+            && upgrade_file_block_add_integer (block,
+                                               ptr_line->data->highlight)
+            && upgrade_file_block_add_integer (
+                block,
+                (buffer->own_lines->last_read_line == ptr_line) ? 1 : 0);
+        if (!rc)
+            break;
+    }
+
+    free (tags);
+
+    return (rc) ? upgrade_file_block_write (block) : 0;
+}
+
+/*
+ * Saves a group of nicklist (with its nicks and subgroups) in a block of
+ * WeeChat upgrade file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_save_nicklist_group (struct t_upgrade_block *block,
+                                     struct t_gui_nick_group *group)
+{
+    struct t_gui_nick_group *ptr_group;
+    struct t_gui_nick *ptr_nick;
+
+    if (!upgrade_file_block_add_string (block, "group")
+        || !upgrade_file_block_add_string (
+            block, (group->parent) ? group->parent->name : NULL)
+        || !upgrade_file_block_add_string (block, group->name)
+        || !upgrade_file_block_add_string (block, group->color)
+        || !upgrade_file_block_add_string (block, NULL)
+        || !upgrade_file_block_add_string (block, NULL)
+        || !upgrade_file_block_add_integer (block, group->visible))
+    {
+        return 0;
+    }
+
+    for (ptr_nick = group->nicks; ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        if (!upgrade_file_block_add_string (block, "nick")
+            || !upgrade_file_block_add_string (block, group->name)
+            || !upgrade_file_block_add_string (block, ptr_nick->name)
+            || !upgrade_file_block_add_string (block, ptr_nick->color)
+            || !upgrade_file_block_add_string (block, ptr_nick->prefix)
+            || !upgrade_file_block_add_string (block, ptr_nick->prefix_color)
+            || !upgrade_file_block_add_integer (block, ptr_nick->visible))
+        {
+            return 0;
+        }
+    }
+
+    for (ptr_group = group->children; ptr_group;
+         ptr_group = ptr_group->next_group)
+    {
+        if (!upgrade_weechat_save_nicklist_group (block, ptr_group))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Saves nicklist of a buffer in a block of WeeChat upgrade file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_save_nicklist (struct t_upgrade_block *block,
+                               struct t_gui_buffer *buffer)
+{
+    if (buffer->nicklist_root
+        && !upgrade_weechat_save_nicklist_group (block,
+                                                 buffer->nicklist_root))
+    {
+        return 0;
+    }
+
+    return upgrade_file_block_write (block);
+}
+
 /*
  * Saves buffers in WeeChat upgrade file.
  *
@@ -120,69 +268,63 @@ int
 upgrade_weechat_save_buffers (struct t_upgrade_file *upgrade_file)
 {
     struct t_infolist *ptr_infolist;
+    struct t_upgrade_block *block_nicklist, *block_lines;
     struct t_gui_buffer *ptr_buffer;
-    struct t_gui_line *ptr_line;
     int rc;
 
+    /*
+     * nicklists and lines are saved in blocks (names of variables are saved
+     * once per block, instead of once per nick/line)
+     */
+    block_nicklist = upgrade_file_block_new (
+        upgrade_file, UPGRADE_WEECHAT_TYPE_NICKLIST,
+        "s:type,s:group,s:name,s:color,s:prefix,s:prefix_color,i:visible");
+    block_lines = upgrade_file_block_new (
+        upgrade_file, UPGRADE_WEECHAT_TYPE_BUFFER_LINE,
+        "i:y,t:date,t:date_printed,s:tags,s:prefix,s:message,"
+        "i:highlight,i:last_read_line");
+    if (!block_nicklist || !block_lines)
+    {
+        rc = 0;
+        goto end;
+    }
+
+    rc = 1;
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
         /* save buffer */
         ptr_infolist = infolist_new (NULL);
         if (!ptr_infolist)
-            return 0;
+        {
+            rc = 0;
+            goto end;
+        }
         if (!gui_buffer_add_to_infolist (ptr_infolist, ptr_buffer))
         {
             infolist_free (ptr_infolist);
-            return 0;
+            rc = 0;
+            goto end;
         }
         rc = upgrade_file_write_object (upgrade_file,
                                         UPGRADE_WEECHAT_TYPE_BUFFER,
                                         ptr_infolist);
         infolist_free (ptr_infolist);
         if (!rc)
-            return 0;
+            goto end;
 
         /* save nicklist */
         if (ptr_buffer->nicklist)
         {
-            ptr_infolist = infolist_new (NULL);
-            if (!ptr_infolist)
-                return 0;
-            if (!gui_nicklist_add_to_infolist (ptr_infolist, ptr_buffer, NULL))
-            {
-                infolist_free (ptr_infolist);
-                return 0;
-            }
-            rc = upgrade_file_write_object (upgrade_file,
-                                            UPGRADE_WEECHAT_TYPE_NICKLIST,
-                                            ptr_infolist);
-            infolist_free (ptr_infolist);
+            rc = upgrade_weechat_save_nicklist (block_nicklist, ptr_buffer);
             if (!rc)
-                return 0;
+                goto end;
         }
 
         /* save buffer lines */
-        for (ptr_line = ptr_buffer->own_lines->first_line; ptr_line;
-             ptr_line = ptr_line->next_line)
-        {
-            ptr_infolist = infolist_new (NULL);
-            if (!ptr_infolist)
-                return 0;
-            if (!gui_line_add_to_infolist (ptr_infolist,
-                                           ptr_buffer->own_lines,
-                                           ptr_line))
-            {
-                infolist_free (ptr_infolist);
-                return 0;
-            }
-            rc = upgrade_file_write_object (upgrade_file,
-                                            UPGRADE_WEECHAT_TYPE_BUFFER_LINE,
-                                            ptr_infolist);
-            infolist_free (ptr_infolist);
-            if (!rc)
-                return 0;
-        }
+        rc = upgrade_weechat_save_buffer_lines (block_lines, ptr_buffer);
+        if (!rc)
+            goto end;
 
         /* save command/text history of buffer */
         if (ptr_buffer->history)
@@ -190,11 +332,17 @@ upgrade_weechat_save_buffers (struct t_upgrade_file *upgrade_file)
             rc = upgrade_weechat_save_history (upgrade_file,
                                                ptr_buffer->last_history);
             if (!rc)
-                return 0;
+                goto end;
         }
     }
 
-    return 1;
+end:
+    if (block_nicklist)
+        upgrade_file_block_free (block_nicklist);
+    if (block_lines)
+        upgrade_file_block_free (block_lines);
+
+    return rc;
 }
 
 /*
@@ -445,6 +593,10 @@ upgrade_weechat_read_buffer (struct t_infolist *infolist)
     /* full name */
     gui_buffer_build_full_name (ptr_buffer);
 
+    /* memory accounting with plugin of buffer (if not main buffer) */
+    if (!main_buffer)
+        gui_buffer_set_memory_tags (ptr_buffer);
+
     /* short name */
     if (ptr_buffer->short_name)
         free (ptr_buffer->short_name);
@@ -705,6 +857,128 @@ upgrade_weechat_read_nicklist (struct t_infolist *infolist)
     }
 }
 
+/*
+ * Reads a block of buffer lines.
+ */
+
+void
+upgrade_weechat_read_buffer_lines (struct t_upgrade_block *block)
+{
+    struct t_gui_line *new_line;
+    int col_y, col_date, col_date_printed, col_tags, col_prefix, col_message;
+    int col_highlight, col_last_read_line;
+
+    if (!upgrade_current_buffer)
+        return;
+
+    col_y = upgrade_file_block_column (block, "y");
+    col_date = upgrade_file_block_column (block, "date");
+    col_date_printed = upgrade_file_block_column (block, "date_printed");
+    col_tags = upgrade_file_block_column (block, "tags");
+    col_prefix = upgrade_file_block_column (block, "prefix");
+    col_message = upgrade_file_block_column (block, "message");
+    col_highlight = upgrade_file_block_column (block, "highlight");
+    col_last_read_line = upgrade_file_block_column (block, "last_read_line");
+
+    while (upgrade_file_block_next_row (block))
+    {
+        switch (upgrade_current_buffer->type)
+        {
+            case GUI_BUFFER_TYPE_FORMATTED:
+                new_line = gui_line_add_restored (
+                    upgrade_current_buffer,
+                    upgrade_file_block_time (block, col_date),
+                    upgrade_file_block_time (block, col_date_printed),
+                    upgrade_file_block_string (block, col_tags),
+                    upgrade_file_block_string (block, col_prefix),
+                    upgrade_file_block_string (block, col_message),
+                    upgrade_file_block_integer (block, col_highlight));
+                if (new_line
+                    && upgrade_file_block_integer (block, col_last_read_line))
+                {
+                    upgrade_current_buffer->lines->last_read_line = new_line;
+                }
+                break;
+            case GUI_BUFFER_TYPE_FREE:
+                gui_line_add_y (upgrade_current_buffer,
+                                upgrade_file_block_integer (block, col_y),
+                                upgrade_file_block_string (block, col_message));
+                break;
+            case GUI_BUFFER_NUM_TYPES:
+                break;
+        }
+    }
+}
+
+/*
+ * Reads a block of nicklist (groups and nicks).
+ */
+
+void
+upgrade_weechat_read_nicklist_block (struct t_upgrade_block *block)
+{
+    struct t_gui_nick_group *ptr_group;
+    const char *type, *group_name, *name;
+    int col_type, col_group, col_name, col_color, col_prefix;
+    int col_prefix_color, col_visible;
+
+    if (!upgrade_current_buffer)
+        return;
+
+    upgrade_current_buffer->nicklist = 1;
+
+    col_type = upgrade_file_block_column (block, "type");
+    col_group = upgrade_file_block_column (block, "group");
+    col_name = upgrade_file_block_column (block, "name");
+    col_color = upgrade_file_block_column (block, "color");
+    col_prefix = upgrade_file_block_column (block, "prefix");
+    col_prefix_color = upgrade_file_block_column (block, "prefix_color");
+    col_visible = upgrade_file_block_column (block, "visible");
+
+    /* nicks of a group are consecutive: the last group found is kept */
+    ptr_group = NULL;
+    while (upgrade_file_block_next_row (block))
+    {
+        type = upgrade_file_block_string (block, col_type);
+        group_name = upgrade_file_block_string (block, col_group);
+        name = upgrade_file_block_string (block, col_name);
+        if (!type || !name)
+            continue;
+        if (!group_name)
+        {
+            ptr_group = NULL;
+        }
+        else if (!ptr_group || (strcmp (ptr_group->name, group_name) != 0))
+        {
+            ptr_group = gui_nicklist_search_group (upgrade_current_buffer,
+                                                   NULL, group_name);
+        }
+        if (strcmp (type, "group") == 0)
+        {
+            if (strcmp (name, "root") != 0)
+            {
+                ptr_group = gui_nicklist_add_group (
+                    upgrade_current_buffer,
+                    ptr_group,
+                    name,
+                    upgrade_file_block_string (block, col_color),
+                    upgrade_file_block_integer (block, col_visible));
+            }
+        }
+        else if (strcmp (type, "nick") == 0)
+        {
+            gui_nicklist_add_nick (
+                upgrade_current_buffer,
+                ptr_group,
+                name,
+                upgrade_file_block_string (block, col_color),
+                upgrade_file_block_string (block, col_prefix),
+                upgrade_file_block_string (block, col_prefix_color),
+                upgrade_file_block_integer (block, col_visible));
+        }
+    }
+}
+
 /*
  * Reads hotlist from infolist.
  */
@@ -818,6 +1092,33 @@ upgrade_weechat_read_cb (void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Reads a block of objects in WeeChat upgrade file.
+ */
+
+int
+upgrade_weechat_read_block_cb (void *data,
+                               struct t_upgrade_file *upgrade_file,
+                               int object_id,
+                               struct t_upgrade_block *block)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) upgrade_file;
+
+    switch (object_id)
+    {
+        case UPGRADE_WEECHAT_TYPE_BUFFER_LINE:
+            upgrade_weechat_read_buffer_lines (block);
+            break;
+        case UPGRADE_WEECHAT_TYPE_NICKLIST:
+            upgrade_weechat_read_nicklist_block (block);
+            break;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Loads WeeChat upgrade file.
  *
@@ -837,6 +1138,8 @@ upgrade_weechat_load ()
     upgrade_file = upgrade_file_new (WEECHAT_UPGRADE_FILENAME, 0);
     if (!upgrade_file)
         return 0;
+    upgrade_file_set_callback_block (upgrade_file,
+                                     &upgrade_weechat_read_block_cb);
     rc = upgrade_file_read (upgrade_file, &upgrade_weechat_read_cb, NULL);
     upgrade_file_close (upgrade_file);
 
@@ -32,9 +32,11 @@
 #include "wee-url.h"
 #include "wee-config.h"
 #include "wee-hashtable.h"
+#include "wee-hook.h"
 #include "wee-infolist.h"
 #include "wee-proxy.h"
 #include "wee-string.h"
+#include "../plugins/plugin.h"
 
 
 #define URL_DEF_CONST(__prefix, __name)                                 \
@@ -932,7 +934,13 @@ struct t_url_option url_options[] =
     { NULL, 0, 0, NULL },
 };
 
-char url_error[CURL_ERROR_SIZE + 1];
+CURLM *url_multi = NULL;               /* multi handle for all transfers    */
+struct t_url_transfer *url_transfers = NULL;     /* list of transfers       */
+struct t_url_transfer *last_url_transfer = NULL; /* last transfer           */
+int url_transfers_running = 0;         /* number of transfers in multi      */
+int url_multi_recursion = 0;           /* > 0 if running curl multi handle  */
+int url_multi_ending = 0;              /* 1 if multi handle is being freed  */
+struct t_hook *url_hook_timer = NULL;  /* timer requested by curl           */
 
 
 /*
@@ -1191,49 +1199,25 @@ weeurl_set_proxy (CURL *curl, struct t_proxy *proxy)
 }
 
 /*
- * Downloads URL using options.
+ * Sets options of a CURL easy handle: default options, proxy, file in/out and
+ * options from hashtable.
  *
  * Returns:
  *   0: OK
- *   1: invalid URL
- *   2: error downloading URL
- *   3: not enough memory
  *   4: file error
  */
 
 int
-weeurl_download (const char *url, struct t_hashtable *options)
+weeurl_set_options (CURL *curl, const char *url, struct t_hashtable *options,
+                    struct t_url_file *url_file)
 {
-    CURL *curl;
-    struct t_url_file url_file[2];
     char *url_file_option[2] = { "file_in", "file_out" };
     char *url_file_mode[2] = { "rb", "wb" };
     CURLoption url_file_opt_func[2] = { CURLOPT_READFUNCTION, CURLOPT_WRITEFUNCTION };
     CURLoption url_file_opt_data[2] = { CURLOPT_READDATA, CURLOPT_WRITEDATA };
     void *url_file_opt_cb[2] = { &weeurl_read, &weeurl_write };
     struct t_proxy *ptr_proxy;
-    int rc, curl_rc, i;
-
-    rc = 0;
-
-    for (i = 0; i < 2; i++)
-    {
-        url_file[i].filename = NULL;
-        url_file[i].stream = NULL;
-    }
-
-    if (!url || !url[0])
-    {
-        rc = 1;
-        goto end;
-    }
-
-    curl = curl_easy_init();
-    if (!curl)
-    {
-        rc = 3;
-        goto end;
-    }
+    int i;
 
     /* set default options */
     curl_easy_setopt (curl, CURLOPT_URL, url);
@@ -1258,10 +1242,7 @@ weeurl_download (const char *url, struct t_hashtable *options)
             {
                 url_file[i].stream = fopen (url_file[i].filename, url_file_mode[i]);
                 if (!url_file[i].stream)
-                {
-                    rc = 4;
-                    goto end;
-                }
+                    return 4;
                 curl_easy_setopt (curl, url_file_opt_func[i], url_file_opt_cb[i]);
                 curl_easy_setopt (curl, url_file_opt_data[i], url_file[i].stream);
             }
@@ -1271,29 +1252,459 @@ weeurl_download (const char *url, struct t_hashtable *options)
     /* set other options in hashtable */
     hashtable_map (options, &weeurl_option_map_cb, curl);
 
-    /* set error buffer */
-    curl_easy_setopt (curl, CURLOPT_ERRORBUFFER, url_error);
+    return 0;
+}
+
+/*
+ * Writes data received in a transfer (callback called by curl if option
+ * "file_out" is not set).
+ */
+
+size_t
+weeurl_transfer_write_cb (void *buffer, size_t size, size_t nmemb,
+                          void *arg_transfer)
+{
+    struct t_url_transfer *transfer;
+
+    transfer = (struct t_url_transfer *)arg_transfer;
+
+    /* transfer deleted by its owner: abort it */
+    if (transfer->deleted)
+        return 0;
+
+    if (transfer->callback_data_received)
+    {
+        (transfer->callback_data_received) (transfer->callback_data,
+                                           (const char *)buffer,
+                                           (int)(size * nmemb));
+    }
+
+    return size * nmemb;
+}
+
+/*
+ * Frees a transfer (the easy handle must have been removed from multi
+ * handle).
+ */
+
+void
+weeurl_transfer_free_data (struct t_url_transfer *transfer)
+{
+    int i;
+
+    if (transfer->curl)
+        curl_easy_cleanup (transfer->curl);
+    for (i = 0; i < 2; i++)
+    {
+        if (transfer->url_file[i].stream)
+            fclose (transfer->url_file[i].stream);
+    }
+    if (transfer->url)
+        free (transfer->url);
+    if (transfer->error)
+        free (transfer->error);
+
+    /* remove transfer from list */
+    if (transfer->prev_transfer)
+        (transfer->prev_transfer)->next_transfer = transfer->next_transfer;
+    if (transfer->next_transfer)
+        (transfer->next_transfer)->prev_transfer = transfer->prev_transfer;
+    if (url_transfers == transfer)
+        url_transfers = transfer->next_transfer;
+    if (last_url_transfer == transfer)
+        last_url_transfer = transfer->prev_transfer;
+
+    free (transfer);
+}
+
+/*
+ * Starts transfers waiting for a slot (according to option
+ * weechat.network.url_max_transfers) and frees deleted transfers.
+ */
+
+void
+weeurl_transfer_schedule ()
+{
+    struct t_url_transfer *ptr_transfer, *ptr_next_transfer;
+
+    if (!url_multi || (url_multi_recursion > 0))
+        return;
+
+    ptr_transfer = url_transfers;
+    while (ptr_transfer)
+    {
+        ptr_next_transfer = ptr_transfer->next_transfer;
+
+        if (ptr_transfer->deleted)
+        {
+            if (ptr_transfer->running)
+            {
+                curl_multi_remove_handle (url_multi, ptr_transfer->curl);
+                url_transfers_running--;
+            }
+            weeurl_transfer_free_data (ptr_transfer);
+        }
+        else if (!ptr_transfer->running
+                 && (url_transfers_running < CONFIG_INTEGER(config_network_url_max_transfers)))
+        {
+            if (curl_multi_add_handle (url_multi, ptr_transfer->curl) == CURLM_OK)
+            {
+                ptr_transfer->running = 1;
+                url_transfers_running++;
+            }
+        }
+
+        ptr_transfer = ptr_next_transfer;
+    }
+}
+
+/*
+ * Calls end callback of transfers completed.
+ */
+
+void
+weeurl_transfer_check_done ()
+{
+    CURLMsg *msg;
+    struct t_url_transfer *transfer;
+    int msgs_left, rc, length;
+    char *error;
+
+    while ((msg = curl_multi_info_read (url_multi, &msgs_left)))
+    {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        transfer = NULL;
+        curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE,
+                           (char **)&transfer);
+        if (!transfer || transfer->deleted)
+            continue;
+
+        rc = 0;
+        error = NULL;
+        if (msg->data.result != CURLE_OK)
+        {
+            rc = (msg->data.result == CURLE_OPERATION_TIMEDOUT) ? 5 : 2;
+            length = strlen (transfer->url) + CURL_ERROR_SIZE + 128;
+            error = malloc (length);
+            if (error)
+            {
+                snprintf (error, length,
+                          _("curl error %d (%s) (URL: \"%s\")\n"),
+                          msg->data.result,
+                          (transfer->error[0]) ?
+                          transfer->error :
+                          curl_easy_strerror (msg->data.result),
+                          transfer->url);
+            }
+        }
+
+        /* the transfer is freed in any case after the callback */
+        transfer->deleted = 1;
+        if (transfer->callback_end)
+        {
+            (transfer->callback_end) (transfer->callback_data, rc, error);
+        }
+        if (error)
+            free (error);
+    }
+}
+
+/*
+ * Runs curl on a socket (or on timeout if fd is CURL_SOCKET_TIMEOUT), then
+ * calls callbacks of transfers completed.
+ */
+
+void
+weeurl_socket_action (int fd)
+{
+    int running;
+
+    url_multi_recursion++;
+    curl_multi_socket_action (url_multi, fd, 0, &running);
+    weeurl_transfer_check_done ();
+    url_multi_recursion--;
+
+    weeurl_transfer_schedule ();
+}
+
+/*
+ * Callback for fd hook on a socket used by curl.
+ */
+
+int
+weeurl_fd_cb (void *data, int fd)
+{
+    /* make C compiler happy */
+    (void) data;
+
+    weeurl_socket_action (fd);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for timer requested by curl.
+ */
+
+int
+weeurl_timer_cb (void *data, int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    /* timer is removed after this call (only one call) */
+    url_hook_timer = NULL;
+
+    weeurl_socket_action (CURL_SOCKET_TIMEOUT);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Adds/updates/removes a fd hook for a socket (callback called by curl).
+ */
+
+int
+weeurl_multi_socket_cb (CURL *easy, curl_socket_t fd, int what,
+                        void *userp, void *socketp)
+{
+    struct t_hook *ptr_hook;
+    int flags;
+
+    /* make C compiler happy */
+    (void) easy;
+    (void) userp;
+
+    if (url_multi_ending)
+        return 0;
+
+    ptr_hook = (struct t_hook *)socketp;
+
+    if (what == CURL_POLL_REMOVE)
+    {
+        if (ptr_hook)
+        {
+            unhook (ptr_hook);
+            curl_multi_assign (url_multi, fd, NULL);
+        }
+        return 0;
+    }
+
+    flags = 0;
+    if ((what == CURL_POLL_IN) || (what == CURL_POLL_INOUT))
+        flags |= HOOK_FD_FLAG_READ;
+    if ((what == CURL_POLL_OUT) || (what == CURL_POLL_INOUT))
+        flags |= HOOK_FD_FLAG_WRITE;
 
-    /* perform action! */
-    curl_rc = curl_easy_perform (curl);
-    if (curl_rc != CURLE_OK)
+    if (ptr_hook)
     {
-        fprintf (stderr,
-                 _("curl error %d (%s) (URL: \"%s\")\n"),
-                 curl_rc, url_error, url);
-        rc = 2;
+        HOOK_FD(ptr_hook, flags) = flags;
     }
+    else
+    {
+        ptr_hook = hook_fd (NULL, fd,
+                            (flags & HOOK_FD_FLAG_READ) ? 1 : 0,
+                            (flags & HOOK_FD_FLAG_WRITE) ? 1 : 0,
+                            0,
+                            &weeurl_fd_cb, NULL);
+        curl_multi_assign (url_multi, fd, ptr_hook);
+    }
+
+    return 0;
+}
+
+/*
+ * Sets timer requested by curl (callback called by curl).
+ */
 
-    /* cleanup */
-    curl_easy_cleanup (curl);
+int
+weeurl_multi_timer_cb (CURLM *multi, long timeout_ms, void *userp)
+{
+    /* make C compiler happy */
+    (void) multi;
+    (void) userp;
 
-end:
+    if (url_multi_ending)
+        return 0;
+
+    if (url_hook_timer)
+    {
+        unhook (url_hook_timer);
+        url_hook_timer = NULL;
+    }
+
+    /* timeout of -1 means no timer */
+    if (timeout_ms >= 0)
+    {
+        url_hook_timer = hook_timer (NULL, (timeout_ms > 0) ? timeout_ms : 1,
+                                     0, 1, &weeurl_timer_cb, NULL);
+    }
+
+    return 0;
+}
+
+/*
+ * Creates a transfer and starts it (or queues it if the max number of
+ * transfers is reached).
+ *
+ * The transfer is run in WeeChat process, with a single curl multi handle for
+ * all transfers (so connections are reused), and the sockets/timers used by
+ * curl are watched by main loop.
+ *
+ * If option "file_out" is not set, data received is sent to callback
+ * "callback_data_received". When the transfer ends, callback "callback_end"
+ * is called with a return code:
+ *   0: OK
+ *   2: error downloading URL
+ *   5: timeout
+ * and the transfer is then automatically freed.
+ *
+ * Returns pointer to transfer, NULL if error (and *rc is set):
+ *   1: invalid URL
+ *   3: not enough memory
+ *   4: file error
+ */
+
+struct t_url_transfer *
+weeurl_transfer_new (const char *url, struct t_hashtable *options,
+                     long timeout,
+                     t_url_transfer_data_cb *callback_data_received,
+                     t_url_transfer_end_cb *callback_end,
+                     void *callback_data, int *rc)
+{
+    struct t_url_transfer *new_transfer;
+    int i;
+
+    *rc = 0;
+
+    if (!url || !url[0])
+    {
+        *rc = 1;
+        return NULL;
+    }
+
+    if (!url_multi)
+    {
+        url_multi = curl_multi_init ();
+        if (!url_multi)
+        {
+            *rc = 3;
+            return NULL;
+        }
+        curl_multi_setopt (url_multi, CURLMOPT_SOCKETFUNCTION,
+                           &weeurl_multi_socket_cb);
+        curl_multi_setopt (url_multi, CURLMOPT_TIMERFUNCTION,
+                           &weeurl_multi_timer_cb);
+    }
+
+    new_transfer = malloc (sizeof (*new_transfer));
+    if (!new_transfer)
+    {
+        *rc = 3;
+        return NULL;
+    }
+    new_transfer->url = strdup (url);
+    new_transfer->curl = curl_easy_init ();
+    new_transfer->error = malloc (CURL_ERROR_SIZE + 1);
     for (i = 0; i < 2; i++)
     {
-        if (url_file[i].stream)
-            fclose (url_file[i].stream);
+        new_transfer->url_file[i].filename = NULL;
+        new_transfer->url_file[i].stream = NULL;
+    }
+    new_transfer->callback_data_received = callback_data_received;
+    new_transfer->callback_end = callback_end;
+    new_transfer->callback_data = callback_data;
+    new_transfer->running = 0;
+    new_transfer->deleted = 0;
+
+    new_transfer->prev_transfer = last_url_transfer;
+    new_transfer->next_transfer = NULL;
+    if (last_url_transfer)
+        last_url_transfer->next_transfer = new_transfer;
+    else
+        url_transfers = new_transfer;
+    last_url_transfer = new_transfer;
+
+    if (!new_transfer->url || !new_transfer->curl || !new_transfer->error)
+    {
+        weeurl_transfer_free_data (new_transfer);
+        *rc = 3;
+        return NULL;
     }
-    return rc;
+    new_transfer->error[0] = '\0';
+
+    /* data received goes to callback (if no file_out is given) */
+    curl_easy_setopt (new_transfer->curl, CURLOPT_WRITEFUNCTION,
+                      &weeurl_transfer_write_cb);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_WRITEDATA, new_transfer);
+
+    *rc = weeurl_set_options (new_transfer->curl, url, options,
+                              new_transfer->url_file);
+    if (*rc != 0)
+    {
+        weeurl_transfer_free_data (new_transfer);
+        return NULL;
+    }
+
+    curl_easy_setopt (new_transfer->curl, CURLOPT_ERRORBUFFER,
+                      new_transfer->error);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_PRIVATE, new_transfer);
+    curl_easy_setopt (new_transfer->curl, CURLOPT_NOSIGNAL, 1L);
+    if (timeout > 0)
+        curl_easy_setopt (new_transfer->curl, CURLOPT_TIMEOUT_MS, timeout);
+
+    weeurl_transfer_schedule ();
+
+    return new_transfer;
+}
+
+/*
+ * Cancels and frees a transfer (callbacks are not called any more).
+ */
+
+void
+weeurl_transfer_free (struct t_url_transfer *transfer)
+{
+    if (!transfer)
+        return;
+
+    transfer->deleted = 1;
+
+    /* transfer is freed later if we are in a curl callback */
+    weeurl_transfer_schedule ();
+}
+
+/*
+ * Frees all transfers and curl multi handle.
+ *
+ * This function must be called after removal of all hooks (the fd/timer hooks
+ * used by curl are not removed here).
+ */
+
+void
+weeurl_end ()
+{
+    if (!url_multi)
+        return;
+
+    url_multi_ending = 1;
+
+    while (url_transfers)
+    {
+        if (url_transfers->running)
+            curl_multi_remove_handle (url_multi, url_transfers->curl);
+        weeurl_transfer_free_data (url_transfers);
+    }
+    url_transfers_running = 0;
+
+    curl_multi_cleanup (url_multi);
+    url_multi = NULL;
+    url_hook_timer = NULL;
+
+    url_multi_ending = 0;
 }
 
 /*
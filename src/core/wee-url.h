@@ -51,10 +51,40 @@ struct t_url_file
     FILE *stream;                      /* file stream                       */
 };
 
+typedef void (t_url_transfer_data_cb)(void *data, const char *buffer,
+                                      int size);
+typedef void (t_url_transfer_end_cb)(void *data, int rc, const char *error);
+
+struct t_url_transfer
+{
+    char *url;                         /* URL                               */
+    void *curl;                        /* curl easy handle                  */
+    struct t_url_file url_file[2];     /* files in/out (options)            */
+    char *error;                       /* error buffer for curl             */
+    t_url_transfer_data_cb *callback_data_received; /* data received        */
+    t_url_transfer_end_cb *callback_end; /* end of transfer                 */
+    void *callback_data;               /* data sent to callbacks            */
+    int running;                       /* 1 if added in curl multi handle   */
+                                       /* (0 = waiting for a free slot)     */
+    int deleted;                       /* 1 if transfer must be freed       */
+    struct t_url_transfer *prev_transfer; /* link to previous transfer      */
+    struct t_url_transfer *next_transfer; /* link to next transfer          */
+};
+
 extern struct t_url_option url_options[];
+extern struct t_url_transfer *url_transfers;
+extern int url_transfers_running;
 
-extern int weeurl_download (const char *url, struct t_hashtable *options);
+extern struct t_url_transfer *weeurl_transfer_new (const char *url,
+                                                   struct t_hashtable *options,
+                                                   long timeout,
+                                                   t_url_transfer_data_cb *callback_data_received,
+                                                   t_url_transfer_end_cb *callback_end,
+                                                   void *callback_data,
+                                                   int *rc);
+extern void weeurl_transfer_free (struct t_url_transfer *transfer);
 extern int weeurl_option_add_to_infolist (struct t_infolist *infolist,
                                           struct t_url_option *option);
+extern void weeurl_end ();
 
 #endif /* WEECHAT_URL_H */
@@ -39,6 +39,7 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -61,11 +62,14 @@
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-network.h"
 #include "wee-proxy.h"
+#include "wee-resolve.h"
 #include "wee-secure.h"
 #include "wee-string.h"
 #include "wee-upgrade.h"
+#include "wee-url.h"
 #include "wee-utf8.h"
 #include "wee-util.h"
 #include "wee-version.h"
@@ -498,6 +502,8 @@ weechat_init (int argc, char *argv[], void (*gui_init_cb)())
 {
     weechat_first_start_time = time (NULL); /* initialize start time        */
     gettimeofday (&weechat_current_start_timeval, NULL);
+    srand ((weechat_current_start_timeval.tv_sec
+            * weechat_current_start_timeval.tv_usec) ^ getpid ());
 
     setlocale (LC_ALL, "");             /* initialize gettext               */
 #ifdef ENABLE_NLS
@@ -541,6 +547,7 @@ weechat_init (int argc, char *argv[], void (*gui_init_cb)())
     plugin_api_init ();                 /* create some hooks (info,hdata,..)*/
     secure_read ();                     /* read secured data options        */
     config_weechat_read ();             /* read WeeChat options             */
+    memory_init ();                     /* init memory accounting           */
     network_init_gnutls ();             /* init GnuTLS                      */
 
     if (gui_init_cb)
@@ -586,8 +593,11 @@ weechat_end (void (*gui_end_cb)(int clean_exit))
     config_file_free_all ();            /* free all configuration files     */
     gui_key_end ();                     /* remove all keys                  */
     unhook_all ();                      /* remove all hooks                 */
+    weeurl_end ();                      /* end URL transfers                */
+    resolve_end ();                     /* end resolution of names          */
     hdata_end ();                       /* end hdata                        */
     secure_end ();                      /* end secured data                 */
     string_end ();                      /* end string                       */
+    memory_end ();                      /* end memory accounting            */
     weechat_shutdown (-1, 0);           /* end other things                 */
 }
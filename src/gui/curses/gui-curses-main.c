@@ -33,6 +33,7 @@
 #include "../../core/weechat.h"
 #include "../../core/wee-command.h"
 #include "../../core/wee-config.h"
+#include "../../core/wee-debug.h"
 #include "../../core/wee-hook.h"
 #include "../../core/wee-log.h"
 #include "../../core/wee-string.h"
@@ -387,7 +388,9 @@ gui_main_loop ()
     while (!weechat_quit)
     {
         /* execute hook timers */
+        debug_loop_phase_start (DEBUG_LOOP_PHASE_TIMER);
         hook_timer_exec ();
+        debug_loop_phase_end ();
 
         /* auto reset of color pairs */
         if (gui_color_pairs_auto_reset)
@@ -398,9 +401,11 @@ gui_main_loop ()
             gui_color_pairs_auto_reset_pending = 1;
         }
 
+        debug_loop_phase_start (DEBUG_LOOP_PHASE_REFRESH);
         gui_main_refreshs ();
         if (gui_window_refresh_needed && !gui_window_bare_display)
             gui_main_refreshs ();
+        debug_loop_phase_end ();
 
         if (gui_signal_sigwinch_received)
         {
@@ -417,14 +422,20 @@ gui_main_loop ()
         FD_ZERO (&except_fds);
         max_fd = hook_fd_set (&read_fds, &write_fds, &except_fds);
         hook_timer_time_to_next (&tv_timeout);
+        debug_loop_wait_start ();
         ready = select (max_fd + 1, &read_fds, &write_fds, &except_fds,
                         &tv_timeout);
+        debug_loop_wait_end ();
         if (ready > 0)
         {
+            debug_loop_phase_start (DEBUG_LOOP_PHASE_FD);
             hook_fd_exec (&read_fds, &write_fds, &except_fds);
+            debug_loop_phase_end ();
         }
     }
 
+    debug_loop_watchdog_disarm ();
+
     /* remove keyboard hook */
     unhook (hook_fd_keyboard);
 }
@@ -41,6 +41,7 @@
 #include "../core/wee-infolist.h"
 #include "../core/wee-list.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-string.h"
 #include "../core/wee-utf8.h"
 #include "../plugins/plugin.h"
@@ -161,6 +162,21 @@ gui_buffer_build_full_name (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Sets tags used for memory accounting of lines and nicklist of buffer,
+ * according to plugin name (must be called before any line or nick is
+ * added in buffer).
+ */
+
+void
+gui_buffer_set_memory_tags (struct t_gui_buffer *buffer)
+{
+    buffer->memory_tag_lines = memory_tag_get (
+        gui_buffer_get_plugin_name (buffer), "lines");
+    buffer->memory_tag_nicklist = memory_tag_get (
+        gui_buffer_get_plugin_name (buffer), "nicklist");
+}
+
 /*
  * Adds a new local variable in a buffer.
  */
@@ -609,6 +625,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->title = NULL;
 
     /* chat content */
+    gui_buffer_set_memory_tags (new_buffer);
     new_buffer->own_lines = gui_lines_alloc ();
     new_buffer->mixed_lines = NULL;
     new_buffer->lines = new_buffer->own_lines;
@@ -4368,6 +4385,7 @@ gui_buffer_print_log ()
         log_printf ("  close_callback_data . . : 0x%lx", ptr_buffer->close_callback_data);
         log_printf ("  closing . . . . . . . . : %d",    ptr_buffer->closing);
         log_printf ("  title . . . . . . . . . : '%s'",  ptr_buffer->title);
+        log_printf ("  memory_tag_lines. . . . : 0x%lx", ptr_buffer->memory_tag_lines);
         log_printf ("  own_lines . . . . . . . : 0x%lx", ptr_buffer->own_lines);
         gui_lines_print_log (ptr_buffer->own_lines);
         log_printf ("  mixed_lines . . . . . . : 0x%lx", ptr_buffer->mixed_lines);
@@ -4377,6 +4395,7 @@ gui_buffer_print_log ()
         log_printf ("  chat_refresh_needed . . : %d",    ptr_buffer->chat_refresh_needed);
         log_printf ("  nicklist. . . . . . . . : %d",    ptr_buffer->nicklist);
         log_printf ("  nicklist_case_sensitive : %d",    ptr_buffer->nicklist_case_sensitive);
+        log_printf ("  memory_tag_nicklist . . : 0x%lx", ptr_buffer->memory_tag_nicklist);
         log_printf ("  nicklist_root . . . . . : 0x%lx", ptr_buffer->nicklist_root);
         log_printf ("  nicklist_max_length . . : %d",    ptr_buffer->nicklist_max_length);
         log_printf ("  nicklist_display_groups : %d",    ptr_buffer->nicklist_display_groups);
@@ -26,6 +26,7 @@
 struct t_hashtable;
 struct t_gui_window;
 struct t_infolist;
+struct t_memory_tag;
 
 enum t_gui_buffer_type
 {
@@ -115,6 +116,7 @@ struct t_gui_buffer
     char *title;                       /* buffer title                      */
 
     /* chat content */
+    struct t_memory_tag *memory_tag_lines; /* tag for memory of lines       */
     struct t_gui_lines *own_lines;     /* lines (for this buffer only)      */
     struct t_gui_lines *mixed_lines;   /* mixed lines (if buffers merged)   */
     struct t_gui_lines *lines;         /* pointer to "own_lines" or         */
@@ -126,6 +128,7 @@ struct t_gui_buffer
     /* nicklist */
     int nicklist;                      /* = 1 if nicklist is enabled        */
     int nicklist_case_sensitive;       /* nicks are case sensitive ?        */
+    struct t_memory_tag *memory_tag_nicklist; /* tag for memory of nicklist */
     struct t_gui_nick_group *nicklist_root; /* pointer to groups root       */
     int nicklist_max_length;           /* max length for a nick             */
     int nicklist_display_groups;       /* display groups ?                  */
@@ -237,6 +240,7 @@ extern char *gui_buffer_properties_set[];
 extern const char *gui_buffer_get_plugin_name (struct t_gui_buffer *buffer);
 extern const char *gui_buffer_get_short_name (struct t_gui_buffer *buffer);
 extern void gui_buffer_build_full_name (struct t_gui_buffer *buffer);
+extern void gui_buffer_set_memory_tags (struct t_gui_buffer *buffer);
 extern void gui_buffer_notify_set_all ();
 extern void gui_buffer_input_buffer_init (struct t_gui_buffer *buffer);
 extern struct t_gui_buffer *gui_buffer_new (struct t_weechat_plugin *plugin,
@@ -125,18 +125,17 @@ gui_color_search_config (const char *color_name)
 
     if (color_name)
     {
-        for (ptr_option = weechat_config_section_color->options;
-             ptr_option; ptr_option = ptr_option->next_option)
+        ptr_option = config_file_search_option (weechat_config_file,
+                                                weechat_config_section_color,
+                                                color_name);
+        if (ptr_option)
         {
-            if (string_strcasecmp (ptr_option->name, color_name) == 0)
+            if (ptr_option->min < 0)
             {
-                if (ptr_option->min < 0)
-                {
-                    return gui_color_get_custom (
-                        gui_color_get_name (CONFIG_COLOR(ptr_option)));
-                }
-                return GUI_COLOR(ptr_option->min);
+                return gui_color_get_custom (
+                    gui_color_get_name (CONFIG_COLOR(ptr_option)));
             }
+            return GUI_COLOR(ptr_option->min);
         }
     }
 
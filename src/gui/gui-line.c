@@ -35,6 +35,7 @@
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-string.h"
 #include "../plugins/plugin.h"
 #include "gui-line.h"
@@ -962,8 +963,12 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 {
     struct t_gui_window *ptr_win;
     struct t_gui_window_scroll *ptr_scroll;
+    struct t_memory_tag *memory_tag;
     int prefix_length, prefix_is_nick;
 
+    /* line and data are allocated with tag of buffer owning the data */
+    memory_tag = line->data->buffer->memory_tag_lines;
+
     for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
     {
         /* reset scroll for any window scroll starting with this line */
@@ -1005,8 +1010,8 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
         if (line->data->prefix)
             string_shared_free (line->data->prefix);
         if (line->data->message)
-            free (line->data->message);
-        free (line->data);
+            memory_free (memory_tag, line->data->message);
+        memory_free (memory_tag, line->data);
     }
 
     /* remove line from list */
@@ -1021,7 +1026,7 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 
     lines->lines_count--;
 
-    free (line);
+    memory_free (memory_tag, line);
 }
 
 /*
@@ -1034,7 +1039,8 @@ gui_line_mixed_add (struct t_gui_lines *lines,
 {
     struct t_gui_line *new_line;
 
-    new_line = malloc (sizeof (*new_line));
+    new_line = memory_malloc (line_data->buffer->memory_tag_lines,
+                              sizeof (*new_line));
     if (new_line)
     {
         new_line->data = line_data;
@@ -1160,27 +1166,20 @@ gui_line_get_notify_level (struct t_gui_line *line)
 }
 
 /*
- * Adds a new line for a buffer.
+ * Removes old lines in a buffer (before adding a new line), according to
+ * history options:
+ *   max_lines:   if > 0, keep only N lines in buffer
+ *   max_minutes: if > 0, keep only lines from last N minutes
+ *
+ * Returns number of lines removed.
  */
 
-struct t_gui_line *
-gui_line_add (struct t_gui_buffer *buffer, time_t date,
-              time_t date_printed, const char *tags,
-              const char *prefix, const char *message)
+int
+gui_line_remove_old_lines (struct t_gui_buffer *buffer)
 {
-    struct t_gui_line *new_line;
-    struct t_gui_line_data *new_line_data;
-    struct t_gui_window *ptr_win;
-    char *message_for_signal;
-    const char *nick;
-    int notify_level, *max_notify_level, lines_removed;
+    int lines_removed;
     time_t current_time;
 
-    /*
-     * remove line(s) if necessary, according to history options:
-     *   max_lines:   if > 0, keep only N lines in buffer
-     *   max_minutes: if > 0, keep only lines from last N minutes
-     */
     lines_removed = 0;
     current_time = time (NULL);
     while (buffer->own_lines->first_line
@@ -1195,8 +1194,26 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
         lines_removed++;
     }
 
+    return lines_removed;
+}
+
+/*
+ * Allocates a new line for a buffer with formatted content (the line is not
+ * added to the buffer).
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_gui_line *
+gui_line_new_formatted (struct t_gui_buffer *buffer, time_t date,
+                        time_t date_printed, const char *tags,
+                        const char *prefix, const char *message)
+{
+    struct t_gui_line *new_line;
+    struct t_gui_line_data *new_line_data;
+
     /* create new line */
-    new_line = malloc (sizeof (*new_line));
+    new_line = memory_malloc (buffer->memory_tag_lines, sizeof (*new_line));
     if (!new_line)
     {
         log_printf (_("Not enough memory for new line"));
@@ -1204,10 +1221,11 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     }
 
     /* create data for line */
-    new_line_data = malloc (sizeof (*new_line_data));
+    new_line_data = memory_malloc (buffer->memory_tag_lines,
+                                   sizeof (*new_line_data));
     if (!new_line_data)
     {
-        free (new_line);
+        memory_free (buffer->memory_tag_lines, new_line);
         log_printf (_("Not enough memory for new line"));
         return NULL;
     }
@@ -1225,7 +1243,35 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
         (char *)string_shared_get (prefix) : ((date != 0) ? (char *)string_shared_get ("") : NULL);
     new_line->data->prefix_length = (prefix) ?
         gui_chat_strlen_screen (prefix) : 0;
-    new_line->data->message = (message) ? strdup (message) : strdup ("");
+    new_line->data->message = memory_strdup (buffer->memory_tag_lines,
+                                             (message) ? message : "");
+    new_line->data->highlight = 0;
+    new_line->data->displayed = 1;
+
+    return new_line;
+}
+
+/*
+ * Adds a new line for a buffer.
+ */
+
+struct t_gui_line *
+gui_line_add (struct t_gui_buffer *buffer, time_t date,
+              time_t date_printed, const char *tags,
+              const char *prefix, const char *message)
+{
+    struct t_gui_line *new_line;
+    struct t_gui_window *ptr_win;
+    char *message_for_signal;
+    const char *nick;
+    int notify_level, *max_notify_level, lines_removed;
+
+    lines_removed = gui_line_remove_old_lines (buffer);
+
+    new_line = gui_line_new_formatted (buffer, date, date_printed, tags,
+                                       prefix, message);
+    if (!new_line)
+        return NULL;
 
     /* get notify level and max notify level for nick in buffer */
     notify_level = gui_line_get_notify_level (new_line);
@@ -1324,6 +1370,49 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     return new_line;
 }
 
+/*
+ * Adds a line restored from upgrade file in a buffer with formatted content.
+ *
+ * Unlike function gui_line_add, the highlight is not computed (the saved
+ * value is used), the hotlist is not updated (it is restored later) and no
+ * signal is sent (plugins are not yet loaded).
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_gui_line *
+gui_line_add_restored (struct t_gui_buffer *buffer, time_t date,
+                       time_t date_printed, const char *tags,
+                       const char *prefix, const char *message,
+                       int highlight)
+{
+    struct t_gui_line *new_line;
+
+    gui_line_remove_old_lines (buffer);
+
+    new_line = gui_line_new_formatted (buffer, date, date_printed, tags,
+                                       prefix, message);
+    if (!new_line)
+        return NULL;
+
+    new_line->data->highlight = highlight;
+    new_line->data->displayed = gui_filter_check_line (new_line->data);
+
+    gui_line_add_to_list (buffer->own_lines, new_line);
+
+    if (!new_line->data->displayed)
+    {
+        buffer->own_lines->lines_hidden++;
+        if (buffer->mixed_lines)
+            buffer->mixed_lines->lines_hidden++;
+    }
+
+    if (buffer->mixed_lines)
+        gui_line_mixed_add (buffer->mixed_lines, new_line->data);
+
+    return new_line;
+}
+
 /*
  * Adds or updates a line for a buffer with free content.
  */
@@ -1345,17 +1434,19 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
 
     if (!ptr_line || (ptr_line->data->y > y))
     {
-        new_line = malloc (sizeof (*new_line));
+        new_line = memory_malloc (buffer->memory_tag_lines,
+                                  sizeof (*new_line));
         if (!new_line)
         {
             log_printf (_("Not enough memory for new line"));
             return;
         }
 
-        new_line_data = malloc (sizeof (*new_line_data));
+        new_line_data = memory_malloc (buffer->memory_tag_lines,
+                                       sizeof (*new_line_data));
         if (!new_line_data)
         {
-            free (new_line);
+            memory_free (buffer->memory_tag_lines, new_line);
             log_printf (_("Not enough memory for new line"));
             return;
         }
@@ -1414,9 +1505,10 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
         }
 
         /* free message in line */
-        free (ptr_line->data->message);
+        memory_free (buffer->memory_tag_lines, ptr_line->data->message);
     }
-    ptr_line->data->message = (message) ? strdup (message) : strdup ("");
+    ptr_line->data->message = memory_strdup (buffer->memory_tag_lines,
+                                             (message) ? message : "");
 
     /* check if line is filtered or not */
     ptr_line->data->displayed = gui_filter_check_line (ptr_line->data);
@@ -1442,8 +1534,9 @@ gui_line_clear (struct t_gui_line *line)
     line->data->prefix = (char *)string_shared_get ("");
 
     if (line->data->message)
-        free (line->data->message);
-    line->data->message = strdup ("");
+        memory_free (line->data->buffer->memory_tag_lines, line->data->message);
+    line->data->message = memory_strdup (line->data->buffer->memory_tag_lines,
+                                         "");
 }
 
 /*
@@ -1660,7 +1753,14 @@ gui_line_hdata_line_data_update_cb (void *data,
     if (hashtable_has_key (hashtable, "message"))
     {
         value = hashtable_get (hashtable, "message");
-        hdata_set (hdata, pointer, "message", value);
+        /* message is counted in memory of buffer lines (no hdata_set) */
+        if (line_data->message)
+        {
+            memory_free (line_data->buffer->memory_tag_lines,
+                         line_data->message);
+        }
+        line_data->message = memory_strdup (line_data->buffer->memory_tag_lines,
+                                            value);
         rc++;
         update_coords = 1;
     }
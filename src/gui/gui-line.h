@@ -103,12 +103,26 @@ extern void gui_line_free (struct t_gui_buffer *buffer,
                            struct t_gui_line *line);
 extern void gui_line_free_all (struct t_gui_buffer *buffer);
 extern int gui_line_get_notify_level (struct t_gui_line *line);
+extern int gui_line_remove_old_lines (struct t_gui_buffer *buffer);
+extern struct t_gui_line *gui_line_new_formatted (struct t_gui_buffer *buffer,
+                                                  time_t date,
+                                                  time_t date_printed,
+                                                  const char *tags,
+                                                  const char *prefix,
+                                                  const char *message);
 extern struct t_gui_line *gui_line_add (struct t_gui_buffer *buffer,
                                         time_t date,
                                         time_t date_printed,
                                         const char *tags,
                                         const char *prefix,
                                         const char *message);
+extern struct t_gui_line *gui_line_add_restored (struct t_gui_buffer *buffer,
+                                                 time_t date,
+                                                 time_t date_printed,
+                                                 const char *tags,
+                                                 const char *prefix,
+                                                 const char *message,
+                                                 int highlight);
 extern void gui_line_add_y (struct t_gui_buffer *buffer, int y,
                             const char *message);
 extern void gui_line_clear (struct t_gui_line *line);
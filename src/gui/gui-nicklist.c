@@ -40,6 +40,7 @@
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-string.h"
 #include "../core/wee-utf8.h"
 #include "../plugins/plugin.h"
@@ -265,7 +266,8 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
     if (!buffer || !name || gui_nicklist_search_group (buffer, parent_group, name))
         return NULL;
 
-    new_group = malloc (sizeof (*new_group));
+    new_group = memory_malloc (buffer->memory_tag_nicklist,
+                               sizeof (*new_group));
     if (!new_group)
         return NULL;
 
@@ -438,7 +440,8 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     if (!buffer || !name || gui_nicklist_search_nick (buffer, NULL, name))
         return NULL;
 
-    new_nick = malloc (sizeof (*new_nick));
+    new_nick = memory_malloc (buffer->memory_tag_nicklist,
+                              sizeof (*new_nick));
     if (!new_nick)
         return NULL;
 
@@ -513,7 +516,7 @@ gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
             buffer->nicklist_visible_count--;
     }
 
-    free (nick);
+    memory_free (buffer->memory_tag_nicklist, nick);
 
     if (CONFIG_BOOLEAN(config_look_color_nick_offline))
         gui_buffer_ask_chat_refresh (buffer, 1);
@@ -587,7 +590,7 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
             buffer->nicklist_visible_count--;
     }
 
-    free (group);
+    memory_free (buffer->memory_tag_nicklist, group);
 
     gui_nicklist_send_signal ("nicklist_group_removed", buffer, group_removed);
 
@@ -276,6 +276,26 @@ exec_command_parse_options (struct t_exec_cmd_options *cmd_options,
         {
             cmd_options->flush = 0;
         }
+        else if (weechat_strcasecmp (argv[i], "-stream") == 0)
+        {
+            cmd_options->stream = 1;
+        }
+        else if (weechat_strcasecmp (argv[i], "-nostream") == 0)
+        {
+            cmd_options->stream = 0;
+        }
+        else if (weechat_strcasecmp (argv[i], "-keep") == 0)
+        {
+            if (i + 1 >= argc)
+                return 0;
+            i++;
+            error = NULL;
+            cmd_options->stream_keep = strtol (argv[i], &error, 10);
+            if (!error || error[0] || (cmd_options->stream_keep < 0))
+                return 0;
+            if (cmd_options->stream_keep > 0)
+                cmd_options->stream = 1;
+        }
         else if (weechat_strcasecmp (argv[i], "-color") == 0)
         {
             if (i + 1 >= argc)
@@ -414,6 +434,8 @@ exec_command_run (struct t_gui_buffer *buffer,
     cmd_options.switch_to_buffer = 1;
     cmd_options.line_numbers = -1;
     cmd_options.flush = 1;
+    cmd_options.stream = 0;
+    cmd_options.stream_keep = 0;
     cmd_options.color = EXEC_COLOR_AUTO;
     cmd_options.display_rc = 1;
     cmd_options.ptr_command_name = NULL;
@@ -479,7 +501,12 @@ exec_command_run (struct t_gui_buffer *buffer,
         weechat_hashtable_set (process_options, "stdin", "1");
     if (cmd_options.detached)
         weechat_hashtable_set (process_options, "detached", "1");
-    if (cmd_options.flush)
+    /* streaming is useless without output or if output is sent at end */
+    if (cmd_options.detached || cmd_options.hsignal)
+        cmd_options.stream = 0;
+    if (cmd_options.stream)
+        weechat_hashtable_set (process_options, "line_buffered", "1");
+    else if (cmd_options.flush)
         weechat_hashtable_set (process_options, "buffer_flush", "1");
 
     /* set variables in new command (before running the command) */
@@ -555,6 +582,14 @@ exec_command_run (struct t_gui_buffer *buffer,
     new_exec_cmd->display_rc = cmd_options.display_rc;
     new_exec_cmd->pipe_command = cmd_options.pipe_command;
     new_exec_cmd->hsignal = cmd_options.hsignal;
+    if (cmd_options.stream)
+    {
+        new_exec_cmd->stream = 1;
+        new_exec_cmd->stream_keep = cmd_options.stream_keep;
+        new_exec_cmd->stream_timer = weechat_hook_timer (
+            EXEC_STREAM_TIMER_INTERVAL, 0, 0,
+            &exec_stream_timer_cb, new_exec_cmd);
+    }
 
     /* execute the command */
     if (weechat_exec_plugin->debug >= 1)
@@ -786,7 +821,8 @@ exec_command_init ()
         N_("-list"
            " || [-sh|-nosh] [-bg|-nobg] [-stdin|-nostdin] [-buffer <name>] "
            "[-l|-o|-n|-nf] [-cl|-nocl] [-sw|-nosw] [-ln|-noln] "
-           "[-flush|-noflush] [-color ansi|auto|irc|weechat|strip] [-rc|-norc] "
+           "[-flush|-noflush] [-stream|-nostream] [-keep <lines>] "
+           "[-color ansi|auto|irc|weechat|strip] [-rc|-norc] "
            "[-timeout <timeout>] [-name <name>] [-pipe <command>] "
            "[-hsignal <name>] <command>"
            " || -in <id> <text>"
@@ -827,6 +863,18 @@ exec_command_init ()
            "   -noln: don't display line numbers\n"
            "  -flush: display output of command in real time (default)\n"
            "-noflush: display output of command after its end\n"
+           " -stream: display output of command line by line, with a "
+           "limited rate (option exec.command.stream_rate); when too many "
+           "lines are waiting for display (option exec.command.stream_queue), "
+           "the output of command is not read any more until lines are "
+           "displayed (the command is blocked); rates of output are displayed "
+           "in title of exec buffer (not compatible with options "
+           "-bg/-hsignal)\n"
+           "-nostream: display output of command without rate limit "
+           "(default)\n"
+           "   -keep: with -stream: keep only the last lines waiting for "
+           "display (older lines are dropped, the command is never blocked); "
+           "0 = block the command (default)\n"
            "  -color: action on ANSI colors in output:\n"
            "             ansi: keep ANSI codes as-is\n"
            "             auto: convert ANSI colors to WeeChat/IRC (default)\n"
@@ -875,14 +923,16 @@ exec_command_init ()
            "  /exec -o uptime\n"
            "  /exec -pipe \"/print Machine uptime:\" uptime\n"
            "  /exec -n tail -f /var/log/messages\n"
+           "  /exec -n -stream -keep 1000 tail -f /var/log/messages\n"
            "  /exec -kill 0"),
         "-list"
         " || -sh|-nosh|-bg|-nobg|-stdin|-nostdin|-buffer|-l|-o|-n|-nf|"
-        "-cl|-nocl|-sw|-nosw|-ln|-noln|-flush|-noflush|-color|-timeout|-name|"
+        "-cl|-nocl|-sw|-nosw|-ln|-noln|-flush|-noflush|-stream|-nostream|"
+        "-keep|-color|-timeout|-name|"
         "-pipe|-hsignal|%*"
         " || -in|-inclose|-signal|-kill %(exec_commands_ids)"
         " || -killall"
-        " || -set %(exec_commands_ids) stdin|stdin_close|signal"
+        " || -set %(exec_commands_ids) stdin|stdin_close|signal|output_pause"
         " || -del %(exec_commands_ids)|-all %(exec_commands_ids)|%*",
         &exec_command_exec, NULL);
 }
@@ -35,6 +35,8 @@ struct t_exec_cmd_options
     int switch_to_buffer;              /* switch to the output buffer       */
     int line_numbers;                  /* 1 to display line numbers         */
     int flush;                         /* 1 to flush lines immediately      */
+    int stream;                        /* 1 for rate-limited display        */
+    int stream_keep;                   /* keep last N lines (0 = block cmd) */
     int color;                         /* what to do with ANSI colors       */
     int display_rc;                    /* 1 to display return code          */
     const char *ptr_command_name;      /* name of command                   */
@@ -34,6 +34,8 @@ struct t_config_file *exec_config_file = NULL;
 
 struct t_config_option *exec_config_command_default_options;
 struct t_config_option *exec_config_command_purge_delay;
+struct t_config_option *exec_config_command_stream_queue;
+struct t_config_option *exec_config_command_stream_rate;
 
 /* exec config, color section */
 
@@ -122,6 +124,22 @@ exec_config_init ()
            "commands immediately, -1 = never purge)"),
         NULL, -1, 36000 * 24 * 30, "0", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL);
+    exec_config_command_stream_queue = weechat_config_new_option (
+        exec_config_file, ptr_section,
+        "stream_queue", "integer",
+        N_("maximum number of lines waiting for display for a command "
+           "executed with option -stream: when this number is reached, the "
+           "output of command is not read any more (the command is blocked) "
+           "until enough lines are displayed (not used with option -keep)"),
+        NULL, 1, 1000000, "10000", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
+    exec_config_command_stream_rate = weechat_config_new_option (
+        exec_config_file, ptr_section,
+        "stream_rate", "integer",
+        N_("maximum number of lines displayed per second for a command "
+           "executed with option -stream"),
+        NULL, 1, 1000000, "1000", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* color */
     ptr_section = weechat_config_new_section (exec_config_file, "color",
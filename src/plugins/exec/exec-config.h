@@ -27,6 +27,8 @@ extern struct t_config_file *exec_config_file;
 
 extern struct t_config_option *exec_config_command_default_options;
 extern struct t_config_option *exec_config_command_purge_delay;
+extern struct t_config_option *exec_config_command_stream_queue;
+extern struct t_config_option *exec_config_command_stream_rate;
 
 extern struct t_config_option *exec_config_color_flag_running;
 extern struct t_config_option *exec_config_color_flag_finished;
@@ -161,6 +161,24 @@ exec_add ()
         new_exec_cmd->output[i] = NULL;
     }
     new_exec_cmd->return_code = -1;
+    new_exec_cmd->stream = 0;
+    new_exec_cmd->stream_keep = 0;
+    new_exec_cmd->stream_queue = NULL;
+    new_exec_cmd->stream_queue_size = 0;
+    new_exec_cmd->stream_queue_start = 0;
+    new_exec_cmd->stream_queue_count = 0;
+    new_exec_cmd->stream_paused = 0;
+    new_exec_cmd->stream_timer = NULL;
+    new_exec_cmd->stream_ticks = 0;
+    new_exec_cmd->stream_bytes = 0;
+    new_exec_cmd->stream_lines = 0;
+    new_exec_cmd->stream_dropped = 0;
+    new_exec_cmd->stream_last_bytes = 0;
+    new_exec_cmd->stream_last_lines = 0;
+    new_exec_cmd->stream_bytes_rate = 0;
+    new_exec_cmd->stream_lines_rate = 0;
+    new_exec_cmd->stream_end = 0;
+    new_exec_cmd->stream_end_rc = 0;
     new_exec_cmd->pipe_command = NULL;
     new_exec_cmd->hsignal = NULL;
 
@@ -339,6 +357,131 @@ exec_display_line (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
     }
 }
 
+/*
+ * Adds a line in queue of lines waiting for display (streaming mode).
+ *
+ * Note: the line is freed by the queue (when displayed or dropped).
+ */
+
+void
+exec_stream_add_line (struct t_exec_cmd *exec_cmd, int out, char *line)
+{
+    struct t_exec_stream_line *new_queue;
+    int i, new_size, index;
+
+    exec_cmd->stream_lines++;
+
+    /* option -keep: drop the oldest line if the queue is full */
+    if ((exec_cmd->stream_keep > 0)
+        && (exec_cmd->stream_queue_count >= exec_cmd->stream_keep))
+    {
+        free (exec_cmd->stream_queue[exec_cmd->stream_queue_start].line);
+        exec_cmd->stream_queue_start = (exec_cmd->stream_queue_start + 1) %
+            exec_cmd->stream_queue_size;
+        exec_cmd->stream_queue_count--;
+        exec_cmd->stream_dropped++;
+    }
+
+    /* grow the queue (lines are moved at the beginning of new queue) */
+    if (exec_cmd->stream_queue_count >= exec_cmd->stream_queue_size)
+    {
+        new_size = (exec_cmd->stream_queue_size > 0) ?
+            exec_cmd->stream_queue_size * 2 : 64;
+        if ((exec_cmd->stream_keep > 0) && (new_size > exec_cmd->stream_keep))
+            new_size = exec_cmd->stream_keep;
+        new_queue = malloc (new_size * sizeof (new_queue[0]));
+        if (!new_queue)
+        {
+            free (line);
+            exec_cmd->stream_dropped++;
+            return;
+        }
+        for (i = 0; i < exec_cmd->stream_queue_count; i++)
+        {
+            new_queue[i] = exec_cmd->stream_queue[
+                (exec_cmd->stream_queue_start + i) %
+                exec_cmd->stream_queue_size];
+        }
+        if (exec_cmd->stream_queue)
+            free (exec_cmd->stream_queue);
+        exec_cmd->stream_queue = new_queue;
+        exec_cmd->stream_queue_size = new_size;
+        exec_cmd->stream_queue_start = 0;
+    }
+
+    index = (exec_cmd->stream_queue_start + exec_cmd->stream_queue_count) %
+        exec_cmd->stream_queue_size;
+    exec_cmd->stream_queue[index].out = out;
+    exec_cmd->stream_queue[index].line = line;
+    exec_cmd->stream_queue_count++;
+
+    /* too many lines waiting for display: stop reading output of command */
+    if ((exec_cmd->stream_keep == 0) && exec_cmd->hook
+        && !exec_cmd->stream_paused
+        && (exec_cmd->stream_queue_count >=
+            weechat_config_integer (exec_config_command_stream_queue)))
+    {
+        weechat_hook_set (exec_cmd->hook, "output_pause", "1");
+        exec_cmd->stream_paused = 1;
+    }
+}
+
+/*
+ * Frees queue of lines waiting for display (streaming mode).
+ */
+
+void
+exec_stream_free_queue (struct t_exec_cmd *exec_cmd)
+{
+    int i;
+
+    for (i = 0; i < exec_cmd->stream_queue_count; i++)
+    {
+        free (exec_cmd->stream_queue[(exec_cmd->stream_queue_start + i) %
+                                     exec_cmd->stream_queue_size].line);
+    }
+    if (exec_cmd->stream_queue)
+        free (exec_cmd->stream_queue);
+    exec_cmd->stream_queue = NULL;
+    exec_cmd->stream_queue_size = 0;
+    exec_cmd->stream_queue_start = 0;
+    exec_cmd->stream_queue_count = 0;
+}
+
+/*
+ * Displays statistics on output of a streamed command in title of buffer
+ * (only if the buffer is an exec buffer).
+ */
+
+void
+exec_stream_display_stats (struct t_exec_cmd *exec_cmd,
+                           struct t_gui_buffer *buffer)
+{
+    char str_title[1024], *str_size;
+    const char *ptr_plugin;
+
+    if (!buffer)
+        return;
+    ptr_plugin = weechat_buffer_get_string (buffer, "plugin");
+    if (!ptr_plugin || (strcmp (ptr_plugin, EXEC_PLUGIN_NAME) != 0))
+        return;
+
+    str_size = weechat_string_format_size (exec_cmd->stream_bytes_rate);
+    snprintf (str_title, sizeof (str_title),
+              /* TRANSLATORS: "%s/s" is a size per second, for example "1.5 MB/s" */
+              _("%s: %s/s, %lld lines/s, queued: %d, dropped: %lld%s"),
+              exec_cmd->command,
+              (str_size) ? str_size : "?",
+              exec_cmd->stream_lines_rate,
+              exec_cmd->stream_queue_count,
+              exec_cmd->stream_dropped,
+              (exec_cmd->stream_paused) ? _(" (paused)") : "");
+    if (str_size)
+        free (str_size);
+
+    weechat_buffer_set (buffer, "title", str_title);
+}
+
 /*
  * Concatenates some text to stdout/stderr of a command.
  */
@@ -385,8 +528,16 @@ exec_concat_output (struct t_exec_cmd *exec_cmd, struct t_gui_buffer *buffer,
                 exec_cmd->output[out] = NULL;
             }
             exec_cmd->output_size[out] = 0;
-            exec_display_line (exec_cmd, buffer, out, line);
-            free (line);
+            if (exec_cmd->stream)
+            {
+                /* line is displayed later (it is freed by the queue) */
+                exec_stream_add_line (exec_cmd, out, line);
+            }
+            else
+            {
+                exec_display_line (exec_cmd, buffer, out, line);
+                free (line);
+            }
             ptr_text = pos + 1;
         }
     }
@@ -505,6 +656,18 @@ exec_end_command (struct t_exec_cmd *exec_cmd, int return_code)
         }
     }
 
+    /* end of streaming: display final statistics */
+    if (exec_cmd->stream_timer)
+    {
+        weechat_unhook (exec_cmd->stream_timer);
+        exec_cmd->stream_timer = NULL;
+        exec_stream_free_queue (exec_cmd);
+        exec_cmd->stream_paused = 0;
+        exec_stream_display_stats (
+            exec_cmd,
+            weechat_buffer_search ("==", exec_cmd->buffer_full_name));
+    }
+
     /* (re)set some variables after the end of command */
     exec_cmd->hook = NULL;
     exec_cmd->pid = 0;
@@ -529,6 +692,85 @@ exec_end_command (struct t_exec_cmd *exec_cmd, int return_code)
     }
 }
 
+/*
+ * Timer callback for a streamed command: displays lines waiting in queue
+ * (at most "exec.command.stream_rate" lines per second), resumes reading of
+ * output when enough lines are displayed, and ends the command when all
+ * lines are displayed.
+ */
+
+int
+exec_stream_timer_cb (void *data, int remaining_calls)
+{
+    struct t_exec_cmd *exec_cmd;
+    struct t_gui_buffer *ptr_buffer;
+    struct t_exec_stream_line *ptr_line;
+    int max_lines, queue_max;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    exec_cmd = (struct t_exec_cmd *)data;
+    if (!exec_cmd)
+        return WEECHAT_RC_OK;
+
+    ptr_buffer = weechat_buffer_search ("==", exec_cmd->buffer_full_name);
+
+    /* buffer has been closed: lines waiting for display are dropped */
+    if (exec_cmd->buffer_full_name && !ptr_buffer)
+    {
+        exec_cmd->stream_dropped += exec_cmd->stream_queue_count;
+        exec_stream_free_queue (exec_cmd);
+    }
+
+    /* display lines (according to rate) */
+    max_lines = (weechat_config_integer (exec_config_command_stream_rate) *
+                 EXEC_STREAM_TIMER_INTERVAL) / 1000;
+    if (max_lines < 1)
+        max_lines = 1;
+    while ((max_lines > 0) && (exec_cmd->stream_queue_count > 0))
+    {
+        ptr_line = &(exec_cmd->stream_queue[exec_cmd->stream_queue_start]);
+        exec_display_line (exec_cmd, ptr_buffer, ptr_line->out,
+                           ptr_line->line);
+        free (ptr_line->line);
+        exec_cmd->stream_queue_start = (exec_cmd->stream_queue_start + 1) %
+            exec_cmd->stream_queue_size;
+        exec_cmd->stream_queue_count--;
+        max_lines--;
+    }
+
+    /* resume reading of output when half of queue is displayed */
+    queue_max = weechat_config_integer (exec_config_command_stream_queue);
+    if (exec_cmd->stream_paused
+        && (exec_cmd->stream_queue_count <= queue_max / 2))
+    {
+        if (exec_cmd->hook)
+            weechat_hook_set (exec_cmd->hook, "output_pause", "0");
+        exec_cmd->stream_paused = 0;
+    }
+
+    /* compute and display statistics every second */
+    exec_cmd->stream_ticks++;
+    if (exec_cmd->stream_ticks >= 1000 / EXEC_STREAM_TIMER_INTERVAL)
+    {
+        exec_cmd->stream_bytes_rate = exec_cmd->stream_bytes -
+            exec_cmd->stream_last_bytes;
+        exec_cmd->stream_lines_rate = exec_cmd->stream_lines -
+            exec_cmd->stream_last_lines;
+        exec_cmd->stream_last_bytes = exec_cmd->stream_bytes;
+        exec_cmd->stream_last_lines = exec_cmd->stream_lines;
+        exec_cmd->stream_ticks = 0;
+        exec_stream_display_stats (exec_cmd, ptr_buffer);
+    }
+
+    /* command has ended and all lines are displayed */
+    if (exec_cmd->stream_end && (exec_cmd->stream_queue_count == 0))
+        exec_end_command (exec_cmd, exec_cmd->stream_end_rc);
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Callback for hook process.
  */
@@ -561,18 +803,43 @@ exec_process_cb (void *data, const char *command, int return_code,
 
     if (out || err)
     {
-        ptr_buffer = weechat_buffer_search ("==",
-                                            ptr_exec_cmd->buffer_full_name);
+        if (ptr_exec_cmd->stream)
+        {
+            /* lines are queued, the buffer is not used */
+            ptr_buffer = NULL;
+            ptr_exec_cmd->stream_bytes += ((out) ? strlen (out) : 0) +
+                ((err) ? strlen (err) : 0);
+        }
+        else
+        {
+            ptr_buffer = weechat_buffer_search ("==",
+                                                ptr_exec_cmd->buffer_full_name);
+        }
         if (out)
             exec_concat_output (ptr_exec_cmd, ptr_buffer, EXEC_STDOUT, out);
         if (err)
             exec_concat_output (ptr_exec_cmd, ptr_buffer, EXEC_STDERR, err);
     }
 
-    if (return_code == WEECHAT_HOOK_PROCESS_ERROR)
-        exec_end_command (ptr_exec_cmd, -1);
-    else if (return_code >= 0)
-        exec_end_command (ptr_exec_cmd, return_code);
+    if ((return_code == WEECHAT_HOOK_PROCESS_ERROR) || (return_code >= 0))
+    {
+        if (return_code == WEECHAT_HOOK_PROCESS_ERROR)
+            return_code = -1;
+        if (ptr_exec_cmd->stream_timer && (ptr_exec_cmd->stream_queue_count > 0))
+        {
+            /*
+             * lines are still waiting for display: the command is ended by
+             * the timer when all lines are displayed (the process hook is
+             * removed after this callback)
+             */
+            ptr_exec_cmd->hook = NULL;
+            ptr_exec_cmd->pid = 0;
+            ptr_exec_cmd->stream_end = 1;
+            ptr_exec_cmd->stream_end_rc = return_code;
+        }
+        else
+            exec_end_command (ptr_exec_cmd, return_code);
+    }
 
     return WEECHAT_RC_OK;
 }
@@ -602,6 +869,9 @@ exec_free (struct t_exec_cmd *exec_cmd)
     /* free data */
     if (exec_cmd->hook)
         weechat_unhook (exec_cmd->hook);
+    if (exec_cmd->stream_timer)
+        weechat_unhook (exec_cmd->stream_timer);
+    exec_stream_free_queue (exec_cmd);
     if (exec_cmd->name)
         free (exec_cmd->name);
     if (exec_cmd->command)
@@ -668,6 +938,24 @@ exec_print_log ()
         weechat_log_printf ("  output_size[stderr] . . : %d",    ptr_exec_cmd->output_size[EXEC_STDERR]);
         weechat_log_printf ("  output[stderr]. . . . . : '%s'",  ptr_exec_cmd->output[EXEC_STDERR]);
         weechat_log_printf ("  return_code . . . . . . : %d",    ptr_exec_cmd->return_code);
+        weechat_log_printf ("  stream. . . . . . . . . : %d",    ptr_exec_cmd->stream);
+        weechat_log_printf ("  stream_keep . . . . . . : %d",    ptr_exec_cmd->stream_keep);
+        weechat_log_printf ("  stream_queue. . . . . . : 0x%lx", ptr_exec_cmd->stream_queue);
+        weechat_log_printf ("  stream_queue_size . . . : %d",    ptr_exec_cmd->stream_queue_size);
+        weechat_log_printf ("  stream_queue_start. . . : %d",    ptr_exec_cmd->stream_queue_start);
+        weechat_log_printf ("  stream_queue_count. . . : %d",    ptr_exec_cmd->stream_queue_count);
+        weechat_log_printf ("  stream_paused . . . . . : %d",    ptr_exec_cmd->stream_paused);
+        weechat_log_printf ("  stream_timer. . . . . . : 0x%lx", ptr_exec_cmd->stream_timer);
+        weechat_log_printf ("  stream_ticks. . . . . . : %d",    ptr_exec_cmd->stream_ticks);
+        weechat_log_printf ("  stream_bytes. . . . . . : %lld",  ptr_exec_cmd->stream_bytes);
+        weechat_log_printf ("  stream_lines. . . . . . : %lld",  ptr_exec_cmd->stream_lines);
+        weechat_log_printf ("  stream_dropped. . . . . : %lld",  ptr_exec_cmd->stream_dropped);
+        weechat_log_printf ("  stream_last_bytes . . . : %lld",  ptr_exec_cmd->stream_last_bytes);
+        weechat_log_printf ("  stream_last_lines . . . : %lld",  ptr_exec_cmd->stream_last_lines);
+        weechat_log_printf ("  stream_bytes_rate . . . : %lld",  ptr_exec_cmd->stream_bytes_rate);
+        weechat_log_printf ("  stream_lines_rate . . . : %lld",  ptr_exec_cmd->stream_lines_rate);
+        weechat_log_printf ("  stream_end. . . . . . . : %d",    ptr_exec_cmd->stream_end);
+        weechat_log_printf ("  stream_end_rc . . . . . : %d",    ptr_exec_cmd->stream_end_rc);
         weechat_log_printf ("  pipe_command. . . . . . : '%s'",  ptr_exec_cmd->pipe_command);
         weechat_log_printf ("  hsignal . . . . . . . . : '%s'",  ptr_exec_cmd->hsignal);
         weechat_log_printf ("  prev_cmd. . . . . . . . : 0x%lx", ptr_exec_cmd->prev_cmd);
@@ -28,6 +28,9 @@
 #define EXEC_STDOUT 0
 #define EXEC_STDERR 1
 
+/* streaming mode: interval between displays of queued lines (in ms) */
+#define EXEC_STREAM_TIMER_INTERVAL 100
+
 enum t_exec_color
 {
     EXEC_COLOR_ANSI = 0,
@@ -39,6 +42,12 @@ enum t_exec_color
     EXEC_NUM_COLORS,
 };
 
+struct t_exec_stream_line
+{
+    int out;                           /* EXEC_STDOUT or EXEC_STDERR        */
+    char *line;                        /* content of line                   */
+};
+
 struct t_exec_cmd
 {
     /* command/process */
@@ -64,6 +73,26 @@ struct t_exec_cmd
     char *output[2];                   /* stdout/stderr of command          */
     int return_code;                   /* command return code               */
 
+    /* streaming mode (rate-limited display of output) */
+    int stream;                        /* 1 if output is streamed           */
+    int stream_keep;                   /* keep last N lines (0 = block cmd) */
+    struct t_exec_stream_line *stream_queue; /* lines waiting for display   */
+    int stream_queue_size;             /* allocated size for queue          */
+    int stream_queue_start;            /* index of first line in queue      */
+    int stream_queue_count;            /* number of lines in queue          */
+    int stream_paused;                 /* 1 if output of process is paused  */
+    struct t_hook *stream_timer;       /* timer to display queued lines     */
+    int stream_ticks;                  /* number of calls to timer          */
+    long long stream_bytes;            /* number of bytes received          */
+    long long stream_lines;            /* number of lines received          */
+    long long stream_dropped;          /* lines dropped (with -keep)        */
+    long long stream_last_bytes;       /* bytes received at last stats      */
+    long long stream_last_lines;       /* lines received at last stats      */
+    long long stream_bytes_rate;       /* bytes received per second         */
+    long long stream_lines_rate;       /* lines received per second         */
+    int stream_end;                    /* 1 if command ended (lines queued) */
+    int stream_end_rc;                 /* return code of ended command      */
+
     /* pipe/hsignal */
     char *pipe_command;                /* output piped to WeeChat/plugin cmd*/
     char *hsignal;                     /* send a hsignal with output        */
@@ -82,6 +111,7 @@ extern struct t_exec_cmd *exec_search_by_id (const char *id);
 extern struct t_exec_cmd *exec_add ();
 extern int exec_process_cb (void *data, const char *command, int return_code,
                             const char *out, const char *err);
+extern int exec_stream_timer_cb (void *data, int remaining_calls);
 extern void exec_free (struct t_exec_cmd *exec_cmd);
 extern void exec_free_all ();
 
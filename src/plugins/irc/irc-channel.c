@@ -515,6 +515,25 @@ irc_channel_remove_away (struct t_irc_server *server,
     }
 }
 
+/*
+ * Checks if away must be checked on a channel (with a "WHO" on channel).
+ *
+ * Returns:
+ *   1: away must be checked
+ *   0: away must not be checked
+ */
+
+int
+irc_channel_check_away_enabled (struct t_irc_server *server,
+                                struct t_irc_channel *channel)
+{
+    return (server->cap_away_notify
+            || ((IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK) > 0)
+                && ((IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS) == 0)
+                    || (channel->nicks_count <= IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS))))) ?
+        1 : 0;
+}
+
 /*
  * Checks for away on a channel.
  */
@@ -525,10 +544,7 @@ irc_channel_check_away (struct t_irc_server *server,
 {
     if ((channel->type == IRC_CHANNEL_TYPE_CHANNEL) && channel->nicks)
     {
-        if (server->cap_away_notify
-            || ((IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK) > 0)
-                && ((IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS) == 0)
-                    || (channel->nicks_count <= IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS)))))
+        if (irc_channel_check_away_enabled (server, channel))
         {
             channel->checking_away++;
             irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
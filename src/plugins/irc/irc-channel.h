@@ -100,6 +100,8 @@ extern const char *irc_channel_get_auto_chantype (struct t_irc_server *server,
                                                   const char *channel_name);
 extern void irc_channel_remove_away (struct t_irc_server *server,
                                      struct t_irc_channel *channel);
+extern int irc_channel_check_away_enabled (struct t_irc_server *server,
+                                           struct t_irc_channel *channel);
 extern void irc_channel_check_away (struct t_irc_server *server,
                                     struct t_irc_channel *channel);
 extern void irc_channel_set_away (struct t_irc_server *server,
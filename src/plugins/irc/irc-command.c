@@ -70,9 +70,7 @@ irc_command_mode_nicks (struct t_irc_server *server,
                         int argc, char **argv)
 {
     int i, arg_yes, max_modes, modes_added, msg_priority, prefix_found;
-    long number;
-    char *error, prefix, modes[128+1], nicks[1024];
-    const char *ptr_modes;
+    char prefix, modes[128+1], nicks[1024];
     struct t_irc_nick *ptr_nick;
     struct t_hashtable *nicks_sent;
 
@@ -102,27 +100,8 @@ irc_command_mode_nicks (struct t_irc_server *server,
         }
     }
 
-    /* default is 4 modes max (if server did not send the info) */
-    max_modes = 4;
-
-    /*
-     * look for the max modes supported in one command by the server
-     * (in isupport value, with the format: "MODES=4")
-     */
-    ptr_modes = irc_server_get_isupport_value (server, "MODES");
-    if (ptr_modes)
-    {
-        error = NULL;
-        number = strtol (ptr_modes, &error, 10);
-        if (error && !error[0])
-        {
-            max_modes = number;
-            if (max_modes < 1)
-                max_modes = 1;
-            if (max_modes > 128)
-                max_modes = 128;
-        }
-    }
+    /* max modes supported in one command by the server */
+    max_modes = irc_server_get_max_modes (server);
 
     /* get prefix for the mode (example: prefix == '@' for mode 'o') */
     prefix = irc_server_get_prefix_char_for_mode (server, mode[0]);
@@ -894,42 +873,95 @@ irc_command_run_away (void *data, struct t_gui_buffer *buffer,
 }
 
 /*
- * Sends a ban/unban command to the server, as "MODE [+/-]b nick".
+ * Sends ban/unban/quiet/unquiet commands to the server for a list of nicks or
+ * masks ("masks" is a NULL-terminated array).
  *
- * Argument "mode" can be "+b" for ban or "-b" for unban.
+ * Many masks are sent in a single message, as allowed by the server (number of
+ * modes and length of message), for example:
+ * "MODE #channel +bbb mask1 mask2 mask3".
+ *
+ * Argument "mode" can be "+b", "-b", "+q" or "-q".
+ * If "use_ban_mask" is 1, a nick found in channel is replaced by its default
+ * ban mask.
  */
 
 void
-irc_command_send_ban (struct t_irc_server *server,
-                      const char *channel_name,
-                      const char *mode,
-                      const char *nick)
+irc_command_send_mode_masks (struct t_irc_server *server,
+                             const char *channel_name,
+                             const char *mode,
+                             int use_ban_mask,
+                             char **masks)
 {
     struct t_irc_channel *ptr_channel;
     struct t_irc_nick *ptr_nick;
-    char *mask;
+    char **ban_masks, **messages;
+    int i, num_masks;
 
-    mask = NULL;
+    num_masks = 0;
+    while (masks[num_masks])
+    {
+        num_masks++;
+    }
 
-    if (!strchr (nick, '!') && !strchr (nick, '@'))
+    ban_masks = malloc ((num_masks + 1) * sizeof (*ban_masks));
+    if (!ban_masks)
+        return;
+
+    /* replace nicks found in channel by their default ban mask */
+    ptr_channel = (use_ban_mask) ?
+        irc_channel_search (server, channel_name) : NULL;
+    for (i = 0; i < num_masks; i++)
     {
-        ptr_channel = irc_channel_search (server, channel_name);
-        if (ptr_channel)
+        ban_masks[i] = NULL;
+        if (ptr_channel && !strchr (masks[i], '!') && !strchr (masks[i], '@'))
         {
-            ptr_nick = irc_nick_search (server, ptr_channel, nick);
+            ptr_nick = irc_nick_search (server, ptr_channel, masks[i]);
             if (ptr_nick)
-                mask = irc_nick_default_ban_mask (ptr_nick);
+                ban_masks[i] = irc_nick_default_ban_mask (ptr_nick);
+        }
+        if (!ban_masks[i])
+            ban_masks[i] = strdup (masks[i]);
+        if (!ban_masks[i])
+        {
+            num_masks = i;
+            break;
+        }
+    }
+    ban_masks[num_masks] = NULL;
+
+    messages = irc_message_build_mode_masks (channel_name, mode, ban_masks,
+                                             irc_server_get_max_modes (server));
+    if (messages)
+    {
+        for (i = 0; messages[i]; i++)
+        {
+            irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
+                              "%s", messages[i]);
         }
+        weechat_string_free_split (messages);
     }
 
-    irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                      "MODE %s %s %s",
-                      channel_name,
-                      mode,
-                      (mask) ? mask : nick);
+    weechat_string_free_split (ban_masks);
+}
 
-    if (mask)
-        free (mask);
+/*
+ * Sends a ban/unban command to the server, as "MODE [+/-]b nick".
+ *
+ * Argument "mode" can be "+b" for ban or "-b" for unban.
+ */
+
+void
+irc_command_send_ban (struct t_irc_server *server,
+                      const char *channel_name,
+                      const char *mode,
+                      const char *nick)
+{
+    char *masks[2];
+
+    masks[0] = (char *)nick;
+    masks[1] = NULL;
+
+    irc_command_send_mode_masks (server, channel_name, mode, 1, masks);
 }
 
 /*
@@ -981,13 +1013,8 @@ irc_command_ban (void *data, struct t_gui_buffer *buffer, int argc,
 
         if (argv[pos_args])
         {
-            /* loop on users */
-            while (argv[pos_args])
-            {
-                irc_command_send_ban (ptr_server, pos_channel, "+b",
-                                      argv[pos_args]);
-                pos_args++;
-            }
+            irc_command_send_mode_masks (ptr_server, pos_channel, "+b", 1,
+                                         argv + pos_args);
         }
         else
         {
@@ -3815,14 +3842,8 @@ irc_command_quiet (void *data, struct t_gui_buffer *buffer, int argc,
 
         if (argv[pos_args])
         {
-            /* loop on users */
-            while (argv[pos_args])
-            {
-                irc_server_sendf (ptr_server, IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                                  "MODE %s +q %s",
-                                  pos_channel, argv[pos_args]);
-                pos_args++;
-            }
+            irc_command_send_mode_masks (ptr_server, pos_channel, "+q", 0,
+                                         argv + pos_args);
         }
         else
         {
@@ -4548,6 +4569,14 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
                             IRC_COLOR_CHAT_VALUE,
                             weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]),
                             NG_("second", "seconds", weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW])));
+        /* anti_flood_burst */
+        if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]))
+            weechat_printf (NULL, "  anti_flood_burst . . :   (%d)",
+                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST));
+        else
+            weechat_printf (NULL, "  anti_flood_burst . . : %s%d",
+                            IRC_COLOR_CHAT_VALUE,
+                            weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]));
         /* away_check */
         if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_printf (NULL, "  away_check . . . . . :   (%d %s)",
@@ -5325,13 +5354,8 @@ irc_command_unban (void *data, struct t_gui_buffer *buffer, int argc,
         }
     }
 
-    /* loop on users */
-    while (argv[pos_args])
-    {
-        irc_command_send_ban (ptr_server, pos_channel, "-b",
-                              argv[pos_args]);
-        pos_args++;
-    }
+    irc_command_send_mode_masks (ptr_server, pos_channel, "-b", 1,
+                                 argv + pos_args);
 
     return WEECHAT_RC_OK;
 }
@@ -5386,14 +5410,8 @@ irc_command_unquiet (void *data, struct t_gui_buffer *buffer, int argc,
 
     if (argv[pos_args])
     {
-        /* loop on users */
-        while (argv[pos_args])
-        {
-            irc_server_sendf (ptr_server, IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                              "MODE %s -q %s",
-                              pos_channel, argv[pos_args]);
-            pos_args++;
-        }
+        irc_command_send_mode_masks (ptr_server, pos_channel, "-q", 0,
+                                     argv + pos_args);
     }
     else
     {
@@ -1945,6 +1945,21 @@ irc_config_server_new_option (struct t_config_file *config_file,
                 callback_change, callback_change_data,
                 NULL, NULL);
             break;
+        case IRC_SERVER_OPTION_ANTI_FLOOD_BURST:
+            new_option = weechat_config_new_option (
+                config_file, section,
+                option_name, "integer",
+                N_("anti-flood: number of messages which can be sent at once "
+                   "to IRC server (burst), then messages are sent with the "
+                   "delay of options anti_flood_prio_high and "
+                   "anti_flood_prio_low"),
+                NULL, 1, 100,
+                default_value, value,
+                null_value_allowed,
+                callback_check_value, callback_check_value_data,
+                callback_change, callback_change_data,
+                NULL, NULL);
+            break;
         case IRC_SERVER_OPTION_AWAY_CHECK:
             new_option = weechat_config_new_option (
                 config_file, section,
@@ -0,0 +1,89 @@
+/*
+ * irc-flood.c - anti-flood for messages sent to IRC server (token bucket)
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Anti-flood is a token bucket: up to "burst" messages can be sent at once,
+ * then one message every "interval" milliseconds.
+ *
+ * The bucket is stored as the time when next message could be sent if there
+ * was no burst ("tv_next"): each message sent adds "interval" to this time
+ * (starting from now if it is in the past).
+ */
+
+#include <stdlib.h>
+
+#include "../weechat-plugin.h"
+#include "irc.h"
+#include "irc-flood.h"
+
+
+/*
+ * Gets delay before a message can be sent.
+ *
+ * Argument "interval" is the interval between two messages (in milliseconds)
+ * for the priority of message, "interval_max" is the max interval of all
+ * priorities (used to detect a change of system clock).
+ *
+ * Returns delay in milliseconds (0 if message can be sent now).
+ */
+
+long
+irc_flood_delay (struct timeval *tv_next, long interval, long interval_max,
+                 int burst, struct timeval *tv_now)
+{
+    long delay;
+
+    if (interval <= 0)
+        return 0;
+
+    if (interval_max < interval)
+        interval_max = interval;
+    if (burst < 1)
+        burst = 1;
+
+    delay = weechat_util_timeval_diff (tv_now, tv_next);
+
+    /* detect if system clock has been changed (now lower than before) */
+    if (delay > burst * interval_max)
+    {
+        *tv_next = *tv_now;
+        return 0;
+    }
+
+    delay -= (burst - 1) * interval;
+
+    return (delay > 0) ? delay : 0;
+}
+
+/*
+ * Uses a token in bucket (a message has been sent).
+ */
+
+void
+irc_flood_use (struct timeval *tv_next, long interval, struct timeval *tv_now)
+{
+    if (interval <= 0)
+        return;
+
+    if (weechat_util_timeval_cmp (tv_next, tv_now) < 0)
+        *tv_next = *tv_now;
+    weechat_util_timeval_add (tv_next, interval);
+}
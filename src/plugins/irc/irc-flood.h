@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_IRC_FLOOD_H
+#define WEECHAT_IRC_FLOOD_H 1
+
+#include <sys/time.h>
+
+extern long irc_flood_delay (struct timeval *tv_next, long interval,
+                             long interval_max, int burst,
+                             struct timeval *tv_now);
+extern void irc_flood_use (struct timeval *tv_next, long interval,
+                           struct timeval *tv_now);
+
+#endif /* WEECHAT_IRC_FLOOD_H */
@@ -405,6 +405,329 @@ irc_message_replace_vars (struct t_irc_server *server,
     return res;
 }
 
+/*
+ * Returns number of targets in a list of targets separated by commas.
+ */
+
+int
+irc_message_count_targets (const char *targets)
+{
+    int count;
+
+    if (!targets || !targets[0])
+        return 0;
+
+    count = 1;
+    while (targets[0])
+    {
+        if (targets[0] == ',')
+            count++;
+        targets++;
+    }
+
+    return count;
+}
+
+/*
+ * Gets max number of targets allowed in one message for a command, using
+ * value of TARGMAX sent by server (format: "JOIN:,WHO:1,PRIVMSG:4").
+ *
+ * Returns max number of targets, 0 if there is no limit, "default_max" if
+ * "targmax" is NULL or empty, if the command is not in "targmax" or if its
+ * value is not a positive number.
+ */
+
+int
+irc_message_get_max_targets (const char *targmax, const char *command,
+                             int default_max)
+{
+    char **items, *pos, *error;
+    int i, num_items, max_targets;
+    long number;
+
+    if (!targmax || !targmax[0] || !command)
+        return default_max;
+
+    max_targets = default_max;
+
+    items = weechat_string_split (targmax, ",", 0, 0, &num_items);
+    if (items)
+    {
+        for (i = 0; i < num_items; i++)
+        {
+            pos = strchr (items[i], ':');
+            if (!pos)
+                continue;
+            pos[0] = '\0';
+            if (weechat_strcasecmp (items[i], command) == 0)
+            {
+                /* no value means no limit, an invalid value is ignored */
+                if (pos[1])
+                {
+                    error = NULL;
+                    number = strtol (pos + 1, &error, 10);
+                    if (error && !error[0] && (number > 0))
+                        max_targets = (int)number;
+                }
+                else
+                {
+                    max_targets = 0;
+                }
+                break;
+            }
+        }
+        weechat_string_free_split (items);
+    }
+
+    return max_targets;
+}
+
+/*
+ * Gets max number of modes with a parameter allowed in one "MODE" message,
+ * using value of MODES sent by server (format: "4").
+ *
+ * Returns max number of modes (between 1 and 128), 4 if "modes" is NULL,
+ * empty or not a number.
+ */
+
+int
+irc_message_get_max_modes (const char *modes)
+{
+    char *error;
+    long number;
+
+    if (!modes || !modes[0])
+        return 4;
+
+    error = NULL;
+    number = strtol (modes, &error, 10);
+    if (!error || error[0])
+        return 4;
+
+    if (number < 1)
+        return 1;
+    if (number > 128)
+        return 128;
+
+    return (int)number;
+}
+
+/*
+ * Builds arguments for a JOIN message with all channels of a list (for rejoin
+ * after disconnection): "#channel1,#channel2,#channel3 key1,key2".
+ *
+ * Private buffers and channels parted are ignored. Channels with a key are
+ * first in list, so that keys match channels.
+ *
+ * Returns NULL if there is no channel to join.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_message_build_join_arguments (struct t_irc_channel *channels)
+{
+    struct t_irc_channel *ptr_channel;
+    char *list_channels, *keys, *arguments;
+    int length_channels, length_keys, pass;
+
+    length_channels = 1;
+    length_keys = 1;
+    for (ptr_channel = channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if ((ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
+            && !ptr_channel->part)
+        {
+            length_channels += strlen (ptr_channel->name) + 1;
+            if (ptr_channel->key)
+                length_keys += strlen (ptr_channel->key) + 1;
+        }
+    }
+    if (length_channels == 1)
+        return NULL;
+
+    list_channels = malloc (length_channels);
+    keys = malloc (length_keys);
+    arguments = malloc (length_channels + length_keys);
+    if (!list_channels || !keys || !arguments)
+    {
+        if (list_channels)
+            free (list_channels);
+        if (keys)
+            free (keys);
+        if (arguments)
+            free (arguments);
+        return NULL;
+    }
+    list_channels[0] = '\0';
+    keys[0] = '\0';
+
+    /* first pass: channels with a key, second pass: channels without key */
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (ptr_channel = channels; ptr_channel;
+             ptr_channel = ptr_channel->next_channel)
+        {
+            if ((ptr_channel->type != IRC_CHANNEL_TYPE_CHANNEL)
+                || ptr_channel->part
+                || ((pass == 0) && !ptr_channel->key)
+                || ((pass == 1) && ptr_channel->key))
+            {
+                continue;
+            }
+            if (list_channels[0])
+                strcat (list_channels, ",");
+            strcat (list_channels, ptr_channel->name);
+            if (ptr_channel->key)
+            {
+                if (keys[0])
+                    strcat (keys, ",");
+                strcat (keys, ptr_channel->key);
+            }
+        }
+    }
+
+    snprintf (arguments, length_channels + length_keys, "%s%s%s",
+              list_channels,
+              (keys[0]) ? " " : "",
+              keys);
+
+    free (list_channels);
+    free (keys);
+
+    return arguments;
+}
+
+/*
+ * Adds a "MODE" message in a NULL-terminated array of messages.
+ *
+ * Returns the array (reallocated), NULL if error (then the array is freed).
+ */
+
+char **
+irc_message_add_mode_message (char **messages, int *num_messages,
+                              const char *channel_name, char mode_sign,
+                              const char *modes, const char *args)
+{
+    char **new_messages;
+    int length;
+
+    new_messages = realloc (messages,
+                            (*num_messages + 2) * sizeof (*messages));
+    if (!new_messages)
+    {
+        if (messages)
+            weechat_string_free_split (messages);
+        return NULL;
+    }
+    messages = new_messages;
+
+    length = 5 + strlen (channel_name) + 2 + strlen (modes) + 1
+        + strlen (args) + 1;
+    messages[*num_messages] = malloc (length);
+    if (messages[*num_messages])
+    {
+        snprintf (messages[*num_messages], length, "MODE %s %c%s %s",
+                  channel_name, mode_sign, modes, args);
+        (*num_messages)++;
+    }
+    messages[*num_messages] = NULL;
+
+    return messages;
+}
+
+/*
+ * Builds "MODE" messages to set/unset a mode on a list of masks ("masks" is a
+ * NULL-terminated array), with many masks in each message, for example:
+ * "MODE #channel +bbb mask1 mask2 mask3".
+ *
+ * Each message has at most "max_modes" masks and is not longer than 510
+ * bytes (a single mask longer than that is sent in its own message).
+ * Argument "mode" can be "+b", "-b", "+q" or "-q".
+ *
+ * Returns a NULL-terminated array of messages, NULL if there is no mask.
+ *
+ * Note: result must be freed after use with function
+ * weechat_string_free_split.
+ */
+
+char **
+irc_message_build_mode_masks (const char *channel_name, const char *mode,
+                              char **masks, int max_modes)
+{
+    char **messages, modes[128+1], args[1024];
+    int i, modes_added, length_msg, num_messages;
+
+    if (!channel_name || !mode || !mode[0] || !masks)
+        return NULL;
+
+    if (max_modes < 1)
+        max_modes = 1;
+    if (max_modes > 128)
+        max_modes = 128;
+
+    /* length of "MODE #channel +" (without modes and arguments) */
+    length_msg = 5 + strlen (channel_name) + 2;
+
+    messages = NULL;
+    num_messages = 0;
+    modes_added = 0;
+    modes[0] = '\0';
+    args[0] = '\0';
+
+    for (i = 0; masks[i]; i++)
+    {
+        /*
+         * if we reached the max number of modes allowed or the max length of
+         * message, add the MODE message and flush the modes/args strings
+         */
+        if ((modes_added > 0)
+            && ((modes_added == max_modes)
+                || (length_msg + modes_added + 1 + (int)strlen (args) + 1
+                    + (int)strlen (masks[i]) + 1 > 510)
+                || (strlen (args) + 1 + strlen (masks[i]) + 1 > sizeof (args))))
+        {
+            messages = irc_message_add_mode_message (messages, &num_messages,
+                                                     channel_name, mode[0],
+                                                     modes, args);
+            if (!messages)
+                return NULL;
+            modes[0] = '\0';
+            args[0] = '\0';
+            modes_added = 0;
+        }
+
+        if (strlen (args) + 1 + strlen (masks[i]) + 1 <= sizeof (args))
+        {
+            strcat (modes, mode + 1);
+            if (args[0])
+                strcat (args, " ");
+            strcat (args, masks[i]);
+            modes_added++;
+        }
+        else
+        {
+            /* mask too long for the buffer: send it in its own message */
+            messages = irc_message_add_mode_message (messages, &num_messages,
+                                                     channel_name, mode[0],
+                                                     mode + 1, masks[i]);
+            if (!messages)
+                return NULL;
+        }
+    }
+
+    /* add a final MODE message if some masks are remaining */
+    if (modes_added > 0)
+    {
+        messages = irc_message_add_mode_message (messages, &num_messages,
+                                                 channel_name, mode[0],
+                                                 modes, args);
+    }
+
+    return messages;
+}
+
 /*
  * Adds a message + arguments in hashtable.
  */
@@ -586,6 +909,9 @@ irc_message_split_string (struct t_hashtable *hashtable,
  * Splits a JOIN message, taking care of keeping channel keys with channel
  * names.
  *
+ * If "max_targets" is greater than 0, each message has at most "max_targets"
+ * channels.
+ *
  * Returns:
  *   1: OK
  *   0: error
@@ -594,10 +920,10 @@ irc_message_split_string (struct t_hashtable *hashtable,
 int
 irc_message_split_join (struct t_hashtable *hashtable,
                         const char *tags, const char *host,
-                        const char *arguments)
+                        const char *arguments, int max_targets)
 {
     int number, channels_count, keys_count, length, length_no_channel;
-    int length_to_add, index_channel;
+    int length_to_add, index_channel, channels_added;
     char **channels, **keys, *pos, *str;
     char msg_to_send[2048], keys_to_add[2048];
 
@@ -635,12 +961,15 @@ irc_message_split_join (struct t_hashtable *hashtable,
     length_no_channel = length;
     keys_to_add[0] = '\0';
     index_channel = 0;
+    channels_added = 0;
     while (index_channel < channels_count)
     {
         length_to_add = 1 + strlen (channels[index_channel]);
         if (index_channel < keys_count)
             length_to_add += 1 + strlen (keys[index_channel]);
-        if ((length + length_to_add < 510) || (length == length_no_channel))
+        if (((length + length_to_add < 510)
+             && ((max_targets <= 0) || (channels_added < max_targets)))
+            || (length == length_no_channel))
         {
             if (length + length_to_add < (int)sizeof (msg_to_send))
             {
@@ -658,6 +987,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
             }
             length += length_to_add;
             index_channel++;
+            channels_added++;
         }
         else
         {
@@ -672,6 +1002,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
                       (host) ? " " : "");
             length = strlen (msg_to_send);
             keys_to_add[0] = '\0';
+            channels_added = 0;
         }
     }
 
@@ -692,6 +1023,103 @@ irc_message_split_join (struct t_hashtable *hashtable,
     return 1;
 }
 
+/*
+ * Splits a message with a list of targets separated by commas (for example
+ * "WHO #channel1,#channel2 o"): each message has at most "max_targets"
+ * targets (if "max_targets" is greater than 0) and is not longer than 510
+ * bytes.
+ *
+ * Argument "suffix" is added after the targets in each message (for example:
+ * " o").
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_message_split_targets (struct t_hashtable *hashtable,
+                           const char *tags, const char *host,
+                           const char *command, const char *targets,
+                           const char *suffix, int max_targets)
+{
+    char **list_targets, msg_to_send[1024], *msg_alone;
+    int number, i, targets_count, targets_added, length, length_no_target;
+    int length_suffix, length_to_add, length_alone;
+
+    list_targets = weechat_string_split (targets, ",", 0, 0, &targets_count);
+    if (!list_targets)
+        return 0;
+
+    number = 1;
+
+    snprintf (msg_to_send, sizeof (msg_to_send), "%s%s%s ",
+              (host) ? host : "",
+              (host) ? " " : "",
+              command);
+    length_no_target = strlen (msg_to_send);
+    length = length_no_target;
+    length_suffix = (suffix) ? strlen (suffix) : 0;
+    targets_added = 0;
+
+    for (i = 0; i < targets_count; i++)
+    {
+        length_to_add = ((targets_added > 0) ? 1 : 0) + strlen (list_targets[i]);
+        if ((targets_added > 0)
+            && ((length + length_to_add + length_suffix > 510)
+                || ((max_targets > 0) && (targets_added >= max_targets))))
+        {
+            /* message is full: add it and start a new message */
+            if (suffix)
+                strcat (msg_to_send, suffix);
+            irc_message_split_add (hashtable, number, tags, msg_to_send,
+                                   msg_to_send + length_no_target);
+            number++;
+            msg_to_send[length_no_target] = '\0';
+            length = length_no_target;
+            targets_added = 0;
+            length_to_add = strlen (list_targets[i]);
+        }
+        if (length + length_to_add + length_suffix < (int)sizeof (msg_to_send))
+        {
+            if (targets_added > 0)
+                strcat (msg_to_send, ",");
+            strcat (msg_to_send, list_targets[i]);
+            length += length_to_add;
+            targets_added++;
+        }
+        else
+        {
+            /* target too long for the buffer: send it in its own message */
+            length_alone = length_no_target + length_to_add + length_suffix + 1;
+            msg_alone = malloc (length_alone);
+            if (msg_alone)
+            {
+                snprintf (msg_alone, length_alone, "%s%s%s",
+                          msg_to_send,
+                          list_targets[i],
+                          (suffix) ? suffix : "");
+                irc_message_split_add (hashtable, number, tags, msg_alone,
+                                       msg_alone + length_no_target);
+                number++;
+                free (msg_alone);
+            }
+        }
+    }
+
+    if (targets_added > 0)
+    {
+        if (suffix)
+            strcat (msg_to_send, suffix);
+        irc_message_split_add (hashtable, number, tags, msg_to_send,
+                               msg_to_send + length_no_target);
+    }
+
+    weechat_string_free_split (list_targets);
+
+    return 1;
+}
+
 /*
  * Splits a PRIVMSG or NOTICE message, taking care of keeping the '\01' char
  * used in CTCP messages.
@@ -816,6 +1244,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
     char **argv, **argv_eol, *tags, *host, *command, *arguments, target[512];
     char *pos, monitor_action[3];
     int split_ok, argc, index_args, max_length_nick, max_length_host;
+    int max_targets;
 
     split_ok = 0;
     tags = NULL;
@@ -922,11 +1351,31 @@ irc_message_split (struct t_irc_server *server, const char *message)
     else if (weechat_strcasecmp (command, "join") == 0)
     {
         /* JOIN #channel1,#channel2,#channel3 key1,key2 */
-        if (strlen (message) > 510)
+        max_targets = irc_server_get_max_targets (server, "JOIN", 0);
+        if ((strlen (message) > 510)
+            || ((max_targets > 0)
+                && (irc_message_count_targets (argv[index_args]) > max_targets)))
         {
-            /* split join if it's more than 510 bytes */
+            /*
+             * split join if it's more than 510 bytes or if there are more
+             * channels than allowed by server
+             */
             split_ok = irc_message_split_join (hashtable, tags, host,
-                                               arguments);
+                                               arguments, max_targets);
+        }
+    }
+    else if (weechat_strcasecmp (command, "who") == 0)
+    {
+        /* WHO #channel1,#channel2,#channel3 o */
+        max_targets = irc_server_get_max_targets (server, "WHO", 0);
+        if ((strlen (message) > 510)
+            || ((max_targets > 0)
+                && (irc_message_count_targets (argv[index_args]) > max_targets)))
+        {
+            pos = strchr (arguments, ' ');
+            split_ok = irc_message_split_targets (hashtable, tags, host,
+                                                  command, argv[index_args],
+                                                  pos, max_targets);
         }
     }
     else if ((weechat_strcasecmp (command, "privmsg") == 0)
@@ -31,6 +31,22 @@ extern struct t_hashtable *irc_message_parse_to_hashtable (struct t_irc_server *
                                                            const char *message);
 extern const char *irc_message_get_nick_from_host (const char *host);
 extern const char *irc_message_get_address_from_host (const char *host);
+extern int irc_message_get_max_targets (const char *targmax,
+                                        const char *command,
+                                        int default_max);
+extern int irc_message_get_max_modes (const char *modes);
+extern char *irc_message_build_join_arguments (struct t_irc_channel *channels);
+extern char **irc_message_build_mode_masks (const char *channel_name,
+                                            const char *mode, char **masks,
+                                            int max_modes);
+extern int irc_message_split_join (struct t_hashtable *hashtable,
+                                   const char *tags, const char *host,
+                                   const char *arguments, int max_targets);
+extern int irc_message_split_targets (struct t_hashtable *hashtable,
+                                      const char *tags, const char *host,
+                                      const char *command,
+                                      const char *targets,
+                                      const char *suffix, int max_targets);
 extern char *irc_message_replace_vars (struct t_irc_server *server,
                                        const char *channel_name,
                                        const char *string);
@@ -2814,15 +2814,32 @@ IRC_PROTOCOL_CALLBACK(314)
 IRC_PROTOCOL_CALLBACK(315)
 {
     struct t_irc_channel *ptr_channel;
+    char **channels;
+    int i, num_channels, checking_away;
 
     IRC_PROTOCOL_MIN_ARGS(5);
 
-    ptr_channel = irc_channel_search (server, argv[3]);
-    if (ptr_channel && (ptr_channel->checking_away > 0))
+    /*
+     * end of WHO can be for many channels (if many channels were checked for
+     * away in a single WHO): "#channel1,#channel2"
+     */
+    checking_away = 0;
+    channels = weechat_string_split (argv[3], ",", 0, 0, &num_channels);
+    if (channels)
     {
-        ptr_channel->checking_away--;
+        for (i = 0; i < num_channels; i++)
+        {
+            ptr_channel = irc_channel_search (server, channels[i]);
+            if (ptr_channel && (ptr_channel->checking_away > 0))
+            {
+                ptr_channel->checking_away--;
+                checking_away = 1;
+            }
+        }
+        weechat_string_free_split (channels);
     }
-    else
+
+    if (!checking_away)
     {
         weechat_printf_date_tags (irc_msgbuffer_get_target_buffer (server, NULL,
                                                                    command, "who",
@@ -4394,7 +4411,7 @@ IRC_PROTOCOL_CALLBACK(366)
         {
             irc_command_mode_server (server, ptr_channel, NULL,
                                      IRC_SERVER_SEND_OUTQ_PRIO_LOW);
-            irc_channel_check_away (server, ptr_channel);
+            irc_server_check_away_channel (server, ptr_channel);
         }
     }
     else
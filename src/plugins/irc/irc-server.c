@@ -55,6 +55,7 @@
 #include "irc-color.h"
 #include "irc-command.h"
 #include "irc-config.h"
+#include "irc-flood.h"
 #include "irc-input.h"
 #include "irc-message.h"
 #include "irc-nick.h"
@@ -63,6 +64,7 @@
 #include "irc-raw.h"
 #include "irc-redirect.h"
 #include "irc-sasl.h"
+#include "irc-tls.h"
 
 
 struct t_irc_server *irc_servers = NULL;
@@ -71,6 +73,8 @@ struct t_irc_server *last_irc_server = NULL;
 struct t_irc_message *irc_recv_msgq = NULL;
 struct t_irc_message *irc_msgq_last_msg = NULL;
 
+struct t_memory_tag *irc_server_memory_tag_outqueue = NULL;
+
 char *irc_server_option_string[IRC_SERVER_NUM_OPTIONS] =
 { "addresses", "proxy", "ipv6",
   "ssl", "ssl_cert", "ssl_priorities", "ssl_dhkey_size", "ssl_fingerprint",
@@ -81,7 +85,7 @@ char *irc_server_option_string[IRC_SERVER_NUM_OPTIONS] =
   "nicks", "username", "realname", "local_hostname",
   "command", "command_delay", "autojoin", "autorejoin", "autorejoin_delay",
   "connection_timeout",
-  "anti_flood_prio_high", "anti_flood_prio_low",
+  "anti_flood_prio_high", "anti_flood_prio_low", "anti_flood_burst",
   "away_check", "away_check_max_nicks",
   "default_msg_kick", "default_msg_part", "default_msg_quit",
   "notify",
@@ -97,7 +101,7 @@ char *irc_server_option_default[IRC_SERVER_NUM_OPTIONS] =
   "", "", "", "",
   "", "0", "", "off", "30",
   "60",
-  "2", "2",
+  "2", "2", "1",
   "0", "25",
   "","WeeChat %v", "WeeChat %v",
   "",
@@ -116,6 +120,7 @@ const char *irc_server_send_default_tags = NULL;  /* default tags when       */
 
 void irc_server_reconnect (struct t_irc_server *server);
 void irc_server_free_data (struct t_irc_server *server);
+void irc_server_outqueue_send (struct t_irc_server *server);
 
 
 /*
@@ -679,6 +684,41 @@ irc_server_get_isupport_value (struct t_irc_server *server, const char *feature)
     return NULL;
 }
 
+/*
+ * Gets max number of targets allowed by server in one message for a command
+ * (in isupport value, with the format: "TARGMAX=JOIN:,WHO:1,PRIVMSG:4").
+ *
+ * Returns max number of targets, 0 if there is no limit, "default_max" if the
+ * command is not in TARGMAX (or if server did not send TARGMAX).
+ */
+
+int
+irc_server_get_max_targets (struct t_irc_server *server, const char *command,
+                            int default_max)
+{
+    if (!server)
+        return default_max;
+
+    return irc_message_get_max_targets (
+        irc_server_get_isupport_value (server, "TARGMAX"),
+        command,
+        default_max);
+}
+
+/*
+ * Gets max number of modes with a parameter allowed by server in one "MODE"
+ * message (in isupport value, with the format: "MODES=4").
+ *
+ * Returns max number of modes (4 if server did not send the info).
+ */
+
+int
+irc_server_get_max_modes (struct t_irc_server *server)
+{
+    return irc_message_get_max_modes (
+        irc_server_get_isupport_value (server, "MODES"));
+}
+
 /*
  * Sets "prefix_modes" and "prefix_chars" in server using value of PREFIX in IRC
  * message 005.
@@ -965,6 +1005,13 @@ irc_server_alloc (const char *name)
     new_server->is_connected = 0;
     new_server->ssl_connected = 0;
     new_server->disconnected = 0;
+#ifdef HAVE_GNUTLS
+    new_server->tls_session_key = NULL;
+    new_server->tls_session_data = NULL;
+    new_server->tls_session_data_size = 0;
+    new_server->tls_verified_certs = NULL;
+    new_server->tls_verified_until = 0;
+#endif
     new_server->unterminated_message = NULL;
     new_server->nicks_count = 0;
     new_server->nicks_array = NULL;
@@ -1004,7 +1051,21 @@ irc_server_alloc (const char *name)
     {
         new_server->outqueue[i] = NULL;
         new_server->last_outqueue[i] = NULL;
-    }
+        new_server->outqueue_count[i] = 0;
+    }
+    new_server->outqueue_latency = 0;
+    new_server->outqueue_latency_max = 0;
+    new_server->anti_flood_time.tv_sec = 0;
+    new_server->anti_flood_time.tv_usec = 0;
+    new_server->hook_timer_outqueue = NULL;
+    new_server->write_buffer = NULL;
+    new_server->write_buffer_size = 0;
+    new_server->write_buffer_length = 0;
+    new_server->write_again_size = 0;
+    new_server->write_buffer_overflow = 0;
+    new_server->write_hold = 0;
+    new_server->who_pending = NULL;
+    new_server->hook_timer_who = NULL;
     new_server->redirects = NULL;
     new_server->last_redirect = NULL;
     new_server->notify_list = NULL;
@@ -1318,6 +1379,128 @@ irc_server_apply_command_line_options (struct t_irc_server *server,
     }
 }
 
+/*
+ * Gets anti-flood delay for a queue priority (in milliseconds).
+ */
+
+long
+irc_server_anti_flood_interval (struct t_irc_server *server, int priority)
+{
+    return 1000L * ((priority == 0) ?
+                    IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH) :
+                    IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW));
+}
+
+/*
+ * Gets delay before a message with given priority can be sent (anti-flood,
+ * see file irc-flood.c).
+ *
+ * Returns delay in milliseconds (0 if message can be sent now).
+ */
+
+long
+irc_server_anti_flood_delay (struct t_irc_server *server, int priority,
+                             struct timeval *tv_now)
+{
+    long interval_max;
+    int i;
+
+    interval_max = 0;
+    for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
+    {
+        if (irc_server_anti_flood_interval (server, i) > interval_max)
+            interval_max = irc_server_anti_flood_interval (server, i);
+    }
+
+    return irc_flood_delay (
+        &server->anti_flood_time,
+        irc_server_anti_flood_interval (server, priority),
+        interval_max,
+        IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST),
+        tv_now);
+}
+
+/*
+ * Uses a token in anti-flood bucket (a message with given priority has been
+ * sent).
+ */
+
+void
+irc_server_anti_flood_use (struct t_irc_server *server, int priority,
+                           struct timeval *tv_now)
+{
+    irc_flood_use (&server->anti_flood_time,
+                   irc_server_anti_flood_interval (server, priority),
+                   tv_now);
+}
+
+/*
+ * Callback for timer sending queued messages.
+ */
+
+int
+irc_server_outqueue_timer_cb (void *data, int remaining_calls)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    server = (struct t_irc_server *)data;
+    if (!server)
+        return WEECHAT_RC_ERROR;
+
+    server->hook_timer_outqueue = NULL;
+
+    irc_server_outqueue_send (server);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Schedules sending of queued messages: the timer is set to the time when
+ * next message can be sent (or when pending data must be sent again).
+ */
+
+void
+irc_server_outqueue_schedule (struct t_irc_server *server)
+{
+    struct timeval tv_now;
+    long delay, delay_prio;
+    int priority;
+
+    if (server->hook_timer_outqueue)
+    {
+        weechat_unhook (server->hook_timer_outqueue);
+        server->hook_timer_outqueue = NULL;
+    }
+
+    delay = -1;
+    gettimeofday (&tv_now, NULL);
+    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    {
+        if (server->is_connected && server->outqueue[priority])
+        {
+            delay_prio = irc_server_anti_flood_delay (server, priority,
+                                                      &tv_now);
+            if ((delay < 0) || (delay_prio < delay))
+                delay = delay_prio;
+        }
+    }
+    if ((server->write_buffer_length > 0)
+        && ((delay < 0) || (delay > IRC_SERVER_WRITE_RETRY_DELAY)))
+    {
+        delay = IRC_SERVER_WRITE_RETRY_DELAY;
+    }
+
+    if (delay < 0)
+        return;
+
+    server->hook_timer_outqueue = weechat_hook_timer (
+        (delay > 0) ? delay : 1, 0, 1,
+        &irc_server_outqueue_timer_cb, server);
+}
+
 /*
  * Adds a message in out queue.
  */
@@ -1330,15 +1513,21 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
 {
     struct t_irc_outqueue *new_outqueue;
 
-    new_outqueue = malloc (sizeof (*new_outqueue));
+    new_outqueue = weechat_memory_malloc (irc_server_memory_tag_outqueue,
+                                          sizeof (*new_outqueue));
     if (new_outqueue)
     {
-        new_outqueue->command = (command) ? strdup (command) : strdup ("unknown");
-        new_outqueue->message_before_mod = (msg1) ? strdup (msg1) : NULL;
-        new_outqueue->message_after_mod = (msg2) ? strdup (msg2) : NULL;
+        new_outqueue->command = weechat_memory_strdup (
+            irc_server_memory_tag_outqueue, (command) ? command : "unknown");
+        new_outqueue->message_before_mod = weechat_memory_strdup (
+            irc_server_memory_tag_outqueue, msg1);
+        new_outqueue->message_after_mod = weechat_memory_strdup (
+            irc_server_memory_tag_outqueue, msg2);
         new_outqueue->modified = modified;
-        new_outqueue->tags = (tags) ? strdup (tags) : NULL;
+        new_outqueue->tags = weechat_memory_strdup (
+            irc_server_memory_tag_outqueue, tags);
         new_outqueue->redirect = redirect;
+        gettimeofday (&new_outqueue->time_queued, NULL);
 
         new_outqueue->prev_outqueue = server->last_outqueue[priority];
         new_outqueue->next_outqueue = NULL;
@@ -1347,6 +1536,11 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
         else
             server->outqueue[priority] = new_outqueue;
         server->last_outqueue[priority] = new_outqueue;
+        server->outqueue_count[priority]++;
+
+        /* wake up when the first message can be sent */
+        if (!server->hook_timer_outqueue)
+            irc_server_outqueue_schedule (server);
     }
 }
 
@@ -1377,14 +1571,25 @@ irc_server_outqueue_free (struct t_irc_server *server,
 
     /* free data */
     if (outqueue->command)
-        free (outqueue->command);
+    {
+        weechat_memory_free (irc_server_memory_tag_outqueue,
+                             outqueue->command);
+    }
     if (outqueue->message_before_mod)
-        free (outqueue->message_before_mod);
+    {
+        weechat_memory_free (irc_server_memory_tag_outqueue,
+                             outqueue->message_before_mod);
+    }
     if (outqueue->message_after_mod)
-        free (outqueue->message_after_mod);
+    {
+        weechat_memory_free (irc_server_memory_tag_outqueue,
+                             outqueue->message_after_mod);
+    }
     if (outqueue->tags)
-        free (outqueue->tags);
-    free (outqueue);
+        weechat_memory_free (irc_server_memory_tag_outqueue, outqueue->tags);
+    weechat_memory_free (irc_server_memory_tag_outqueue, outqueue);
+    if (server->outqueue_count[priority] > 0)
+        server->outqueue_count[priority]--;
 
     /* set new head */
     server->outqueue[priority] = new_outqueue;
@@ -1456,6 +1661,19 @@ irc_server_free_data (struct t_irc_server *server)
         weechat_unhook (server->hook_timer_connection);
     if (server->hook_timer_sasl)
         weechat_unhook (server->hook_timer_sasl);
+    if (server->hook_timer_outqueue)
+        weechat_unhook (server->hook_timer_outqueue);
+    if (server->write_buffer)
+        free (server->write_buffer);
+    if (server->hook_timer_who)
+        weechat_unhook (server->hook_timer_who);
+    if (server->who_pending)
+        free (server->who_pending);
+#ifdef HAVE_GNUTLS
+    irc_server_gnutls_free_session (server);
+    if (server->tls_verified_certs)
+        free (server->tls_verified_certs);
+#endif
     if (server->unterminated_message)
         free (server->unterminated_message);
     if (server->nicks_array)
@@ -1737,7 +1955,8 @@ irc_server_send_signal (struct t_irc_server *server, const char *signal,
 /*
  * Sends data to IRC server.
  *
- * Returns number of bytes sent, -1 if error.
+ * Returns number of bytes sent, 0 if socket is full (data must be sent again
+ * later), -1 if error.
  */
 
 int
@@ -1751,7 +1970,7 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
                         _("%s%s: sending data to server: null pointer (please "
                           "report problem to developers)"),
                         weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        return 0;
+        return -1;
     }
 
     if (size_buf <= 0)
@@ -1760,7 +1979,7 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
                         _("%s%s: sending data to server: empty buffer (please "
                           "report problem to developers)"),
                         weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        return 0;
+        return -1;
     }
 
 #ifdef HAVE_GNUTLS
@@ -1772,6 +1991,22 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
 
     if (rc < 0)
     {
+#ifdef HAVE_GNUTLS
+        if (server->ssl_connected
+            && ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED)))
+        {
+            return 0;
+        }
+        if (!server->ssl_connected
+            && ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                || (errno == EINTR)))
+        {
+            return 0;
+        }
+#else
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+            return 0;
+#endif
 #ifdef HAVE_GNUTLS
         if (server->ssl_connected)
         {
@@ -1795,6 +2030,150 @@ irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
     return rc;
 }
 
+/*
+ * Sends data in write buffer to IRC server.
+ *
+ * If socket is full, the data not sent is kept in buffer and will be sent
+ * later (by the timer of out queue).
+ *
+ * Returns:
+ *   1: OK (data sent or kept in buffer)
+ *   0: error (data is lost)
+ */
+
+int
+irc_server_write_flush (struct t_irc_server *server)
+{
+    int rc, size;
+
+    while (server->write_buffer_length > 0)
+    {
+        /* with TLS, a record not sent must be sent again with same size */
+        size = (server->write_again_size > 0) ?
+            server->write_again_size : server->write_buffer_length;
+        server->write_again_size = 0;
+
+        rc = irc_server_send (server, server->write_buffer, size);
+        if (rc < 0)
+        {
+            server->write_buffer_length = 0;
+            return 0;
+        }
+        if (rc == 0)
+        {
+            /* socket is full: send data later */
+#ifdef HAVE_GNUTLS
+            if (server->ssl_connected)
+                server->write_again_size = size;
+#endif
+            if (!server->hook_timer_outqueue)
+                irc_server_outqueue_schedule (server);
+            break;
+        }
+        if (rc < server->write_buffer_length)
+        {
+            memmove (server->write_buffer, server->write_buffer + rc,
+                     server->write_buffer_length - rc);
+        }
+        server->write_buffer_length -= rc;
+    }
+
+    return 1;
+}
+
+/*
+ * Writes data to IRC server.
+ *
+ * If write is on hold (see function irc_server_write_hold), data is added to
+ * write buffer and sent later (with other data), in one write.
+ *
+ * If data not sent would exceed IRC_SERVER_WRITE_BUFFER_MAX bytes, data is
+ * lost and the server is disconnected by the server timer (it is not done
+ * here because the caller may still use server data).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_server_write (struct t_irc_server *server, const char *data, int length)
+{
+    char *new_buffer;
+    int new_size;
+
+    if (length <= 0)
+        return 1;
+
+    if (server->write_buffer_overflow)
+        return 0;
+
+    if (server->write_buffer_length + length > IRC_SERVER_WRITE_BUFFER_MAX)
+    {
+        weechat_printf (server->buffer,
+                        _("%s%s: too much data not sent to server (more "
+                          "than %d bytes), disconnecting from server..."),
+                        weechat_prefix ("error"), IRC_PLUGIN_NAME,
+                        IRC_SERVER_WRITE_BUFFER_MAX);
+        server->write_buffer_overflow = 1;
+        return 0;
+    }
+
+    if (server->write_buffer_length + length > server->write_buffer_size)
+    {
+        new_size = (server->write_buffer_size > 0) ?
+            server->write_buffer_size : 4096;
+        while (new_size < server->write_buffer_length + length)
+        {
+            new_size *= 2;
+        }
+        new_buffer = realloc (server->write_buffer, new_size);
+        if (!new_buffer)
+            return 0;
+        server->write_buffer = new_buffer;
+        server->write_buffer_size = new_size;
+    }
+
+    memcpy (server->write_buffer + server->write_buffer_length, data, length);
+    server->write_buffer_length += length;
+
+    if (server->write_hold > 0)
+        return 1;
+
+    return irc_server_write_flush (server);
+}
+
+/*
+ * Puts write on hold: all data written is sent in one write by function
+ * irc_server_write_release.
+ */
+
+void
+irc_server_write_hold (struct t_irc_server *server)
+{
+    server->write_hold++;
+}
+
+/*
+ * Releases write on hold and sends data written (if no more hold).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+irc_server_write_release (struct t_irc_server *server)
+{
+    if (server->write_hold > 0)
+        server->write_hold--;
+
+    if (server->write_hold > 0)
+        return 1;
+
+    return irc_server_write_flush (server);
+}
+
 /*
  * Sets default tags used when sending message.
  */
@@ -1836,89 +2215,98 @@ irc_server_get_tags_to_send (const char *tags)
 }
 
 /*
- * Sends a message from out queue.
+ * Sends messages from out queue: all messages allowed by anti-flood are sent
+ * (in one write), then the timer is set for next message.
  */
 
 void
 irc_server_outqueue_send (struct t_irc_server *server)
 {
-    time_t time_now;
+    struct timeval tv_now;
+    struct t_irc_outqueue *ptr_outqueue;
     char *pos, *tags_to_send;
-    int priority, anti_flood;
+    int priority, latency;
 
-    time_now = time (NULL);
+    irc_server_write_hold (server);
 
-    /* detect if system clock has been changed (now lower than before) */
-    if (server->last_user_message > time_now)
-        server->last_user_message = time_now;
-
-    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    while (server->is_connected)
     {
-        switch (priority)
-        {
-            case 0:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                break;
-            default:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                break;
-        }
-        if (server->outqueue[priority]
-            && (time_now >= server->last_user_message + anti_flood))
+        gettimeofday (&tv_now, NULL);
+
+        /* look for first queue with a message that can be sent now */
+        for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO;
+             priority++)
         {
-            if (server->outqueue[priority]->message_before_mod)
+            if (server->outqueue[priority]
+                && (irc_server_anti_flood_delay (server, priority,
+                                                 &tv_now) == 0))
             {
-                pos = strchr (server->outqueue[priority]->message_before_mod,
-                              '\r');
-                if (pos)
-                    pos[0] = '\0';
-                irc_raw_print (server, IRC_RAW_FLAG_SEND,
-                               server->outqueue[priority]->message_before_mod);
-                if (pos)
-                    pos[0] = '\r';
+                break;
             }
-            if (server->outqueue[priority]->message_after_mod)
-            {
-                pos = strchr (server->outqueue[priority]->message_after_mod,
-                              '\r');
-                if (pos)
-                    pos[0] = '\0';
-                irc_raw_print (server, IRC_RAW_FLAG_SEND |
-                               ((server->outqueue[priority]->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
-                               server->outqueue[priority]->message_after_mod);
-                if (pos)
-                    pos[0] = '\r';
+        }
+        if (priority >= IRC_SERVER_NUM_OUTQUEUES_PRIO)
+            break;
 
-                /* send signal with command that will be sent to server */
-                irc_server_send_signal (server, "irc_out",
-                                        server->outqueue[priority]->command,
-                                        server->outqueue[priority]->message_after_mod,
-                                        NULL);
-                tags_to_send = irc_server_get_tags_to_send (server->outqueue[priority]->tags);
-                irc_server_send_signal (server, "irc_outtags",
-                                        server->outqueue[priority]->command,
-                                        server->outqueue[priority]->message_after_mod,
-                                        (tags_to_send) ? tags_to_send : "");
-                if (tags_to_send)
-                    free (tags_to_send);
+        ptr_outqueue = server->outqueue[priority];
 
-                /* send command */
-                irc_server_send (server, server->outqueue[priority]->message_after_mod,
-                                 strlen (server->outqueue[priority]->message_after_mod));
-                server->last_user_message = time_now;
+        if (ptr_outqueue->message_before_mod)
+        {
+            pos = strchr (ptr_outqueue->message_before_mod, '\r');
+            if (pos)
+                pos[0] = '\0';
+            irc_raw_print (server, IRC_RAW_FLAG_SEND,
+                           ptr_outqueue->message_before_mod);
+            if (pos)
+                pos[0] = '\r';
+        }
+        if (ptr_outqueue->message_after_mod)
+        {
+            pos = strchr (ptr_outqueue->message_after_mod, '\r');
+            if (pos)
+                pos[0] = '\0';
+            irc_raw_print (server, IRC_RAW_FLAG_SEND |
+                           ((ptr_outqueue->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
+                           ptr_outqueue->message_after_mod);
+            if (pos)
+                pos[0] = '\r';
 
-                /* start redirection if redirect is set */
-                if (server->outqueue[priority]->redirect)
-                {
-                    irc_redirect_init_command (server->outqueue[priority]->redirect,
-                                               server->outqueue[priority]->message_after_mod);
-                }
+            /* send signal with command that will be sent to server */
+            irc_server_send_signal (server, "irc_out",
+                                    ptr_outqueue->command,
+                                    ptr_outqueue->message_after_mod,
+                                    NULL);
+            tags_to_send = irc_server_get_tags_to_send (ptr_outqueue->tags);
+            irc_server_send_signal (server, "irc_outtags",
+                                    ptr_outqueue->command,
+                                    ptr_outqueue->message_after_mod,
+                                    (tags_to_send) ? tags_to_send : "");
+            if (tags_to_send)
+                free (tags_to_send);
+
+            /* send command (in write buffer, sent after the loop) */
+            irc_server_write (server, ptr_outqueue->message_after_mod,
+                              strlen (ptr_outqueue->message_after_mod));
+            irc_server_anti_flood_use (server, priority, &tv_now);
+            server->last_user_message = tv_now.tv_sec;
+            latency = weechat_util_timeval_diff (&ptr_outqueue->time_queued,
+                                                 &tv_now);
+            server->outqueue_latency = (latency > 0) ? latency : 0;
+            if (server->outqueue_latency > server->outqueue_latency_max)
+                server->outqueue_latency_max = server->outqueue_latency;
+
+            /* start redirection if redirect is set */
+            if (ptr_outqueue->redirect)
+            {
+                irc_redirect_init_command (ptr_outqueue->redirect,
+                                           ptr_outqueue->message_after_mod);
             }
-            irc_server_outqueue_free (server, priority,
-                                      server->outqueue[priority]);
-            break;
         }
+        irc_server_outqueue_free (server, priority, ptr_outqueue);
     }
+
+    irc_server_write_release (server);
+
+    irc_server_outqueue_schedule (server);
 }
 
 /*
@@ -1945,8 +2333,8 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     const char *ptr_msg, *ptr_chan_nick;
     char *new_msg, *pos, *tags_to_send, *msg_encoded;
     char str_modifier[128], modifier_data[256];
-    int rc, queue_msg, add_to_queue, first_message, anti_flood;
-    time_t time_now;
+    int rc, queue_msg, add_to_queue, first_message;
+    struct timeval tv_now;
     struct t_irc_redirect *ptr_redirect;
 
     rc = 1;
@@ -2004,13 +2392,6 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
 
             snprintf (buffer, sizeof (buffer), "%s\r\n", ptr_msg);
 
-            /* anti-flood: look whether we should queue outgoing message or not */
-            time_now = time (NULL);
-
-            /* detect if system clock has been changed (now lower than before) */
-            if (server->last_user_message > time_now)
-                server->last_user_message = time_now;
-
             /* get queue from flags */
             queue_msg = 0;
             if (flags & IRC_SERVER_SEND_OUTQ_PRIO_HIGH)
@@ -2018,21 +2399,13 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
             else if (flags & IRC_SERVER_SEND_OUTQ_PRIO_LOW)
                 queue_msg = 2;
 
-            switch (queue_msg - 1)
-            {
-                case 0:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                    break;
-                default:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                    break;
-            }
-
+            /* anti-flood: look whether we should queue outgoing message or not */
+            gettimeofday (&tv_now, NULL);
             add_to_queue = 0;
             if ((queue_msg > 0)
                 && (server->outqueue[queue_msg - 1]
-                    || ((anti_flood > 0)
-                        && (time_now - server->last_user_message < anti_flood))))
+                    || (irc_server_anti_flood_delay (server, queue_msg - 1,
+                                                     &tv_now) > 0)))
             {
                 add_to_queue = queue_msg;
             }
@@ -2077,12 +2450,16 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
                                         ptr_msg,
                                         (tags_to_send) ? tags_to_send : "");
 
-                if (irc_server_send (server, buffer, strlen (buffer)) <= 0)
+                if (!irc_server_write (server, buffer, strlen (buffer)))
                     rc = 0;
                 else
                 {
                     if (queue_msg > 0)
-                        server->last_user_message = time_now;
+                    {
+                        irc_server_anti_flood_use (server, queue_msg - 1,
+                                                   &tv_now);
+                        server->last_user_message = tv_now.tv_sec;
+                    }
                 }
                 if (ptr_redirect)
                     irc_redirect_init_command (ptr_redirect, buffer);
@@ -2156,6 +2533,9 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
                                                NULL);
     }
 
+    /* all messages are sent in one write */
+    irc_server_write_hold (server);
+
     rc = 1;
     items = weechat_string_split (vbuffer, "\n", 0, 0, &items_count);
     for (i = 0; i < items_count; i++)
@@ -2241,6 +2621,8 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
     if (items)
         weechat_string_free_split (items);
 
+    irc_server_write_release (server);
+
     free (vbuffer);
 
     return ret_hashtable;
@@ -2848,8 +3230,19 @@ irc_server_timer_cb (void *data, int remaining_calls)
             if (!ptr_server->is_connected)
                 continue;
 
-            /* send queued messages */
-            irc_server_outqueue_send (ptr_server);
+            /* too much data not sent to server: disconnect */
+            if (ptr_server->write_buffer_overflow)
+            {
+                irc_server_disconnect (ptr_server, 0, 1);
+                continue;
+            }
+
+            /* send queued messages (if they were queued before connection) */
+            if (!ptr_server->hook_timer_outqueue
+                && (ptr_server->outqueue[0] || ptr_server->outqueue[1]))
+            {
+                irc_server_outqueue_schedule (ptr_server);
+            }
 
             /* check for lag */
             if ((weechat_config_integer (irc_config_network_lag_check) > 0)
@@ -3022,7 +3415,11 @@ irc_server_close_connection (struct t_irc_server *server)
         if (server->ssl_connected)
         {
             if (server->sock != -1)
+            {
+                /* session tickets may have been received after handshake */
+                irc_server_gnutls_save_session (server);
                 gnutls_bye (server->gnutls_sess, GNUTLS_SHUT_WR);
+            }
             gnutls_deinit (server->gnutls_sess);
         }
 #endif
@@ -3047,6 +3444,26 @@ irc_server_close_connection (struct t_irc_server *server)
     {
         irc_server_outqueue_free_all (server, i);
     }
+    if (server->hook_timer_outqueue)
+    {
+        weechat_unhook (server->hook_timer_outqueue);
+        server->hook_timer_outqueue = NULL;
+    }
+
+    /* free data not sent */
+    server->write_buffer_length = 0;
+    server->write_again_size = 0;
+    server->write_buffer_overflow = 0;
+    if (server->hook_timer_who)
+    {
+        weechat_unhook (server->hook_timer_who);
+        server->hook_timer_who = NULL;
+    }
+    if (server->who_pending)
+    {
+        free (server->who_pending);
+        server->who_pending = NULL;
+    }
 
     /* remove all redirects */
     irc_redirect_free_all (server);
@@ -3260,6 +3677,18 @@ irc_server_connect_cb (void *data, int status, int gnutls_rc, int sock,
                             server->current_address,
                             server->current_port,
                             (server->current_ip) ? server->current_ip : "?");
+#ifdef HAVE_GNUTLS
+            if (server->ssl_connected)
+            {
+                if (gnutls_session_is_resumed (server->gnutls_sess))
+                {
+                    weechat_printf (server->buffer,
+                                    _("%sgnutls: TLS session resumed"),
+                                    weechat_prefix ("network"));
+                }
+                irc_server_gnutls_save_session (server);
+            }
+#endif
             server->hook_fd = weechat_hook_fd (server->sock,
                                                1, 0, 0,
                                                &irc_server_recv_cb,
@@ -3376,6 +3805,8 @@ irc_server_connect_cb (void *data, int status, int gnutls_rc, int sock,
                                 error);
             }
 #ifdef HAVE_GNUTLS
+            /* session saved may be the cause of error: don't resume it */
+            irc_server_gnutls_free_session (server);
             if (gnutls_rc == GNUTLS_E_DH_PRIME_UNACCEPTABLE)
             {
                 weechat_printf (server->buffer,
@@ -3652,6 +4083,119 @@ irc_server_check_certificate_fingerprint (struct t_irc_server *server,
     return rc;
 }
 
+/*
+ * Gets CA file used to verify certificates (option
+ * "weechat.network.gnutls_ca_file").
+ */
+
+const char *
+irc_server_gnutls_ca_file ()
+{
+    return weechat_config_string (
+        weechat_config_get ("weechat.network.gnutls_ca_file"));
+}
+
+/*
+ * Builds key for TLS session of a server: a session is resumed only if
+ * address, port and SSL options are the same as when it was saved.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_gnutls_session_key (struct t_irc_server *server)
+{
+    return irc_tls_session_key (
+        server->current_address,
+        server->current_port,
+        IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_SSL_PRIORITIES),
+        IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_SSL_DHKEY_SIZE),
+        IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_SSL_CERT),
+        IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_SSL_FINGERPRINT),
+        IRC_SERVER_OPTION_BOOLEAN(server, IRC_SERVER_OPTION_SSL_VERIFY),
+        irc_server_gnutls_ca_file ());
+}
+
+/*
+ * Frees TLS session saved for a server.
+ */
+
+void
+irc_server_gnutls_free_session (struct t_irc_server *server)
+{
+    if (server->tls_session_key)
+    {
+        free (server->tls_session_key);
+        server->tls_session_key = NULL;
+    }
+    if (server->tls_session_data)
+    {
+        free (server->tls_session_data);
+        server->tls_session_data = NULL;
+    }
+    server->tls_session_data_size = 0;
+}
+
+/*
+ * Saves TLS session of a server (after handshake, or when connection is
+ * closed), so that it can be resumed on next connection.
+ */
+
+void
+irc_server_gnutls_save_session (struct t_irc_server *server)
+{
+    gnutls_datum_t session_data;
+    char *key;
+
+    if (!server->ssl_connected)
+        return;
+
+    if (gnutls_session_get_data2 (server->gnutls_sess,
+                                  &session_data) != GNUTLS_E_SUCCESS)
+        return;
+
+    key = irc_server_gnutls_session_key (server);
+    if (key && session_data.data && (session_data.size > 0))
+    {
+        irc_server_gnutls_free_session (server);
+        server->tls_session_data = malloc (session_data.size);
+        if (server->tls_session_data)
+        {
+            memcpy (server->tls_session_data, session_data.data,
+                    session_data.size);
+            server->tls_session_data_size = session_data.size;
+            server->tls_session_key = key;
+            key = NULL;
+        }
+    }
+
+    if (key)
+        free (key);
+    if (session_data.data)
+        gnutls_free (session_data.data);
+}
+
+/*
+ * Builds an identifier for certificates received from server (with options
+ * used to verify them).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_gnutls_certs_id (struct t_irc_server *server,
+                            const gnutls_datum_t *cert_list,
+                            unsigned int cert_list_len)
+{
+    return irc_tls_certs_id (
+        server->current_address,
+        IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_SSL_FINGERPRINT),
+        IRC_SERVER_OPTION_BOOLEAN(server, IRC_SERVER_OPTION_SSL_VERIFY),
+        irc_server_gnutls_ca_file (),
+        cert_list,
+        cert_list_len);
+}
+
 /*
  * GnuTLS callback called during handshake.
  *
@@ -3683,7 +4227,9 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
     gnutls_datum_t filedatum;
     unsigned int i, cert_list_len, status;
     time_t cert_time;
-    char *cert_path0, *cert_path1, *cert_path2, *cert_str;
+    time_t certs_until;
+    char *cert_path0, *cert_path1, *cert_path2, *cert_str, *certs_id;
+    char *session_key;
     const char *weechat_dir, *fingerprint;
     int rc, ret, fingerprint_match, hostname_match, cert_temp_init;
 #if LIBGNUTLS_VERSION_NUMBER >= 0x010706
@@ -3706,6 +4252,8 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
     cert_temp_init = 0;
     cert_list = NULL;
     cert_list_len = 0;
+    certs_id = NULL;
+    certs_until = 0;
 
     if (action == WEECHAT_HOOK_CONNECT_GNUTLS_CB_VERIFY_CERT)
     {
@@ -3740,6 +4288,23 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
 
         /* get the peer's raw certificate (chain) as sent by the peer */
         cert_list = gnutls_certificate_get_peers (tls_session, &cert_list_len);
+
+        /*
+         * if same certificates have already been verified (and are still
+         * valid), don't check them again
+         */
+        certs_id = irc_server_gnutls_certs_id (server, cert_list,
+                                               cert_list_len);
+        if (certs_id && server->tls_verified_certs
+            && (strcmp (certs_id, server->tls_verified_certs) == 0)
+            && (time (NULL) < server->tls_verified_until))
+        {
+            weechat_printf (server->buffer,
+                            _("%sgnutls: certificates already verified"),
+                            weechat_prefix ("network"));
+            goto end;
+        }
+
         if (cert_list)
         {
             weechat_printf (server->buffer,
@@ -3763,6 +4328,11 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
                     goto end;
                 }
 
+                /* keep the first expiration date of certificates */
+                cert_time = gnutls_x509_crt_get_expiration_time (cert_temp);
+                if ((certs_until == 0) || (cert_time < certs_until))
+                    certs_until = cert_time;
+
                 /* checks on first certificate received */
                 if (i == 0)
                 {
@@ -4008,7 +4578,42 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
         }
     }
 
+    else if (action == WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_SESSION)
+    {
+        /* resume last TLS session if SSL options have not changed */
+        if (server->tls_session_data && server->tls_session_key)
+        {
+            session_key = irc_server_gnutls_session_key (server);
+            if (session_key
+                && (strcmp (session_key, server->tls_session_key) == 0))
+            {
+                gnutls_session_set_data (tls_session,
+                                         server->tls_session_data,
+                                         server->tls_session_data_size);
+            }
+            if (session_key)
+                free (session_key);
+        }
+    }
+
 end:
+    /* remember certificates verified, to not check them again */
+    if ((action == WEECHAT_HOOK_CONNECT_GNUTLS_CB_VERIFY_CERT)
+        && (rc == 0) && certs_id && (certs_until > 0))
+    {
+        certs_until = irc_tls_verified_until (certs_until, time (NULL));
+        if (certs_until > 0)
+        {
+            if (server->tls_verified_certs)
+                free (server->tls_verified_certs);
+            server->tls_verified_certs = certs_id;
+            server->tls_verified_until = certs_until;
+            certs_id = NULL;
+        }
+    }
+    if (certs_id)
+        free (certs_id);
+
     /* an error should stop the handshake unless the user doesn't care */
     if ((rc == -1)
         && (IRC_SERVER_OPTION_BOOLEAN(server, IRC_SERVER_OPTION_SSL_VERIFY) == 0))
@@ -4394,33 +4999,21 @@ irc_server_disconnect_all ()
 void
 irc_server_autojoin_channels (struct t_irc_server *server)
 {
-    struct t_irc_channel *ptr_channel;
-    char *autojoin;
+    char *autojoin, *rejoin;
 
     /* auto-join after disconnection (only rejoins opened channels) */
     if (!server->disable_autojoin && server->reconnect_join && server->channels)
     {
-        for (ptr_channel = server->channels; ptr_channel;
-             ptr_channel = ptr_channel->next_channel)
+        /*
+         * all channels are joined with a single JOIN, split according to
+         * server limits (TARGMAX and length of messages)
+         */
+        rejoin = irc_message_build_join_arguments (server->channels);
+        if (rejoin)
         {
-            if ((ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
-                && !ptr_channel->part)
-            {
-                if (ptr_channel->key)
-                {
-                    irc_server_sendf (server,
-                                      IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                                      "JOIN %s %s",
-                                      ptr_channel->name, ptr_channel->key);
-                }
-                else
-                {
-                    irc_server_sendf (server,
-                                      IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                                      "JOIN %s",
-                                      ptr_channel->name);
-                }
-            }
+            irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
+                              "JOIN %s", rejoin);
+            free (rejoin);
         }
         server->reconnect_join = 0;
     }
@@ -4543,6 +5136,108 @@ irc_server_remove_away (struct t_irc_server *server)
     }
 }
 
+/*
+ * Sends pending WHO (channels to check for away) to server.
+ */
+
+void
+irc_server_who_flush (struct t_irc_server *server)
+{
+    if (server->hook_timer_who)
+    {
+        weechat_unhook (server->hook_timer_who);
+        server->hook_timer_who = NULL;
+    }
+
+    if (server->who_pending)
+    {
+        /* the WHO is split according to server limits (TARGMAX) */
+        if (server->is_connected && server->who_pending[0])
+        {
+            irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_LOW, NULL,
+                              "WHO %s", server->who_pending);
+        }
+        free (server->who_pending);
+        server->who_pending = NULL;
+    }
+}
+
+/*
+ * Callback for timer sending pending WHO.
+ */
+
+int
+irc_server_who_timer_cb (void *data, int remaining_calls)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    server = (struct t_irc_server *)data;
+    if (!server)
+        return WEECHAT_RC_ERROR;
+
+    server->hook_timer_who = NULL;
+
+    irc_server_who_flush (server);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Checks for away on a channel.
+ *
+ * If server allows many channels in a WHO (TARGMAX), the channel is added to
+ * pending WHO, which is sent after a short delay (so that channels joined at
+ * same time are checked with a single WHO), otherwise a WHO is sent now for
+ * the channel.
+ */
+
+void
+irc_server_check_away_channel (struct t_irc_server *server,
+                               struct t_irc_channel *channel)
+{
+    char *new_who_pending;
+    int length;
+
+    if ((channel->type != IRC_CHANNEL_TYPE_CHANNEL) || !channel->nicks)
+        return;
+
+    if (irc_server_get_max_targets (server, "WHO", 1) == 1)
+    {
+        irc_channel_check_away (server, channel);
+        return;
+    }
+
+    if (!irc_channel_check_away_enabled (server, channel))
+    {
+        irc_channel_remove_away (server, channel);
+        return;
+    }
+
+    length = ((server->who_pending) ? strlen (server->who_pending) + 1 : 0)
+        + strlen (channel->name) + 1;
+    new_who_pending = realloc (server->who_pending, length);
+    if (!new_who_pending)
+        return;
+    if (!server->who_pending)
+        new_who_pending[0] = '\0';
+    server->who_pending = new_who_pending;
+    if (server->who_pending[0])
+        strcat (server->who_pending, ",");
+    strcat (server->who_pending, channel->name);
+
+    channel->checking_away++;
+
+    if (!server->hook_timer_who)
+    {
+        server->hook_timer_who = weechat_hook_timer (
+            IRC_SERVER_WHO_BATCH_DELAY, 0, 1,
+            &irc_server_who_timer_cb, server);
+    }
+}
+
 /*
  * Checks for away on all channels of a server.
  */
@@ -4558,8 +5253,9 @@ irc_server_check_away (struct t_irc_server *server)
              ptr_channel = ptr_channel->next_channel)
         {
             if (ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
-                irc_channel_check_away (server, ptr_channel);
+                irc_server_check_away_channel (server, ptr_channel);
         }
+        irc_server_who_flush (server);
         server->last_away_check = time (NULL);
     }
 }
@@ -4855,6 +5551,11 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
         WEECHAT_HDATA_VAR(struct t_irc_server, gnutls_sess, OTHER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert, OTHER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, tls_cert_key, OTHER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, tls_session_key, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, tls_session_data, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, tls_session_data_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, tls_verified_certs, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, tls_verified_until, TIME, 0, NULL, NULL);
 #endif
         WEECHAT_HDATA_VAR(struct t_irc_server, unterminated_message, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, nicks_count, INTEGER, 0, NULL, NULL);
@@ -4891,6 +5592,19 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
         WEECHAT_HDATA_VAR(struct t_irc_server, last_data_purge, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, outqueue, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_outqueue, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_count, INTEGER, 0, "2", NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_latency, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_latency_max, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, anti_flood_time, OTHER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_outqueue, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, write_buffer, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, write_buffer_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, write_buffer_length, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, write_again_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, write_buffer_overflow, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, write_hold, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, who_pending, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_who, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, redirects, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_redirect, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_list, POINTER, 0, NULL, "irc_notify");
@@ -5031,6 +5745,9 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
     if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_prio_low",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW)))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_burst",
+                                           IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST)))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "away_check",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK)))
         return 0;
@@ -5066,6 +5783,17 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "disconnected", server->disconnected))
         return 0;
+#ifdef HAVE_GNUTLS
+    if (!weechat_infolist_new_var_string (ptr_item, "tls_session_key", server->tls_session_key))
+        return 0;
+    if (server->tls_session_data
+        && !weechat_infolist_new_var_buffer (ptr_item, "tls_session_data", server->tls_session_data, server->tls_session_data_size))
+        return 0;
+    if (!weechat_infolist_new_var_string (ptr_item, "tls_verified_certs", server->tls_verified_certs))
+        return 0;
+    if (!weechat_infolist_new_var_time (ptr_item, "tls_verified_until", server->tls_verified_until))
+        return 0;
+#endif
     if (!weechat_infolist_new_var_string (ptr_item, "unterminated_message", server->unterminated_message))
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "nick", server->nick))
@@ -5120,6 +5848,8 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_user_message", server->last_user_message))
         return 0;
+    if (!weechat_infolist_new_var_buffer (ptr_item, "anti_flood_time", &(server->anti_flood_time), sizeof (struct timeval)))
+        return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_away_check", server->last_away_check))
         return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_data_purge", server->last_data_purge))
@@ -5353,6 +6083,13 @@ irc_server_print_log ()
         else
             weechat_log_printf ("  anti_flood_prio_low. : %d",
                                 weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]));
+        /* anti_flood_burst */
+        if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]))
+            weechat_log_printf ("  anti_flood_burst . . : null (%d)",
+                                IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST));
+        else
+            weechat_log_printf ("  anti_flood_burst . . : %d",
+                                weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST]));
         /* away_check */
         if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_log_printf ("  away_check . . . . . : null (%d)",
@@ -5411,6 +6148,11 @@ irc_server_print_log ()
         weechat_log_printf ("  disconnected . . . . : %d",    ptr_server->disconnected);
 #ifdef HAVE_GNUTLS
         weechat_log_printf ("  gnutls_sess. . . . . : 0x%lx", ptr_server->gnutls_sess);
+        weechat_log_printf ("  tls_session_key. . . : '%s'",  ptr_server->tls_session_key);
+        weechat_log_printf ("  tls_session_data . . : 0x%lx", ptr_server->tls_session_data);
+        weechat_log_printf ("  tls_session_data_size: %d",    ptr_server->tls_session_data_size);
+        weechat_log_printf ("  tls_verified_certs . : '%s'",  ptr_server->tls_verified_certs);
+        weechat_log_printf ("  tls_verified_until . : %ld",   (long)ptr_server->tls_verified_until);
 #endif
         weechat_log_printf ("  unterminated_message : '%s'",  ptr_server->unterminated_message);
         weechat_log_printf ("  nicks_count. . . . . : %d",    ptr_server->nicks_count);
@@ -5453,7 +6195,22 @@ irc_server_print_log ()
         {
             weechat_log_printf ("  outqueue[%02d] . . . . : 0x%lx", i, ptr_server->outqueue[i]);
             weechat_log_printf ("  last_outqueue[%02d]. . : 0x%lx", i, ptr_server->last_outqueue[i]);
+            weechat_log_printf ("  outqueue_count[%02d] . : %d",   i, ptr_server->outqueue_count[i]);
         }
+        weechat_log_printf ("  outqueue_latency . . : %d",    ptr_server->outqueue_latency);
+        weechat_log_printf ("  outqueue_latency_max : %d",    ptr_server->outqueue_latency_max);
+        weechat_log_printf ("  anti_flood_time. . . : tv_sec:%d, tv_usec:%d",
+                            ptr_server->anti_flood_time.tv_sec,
+                            ptr_server->anti_flood_time.tv_usec);
+        weechat_log_printf ("  hook_timer_outqueue. : 0x%lx", ptr_server->hook_timer_outqueue);
+        weechat_log_printf ("  write_buffer . . . . : 0x%lx", ptr_server->write_buffer);
+        weechat_log_printf ("  write_buffer_size. . : %d",    ptr_server->write_buffer_size);
+        weechat_log_printf ("  write_buffer_length. : %d",    ptr_server->write_buffer_length);
+        weechat_log_printf ("  write_again_size . . : %d",    ptr_server->write_again_size);
+        weechat_log_printf ("  write_buffer_overflow: %d",    ptr_server->write_buffer_overflow);
+        weechat_log_printf ("  write_hold . . . . . : %d",    ptr_server->write_hold);
+        weechat_log_printf ("  who_pending. . . . . : '%s'",  ptr_server->who_pending);
+        weechat_log_printf ("  hook_timer_who . . . : 0x%lx", ptr_server->hook_timer_who);
         weechat_log_printf ("  redirects. . . . . . : 0x%lx", ptr_server->redirects);
         weechat_log_printf ("  last_redirect. . . . : 0x%lx", ptr_server->last_redirect);
         weechat_log_printf ("  notify_list. . . . . : 0x%lx", ptr_server->notify_list);
@@ -64,6 +64,7 @@ enum t_irc_server_option
     IRC_SERVER_OPTION_CONNECTION_TIMEOUT,   /* timeout for connection        */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH, /* anti-flood (high priority)    */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW,  /* anti-flood (low priority)     */
+    IRC_SERVER_OPTION_ANTI_FLOOD_BURST,     /* anti-flood: max burst         */
     IRC_SERVER_OPTION_AWAY_CHECK,           /* delay between away checks     */
     IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS, /* max nicks for away check      */
     IRC_SERVER_OPTION_DEFAULT_MSG_KICK,     /* default kick message          */
@@ -107,6 +108,21 @@ enum t_irc_server_option
 #define IRC_SERVER_SEND_OUTQ_PRIO_LOW    2
 #define IRC_SERVER_SEND_RETURN_HASHTABLE 4
 
+/* delay before sending again data (if socket was full), in milliseconds */
+#define IRC_SERVER_WRITE_RETRY_DELAY 50
+
+/*
+ * max size of data not sent to server (socket full): if this size is
+ * reached, the server is disconnected
+ */
+#define IRC_SERVER_WRITE_BUFFER_MAX (1024 * 1024)
+
+/*
+ * delay before sending WHO for channels joined (channels joined at same time
+ * are checked in a single WHO), in milliseconds
+ */
+#define IRC_SERVER_WHO_BATCH_DELAY 100
+
 /* casemapping (string comparisons for nicks/channels) */
 enum t_irc_server_casemapping
 {
@@ -127,6 +143,7 @@ struct t_irc_outqueue
     int modified;                         /* msg was modified by modifier(s) */
     char *tags;                           /* tags (used by Relay plugin)     */
     struct t_irc_redirect *redirect;      /* command redirection             */
+    struct timeval time_queued;           /* time when msg was queued        */
     struct t_irc_outqueue *next_outqueue; /* link to next msg in queue       */
     struct t_irc_outqueue *prev_outqueue; /* link to prev msg in queue       */
 };
@@ -163,6 +180,11 @@ struct t_irc_server
     gnutls_session_t gnutls_sess;   /* gnutls session (only if SSL is used)  */
     gnutls_x509_crt_t tls_cert;     /* certificate used if ssl_cert is set   */
     gnutls_x509_privkey_t tls_cert_key; /* key used if ssl_cert is set       */
+    char *tls_session_key;          /* options used for TLS session below    */
+    void *tls_session_data;         /* data of last TLS session (to resume)  */
+    int tls_session_data_size;      /* size of TLS session data              */
+    char *tls_verified_certs;       /* id of last certificates verified      */
+    time_t tls_verified_until;      /* verified certificates expire at       */
 #endif
     char *unterminated_message;     /* beginning of a message in input buf   */
     int nicks_count;                /* number of nicknames                   */
@@ -204,6 +226,25 @@ struct t_irc_server
     struct t_irc_outqueue *outqueue[2];      /* queue for outgoing messages  */
                                              /* with 2 priorities (high/low) */
     struct t_irc_outqueue *last_outqueue[2]; /* last outgoing message        */
+    int outqueue_count[2];                   /* number of messages in queues */
+    int outqueue_latency;                    /* time in queue of last msg    */
+                                             /* sent (in milliseconds)       */
+    int outqueue_latency_max;                /* max time in queue (in ms)    */
+    struct timeval anti_flood_time;          /* anti-flood: time when next   */
+                                             /* msg can be sent (w/o burst)  */
+    struct t_hook *hook_timer_outqueue;      /* timer to send queued msgs    */
+    char *write_buffer;                      /* data to send to server       */
+    int write_buffer_size;                   /* size of write buffer         */
+    int write_buffer_length;                 /* length of data in buffer     */
+    int write_again_size;                    /* size of last send to repeat  */
+                                             /* (TLS record not sent)        */
+    int write_buffer_overflow;               /* 1 if max size of write buffer*/
+                                             /* reached (data lost)          */
+    int write_hold;                          /* > 0: data is sent later (in  */
+                                             /* one write)                   */
+    char *who_pending;                       /* channels to check with WHO   */
+                                             /* (sent in a single WHO)       */
+    struct t_hook *hook_timer_who;           /* timer to send pending WHO    */
     struct t_irc_redirect *redirects;        /* command redirections         */
     struct t_irc_redirect *last_redirect;    /* last command redirection     */
     struct t_irc_notify *notify_list;        /* list of notify               */
@@ -235,6 +276,7 @@ extern const int gnutls_cert_type_prio[];
 extern const int gnutls_prot_prio[];
 #endif
 extern struct t_irc_message *irc_recv_msgq, *irc_msgq_last_msg;
+extern struct t_memory_tag *irc_server_memory_tag_outqueue;
 extern char *irc_server_option_string[];
 extern char *irc_server_option_default[];
 
@@ -257,6 +299,9 @@ extern void irc_server_set_nick (struct t_irc_server *server, const char *nick);
 extern const char *irc_server_get_alternate_nick (struct t_irc_server *server);
 extern const char *irc_server_get_isupport_value (struct t_irc_server *server,
                                                   const char *feature);
+extern int irc_server_get_max_targets (struct t_irc_server *server,
+                                       const char *command, int default_max);
+extern int irc_server_get_max_modes (struct t_irc_server *server);
 extern void irc_server_set_prefix_modes_chars (struct t_irc_server *server,
                                                const char *prefix);
 extern const char *irc_server_get_prefix_modes (struct t_irc_server *server);
@@ -294,6 +339,10 @@ extern void irc_server_msgq_add_buffer (struct t_irc_server *server,
 extern void irc_server_msgq_flush ();
 extern void irc_server_set_buffer_title (struct t_irc_server *server);
 extern struct t_gui_buffer *irc_server_create_buffer (struct t_irc_server *server);
+#ifdef HAVE_GNUTLS
+extern void irc_server_gnutls_free_session (struct t_irc_server *server);
+extern void irc_server_gnutls_save_session (struct t_irc_server *server);
+#endif
 extern int irc_server_connect (struct t_irc_server *server);
 extern void irc_server_auto_connect (int auto_connect);
 extern void irc_server_autojoin_channels ();
@@ -308,6 +357,8 @@ extern void irc_server_set_away (struct t_irc_server *server, const char *nick,
                                  int is_away);
 extern void irc_server_remove_away (struct t_irc_server *server);
 extern void irc_server_check_away (struct t_irc_server *server);
+extern void irc_server_check_away_channel (struct t_irc_server *server,
+                                           struct t_irc_channel *channel);
 extern void irc_server_switch_address (struct t_irc_server *server,
                                        int connection);
 extern void irc_server_disconnect (struct t_irc_server *server,
@@ -0,0 +1,161 @@
+/*
+ * irc-tls.c - keys for TLS sessions and verified certificates
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_GNUTLS
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <gnutls/gnutls.h>
+
+#include "irc-tls.h"
+
+
+/*
+ * Builds key for a TLS session: a session is resumed only if address, port
+ * and SSL options are the same as when it was saved.
+ *
+ * Returns NULL if address is NULL.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_tls_session_key (const char *address, int port,
+                     const char *priorities, int dhkey_size,
+                     const char *cert, const char *fingerprint,
+                     int verify, const char *ca_file)
+{
+    char *key;
+    int length;
+
+    if (!address)
+        return NULL;
+
+    length = strlen (address) + 1 + 16 + 1
+        + ((priorities) ? strlen (priorities) : 0) + 1 + 16 + 1
+        + ((cert) ? strlen (cert) : 0) + 1
+        + ((fingerprint) ? strlen (fingerprint) : 0) + 1 + 16 + 1
+        + ((ca_file) ? strlen (ca_file) : 0) + 1;
+    key = malloc (length);
+    if (!key)
+        return NULL;
+
+    snprintf (key, length, "%s/%d/%s/%d/%s/%s/%d/%s",
+              address,
+              port,
+              (priorities) ? priorities : "",
+              dhkey_size,
+              (cert) ? cert : "",
+              (fingerprint) ? fingerprint : "",
+              (verify) ? 1 : 0,
+              (ca_file) ? ca_file : "");
+
+    return key;
+}
+
+/*
+ * Builds an identifier for certificates received from a server: address,
+ * SSL options used to verify the certificates and SHA256 fingerprints of
+ * certificates.
+ *
+ * Returns NULL if address is NULL, if there is no certificate or if a
+ * fingerprint can not be computed.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_tls_certs_id (const char *address, const char *fingerprint,
+                  int verify, const char *ca_file,
+                  const gnutls_datum_t *cert_list, unsigned int cert_list_len)
+{
+    unsigned char digest[64];
+    char *certs_id, *ptr_id;
+    size_t digest_size, j;
+    unsigned int i;
+    int length;
+
+    if (!address || !cert_list || (cert_list_len == 0))
+        return NULL;
+
+    length = strlen (address) + 1
+        + ((fingerprint) ? strlen (fingerprint) : 0) + 1
+        + 1 + 1
+        + ((ca_file) ? strlen (ca_file) : 0) + 1
+        + (cert_list_len * ((sizeof (digest) * 2) + 1)) + 1;
+    certs_id = malloc (length);
+    if (!certs_id)
+        return NULL;
+
+    snprintf (certs_id, length, "%s/%s/%d/%s/",
+              address,
+              (fingerprint) ? fingerprint : "",
+              (verify) ? 1 : 0,
+              (ca_file) ? ca_file : "");
+    ptr_id = certs_id + strlen (certs_id);
+
+    for (i = 0; i < cert_list_len; i++)
+    {
+        digest_size = sizeof (digest);
+        if (gnutls_fingerprint (GNUTLS_DIG_SHA256, &cert_list[i],
+                                digest, &digest_size) != GNUTLS_E_SUCCESS)
+        {
+            free (certs_id);
+            return NULL;
+        }
+        if (i > 0)
+            *(ptr_id++) = ',';
+        for (j = 0; j < digest_size; j++)
+        {
+            snprintf (ptr_id, 3, "%02x", digest[j]);
+            ptr_id += 2;
+        }
+    }
+    ptr_id[0] = '\0';
+
+    return certs_id;
+}
+
+/*
+ * Returns time until verified certificates are trusted: the first
+ * expiration date of certificates, but not more than
+ * IRC_TLS_VERIFIED_MAX_TIME seconds after now (so that a revoked
+ * certificate or a change in trusted CAs is detected soon).
+ *
+ * Returns 0 if certificates are already expired (they must not be trusted
+ * without a new verification).
+ */
+
+time_t
+irc_tls_verified_until (time_t certs_until, time_t now)
+{
+    if (certs_until <= now)
+        return 0;
+
+    if (certs_until - now > IRC_TLS_VERIFIED_MAX_TIME)
+        return now + IRC_TLS_VERIFIED_MAX_TIME;
+
+    return certs_until;
+}
+
+#endif /* HAVE_GNUTLS */
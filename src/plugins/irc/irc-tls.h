@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_IRC_TLS_H
+#define WEECHAT_IRC_TLS_H 1
+
+#ifdef HAVE_GNUTLS
+
+#include <time.h>
+#include <gnutls/gnutls.h>
+
+/* max time (in seconds) during which verified certificates are trusted */
+#define IRC_TLS_VERIFIED_MAX_TIME (10 * 60)
+
+extern char *irc_tls_session_key (const char *address, int port,
+                                  const char *priorities, int dhkey_size,
+                                  const char *cert, const char *fingerprint,
+                                  int verify, const char *ca_file);
+extern char *irc_tls_certs_id (const char *address, const char *fingerprint,
+                               int verify, const char *ca_file,
+                               const gnutls_datum_t *cert_list,
+                               unsigned int cert_list_len);
+extern time_t irc_tls_verified_until (time_t certs_until, time_t now);
+
+#endif /* HAVE_GNUTLS */
+
+#endif /* WEECHAT_IRC_TLS_H */
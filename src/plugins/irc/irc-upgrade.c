@@ -352,6 +352,26 @@ irc_upgrade_read_cb (void *data,
                     irc_upgrade_current_server->is_connected = weechat_infolist_integer (infolist, "is_connected");
                     irc_upgrade_current_server->ssl_connected = weechat_infolist_integer (infolist, "ssl_connected");
                     irc_upgrade_current_server->disconnected = weechat_infolist_integer (infolist, "disconnected");
+#ifdef HAVE_GNUTLS
+                    str = weechat_infolist_string (infolist, "tls_session_key");
+                    buf = weechat_infolist_buffer (infolist, "tls_session_data", &size);
+                    if (str && buf && (size > 0))
+                    {
+                        irc_upgrade_current_server->tls_session_data = malloc (size);
+                        if (irc_upgrade_current_server->tls_session_data)
+                        {
+                            memcpy (irc_upgrade_current_server->tls_session_data,
+                                    buf, size);
+                            irc_upgrade_current_server->tls_session_data_size = size;
+                            irc_upgrade_current_server->tls_session_key = strdup (str);
+                        }
+                    }
+                    /*
+                     * verified certificates are not restored: they are
+                     * verified again on next connection (CA file may have
+                     * changed)
+                     */
+#endif
                     str = weechat_infolist_string (infolist, "unterminated_message");
                     if (str)
                         irc_upgrade_current_server->unterminated_message = strdup (str);
@@ -439,6 +459,9 @@ irc_upgrade_read_cb (void *data,
                     irc_upgrade_current_server->lag_next_check = weechat_infolist_time (infolist, "lag_next_check");
                     irc_upgrade_current_server->lag_last_refresh = weechat_infolist_time (infolist, "lag_last_refresh");
                     irc_upgrade_current_server->last_user_message = weechat_infolist_time (infolist, "last_user_message");
+                    buf = weechat_infolist_buffer (infolist, "anti_flood_time", &size);
+                    if (buf)
+                        memcpy (&(irc_upgrade_current_server->anti_flood_time), buf, size);
                     irc_upgrade_current_server->last_away_check = weechat_infolist_time (infolist, "last_away_check");
                     irc_upgrade_current_server->last_data_purge = weechat_infolist_time (infolist, "last_data_purge");
                 }
@@ -160,6 +160,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_plugin = plugin;
 
+    irc_server_memory_tag_outqueue = weechat_memory_tag ("outqueue");
+
     if (!irc_config_init ())
         return WEECHAT_RC_ERROR;
 
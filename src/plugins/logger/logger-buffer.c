@@ -26,15 +26,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "../weechat-plugin.h"
 #include "logger.h"
 #include "logger-buffer.h"
+#include "logger-index.h"
+#include "logger-writer.h"
 
 
 struct t_logger_buffer *logger_buffers = NULL;
 struct t_logger_buffer *last_logger_buffer = NULL;
 
+/* logger buffers by buffer pointer (fast lookup on each line printed) */
+struct t_hashtable *logger_buffers_by_buffer = NULL;
+
 
 /*
  * Checks if a logger buffer pointer is valid.
@@ -77,6 +83,18 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
     if (!buffer)
         return NULL;
 
+    if (!logger_buffers_by_buffer)
+    {
+        logger_buffers_by_buffer = weechat_hashtable_new (
+            32,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL,
+            NULL);
+        if (!logger_buffers_by_buffer)
+            return NULL;
+    }
+
     if (weechat_logger_plugin->debug)
     {
         weechat_printf_tags (NULL,
@@ -91,7 +109,13 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
     {
         new_logger_buffer->buffer = buffer;
         new_logger_buffer->log_filename = NULL;
-        new_logger_buffer->log_file = NULL;
+        new_logger_buffer->log_fd = -1;
+        new_logger_buffer->log_size = 0;
+        new_logger_buffer->write_buffer = NULL;
+        new_logger_buffer->write_buffer_size = 0;
+        new_logger_buffer->write_buffer_alloc = 0;
+        new_logger_buffer->lines_dropped = 0;
+        new_logger_buffer->index = NULL;
         new_logger_buffer->log_enabled = 1;
         new_logger_buffer->log_level = log_level;
         new_logger_buffer->write_start_info_line = 1;
@@ -104,6 +128,9 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
         else
             logger_buffers = new_logger_buffer;
         last_logger_buffer = new_logger_buffer;
+
+        weechat_hashtable_set (logger_buffers_by_buffer,
+                               buffer, new_logger_buffer);
     }
 
     return new_logger_buffer;
@@ -118,17 +145,10 @@ logger_buffer_add (struct t_gui_buffer *buffer, int log_level)
 struct t_logger_buffer *
 logger_buffer_search_buffer (struct t_gui_buffer *buffer)
 {
-    struct t_logger_buffer *ptr_logger_buffer;
-
-    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
-         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
-    {
-        if (ptr_logger_buffer->buffer == buffer)
-            return ptr_logger_buffer;
-    }
+    if (!logger_buffers_by_buffer)
+        return NULL;
 
-    /* logger buffer not found */
-    return NULL;
+    return weechat_hashtable_get (logger_buffers_by_buffer, buffer);
 }
 
 /*
@@ -159,6 +179,133 @@ logger_buffer_search_log_filename (const char *log_filename)
     return NULL;
 }
 
+/*
+ * Appends data to write buffer of a logger buffer (space for data must have
+ * been reserved with function logger_writer_reserve).
+ *
+ * A new line is added after data, and the line is added in index of log
+ * file (if index is loaded).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_buffer_append (struct t_logger_buffer *logger_buffer,
+                      const char *data, int size, time_t date)
+{
+    char *new_write_buffer;
+    int new_alloc;
+
+    if (logger_buffer->write_buffer_size + size + 1 >
+        logger_buffer->write_buffer_alloc)
+    {
+        new_alloc = (logger_buffer->write_buffer_alloc > 0) ?
+            logger_buffer->write_buffer_alloc : 1024;
+        while (logger_buffer->write_buffer_size + size + 1 > new_alloc)
+        {
+            new_alloc *= 2;
+        }
+        new_write_buffer = realloc (logger_buffer->write_buffer, new_alloc);
+        if (!new_write_buffer)
+            return 0;
+        logger_buffer->write_buffer = new_write_buffer;
+        logger_buffer->write_buffer_alloc = new_alloc;
+    }
+
+    memcpy (logger_buffer->write_buffer + logger_buffer->write_buffer_size,
+            data, size);
+    logger_buffer->write_buffer_size += size;
+    logger_buffer->write_buffer[logger_buffer->write_buffer_size] = '\n';
+    logger_buffer->write_buffer_size++;
+    logger_buffer->log_size += size + 1;
+    logger_buffer->flush_needed = 1;
+
+    logger_index_add_line (logger_buffer->index, date, size + 1);
+
+    return 1;
+}
+
+/*
+ * Sends data of write buffer to writer (data is written in log file by
+ * writer thread).
+ *
+ * Argument "flags" is a combination of LOGGER_WRITER_SYNC and
+ * LOGGER_WRITER_CLOSE (0 = just write data).
+ */
+
+void
+logger_buffer_flush (struct t_logger_buffer *logger_buffer, int flags)
+{
+    int error;
+
+    if (logger_buffer->log_fd < 0)
+        return;
+
+    if ((logger_buffer->write_buffer_size == 0) && (flags == 0))
+        return;
+
+    if (weechat_logger_plugin->debug >= 2)
+    {
+        weechat_printf_tags (NULL,
+                             "no_log",
+                             "%s: flush file %s (%d bytes)",
+                             LOGGER_PLUGIN_NAME,
+                             logger_buffer->log_filename,
+                             logger_buffer->write_buffer_size);
+    }
+
+    /* the write buffer is given to writer, which frees it after write */
+    if (logger_buffer->write_buffer_size == 0)
+    {
+        free (logger_buffer->write_buffer);
+        logger_buffer->write_buffer = NULL;
+    }
+    error = logger_writer_queue (logger_buffer->log_fd,
+                                 logger_writer_file_id (logger_buffer->log_filename),
+                                 logger_buffer->write_buffer,
+                                 logger_buffer->write_buffer_size,
+                                 flags);
+    logger_buffer->write_buffer = NULL;
+    logger_buffer->write_buffer_size = 0;
+    logger_buffer->write_buffer_alloc = 0;
+    logger_buffer->flush_needed = 0;
+
+    logger_index_set_flushed (logger_buffer->index);
+
+    if (error != 0)
+    {
+        weechat_printf_tags (NULL,
+                             "no_log",
+                             _("%s%s: unable to write log file: %s"),
+                             weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+                             strerror (error));
+    }
+}
+
+/*
+ * Closes log file of a logger buffer (pending data is written before file
+ * is closed).
+ */
+
+void
+logger_buffer_close (struct t_logger_buffer *logger_buffer)
+{
+    if (logger_buffer->log_fd < 0)
+        return;
+
+    logger_buffer_flush (logger_buffer, LOGGER_WRITER_CLOSE);
+    logger_buffer->log_fd = -1;
+
+    if (logger_buffer->index)
+    {
+        logger_index_save (logger_buffer->index);
+        logger_index_free (logger_buffer->index);
+        logger_buffer->index = NULL;
+    }
+}
+
 /*
  * Removes a logger buffer from list.
  */
@@ -171,6 +318,9 @@ logger_buffer_free (struct t_logger_buffer *logger_buffer)
 
     ptr_buffer = logger_buffer->buffer;
 
+    if (logger_buffers_by_buffer)
+        weechat_hashtable_remove (logger_buffers_by_buffer, ptr_buffer);
+
     /* remove logger buffer */
     if (last_logger_buffer == logger_buffer)
         last_logger_buffer = logger_buffer->prev_buffer;
@@ -186,15 +336,25 @@ logger_buffer_free (struct t_logger_buffer *logger_buffer)
         (logger_buffer->next_buffer)->prev_buffer = logger_buffer->prev_buffer;
 
     /* free data */
+    logger_buffer_close (logger_buffer);
     if (logger_buffer->log_filename)
         free (logger_buffer->log_filename);
-    if (logger_buffer->log_file)
-        fclose (logger_buffer->log_file);
+    if (logger_buffer->write_buffer)
+    {
+        logger_writer_release (logger_buffer->write_buffer_size);
+        free (logger_buffer->write_buffer);
+    }
 
     free (logger_buffer);
 
     logger_buffers = new_logger_buffers;
 
+    if (!logger_buffers && logger_buffers_by_buffer)
+    {
+        weechat_hashtable_free (logger_buffers_by_buffer);
+        logger_buffers_by_buffer = NULL;
+    }
+
     if (weechat_logger_plugin->debug)
     {
         weechat_printf_tags (NULL,
@@ -230,7 +390,11 @@ logger_buffer_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "log_filename", logger_buffer->log_filename))
         return 0;
-    if (!weechat_infolist_new_var_pointer (ptr_item, "log_file", logger_buffer->log_file))
+    if (!weechat_infolist_new_var_integer (ptr_item, "log_fd", logger_buffer->log_fd))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "write_buffer_size", logger_buffer->write_buffer_size))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "lines_dropped", logger_buffer->lines_dropped))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "log_enabled", logger_buffer->log_enabled))
         return 0;
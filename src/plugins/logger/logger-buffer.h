@@ -21,12 +21,21 @@
 #define WEECHAT_LOGGER_BUFFER_H 1
 
 struct t_infolist;
+struct t_hashtable;
+struct t_logger_index;
 
 struct t_logger_buffer
 {
     struct t_gui_buffer *buffer;          /* pointer to buffer              */
     char *log_filename;                   /* log filename                   */
-    FILE *log_file;                       /* log file                       */
+    int log_fd;                           /* log file (-1 if not opened)    */
+    long long log_size;                   /* size of log file               */
+    char *write_buffer;                   /* lines not yet sent to writer   */
+    int write_buffer_size;                /* size of data in write_buffer   */
+    int write_buffer_alloc;               /* allocated size of write_buffer */
+    int lines_dropped;                    /* lines dropped (buffer full)    */
+    struct t_logger_index *index;         /* index of log file (NULL if     */
+                                          /* not yet loaded)                */
     int log_enabled;                      /* log enabled ?                  */
     int log_level;                        /* log level (0..9)               */
     int write_start_info_line;            /* 1 if start info line must be   */
@@ -38,12 +47,18 @@ struct t_logger_buffer
 
 extern struct t_logger_buffer *logger_buffers;
 extern struct t_logger_buffer *last_logger_buffer;
+extern struct t_hashtable *logger_buffers_by_buffer;
 
 extern int logger_buffer_valid (struct t_logger_buffer *logger_buffer);
 extern struct t_logger_buffer *logger_buffer_add (struct t_gui_buffer *,
                                                   int log_level);
 extern struct t_logger_buffer *logger_buffer_search_buffer (struct t_gui_buffer *buffer);
 extern struct t_logger_buffer *logger_buffer_search_log_filename (const char *log_filename);
+extern int logger_buffer_append (struct t_logger_buffer *logger_buffer,
+                                 const char *data, int size, time_t date);
+extern void logger_buffer_flush (struct t_logger_buffer *logger_buffer,
+                                 int flags);
+extern void logger_buffer_close (struct t_logger_buffer *logger_buffer);
 extern void logger_buffer_free (struct t_logger_buffer *logger_buffer);
 extern int logger_buffer_add_to_infolist (struct t_infolist *infolist,
                                           struct t_logger_buffer *logger_buffer);
@@ -46,6 +46,7 @@ struct t_config_option *logger_config_color_backlog_line;
 
 struct t_config_option *logger_config_file_auto_log;
 struct t_config_option *logger_config_file_flush_delay;
+struct t_config_option *logger_config_file_fsync;
 struct t_config_option *logger_config_file_info_lines;
 struct t_config_option *logger_config_file_mask;
 struct t_config_option *logger_config_file_name_lower_case;
@@ -53,7 +54,12 @@ struct t_config_option *logger_config_file_nick_prefix;
 struct t_config_option *logger_config_file_nick_suffix;
 struct t_config_option *logger_config_file_path;
 struct t_config_option *logger_config_file_replacement_char;
+struct t_config_option *logger_config_file_rotation_compression_level;
+struct t_config_option *logger_config_file_rotation_compression_type;
+struct t_config_option *logger_config_file_rotation_size_max;
 struct t_config_option *logger_config_file_time_format;
+struct t_config_option *logger_config_file_write_buffer_max;
+struct t_config_option *logger_config_file_write_overflow;
 
 
 /*
@@ -430,9 +436,17 @@ logger_config_init ()
         logger_config_file, ptr_section,
         "flush_delay", "integer",
         N_("number of seconds between flush of log files (0 = write in log "
-           "files immediately for each line printed)"),
+           "files immediately for each line printed); files are written by "
+           "a background thread"),
         NULL, 0, 3600, "120", NULL, 0, NULL, NULL,
         &logger_config_flush_delay_change, NULL, NULL, NULL);
+    logger_config_file_fsync = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "fsync", "boolean",
+        N_("synchronize log files with storage device after each flush (see "
+           "option logger.file.flush_delay); this is safer in case of system "
+           "crash, but slower"),
+        NULL, 0, 0, "off", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     logger_config_file_info_lines = weechat_config_new_option (
         logger_config_file, ptr_section,
         "info_lines", "boolean",
@@ -480,12 +494,52 @@ logger_config_init ()
            "(like directory delimiter)"),
         NULL, 0, 0, "_", NULL, 0, NULL, NULL,
         &logger_config_change_file_option_restart_log, NULL, NULL, NULL);
+    logger_config_file_rotation_compression_level = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "rotation_compression_level", "integer",
+        N_("compression level for rotated log files (see option "
+           "logger.file.rotation_compression_type): 1 = fast compression, "
+           "9 = best compression"),
+        NULL, 1, 9, "6", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    logger_config_file_rotation_compression_type = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "rotation_compression_type", "integer",
+        N_("compression of log files closed after a rotation (see option "
+           "logger.file.rotation_size_max) or after a change of filename "
+           "(for example with a date in mask): none = no compression, "
+           "gzip = gzip compression (extension \".gz\" is added to "
+           "filename); lines of compressed files are still displayed in "
+           "backlog"),
+        "none|gzip", 0, 0, "none", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    logger_config_file_rotation_size_max = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "rotation_size_max", "integer",
+        N_("when this size is reached (in kilobytes), the log file is "
+           "rotated: existing rotated files are renamed (.1 becomes .2, .2 "
+           "becomes .3, etc.) and the current file is renamed with "
+           "extension .1 (0 = no rotation)"),
+        NULL, 0, INT_MAX, "0", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     logger_config_file_time_format = weechat_config_new_option (
         logger_config_file, ptr_section,
         "time_format", "string",
         N_("timestamp used in log files (see man strftime for date/time "
            "specifiers)"),
         NULL, 0, 0, "%Y-%m-%d %H:%M:%S", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    logger_config_file_write_buffer_max = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "write_buffer_max", "integer",
+        N_("max size of data waiting to be written in log files (in "
+           "kilobytes); when this size is reached, new lines are handled "
+           "according to option logger.file.write_overflow"),
+        NULL, 64, 1024 * 1024, "4096", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    logger_config_file_write_overflow = weechat_config_new_option (
+        logger_config_file, ptr_section,
+        "write_overflow", "integer",
+        N_("action when max size of data waiting to be written is reached "
+           "(see option logger.file.write_buffer_max): block = wait until "
+           "data is written (no line is lost), drop = drop new lines (a "
+           "line with number of lines dropped is written in log file)"),
+        "block|drop", 0, 0, "block", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* level */
     ptr_section = weechat_config_new_section (logger_config_file, "level",
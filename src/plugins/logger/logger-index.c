@@ -0,0 +1,768 @@
+/*
+ * logger-index.c - index of log files (fast backlog and search by date)
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Each log file has an index in a file with same name and extension ".idx".
+ * The index has a header (size and number of lines indexed) and entries
+ * with offset, line number and date of a line: an entry is added every
+ * LOGGER_INDEX_LINES lines and on first line of each day.
+ *
+ * The index is updated when lines are added in log file (only data sent to
+ * log file is saved in index file), and it is
+ * built (or completed) by reading the log file if it is missing or not up
+ * to date (for example if log file was written by an old WeeChat version).
+ *
+ * This file does not use WeeChat API (it is used in tests).
+ */
+
+/* this define is needed for strptime() (not on OpenBSD/Sun) */
+#if !defined(__OpenBSD__) && !defined(__sun)
+#define _XOPEN_SOURCE 700
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "logger-index.h"
+#include "logger-tail.h"
+
+
+#define LOGGER_INDEX_READ_SIZE 65536
+
+
+/*
+ * Builds index filename for a log file.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_index_get_filename (const char *log_filename)
+{
+    char *filename;
+    int length;
+
+    if (!log_filename)
+        return NULL;
+
+    length = strlen (log_filename) + strlen (LOGGER_INDEX_EXTENSION) + 1;
+    filename = malloc (length);
+    if (filename)
+    {
+        snprintf (filename, length, "%s%s",
+                  log_filename, LOGGER_INDEX_EXTENSION);
+    }
+
+    return filename;
+}
+
+/*
+ * Parses date at beginning of a line (before first tab).
+ *
+ * Returns date found, 0 if not found.
+ */
+
+time_t
+logger_index_parse_date (const char *line, int length,
+                         const char *time_format)
+{
+    char str_date[256], *error;
+    const char *pos_tab;
+    struct tm tm_line;
+    time_t time_now;
+
+    pos_tab = memchr (line, '\t', length);
+    if (!pos_tab || (pos_tab - line >= (int)sizeof (str_date)))
+        return 0;
+
+    memcpy (str_date, line, pos_tab - line);
+    str_date[pos_tab - line] = '\0';
+
+    /*
+     * initialize structure with current time (for daylight saving time),
+     * because strptime does not do it
+     */
+    memset (&tm_line, 0, sizeof (tm_line));
+    time_now = time (NULL);
+    localtime_r (&time_now, &tm_line);
+    error = strptime (str_date, time_format, &tm_line);
+    if (error && !error[0] && (tm_line.tm_year > 0))
+        return mktime (&tm_line);
+
+    return 0;
+}
+
+/*
+ * Creates a new empty index for a log file.
+ *
+ * Returns pointer to new index, NULL if error.
+ */
+
+struct t_logger_index *
+logger_index_new (const char *log_filename)
+{
+    struct t_logger_index *new_index;
+
+    new_index = malloc (sizeof (*new_index));
+    if (!new_index)
+        return NULL;
+
+    new_index->filename = logger_index_get_filename (log_filename);
+    if (!new_index->filename)
+    {
+        free (new_index);
+        return NULL;
+    }
+    new_index->size = 0;
+    new_index->lines = 0;
+    new_index->last_date = 0;
+    new_index->day_start = 0;
+    new_index->day_end = 0;
+    new_index->entries = NULL;
+    new_index->num_entries = 0;
+    new_index->alloc_entries = 0;
+    new_index->num_saved = -1;
+    new_index->saved_size = -1;
+    new_index->flushed_size = 0;
+    new_index->flushed_lines = 0;
+    new_index->flushed_last_date = 0;
+    new_index->flushed_entries = 0;
+
+    return new_index;
+}
+
+/*
+ * Marks all lines indexed as sent to log file (they will be saved in index
+ * file on next save).
+ */
+
+void
+logger_index_set_flushed (struct t_logger_index *index)
+{
+    if (!index)
+        return;
+
+    index->flushed_size = index->size;
+    index->flushed_lines = index->lines;
+    index->flushed_last_date = index->last_date;
+    index->flushed_entries = index->num_entries;
+}
+
+/*
+ * Resets an index (the index file will be rebuilt on next save).
+ */
+
+void
+logger_index_reset (struct t_logger_index *index)
+{
+    index->size = 0;
+    index->lines = 0;
+    index->last_date = 0;
+    index->day_start = 0;
+    index->day_end = 0;
+    index->num_entries = 0;
+    index->num_saved = -1;
+    index->saved_size = -1;
+    logger_index_set_flushed (index);
+}
+
+/*
+ * Adds an entry in index.
+ */
+
+void
+logger_index_add_entry (struct t_logger_index *index, time_t date)
+{
+    struct t_logger_index_entry *new_entries;
+    int new_alloc;
+
+    if (index->num_entries >= index->alloc_entries)
+    {
+        new_alloc = (index->alloc_entries > 0) ?
+            index->alloc_entries * 2 : 64;
+        new_entries = realloc (index->entries,
+                               new_alloc * sizeof (new_entries[0]));
+        if (!new_entries)
+            return;
+        index->entries = new_entries;
+        index->alloc_entries = new_alloc;
+    }
+
+    index->entries[index->num_entries].offset = index->size;
+    index->entries[index->num_entries].line = index->lines;
+    index->entries[index->num_entries].date = date;
+    index->num_entries++;
+}
+
+/*
+ * Sets start of day and start of next day for a date.
+ */
+
+void
+logger_index_set_day (struct t_logger_index *index, time_t date)
+{
+    struct tm tm_day;
+
+    localtime_r (&date, &tm_day);
+    tm_day.tm_hour = 0;
+    tm_day.tm_min = 0;
+    tm_day.tm_sec = 0;
+    tm_day.tm_isdst = -1;
+    index->day_start = mktime (&tm_day);
+    tm_day.tm_mday++;
+    tm_day.tm_isdst = -1;
+    index->day_end = mktime (&tm_day);
+}
+
+/*
+ * Adds a line in index ("size" is the size of line, including final "\n").
+ */
+
+void
+logger_index_add_line (struct t_logger_index *index, time_t date, int size)
+{
+    int new_day;
+
+    if (!index)
+        return;
+
+    new_day = 0;
+    if ((date > 0) && ((date < index->day_start) || (date >= index->day_end)))
+    {
+        logger_index_set_day (index, date);
+        new_day = 1;
+    }
+
+    if (new_day || (index->lines % LOGGER_INDEX_LINES == 0))
+        logger_index_add_entry (index, date);
+
+    index->size += size;
+    index->lines++;
+    if (date > 0)
+        index->last_date = date;
+}
+
+/*
+ * Reads log file from the end of data already indexed, and adds lines in
+ * index.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_index_scan (struct t_logger_index *index, const char *log_filename,
+                   const char *time_format)
+{
+    char *buffer, *ptr_line, *pos_eol, last_date_str[256];
+    int fd, length_data, length_line, length_date, last_date_length;
+    int long_line_size;
+    ssize_t bytes_read;
+    time_t date, last_date, long_line_date;
+    const char *pos_tab;
+
+    fd = open (log_filename, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    buffer = malloc (LOGGER_INDEX_READ_SIZE);
+    if (!buffer)
+    {
+        close (fd);
+        return 0;
+    }
+
+    last_date = 0;
+    last_date_length = -1;
+    length_data = 0;
+    long_line_size = 0;
+    long_line_date = 0;
+    while (1)
+    {
+        bytes_read = pread (fd, buffer + length_data,
+                            LOGGER_INDEX_READ_SIZE - length_data,
+                            index->size + long_line_size + length_data);
+        if (bytes_read <= 0)
+            break;
+        length_data += bytes_read;
+        ptr_line = buffer;
+        while (ptr_line < buffer + length_data)
+        {
+            pos_eol = memchr (ptr_line, '\n',
+                              buffer + length_data - ptr_line);
+            if (!pos_eol)
+            {
+                if ((ptr_line > buffer)
+                    || (length_data < LOGGER_INDEX_READ_SIZE))
+                {
+                    break;
+                }
+                /*
+                 * line too long: the line is read in many parts, it is
+                 * added in index when its end is found
+                 */
+                if (long_line_size == 0)
+                {
+                    long_line_date = logger_index_parse_date (ptr_line,
+                                                              length_data,
+                                                              time_format);
+                }
+                long_line_size += length_data;
+                ptr_line = buffer + length_data;
+                break;
+            }
+            length_line = pos_eol - ptr_line + 1;
+
+            if (long_line_size > 0)
+            {
+                /* end of a long line */
+                logger_index_add_line (index, long_line_date,
+                                       long_line_size + length_line);
+                long_line_size = 0;
+                ptr_line = pos_eol + 1;
+                continue;
+            }
+
+            /* parse date (only if different from date of previous line) */
+            pos_tab = memchr (ptr_line, '\t', length_line);
+            length_date = (pos_tab) ? pos_tab - ptr_line : -1;
+            if ((length_date >= 0)
+                && (length_date < (int)sizeof (last_date_str))
+                && (length_date == last_date_length)
+                && (memcmp (ptr_line, last_date_str, length_date) == 0))
+            {
+                date = last_date;
+            }
+            else
+            {
+                date = logger_index_parse_date (ptr_line, length_line,
+                                                time_format);
+                if ((length_date >= 0)
+                    && (length_date < (int)sizeof (last_date_str)))
+                {
+                    memcpy (last_date_str, ptr_line, length_date);
+                    last_date_length = length_date;
+                    last_date = date;
+                }
+            }
+
+            logger_index_add_line (index, date, length_line);
+            ptr_line = pos_eol + 1;
+        }
+
+        /* keep partial line at the beginning of buffer */
+        length_data = buffer + length_data - ptr_line;
+        if (length_data > 0)
+            memmove (buffer, ptr_line, length_data);
+    }
+
+    /* last line without final "\n" */
+    if (long_line_size + length_data > 0)
+    {
+        logger_index_add_line (index,
+                               (long_line_size > 0) ? long_line_date : 0,
+                               long_line_size + length_data);
+    }
+
+    free (buffer);
+    close (fd);
+
+    return 1;
+}
+
+/*
+ * Loads index of a log file: the index is read from index file, completed
+ * with lines not yet indexed, or rebuilt if it is missing or invalid.
+ *
+ * Returns pointer to index, NULL if error.
+ */
+
+struct t_logger_index *
+logger_index_load (const char *log_filename, const char *time_format)
+{
+    struct t_logger_index *index;
+    struct t_logger_index_header header;
+    struct stat st;
+    char last_char;
+    int fd, fd_log, valid;
+    ssize_t size_entries;
+
+    if (!log_filename || !time_format)
+        return NULL;
+
+    index = logger_index_new (log_filename);
+    if (!index)
+        return NULL;
+
+    if (stat (log_filename, &st) != 0)
+        st.st_size = 0;
+
+    valid = 0;
+    fd = open (index->filename, O_RDONLY);
+    if (fd >= 0)
+    {
+        if ((read (fd, &header, sizeof (header)) == (ssize_t)sizeof (header))
+            && (memcmp (header.magic, LOGGER_INDEX_MAGIC,
+                        sizeof (header.magic)) == 0)
+            && (header.size <= (long long)st.st_size)
+            && (header.num_entries >= 0)
+            && (header.num_entries <= header.lines))
+        {
+            index->entries = malloc ((header.num_entries + 1) *
+                                     sizeof (index->entries[0]));
+            if (index->entries)
+            {
+                index->alloc_entries = header.num_entries + 1;
+                size_entries = header.num_entries * sizeof (index->entries[0]);
+                if (read (fd, index->entries, size_entries) == size_entries)
+                {
+                    index->size = header.size;
+                    index->lines = header.lines;
+                    index->last_date = header.last_date;
+                    if (index->last_date > 0)
+                        logger_index_set_day (index, index->last_date);
+                    index->num_entries = header.num_entries;
+                    index->num_saved = header.num_entries;
+                    index->saved_size = header.size;
+                    valid = 1;
+                }
+            }
+        }
+        close (fd);
+    }
+
+    /*
+     * check that indexed data ends with a new line in log file (except if
+     * the whole file is indexed: the last line may not have a final "\n")
+     */
+    if (valid && (index->size > 0) && (index->size < (long long)st.st_size))
+    {
+        valid = 0;
+        fd_log = open (log_filename, O_RDONLY);
+        if (fd_log >= 0)
+        {
+            if ((pread (fd_log, &last_char, 1, index->size - 1) == 1)
+                && (last_char == '\n'))
+            {
+                valid = 1;
+            }
+            close (fd_log);
+        }
+    }
+
+    if (!valid)
+        logger_index_reset (index);
+
+    /* index lines not yet indexed */
+    if (index->size < (long long)st.st_size)
+        logger_index_scan (index, log_filename, time_format);
+
+    /* all lines indexed are in log file */
+    logger_index_set_flushed (index);
+
+    return index;
+}
+
+/*
+ * Saves index in index file (only new entries and header are written, or
+ * the whole file if it must be rebuilt).
+ *
+ * Only lines sent to log file are saved (see function
+ * logger_index_set_flushed).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_index_save (struct t_logger_index *index)
+{
+    struct t_logger_index_header header;
+    int fd, rc, first_entry;
+    ssize_t size_entries;
+
+    if (!index)
+        return 0;
+
+    /* nothing new since last save? */
+    if ((index->num_saved >= 0)
+        && (index->num_saved == index->flushed_entries)
+        && (index->saved_size == index->flushed_size))
+    {
+        return 1;
+    }
+
+    if (index->num_saved < 0)
+    {
+        fd = open (index->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        first_entry = 0;
+    }
+    else
+    {
+        fd = open (index->filename, O_WRONLY | O_CREAT, 0644);
+        first_entry = index->num_saved;
+    }
+    if (fd < 0)
+        return 0;
+
+    rc = 1;
+
+    /* write new entries */
+    if (index->flushed_entries > first_entry)
+    {
+        size_entries = (index->flushed_entries - first_entry) *
+            sizeof (index->entries[0]);
+        if (pwrite (fd, index->entries + first_entry, size_entries,
+                    sizeof (header) +
+                    (first_entry * sizeof (index->entries[0]))) != size_entries)
+        {
+            rc = 0;
+        }
+    }
+
+    /* write header */
+    if (rc)
+    {
+        memset (&header, 0, sizeof (header));
+        memcpy (header.magic, LOGGER_INDEX_MAGIC, sizeof (header.magic));
+        header.size = index->flushed_size;
+        header.lines = index->flushed_lines;
+        header.last_date = index->flushed_last_date;
+        header.num_entries = index->flushed_entries;
+        if (pwrite (fd, &header, sizeof (header), 0) != (ssize_t)sizeof (header))
+            rc = 0;
+    }
+
+    close (fd);
+
+    index->num_saved = (rc) ? index->flushed_entries : -1;
+    index->saved_size = (rc) ? index->flushed_size : -1;
+
+    return rc;
+}
+
+/*
+ * Reads lines of a log file between two offsets (with a single read).
+ *
+ * Note: result must be freed with function "logger_tail_free".
+ */
+
+struct t_logger_line *
+logger_index_read_lines (const char *log_filename, long long offset_start,
+                         long long offset_end)
+{
+    struct t_logger_line *lines, *last_line, *new_line;
+    char *buffer, *ptr_line, *pos_eol;
+    long long size;
+    ssize_t bytes_read;
+    int fd, length;
+
+    if (offset_end <= offset_start)
+        return NULL;
+
+    size = offset_end - offset_start;
+    buffer = malloc (size + 1);
+    if (!buffer)
+        return NULL;
+
+    fd = open (log_filename, O_RDONLY);
+    if (fd < 0)
+    {
+        free (buffer);
+        return NULL;
+    }
+    length = 0;
+    while (length < size)
+    {
+        bytes_read = pread (fd, buffer + length, size - length,
+                            offset_start + length);
+        if (bytes_read <= 0)
+            break;
+        length += bytes_read;
+    }
+    close (fd);
+    buffer[length] = '\0';
+
+    lines = NULL;
+    last_line = NULL;
+    ptr_line = buffer;
+    while (ptr_line < buffer + length)
+    {
+        pos_eol = memchr (ptr_line, '\n', buffer + length - ptr_line);
+        if (!pos_eol)
+            pos_eol = buffer + length;
+        pos_eol[0] = '\0';
+        if ((pos_eol > ptr_line) && (pos_eol[-1] == '\r'))
+            pos_eol[-1] = '\0';
+        new_line = malloc (sizeof (*new_line));
+        if (!new_line)
+            break;
+        new_line->data = strdup (ptr_line);
+        if (!new_line->data)
+        {
+            free (new_line);
+            break;
+        }
+        new_line->next_line = NULL;
+        if (last_line)
+            last_line->next_line = new_line;
+        else
+            lines = new_line;
+        last_line = new_line;
+        ptr_line = pos_eol + 1;
+    }
+
+    free (buffer);
+
+    return lines;
+}
+
+/*
+ * Returns last lines of a log file, using index to read only the needed
+ * part of file.
+ *
+ * Note: result must be freed with function "logger_tail_free".
+ */
+
+struct t_logger_line *
+logger_index_tail (struct t_logger_index *index, const char *log_filename,
+                   int n_lines)
+{
+    struct t_logger_line *lines, *ptr_line;
+    long long first_line, line, offset;
+    int first, last, middle;
+
+    if (!index || (n_lines <= 0) || (index->lines == 0))
+        return NULL;
+
+    first_line = index->lines - n_lines;
+    if (first_line < 0)
+        first_line = 0;
+
+    /* search last entry with line <= first_line */
+    offset = 0;
+    line = 0;
+    first = 0;
+    last = index->num_entries - 1;
+    while (first <= last)
+    {
+        middle = (first + last) / 2;
+        if (index->entries[middle].line <= first_line)
+        {
+            offset = index->entries[middle].offset;
+            line = index->entries[middle].line;
+            first = middle + 1;
+        }
+        else
+            last = middle - 1;
+    }
+
+    lines = logger_index_read_lines (log_filename, offset, index->size);
+
+    /* skip lines before first line wanted */
+    while (lines && (line < first_line))
+    {
+        ptr_line = lines->next_line;
+        free (lines->data);
+        free (lines);
+        lines = ptr_line;
+        line++;
+    }
+
+    return lines;
+}
+
+/*
+ * Gets range of offsets in log file for lines between two dates (0 = no
+ * limit), assuming dates of lines are in chronological order.
+ */
+
+void
+logger_index_range (struct t_logger_index *index,
+                    time_t date_start, time_t date_end,
+                    long long *offset_start, long long *offset_end)
+{
+    int i, first_entry;
+
+    *offset_start = 0;
+    *offset_end = (index) ? index->size : 0;
+
+    if (!index || (index->num_entries == 0))
+        return;
+
+    first_entry = 0;
+    if (date_start > 0)
+    {
+        first_entry = index->num_entries - 1;
+        for (i = 0; i < index->num_entries; i++)
+        {
+            if ((index->entries[i].date > 0)
+                && (index->entries[i].date >= date_start))
+            {
+                first_entry = (i > 0) ? i - 1 : 0;
+                break;
+            }
+        }
+        *offset_start = index->entries[first_entry].offset;
+    }
+
+    if (date_end > 0)
+    {
+        for (i = first_entry + 1; i < index->num_entries; i++)
+        {
+            if (index->entries[i].date > date_end)
+            {
+                *offset_end = index->entries[i].offset;
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * Frees an index.
+ */
+
+void
+logger_index_free (struct t_logger_index *index)
+{
+    if (!index)
+        return;
+
+    if (index->filename)
+        free (index->filename);
+    if (index->entries)
+        free (index->entries);
+
+    free (index);
+}
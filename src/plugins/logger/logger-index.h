@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_INDEX_H
+#define WEECHAT_LOGGER_INDEX_H 1
+
+#include <time.h>
+
+#define LOGGER_INDEX_EXTENSION ".idx"
+#define LOGGER_INDEX_MAGIC "WLOGIDX1"
+
+/* an entry is added in index every N lines (and on each new day) */
+#define LOGGER_INDEX_LINES 256
+
+struct t_logger_line;
+
+/* entry in index (saved as-is in index file) */
+
+struct t_logger_index_entry
+{
+    long long offset;                  /* offset of line in log file        */
+    long long line;                    /* line number (first line is 0)     */
+    long long date;                    /* date of line (0 if unknown)       */
+};
+
+/* header of index file (saved as-is in index file) */
+
+struct t_logger_index_header
+{
+    char magic[8];                     /* LOGGER_INDEX_MAGIC                */
+    long long size;                    /* size of log file indexed          */
+    long long lines;                   /* number of lines indexed           */
+    long long last_date;               /* date of last line indexed         */
+    long long num_entries;             /* number of entries in file         */
+};
+
+struct t_logger_index
+{
+    char *filename;                    /* index filename                    */
+    long long size;                    /* size of log file indexed          */
+    long long lines;                   /* number of lines indexed           */
+    time_t last_date;                  /* date of last line indexed         */
+    time_t day_start;                  /* start of day of last line         */
+    time_t day_end;                    /* start of next day                 */
+    struct t_logger_index_entry *entries; /* entries (every N lines/days)   */
+    int num_entries;                   /* number of entries                 */
+    int alloc_entries;                 /* allocated entries                 */
+    int num_saved;                     /* entries saved in index file       */
+                                       /* (-1 = index file must be rebuilt) */
+    long long saved_size;              /* size of log file in index file    */
+    long long flushed_size;            /* size of data sent to log file     */
+    long long flushed_lines;           /* lines sent to log file            */
+    time_t flushed_last_date;          /* date of last line sent to file    */
+    int flushed_entries;               /* entries for data sent to file     */
+};
+
+extern char *logger_index_get_filename (const char *log_filename);
+extern time_t logger_index_parse_date (const char *line, int length,
+                                       const char *time_format);
+extern struct t_logger_index *logger_index_new (const char *log_filename);
+extern void logger_index_reset (struct t_logger_index *index);
+extern void logger_index_add_line (struct t_logger_index *index, time_t date,
+                                   int size);
+extern int logger_index_scan (struct t_logger_index *index,
+                              const char *log_filename,
+                              const char *time_format);
+extern struct t_logger_index *logger_index_load (const char *log_filename,
+                                                 const char *time_format);
+extern void logger_index_set_flushed (struct t_logger_index *index);
+extern int logger_index_save (struct t_logger_index *index);
+extern struct t_logger_line *logger_index_read_lines (const char *log_filename,
+                                                      long long offset_start,
+                                                      long long offset_end);
+extern struct t_logger_line *logger_index_tail (struct t_logger_index *index,
+                                                const char *log_filename,
+                                                int n_lines);
+extern void logger_index_range (struct t_logger_index *index,
+                                time_t date_start, time_t date_end,
+                                long long *offset_start,
+                                long long *offset_end);
+extern void logger_index_free (struct t_logger_index *index);
+
+#endif /* WEECHAT_LOGGER_INDEX_H */
@@ -21,12 +21,147 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 #include "../weechat-plugin.h"
 #include "logger.h"
 #include "logger-buffer.h"
+#include "logger-config.h"
+#include "logger-index.h"
+#include "logger-tail.h"
 
 
+/*
+ * Adds a line of log file in an infolist (for infolist "logger_search").
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+logger_info_add_line_to_infolist (struct t_infolist *infolist,
+                                  time_t date, const char *prefix, const char *message)
+{
+    struct t_infolist_item *ptr_item;
+
+    ptr_item = weechat_infolist_new_item (infolist);
+    if (!ptr_item)
+        return 0;
+
+    if (!weechat_infolist_new_var_time (ptr_item, "date", date))
+        return 0;
+    if (!weechat_infolist_new_var_string (ptr_item, "prefix", prefix))
+        return 0;
+    if (!weechat_infolist_new_var_string (ptr_item, "message", message))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Searches lines in log file of a buffer, between two dates and matching a
+ * mask (arguments: "start,end[,mask]", dates are timestamps, 0 = no limit).
+ *
+ * Only the part of log file between the two dates is read (using index of
+ * log file).
+ *
+ * Returns infolist with lines found, NULL if error.
+ */
+
+struct t_infolist *
+logger_info_search (struct t_logger_buffer *logger_buffer,
+                    const char *arguments)
+{
+    struct t_infolist *ptr_infolist;
+    struct t_logger_index *ptr_index;
+    struct t_logger_line *lines, *ptr_line;
+    const char *charset, *time_format, *mask;
+    char **argv, *line, *pos_prefix, *pos_message;
+    int argc, temp_index, rc;
+    long long offset_start, offset_end;
+    time_t date_start, date_end, date;
+
+    argv = weechat_string_split ((arguments) ? arguments : "", ",", 1, 3,
+                                 &argc);
+    date_start = (argc >= 1) ? (time_t)strtol (argv[0], NULL, 10) : 0;
+    date_end = (argc >= 2) ? (time_t)strtol (argv[1], NULL, 10) : 0;
+    mask = (argc >= 3) ? argv[2] : NULL;
+
+    ptr_infolist = NULL;
+    lines = NULL;
+
+    ptr_index = logger_get_index (logger_buffer, &temp_index);
+    if (!ptr_index)
+        goto end;
+
+    ptr_infolist = weechat_infolist_new ();
+    if (!ptr_infolist)
+        goto end;
+
+    logger_index_range (ptr_index, date_start, date_end,
+                        &offset_start, &offset_end);
+    lines = logger_index_read_lines (logger_buffer->log_filename,
+                                     offset_start, offset_end);
+
+    charset = weechat_info_get ("charset_terminal", "");
+    time_format = weechat_config_string (logger_config_file_time_format);
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        date = logger_index_parse_date (ptr_line->data,
+                                        strlen (ptr_line->data),
+                                        time_format);
+        if (((date_start > 0) || (date_end > 0)) && (date == 0))
+            continue;
+        if ((date_start > 0) && (date < date_start))
+            continue;
+        if ((date_end > 0) && (date > date_end))
+            continue;
+        line = (charset) ?
+            weechat_iconv_to_internal (charset, ptr_line->data) :
+            strdup (ptr_line->data);
+        if (!line)
+            continue;
+        pos_prefix = strchr (line, '\t');
+        pos_prefix = (pos_prefix) ? pos_prefix + 1 : line;
+        pos_message = strchr (pos_prefix, '\t');
+        if (pos_message)
+        {
+            pos_message[0] = '\0';
+            pos_message++;
+        }
+        else
+        {
+            pos_message = pos_prefix;
+            pos_prefix = NULL;
+        }
+        rc = 1;
+        if (!mask || weechat_string_match (pos_message, mask, 0))
+        {
+            rc = logger_info_add_line_to_infolist (ptr_infolist, date,
+                                                   pos_prefix, pos_message);
+        }
+        free (line);
+        if (!rc)
+        {
+            weechat_infolist_free (ptr_infolist);
+            ptr_infolist = NULL;
+            break;
+        }
+    }
+
+end:
+    if (lines)
+        logger_tail_free (lines);
+    if (ptr_index && temp_index)
+        logger_index_free (ptr_index);
+    if (argv)
+        weechat_string_free_split (argv);
+
+    return ptr_infolist;
+}
+
 /*
  * Returns infolist with logger info.
  */
@@ -40,7 +175,6 @@ logger_info_get_infolist_cb (void *data, const char *infolist_name,
 
     /* make C compiler happy */
     (void) data;
-    (void) arguments;
 
     if (!infolist_name || !infolist_name[0])
         return NULL;
@@ -80,6 +214,13 @@ logger_info_get_infolist_cb (void *data, const char *infolist_name,
             }
         }
     }
+    else if (weechat_strcasecmp (infolist_name, "logger_search") == 0)
+    {
+        ptr_logger_buffer = logger_buffer_search_buffer (pointer);
+        if (!ptr_logger_buffer)
+            return NULL;
+        return logger_info_search (ptr_logger_buffer, arguments);
+    }
 
     return NULL;
 }
@@ -95,4 +236,12 @@ logger_info_init ()
                            N_("logger pointer (optional)"),
                            NULL,
                            &logger_info_get_infolist_cb, NULL);
+    weechat_hook_infolist ("logger_search",
+                           N_("lines of log file of a buffer between two "
+                              "dates"),
+                           N_("buffer pointer (mandatory)"),
+                           N_("start,end[,mask] (start/end: timestamps, "
+                              "0 = no limit; mask: message to search, "
+                              "wildcard \"*\" is allowed)"),
+                           &logger_info_get_infolist_cb, NULL);
 }
@@ -0,0 +1,481 @@
+/*
+ * logger-rotate.c - rotation and compression of log files
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * When a log file is rotated, it is renamed to "<file>.1" (previous
+ * segments are renamed: "<file>.1" to "<file>.2", etc.), so "<file>.1" is
+ * always the most recent segment. Segments may be compressed with gzip
+ * (extension ".gz" is added). Segments are renamed and compressed by writer
+ * thread.
+ *
+ * Segments are read transparently (compressed or not) when lines are
+ * needed before the first line of a log file (for example for backlog).
+ *
+ * This file does not use WeeChat API (functions are called by writer
+ * thread and used in tests).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <zlib.h>
+
+#include "logger-rotate.h"
+#include "logger-tail.h"
+
+
+#define LOGGER_ROTATE_READ_SIZE 65536
+
+
+/*
+ * Builds filename of a segment of log file: "<file>.<number>" (with
+ * extension ".gz" if "compressed" is 1).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_rotate_segment_filename (const char *log_filename, int number,
+                                int compressed)
+{
+    char *filename;
+    int length;
+
+    if (!log_filename || (number < 1))
+        return NULL;
+
+    length = strlen (log_filename) + 16 +
+        strlen (LOGGER_ROTATE_GZIP_EXTENSION) + 1;
+    filename = malloc (length);
+    if (filename)
+    {
+        snprintf (filename, length, "%s.%d%s",
+                  log_filename, number,
+                  (compressed) ? LOGGER_ROTATE_GZIP_EXTENSION : "");
+    }
+
+    return filename;
+}
+
+/*
+ * Searches a segment of log file (compressed segment is used first, if both
+ * files exist).
+ *
+ * Returns filename of segment found, NULL if not found.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_rotate_search_segment (const char *log_filename, int number)
+{
+    char *filename;
+    int compressed;
+
+    for (compressed = 1; compressed >= 0; compressed--)
+    {
+        filename = logger_rotate_segment_filename (log_filename, number,
+                                                   compressed);
+        if (!filename)
+            return NULL;
+        if (access (filename, F_OK) == 0)
+            return filename;
+        free (filename);
+    }
+
+    /* segment not found */
+    return NULL;
+}
+
+/*
+ * Renames a segment of log file (compressed and not compressed files).
+ */
+
+void
+logger_rotate_rename_segment (const char *log_filename, int number,
+                              int new_number)
+{
+    char *filename, *new_filename;
+    int compressed;
+
+    for (compressed = 0; compressed <= 1; compressed++)
+    {
+        filename = logger_rotate_segment_filename (log_filename, number,
+                                                   compressed);
+        new_filename = logger_rotate_segment_filename (log_filename,
+                                                       new_number,
+                                                       compressed);
+        if (filename && new_filename && (access (filename, F_OK) == 0))
+            rename (filename, new_filename);
+        if (filename)
+            free (filename);
+        if (new_filename)
+            free (new_filename);
+    }
+}
+
+/*
+ * Builds filename of a log file waiting for rotation:
+ * "<file>.rotating.<number>".
+ *
+ * The log file is renamed with this name when it is closed for rotation
+ * (so that a new log file can be opened immediately), then the writer
+ * thread renames it to "<file>.1" (see function logger_rotate_file).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_rotate_pending_filename (const char *log_filename, int number)
+{
+    char *filename;
+    int length;
+
+    if (!log_filename)
+        return NULL;
+
+    length = strlen (log_filename) + 32;
+    filename = malloc (length);
+    if (filename)
+        snprintf (filename, length, "%s.rotating.%d", log_filename, number);
+
+    return filename;
+}
+
+/*
+ * Rotates a log file: segments are renamed ("<file>.1" to "<file>.2", ...)
+ * and file "filename" is renamed to "<file>.1" (if "filename" is NULL, the
+ * log file itself is renamed).
+ *
+ * The file must not be written during rotation (data already sent to an
+ * opened file descriptor is still written in the renamed file).
+ *
+ * Returns filename of new segment ("<file>.1"), NULL if error.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+logger_rotate_file (const char *log_filename, const char *filename)
+{
+    char *new_filename;
+    int last_number;
+
+    if (!log_filename)
+        return NULL;
+    if (!filename)
+        filename = log_filename;
+    if (access (filename, F_OK) != 0)
+        return NULL;
+
+    /* search last segment */
+    last_number = 0;
+    while (1)
+    {
+        new_filename = logger_rotate_search_segment (log_filename,
+                                                     last_number + 1);
+        if (!new_filename)
+            break;
+        free (new_filename);
+        last_number++;
+    }
+
+    /* rename segments (from the oldest) */
+    while (last_number > 0)
+    {
+        logger_rotate_rename_segment (log_filename, last_number,
+                                      last_number + 1);
+        last_number--;
+    }
+
+    new_filename = logger_rotate_segment_filename (log_filename, 1, 0);
+    if (!new_filename)
+        return NULL;
+    if (rename (filename, new_filename) != 0)
+    {
+        free (new_filename);
+        return NULL;
+    }
+
+    return new_filename;
+}
+
+/*
+ * Compresses a file with gzip: file "<file>.gz" is created, then "<file>"
+ * is removed.
+ *
+ * The compressed data is written in a temporary file, which is renamed when
+ * compression is done (so that a compressed file is never incomplete).
+ *
+ * Returns 0 if OK, errno value if error.
+ */
+
+int
+logger_rotate_compress_file (const char *filename, int level)
+{
+    char *filename_gz, *filename_tmp, *buffer, mode[16];
+    int length, fd, error;
+    ssize_t bytes_read;
+    gzFile file_gz;
+
+    if (!filename)
+        return EINVAL;
+
+    if ((level < 1) || (level > 9))
+        level = Z_DEFAULT_COMPRESSION;
+
+    length = strlen (filename) + strlen (LOGGER_ROTATE_GZIP_EXTENSION) + 5;
+    filename_gz = malloc (length);
+    filename_tmp = malloc (length);
+    buffer = malloc (LOGGER_ROTATE_READ_SIZE);
+    if (!filename_gz || !filename_tmp || !buffer)
+    {
+        error = ENOMEM;
+        goto end;
+    }
+    snprintf (filename_gz, length, "%s%s",
+              filename, LOGGER_ROTATE_GZIP_EXTENSION);
+    snprintf (filename_tmp, length, "%s%s.tmp",
+              filename, LOGGER_ROTATE_GZIP_EXTENSION);
+
+    fd = open (filename, O_RDONLY);
+    if (fd < 0)
+    {
+        error = errno;
+        goto end;
+    }
+
+    if (level == Z_DEFAULT_COMPRESSION)
+        snprintf (mode, sizeof (mode), "wb");
+    else
+        snprintf (mode, sizeof (mode), "wb%d", level);
+    file_gz = gzopen (filename_tmp, mode);
+    if (!file_gz)
+    {
+        error = (errno != 0) ? errno : ENOMEM;
+        close (fd);
+        goto end;
+    }
+
+    error = 0;
+    while (1)
+    {
+        bytes_read = read (fd, buffer, LOGGER_ROTATE_READ_SIZE);
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            error = errno;
+            break;
+        }
+        if (bytes_read == 0)
+            break;
+        if (gzwrite (file_gz, buffer, bytes_read) != bytes_read)
+        {
+            error = EIO;
+            break;
+        }
+    }
+    close (fd);
+    if ((gzclose (file_gz) != Z_OK) && (error == 0))
+        error = EIO;
+
+    if (error == 0)
+    {
+        if (rename (filename_tmp, filename_gz) == 0)
+            unlink (filename);
+        else
+            error = errno;
+    }
+    if (error != 0)
+        unlink (filename_tmp);
+
+end:
+    if (filename_gz)
+        free (filename_gz);
+    if (filename_tmp)
+        free (filename_tmp);
+    if (buffer)
+        free (buffer);
+
+    return error;
+}
+
+/*
+ * Returns last lines of a segment of log file (compressed or not).
+ *
+ * Note: result must be freed with function "logger_tail_free".
+ */
+
+struct t_logger_line *
+logger_rotate_tail_segment (const char *filename, int n_lines)
+{
+    gzFile file_gz;
+    struct t_logger_line *lines, *new_line;
+    char **last_lines, *line, *new_data, buffer[4096];
+    int i, index, count, length, length_line, complete;
+
+    if (!filename || (n_lines <= 0))
+        return NULL;
+
+    file_gz = gzopen (filename, "rb");
+    if (!file_gz)
+        return NULL;
+
+    last_lines = calloc (n_lines, sizeof (*last_lines));
+    if (!last_lines)
+    {
+        gzclose (file_gz);
+        return NULL;
+    }
+
+    /* keep last lines in a circular array */
+    index = 0;
+    count = 0;
+    line = NULL;
+    length_line = 0;
+    while (1)
+    {
+        complete = 0;
+        if (gzgets (file_gz, buffer, sizeof (buffer)))
+        {
+            length = strlen (buffer);
+            if ((length > 0) && (buffer[length - 1] == '\n'))
+            {
+                buffer[--length] = '\0';
+                complete = 1;
+            }
+            new_data = realloc (line, length_line + length + 1);
+            if (!new_data)
+                break;
+            line = new_data;
+            memcpy (line + length_line, buffer, length + 1);
+            length_line += length;
+        }
+        else
+        {
+            /* end of file: last line without final "\n" */
+            if (!line)
+                break;
+            complete = 1;
+        }
+        if (complete && line)
+        {
+            if ((length_line > 0) && (line[length_line - 1] == '\r'))
+                line[length_line - 1] = '\0';
+            if (last_lines[index])
+                free (last_lines[index]);
+            last_lines[index] = line;
+            index = (index + 1) % n_lines;
+            count++;
+            line = NULL;
+            length_line = 0;
+        }
+    }
+    if (line)
+        free (line);
+    gzclose (file_gz);
+
+    /* build list with lines, from the oldest */
+    lines = NULL;
+    if (count > n_lines)
+        count = n_lines;
+    for (i = 0; i < count; i++)
+    {
+        index = (index + n_lines - 1) % n_lines;
+        new_line = malloc (sizeof (*new_line));
+        if (!new_line)
+            break;
+        new_line->data = last_lines[index];
+        last_lines[index] = NULL;
+        new_line->next_line = lines;
+        lines = new_line;
+    }
+    for (i = 0; i < n_lines; i++)
+    {
+        if (last_lines[i])
+            free (last_lines[i]);
+    }
+    free (last_lines);
+
+    return lines;
+}
+
+/*
+ * Adds lines of previous segments of a log file before lines read in log
+ * file, so that the list has "n_lines" lines (if enough lines are found in
+ * segments).
+ *
+ * Returns the new list of lines.
+ *
+ * Note: result must be freed with function "logger_tail_free".
+ */
+
+struct t_logger_line *
+logger_rotate_add_previous_lines (const char *log_filename,
+                                  struct t_logger_line *lines, int n_lines)
+{
+    struct t_logger_line *ptr_line, *segment_lines, *last_segment_line;
+    char *filename;
+    int count, number;
+
+    count = 0;
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        count++;
+    }
+
+    number = 1;
+    while (count < n_lines)
+    {
+        filename = logger_rotate_search_segment (log_filename, number);
+        if (!filename)
+            break;
+        segment_lines = logger_rotate_tail_segment (filename,
+                                                    n_lines - count);
+        free (filename);
+        if (segment_lines)
+        {
+            /* add lines of segment before current lines */
+            last_segment_line = segment_lines;
+            count++;
+            while (last_segment_line->next_line)
+            {
+                last_segment_line = last_segment_line->next_line;
+                count++;
+            }
+            last_segment_line->next_line = lines;
+            lines = segment_lines;
+        }
+        number++;
+    }
+
+    return lines;
+}
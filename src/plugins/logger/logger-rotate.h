@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_ROTATE_H
+#define WEECHAT_LOGGER_ROTATE_H 1
+
+#define LOGGER_ROTATE_GZIP_EXTENSION ".gz"
+
+struct t_logger_line;
+
+/* compression of log files after rotation */
+
+enum t_logger_rotate_compression
+{
+    LOGGER_ROTATE_COMPRESSION_NONE = 0, /* no compression                   */
+    LOGGER_ROTATE_COMPRESSION_GZIP,    /* gzip compression (with zlib)      */
+    /* number of compression types */
+    LOGGER_ROTATE_NUM_COMPRESSION,
+};
+
+extern char *logger_rotate_segment_filename (const char *log_filename,
+                                             int number, int compressed);
+extern char *logger_rotate_search_segment (const char *log_filename,
+                                           int number);
+extern char *logger_rotate_pending_filename (const char *log_filename,
+                                             int number);
+extern char *logger_rotate_file (const char *log_filename,
+                                 const char *filename);
+extern int logger_rotate_compress_file (const char *filename, int level);
+extern struct t_logger_line *logger_rotate_tail_segment (const char *filename,
+                                                         int n_lines);
+extern struct t_logger_line *logger_rotate_add_previous_lines (const char *log_filename,
+                                                               struct t_logger_line *lines,
+                                                               int n_lines);
+
+#endif /* WEECHAT_LOGGER_ROTATE_H */
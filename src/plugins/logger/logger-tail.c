@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include "logger.h"
+#include "logger-rotate.h"
 #include "logger-tail.h"
 
 
@@ -56,13 +57,13 @@ logger_tail_last_eol (const char *string_start, const char *string_ptr)
 }
 
 /*
- * Returns last lines of a file.
+ * Returns last lines of a file (without reading segments of rotated file).
  *
  * Note: result must be freed with function "logger_tail_free".
  */
 
 struct t_logger_line *
-logger_tail_file (const char *filename, int n_lines)
+logger_tail_read_file (const char *filename, int n_lines)
 {
     int fd;
     off_t file_length, file_pos;
@@ -212,6 +213,23 @@ logger_tail_file (const char *filename, int n_lines)
     return ptr_line;
 }
 
+/*
+ * Returns last lines of a log file: if the file has not enough lines,
+ * lines are read in previous segments of file (if file was rotated).
+ *
+ * Note: result must be freed with function "logger_tail_free".
+ */
+
+struct t_logger_line *
+logger_tail_file (const char *filename, int n_lines)
+{
+    struct t_logger_line *lines;
+
+    lines = logger_tail_read_file (filename, n_lines);
+
+    return logger_rotate_add_previous_lines (filename, lines, n_lines);
+}
+
 /*
  * Frees structure returned by function "logger_tail_file".
  */
@@ -0,0 +1,766 @@
+/*
+ * logger-writer.c - background writer for log files
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lines are formatted by main thread in a buffer for each log file, then
+ * buffers are sent to a writer thread, which writes data of each file with
+ * writev (and optionally fdatasync), then closes files if asked.
+ *
+ * Log files are rotated and compressed by writer thread too, after pending
+ * data of files is written (see functions logger_writer_queue_rotate and
+ * logger_writer_queue_compress).
+ *
+ * The writer thread does not call any WeeChat function: errors are saved
+ * and returned to main thread by function logger_writer_queue.
+ *
+ * Memory used by data not yet written is bounded: the main thread reserves
+ * space before formatting a line (function logger_writer_reserve), and the
+ * space is released by writer thread once data is written.
+ *
+ * Requests have the id of their log file, so that the main thread can wait
+ * until data of a single file is written (function logger_writer_wait_file),
+ * without waiting for other files (or compression of rotated files).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "logger-rotate.h"
+#include "logger-writer.h"
+
+
+pthread_t logger_writer_thread_id;     /* writer thread                     */
+int logger_writer_running = 0;         /* 1 if writer thread is running     */
+pthread_mutex_t logger_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t logger_writer_cond_queue = PTHREAD_COND_INITIALIZER;
+pthread_cond_t logger_writer_cond_done = PTHREAD_COND_INITIALIZER;
+
+/* data below is protected by mutex */
+struct t_logger_writer_request *logger_writer_requests = NULL;
+struct t_logger_writer_request *last_logger_writer_request = NULL;
+int logger_writer_busy = 0;            /* 1 if writer is writing data       */
+int logger_writer_stop = 0;            /* 1 if writer thread must stop      */
+int logger_writer_size = 0;            /* size of data not yet written      */
+int logger_writer_error = 0;           /* last error (errno) in writer      */
+int *logger_writer_busy_ids = NULL;    /* files of requests being processed */
+int logger_writer_num_busy_ids = 0;    /* number of ids in array above      */
+
+
+/*
+ * Returns id of a log file (hash of filename), used to wait for requests of
+ * this file (see function logger_writer_wait_file).
+ *
+ * The id is never 0; two files may have the same id (then a wait for one of
+ * them waits for both files).
+ */
+
+int
+logger_writer_file_id (const char *filename)
+{
+    unsigned int hash;
+
+    if (!filename)
+        return 0;
+
+    hash = 5381;
+    while (filename[0])
+    {
+        hash = (hash << 5) + hash + (unsigned char)filename[0];
+        filename++;
+    }
+    hash &= 0x7FFFFFFF;
+
+    return (hash == 0) ? 1 : (int)hash;
+}
+
+/*
+ * Marks requests as processed: files of these requests are not busy any
+ * more (threads waiting for a file are woken up).
+ */
+
+void
+logger_writer_done (struct t_logger_writer_request **requests, int count)
+{
+    int i, j;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    for (i = 0; i < count; i++)
+    {
+        if (requests[i]->file_id == 0)
+            continue;
+        for (j = 0; j < logger_writer_num_busy_ids; j++)
+        {
+            if (logger_writer_busy_ids[j] == requests[i]->file_id)
+            {
+                logger_writer_busy_ids[j] =
+                    logger_writer_busy_ids[logger_writer_num_busy_ids - 1];
+                logger_writer_num_busy_ids--;
+                break;
+            }
+        }
+    }
+    pthread_cond_broadcast (&logger_writer_cond_done);
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Writes chunks of data in a file (partial writes are retried).
+ *
+ * Returns 0 if OK, errno value if error.
+ */
+
+int
+logger_writer_writev (int fd, struct iovec *iov, int count)
+{
+    ssize_t num_written;
+
+    while (count > 0)
+    {
+        num_written = writev (fd, iov, count);
+        if (num_written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        while ((count > 0) && (num_written >= (ssize_t)iov->iov_len))
+        {
+            num_written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + num_written;
+            iov->iov_len -= num_written;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Writes data of requests for a file (with a single call to writev), then
+ * frees requests.
+ *
+ * Returns 0 if OK, errno value if error.
+ */
+
+int
+logger_writer_write_requests (int fd,
+                              struct t_logger_writer_request **requests,
+                              int count, int *size_written)
+{
+    struct iovec iov[LOGGER_WRITER_IOV_MAX];
+    int i, num_iov, rc;
+
+    num_iov = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (requests[i]->data && (requests[i]->size > 0))
+        {
+            iov[num_iov].iov_base = requests[i]->data;
+            iov[num_iov].iov_len = requests[i]->size;
+            num_iov++;
+        }
+    }
+
+    rc = (num_iov > 0) ? logger_writer_writev (fd, iov, num_iov) : 0;
+
+    logger_writer_done (requests, count);
+
+    for (i = 0; i < count; i++)
+    {
+        *size_written += requests[i]->size;
+        if (requests[i]->data)
+            free (requests[i]->data);
+        free (requests[i]);
+    }
+
+    return rc;
+}
+
+/*
+ * Processes a rotation or compression request.
+ *
+ * Returns 0 if OK, errno value if error.
+ */
+
+int
+logger_writer_process_file (struct t_logger_writer_request *request)
+{
+    char *segment_filename;
+    int rc;
+
+    if (!(request->flags & LOGGER_WRITER_ROTATE))
+    {
+        return logger_rotate_compress_file (request->data,
+                                            request->compression_level);
+    }
+
+    errno = 0;
+    segment_filename = logger_rotate_file (request->log_filename,
+                                           request->data);
+    rc = (segment_filename || (errno == 0)) ? 0 : errno;
+
+    /* segments are renamed: the log file is not busy during compression */
+    logger_writer_done (&request, 1);
+
+    if (!segment_filename)
+        return (rc != 0) ? rc : ENOENT;
+    rc = (request->compression_level > 0) ?
+        logger_rotate_compress_file (segment_filename,
+                                     request->compression_level) : 0;
+    free (segment_filename);
+
+    return rc;
+}
+
+/*
+ * Processes a list of requests: data of each file is written with writev,
+ * requests for a file are processed in the order they were queued.
+ *
+ * A rotation or compression request is processed alone: files closed by
+ * requests queued before are closed before rotation or compression, and
+ * these requests are processed in the order they were queued.
+ *
+ * Requests are freed, the size of data written (or discarded after an
+ * error) is added to "size_written".
+ *
+ * Returns 0 if OK, errno value of last error.
+ */
+
+int
+logger_writer_process (struct t_logger_writer_request *requests,
+                       int *size_written)
+{
+    struct t_logger_writer_request *ptr_request, *ptr_next_request;
+    struct t_logger_writer_request *ptr_prev_request;
+    struct t_logger_writer_request *file_requests[LOGGER_WRITER_IOV_MAX];
+    int fd, count, flags, rc, error;
+
+    error = 0;
+    *size_written = 0;
+
+    while (requests)
+    {
+        if (requests->flags & (LOGGER_WRITER_COMPRESS | LOGGER_WRITER_ROTATE))
+        {
+            ptr_request = requests;
+            requests = requests->next_request;
+            rc = logger_writer_process_file (ptr_request);
+            if (rc != 0)
+                error = rc;
+            if (!(ptr_request->flags & LOGGER_WRITER_ROTATE))
+                logger_writer_done (&ptr_request, 1);
+            free (ptr_request->data);
+            if (ptr_request->log_filename)
+                free (ptr_request->log_filename);
+            free (ptr_request);
+            continue;
+        }
+
+        /* write data of all requests for the file of first request */
+        fd = requests->fd;
+        count = 0;
+        flags = 0;
+        ptr_prev_request = NULL;
+        ptr_request = requests;
+        while (ptr_request)
+        {
+            ptr_next_request = ptr_request->next_request;
+            if ((ptr_request->fd == fd)
+                && !(ptr_request->flags & (LOGGER_WRITER_COMPRESS
+                                           | LOGGER_WRITER_ROTATE)))
+            {
+                /* remove request from list */
+                if (ptr_prev_request)
+                    ptr_prev_request->next_request = ptr_next_request;
+                else
+                    requests = ptr_next_request;
+                flags |= ptr_request->flags;
+                if (count == LOGGER_WRITER_IOV_MAX)
+                {
+                    rc = logger_writer_write_requests (fd, file_requests,
+                                                       count, size_written);
+                    if (rc != 0)
+                        error = rc;
+                    count = 0;
+                }
+                file_requests[count++] = ptr_request;
+            }
+            else
+                ptr_prev_request = ptr_request;
+            ptr_request = ptr_next_request;
+        }
+        rc = logger_writer_write_requests (fd, file_requests, count,
+                                           size_written);
+        if (rc != 0)
+            error = rc;
+
+        if (flags & LOGGER_WRITER_SYNC)
+        {
+#ifdef __APPLE__
+            rc = fsync (fd);
+#else
+            rc = fdatasync (fd);
+#endif /* __APPLE__ */
+            if (rc != 0)
+                error = errno;
+        }
+        if (flags & LOGGER_WRITER_CLOSE)
+            close (fd);
+    }
+
+    return error;
+}
+
+/*
+ * Main function of writer thread.
+ */
+
+void *
+logger_writer_thread (void *arg)
+{
+    struct t_logger_writer_request *ptr_requests, *ptr_request;
+    int rc, size_written, count, *new_ids;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    while (1)
+    {
+        while (!logger_writer_requests && !logger_writer_stop)
+        {
+            pthread_cond_wait (&logger_writer_cond_queue,
+                               &logger_writer_mutex);
+        }
+        if (!logger_writer_requests)
+            break;
+
+        ptr_requests = logger_writer_requests;
+        logger_writer_requests = NULL;
+        last_logger_writer_request = NULL;
+        logger_writer_busy = 1;
+
+        /* save files of requests (they are busy until processed) */
+        count = 0;
+        for (ptr_request = ptr_requests; ptr_request;
+             ptr_request = ptr_request->next_request)
+        {
+            count++;
+        }
+        new_ids = realloc (logger_writer_busy_ids, count * sizeof (*new_ids));
+        if (new_ids)
+        {
+            logger_writer_busy_ids = new_ids;
+            logger_writer_num_busy_ids = 0;
+            for (ptr_request = ptr_requests; ptr_request;
+                 ptr_request = ptr_request->next_request)
+            {
+                if (ptr_request->file_id != 0)
+                {
+                    logger_writer_busy_ids[logger_writer_num_busy_ids++] =
+                        ptr_request->file_id;
+                }
+            }
+        }
+        else
+        {
+            /* not enough memory: all files are busy until end of batch */
+            logger_writer_num_busy_ids = -1;
+        }
+        pthread_mutex_unlock (&logger_writer_mutex);
+
+        rc = logger_writer_process (ptr_requests, &size_written);
+
+        pthread_mutex_lock (&logger_writer_mutex);
+        logger_writer_busy = 0;
+        logger_writer_num_busy_ids = 0;
+        logger_writer_size -= size_written;
+        if (rc != 0)
+            logger_writer_error = rc;
+        pthread_cond_broadcast (&logger_writer_cond_done);
+    }
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return NULL;
+}
+
+/*
+ * Starts writer thread.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (data will be written by main thread)
+ */
+
+int
+logger_writer_init ()
+{
+    if (logger_writer_running)
+        return 1;
+
+    logger_writer_stop = 0;
+    logger_writer_error = 0;
+    if (pthread_create (&logger_writer_thread_id, NULL,
+                        &logger_writer_thread, NULL) != 0)
+    {
+        return 0;
+    }
+    logger_writer_running = 1;
+
+    return 1;
+}
+
+/*
+ * Reserves space for data that will be sent to writer.
+ *
+ * If "max_size" is reached and "wait" is 1, this function waits until
+ * enough data is written by writer thread (only if data is being written:
+ * data still in logger buffers must be sent to writer before).
+ *
+ * Returns:
+ *   1: space reserved
+ *   0: max size reached
+ */
+
+int
+logger_writer_reserve (int size, int max_size, int wait)
+{
+    int rc;
+
+    rc = 1;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+
+    /* a single chunk bigger than max size is always accepted */
+    while ((logger_writer_size > 0)
+           && (logger_writer_size + size > max_size))
+    {
+        if (!wait || !logger_writer_running
+            || (!logger_writer_requests && !logger_writer_busy))
+        {
+            rc = 0;
+            break;
+        }
+        pthread_cond_wait (&logger_writer_cond_done, &logger_writer_mutex);
+    }
+    if (rc)
+        logger_writer_size += size;
+
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return rc;
+}
+
+/*
+ * Releases space reserved for data that will not be written.
+ */
+
+void
+logger_writer_release (int size)
+{
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_size -= size;
+    pthread_cond_broadcast (&logger_writer_cond_done);
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Adds a request in queue of writer thread (or processes it immediately if
+ * writer thread is not running).
+ *
+ * Returns 0 if OK, errno value if an error occurred in writer since last
+ * call to this function (the error is reset).
+ */
+
+int
+logger_writer_add_request (struct t_logger_writer_request *request)
+{
+    int error, size_written;
+
+    if (!logger_writer_running)
+    {
+        /* no writer thread: process request now */
+        error = logger_writer_process (request, &size_written);
+        logger_writer_release (size_written);
+        pthread_mutex_lock (&logger_writer_mutex);
+        if (error == 0)
+            error = logger_writer_error;
+        logger_writer_error = 0;
+        pthread_mutex_unlock (&logger_writer_mutex);
+        return error;
+    }
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    if (last_logger_writer_request)
+        last_logger_writer_request->next_request = request;
+    else
+        logger_writer_requests = request;
+    last_logger_writer_request = request;
+    error = logger_writer_error;
+    logger_writer_error = 0;
+    pthread_cond_signal (&logger_writer_cond_queue);
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return error;
+}
+
+/*
+ * Sends data to write to writer thread (the space must have been reserved
+ * with function logger_writer_reserve).
+ *
+ * Argument "file_id" is the id of log file (see function
+ * logger_writer_file_id).
+ *
+ * The data is freed by writer after write (it must not be used any more by
+ * caller).
+ *
+ * Returns 0 if OK, errno value if an error occurred in writer since last
+ * call to this function (the error is reset).
+ */
+
+int
+logger_writer_queue (int fd, int file_id, char *data, int size, int flags)
+{
+    struct t_logger_writer_request *new_request;
+
+    new_request = malloc (sizeof (*new_request));
+    if (!new_request)
+    {
+        free (data);
+        logger_writer_release (size);
+        if (flags & LOGGER_WRITER_CLOSE)
+            close (fd);
+        return ENOMEM;
+    }
+    new_request->fd = fd;
+    new_request->file_id = file_id;
+    new_request->data = data;
+    new_request->size = (data) ? size : 0;
+    new_request->flags = flags;
+    new_request->compression_level = 0;
+    new_request->log_filename = NULL;
+    new_request->next_request = NULL;
+
+    return logger_writer_add_request (new_request);
+}
+
+/*
+ * Sends a request to compress a file to writer thread: the file is
+ * compressed after all data queued before is written.
+ *
+ * Returns 0 if OK, errno value if an error occurred in writer since last
+ * call to this function (the error is reset).
+ */
+
+int
+logger_writer_queue_compress (const char *filename, int level)
+{
+    struct t_logger_writer_request *new_request;
+
+    new_request = malloc (sizeof (*new_request));
+    if (!new_request)
+        return ENOMEM;
+    new_request->fd = -1;
+    new_request->file_id = 0;
+    new_request->data = strdup (filename);
+    new_request->size = 0;
+    new_request->flags = LOGGER_WRITER_COMPRESS;
+    new_request->compression_level = level;
+    new_request->log_filename = NULL;
+    new_request->next_request = NULL;
+    if (!new_request->data)
+    {
+        free (new_request);
+        return ENOMEM;
+    }
+
+    return logger_writer_add_request (new_request);
+}
+
+/*
+ * Sends a request to rotate a log file to writer thread: after all data
+ * queued before is written, segments of log file are renamed, then file
+ * "filename" (log file closed and renamed by caller) is renamed to
+ * "<file>.1" and compressed if "level" is greater than 0.
+ *
+ * Returns 0 if OK, errno value if an error occurred in writer since last
+ * call to this function (the error is reset).
+ */
+
+int
+logger_writer_queue_rotate (const char *log_filename, const char *filename,
+                            int level)
+{
+    struct t_logger_writer_request *new_request;
+
+    new_request = malloc (sizeof (*new_request));
+    if (!new_request)
+        return ENOMEM;
+    new_request->fd = -1;
+    new_request->file_id = logger_writer_file_id (log_filename);
+    new_request->data = strdup (filename);
+    new_request->size = 0;
+    new_request->flags = LOGGER_WRITER_ROTATE;
+    new_request->compression_level = level;
+    new_request->log_filename = strdup (log_filename);
+    new_request->next_request = NULL;
+    if (!new_request->data || !new_request->log_filename)
+    {
+        if (new_request->data)
+            free (new_request->data);
+        if (new_request->log_filename)
+            free (new_request->log_filename);
+        free (new_request);
+        return ENOMEM;
+    }
+
+    return logger_writer_add_request (new_request);
+}
+
+/*
+ * Waits until all data sent to writer is written.
+ */
+
+void
+logger_writer_wait ()
+{
+    if (!logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    while (logger_writer_requests || logger_writer_busy)
+    {
+        pthread_cond_wait (&logger_writer_cond_done, &logger_writer_mutex);
+    }
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Checks if a log file has requests not yet processed.
+ *
+ * Note: mutex must be locked by caller.
+ *
+ * Returns:
+ *   1: file has requests not yet processed
+ *   0: all requests of file are processed
+ */
+
+int
+logger_writer_file_busy (int file_id)
+{
+    struct t_logger_writer_request *ptr_request;
+    int i;
+
+    if (logger_writer_busy && (logger_writer_num_busy_ids < 0))
+        return 1;
+
+    for (i = 0; i < logger_writer_num_busy_ids; i++)
+    {
+        if (logger_writer_busy_ids[i] == file_id)
+            return 1;
+    }
+
+    for (ptr_request = logger_writer_requests; ptr_request;
+         ptr_request = ptr_request->next_request)
+    {
+        if (ptr_request->file_id == file_id)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Waits until all data sent to writer for a log file is written (and
+ * rotation of this file is done), requests of other files are not waited.
+ */
+
+void
+logger_writer_wait_file (int file_id)
+{
+    if (!logger_writer_running || (file_id == 0))
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    while (logger_writer_file_busy (file_id))
+    {
+        pthread_cond_wait (&logger_writer_cond_done, &logger_writer_mutex);
+    }
+    pthread_mutex_unlock (&logger_writer_mutex);
+}
+
+/*
+ * Returns size of data reserved and not yet written.
+ */
+
+int
+logger_writer_pending_size ()
+{
+    int size;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    size = logger_writer_size;
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    return size;
+}
+
+/*
+ * Stops writer thread (all data sent to writer is written before thread
+ * ends).
+ */
+
+void
+logger_writer_end ()
+{
+    if (!logger_writer_running)
+        return;
+
+    pthread_mutex_lock (&logger_writer_mutex);
+    logger_writer_stop = 1;
+    pthread_cond_signal (&logger_writer_cond_queue);
+    pthread_mutex_unlock (&logger_writer_mutex);
+
+    pthread_join (logger_writer_thread_id, NULL);
+
+    logger_writer_running = 0;
+    logger_writer_stop = 0;
+
+    if (logger_writer_busy_ids)
+    {
+        free (logger_writer_busy_ids);
+        logger_writer_busy_ids = NULL;
+    }
+    logger_writer_num_busy_ids = 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_LOGGER_WRITER_H
+#define WEECHAT_LOGGER_WRITER_H 1
+
+/* data of a logger buffer is sent to writer when this size is reached */
+#define LOGGER_WRITER_CHUNK_SIZE 16384
+
+/* max number of chunks written with a single call to writev */
+#define LOGGER_WRITER_IOV_MAX 64
+
+/* flags for requests sent to writer */
+#define LOGGER_WRITER_SYNC  1          /* fdatasync file after write        */
+#define LOGGER_WRITER_CLOSE 2          /* close file after write            */
+#define LOGGER_WRITER_COMPRESS 4       /* compress file (data is filename)  */
+#define LOGGER_WRITER_ROTATE 8         /* rotate file (data is filename)    */
+
+/* overflow policy (when max size of pending data is reached) */
+
+enum t_logger_writer_overflow
+{
+    LOGGER_WRITER_OVERFLOW_BLOCK = 0,  /* wait until data is written        */
+    LOGGER_WRITER_OVERFLOW_DROP,       /* drop new lines                    */
+    /* number of overflow policies */
+    LOGGER_WRITER_NUM_OVERFLOW,
+};
+
+struct t_logger_writer_request
+{
+    int fd;                            /* file descriptor                   */
+    int file_id;                       /* id of log file (0 = none)         */
+    char *data;                        /* data to write (may be NULL)       */
+    int size;                          /* size of data                      */
+    int flags;                         /* LOGGER_WRITER_SYNC/CLOSE/...      */
+    int compression_level;             /* compression level (1-9)           */
+    char *log_filename;                /* log file (for rotation)           */
+    struct t_logger_writer_request *next_request; /* link to next request   */
+};
+
+extern int logger_writer_init ();
+extern int logger_writer_reserve (int size, int max_size, int wait);
+extern void logger_writer_release (int size);
+extern int logger_writer_file_id (const char *filename);
+extern int logger_writer_queue (int fd, int file_id, char *data, int size,
+                                int flags);
+extern int logger_writer_queue_compress (const char *filename, int level);
+extern int logger_writer_queue_rotate (const char *log_filename,
+                                       const char *filename, int level);
+extern void logger_writer_wait ();
+extern void logger_writer_wait_file (int file_id);
+extern int logger_writer_pending_size ();
+extern void logger_writer_end ();
+
+#endif /* WEECHAT_LOGGER_WRITER_H */
@@ -41,8 +41,11 @@
 #include "logger.h"
 #include "logger-buffer.h"
 #include "logger-config.h"
+#include "logger-index.h"
 #include "logger-info.h"
+#include "logger-rotate.h"
 #include "logger-tail.h"
+#include "logger-writer.h"
 
 
 WEECHAT_PLUGIN_NAME(LOGGER_PLUGIN_NAME);
@@ -54,6 +57,7 @@ WEECHAT_PLUGIN_LICENSE(WEECHAT_LICENSE);
 struct t_weechat_plugin *weechat_logger_plugin = NULL;
 
 struct t_hook *logger_timer = NULL;    /* timer to flush log files          */
+int logger_rotate_count = 0;           /* number of rotations (for names)   */
 
 
 /*
@@ -531,22 +535,343 @@ logger_set_log_filename (struct t_logger_buffer *logger_buffer)
 }
 
 /*
- * Writes a line to log file.
+ * Sends data of all logger buffers to writer.
+ *
+ * Argument "flags" is sent to writer (see function logger_buffer_flush).
  */
 
 void
-logger_write_line (struct t_logger_buffer *logger_buffer,
+logger_flush_buffers (int flags)
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
+         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
+    {
+        if (ptr_logger_buffer->flush_needed)
+            logger_buffer_flush (ptr_logger_buffer, flags);
+    }
+}
+
+/*
+ * Loads index of log file of a logger buffer, if the log file is empty or
+ * if the index file exists (otherwise the index is built when needed, see
+ * function logger_get_index).
+ */
+
+void
+logger_load_index (struct t_logger_buffer *logger_buffer)
+{
+    struct stat st;
+    char *index_filename;
+    int index_exists;
+
+    if (logger_buffer->index || !logger_buffer->log_filename)
+        return;
+
+    if ((stat (logger_buffer->log_filename, &st) == 0) && (st.st_size > 0))
+    {
+        index_filename = logger_index_get_filename (logger_buffer->log_filename);
+        if (!index_filename)
+            return;
+        index_exists = (access (index_filename, F_OK) == 0);
+        free (index_filename);
+        if (!index_exists)
+            return;
+    }
+
+    logger_buffer->index = logger_index_load (
+        logger_buffer->log_filename,
+        weechat_config_string (logger_config_file_time_format));
+}
+
+/*
+ * Gets index of log file of a logger buffer, to read the log file: data not
+ * yet written is written in file, and the index is built if needed.
+ *
+ * If "*temp_index" is set to 1 by this function, the index returned must
+ * be freed after use (the log file is not opened by the logger buffer).
+ *
+ * Returns pointer to index, NULL if error.
+ */
+
+struct t_logger_index *
+logger_get_index (struct t_logger_buffer *logger_buffer, int *temp_index)
+{
+    struct t_logger_index *ptr_index;
+
+    *temp_index = 0;
+
+    if (!logger_buffer->log_filename)
+        logger_set_log_filename (logger_buffer);
+    if (!logger_buffer->log_filename)
+        return NULL;
+
+    /* the log file may have data not yet written */
+    logger_buffer_flush (logger_buffer, 0);
+    logger_writer_wait_file (
+        logger_writer_file_id (logger_buffer->log_filename));
+
+    if (logger_buffer->index)
+        return logger_buffer->index;
+
+    ptr_index = logger_index_load (
+        logger_buffer->log_filename,
+        weechat_config_string (logger_config_file_time_format));
+    if (!ptr_index)
+        return NULL;
+    logger_index_save (ptr_index);
+
+    if (logger_buffer->log_fd >= 0)
+        logger_buffer->index = ptr_index;
+    else
+        *temp_index = 1;
+
+    return ptr_index;
+}
+
+/*
+ * Saves index of all log files in index files.
+ */
+
+void
+logger_save_indexes ()
+{
+    struct t_logger_buffer *ptr_logger_buffer;
+
+    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
+         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
+    {
+        if (ptr_logger_buffer->index)
+            logger_index_save (ptr_logger_buffer->index);
+    }
+}
+
+/*
+ * Compresses a log file which is not used any more (if compression is
+ * enabled): the file is compressed by writer thread.
+ */
+
+void
+logger_compress_file (const char *filename)
+{
+    char *index_filename;
+    int error;
+
+    if (weechat_config_integer (logger_config_file_rotation_compression_type) ==
+        LOGGER_ROTATE_COMPRESSION_NONE)
+    {
+        return;
+    }
+
+    /* the index is useless for a compressed file */
+    index_filename = logger_index_get_filename (filename);
+    if (index_filename)
+    {
+        unlink (index_filename);
+        free (index_filename);
+    }
+
+    error = logger_writer_queue_compress (
+        filename,
+        weechat_config_integer (logger_config_file_rotation_compression_level));
+    if (error != 0)
+    {
+        weechat_printf_tags (NULL,
+                             "no_log",
+                             _("%s%s: unable to compress log file: %s"),
+                             weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+                             strerror (error));
+    }
+}
+
+/*
+ * Rotates log file of a logger buffer: the file is closed and renamed to
+ * "<file>.1" (previous rotated files are renamed), then compressed (if
+ * enabled). A new log file is opened on next line.
+ *
+ * The log file is renamed to a temporary name now, so that the new log file
+ * can be opened immediately: segments are renamed and compressed by writer
+ * thread, after data queued before (the main thread never waits).
+ */
+
+void
+logger_rotate (struct t_logger_buffer *logger_buffer)
+{
+    char *index_filename, *pending_filename;
+    int level, error;
+
+    if (weechat_logger_plugin->debug)
+    {
+        weechat_printf_tags (NULL,
+                             "no_log",
+                             "%s: rotate file %s (%lld bytes)",
+                             LOGGER_PLUGIN_NAME,
+                             logger_buffer->log_filename,
+                             logger_buffer->log_size);
+    }
+
+    /* the index of log file is rebuilt for new file */
+    if (logger_buffer->index)
+    {
+        logger_index_free (logger_buffer->index);
+        logger_buffer->index = NULL;
+    }
+    logger_buffer_close (logger_buffer);
+    logger_buffer->log_size = 0;
+    index_filename = logger_index_get_filename (logger_buffer->log_filename);
+    if (index_filename)
+    {
+        unlink (index_filename);
+        free (index_filename);
+    }
+
+    /* data already queued is still written in the renamed file */
+    logger_rotate_count++;
+    pending_filename = logger_rotate_pending_filename (
+        logger_buffer->log_filename, logger_rotate_count);
+    if (!pending_filename
+        || (rename (logger_buffer->log_filename, pending_filename) != 0))
+    {
+        weechat_printf_tags (NULL,
+                             "no_log",
+                             _("%s%s: unable to rotate log file \"%s\""),
+                             weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+                             logger_buffer->log_filename);
+        if (pending_filename)
+            free (pending_filename);
+        return;
+    }
+
+    level = (weechat_config_integer (logger_config_file_rotation_compression_type) ==
+             LOGGER_ROTATE_COMPRESSION_NONE) ?
+        0 : weechat_config_integer (logger_config_file_rotation_compression_level);
+    error = logger_writer_queue_rotate (logger_buffer->log_filename,
+                                        pending_filename, level);
+    if (error != 0)
+    {
+        weechat_printf_tags (NULL,
+                             "no_log",
+                             _("%s%s: unable to rotate log file \"%s\": %s"),
+                             weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+                             logger_buffer->log_filename,
+                             strerror (error));
+    }
+    free (pending_filename);
+}
+
+/*
+ * Adds a line (without final "\n") in write buffer of a logger buffer.
+ *
+ * If the max size of data not yet written in log files is reached, the
+ * line is handled according to option logger.file.write_overflow: wait
+ * until data is written ("block") or drop the line ("drop").
+ */
+
+void
+logger_write_data (struct t_logger_buffer *logger_buffer, const char *data,
+                   time_t date)
+{
+    char buf_dropped[256];
+    int size, size_dropped, max_size, block, rc;
+    long long size_max;
+
+    size = strlen (data) + 1;
+    max_size = weechat_config_integer (logger_config_file_write_buffer_max) * 1024;
+    block = (weechat_config_integer (logger_config_file_write_overflow) ==
+             LOGGER_WRITER_OVERFLOW_BLOCK);
+
+    rc = logger_writer_reserve (size, max_size, block);
+    if (!rc && block)
+    {
+        /* send all pending data to writer, then wait until it is written */
+        logger_flush_buffers (0);
+        rc = logger_writer_reserve (size, max_size, block);
+    }
+    if (!rc)
+    {
+        if (logger_buffer->lines_dropped == 0)
+        {
+            weechat_printf_tags (NULL,
+                                 "no_log",
+                                 _("%s%s: too much data waiting to be written "
+                                   "in log files, lines are dropped for file "
+                                   "\"%s\""),
+                                 weechat_prefix ("error"), LOGGER_PLUGIN_NAME,
+                                 logger_buffer->log_filename);
+        }
+        logger_buffer->lines_dropped++;
+        return;
+    }
+
+    if (logger_buffer->lines_dropped > 0)
+    {
+        snprintf (buf_dropped, sizeof (buf_dropped),
+                  _("\t****  %d lines dropped  ****"),
+                  logger_buffer->lines_dropped);
+        size_dropped = strlen (buf_dropped) + 1;
+        /*
+         * if there is no room for the marker, keep the counter: the marker
+         * will be added before next line
+         */
+        if (logger_writer_reserve (size_dropped, max_size, 0))
+        {
+            if (logger_buffer_append (logger_buffer, buf_dropped,
+                                      size_dropped - 1, 0))
+                logger_buffer->lines_dropped = 0;
+            else
+                logger_writer_release (size_dropped);
+        }
+    }
+
+    if (!logger_buffer_append (logger_buffer, data, size - 1, date))
+    {
+        logger_writer_release (size);
+        return;
+    }
+
+    size_max = weechat_config_integer (logger_config_file_rotation_size_max);
+    if ((size_max > 0) && (logger_buffer->log_size >= size_max * 1024))
+    {
+        logger_rotate (logger_buffer);
+        return;
+    }
+
+    /*
+     * without flush timer, data is sent to writer immediately (the writer
+     * groups data of many lines if it is late)
+     */
+    if (!logger_timer)
+    {
+        logger_buffer_flush (logger_buffer,
+                             (weechat_config_boolean (logger_config_file_fsync)) ?
+                             LOGGER_WRITER_SYNC : 0);
+    }
+    else if (logger_buffer->write_buffer_size >= LOGGER_WRITER_CHUNK_SIZE)
+    {
+        logger_buffer_flush (logger_buffer, 0);
+    }
+}
+
+/*
+ * Writes a line to log file ("date" is the date of line, used in index of
+ * log file).
+ */
+
+void
+logger_write_line (struct t_logger_buffer *logger_buffer, time_t date,
                    const char *format, ...)
 {
     char *message, buf_time[256], buf_beginning[1024];
     const char *charset;
     time_t seconds;
     struct tm *date_tmp;
+    struct stat st;
     int log_level;
 
     charset = weechat_info_get ("charset_terminal", "");
 
-    if (!logger_buffer->log_file)
+    if (logger_buffer->log_fd < 0)
     {
         log_level = logger_get_level_for_buffer (logger_buffer->buffer);
         if (log_level == 0)
@@ -573,9 +898,9 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
             return;
         }
 
-        logger_buffer->log_file =
-            fopen (logger_buffer->log_filename, "a");
-        if (!logger_buffer->log_file)
+        logger_buffer->log_fd = open (logger_buffer->log_filename,
+                                      O_WRONLY | O_CREAT | O_APPEND, 0666);
+        if (logger_buffer->log_fd < 0)
         {
             weechat_printf_tags (NULL,
                                  "no_log",
@@ -586,6 +911,15 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
             return;
         }
 
+        /* the file may have been closed with data not yet written */
+        logger_writer_wait_file (
+            logger_writer_file_id (logger_buffer->log_filename));
+
+        if (fstat (logger_buffer->log_fd, &st) == 0)
+            logger_buffer->log_size = st.st_size;
+
+        logger_load_index (logger_buffer);
+
         if (weechat_config_boolean (logger_config_file_info_lines)
             && logger_buffer->write_start_info_line)
         {
@@ -603,11 +937,10 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
                       buf_time);
             message = (charset) ?
                 weechat_iconv_from_internal (charset, buf_beginning) : NULL;
-            fprintf (logger_buffer->log_file,
-                     "%s\n", (message) ? message : buf_beginning);
+            logger_write_data (logger_buffer,
+                               (message) ? message : buf_beginning, seconds);
             if (message)
                 free (message);
-            logger_buffer->flush_needed = 1;
         }
         logger_buffer->write_start_info_line = 0;
     }
@@ -617,16 +950,10 @@ logger_write_line (struct t_logger_buffer *logger_buffer,
     {
         message = (charset) ?
             weechat_iconv_from_internal (charset, vbuffer) : NULL;
-        fprintf (logger_buffer->log_file,
-                 "%s\n", (message) ? message : vbuffer);
+        logger_write_data (logger_buffer, (message) ? message : vbuffer,
+                           date);
         if (message)
             free (message);
-        logger_buffer->flush_needed = 1;
-        if (!logger_timer)
-        {
-            fflush (logger_buffer->log_file);
-            logger_buffer->flush_needed = 0;
-        }
         free (vbuffer);
     }
 }
@@ -645,7 +972,7 @@ logger_stop (struct t_logger_buffer *logger_buffer, int write_info_line)
     if (!logger_buffer)
         return;
 
-    if (logger_buffer->log_enabled && logger_buffer->log_file)
+    if (logger_buffer->log_enabled && (logger_buffer->log_fd >= 0))
     {
         if (write_info_line && weechat_config_boolean (logger_config_file_info_lines))
         {
@@ -658,12 +985,11 @@ logger_stop (struct t_logger_buffer *logger_buffer, int write_info_line)
                           weechat_config_string (logger_config_file_time_format),
                           date_tmp);
             }
-            logger_write_line (logger_buffer,
+            logger_write_line (logger_buffer, seconds,
                                _("%s\t****  End of log  ****"),
                                buf_time);
         }
-        fclose (logger_buffer->log_file);
-        logger_buffer->log_file = NULL;
+        logger_buffer_close (logger_buffer);
     }
     logger_buffer_free (logger_buffer);
 }
@@ -719,13 +1045,7 @@ logger_start_buffer (struct t_gui_buffer *buffer, int write_info_line)
             if (ptr_logger_buffer)
             {
                 if (ptr_logger_buffer->log_filename)
-                {
-                    if (ptr_logger_buffer->log_file)
-                    {
-                        fclose (ptr_logger_buffer->log_file);
-                        ptr_logger_buffer->log_file = NULL;
-                    }
-                }
+                    logger_buffer_close (ptr_logger_buffer);
             }
         }
         if (ptr_logger_buffer)
@@ -847,25 +1167,8 @@ logger_set_buffer (struct t_gui_buffer *buffer, const char *value)
 void
 logger_flush ()
 {
-    struct t_logger_buffer *ptr_logger_buffer;
-
-    for (ptr_logger_buffer = logger_buffers; ptr_logger_buffer;
-         ptr_logger_buffer = ptr_logger_buffer->next_buffer)
-    {
-        if (ptr_logger_buffer->log_file && ptr_logger_buffer->flush_needed)
-        {
-            if (weechat_logger_plugin->debug >= 2)
-            {
-                weechat_printf_tags (NULL,
-                                     "no_log",
-                                     "%s: flush file %s",
-                                     LOGGER_PLUGIN_NAME,
-                                     ptr_logger_buffer->log_filename);
-            }
-            fflush (ptr_logger_buffer->log_file);
-            ptr_logger_buffer->flush_needed = 0;
-        }
-    }
+    logger_flush_buffers ((weechat_config_boolean (logger_config_file_fsync)) ?
+                          LOGGER_WRITER_SYNC : 0);
 }
 
 /*
@@ -897,6 +1200,8 @@ logger_command_cb (void *data, struct t_gui_buffer *buffer,
     if (weechat_strcasecmp (argv[1], "flush") == 0)
     {
         logger_flush ();
+        logger_writer_wait ();
+        logger_save_indexes ();
         return WEECHAT_RC_OK;
     }
 
@@ -965,11 +1270,13 @@ logger_buffer_renamed_signal_cb (void *data, const char *signal,
 }
 
 /*
- * Displays backlog for a buffer (by reading end of log file).
+ * Displays backlog for a buffer (by reading end of log file, using index of
+ * log file if not NULL).
  */
 
 void
-logger_backlog (struct t_gui_buffer *buffer, const char *filename, int lines)
+logger_backlog (struct t_gui_buffer *buffer, const char *filename,
+                struct t_logger_index *index, int lines)
 {
     const char *charset;
     struct t_logger_line *last_lines, *ptr_lines;
@@ -983,7 +1290,14 @@ logger_backlog (struct t_gui_buffer *buffer, const char *filename, int lines)
     weechat_buffer_set (buffer, "print_hooks_enabled", "0");
 
     num_lines = 0;
-    last_lines = logger_tail_file (filename, lines);
+    if (index)
+    {
+        last_lines = logger_index_tail (index, filename, lines);
+        last_lines = logger_rotate_add_previous_lines (filename, last_lines,
+                                                       lines);
+    }
+    else
+        last_lines = logger_tail_file (filename, lines);
     ptr_lines = last_lines;
     while (ptr_lines)
     {
@@ -1056,6 +1370,8 @@ logger_backlog_signal_cb (void *data, const char *signal,
                           const char *type_data, void *signal_data)
 {
     struct t_logger_buffer *ptr_logger_buffer;
+    struct t_logger_index *ptr_index;
+    int temp_index;
 
     /* make C compiler happy */
     (void) data;
@@ -1067,8 +1383,7 @@ logger_backlog_signal_cb (void *data, const char *signal,
         ptr_logger_buffer = logger_buffer_search_buffer (signal_data);
         if (ptr_logger_buffer && ptr_logger_buffer->log_enabled)
         {
-            if (!ptr_logger_buffer->log_filename)
-                logger_set_log_filename (ptr_logger_buffer);
+            ptr_index = logger_get_index (ptr_logger_buffer, &temp_index);
 
             if (ptr_logger_buffer->log_filename)
             {
@@ -1076,10 +1391,14 @@ logger_backlog_signal_cb (void *data, const char *signal,
 
                 logger_backlog (signal_data,
                                 ptr_logger_buffer->log_filename,
+                                ptr_index,
                                 weechat_config_integer (logger_config_look_backlog));
 
                 ptr_logger_buffer->log_enabled = 1;
             }
+
+            if (temp_index)
+                logger_index_free (ptr_index);
         }
     }
 
@@ -1139,7 +1458,8 @@ logger_adjust_log_filenames ()
     struct t_infolist *ptr_infolist;
     struct t_logger_buffer *ptr_logger_buffer;
     struct t_gui_buffer *ptr_buffer;
-    char *log_filename;
+    char *log_filename, *old_log_filename;
+    int opened;
 
     ptr_infolist = weechat_infolist_get ("buffer", NULL, NULL);
     if (ptr_infolist)
@@ -1159,8 +1479,16 @@ logger_adjust_log_filenames ()
                          * log filename has changed (probably due to day
                          * change),then we'll use new filename
                          */
+                        old_log_filename = strdup (ptr_logger_buffer->log_filename);
+                        opened = (ptr_logger_buffer->log_fd >= 0);
                         logger_stop (ptr_logger_buffer, 1);
                         logger_start_buffer (ptr_buffer, 1);
+                        if (old_log_filename)
+                        {
+                            if (opened)
+                                logger_compress_file (old_log_filename);
+                            free (old_log_filename);
+                        }
                     }
                     free (log_filename);
                 }
@@ -1277,7 +1605,7 @@ logger_print_cb (void *data, struct t_gui_buffer *buffer, time_t date,
                           date_tmp);
             }
 
-            logger_write_line (ptr_logger_buffer,
+            logger_write_line (ptr_logger_buffer, date,
                                "%s\t%s%s%s\t%s",
                                buf_time,
                                (prefix && prefix_is_nick) ? weechat_config_string (logger_config_file_nick_prefix) : "",
@@ -1301,6 +1629,8 @@ logger_timer_cb (void *data, int remaining_calls)
     (void) data;
     (void) remaining_calls;
 
+    /* indexes are saved for data sent to writer on previous flush */
+    logger_save_indexes ();
     logger_flush ();
 
     return WEECHAT_RC_OK;
@@ -1324,6 +1654,14 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     logger_config_read ();
 
+    if (!logger_writer_init ())
+    {
+        weechat_printf (NULL,
+                        _("%s%s: unable to start writer thread, log files "
+                          "will be written by main thread"),
+                        weechat_prefix ("error"), LOGGER_PLUGIN_NAME);
+    }
+
     /* command /logger */
     weechat_hook_command (
         "logger",
@@ -1403,6 +1741,8 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     logger_stop_all (1);
 
+    logger_writer_end ();
+
     logger_config_free ();
 
     return WEECHAT_RC_OK;
@@ -25,6 +25,9 @@
 
 #define LOGGER_LEVEL_DEFAULT 9
 
+struct t_logger_buffer;
+struct t_logger_index;
+
 extern struct t_weechat_plugin *weechat_logger_plugin;
 
 extern struct t_hook *logger_timer;
@@ -32,6 +35,8 @@ extern struct t_hook *logger_timer;
 extern void logger_start_buffer_all (int write_info_line);
 extern void logger_stop_all (int write_info_line);
 extern void logger_adjust_log_filenames ();
+extern struct t_logger_index *logger_get_index (struct t_logger_buffer *logger_buffer,
+                                                int *temp_index);
 extern int logger_timer_cb (void *data, int remaining_calls);
 
 #endif /* WEECHAT_LOGGER_H */
@@ -36,10 +36,12 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-debug.h"
 #include "../core/wee-hashtable.h"
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-input.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-proxy.h"
 #include "../core/wee-string.h"
 #include "../core/wee-url.h"
@@ -455,6 +457,11 @@ plugin_api_info_get_internal (void *data, const char *info_name,
         }
     }
 
+    else if (string_strcasecmp (info_name, "loop_latency") == 0)
+    {
+        return debug_loop_info (arguments);
+    }
+
     /* info not found */
     return NULL;
 }
@@ -483,6 +490,7 @@ plugin_api_infolist_get_internal (void *data, const char *infolist_name,
     struct t_weechat_plugin *ptr_plugin;
     struct t_proxy *ptr_proxy;
     struct t_gui_layout *ptr_layout;
+    struct t_memory_tag *ptr_memory_tag;
     int context, number, i;
     char *error;
 
@@ -747,6 +755,19 @@ plugin_api_infolist_get_internal (void *data, const char *infolist_name,
             return ptr_infolist;
         }
     }
+    else if (string_strcasecmp (infolist_name, "hook_stats") == 0)
+    {
+        ptr_infolist = infolist_new (NULL);
+        if (ptr_infolist)
+        {
+            if (!hook_stats_add_to_infolist (ptr_infolist, arguments))
+            {
+                infolist_free (ptr_infolist);
+                return NULL;
+            }
+            return ptr_infolist;
+        }
+    }
     else if (string_strcasecmp (infolist_name, "hotlist") == 0)
     {
         ptr_infolist = infolist_new (NULL);
@@ -805,6 +826,27 @@ plugin_api_infolist_get_internal (void *data, const char *infolist_name,
             return ptr_infolist;
         }
     }
+    else if (string_strcasecmp (infolist_name, "memory") == 0)
+    {
+        ptr_infolist = infolist_new (NULL);
+        if (ptr_infolist)
+        {
+            for (ptr_memory_tag = memory_tags; ptr_memory_tag;
+                 ptr_memory_tag = ptr_memory_tag->next_tag)
+            {
+                if (!arguments || !arguments[0]
+                    || string_match (ptr_memory_tag->plugin_name, arguments, 0))
+                {
+                    if (!memory_add_to_infolist (ptr_infolist, ptr_memory_tag))
+                    {
+                        infolist_free (ptr_infolist);
+                        return NULL;
+                    }
+                }
+            }
+            return ptr_infolist;
+        }
+    }
     else if (string_strcasecmp (infolist_name, "nicklist") == 0)
     {
         /* invalid buffer pointer ? */
@@ -1211,6 +1253,13 @@ plugin_api_init ()
                N_("rgb,limit (limit is optional and is set to 256 by default)"),
                &plugin_api_info_get_internal, NULL);
 
+    hook_info (NULL, "loop_latency", N_("latency of main loop, in microseconds (see /debug loop)"),
+               N_("phase,value (phase is timer, fd, refresh, wait or busy "
+                  "(default), value is count, min, avg, max, stalls or a "
+                  "percentile like p99 or p99.9; without value, all values "
+                  "are returned)"),
+               &plugin_api_info_get_internal, NULL);
+
     /* WeeChat core infolist hooks */
     hook_infolist (NULL, "bar", N_("list of bars"),
                    N_("bar pointer (optional)"),
@@ -1246,6 +1295,12 @@ plugin_api_init ()
                       "get only some hooks (wildcard \"*\" is allowed), "
                       "both are optional)"),
                    &plugin_api_infolist_get_internal, NULL);
+    hook_infolist (NULL, "hook_stats",
+                   N_("statistics on time spent in hook callbacks (only if "
+                      "enabled with \"/debug hooks-time enable\")"),
+                   NULL,
+                   N_("hook type: command, timer, .. (optional)"),
+                   &plugin_api_infolist_get_internal, NULL);
     hook_infolist (NULL, "hotlist", N_("list of buffers in hotlist"),
                    NULL,
                    NULL,
@@ -1259,6 +1314,12 @@ plugin_api_init ()
                    NULL,
                    NULL,
                    &plugin_api_infolist_get_internal, NULL);
+    hook_infolist (NULL, "memory",
+                   N_("memory allocated per plugin and subsystem (only if "
+                      "option weechat.startup.memory_accounting is enabled)"),
+                   NULL,
+                   N_("plugin name (wildcard \"*\" is allowed) (optional)"),
+                   &plugin_api_infolist_get_internal, NULL);
     hook_infolist (NULL, "nicklist", N_("nicks in nicklist for a buffer"),
                    N_("buffer pointer"),
                    N_("nick_xxx or group_xxx to get only nick/group xxx "
@@ -1312,6 +1373,8 @@ plugin_api_init ()
                 &gui_history_hdata_history_cb, NULL);
     hook_hdata (NULL, "hotlist", N_("hotlist"),
                 &gui_hotlist_hdata_hotlist_cb, NULL);
+    hook_hdata (NULL, "hook", N_("hook (variables common to all hook types)"),
+                &hook_hdata_hook_cb, NULL);
     hook_hdata (NULL, "input_undo", N_("structure with undo for input line"),
                 &gui_buffer_hdata_input_undo_cb, NULL);
     hook_hdata (NULL, "key", N_("a key (keyboard shortcut)"),
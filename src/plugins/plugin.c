@@ -44,6 +44,7 @@
 #include "../core/wee-infolist.h"
 #include "../core/wee-list.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-network.h"
 #include "../core/wee-string.h"
 #include "../core/wee-upgrade-file.h"
@@ -567,6 +568,11 @@ plugin_load (const char *filename, int argc, char **argv)
         new_plugin->util_get_time_string = &util_get_time_string;
         new_plugin->util_version_number = &util_version_number;
 
+        new_plugin->memory_tag = &memory_tag_get_plugin;
+        new_plugin->memory_malloc = &memory_malloc;
+        new_plugin->memory_strdup = &memory_strdup;
+        new_plugin->memory_free = &memory_free;
+
         new_plugin->list_new = &weelist_new;
         new_plugin->list_add = &weelist_add;
         new_plugin->list_search = &weelist_search;
@@ -45,6 +45,9 @@ char *relay_irc_backlog_commands_tags[RELAY_IRC_NUM_CMD] =
 char *relay_irc_server_capabilities[RELAY_IRC_NUM_CAPAB] =
 { "server-time" };
 
+struct t_hashtable *relay_irc_servers = NULL; /* IRC servers with clients   */
+                                              /* (key: server name)         */
+
 
 /*
  * Checks if IRC command has to be relayed to client.
@@ -186,17 +189,96 @@ end:
 }
 
 /*
- * Sends formatted data to client.
+ * Splits an IRC message (if it is too long) for a server.
+ *
+ * Returns array of messages (each one ending with "\r\n"), NULL if error.
+ * The number of messages is stored in "count".
+ *
+ * Note: result must be freed after use with function
+ * relay_irc_message_split_free.
  */
 
-void
-relay_irc_sendf (struct t_relay_client *client, const char *format, ...)
+char **
+relay_irc_message_split (const char *server, const char *message, int *count)
 {
     int length, number;
-    char *pos, hash_key[32], *message;
+    char hash_key[32], **messages, **new_messages;
     const char *str_message;
     struct t_hashtable *hashtable_in, *hashtable_out;
 
+    *count = 0;
+    messages = NULL;
+
+    hashtable_in = weechat_hashtable_new (32,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          WEECHAT_HASHTABLE_STRING,
+                                          NULL,
+                                          NULL);
+    if (!hashtable_in)
+        return NULL;
+
+    weechat_hashtable_set (hashtable_in, "server", server);
+    weechat_hashtable_set (hashtable_in, "message", message);
+    hashtable_out = weechat_info_get_hashtable ("irc_message_split",
+                                                hashtable_in);
+    if (hashtable_out)
+    {
+        number = 1;
+        while (1)
+        {
+            snprintf (hash_key, sizeof (hash_key), "msg%d", number);
+            str_message = weechat_hashtable_get (hashtable_out, hash_key);
+            if (!str_message)
+                break;
+            new_messages = realloc (messages,
+                                    (*count + 1) * sizeof (*messages));
+            if (!new_messages)
+                break;
+            messages = new_messages;
+            length = strlen (str_message) + 2 + 1;
+            messages[*count] = malloc (length);
+            if (!messages[*count])
+                break;
+            snprintf (messages[*count], length, "%s\r\n", str_message);
+            (*count)++;
+            number++;
+        }
+        weechat_hashtable_free (hashtable_out);
+    }
+    weechat_hashtable_free (hashtable_in);
+
+    return messages;
+}
+
+/*
+ * Frees messages returned by function relay_irc_message_split.
+ */
+
+void
+relay_irc_message_split_free (char **messages, int count)
+{
+    int i;
+
+    if (!messages)
+        return;
+
+    for (i = 0; i < count; i++)
+    {
+        free (messages[i]);
+    }
+    free (messages);
+}
+
+/*
+ * Sends formatted data to client.
+ */
+
+void
+relay_irc_sendf (struct t_relay_client *client, const char *format, ...)
+{
+    int i, count;
+    char *pos, **messages;
+
     if (!client)
         return;
 
@@ -211,110 +293,221 @@ relay_irc_sendf (struct t_relay_client *client, const char *format, ...)
     if (pos)
         pos[0] = '\0';
 
-    hashtable_in = weechat_hashtable_new (32,
-                                          WEECHAT_HASHTABLE_STRING,
-                                          WEECHAT_HASHTABLE_STRING,
-                                          NULL,
-                                          NULL);
-    if (hashtable_in)
+    messages = relay_irc_message_split (client->protocol_args, vbuffer,
+                                        &count);
+    if (messages)
     {
-        weechat_hashtable_set (hashtable_in, "server", client->protocol_args);
-        weechat_hashtable_set (hashtable_in, "message", vbuffer);
-        hashtable_out = weechat_info_get_hashtable ("irc_message_split",
-                                                    hashtable_in);
-        if (hashtable_out)
+        for (i = 0; i < count; i++)
         {
-            number = 1;
-            while (1)
-            {
-                snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                str_message = weechat_hashtable_get (hashtable_out, hash_key);
-                if (!str_message)
-                    break;
-                length = strlen (str_message) + 16 + 1;
-                message = malloc (length);
-                if (message)
-                {
-                    snprintf (message, length, "%s\r\n", str_message);
-                    relay_client_send (client, message, strlen (message), NULL);
-                    free (message);
-                }
-                number++;
-            }
-            weechat_hashtable_free (hashtable_out);
+            relay_client_send (client, messages[i], strlen (messages[i]),
+                               NULL);
         }
-        weechat_hashtable_free (hashtable_in);
+        relay_irc_message_split_free (messages, count);
     }
 
     free (vbuffer);
 }
 
 /*
- * Callback for signal "irc_in2".
+ * Initializes a message shared by many clients.
+ */
+
+void
+relay_irc_shared_msg_init (struct t_relay_irc_shared_msg *shared_msg)
+{
+    shared_msg->prefix = NULL;
+    shared_msg->count = 0;
+    shared_msg->messages = NULL;
+}
+
+/*
+ * Frees content of a message shared by many clients.
+ */
+
+void
+relay_irc_shared_msg_free (struct t_relay_irc_shared_msg *shared_msg)
+{
+    if (shared_msg->prefix)
+        free (shared_msg->prefix);
+    relay_irc_message_split_free (shared_msg->messages, shared_msg->count);
+    relay_irc_shared_msg_init (shared_msg);
+}
+
+/*
+ * Sends a message ":prefix message" to a client.
+ *
+ * The message is formatted and split only once for all clients receiving the
+ * same event: it is built again only if the prefix is different for this
+ * client (for example if the nick of client is different).
+ */
+
+void
+relay_irc_shared_msg_send (struct t_relay_client *client,
+                           struct t_relay_irc_shared_msg *shared_msg,
+                           const char *prefix, const char *message)
+{
+    int i, length;
+    char *str_message;
+
+    if (!shared_msg->messages || !shared_msg->prefix
+        || (strcmp (shared_msg->prefix, prefix) != 0))
+    {
+        relay_irc_shared_msg_free (shared_msg);
+        length = 1 + strlen (prefix) + 1 + strlen (message) + 1;
+        str_message = malloc (length);
+        if (!str_message)
+            return;
+        snprintf (str_message, length, ":%s %s", prefix, message);
+        shared_msg->messages = relay_irc_message_split (client->protocol_args,
+                                                        str_message,
+                                                        &shared_msg->count);
+        free (str_message);
+        if (!shared_msg->messages)
+            return;
+        shared_msg->prefix = strdup (prefix);
+    }
+
+    for (i = 0; i < shared_msg->count; i++)
+    {
+        relay_client_send (client, shared_msg->messages[i],
+                           strlen (shared_msg->messages[i]), NULL);
+    }
+}
+
+/*
+ * Checks if a client receives messages from/to an IRC server.
+ *
+ * Returns:
+ *   1: client receives messages from/to server
+ *   0: client does not receive messages from/to server
+ */
+
+int
+relay_irc_client_on_server (struct t_relay_client *client, const char *server)
+{
+    return ((client->protocol == RELAY_PROTOCOL_IRC)
+            && client->protocol_data
+            && RELAY_IRC_DATA(client, server_messages)
+            && client->protocol_args
+            && (strcmp (client->protocol_args, server) == 0)) ? 1 : 0;
+}
+
+/*
+ * Callback for signal "irc_in2" (hooked once for each IRC server).
  *
  * This is called when something is received on IRC server, and message can be
- * relayed (or not) to client.
+ * relayed (or not) to clients: the message is parsed and built only once for
+ * all clients on this server.
  */
 
 int
 relay_irc_signal_irc_in2_cb (void *data, const char *signal,
                              const char *type_data, void *signal_data)
 {
-    struct t_relay_client *client;
+    struct t_relay_irc_server *ptr_server;
+    struct t_relay_client *ptr_client, *ptr_next_client;
     const char *ptr_msg, *irc_nick, *irc_host, *irc_command, *irc_args;
     struct t_hashtable *hash_parsed;
+    struct t_relay_irc_shared_msg shared_msg;
+    char *message, *server_name;
+    int length;
 
     /* make C compiler happy */
     (void) signal;
     (void) type_data;
 
-    client = (struct t_relay_client *)data;
+    ptr_server = (struct t_relay_irc_server *)data;
     ptr_msg = (const char *)signal_data;
 
+    /*
+     * server name is copied because the server structure is freed if the
+     * last client on this server is disconnected (when sending message)
+     */
+    server_name = strdup (ptr_server->name);
+    if (!server_name)
+        return WEECHAT_RC_ERROR;
+
     if (weechat_relay_plugin->debug >= 2)
     {
-        weechat_printf (NULL, "%s: irc_in2: client: %s%s%s, data: %s",
+        weechat_printf (NULL, "%s: irc_in2: server: %s, data: %s",
                         RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
+                        server_name,
                         ptr_msg);
     }
 
-    hash_parsed = relay_irc_message_parse (ptr_msg);
-    if (hash_parsed)
+    hash_parsed = NULL;
+    irc_nick = NULL;
+    irc_host = NULL;
+    irc_command = NULL;
+    irc_args = NULL;
+    message = NULL;
+    relay_irc_shared_msg_init (&shared_msg);
+
+    ptr_client = relay_clients;
+    while (ptr_client)
     {
-        irc_nick = weechat_hashtable_get (hash_parsed, "nick");
-        irc_host = weechat_hashtable_get (hash_parsed, "host");
-        irc_command = weechat_hashtable_get (hash_parsed, "command");
-        irc_args = weechat_hashtable_get (hash_parsed, "arguments");
-
-        /* if self nick has changed, update it in client data */
-        if (irc_command && (weechat_strcasecmp (irc_command, "nick") == 0)
-            && irc_nick && irc_nick[0]
-            && irc_args && irc_args[0]
-            && (weechat_strcasecmp (irc_nick, RELAY_IRC_DATA(client, nick)) == 0))
-        {
-            if (RELAY_IRC_DATA(client, nick))
-                free (RELAY_IRC_DATA(client, nick));
-            RELAY_IRC_DATA(client, nick) = strdup ((irc_args[0] == ':') ?
-                                                   irc_args + 1 : irc_args);
-        }
+        ptr_next_client = ptr_client->next_client;
 
-        /* relay all commands to client, but not ping/pong */
-        if (irc_command
-            && (weechat_strcasecmp (irc_command, "ping") != 0)
-            && (weechat_strcasecmp (irc_command, "pong") != 0))
+        if (relay_irc_client_on_server (ptr_client, server_name))
         {
-            relay_irc_sendf (client, ":%s %s %s",
-                             (irc_host && irc_host[0]) ? irc_host : RELAY_IRC_DATA(client, address),
-                             irc_command,
-                             irc_args);
+            /* parse message only once, for first client on server */
+            if (!hash_parsed)
+            {
+                hash_parsed = relay_irc_message_parse (ptr_msg);
+                if (!hash_parsed)
+                    break;
+                irc_nick = weechat_hashtable_get (hash_parsed, "nick");
+                irc_host = weechat_hashtable_get (hash_parsed, "host");
+                irc_command = weechat_hashtable_get (hash_parsed, "command");
+                irc_args = weechat_hashtable_get (hash_parsed, "arguments");
+
+                /* relay all commands to clients, but not ping/pong */
+                if (irc_command
+                    && (weechat_strcasecmp (irc_command, "ping") != 0)
+                    && (weechat_strcasecmp (irc_command, "pong") != 0))
+                {
+                    length = strlen (irc_command) + 1
+                        + ((irc_args) ? strlen (irc_args) : 0) + 1;
+                    message = malloc (length);
+                    if (message)
+                    {
+                        snprintf (message, length, "%s %s",
+                                  irc_command, (irc_args) ? irc_args : "");
+                    }
+                }
+            }
+
+            /* if self nick has changed, update it in client data */
+            if (irc_command && (weechat_strcasecmp (irc_command, "nick") == 0)
+                && irc_nick && irc_nick[0]
+                && irc_args && irc_args[0]
+                && (weechat_strcasecmp (irc_nick, RELAY_IRC_DATA(ptr_client, nick)) == 0))
+            {
+                if (RELAY_IRC_DATA(ptr_client, nick))
+                    free (RELAY_IRC_DATA(ptr_client, nick));
+                RELAY_IRC_DATA(ptr_client, nick) = strdup ((irc_args[0] == ':') ?
+                                                           irc_args + 1 : irc_args);
+            }
+
+            if (message)
+            {
+                relay_irc_shared_msg_send (ptr_client, &shared_msg,
+                                           (irc_host && irc_host[0]) ?
+                                           irc_host : RELAY_IRC_DATA(ptr_client, address),
+                                           message);
+            }
         }
 
-        weechat_hashtable_free (hash_parsed);
+        ptr_client = ptr_next_client;
     }
 
+    relay_irc_shared_msg_free (&shared_msg);
+    if (message)
+        free (message);
+    if (hash_parsed)
+        weechat_hashtable_free (hash_parsed);
+    free (server_name);
+
     return WEECHAT_RC_OK;
 }
 
@@ -360,10 +553,58 @@ relay_irc_tag_relay_client_id (const char *tags)
 }
 
 /*
- * Callback for signal "irc_outtags".
+ * Gets prefix for a message sent by a client on a channel: "nick!host" (or
+ * "nick" if host is unknown).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+relay_irc_get_self_prefix (struct t_relay_client *client,
+                           const char *irc_channel)
+{
+    struct t_infolist *infolist_nick;
+    char str_infolist_args[256], *prefix;
+    const char *host;
+    int length;
+
+    /* get host for nick (it is self nick) */
+    snprintf (str_infolist_args, sizeof (str_infolist_args),
+              "%s,%s,%s",
+              client->protocol_args,
+              irc_channel,
+              RELAY_IRC_DATA(client, nick));
+
+    host = NULL;
+    infolist_nick = weechat_infolist_get ("irc_nick", NULL,
+                                          str_infolist_args);
+    if (infolist_nick && weechat_infolist_next (infolist_nick))
+        host = weechat_infolist_string (infolist_nick, "host");
+
+    length = strlen (RELAY_IRC_DATA(client, nick)) + 1
+        + ((host) ? strlen (host) : 0) + 1;
+    prefix = malloc (length);
+    if (prefix)
+    {
+        snprintf (prefix, length, "%s%s%s",
+                  RELAY_IRC_DATA(client, nick),
+                  (host && host[0]) ? "!" : "",
+                  (host && host[0]) ? host : "");
+    }
+
+    if (infolist_nick)
+        weechat_infolist_free (infolist_nick);
+
+    return prefix;
+}
+
+/*
+ * Callback for signal "irc_outtags" (hooked once for each IRC server).
  *
  * This is called when a message is sent to IRC server (by irc plugin or any
- * other plugin/script).
+ * other plugin/script): the message is parsed and built only once for all
+ * clients on this server (it is built again only for a client with a
+ * different nick).
  */
 
 int
@@ -371,20 +612,36 @@ relay_irc_signal_irc_outtags_cb (void *data, const char *signal,
                                  const char *type_data,
                                  void *signal_data)
 {
-    struct t_relay_client *client;
+    struct t_relay_irc_server *ptr_server;
+    struct t_relay_client *ptr_client, *ptr_next_client;
     struct t_hashtable *hash_parsed;
-    const char *irc_command, *irc_args, *host, *ptr_message;
-    char *pos, *tags, *irc_channel, *message;
-    struct t_infolist *infolist_nick;
-    char str_infolist_args[256];
+    struct t_relay_irc_shared_msg shared_msg;
+    const char *irc_command, *irc_args, *ptr_message;
+    char *pos, *tags, *irc_channel, *message, *prefix, *prefix_nick;
+    char *server_name;
+    int client_id, relayed;
 
     /* make C compiler happy */
     (void) signal;
     (void) type_data;
 
-    client = (struct t_relay_client *)data;
+    ptr_server = (struct t_relay_irc_server *)data;
+
+    /*
+     * server name is copied because the server structure is freed if the
+     * last client on this server is disconnected (when sending message)
+     */
+    server_name = strdup (ptr_server->name);
+    if (!server_name)
+        return WEECHAT_RC_ERROR;
 
     tags = NULL;
+    hash_parsed = NULL;
+    irc_channel = NULL;
+    prefix = NULL;
+    prefix_nick = NULL;
+    relayed = -1;
+    relay_irc_shared_msg_init (&shared_msg);
 
     message = strdup ((char *)signal_data);
     if (!message)
@@ -397,11 +654,9 @@ relay_irc_signal_irc_outtags_cb (void *data, const char *signal,
 
     if (weechat_relay_plugin->debug >= 2)
     {
-        weechat_printf (NULL, "%s: irc_outtags: client: %s%s%s, message: %s",
+        weechat_printf (NULL, "%s: irc_outtags: server: %s, message: %s",
                         RELAY_PLUGIN_NAME,
-                        RELAY_COLOR_CHAT_CLIENT,
-                        client->desc,
-                        RELAY_COLOR_CHAT,
+                        server_name,
                         message);
     }
 
@@ -413,64 +668,85 @@ relay_irc_signal_irc_outtags_cb (void *data, const char *signal,
         ptr_message = pos + 1;
     }
 
-    /*
-     * We check if there is a tag "relay_client_NNN" and if NNN (numeric)
-     * is equal to current client, then we ignore message, because message
-     * was sent from this same client!
-     * This is to prevent message from being displayed twice on client.
-     */
-    if (relay_irc_tag_relay_client_id (tags) == client->id)
-        goto end;
+    client_id = relay_irc_tag_relay_client_id (tags);
 
-    hash_parsed = relay_irc_message_parse (ptr_message);
-    if (hash_parsed)
+    ptr_client = relay_clients;
+    while (ptr_client)
     {
-        irc_command = weechat_hashtable_get (hash_parsed, "command");
-        irc_args = weechat_hashtable_get (hash_parsed, "arguments");
+        ptr_next_client = ptr_client->next_client;
 
-        pos = strchr (irc_args, ' ');
-        irc_channel = (pos) ?
-            weechat_strndup (irc_args, pos - irc_args) : strdup (irc_args);
-
-        /* if command has to be relayed, relay it to client */
-        if (irc_command && irc_command[0]
-            && irc_channel && irc_channel[0]
-            && relay_irc_command_relayed (irc_command))
+        /*
+         * We check if there is a tag "relay_client_NNN" and if NNN (numeric)
+         * is equal to current client, then we ignore message, because message
+         * was sent from this same client!
+         * This is to prevent message from being displayed twice on client.
+         */
+        if (relay_irc_client_on_server (ptr_client, server_name)
+            && (client_id != ptr_client->id)
+            && RELAY_IRC_DATA(ptr_client, nick))
         {
-            /* get host for nick (it is self nick) */
-            snprintf (str_infolist_args, sizeof (str_infolist_args),
-                      "%s,%s,%s",
-                      client->protocol_args,
-                      irc_channel,
-                      RELAY_IRC_DATA(client, nick));
-
-            host = NULL;
-            infolist_nick = weechat_infolist_get ("irc_nick", NULL,
-                                                  str_infolist_args);
-            if (infolist_nick && weechat_infolist_next (infolist_nick))
-                host = weechat_infolist_string (infolist_nick, "host");
+            /* parse message only once, for first client on server */
+            if (relayed < 0)
+            {
+                relayed = 0;
+                hash_parsed = relay_irc_message_parse (ptr_message);
+                if (!hash_parsed)
+                    break;
+                irc_command = weechat_hashtable_get (hash_parsed, "command");
+                irc_args = weechat_hashtable_get (hash_parsed, "arguments");
+                if (irc_args)
+                {
+                    pos = strchr (irc_args, ' ');
+                    irc_channel = (pos) ?
+                        weechat_strndup (irc_args, pos - irc_args) :
+                        strdup (irc_args);
+                }
+                /* check if command has to be relayed to clients */
+                relayed = (irc_command && irc_command[0]
+                           && irc_channel && irc_channel[0]
+                           && relay_irc_command_relayed (irc_command)) ? 1 : 0;
+            }
+            if (!relayed)
+                break;
 
-            /* send message to client */
-            relay_irc_sendf (client,
-                             ":%s%s%s %s",
-                             RELAY_IRC_DATA(client, nick),
-                             (host && host[0]) ? "!" : "",
-                             (host && host[0]) ? host : "",
-                             ptr_message);
+            /* get prefix again only if nick of client is different */
+            if (!prefix_nick
+                || (strcmp (prefix_nick, RELAY_IRC_DATA(ptr_client, nick)) != 0))
+            {
+                if (prefix)
+                    free (prefix);
+                if (prefix_nick)
+                    free (prefix_nick);
+                prefix_nick = strdup (RELAY_IRC_DATA(ptr_client, nick));
+                prefix = relay_irc_get_self_prefix (ptr_client, irc_channel);
+            }
 
-            if (infolist_nick)
-                weechat_infolist_free (infolist_nick);
+            /* send message to client */
+            if (prefix)
+            {
+                relay_irc_shared_msg_send (ptr_client, &shared_msg,
+                                           prefix, ptr_message);
+            }
         }
-        if (irc_channel)
-            free (irc_channel);
-        weechat_hashtable_free (hash_parsed);
+
+        ptr_client = ptr_next_client;
     }
 
 end:
+    relay_irc_shared_msg_free (&shared_msg);
+    if (prefix)
+        free (prefix);
+    if (prefix_nick)
+        free (prefix_nick);
+    if (irc_channel)
+        free (irc_channel);
+    if (hash_parsed)
+        weechat_hashtable_free (hash_parsed);
     if (message)
         free (message);
     if (tags)
         free (tags);
+    free (server_name);
 
     return WEECHAT_RC_OK;
 }
@@ -1153,41 +1429,141 @@ relay_irc_input_send (struct t_relay_client *client, const char *irc_channel,
 }
 
 /*
- * Hooks signals for a client.
+ * Frees an IRC server structure (value of hashtable "relay_irc_servers").
  */
 
 void
-relay_irc_hook_signals (struct t_relay_client *client)
+relay_irc_server_free_value_cb (struct t_hashtable *hashtable,
+                                const void *key, void *value)
 {
+    struct t_relay_irc_server *ptr_server;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    ptr_server = (struct t_relay_irc_server *)value;
+
+    if (ptr_server->hook_signal_irc_in2)
+        weechat_unhook (ptr_server->hook_signal_irc_in2);
+    if (ptr_server->hook_signal_irc_outtags)
+        weechat_unhook (ptr_server->hook_signal_irc_outtags);
+    if (ptr_server->name)
+        free (ptr_server->name);
+
+    free (ptr_server);
+}
+
+/*
+ * Hooks signals "irc_in2" and "irc_outtags" for an IRC server (if not already
+ * hooked by another client on this server).
+ *
+ * Returns pointer to IRC server structure, NULL if error.
+ */
+
+struct t_relay_irc_server *
+relay_irc_server_hook_signals (const char *server)
+{
+    struct t_relay_irc_server *ptr_server;
     char str_signal_name[128];
 
-    /* do nothing if "protocol_args" (irc server name) is not yet initialized */
-    if (!client->protocol_args)
-        return;
+    if (!relay_irc_servers)
+    {
+        relay_irc_servers = weechat_hashtable_new (32,
+                                                   WEECHAT_HASHTABLE_STRING,
+                                                   WEECHAT_HASHTABLE_POINTER,
+                                                   NULL,
+                                                   NULL);
+        if (!relay_irc_servers)
+            return NULL;
+        weechat_hashtable_set_pointer (relay_irc_servers,
+                                       "callback_free_value",
+                                       &relay_irc_server_free_value_cb);
+    }
+
+    ptr_server = weechat_hashtable_get (relay_irc_servers, server);
+    if (ptr_server)
+        return ptr_server;
+
+    ptr_server = malloc (sizeof (*ptr_server));
+    if (!ptr_server)
+        return NULL;
+    ptr_server->name = strdup (server);
 
     /*
      * hook signal "xxx,irc_in2_*" to catch IRC data received from
      * this server
      */
     snprintf (str_signal_name, sizeof (str_signal_name),
-              "%s,irc_in2_*",
-              client->protocol_args);
-    RELAY_IRC_DATA(client, hook_signal_irc_in2) =
+              "%s,irc_in2_*", server);
+    ptr_server->hook_signal_irc_in2 =
         weechat_hook_signal (str_signal_name,
                              &relay_irc_signal_irc_in2_cb,
-                             client);
+                             ptr_server);
 
     /*
      * hook signal "xxx,irc_outtags_*" to catch IRC data sent to
      * this server
      */
     snprintf (str_signal_name, sizeof (str_signal_name),
-              "%s,irc_outtags_*",
-              client->protocol_args);
-    RELAY_IRC_DATA(client, hook_signal_irc_outtags) =
+              "%s,irc_outtags_*", server);
+    ptr_server->hook_signal_irc_outtags =
         weechat_hook_signal (str_signal_name,
                              &relay_irc_signal_irc_outtags_cb,
-                             client);
+                             ptr_server);
+
+    weechat_hashtable_set (relay_irc_servers, server, ptr_server);
+
+    return ptr_server;
+}
+
+/*
+ * Unhooks signals for an IRC server if there are no more clients on this
+ * server.
+ */
+
+void
+relay_irc_server_unhook_signals (const char *server)
+{
+    struct t_relay_client *ptr_client;
+
+    if (!relay_irc_servers || !server)
+        return;
+
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if (relay_irc_client_on_server (ptr_client, server))
+            return;
+    }
+
+    weechat_hashtable_remove (relay_irc_servers, server);
+
+    if (weechat_hashtable_get_integer (relay_irc_servers, "items_count") == 0)
+    {
+        weechat_hashtable_free (relay_irc_servers);
+        relay_irc_servers = NULL;
+    }
+}
+
+/*
+ * Hooks signals for a client.
+ */
+
+void
+relay_irc_hook_signals (struct t_relay_client *client)
+{
+    /* do nothing if "protocol_args" (irc server name) is not yet initialized */
+    if (!client->protocol_args)
+        return;
+
+    /*
+     * hook signals "xxx,irc_in2_*" and "xxx,irc_outtags_*" (only once for
+     * all clients on this server)
+     */
+    if (!relay_irc_server_hook_signals (client->protocol_args))
+        return;
+    RELAY_IRC_DATA(client, server_messages) = 1;
 
     /*
      * hook signal "irc_server_disconnected" to disconnect client if
@@ -1765,15 +2141,10 @@ relay_irc_close_connection (struct t_relay_client *client)
         weechat_unhook (RELAY_IRC_DATA(client, hook_timer_signals_joins));
         RELAY_IRC_DATA(client, hook_timer_signals_joins) = NULL;
     }
-    if (RELAY_IRC_DATA(client, hook_signal_irc_in2))
-    {
-        weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_in2));
-        RELAY_IRC_DATA(client, hook_signal_irc_in2) = NULL;
-    }
-    if (RELAY_IRC_DATA(client, hook_signal_irc_outtags))
+    if (RELAY_IRC_DATA(client, server_messages))
     {
-        weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_outtags));
-        RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
+        RELAY_IRC_DATA(client, server_messages) = 0;
+        relay_irc_server_unhook_signals (client->protocol_args);
     }
     if (RELAY_IRC_DATA(client, hook_signal_irc_disc))
     {
@@ -1810,8 +2181,7 @@ relay_irc_alloc (struct t_relay_client *client)
         RELAY_IRC_DATA(client, connected) = 0;
         RELAY_IRC_DATA(client, server_capabilities) = 0;
         RELAY_IRC_DATA(client, hook_timer_signals_joins) = NULL;
-        RELAY_IRC_DATA(client, hook_signal_irc_in2) = NULL;
-        RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
+        RELAY_IRC_DATA(client, server_messages) = 0;
         RELAY_IRC_DATA(client, hook_signal_irc_disc) = NULL;
         RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
     }
@@ -1845,17 +2215,11 @@ relay_irc_alloc_with_infolist (struct t_relay_client *client,
         RELAY_IRC_DATA(client, connected) = weechat_infolist_integer (infolist, "connected");
         RELAY_IRC_DATA(client, server_capabilities) = weechat_infolist_integer (infolist, "server_capabilities");
         RELAY_IRC_DATA(client, hook_timer_signals_joins) = NULL;
+        RELAY_IRC_DATA(client, server_messages) = 0;
+        RELAY_IRC_DATA(client, hook_signal_irc_disc) = NULL;
+        RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
         if (RELAY_IRC_DATA(client, connected))
-        {
             relay_irc_hook_signals (client);
-        }
-        else
-        {
-            RELAY_IRC_DATA(client, hook_signal_irc_in2) = NULL;
-            RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
-            RELAY_IRC_DATA(client, hook_signal_irc_disc) = NULL;
-            RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
-        }
     }
 }
 
@@ -1866,6 +2230,8 @@ relay_irc_alloc_with_infolist (struct t_relay_client *client,
 void
 relay_irc_free (struct t_relay_client *client)
 {
+    int server_messages;
+
     if (client->protocol_data)
     {
         if (RELAY_IRC_DATA(client, address))
@@ -1874,18 +2240,19 @@ relay_irc_free (struct t_relay_client *client)
             free (RELAY_IRC_DATA(client, nick));
         if (RELAY_IRC_DATA(client, hook_timer_signals_joins))
             weechat_unhook (RELAY_IRC_DATA(client, hook_timer_signals_joins));
-        if (RELAY_IRC_DATA(client, hook_signal_irc_in2))
-            weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_in2));
-        if (RELAY_IRC_DATA(client, hook_signal_irc_outtags))
-            weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_outtags));
         if (RELAY_IRC_DATA(client, hook_signal_irc_disc))
             weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_disc));
         if (RELAY_IRC_DATA(client, hook_hsignal_irc_redir))
             weechat_unhook (RELAY_IRC_DATA(client, hook_hsignal_irc_redir));
 
+        server_messages = RELAY_IRC_DATA(client, server_messages);
+
         free (client->protocol_data);
 
         client->protocol_data = NULL;
+
+        if (server_messages)
+            relay_irc_server_unhook_signals (client->protocol_args);
     }
 }
 
@@ -1918,9 +2285,7 @@ relay_irc_add_to_infolist (struct t_infolist_item *item,
         return 0;
     if (!weechat_infolist_new_var_pointer (item, "hook_timer_signals_joins", RELAY_IRC_DATA(client, hook_timer_signals_joins)))
         return 0;
-    if (!weechat_infolist_new_var_pointer (item, "hook_signal_irc_in2", RELAY_IRC_DATA(client, hook_signal_irc_in2)))
-        return 0;
-    if (!weechat_infolist_new_var_pointer (item, "hook_signal_irc_outtags", RELAY_IRC_DATA(client, hook_signal_irc_outtags)))
+    if (!weechat_infolist_new_var_integer (item, "server_messages", RELAY_IRC_DATA(client, server_messages)))
         return 0;
     if (!weechat_infolist_new_var_pointer (item, "hook_signal_irc_disc", RELAY_IRC_DATA(client, hook_signal_irc_disc)))
         return 0;
@@ -1946,8 +2311,7 @@ relay_irc_print_log (struct t_relay_client *client)
         weechat_log_printf ("    connected . . . . . . . : %d",    RELAY_IRC_DATA(client, connected));
         weechat_log_printf ("    server_capabilities . . : %d",    RELAY_IRC_DATA(client, server_capabilities));
         weechat_log_printf ("    hook_timer_signals_joins: 0x%lx", RELAY_IRC_DATA(client, hook_timer_signals_joins));
-        weechat_log_printf ("    hook_signal_irc_in2 . . : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_in2));
-        weechat_log_printf ("    hook_signal_irc_outtags : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_outtags));
+        weechat_log_printf ("    server_messages . . . . : %d",    RELAY_IRC_DATA(client, server_messages));
         weechat_log_printf ("    hook_signal_irc_disc. . : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_disc));
         weechat_log_printf ("    hook_hsignal_irc_redir. : 0x%lx", RELAY_IRC_DATA(client, hook_hsignal_irc_redir));
     }
@@ -38,12 +38,33 @@ struct t_relay_irc_data
                                        /* bit per capability)               */
     struct t_hook *hook_timer_signals_joins;/* timer to hooks signals and   */
                                             /* send joins to client         */
-    struct t_hook *hook_signal_irc_in2;     /* signal "irc_in2"             */
-    struct t_hook *hook_signal_irc_outtags; /* signal "irc_outtags"         */
+    int server_messages;               /* 1 if messages from/to IRC server  */
+                                       /* are relayed to client             */
     struct t_hook *hook_signal_irc_disc;    /* signal "irc_disconnected"    */
     struct t_hook *hook_hsignal_irc_redir;  /* hsignal "irc_redirection_..."*/
 };
 
+/*
+ * IRC server with relay clients: signals "irc_in2" and "irc_outtags" are
+ * hooked only once for all clients on this server
+ */
+
+struct t_relay_irc_server
+{
+    char *name;                             /* IRC server name              */
+    struct t_hook *hook_signal_irc_in2;     /* signal "irc_in2"             */
+    struct t_hook *hook_signal_irc_outtags; /* signal "irc_outtags"         */
+};
+
+/* message sent to many clients (built once, split and ready to send) */
+
+struct t_relay_irc_shared_msg
+{
+    char *prefix;                      /* prefix used to build messages     */
+    int count;                         /* number of messages                */
+    char **messages;                   /* messages (with final "\r\n")      */
+};
+
 enum t_relay_irc_command
 {
     RELAY_IRC_CMD_JOIN = 0,
@@ -62,6 +83,8 @@ enum t_relay_irc_server_capab
     RELAY_IRC_NUM_CAPAB,
 };
 
+extern struct t_hashtable *relay_irc_servers;
+
 extern void relay_irc_recv (struct t_relay_client *client,
                             const char *data);
 extern void relay_irc_close_connection (struct t_relay_client *client);
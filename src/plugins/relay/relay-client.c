@@ -25,6 +25,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <time.h>
+#include <sys/time.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -62,6 +63,8 @@ struct t_relay_client *relay_clients = NULL;
 struct t_relay_client *last_relay_client = NULL;
 int relay_client_count = 0;            /* number of clients                 */
 
+struct t_memory_tag *relay_client_memory_tag_outqueue = NULL;
+
 
 /*
  * Checks if a client pointer is valid.
@@ -262,180 +265,293 @@ relay_client_handshake_timer_cb (void *data, int remaining_calls)
 #endif
 
 /*
- * Reads text data from a client: splits data on '\n' and keep a partial message
- * if date  does not end with '\n'.
+ * Allocates receive buffer of client, so that at least "size" bytes (plus a
+ * final '\0') can be added after data already in buffer.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
  */
 
-void
-relay_client_recv_text (struct t_relay_client *client, const char *data)
+int
+relay_client_recv_buffer_alloc (struct t_relay_client *client, int size)
 {
-    char *new_partial, *raw_msg, **lines, *pos, *tmp, *handshake;
-    int i, num_lines, length, rc;
+    char *new_buffer;
+    int new_size;
+
+    if (client->recv_buffer_length + size + 1 <= client->recv_buffer_size)
+        return 1;
 
-    if (client->partial_message)
+    new_size = (client->recv_buffer_size > 0) ?
+        client->recv_buffer_size : RELAY_CLIENT_RECV_SIZE + 1;
+    while (new_size < client->recv_buffer_length + size + 1)
     {
-        new_partial = realloc (client->partial_message,
-                               strlen (client->partial_message) +
-                               strlen (data) + 1);
-        if (!new_partial)
-            return;
-        client->partial_message = new_partial;
-        strcat (client->partial_message, data);
+        new_size *= 2;
     }
-    else
-        client->partial_message = strdup (data);
 
-    pos = strrchr (client->partial_message, '\n');
-    if (pos)
+    new_buffer = realloc (client->recv_buffer, new_size);
+    if (!new_buffer)
+        return 0;
+    client->recv_buffer = new_buffer;
+    client->recv_buffer_size = new_size;
+
+    return 1;
+}
+
+/*
+ * Reads text data from a client: splits data on '\n' and processes each
+ * complete line.
+ *
+ * Lines are processed in place (the '\n' are replaced by '\0'), data after
+ * the last '\n' is not processed: it is a partial message that must be kept
+ * by caller until the end of line is received.
+ *
+ * Note: byte at data[length] must be writable (it is temporarily modified).
+ *
+ * Returns the number of bytes processed (0 if no complete line was found), or
+ * -1 if all data received must be discarded (after websocket handshake).
+ */
+
+int
+relay_client_recv_text (struct t_relay_client *client, char *data, int length)
+{
+    char *ptr_line, *pos, *pos_last, *handshake, saved_char;
+    int length_line, rc;
+
+    pos_last = NULL;
+    for (pos = data + length - 1; pos >= data; pos--)
     {
-        /* print message in raw buffer */
-        raw_msg = weechat_strndup (client->partial_message,
-                                   pos - client->partial_message + 1);
-        if (raw_msg)
+        if (pos[0] == '\n')
         {
-            relay_raw_print (client, RELAY_RAW_FLAG_RECV,
-                             raw_msg, strlen (raw_msg) + 1);
-            free (raw_msg);
+            pos_last = pos;
+            break;
         }
+    }
+    if (!pos_last)
+        return 0;
+
+    /* print message in raw buffer */
+    saved_char = pos_last[1];
+    pos_last[1] = '\0';
+    relay_raw_print (client, RELAY_RAW_FLAG_RECV, data, pos_last - data + 2);
+    pos_last[1] = saved_char;
 
+    ptr_line = data;
+    while (ptr_line <= pos_last)
+    {
+        pos = memchr (ptr_line, '\n', pos_last - ptr_line + 1);
         pos[0] = '\0';
 
-        lines = weechat_string_split (client->partial_message, "\n",
-                                      0, 0, &num_lines);
-        if (lines)
+        /* remove final '\r' */
+        length_line = pos - ptr_line;
+        if ((length_line > 0) && (ptr_line[length_line - 1] == '\r'))
+            ptr_line[length_line - 1] = '\0';
+
+        /* if websocket is initializing */
+        if (client->websocket == 1)
         {
-            for (i = 0; i < num_lines; i++)
+            if (ptr_line[0])
             {
-                /* remove final '\r' */
-                length = strlen (lines[i]);
-                if ((length > 0) && (lines[i][length - 1] == '\r'))
-                    lines[i][length - 1] = '\0';
-
-                /* if websocket is initializing */
-                if (client->websocket == 1)
+                /* web socket is initializing, read HTTP headers */
+                relay_websocket_save_header (client, ptr_line);
+            }
+            else
+            {
+                /*
+                 * empty line means that we have received all HTTP
+                 * headers: then we check the validity of websocket, and
+                 * if it is OK, we'll do the handshake and answer to the
+                 * client
+                 */
+                rc = relay_websocket_client_handshake_valid (client);
+                if (rc == 0)
                 {
-                    if (lines[i][0])
-                    {
-                        /* web socket is initializing, read HTTP headers */
-                        relay_websocket_save_header (client, lines[i]);
-                    }
-                    else
+                    /* handshake from client is valid */
+                    handshake  = relay_websocket_build_handshake (client);
+                    if (handshake)
                     {
-                        /*
-                         * empty line means that we have received all HTTP
-                         * headers: then we check the validity of websocket, and
-                         * if it is OK, we'll do the handshake and answer to the
-                         * client
-                         */
-                        rc = relay_websocket_client_handshake_valid (client);
-                        if (rc == 0)
-                        {
-                            /* handshake from client is valid */
-                            handshake  = relay_websocket_build_handshake (client);
-                            if (handshake)
-                            {
-                                relay_client_send (client, handshake,
-                                                   strlen (handshake), NULL);
-                                free (handshake);
-                                client->websocket = 2;
-                            }
-                        }
-                        else
-                        {
-                            switch (rc)
-                            {
-                                case -1:
-                                    relay_websocket_send_http (client,
-                                                               "400 Bad Request");
-                                    if (weechat_relay_plugin->debug >= 1)
-                                    {
-                                        weechat_printf_tags (NULL, "relay_client",
-                                                             _("%s%s: invalid websocket "
-                                                               "handshake received for "
-                                                               "client %s%s%s"),
-                                                             weechat_prefix ("error"),
-                                                             RELAY_PLUGIN_NAME,
-                                                             RELAY_COLOR_CHAT_CLIENT,
-                                                             client->desc,
-                                                             RELAY_COLOR_CHAT);
-                                    }
-                                    break;
-                                case -2:
-                                    relay_websocket_send_http (client,
-                                                               "403 Forbidden");
-                                    if (weechat_relay_plugin->debug >= 1)
-                                    {
-                                        weechat_printf_tags (NULL, "relay_client",
-                                                             _("%s%s: origin \"%s\" "
-                                                               "not allowed for websocket"),
-                                                             weechat_prefix ("error"),
-                                                             RELAY_PLUGIN_NAME,
-                                                             weechat_hashtable_get (client->http_headers,
-                                                                                    "Origin"));
-                                    }
-                                    break;
-                            }
-                            relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                        }
-
-                        /* remove HTTP headers */
-                        weechat_hashtable_free (client->http_headers);
-                        client->http_headers = NULL;
-
-                        /*
-                         * discard all received data after the handshake
-                         * received from client, and return immediately
-                         */
-                        free (client->partial_message);
-                        client->partial_message = NULL;
-                        weechat_string_free_split (lines);
-                        return;
+                        relay_client_send (client, handshake,
+                                           strlen (handshake), NULL);
+                        free (handshake);
+                        client->websocket = 2;
                     }
                 }
                 else
                 {
-                    /* receive text from client */
-                    switch (client->protocol)
+                    switch (rc)
                     {
-                        case RELAY_PROTOCOL_WEECHAT:
-                            relay_weechat_recv (client, lines[i]);
-                            break;
-                        case RELAY_PROTOCOL_IRC:
-                            relay_irc_recv (client, lines[i]);
+                        case -1:
+                            relay_websocket_send_http (client,
+                                                       "400 Bad Request");
+                            if (weechat_relay_plugin->debug >= 1)
+                            {
+                                weechat_printf_tags (NULL, "relay_client",
+                                                     _("%s%s: invalid websocket "
+                                                       "handshake received for "
+                                                       "client %s%s%s"),
+                                                     weechat_prefix ("error"),
+                                                     RELAY_PLUGIN_NAME,
+                                                     RELAY_COLOR_CHAT_CLIENT,
+                                                     client->desc,
+                                                     RELAY_COLOR_CHAT);
+                            }
                             break;
-                        case RELAY_NUM_PROTOCOLS:
+                        case -2:
+                            relay_websocket_send_http (client,
+                                                       "403 Forbidden");
+                            if (weechat_relay_plugin->debug >= 1)
+                            {
+                                weechat_printf_tags (NULL, "relay_client",
+                                                     _("%s%s: origin \"%s\" "
+                                                       "not allowed for websocket"),
+                                                     weechat_prefix ("error"),
+                                                     RELAY_PLUGIN_NAME,
+                                                     weechat_hashtable_get (client->http_headers,
+                                                                            "Origin"));
+                            }
                             break;
                     }
+                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
                 }
+
+                /* remove HTTP headers */
+                weechat_hashtable_free (client->http_headers);
+                client->http_headers = NULL;
+
+                /*
+                 * discard all received data after the handshake
+                 * received from client, and return immediately
+                 */
+                return -1;
             }
-            weechat_string_free_split (lines);
         }
-        if (pos[1])
+        else
         {
-            tmp = strdup (pos + 1);
-            free (client->partial_message);
-            client->partial_message = tmp;
+            /* receive text from client */
+            switch (client->protocol)
+            {
+                case RELAY_PROTOCOL_WEECHAT:
+                    relay_weechat_recv (client, ptr_line);
+                    break;
+                case RELAY_PROTOCOL_IRC:
+                    relay_irc_recv (client, ptr_line);
+                    break;
+                case RELAY_NUM_PROTOCOLS:
+                    break;
+            }
         }
-        else
+
+        ptr_line = pos + 1;
+    }
+
+    return pos_last - data + 1;
+}
+
+/*
+ * Processes data in receive buffer of client.
+ *
+ * The receive buffer contains a partial text message (not yet terminated by
+ * '\n'), followed by data received and not yet processed. For a websocket,
+ * the frames are decoded in place, right after the partial text message, and
+ * a partial frame at the end of buffer is kept for next call.
+ *
+ * Processed data is removed from buffer, only the partial text message and
+ * the partial websocket frame are kept.
+ */
+
+void
+relay_client_recv_buffer (struct t_relay_client *client)
+{
+    char *ptr_text;
+    int rc, length_text, length_processed, start_frame, length_frame;
+    unsigned long long decoded_length, used_length;
+
+    ptr_text = client->recv_buffer;
+    length_text = client->recv_buffer_length;
+    start_frame = client->recv_buffer_length;
+    length_frame = 0;
+
+    if (client->websocket == 2)
+    {
+        /* websocket used, decode complete frames (in place) */
+        rc = relay_websocket_decode_frame (
+            (unsigned char *)ptr_text + client->recv_partial_length,
+            (unsigned long long)(client->recv_buffer_length - client->recv_partial_length),
+            (unsigned char *)ptr_text + client->recv_partial_length,
+            &decoded_length,
+            &used_length);
+        if (!rc)
         {
-            free (client->partial_message);
-            client->partial_message = NULL;
+            /* error when decoding frame: close connection */
+            weechat_printf_tags (NULL, "relay_client",
+                                 _("%s%s: error decoding websocket frame "
+                                   "for client %s%s%s"),
+                                 weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+                                 RELAY_COLOR_CHAT_CLIENT,
+                                 client->desc,
+                                 RELAY_COLOR_CHAT);
+            relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+            return;
         }
+        length_text = client->recv_partial_length + (int)decoded_length;
+        start_frame = client->recv_partial_length + (int)used_length;
+        length_frame = client->recv_buffer_length - start_frame;
+    }
+
+    if ((client->websocket == 1)
+        || (client->recv_data_type == RELAY_CLIENT_DATA_TEXT))
+    {
+        /* websocket initializing or text data for this client */
+        length_processed = relay_client_recv_text (client, ptr_text,
+                                                   length_text);
+        if (length_processed < 0)
+        {
+            client->recv_buffer_length = 0;
+            client->recv_partial_length = 0;
+            return;
+        }
+    }
+    else
+    {
+        /* receive buffer as-is (binary data) */
+        /* currently, all supported protocols receive only text, no binary */
+        length_processed = length_text;
     }
+
+    /* keep partial text message, followed by partial websocket frame */
+    if (length_processed > 0)
+    {
+        memmove (ptr_text, ptr_text + length_processed,
+                 length_text - length_processed);
+    }
+    if ((length_frame > 0) && (start_frame != length_text - length_processed))
+    {
+        memmove (ptr_text + length_text - length_processed,
+                 ptr_text + start_frame,
+                 length_frame);
+    }
+    client->recv_partial_length = length_text - length_processed;
+    client->recv_buffer_length = client->recv_partial_length + length_frame;
 }
 
 /*
  * Reads data from a client.
+ *
+ * Data is read until there is nothing more to read on socket (EAGAIN) or
+ * RELAY_CLIENT_RECV_MAX_PER_CALL bytes are read (the remaining data is read
+ * on next call, so that other clients and WeeChat are not blocked), and
+ * processed after each read.
+ *
+ * The client is disconnected if a message longer than
+ * RELAY_CLIENT_RECV_BUFFER_MAX bytes is received.
  */
 
 int
 relay_client_recv_cb (void *arg_client, int fd)
 {
     struct t_relay_client *client;
-    static char buffer[4096], decoded[4096 + 1];
-    const char *ptr_buffer;
-    int num_read, rc;
-    unsigned long long decoded_length;
+    char *ptr_buffer;
+    int num_read, data_received, bytes_read;
 
     /* make C compiler happy */
     (void) fd;
@@ -445,135 +561,145 @@ relay_client_recv_cb (void *arg_client, int fd)
     if (client->status != RELAY_STATUS_CONNECTED)
         return WEECHAT_RC_OK;
 
-#ifdef HAVE_GNUTLS
-    if (client->ssl)
-        num_read = gnutls_record_recv (client->gnutls_sess, buffer,
-                                       sizeof (buffer) - 1);
-    else
-#endif
-        num_read = recv (client->sock, buffer, sizeof (buffer) - 1, 0);
+    data_received = 0;
+    bytes_read = 0;
 
-    if (num_read > 0)
+    while (client->status == RELAY_STATUS_CONNECTED)
     {
-        buffer[num_read] = '\0';
-        ptr_buffer = buffer;
-
-        /*
-         * if we are receiving the first message from client, check if it looks
-         * like a websocket
-         */
-        if (client->bytes_recv == 0)
+        if (bytes_read >= RELAY_CLIENT_RECV_MAX_PER_CALL)
         {
-            if (relay_websocket_is_http_get_weechat (buffer))
-            {
-                /*
-                 * web socket is just initializing for now, it's not accepted
-                 * (we will check later with "http_headers" if web socket is
-                 * valid or not)
-                 */
-                client->websocket = 1;
-                client->http_headers = weechat_hashtable_new (32,
-                                                              WEECHAT_HASHTABLE_STRING,
-                                                              WEECHAT_HASHTABLE_STRING,
-                                                              NULL,
-                                                              NULL);
-            }
+#ifdef HAVE_GNUTLS
+            /*
+             * data already decrypted by gnutls must be read now (the socket
+             * may have nothing more to read)
+             */
+            if (!client->ssl
+                || (gnutls_record_check_pending (client->gnutls_sess) == 0))
+                break;
+#else
+            break;
+#endif
         }
 
-        client->bytes_recv += num_read;
-
-        if (client->websocket == 2)
+        if (client->recv_buffer_length + RELAY_CLIENT_RECV_SIZE + 1 >
+            RELAY_CLIENT_RECV_BUFFER_MAX)
         {
-            /* websocket used, decode message */
-            rc = relay_websocket_decode_frame ((unsigned char *)buffer,
-                                               (unsigned long long)num_read,
-                                               (unsigned char *)decoded,
-                                               &decoded_length);
-            if (decoded_length == 0)
-            {
-                /*
-                 * When decoded length is 0, assume client sent a PONG frame.
-                 *
-                 * RFC 6455 Section 5.5.3:
-                 *
-                 *   "A Pong frame MAY be sent unsolicited.  This serves as a
-                 *   unidirectional heartbeat.  A response to an unsolicited
-                 *   Pong
-                 *   frame is not expected."
-                 */
-                return WEECHAT_RC_OK;
-            }
-            if (!rc)
-            {
-                /* error when decoding frame: close connection */
-                weechat_printf_tags (NULL, "relay_client",
-                                     _("%s%s: error decoding websocket frame "
-                                       "for client %s%s%s"),
-                                     weechat_prefix ("error"), RELAY_PLUGIN_NAME,
-                                     RELAY_COLOR_CHAT_CLIENT,
-                                     client->desc,
-                                     RELAY_COLOR_CHAT);
-                relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                return WEECHAT_RC_OK;
-            }
-            ptr_buffer = decoded;
+            weechat_printf_tags (NULL, "relay_client",
+                                 _("%s%s: message too long received from "
+                                   "client %s%s%s (more than %d bytes)"),
+                                 weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+                                 RELAY_COLOR_CHAT_CLIENT,
+                                 client->desc,
+                                 RELAY_COLOR_CHAT,
+                                 RELAY_CLIENT_RECV_BUFFER_MAX);
+            relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+            break;
         }
 
-        if ((client->websocket == 1)
-            || (client->recv_data_type == RELAY_CLIENT_DATA_TEXT))
+        if (!relay_client_recv_buffer_alloc (client, RELAY_CLIENT_RECV_SIZE))
         {
-            /* websocket initializing or text data for this client */
-            relay_client_recv_text (client, ptr_buffer);
-        }
-        else
-        {
-            /* receive buffer as-is (binary data) */
-            /* currently, all supported protocols receive only text, no binary */
+            weechat_printf_tags (NULL, "relay_client",
+                                 _("%s%s: not enough memory for received "
+                                   "data of client %s%s%s"),
+                                 weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+                                 RELAY_COLOR_CHAT_CLIENT,
+                                 client->desc,
+                                 RELAY_COLOR_CHAT);
+            relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+            break;
         }
-        relay_buffer_refresh (NULL);
-    }
-    else
-    {
+
+        ptr_buffer = client->recv_buffer + client->recv_buffer_length;
+
 #ifdef HAVE_GNUTLS
         if (client->ssl)
+            num_read = gnutls_record_recv (client->gnutls_sess, ptr_buffer,
+                                           RELAY_CLIENT_RECV_SIZE);
+        else
+#endif
+            num_read = recv (client->sock, ptr_buffer,
+                             RELAY_CLIENT_RECV_SIZE, 0);
+
+        if (num_read > 0)
         {
-            if ((num_read == 0)
-                || ((num_read != GNUTLS_E_AGAIN) && (num_read != GNUTLS_E_INTERRUPTED)))
+            ptr_buffer[num_read] = '\0';
+            data_received = 1;
+
+            /*
+             * if we are receiving the first message from client, check if it
+             * looks like a websocket
+             */
+            if (client->bytes_recv == 0)
             {
-                weechat_printf_tags (NULL, "relay_client",
-                                     _("%s%s: reading data on socket for "
-                                       "client %s%s%s: error %d %s"),
-                                     weechat_prefix ("error"), RELAY_PLUGIN_NAME,
-                                     RELAY_COLOR_CHAT_CLIENT,
-                                     client->desc,
-                                     RELAY_COLOR_CHAT,
-                                     num_read,
-                                     (num_read == 0) ? _("(connection closed by peer)") :
-                                     gnutls_strerror (num_read));
-                relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                if (relay_websocket_is_http_get_weechat (ptr_buffer))
+                {
+                    /*
+                     * web socket is just initializing for now, it's not
+                     * accepted (we will check later with "http_headers" if web
+                     * socket is valid or not)
+                     */
+                    client->websocket = 1;
+                    client->http_headers = weechat_hashtable_new (32,
+                                                                  WEECHAT_HASHTABLE_STRING,
+                                                                  WEECHAT_HASHTABLE_STRING,
+                                                                  NULL,
+                                                                  NULL);
+                }
             }
+
+            client->bytes_recv += num_read;
+            client->recv_buffer_length += num_read;
+            bytes_read += num_read;
+
+            relay_client_recv_buffer (client);
         }
         else
-#endif
         {
-            if ((num_read == 0)
-                || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+#ifdef HAVE_GNUTLS
+            if (client->ssl)
             {
-                weechat_printf_tags (NULL, "relay_client",
-                                     _("%s%s: reading data on socket for "
-                                       "client %s%s%s: error %d %s"),
-                                     weechat_prefix ("error"), RELAY_PLUGIN_NAME,
-                                     RELAY_COLOR_CHAT_CLIENT,
-                                     client->desc,
-                                     RELAY_COLOR_CHAT,
-                                     errno,
-                                     (num_read == 0) ? _("(connection closed by peer)") :
-                                     strerror (errno));
-                relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                if ((num_read == 0)
+                    || ((num_read != GNUTLS_E_AGAIN) && (num_read != GNUTLS_E_INTERRUPTED)))
+                {
+                    weechat_printf_tags (NULL, "relay_client",
+                                         _("%s%s: reading data on socket for "
+                                           "client %s%s%s: error %d %s"),
+                                         weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+                                         RELAY_COLOR_CHAT_CLIENT,
+                                         client->desc,
+                                         RELAY_COLOR_CHAT,
+                                         num_read,
+                                         (num_read == 0) ? _("(connection closed by peer)") :
+                                         gnutls_strerror (num_read));
+                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                }
+            }
+            else
+#endif
+            {
+                if ((num_read == 0)
+                    || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+                {
+                    weechat_printf_tags (NULL, "relay_client",
+                                         _("%s%s: reading data on socket for "
+                                           "client %s%s%s: error %d %s"),
+                                         weechat_prefix ("error"), RELAY_PLUGIN_NAME,
+                                         RELAY_COLOR_CHAT_CLIENT,
+                                         client->desc,
+                                         RELAY_COLOR_CHAT,
+                                         errno,
+                                         (num_read == 0) ? _("(connection closed by peer)") :
+                                         strerror (errno));
+                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                }
             }
+            break;
         }
     }
 
+    if (data_received)
+        relay_buffer_refresh (NULL);
+
     return WEECHAT_RC_OK;
 }
 
@@ -593,13 +719,16 @@ relay_client_outqueue_add (struct t_relay_client *client,
     if (!client || !data || (data_size <= 0))
         return;
 
-    new_outqueue = malloc (sizeof (*new_outqueue));
+    new_outqueue = weechat_memory_malloc (relay_client_memory_tag_outqueue,
+                                          sizeof (*new_outqueue));
     if (new_outqueue)
     {
-        new_outqueue->data = malloc (data_size);
+        new_outqueue->data = weechat_memory_malloc (
+            relay_client_memory_tag_outqueue, data_size);
         if (!new_outqueue->data)
         {
-            free (new_outqueue);
+            weechat_memory_free (relay_client_memory_tag_outqueue,
+                                 new_outqueue);
             return;
         }
         memcpy (new_outqueue->data, data, data_size);
@@ -611,7 +740,8 @@ relay_client_outqueue_add (struct t_relay_client *client,
             new_outqueue->raw_size[i] = 0;
             if (raw_message && raw_message[i] && (raw_size[i] > 0))
             {
-                new_outqueue->raw_message[i] = malloc (raw_size[i]);
+                new_outqueue->raw_message[i] = weechat_memory_malloc (
+                    relay_client_memory_tag_outqueue, raw_size[i]);
                 if (new_outqueue->raw_message[i])
                 {
                     new_outqueue->raw_flags[i] = raw_flags[i];
@@ -658,12 +788,18 @@ relay_client_outqueue_free (struct t_relay_client *client,
 
     /* free data */
     if (outqueue->data)
-        free (outqueue->data);
+        weechat_memory_free (relay_client_memory_tag_outqueue, outqueue->data);
     if (outqueue->raw_message[0])
-        free (outqueue->raw_message[0]);
+    {
+        weechat_memory_free (relay_client_memory_tag_outqueue,
+                             outqueue->raw_message[0]);
+    }
     if (outqueue->raw_message[1])
-        free (outqueue->raw_message[1]);
-    free (outqueue);
+    {
+        weechat_memory_free (relay_client_memory_tag_outqueue,
+                             outqueue->raw_message[1]);
+    }
+    weechat_memory_free (relay_client_memory_tag_outqueue, outqueue);
 
     /* set new head */
     client->outqueue = new_outqueue;
@@ -692,8 +828,8 @@ relay_client_outqueue_free_all (struct t_relay_client *client)
  */
 
 int
-relay_client_send (struct t_relay_client *client, const char *data,
-                   int data_size, const char *message_raw_buffer)
+relay_client_send_data (struct t_relay_client *client, const char *data,
+                        int data_size, const char *message_raw_buffer)
 {
     int num_sent, raw_size[2], raw_flags[2], i;
     char *websocket_frame;
@@ -870,6 +1006,33 @@ relay_client_send (struct t_relay_client *client, const char *data,
     return num_sent;
 }
 
+/*
+ * Sends data to client (see function relay_client_send_data), measures time
+ * spent in function if profiling is enabled.
+ *
+ * Returns number of bytes sent to client, -1 if error.
+ */
+
+int
+relay_client_send (struct t_relay_client *client, const char *data,
+                   int data_size, const char *message_raw_buffer)
+{
+    struct timeval tv_start;
+    int rc;
+
+    if (!relay_profile)
+    {
+        return relay_client_send_data (client, data, data_size,
+                                       message_raw_buffer);
+    }
+
+    gettimeofday (&tv_start, NULL);
+    rc = relay_client_send_data (client, data, data_size, message_raw_buffer);
+    relay_profile_add (RELAY_PROFILE_CLIENT_SEND, &tv_start);
+
+    return rc;
+}
+
 /*
  * Timer callback, called each second.
  */
@@ -939,7 +1102,8 @@ relay_client_timer_cb (void *data, int remaining_calls)
                                              ptr_client->outqueue->raw_message[i],
                                              ptr_client->outqueue->raw_size[i]);
                             ptr_client->outqueue->raw_flags[i] = 0;
-                            free (ptr_client->outqueue->raw_message[i]);
+                            weechat_memory_free (relay_client_memory_tag_outqueue,
+                                                 ptr_client->outqueue->raw_message[i]);
                             ptr_client->outqueue->raw_message[i] = NULL;
                             ptr_client->outqueue->raw_size[i] = 0;
                         }
@@ -963,13 +1127,16 @@ relay_client_timer_cb (void *data, int remaining_calls)
                          */
                         if (num_sent > 0)
                         {
-                            buf = malloc (ptr_client->outqueue->data_size - num_sent);
+                            buf = weechat_memory_malloc (
+                                relay_client_memory_tag_outqueue,
+                                ptr_client->outqueue->data_size - num_sent);
                             if (buf)
                             {
                                 memcpy (buf,
                                         ptr_client->outqueue->data + num_sent,
                                         ptr_client->outqueue->data_size - num_sent);
-                                free (ptr_client->outqueue->data);
+                                weechat_memory_free (relay_client_memory_tag_outqueue,
+                                                     ptr_client->outqueue->data);
                                 ptr_client->outqueue->data = buf;
                                 ptr_client->outqueue->data_size = ptr_client->outqueue->data_size - num_sent;
                             }
@@ -1092,7 +1259,10 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
                 new_client->send_data_type = RELAY_CLIENT_DATA_TEXT;
                 break;
         }
-        new_client->partial_message = NULL;
+        new_client->recv_buffer = NULL;
+        new_client->recv_buffer_size = 0;
+        new_client->recv_buffer_length = 0;
+        new_client->recv_partial_length = 0;
 
         relay_client_set_desc (new_client);
 
@@ -1219,6 +1389,8 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
 {
     struct t_relay_client *new_client;
     const char *str;
+    void *buf;
+    int length, size;
 
     new_client = malloc (sizeof (*new_client));
     if (new_client)
@@ -1259,8 +1431,26 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
                 "%llu", &(new_client->bytes_sent));
         new_client->recv_data_type = weechat_infolist_integer (infolist, "recv_data_type");
         new_client->send_data_type = weechat_infolist_integer (infolist, "send_data_type");
+        new_client->recv_buffer = NULL;
+        new_client->recv_buffer_size = 0;
+        new_client->recv_buffer_length = 0;
+        new_client->recv_partial_length = 0;
         str = weechat_infolist_string (infolist, "partial_message");
-        new_client->partial_message = (str) ? strdup (str) : NULL;
+        length = (str) ? strlen (str) : 0;
+        buf = weechat_infolist_buffer (infolist, "partial_ws_frame", &size);
+        if (!buf)
+            size = 0;
+        if (((length > 0) || (size > 0))
+            && relay_client_recv_buffer_alloc (new_client,
+                                               length + size))
+        {
+            if (length > 0)
+                memcpy (new_client->recv_buffer, str, length);
+            if (size > 0)
+                memcpy (new_client->recv_buffer + length, buf, size);
+            new_client->recv_partial_length = length;
+            new_client->recv_buffer_length = length + size;
+        }
 
         str = weechat_infolist_string (infolist, "desc");
         if (str)
@@ -1423,8 +1613,8 @@ relay_client_free (struct t_relay_client *client)
         weechat_hashtable_free (client->http_headers);
     if (client->hook_fd)
         weechat_unhook (client->hook_fd);
-    if (client->partial_message)
-        free (client->partial_message);
+    if (client->recv_buffer)
+        free (client->recv_buffer);
     if (client->protocol_data)
     {
         switch (client->protocol)
@@ -1508,7 +1698,8 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
                               struct t_relay_client *client)
 {
     struct t_infolist_item *ptr_item;
-    char value[128];
+    struct t_infolist_var *ptr_var;
+    char value[128], saved_char;
 
     if (!infolist || !client)
         return 0;
@@ -1565,8 +1756,28 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "send_data_type", client->send_data_type))
         return 0;
-    if (!weechat_infolist_new_var_string (ptr_item, "partial_message", client->partial_message))
-        return 0;
+    if (client->recv_buffer)
+    {
+        saved_char = client->recv_buffer[client->recv_partial_length];
+        client->recv_buffer[client->recv_partial_length] = '\0';
+        ptr_var = weechat_infolist_new_var_string (ptr_item, "partial_message",
+                                                   client->recv_buffer);
+        client->recv_buffer[client->recv_partial_length] = saved_char;
+        if (!ptr_var)
+            return 0;
+        if (client->recv_buffer_length > client->recv_partial_length)
+        {
+            if (!weechat_infolist_new_var_buffer (ptr_item, "partial_ws_frame",
+                                                  client->recv_buffer + client->recv_partial_length,
+                                                  client->recv_buffer_length - client->recv_partial_length))
+                return 0;
+        }
+    }
+    else
+    {
+        if (!weechat_infolist_new_var_string (ptr_item, "partial_message", NULL))
+            return 0;
+    }
 
     switch (client->protocol)
     {
@@ -1631,7 +1842,10 @@ relay_client_print_log ()
         weechat_log_printf ("  send_data_type. . . . : %d (%s)",
                             ptr_client->send_data_type,
                             relay_client_data_type_string[ptr_client->send_data_type]);
-        weechat_log_printf ("  partial_message . . . : '%s'",  ptr_client->partial_message);
+        weechat_log_printf ("  recv_buffer . . . . . : 0x%lx", ptr_client->recv_buffer);
+        weechat_log_printf ("  recv_buffer_size. . . : %d",   ptr_client->recv_buffer_size);
+        weechat_log_printf ("  recv_buffer_length. . : %d",   ptr_client->recv_buffer_length);
+        weechat_log_printf ("  recv_partial_length . : %d",   ptr_client->recv_partial_length);
         weechat_log_printf ("  protocol_data . . . . : 0x%lx", ptr_client->protocol_data);
         switch (ptr_client->protocol)
         {
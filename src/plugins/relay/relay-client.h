@@ -55,6 +55,18 @@ enum t_relay_client_data_type
     ((client->status == RELAY_STATUS_AUTH_FAILED) ||                    \
      (client->status == RELAY_STATUS_DISCONNECTED))
 
+/* size of data read on socket (receive buffer grows by this size) */
+
+#define RELAY_CLIENT_RECV_SIZE 4096
+
+/* max bytes read for a client in one call to receive callback */
+
+#define RELAY_CLIENT_RECV_MAX_PER_CALL (64 * 1024)
+
+/* max size of data received and not yet processed (partial message) */
+
+#define RELAY_CLIENT_RECV_BUFFER_MAX (1024 * 1024)
+
 /* output queue of messages to client */
 
 struct t_relay_client_outqueue
@@ -97,7 +109,12 @@ struct t_relay_client
     unsigned long long bytes_sent;     /* bytes sent to client              */
     enum t_relay_client_data_type recv_data_type; /* type recv from client  */
     enum t_relay_client_data_type send_data_type; /* type sent to client    */
-    char *partial_message;             /* partial text message received     */
+    char *recv_buffer;                 /* data received, not processed yet: */
+                                       /* partial text message, followed   */
+                                       /* by partial websocket frame       */
+    int recv_buffer_size;              /* allocated size of recv_buffer     */
+    int recv_buffer_length;            /* length of data in recv_buffer     */
+    int recv_partial_length;           /* length of partial text message    */
     void *protocol_data;               /* data depending on protocol used   */
     struct t_relay_client_outqueue *outqueue; /* queue for outgoing msgs    */
     struct t_relay_client_outqueue *last_outqueue; /* last outgoing msg     */
@@ -109,13 +126,23 @@ extern char *relay_client_status_string[];
 extern struct t_relay_client *relay_clients;
 extern struct t_relay_client *last_relay_client;
 extern int relay_client_count;
+extern struct t_memory_tag *relay_client_memory_tag_outqueue;
 
 extern int relay_client_valid (struct t_relay_client *client);
 extern struct t_relay_client *relay_client_search_by_number (int number);
 extern struct t_relay_client *relay_client_search_by_id (int id);
 extern int relay_client_status_search (const char *name);
 extern void relay_client_set_desc (struct t_relay_client *client);
+extern int relay_client_recv_buffer_alloc (struct t_relay_client *client,
+                                           int size);
+extern int relay_client_recv_text (struct t_relay_client *client,
+                                   char *data, int length);
+extern void relay_client_recv_buffer (struct t_relay_client *client);
 extern int relay_client_recv_cb (void *arg_client, int fd);
+extern int relay_client_send_data (struct t_relay_client *client,
+                                   const char *data,
+                                   int data_size,
+                                   const char *message_raw_buffer);
 extern int relay_client_send (struct t_relay_client *client, const char *data,
                               int data_size, const char *message_raw_buffer);
 extern int relay_client_timer_cb (void *data, int remaining_calls);
@@ -68,6 +68,11 @@ struct t_config_option *relay_config_irc_backlog_since_last_disconnect;
 struct t_config_option *relay_config_irc_backlog_tags;
 struct t_config_option *relay_config_irc_backlog_time_format;
 
+/* relay config, weechat section */
+
+struct t_config_option *relay_config_weechat_lines_batch_delay;
+struct t_config_option *relay_config_weechat_lines_batch_max;
+
 /* other */
 
 regex_t *relay_config_regex_allowed_ips = NULL;
@@ -710,6 +715,35 @@ relay_config_init ()
            "time in backlog messages"),
         NULL, 0, 0, "[%H:%M] ", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
 
+    /* section weechat */
+    ptr_section = weechat_config_new_section (relay_config_file, "weechat",
+                                              0, 0,
+                                              NULL, NULL, NULL, NULL,
+                                              NULL, NULL, NULL, NULL,
+                                              NULL, NULL);
+    if (!ptr_section)
+    {
+        weechat_config_free (relay_config_file);
+        return 0;
+    }
+
+    relay_config_weechat_lines_batch_delay = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "lines_batch_delay", "integer",
+        N_("delay (in milliseconds) before sending new lines to clients "
+           "synchronized with option \"batch\": all lines added during this "
+           "delay are sent in a single message"),
+        NULL, 1, 60000, "20", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_weechat_lines_batch_max = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "lines_batch_max", "integer",
+        N_("maximum number of lines in a single message sent to clients "
+           "synchronized with option \"batch\" (when this number is "
+           "reached, lines are sent immediately)"),
+        NULL, 1, 100000, "100", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
+
     /* section port */
     ptr_section = weechat_config_new_section (relay_config_file, "port",
                                               1, 1,
@@ -52,6 +52,9 @@ extern struct t_config_option *relay_config_irc_backlog_since_last_disconnect;
 extern struct t_config_option *relay_config_irc_backlog_tags;
 extern struct t_config_option *relay_config_irc_backlog_time_format;
 
+extern struct t_config_option *relay_config_weechat_lines_batch_delay;
+extern struct t_config_option *relay_config_weechat_lines_batch_max;
+
 extern regex_t *relay_config_regex_allowed_ips;
 extern regex_t *relay_config_regex_websocket_allowed_origins;
 extern struct t_hashtable *relay_config_hashtable_irc_backlog_tags;
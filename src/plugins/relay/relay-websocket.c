@@ -255,10 +255,20 @@ relay_websocket_send_http (struct t_relay_client *client,
 }
 
 /*
- * Decodes a websocket frame.
+ * Decodes websocket frames.
+ *
+ * Only complete frames are decoded: if the buffer ends with a partial frame
+ * (data not yet received), it is left as-is and "used_length" is set to the
+ * number of bytes of complete frames in buffer, so that the caller can keep
+ * the partial frame and decode it later, when more data is received.
+ *
+ * The payload of data frames is concatenated in "decoded" (which can be the
+ * same pointer as "buffer": decoded data is always shorter than the frames,
+ * so frames can be decoded in place). The payload of control frames
+ * (close, ping, pong) is ignored.
  *
  * Returns:
- *   1: frame decoded successfully
+ *   1: frame(s) decoded successfully
  *   0: error decoding frame (connection must be closed if it happens)
  */
 
@@ -266,16 +276,21 @@ int
 relay_websocket_decode_frame (const unsigned char *buffer,
                               unsigned long long buffer_length,
                               unsigned char *decoded,
-                              unsigned long long *decoded_length)
+                              unsigned long long *decoded_length,
+                              unsigned long long *used_length)
 {
     unsigned long long i, index_buffer, length_frame_size, length_frame;
+    unsigned char opcode, masks[4];
 
     *decoded_length = 0;
+    *used_length = 0;
     index_buffer = 0;
 
-    /* loop to decode all frames in message */
+    /* loop to decode all complete frames in message */
     while (index_buffer + 2 <= buffer_length)
     {
+        opcode = buffer[index_buffer] & 15;
+
         /*
          * check if frame is masked: client MUST send a masked frame; if frame is
          * not masked, we MUST reject it and close the connection (see RFC 6455)
@@ -284,14 +299,13 @@ relay_websocket_decode_frame (const unsigned char *buffer,
             return 0;
 
         /* decode frame */
-        length_frame_size = 1;
         length_frame = buffer[index_buffer + 1] & 127;
         index_buffer += 2;
         if ((length_frame == 126) || (length_frame == 127))
         {
             length_frame_size = (length_frame == 126) ? 2 : 8;
-            if (buffer_length < 1 + length_frame_size)
-                return 0;
+            if (index_buffer + length_frame_size > buffer_length)
+                break;
             length_frame = 0;
             for (i = 0; i < length_frame_size; i++)
             {
@@ -300,25 +314,31 @@ relay_websocket_decode_frame (const unsigned char *buffer,
             index_buffer += length_frame_size;
         }
 
-        if (buffer_length < 1 + length_frame_size + 4 + length_frame)
-            return 0;
+        /* partial frame? (wait for more data) */
+        if ((index_buffer + 4 > buffer_length)
+            || (length_frame > buffer_length - index_buffer - 4))
+        {
+            break;
+        }
 
         /* read masks (4 bytes) */
-        int masks[4];
         for (i = 0; i < 4; i++)
         {
-            masks[i] = (int)((unsigned char)buffer[index_buffer + i]);
+            masks[i] = buffer[index_buffer + i];
         }
         index_buffer += 4;
 
-        /* decode data using masks */
-        for (i = 0; i < length_frame; i++)
+        /* decode data using masks (only for data frames) */
+        if (!(opcode & 8))
         {
-            decoded[*decoded_length + i] = (int)((unsigned char)buffer[index_buffer + i]) ^ masks[i % 4];
+            for (i = 0; i < length_frame; i++)
+            {
+                decoded[*decoded_length + i] = buffer[index_buffer + i] ^ masks[i % 4];
+            }
+            *decoded_length += length_frame;
         }
-        decoded[*decoded_length + length_frame] = '\0';
-        *decoded_length += length_frame;
         index_buffer += length_frame;
+        *used_length = index_buffer;
     }
 
     return 1;
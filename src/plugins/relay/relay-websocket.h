@@ -28,9 +28,10 @@ extern char *relay_websocket_build_handshake (struct t_relay_client *client);
 extern void relay_websocket_send_http (struct t_relay_client *client,
                                        const char *http);
 extern int relay_websocket_decode_frame (const unsigned char *buffer,
-                                         unsigned long long length,
+                                         unsigned long long buffer_length,
                                          unsigned char *decoded,
-                                         unsigned long long *decoded_length);
+                                         unsigned long long *decoded_length,
+                                         unsigned long long *used_length);
 extern char *relay_websocket_encode_frame (struct t_relay_client *client,
                                            const char *buffer,
                                            unsigned long long length,
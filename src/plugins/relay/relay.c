@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "../weechat-plugin.h"
 #include "relay.h"
@@ -52,6 +53,10 @@ char *relay_protocol_string[] =        /* strings for protocols             */
 
 struct t_hook *relay_hook_timer = NULL;
 
+int relay_profile = 0;                 /* 1 to measure time spent in some   */
+                                       /* functions (used by benchmarks)    */
+struct t_relay_profile_counter relay_profile_counters[RELAY_NUM_PROFILE];
+
 
 /*
  * Searches for a protocol.
@@ -75,6 +80,22 @@ relay_protocol_search (const char *name)
     return -1;
 }
 
+/*
+ * Adds time spent in a function (since "tv_start") to the profile counter.
+ */
+
+void
+relay_profile_add (enum t_relay_profile profile, struct timeval *tv_start)
+{
+    struct timeval tv_end;
+
+    gettimeofday (&tv_end, NULL);
+    relay_profile_counters[profile].count++;
+    relay_profile_counters[profile].time +=
+        ((long long)(tv_end.tv_sec - tv_start->tv_sec) * 1000000)
+        + (tv_end.tv_usec - tv_start->tv_usec);
+}
+
 /*
  * Callback for signal "upgrade".
  */
@@ -190,6 +211,8 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     weechat_plugin = plugin;
 
+    relay_client_memory_tag_outqueue = weechat_memory_tag ("outqueue");
+
     if (!relay_config_init ())
         return WEECHAT_RC_ERROR;
 
@@ -20,6 +20,8 @@
 #ifndef WEECHAT_RELAY_H
 #define WEECHAT_RELAY_H 1
 
+struct timeval;
+
 #define weechat_plugin weechat_relay_plugin
 #define RELAY_PLUGIN_NAME "relay"
 
@@ -42,8 +44,28 @@ enum t_relay_protocol
 #define RELAY_COLOR_CHAT_BUFFER weechat_color("chat_buffer")
 #define RELAY_COLOR_CHAT_CLIENT weechat_color(weechat_config_string(relay_config_color_client))
 
+/* functions profiled (time spent in these functions) */
+
+enum t_relay_profile
+{
+    RELAY_PROFILE_CLIENT_SEND = 0,     /* relay_client_send                 */
+    RELAY_PROFILE_WEECHAT_MSG_SEND,    /* relay_weechat_msg_send            */
+    /* number of functions profiled */
+    RELAY_NUM_PROFILE,
+};
+
+struct t_relay_profile_counter
+{
+    long long count;                   /* number of calls                   */
+    long long time;                    /* total time (in microseconds)      */
+};
+
 extern char *relay_protocol_string[];
+extern int relay_profile;
+extern struct t_relay_profile_counter relay_profile_counters[];
 
 extern int relay_protocol_search (const char *name);
+extern void relay_profile_add (enum t_relay_profile profile,
+                               struct timeval *tv_start);
 
 #endif /* WEECHAT_RELAY_H */
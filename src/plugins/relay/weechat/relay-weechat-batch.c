@@ -0,0 +1,509 @@
+/*
+ * relay-weechat-batch.c - batched lines for WeeChat protocol
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../weechat-plugin.h"
+#include "../relay.h"
+#include "relay-weechat.h"
+#include "relay-weechat-batch.h"
+#include "relay-weechat-msg.h"
+#include "../relay-client.h"
+#include "../relay-config.h"
+
+
+/*
+ * Builds a new batch structure (to store lines waiting to be sent).
+ *
+ * Returns pointer to new batch structure, NULL if error.
+ */
+
+struct t_relay_weechat_batch *
+relay_weechat_batch_new ()
+{
+    struct t_relay_weechat_batch *new_batch;
+
+    new_batch = malloc (sizeof (*new_batch));
+    if (!new_batch)
+        return NULL;
+
+    new_batch->strings_index = weechat_hashtable_new (64,
+                                                      WEECHAT_HASHTABLE_STRING,
+                                                      WEECHAT_HASHTABLE_INTEGER,
+                                                      NULL,
+                                                      NULL);
+    if (!new_batch->strings_index)
+    {
+        free (new_batch);
+        return NULL;
+    }
+    new_batch->lines_count = 0;
+    new_batch->lines_size = 0;
+    new_batch->lines = NULL;
+    new_batch->strings_count = 0;
+    new_batch->strings_size = 0;
+    new_batch->strings = NULL;
+    new_batch->tags_count = 0;
+    new_batch->tags_size = 0;
+    new_batch->tags = NULL;
+
+    return new_batch;
+}
+
+/*
+ * Grows an array of a batch so that it can contain at least one more item
+ * (the size is doubled each time the array is full).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (not enough memory)
+ */
+
+int
+relay_weechat_batch_grow (void **array, int *size, int count, int item_size)
+{
+    void *new_array;
+    int new_size;
+
+    if (count < *size)
+        return 1;
+
+    new_size = (*size > 0) ? *size * 2 : 32;
+    new_array = realloc (*array, new_size * item_size);
+    if (!new_array)
+        return 0;
+
+    *array = new_array;
+    *size = new_size;
+
+    return 1;
+}
+
+/*
+ * Interns a string in a batch: each string is stored only once in batch and
+ * sent only once in message.
+ *
+ * Returns index of string in batch, -1 if string is NULL (or error).
+ */
+
+int
+relay_weechat_batch_intern (struct t_relay_weechat_batch *batch,
+                            const char *string)
+{
+    int *ptr_index, index;
+
+    if (!string)
+        return -1;
+
+    ptr_index = weechat_hashtable_get (batch->strings_index, string);
+    if (ptr_index)
+        return *ptr_index;
+
+    if (!relay_weechat_batch_grow ((void **)&batch->strings,
+                                   &batch->strings_size,
+                                   batch->strings_count,
+                                   sizeof (*batch->strings)))
+    {
+        return -1;
+    }
+    batch->strings[batch->strings_count] = strdup (string);
+    if (!batch->strings[batch->strings_count])
+        return -1;
+    index = batch->strings_count;
+    if (!weechat_hashtable_set (batch->strings_index, string, &index))
+    {
+        free (batch->strings[batch->strings_count]);
+        return -1;
+    }
+    batch->strings_count++;
+
+    return index;
+}
+
+/*
+ * Adds a line in a batch (tags are added after with function
+ * relay_weechat_batch_add_tag).
+ *
+ * Returns pointer to line added, NULL if error.
+ */
+
+struct t_relay_weechat_batch_line *
+relay_weechat_batch_add_line (struct t_relay_weechat_batch *batch,
+                              struct t_gui_buffer *buffer,
+                              time_t date, time_t date_printed,
+                              int displayed, int highlight,
+                              const char *prefix, const char *message)
+{
+    struct t_relay_weechat_batch_line *ptr_line;
+
+    if (!batch)
+        return NULL;
+
+    if (!relay_weechat_batch_grow ((void **)&batch->lines,
+                                   &batch->lines_size,
+                                   batch->lines_count,
+                                   sizeof (*batch->lines)))
+    {
+        return NULL;
+    }
+
+    ptr_line = &(batch->lines[batch->lines_count]);
+    ptr_line->buffer = buffer;
+    ptr_line->date = date;
+    ptr_line->date_printed = date_printed;
+    ptr_line->displayed = (char)displayed;
+    ptr_line->highlight = (char)highlight;
+    ptr_line->tags_count = 0;
+    ptr_line->prefix = relay_weechat_batch_intern (batch, prefix);
+    ptr_line->message = (message) ? strdup (message) : NULL;
+    batch->lines_count++;
+
+    return ptr_line;
+}
+
+/*
+ * Adds a tag to the last line added in batch.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_weechat_batch_add_tag (struct t_relay_weechat_batch *batch,
+                             const char *tag)
+{
+    int index;
+
+    if (!batch || (batch->lines_count == 0) || !tag)
+        return 0;
+
+    index = relay_weechat_batch_intern (batch, tag);
+    if (index < 0)
+        return 0;
+
+    if (!relay_weechat_batch_grow ((void **)&batch->tags,
+                                   &batch->tags_size,
+                                   batch->tags_count,
+                                   sizeof (*batch->tags)))
+    {
+        return 0;
+    }
+    batch->tags[batch->tags_count] = index;
+    batch->tags_count++;
+    batch->lines[batch->lines_count - 1].tags_count++;
+
+    return 1;
+}
+
+/*
+ * Adds type of elements and number of elements of an array to a message.
+ */
+
+void
+relay_weechat_batch_add_array (struct t_relay_weechat_msg *msg,
+                               const char *type, int count)
+{
+    relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_ARRAY);
+    relay_weechat_msg_add_type (msg, type);
+    relay_weechat_msg_add_int (msg, count);
+}
+
+/*
+ * Adds lines of a batch to a message: the schema (names and types of
+ * columns), the number of lines, then one array for each column (see
+ * RELAY_WEECHAT_BATCH_SCHEMA).
+ */
+
+void
+relay_weechat_batch_add_to_msg (struct t_relay_weechat_msg *msg,
+                                struct t_relay_weechat_batch *batch)
+{
+    int i;
+
+    relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_STRING);
+    relay_weechat_msg_add_string (msg, RELAY_WEECHAT_BATCH_SCHEMA);
+
+    relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_INT);
+    relay_weechat_msg_add_int (msg, batch->lines_count);
+
+    /* strings */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_STRING,
+                                   batch->strings_count);
+    for (i = 0; i < batch->strings_count; i++)
+    {
+        relay_weechat_msg_add_string (msg, batch->strings[i]);
+    }
+
+    /* buffer */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_POINTER,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_pointer (msg, batch->lines[i].buffer);
+    }
+
+    /* date */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_TIME,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_time (msg, batch->lines[i].date);
+    }
+
+    /* date_printed */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_TIME,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_time (msg, batch->lines[i].date_printed);
+    }
+
+    /* displayed */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_CHAR,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_char (msg, batch->lines[i].displayed);
+    }
+
+    /* highlight */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_CHAR,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_char (msg, batch->lines[i].highlight);
+    }
+
+    /* tags_count */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_INT,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_int (msg, batch->lines[i].tags_count);
+    }
+
+    /* tags */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_INT,
+                                   batch->tags_count);
+    for (i = 0; i < batch->tags_count; i++)
+    {
+        relay_weechat_msg_add_int (msg, batch->tags[i]);
+    }
+
+    /* prefix */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_INT,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_int (msg, batch->lines[i].prefix);
+    }
+
+    /* message */
+    relay_weechat_batch_add_array (msg, RELAY_WEECHAT_MSG_OBJ_STRING,
+                                   batch->lines_count);
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        relay_weechat_msg_add_string (msg, batch->lines[i].message);
+    }
+}
+
+/*
+ * Removes all lines and strings from a batch (allocated arrays are kept for
+ * next lines).
+ */
+
+void
+relay_weechat_batch_clear (struct t_relay_weechat_batch *batch)
+{
+    int i;
+
+    if (!batch)
+        return;
+
+    for (i = 0; i < batch->lines_count; i++)
+    {
+        if (batch->lines[i].message)
+            free (batch->lines[i].message);
+    }
+    batch->lines_count = 0;
+
+    for (i = 0; i < batch->strings_count; i++)
+    {
+        free (batch->strings[i]);
+    }
+    batch->strings_count = 0;
+    weechat_hashtable_remove_all (batch->strings_index);
+
+    batch->tags_count = 0;
+}
+
+/*
+ * Frees a batch structure.
+ */
+
+void
+relay_weechat_batch_free (struct t_relay_weechat_batch *batch)
+{
+    if (!batch)
+        return;
+
+    relay_weechat_batch_clear (batch);
+
+    if (batch->lines)
+        free (batch->lines);
+    if (batch->strings)
+        free (batch->strings);
+    if (batch->tags)
+        free (batch->tags);
+    weechat_hashtable_free (batch->strings_index);
+
+    free (batch);
+}
+
+/*
+ * Callback for timer used to send lines of batch to a client.
+ */
+
+int
+relay_weechat_batch_timer_cb (void *data, int remaining_calls)
+{
+    struct t_relay_client *ptr_client;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    ptr_client = (struct t_relay_client *)data;
+    if (!ptr_client || !ptr_client->protocol_data)
+        return WEECHAT_RC_OK;
+
+    RELAY_WEECHAT_DATA(ptr_client, hook_timer_batch) = NULL;
+
+    relay_weechat_batch_flush (ptr_client);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Adds a line (pointer to "line_data") in batch of a client.
+ *
+ * Lines are sent when the batch is full (option relay.weechat.lines_batch_max)
+ * or when the timer expires (option relay.weechat.lines_batch_delay).
+ */
+
+void
+relay_weechat_batch_add_line_data (struct t_relay_client *client,
+                                   void *line_data)
+{
+    struct t_hdata *ptr_hdata;
+    struct t_relay_weechat_batch *ptr_batch;
+    int i, tags_count;
+    char name[64];
+
+    ptr_hdata = weechat_hdata_get ("line_data");
+    if (!ptr_hdata)
+        return;
+
+    if (!RELAY_WEECHAT_DATA(client, batch_lines))
+    {
+        RELAY_WEECHAT_DATA(client, batch_lines) = relay_weechat_batch_new ();
+        if (!RELAY_WEECHAT_DATA(client, batch_lines))
+            return;
+    }
+    ptr_batch = RELAY_WEECHAT_DATA(client, batch_lines);
+
+    if (!relay_weechat_batch_add_line (
+            ptr_batch,
+            weechat_hdata_pointer (ptr_hdata, line_data, "buffer"),
+            weechat_hdata_time (ptr_hdata, line_data, "date"),
+            weechat_hdata_time (ptr_hdata, line_data, "date_printed"),
+            weechat_hdata_char (ptr_hdata, line_data, "displayed"),
+            weechat_hdata_char (ptr_hdata, line_data, "highlight"),
+            weechat_hdata_string (ptr_hdata, line_data, "prefix"),
+            weechat_hdata_string (ptr_hdata, line_data, "message")))
+    {
+        return;
+    }
+
+    tags_count = weechat_hdata_get_var_array_size (ptr_hdata, line_data,
+                                                   "tags_array");
+    for (i = 0; i < tags_count; i++)
+    {
+        snprintf (name, sizeof (name), "%d|tags_array", i);
+        relay_weechat_batch_add_tag (ptr_batch,
+                                     weechat_hdata_string (ptr_hdata,
+                                                           line_data, name));
+    }
+
+    if (ptr_batch->lines_count >= weechat_config_integer (relay_config_weechat_lines_batch_max))
+    {
+        relay_weechat_batch_flush (client);
+    }
+    else if (!RELAY_WEECHAT_DATA(client, hook_timer_batch))
+    {
+        RELAY_WEECHAT_DATA(client, hook_timer_batch) =
+            weechat_hook_timer (weechat_config_integer (relay_config_weechat_lines_batch_delay),
+                                0, 1,
+                                &relay_weechat_batch_timer_cb,
+                                client);
+    }
+}
+
+/*
+ * Sends lines of batch to a client (in a single message
+ * "_buffer_lines_added").
+ *
+ * This is called before sending any other message to the client, so that
+ * messages are received in the same order as the events in WeeChat.
+ */
+
+void
+relay_weechat_batch_flush (struct t_relay_client *client)
+{
+    struct t_relay_weechat_batch *ptr_batch;
+    struct t_relay_weechat_msg *msg;
+
+    if (RELAY_WEECHAT_DATA(client, hook_timer_batch))
+    {
+        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_timer_batch));
+        RELAY_WEECHAT_DATA(client, hook_timer_batch) = NULL;
+    }
+
+    ptr_batch = RELAY_WEECHAT_DATA(client, batch_lines);
+    if (!ptr_batch || (ptr_batch->lines_count == 0))
+        return;
+
+    msg = relay_weechat_msg_new ("_buffer_lines_added");
+    if (msg)
+        relay_weechat_batch_add_to_msg (msg, ptr_batch);
+
+    /* the batch is cleared before sending, so it is not sent again */
+    relay_weechat_batch_clear (ptr_batch);
+
+    if (msg)
+    {
+        relay_weechat_msg_send (client, msg);
+        relay_weechat_msg_free (msg);
+    }
+}
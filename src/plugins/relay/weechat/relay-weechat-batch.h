@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_RELAY_WEECHAT_BATCH_H
+#define WEECHAT_RELAY_WEECHAT_BATCH_H 1
+
+#include <time.h>
+
+struct t_relay_client;
+struct t_relay_weechat_msg;
+
+/*
+ * columns sent in message "_buffer_lines_added" (after the number of lines),
+ * each column is an array: "strings" are interned strings (tags and
+ * prefixes), "tags" are indexes in "strings" ("tags_count" indexes for each
+ * line), "prefix" is an index in "strings" (-1 if line has no prefix)
+ */
+#define RELAY_WEECHAT_BATCH_SCHEMA                                      \
+    "strings:str,buffer:ptr,date:tim,date_printed:tim,displayed:chr,"   \
+    "highlight:chr,tags_count:int,tags:int,prefix:int,message:str"
+
+struct t_relay_weechat_batch_line
+{
+    struct t_gui_buffer *buffer;       /* buffer                            */
+    time_t date;                       /* date of line                      */
+    time_t date_printed;               /* date when line was printed        */
+    char displayed;                    /* 1 if line is displayed            */
+    char highlight;                    /* 1 if line has a highlight         */
+    int tags_count;                    /* number of tags of line            */
+    int prefix;                        /* index of prefix in "strings" of   */
+                                       /* batch (-1 if no prefix)           */
+    char *message;                     /* message                           */
+};
+
+/* lines waiting to be sent to a client, in a single message */
+
+struct t_relay_weechat_batch
+{
+    int lines_count;                   /* number of lines                   */
+    int lines_size;                    /* number of lines allocated         */
+    struct t_relay_weechat_batch_line *lines; /* lines                      */
+    struct t_hashtable *strings_index; /* index of interned strings         */
+                                       /* (key: string, value: index)       */
+    int strings_count;                 /* number of interned strings        */
+    int strings_size;                  /* number of strings allocated       */
+    char **strings;                    /* interned strings (tags/prefixes)  */
+    int tags_count;                    /* number of tags (for all lines)    */
+    int tags_size;                     /* number of tags allocated          */
+    int *tags;                         /* tags of lines (index in strings)  */
+};
+
+extern struct t_relay_weechat_batch *relay_weechat_batch_new ();
+extern struct t_relay_weechat_batch_line *relay_weechat_batch_add_line (struct t_relay_weechat_batch *batch,
+                                                                        struct t_gui_buffer *buffer,
+                                                                        time_t date,
+                                                                        time_t date_printed,
+                                                                        int displayed,
+                                                                        int highlight,
+                                                                        const char *prefix,
+                                                                        const char *message);
+extern int relay_weechat_batch_add_tag (struct t_relay_weechat_batch *batch,
+                                        const char *tag);
+extern void relay_weechat_batch_add_to_msg (struct t_relay_weechat_msg *msg,
+                                            struct t_relay_weechat_batch *batch);
+extern void relay_weechat_batch_clear (struct t_relay_weechat_batch *batch);
+extern void relay_weechat_batch_free (struct t_relay_weechat_batch *batch);
+extern void relay_weechat_batch_add_line_data (struct t_relay_client *client,
+                                               void *line_data);
+extern void relay_weechat_batch_flush (struct t_relay_client *client);
+
+#endif /* WEECHAT_RELAY_WEECHAT_BATCH_H */
@@ -33,6 +33,7 @@
 #include "../../weechat-plugin.h"
 #include "../relay.h"
 #include "relay-weechat.h"
+#include "relay-weechat-batch.h"
 #include "relay-weechat-msg.h"
 #include "relay-weechat-nicklist.h"
 #include "../relay-buffer.h"
@@ -850,8 +851,8 @@ relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
 /*
  * Adds nicklist for a buffer, as hdata object.
  *
- * Argument "nicklist" contains nicklist diffs. If it is NULL or don't have
- * items inside, full nicklist is sent.
+ * Argument "diffs" contains nicklist diffs to send (indexes of items in
+ * "nicklist"). If it is NULL, full nicklist is sent.
  *
  * Returns the number of nicks+groups added to message.
  */
@@ -859,30 +860,34 @@ relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
 int
 relay_weechat_msg_add_nicklist_buffer (struct t_relay_weechat_msg *msg,
                                        struct t_gui_buffer *buffer,
-                                       struct t_relay_weechat_nicklist *nicklist)
+                                       struct t_relay_weechat_nicklist *nicklist,
+                                       struct t_relay_weechat_nicklist_diff *diffs,
+                                       int diffs_count)
 {
     int count, i;
     struct t_hdata *ptr_hdata_group, *ptr_hdata_nick;
     struct t_gui_nick_group *ptr_group;
     struct t_gui_nick *ptr_nick;
+    struct t_relay_weechat_nicklist_item *ptr_item;
 
     count = 0;
 
-    if (nicklist)
+    if (nicklist && diffs)
     {
         /* send nicklist diffs */
-        for (i = 0; i < nicklist->items_count; i++)
+        for (i = 0; i < diffs_count; i++)
         {
+            ptr_item = &(nicklist->items[diffs[i].index]);
             relay_weechat_msg_add_pointer (msg, buffer);
-            relay_weechat_msg_add_pointer (msg, nicklist->items[i].pointer);
-            relay_weechat_msg_add_char (msg, nicklist->items[i].diff);
-            relay_weechat_msg_add_char (msg, nicklist->items[i].group);
-            relay_weechat_msg_add_char (msg, nicklist->items[i].visible);
-            relay_weechat_msg_add_int (msg, nicklist->items[i].level);
-            relay_weechat_msg_add_string (msg, nicklist->items[i].name);
-            relay_weechat_msg_add_string (msg, nicklist->items[i].color);
-            relay_weechat_msg_add_string (msg, nicklist->items[i].prefix);
-            relay_weechat_msg_add_string (msg, nicklist->items[i].prefix_color);
+            relay_weechat_msg_add_pointer (msg, ptr_item->pointer);
+            relay_weechat_msg_add_char (msg, diffs[i].diff);
+            relay_weechat_msg_add_char (msg, ptr_item->group);
+            relay_weechat_msg_add_char (msg, ptr_item->visible);
+            relay_weechat_msg_add_int (msg, ptr_item->level);
+            relay_weechat_msg_add_string (msg, ptr_item->name);
+            relay_weechat_msg_add_string (msg, ptr_item->color);
+            relay_weechat_msg_add_string (msg, ptr_item->prefix);
+            relay_weechat_msg_add_string (msg, ptr_item->prefix_color);
             count++;
         }
     }
@@ -960,14 +965,16 @@ relay_weechat_msg_add_nicklist_buffer (struct t_relay_weechat_msg *msg,
 /*
  * Adds nicklist for one or all buffers, as hdata object.
  *
- * Argument "nicklist" contains nicklist diffs. If it is NULL or don't have
- * items inside, full nicklist is sent.
+ * Argument "diffs" contains nicklist diffs to send (indexes of items in
+ * "nicklist"). If it is NULL, full nicklist is sent.
  */
 
 void
 relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
                                 struct t_gui_buffer *buffer,
-                                struct t_relay_weechat_nicklist *nicklist)
+                                struct t_relay_weechat_nicklist *nicklist,
+                                struct t_relay_weechat_nicklist_diff *diffs,
+                                int diffs_count)
 {
     char str_vars[512];
     struct t_hdata *ptr_hdata;
@@ -979,7 +986,7 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
               "%sgroup:chr,visible:chr,level:int,"
               "name:str,color:str,"
               "prefix:str,prefix_color:str",
-              (nicklist) ? "_diff:chr," : "");
+              (nicklist && diffs) ? "_diff:chr," : "");
 
     relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_HDATA);
     relay_weechat_msg_add_string (msg, "buffer/nicklist_item");
@@ -992,7 +999,8 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
 
     if (buffer)
     {
-        count += relay_weechat_msg_add_nicklist_buffer (msg, buffer, nicklist);
+        count += relay_weechat_msg_add_nicklist_buffer (msg, buffer, nicklist,
+                                                        diffs, diffs_count);
     }
     else
     {
@@ -1000,7 +1008,8 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
         ptr_buffer = weechat_hdata_get_list (ptr_hdata, "gui_buffers");
         while (ptr_buffer)
         {
-            count += relay_weechat_msg_add_nicklist_buffer (msg, ptr_buffer, NULL);
+            count += relay_weechat_msg_add_nicklist_buffer (msg, ptr_buffer,
+                                                            NULL, NULL, 0);
             ptr_buffer = weechat_hdata_move (ptr_hdata, ptr_buffer, 1);
         }
     }
@@ -1014,8 +1023,8 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
  */
 
 void
-relay_weechat_msg_send (struct t_relay_client *client,
-                        struct t_relay_weechat_msg *msg)
+relay_weechat_msg_send_data (struct t_relay_client *client,
+                             struct t_relay_weechat_msg *msg)
 {
     uint32_t size32;
     char compression, raw_message[1024];
@@ -1025,6 +1034,13 @@ relay_weechat_msg_send (struct t_relay_client *client,
     struct timeval tv1, tv2;
     long time_diff;
 
+    /* send lines waiting in batch first (to keep order of messages) */
+    if (client->protocol_data && RELAY_WEECHAT_DATA(client, batch_lines)
+        && (RELAY_WEECHAT_DATA(client, batch_lines)->lines_count > 0))
+    {
+        relay_weechat_batch_flush (client);
+    }
+
     if (weechat_config_integer (relay_config_network_compression_level) > 0)
     {
         switch (RELAY_WEECHAT_DATA(client, compression))
@@ -1085,6 +1101,28 @@ relay_weechat_msg_send (struct t_relay_client *client,
     relay_client_send (client, msg->data, msg->data_size, raw_message);
 }
 
+/*
+ * Sends a message (see function relay_weechat_msg_send_data), measures time
+ * spent in function if profiling is enabled.
+ */
+
+void
+relay_weechat_msg_send (struct t_relay_client *client,
+                        struct t_relay_weechat_msg *msg)
+{
+    struct timeval tv_start;
+
+    if (!relay_profile)
+    {
+        relay_weechat_msg_send_data (client, msg);
+        return;
+    }
+
+    gettimeofday (&tv_start, NULL);
+    relay_weechat_msg_send_data (client, msg);
+    relay_profile_add (RELAY_PROFILE_WEECHAT_MSG_SEND, &tv_start);
+}
+
 /*
  * Frees a message.
  */
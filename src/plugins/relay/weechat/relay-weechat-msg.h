@@ -21,6 +21,7 @@
 #define WEECHAT_RELAY_WEECHAT_MSG_H 1
 
 struct t_relay_weechat_nicklist;
+struct t_relay_weechat_nicklist_diff;
 
 #define RELAY_WEECHAT_MSG_INITIAL_ALLOC 4096
 
@@ -76,7 +77,11 @@ extern void relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
                                             const char *arguments);
 extern void relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
                                             struct t_gui_buffer *buffer,
-                                            struct t_relay_weechat_nicklist *nicklist);
+                                            struct t_relay_weechat_nicklist *nicklist,
+                                            struct t_relay_weechat_nicklist_diff *diffs,
+                                            int diffs_count);
+extern void relay_weechat_msg_send_data (struct t_relay_client *client,
+                                         struct t_relay_weechat_msg *msg);
 extern void relay_weechat_msg_send (struct t_relay_client *client,
                                     struct t_relay_weechat_msg *msg);
 extern void relay_weechat_msg_free (struct t_relay_weechat_msg *msg);
@@ -28,6 +28,10 @@
 #include "relay-weechat-nicklist.h"
 
 
+struct t_hashtable *relay_weechat_nicklists = NULL; /* nicklist diffs       */
+                                                    /* (key: buffer)        */
+
+
 /*
  * Builds a new nicklist structure (to store nicklist diffs).
  *
@@ -45,11 +49,70 @@ relay_weechat_nicklist_new ()
 
     new_nicklist->nicklist_count = 0;
     new_nicklist->items_count = 0;
+    new_nicklist->items_size = 0;
     new_nicklist->items = NULL;
 
     return new_nicklist;
 }
 
+/*
+ * Frees a value of hashtable "relay_weechat_nicklists".
+ */
+
+void
+relay_weechat_nicklist_free_value_cb (struct t_hashtable *hashtable,
+                                      const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    relay_weechat_nicklist_free ((struct t_relay_weechat_nicklist *)value);
+}
+
+/*
+ * Searches nicklist diffs of a buffer (shared by all clients).
+ *
+ * If "create" is 1 and nicklist diffs are not found, they are created.
+ *
+ * Returns pointer to nicklist diffs, NULL if not found (or error).
+ */
+
+struct t_relay_weechat_nicklist *
+relay_weechat_nicklist_search (struct t_gui_buffer *buffer, int create)
+{
+    struct t_relay_weechat_nicklist *ptr_nicklist;
+
+    if (!relay_weechat_nicklists)
+    {
+        if (!create)
+            return NULL;
+        relay_weechat_nicklists = weechat_hashtable_new (32,
+                                                         WEECHAT_HASHTABLE_POINTER,
+                                                         WEECHAT_HASHTABLE_POINTER,
+                                                         NULL,
+                                                         NULL);
+        if (!relay_weechat_nicklists)
+            return NULL;
+        weechat_hashtable_set_pointer (relay_weechat_nicklists,
+                                       "callback_free_value",
+                                       &relay_weechat_nicklist_free_value_cb);
+    }
+
+    ptr_nicklist = weechat_hashtable_get (relay_weechat_nicklists, buffer);
+    if (!ptr_nicklist && create)
+    {
+        ptr_nicklist = relay_weechat_nicklist_new ();
+        if (!ptr_nicklist)
+            return NULL;
+        ptr_nicklist->nicklist_count = weechat_buffer_get_integer (buffer,
+                                                                   "nicklist_count");
+        weechat_hashtable_set (relay_weechat_nicklists, buffer, ptr_nicklist);
+    }
+
+    return ptr_nicklist;
+}
+
 /*
  * Adds a nicklist item in nicklist structure.
  */
@@ -82,12 +145,18 @@ relay_weechat_nicklist_add_item (struct t_relay_weechat_nicklist *nicklist,
         }
     }
 
-    new_items = realloc (nicklist->items,
-                         (nicklist->items_count + 1) * sizeof (new_items[0]));
-    if (!new_items)
-        return;
+    if (nicklist->items_count >= nicklist->items_size)
+    {
+        new_items = realloc (nicklist->items,
+                             ((nicklist->items_size > 0) ?
+                              nicklist->items_size * 2 : 32) * sizeof (new_items[0]));
+        if (!new_items)
+            return;
+        nicklist->items = new_items;
+        nicklist->items_size = (nicklist->items_size > 0) ?
+            nicklist->items_size * 2 : 32;
+    }
 
-    nicklist->items = new_items;
     ptr_item = &(nicklist->items[nicklist->items_count]);
     if (group)
     {
@@ -115,6 +184,137 @@ relay_weechat_nicklist_add_item (struct t_relay_weechat_nicklist *nicklist,
     nicklist->items_count++;
 }
 
+/*
+ * Compacts nicklist items, starting at index "start": a group/nick added then
+ * removed is not sent at all, a group/nick changed many times is sent only
+ * once (with last values), and a group/nick added then changed is sent as
+ * added (with last values). Items for parent groups are sent only if needed.
+ *
+ * Argument "diffs" is set with an array of diffs to send (must be freed after
+ * use), it can be NULL if there is no diff at all.
+ *
+ * Returns number of diffs in array "diffs", -1 if error.
+ */
+
+int
+relay_weechat_nicklist_compact (struct t_relay_weechat_nicklist *nicklist,
+                                int start,
+                                struct t_relay_weechat_nicklist_diff **diffs)
+{
+    struct t_relay_weechat_nicklist_diff *items;
+    struct t_hashtable *last_diff;
+    int i, *parents, *ptr_pos, num_items, index_parent, count;
+    void *last_parent;
+
+    *diffs = NULL;
+
+    if (!nicklist || (start >= nicklist->items_count))
+        return 0;
+
+    /* compact items (without parent groups) */
+    items = malloc ((nicklist->items_count - start) * sizeof (items[0]));
+    parents = malloc ((nicklist->items_count - start) * sizeof (parents[0]));
+    last_diff = weechat_hashtable_new (32,
+                                       WEECHAT_HASHTABLE_POINTER,
+                                       WEECHAT_HASHTABLE_INTEGER,
+                                       NULL,
+                                       NULL);
+    if (!items || !parents || !last_diff)
+    {
+        if (items)
+            free (items);
+        if (parents)
+            free (parents);
+        if (last_diff)
+            weechat_hashtable_free (last_diff);
+        return -1;
+    }
+    num_items = 0;
+    index_parent = -1;
+    for (i = start; i < nicklist->items_count; i++)
+    {
+        if (nicklist->items[i].diff == RELAY_WEECHAT_NICKLIST_DIFF_PARENT)
+        {
+            index_parent = i;
+            continue;
+        }
+        ptr_pos = weechat_hashtable_get (last_diff, nicklist->items[i].pointer);
+        switch (nicklist->items[i].diff)
+        {
+            case RELAY_WEECHAT_NICKLIST_DIFF_ADDED:
+            case RELAY_WEECHAT_NICKLIST_DIFF_CHANGED:
+                if (ptr_pos)
+                {
+                    /* use last values for group/nick added or changed */
+                    items[*ptr_pos].index = i;
+                    break;
+                }
+                items[num_items].index = i;
+                items[num_items].diff = nicklist->items[i].diff;
+                parents[num_items] = index_parent;
+                weechat_hashtable_set (last_diff, nicklist->items[i].pointer,
+                                       &num_items);
+                num_items++;
+                break;
+            case RELAY_WEECHAT_NICKLIST_DIFF_REMOVED:
+                if (ptr_pos)
+                {
+                    /* group/nick added or changed, then removed */
+                    items[*ptr_pos].index = -1;
+                    if (items[*ptr_pos].diff == RELAY_WEECHAT_NICKLIST_DIFF_ADDED)
+                    {
+                        weechat_hashtable_remove (last_diff,
+                                                  nicklist->items[i].pointer);
+                        break;
+                    }
+                    weechat_hashtable_remove (last_diff,
+                                              nicklist->items[i].pointer);
+                }
+                items[num_items].index = i;
+                items[num_items].diff = nicklist->items[i].diff;
+                parents[num_items] = index_parent;
+                num_items++;
+                break;
+        }
+    }
+    weechat_hashtable_free (last_diff);
+
+    /* build diffs, with parent groups (only when parent changes) */
+    count = 0;
+    *diffs = malloc (num_items * 2 * sizeof ((*diffs)[0]));
+    if (*diffs)
+    {
+        last_parent = NULL;
+        for (i = 0; i < num_items; i++)
+        {
+            if (items[i].index < 0)
+                continue;
+            if ((parents[i] >= 0)
+                && (nicklist->items[parents[i]].pointer != last_parent))
+            {
+                (*diffs)[count].index = parents[i];
+                (*diffs)[count].diff = RELAY_WEECHAT_NICKLIST_DIFF_PARENT;
+                count++;
+                last_parent = nicklist->items[parents[i]].pointer;
+            }
+            (*diffs)[count] = items[i];
+            count++;
+        }
+        if (count == 0)
+        {
+            free (*diffs);
+            *diffs = NULL;
+        }
+    }
+    else
+        count = -1;
+
+    free (items);
+    free (parents);
+
+    return count;
+}
+
 /*
  * Frees a nicklist_item structure.
  */
@@ -153,3 +353,28 @@ relay_weechat_nicklist_free (struct t_relay_weechat_nicklist *nicklist)
 
     free (nicklist);
 }
+
+/*
+ * Removes nicklist diffs of a buffer.
+ */
+
+void
+relay_weechat_nicklist_remove (struct t_gui_buffer *buffer)
+{
+    if (relay_weechat_nicklists)
+        weechat_hashtable_remove (relay_weechat_nicklists, buffer);
+}
+
+/*
+ * Removes nicklist diffs of all buffers.
+ */
+
+void
+relay_weechat_nicklist_remove_all ()
+{
+    if (relay_weechat_nicklists)
+    {
+        weechat_hashtable_free (relay_weechat_nicklists);
+        relay_weechat_nicklists = NULL;
+    }
+}
@@ -39,19 +39,43 @@ struct t_relay_weechat_nicklist_item
     char *prefix_color;                /* color for prefix                  */
 };
 
+/*
+ * nicklist diffs of a buffer: this log is shared by all clients synchronized
+ * with nicklist of buffer, each client has its own position in the log
+ * (index of first item not yet sent to client)
+ */
+
 struct t_relay_weechat_nicklist
 {
     int nicklist_count;                /* number of nicks in nicklist       */
                                        /* before receiving first diff       */
     int items_count;                   /* number of nicklist items          */
+    int items_size;                    /* number of items allocated         */
     struct t_relay_weechat_nicklist_item *items; /* nicklist items          */
 };
 
+/* nicklist diff to send (after compaction of items in log) */
+
+struct t_relay_weechat_nicklist_diff
+{
+    int index;                         /* index of item in nicklist log     */
+    char diff;                         /* type of diff (see constants above)*/
+};
+
+extern struct t_hashtable *relay_weechat_nicklists;
+
 extern struct t_relay_weechat_nicklist *relay_weechat_nicklist_new ();
+extern struct t_relay_weechat_nicklist *relay_weechat_nicklist_search (struct t_gui_buffer *buffer,
+                                                                       int create);
 extern void relay_weechat_nicklist_add_item (struct t_relay_weechat_nicklist *nicklist,
                                              char diff,
                                              struct t_gui_nick_group *group,
                                              struct t_gui_nick *nick);
+extern int relay_weechat_nicklist_compact (struct t_relay_weechat_nicklist *nicklist,
+                                           int start,
+                                           struct t_relay_weechat_nicklist_diff **diffs);
 extern void relay_weechat_nicklist_free (struct t_relay_weechat_nicklist *nicklist);
+extern void relay_weechat_nicklist_remove (struct t_gui_buffer *buffer);
+extern void relay_weechat_nicklist_remove_all ();
 
 #endif /* WEECHAT_RELAY_WEECHAT_NICKLIST_H */
@@ -26,6 +26,7 @@
 #include "../../weechat-plugin.h"
 #include "../relay.h"
 #include "relay-weechat.h"
+#include "relay-weechat-batch.h"
 #include "relay-weechat-protocol.h"
 #include "relay-weechat-msg.h"
 #include "relay-weechat-nicklist.h"
@@ -35,6 +36,10 @@
 #include "../relay-raw.h"
 
 
+struct t_hashtable *relay_weechat_protocol_nicklist_msgs = NULL; /* nicklist */
+                                       /* msgs built when sending nicklist  */
+
+
 /*
  * Checks if the buffer pointer is a relay buffer (relay raw/list).
  *
@@ -107,6 +112,8 @@ relay_weechat_protocol_sync_flag (const char *flag)
         return RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS;
     if (strcmp (flag, "upgrade") == 0)
         return RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE;
+    if (strcmp (flag, "batch") == 0)
+        return RELAY_WEECHAT_PROTOCOL_SYNC_BATCH;
 
     /* unknown flag */
     return 0;
@@ -124,6 +131,7 @@ relay_weechat_protocol_sync_flag (const char *flag)
  *   RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST
  *   RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS
  *   RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE
+ *   RELAY_WEECHAT_PROTOCOL_SYNC_BATCH
  *
  * Returns:
  *   1: buffer is synchronized with at least one flag given
@@ -346,7 +354,7 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(nicklist)
     msg = relay_weechat_msg_new (id);
     if (msg)
     {
-        relay_weechat_msg_add_nicklist (msg, ptr_buffer, NULL);
+        relay_weechat_msg_add_nicklist (msg, ptr_buffer, NULL, NULL, 0);
         relay_weechat_msg_send (client, msg);
         relay_weechat_msg_free (msg);
     }
@@ -710,6 +718,13 @@ relay_weechat_protocol_signal_buffer_cb (void *data, const char *signal,
         if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
                                             RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
         {
+            /* with flag "batch", line is sent later with other lines */
+            if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
+                                                RELAY_WEECHAT_PROTOCOL_SYNC_BATCH))
+            {
+                relay_weechat_batch_add_line_data (ptr_client, ptr_line_data);
+                return WEECHAT_RC_OK;
+            }
             msg = relay_weechat_msg_new (str_signal);
             if (msg)
             {
@@ -731,6 +746,9 @@ relay_weechat_protocol_signal_buffer_cb (void *data, const char *signal,
         if (!ptr_buffer)
             return WEECHAT_RC_OK;
 
+        /* remove nicklist diffs of buffer (shared by all clients) */
+        relay_weechat_nicklist_remove (ptr_buffer);
+
         /* send signal only if sync with flag "buffers" or "buffer" */
         if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
                                             RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
@@ -757,6 +775,10 @@ relay_weechat_protocol_signal_buffer_cb (void *data, const char *signal,
 /*
  * Callback for entries in hashtable "buffers_nicklist" of client (sends
  * nicklist for each buffer in this hashtable).
+ *
+ * Messages are built only once for all clients: they are stored in hashtable
+ * "relay_weechat_protocol_nicklist_msgs" (key is buffer pointer + index of
+ * first diff for a diff, only buffer pointer for full nicklist).
  */
 
 void
@@ -768,48 +790,100 @@ relay_weechat_protocol_nicklist_map_cb (void *data,
     struct t_relay_client *ptr_client;
     struct t_gui_buffer *ptr_buffer;
     struct t_relay_weechat_nicklist *ptr_nicklist;
+    struct t_relay_weechat_nicklist_diff *diffs;
     struct t_hdata *ptr_hdata;
     struct t_relay_weechat_msg *msg;
+    char str_key[128];
+    int start, count;
 
     /* make C compiler happy */
     (void) hashtable;
 
     ptr_client = (struct t_relay_client *)data;
     ptr_buffer = (struct t_gui_buffer *)key;
-    ptr_nicklist = (struct t_relay_weechat_nicklist *)value;
+    start = *((int *)value);
 
     ptr_hdata = weechat_hdata_get ("buffer");
-    if (ptr_hdata)
-    {
-        if (weechat_hdata_check_pointer (ptr_hdata,
+    if (!ptr_hdata
+        || !weechat_hdata_check_pointer (ptr_hdata,
                                          weechat_hdata_get_list (ptr_hdata, "gui_buffers"),
                                          ptr_buffer))
+    {
+        return;
+    }
+
+    ptr_nicklist = relay_weechat_nicklist_search (ptr_buffer, 0);
+
+    /* diffs for this buffer/start already built for another client? */
+    snprintf (str_key, sizeof (str_key),
+              "0x%lx:%d", (long unsigned int)ptr_buffer, start);
+    msg = weechat_hashtable_get (relay_weechat_protocol_nicklist_msgs, str_key);
+    if (!msg)
+    {
+        diffs = NULL;
+        count = -1;
+        if (ptr_nicklist && (ptr_nicklist->items_count > 0))
         {
-            /*
-             * if no diff at all, or if diffs are bigger than nicklist:
-             * send whole nicklist
-             */
-            if (ptr_nicklist
-                && ((ptr_nicklist->items_count == 0)
-                    || (ptr_nicklist->items_count >= weechat_buffer_get_integer (ptr_buffer, "nicklist_count") + 1)))
+            count = relay_weechat_nicklist_compact (ptr_nicklist, start, &diffs);
+
+            /* nothing changed (for example nick added then removed) */
+            if (count == 0)
+                return;
+
+            /* if diffs are bigger than nicklist: send whole nicklist */
+            if (count >= weechat_buffer_get_integer (ptr_buffer, "nicklist_count") + 1)
             {
-                ptr_nicklist = NULL;
+                free (diffs);
+                diffs = NULL;
+                count = -1;
             }
+        }
 
-            /* send nicklist diffs or full nicklist */
-            msg = relay_weechat_msg_new ((ptr_nicklist) ? "_nicklist_diff" : "_nicklist");
+        if (count < 0)
+        {
+            /* send full nicklist (built only once for all clients) */
+            snprintf (str_key, sizeof (str_key),
+                      "0x%lx", (long unsigned int)ptr_buffer);
+            msg = weechat_hashtable_get (relay_weechat_protocol_nicklist_msgs,
+                                         str_key);
+        }
+        if (!msg)
+        {
+            msg = relay_weechat_msg_new ((diffs) ? "_nicklist_diff" : "_nicklist");
             if (msg)
             {
-                relay_weechat_msg_add_nicklist (msg, ptr_buffer, ptr_nicklist);
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
+                relay_weechat_msg_add_nicklist (msg, ptr_buffer,
+                                                ptr_nicklist, diffs, count);
+                weechat_hashtable_set (relay_weechat_protocol_nicklist_msgs,
+                                       str_key, msg);
             }
         }
+        if (diffs)
+            free (diffs);
     }
+
+    if (msg)
+        relay_weechat_msg_send (ptr_client, msg);
+}
+
+/*
+ * Frees a message in hashtable "relay_weechat_protocol_nicklist_msgs".
+ */
+
+void
+relay_weechat_protocol_nicklist_msg_free_cb (struct t_hashtable *hashtable,
+                                             const void *key, void *value)
+{
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    relay_weechat_msg_free ((struct t_relay_weechat_msg *)value);
 }
 
 /*
- * Callback for nicklist timer.
+ * Callback for nicklist timer: sends nicklist diffs (or full nicklist) to all
+ * clients, then clears nicklist diffs.
  */
 
 int
@@ -818,25 +892,51 @@ relay_weechat_protocol_timer_nicklist_cb (void *data, int remaining_calls)
     struct t_relay_client *ptr_client;
 
     /* make C compiler happy */
+    (void) data;
     (void) remaining_calls;
 
-    ptr_client = (struct t_relay_client *)data;
-    if (!ptr_client || !relay_client_valid (ptr_client))
+    relay_weechat_hook_nicklist_timer = NULL;
+
+    relay_weechat_protocol_nicklist_msgs = weechat_hashtable_new (32,
+                                                                  WEECHAT_HASHTABLE_STRING,
+                                                                  WEECHAT_HASHTABLE_POINTER,
+                                                                  NULL,
+                                                                  NULL);
+    if (!relay_weechat_protocol_nicklist_msgs)
         return WEECHAT_RC_OK;
+    weechat_hashtable_set_pointer (relay_weechat_protocol_nicklist_msgs,
+                                   "callback_free_value",
+                                   &relay_weechat_protocol_nicklist_msg_free_cb);
 
-    weechat_hashtable_map (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-                           &relay_weechat_protocol_nicklist_map_cb,
-                           ptr_client);
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if ((ptr_client->protocol != RELAY_PROTOCOL_WEECHAT)
+            || !ptr_client->protocol_data
+            || RELAY_CLIENT_HAS_ENDED(ptr_client))
+        {
+            continue;
+        }
+        weechat_hashtable_map (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                               &relay_weechat_protocol_nicklist_map_cb,
+                               ptr_client);
+        weechat_hashtable_remove_all (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist));
+    }
 
-    weechat_hashtable_remove_all (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist));
+    weechat_hashtable_free (relay_weechat_protocol_nicklist_msgs);
+    relay_weechat_protocol_nicklist_msgs = NULL;
 
-    RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist) = NULL;
+    /* all diffs have been sent to clients */
+    relay_weechat_nicklist_remove_all ();
 
     return WEECHAT_RC_OK;
 }
 
 /*
- * Callback for hsignals "nicklist_*".
+ * Callback for hsignals "nicklist_*" (hooked only once for all clients).
+ *
+ * Nicklist diffs are stored only once for all clients, and each client has
+ * the index of first diff to send in hashtable "buffers_nicklist".
  */
 
 int
@@ -850,16 +950,10 @@ relay_weechat_protocol_hsignal_nicklist_cb (void *data, const char *signal,
     struct t_relay_weechat_nicklist *ptr_nicklist;
     char diff;
 
-    ptr_client = (struct t_relay_client *)data;
-    if (!ptr_client || !relay_client_valid (ptr_client))
-        return WEECHAT_RC_OK;
+    /* make C compiler happy */
+    (void) data;
 
-    /* check if buffer is synchronized with flag "nicklist" */
     ptr_buffer = weechat_hashtable_get (hashtable, "buffer");
-    if (!relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                         RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
-        return WEECHAT_RC_OK;
-
     parent_group = weechat_hashtable_get (hashtable, "parent_group");
     group = weechat_hashtable_get (hashtable, "group");
     nick = weechat_hashtable_get (hashtable, "nick");
@@ -868,21 +962,6 @@ relay_weechat_protocol_hsignal_nicklist_cb (void *data, const char *signal,
     if (!parent_group)
         return WEECHAT_RC_OK;
 
-    ptr_nicklist = weechat_hashtable_get (RELAY_WEECHAT_DATA(ptr_client,
-                                                             buffers_nicklist),
-                                          ptr_buffer);
-    if (!ptr_nicklist)
-    {
-        ptr_nicklist = relay_weechat_nicklist_new ();
-        if (!ptr_nicklist)
-            return WEECHAT_RC_OK;
-        ptr_nicklist->nicklist_count = weechat_buffer_get_integer (ptr_buffer,
-                                                                   "nicklist_count");
-        weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-                               ptr_buffer,
-                               ptr_nicklist);
-    }
-
     /* set diff type */
     diff = RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN;
     if ((strcmp (signal, "nicklist_group_added") == 0)
@@ -901,30 +980,59 @@ relay_weechat_protocol_hsignal_nicklist_cb (void *data, const char *signal,
         diff = RELAY_WEECHAT_NICKLIST_DIFF_CHANGED;
     }
 
-    if (diff != RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+    if (diff == RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+        return WEECHAT_RC_OK;
+
+    /* check clients synchronized with flag "nicklist" for this buffer */
+    ptr_nicklist = NULL;
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
     {
-        /*
-         * add items if nicklist was not empty or very small (otherwise we will
-         * send full nicklist)
-         */
-        if (ptr_nicklist->nicklist_count > 1)
+        if ((ptr_client->protocol != RELAY_PROTOCOL_WEECHAT)
+            || !ptr_client->protocol_data
+            || RELAY_CLIENT_HAS_ENDED(ptr_client)
+            || !relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
+                                                RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
         {
-            /* add nicklist item for parent group and group/nick */
-            relay_weechat_nicklist_add_item (ptr_nicklist,
-                                             RELAY_WEECHAT_NICKLIST_DIFF_PARENT,
-                                             parent_group, NULL);
-            relay_weechat_nicklist_add_item (ptr_nicklist, diff, group, nick);
+            continue;
         }
-
-        /* add timer to send nicklist */
-        if (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist))
+        if (!ptr_nicklist)
+        {
+            ptr_nicklist = relay_weechat_nicklist_search (ptr_buffer, 1);
+            if (!ptr_nicklist)
+                return WEECHAT_RC_OK;
+        }
+        /* client will receive diffs starting with this one */
+        if (!weechat_hashtable_has_key (RELAY_WEECHAT_DATA(ptr_client,
+                                                           buffers_nicklist),
+                                        ptr_buffer))
         {
-            weechat_unhook (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist));
-            RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist) = NULL;
+            weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client,
+                                                      buffers_nicklist),
+                                   ptr_buffer,
+                                   &(ptr_nicklist->items_count));
         }
-        relay_weechat_hook_timer_nicklist (ptr_client);
     }
 
+    if (!ptr_nicklist)
+        return WEECHAT_RC_OK;
+
+    /*
+     * add items if nicklist was not empty or very small (otherwise we will
+     * send full nicklist)
+     */
+    if (ptr_nicklist->nicklist_count > 1)
+    {
+        /* add nicklist item for parent group and group/nick */
+        relay_weechat_nicklist_add_item (ptr_nicklist,
+                                         RELAY_WEECHAT_NICKLIST_DIFF_PARENT,
+                                         parent_group, NULL);
+        relay_weechat_nicklist_add_item (ptr_nicklist, diff, group, nick);
+    }
+
+    /* add timer to send nicklist */
+    relay_weechat_hook_timer_nicklist ();
+
     return WEECHAT_RC_OK;
 }
 
@@ -954,6 +1062,9 @@ relay_weechat_protocol_signal_upgrade_cb (void *data, const char *signal,
     if ((strcmp (signal, "upgrade") == 0)
         || (strcmp (signal, "upgrade_ended") == 0))
     {
+        /* lines waiting in batch are not saved on upgrade: send them now */
+        relay_weechat_batch_flush (ptr_client);
+
         /* send signal only if client is synchronized with flag "upgrade" */
         if (relay_weechat_protocol_is_sync (ptr_client, NULL,
                                             RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE))
@@ -1025,7 +1136,7 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(sync)
                 {
                     full_name = strdup (buffers[i]);
                     if (strcmp (buffers[i], "*") == 0)
-                        mask = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
+                        mask = RELAY_WEECHAT_PROTOCOL_SYNC_MASK_ALL;
                 }
 
                 if (full_name)
@@ -1072,7 +1183,7 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(desync)
                                     &num_buffers);
     if (buffers)
     {
-        sub_flags = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
+        sub_flags = RELAY_WEECHAT_PROTOCOL_SYNC_MASK_ALL;
         if (argc > 1)
         {
             sub_flags = 0;
@@ -1105,7 +1216,7 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(desync)
                 {
                     full_name = strdup (buffers[i]);
                     if (strcmp (buffers[i], "*") == 0)
-                        mask = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
+                        mask = RELAY_WEECHAT_PROTOCOL_SYNC_MASK_ALL;
                 }
 
                 if (full_name)
@@ -24,6 +24,7 @@
 #define RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST 2
 #define RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS  4
 #define RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE  8
+#define RELAY_WEECHAT_PROTOCOL_SYNC_BATCH    16
 
 #define RELAY_WEECHAT_PROTOCOL_SYNC_ALL         \
     (RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER |       \
@@ -31,9 +32,16 @@
      RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |      \
      RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE)
 
+/* flags allowed for "*" (flag "batch" is never set by default) */
+#define RELAY_WEECHAT_PROTOCOL_SYNC_MASK_ALL    \
+    (RELAY_WEECHAT_PROTOCOL_SYNC_ALL |          \
+     RELAY_WEECHAT_PROTOCOL_SYNC_BATCH)
+
+/* flags allowed for a buffer */
 #define RELAY_WEECHAT_PROTOCOL_SYNC_FOR_BUFFER  \
     (RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER |       \
-     RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST)
+     RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST |     \
+     RELAY_WEECHAT_PROTOCOL_SYNC_BATCH)
 
 #define RELAY_WEECHAT_PROTOCOL_CALLBACK(__command)                      \
     int                                                                 \
@@ -33,6 +33,7 @@
 #include "../../weechat-plugin.h"
 #include "../relay.h"
 #include "relay-weechat.h"
+#include "relay-weechat-batch.h"
 #include "relay-weechat-nicklist.h"
 #include "relay-weechat-protocol.h"
 #include "../relay-client.h"
@@ -43,6 +44,11 @@
 char *relay_weechat_compression_string[] = /* strings for compressions      */
 { "off", "zlib" };
 
+struct t_hook *relay_weechat_hook_nicklist_hsignal = NULL; /* hsignals     */
+                                       /* "nicklist_*" (for all clients)    */
+struct t_hook *relay_weechat_hook_nicklist_timer = NULL; /* timer to send  */
+                                       /* nicklist (for all clients)        */
+
 
 /*
  * Searches for a compression.
@@ -77,14 +83,19 @@ relay_weechat_hook_signals (struct t_relay_client *client)
         weechat_hook_signal ("buffer_*",
                              &relay_weechat_protocol_signal_buffer_cb,
                              client);
-    RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) =
-        weechat_hook_hsignal ("nicklist_*",
-                              &relay_weechat_protocol_hsignal_nicklist_cb,
-                              client);
     RELAY_WEECHAT_DATA(client, hook_signal_upgrade) =
         weechat_hook_signal ("upgrade*",
                              &relay_weechat_protocol_signal_upgrade_cb,
                              client);
+
+    /* hsignals for nicklist are hooked only once, for all clients */
+    if (!relay_weechat_hook_nicklist_hsignal)
+    {
+        relay_weechat_hook_nicklist_hsignal =
+            weechat_hook_hsignal ("nicklist_*",
+                                  &relay_weechat_protocol_hsignal_nicklist_cb,
+                                  NULL);
+    }
 }
 
 /*
@@ -99,29 +110,69 @@ relay_weechat_unhook_signals (struct t_relay_client *client)
         weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
         RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
     }
-    if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
-    {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-    }
     if (RELAY_WEECHAT_DATA(client, hook_signal_upgrade))
     {
         weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
         RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
     }
+    if (RELAY_WEECHAT_DATA(client, hook_timer_batch))
+    {
+        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_timer_batch));
+        RELAY_WEECHAT_DATA(client, hook_timer_batch) = NULL;
+    }
+
+    relay_weechat_unhook_nicklist ();
+}
+
+/*
+ * Unhooks hsignals and timer for nicklist if there are no more clients with
+ * WeeChat protocol listening to signals (and frees nicklist diffs).
+ */
+
+void
+relay_weechat_unhook_nicklist ()
+{
+    struct t_relay_client *ptr_client;
+
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if ((ptr_client->protocol == RELAY_PROTOCOL_WEECHAT)
+            && ptr_client->protocol_data
+            && RELAY_WEECHAT_DATA(ptr_client, hook_signal_buffer))
+        {
+            return;
+        }
+    }
+
+    if (relay_weechat_hook_nicklist_hsignal)
+    {
+        weechat_unhook (relay_weechat_hook_nicklist_hsignal);
+        relay_weechat_hook_nicklist_hsignal = NULL;
+    }
+    if (relay_weechat_hook_nicklist_timer)
+    {
+        weechat_unhook (relay_weechat_hook_nicklist_timer);
+        relay_weechat_hook_nicklist_timer = NULL;
+    }
+    relay_weechat_nicklist_remove_all ();
 }
 
 /*
- * Hooks timer to update nicklist.
+ * Hooks timer to send nicklist to clients (the timer is restarted if it was
+ * already running).
  */
 
 void
-relay_weechat_hook_timer_nicklist (struct t_relay_client *client)
+relay_weechat_hook_timer_nicklist ()
 {
-    RELAY_WEECHAT_DATA(client, hook_timer_nicklist) =
+    if (relay_weechat_hook_nicklist_timer)
+        weechat_unhook (relay_weechat_hook_nicklist_timer);
+
+    relay_weechat_hook_nicklist_timer =
         weechat_hook_timer (100, 0, 1,
                             &relay_weechat_protocol_timer_nicklist_cb,
-                            client);
+                            NULL);
 }
 
 /*
@@ -144,21 +195,6 @@ relay_weechat_close_connection (struct t_relay_client *client)
     relay_weechat_unhook_signals (client);
 }
 
-/*
- * Frees a value of hashtable "buffers_nicklist".
- */
-
-void
-relay_weechat_free_buffers_nicklist (struct t_hashtable *hashtable,
-                                     const void *key, void *value)
-{
-    /* make C compiler happy */
-    (void) hashtable;
-    (void) key;
-
-    relay_weechat_nicklist_free ((struct t_relay_weechat_nicklist *)value);
-}
-
 /*
  * Initializes relay data specific to WeeChat protocol.
  */
@@ -184,18 +220,15 @@ relay_weechat_alloc (struct t_relay_client *client)
                                    NULL,
                                    NULL);
         RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
         RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
         RELAY_WEECHAT_DATA(client, buffers_nicklist) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_POINTER,
-                                   WEECHAT_HASHTABLE_POINTER,
+                                   WEECHAT_HASHTABLE_INTEGER,
                                    NULL,
                                    NULL);
-        weechat_hashtable_set_pointer (RELAY_WEECHAT_DATA(client, buffers_nicklist),
-                                       "callback_free_value",
-                                       &relay_weechat_free_buffers_nicklist);
-        RELAY_WEECHAT_DATA(client, hook_timer_nicklist) = NULL;
+        RELAY_WEECHAT_DATA(client, batch_lines) = NULL;
+        RELAY_WEECHAT_DATA(client, hook_timer_batch) = NULL;
 
         relay_weechat_hook_signals (client);
     }
@@ -247,23 +280,19 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
             index++;
         }
         RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
         RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
         RELAY_WEECHAT_DATA(client, buffers_nicklist) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_POINTER,
-                                   WEECHAT_HASHTABLE_POINTER,
+                                   WEECHAT_HASHTABLE_INTEGER,
                                    NULL,
                                    NULL);
-        weechat_hashtable_set_pointer (RELAY_WEECHAT_DATA(client, buffers_nicklist),
-                                       "callback_free_value",
-                                       &relay_weechat_free_buffers_nicklist);
-        RELAY_WEECHAT_DATA(client, hook_timer_nicklist) = NULL;
+        RELAY_WEECHAT_DATA(client, batch_lines) = NULL;
+        RELAY_WEECHAT_DATA(client, hook_timer_batch) = NULL;
 
         if (RELAY_CLIENT_HAS_ENDED(client))
         {
             RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-            RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
             RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
         }
         else
@@ -284,16 +313,20 @@ relay_weechat_free (struct t_relay_client *client)
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_sync));
         if (RELAY_WEECHAT_DATA(client, hook_signal_buffer))
             weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
         if (RELAY_WEECHAT_DATA(client, hook_signal_upgrade))
             weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
         if (RELAY_WEECHAT_DATA(client, buffers_nicklist))
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_nicklist));
+        if (RELAY_WEECHAT_DATA(client, batch_lines))
+            relay_weechat_batch_free (RELAY_WEECHAT_DATA(client, batch_lines));
+        if (RELAY_WEECHAT_DATA(client, hook_timer_batch))
+            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_timer_batch));
 
         free (client->protocol_data);
 
         client->protocol_data = NULL;
+
+        relay_weechat_unhook_nicklist ();
     }
 }
 
@@ -338,12 +371,15 @@ relay_weechat_print_log (struct t_relay_client *client)
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_sync),
                                                           "keys_values"));
         weechat_log_printf ("    hook_signal_buffer . . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        weechat_log_printf ("    hook_hsignal_nicklist. : 0x%lx", RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
         weechat_log_printf ("    hook_signal_upgrade. . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
         weechat_log_printf ("    buffers_nicklist . . . : 0x%lx (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_nicklist),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_nicklist),
                                                           "keys_values"));
-        weechat_log_printf ("    hook_timer_nicklist. . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_timer_nicklist));
+        weechat_log_printf ("    batch_lines. . . . . . : 0x%lx (%d lines)",
+                            RELAY_WEECHAT_DATA(client, batch_lines),
+                            (RELAY_WEECHAT_DATA(client, batch_lines)) ?
+                            RELAY_WEECHAT_DATA(client, batch_lines)->lines_count : 0);
+        weechat_log_printf ("    hook_timer_batch . . . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_timer_batch));
     }
 }
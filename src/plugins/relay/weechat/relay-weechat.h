@@ -21,6 +21,7 @@
 #define WEECHAT_RELAY_WEECHAT_H 1
 
 struct t_relay_client;
+struct t_relay_weechat_batch;
 
 #define RELAY_WEECHAT_DATA(client, var)                          \
     (((struct t_relay_weechat_data *)client->protocol_data)->var)
@@ -42,16 +43,23 @@ struct t_relay_weechat_data
     struct t_hashtable *buffers_sync;  /* buffers synchronized (events      */
                                        /* received for these buffers)       */
     struct t_hook *hook_signal_buffer;    /* hook for signals "buffer_*"    */
-    struct t_hook *hook_hsignal_nicklist; /* hook for hsignals "nicklist_*" */
     struct t_hook *hook_signal_upgrade;   /* hook for signals "upgrade*"    */
     struct t_hashtable *buffers_nicklist; /* send nicklist for these buffers*/
-    struct t_hook *hook_timer_nicklist;   /* timer for sending nicklist     */
+                                          /* (value: index of first diff    */
+                                          /* not yet sent, in nicklist log) */
+    struct t_relay_weechat_batch *batch_lines; /* lines waiting to be sent  */
+                                          /* (sync with flag "batch")       */
+    struct t_hook *hook_timer_batch;      /* timer to send batch of lines   */
 };
 
+extern struct t_hook *relay_weechat_hook_nicklist_hsignal;
+extern struct t_hook *relay_weechat_hook_nicklist_timer;
+
 extern int relay_weechat_compression_search (const char *compression);
 extern void relay_weechat_hook_signals (struct t_relay_client *client);
 extern void relay_weechat_unhook_signals (struct t_relay_client *client);
-extern void relay_weechat_hook_timer_nicklist (struct t_relay_client *client);
+extern void relay_weechat_unhook_nicklist ();
+extern void relay_weechat_hook_timer_nicklist ();
 extern void relay_weechat_recv (struct t_relay_client *client,
                                 const char *data);
 extern void relay_weechat_close_connection (struct t_relay_client *client);
@@ -45,6 +45,7 @@ struct t_infolist_item;
 struct t_weelist;
 struct t_hashtable;
 struct t_hdata;
+struct t_memory_tag;
 struct timeval;
 
 /*
@@ -57,7 +58,7 @@ struct timeval;
  * please change the date with current one; for a second change at same
  * date, increment the 01, otherwise please keep 01.
  */
-#define WEECHAT_PLUGIN_API_VERSION "20140802-01"
+#define WEECHAT_PLUGIN_API_VERSION "20141018-02"
 
 /* macros for defining plugin infos */
 #define WEECHAT_PLUGIN_NAME(__name)                                     \
@@ -155,9 +156,10 @@ struct timeval;
 #define WEECHAT_HOOK_CONNECT_TIMEOUT                9
 #define WEECHAT_HOOK_CONNECT_SOCKET_ERROR           10
 
-/* action for gnutls callback: verify or set certificate */
+/* action for gnutls callback: verify or set certificate, set session */
 #define WEECHAT_HOOK_CONNECT_GNUTLS_CB_VERIFY_CERT  0
 #define WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_CERT     1
+#define WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_SESSION  2
 
 /* type of data for signal hooked */
 #define WEECHAT_HOOK_SIGNAL_STRING                  "string"
@@ -309,6 +311,13 @@ struct t_weechat_plugin
     char *(*util_get_time_string) (const time_t *date);
     int (*util_version_number) (const char *version);
 
+    /* memory */
+    struct t_memory_tag *(*memory_tag) (struct t_weechat_plugin *plugin,
+                                        const char *name);
+    void *(*memory_malloc) (struct t_memory_tag *tag, size_t size);
+    char *(*memory_strdup) (struct t_memory_tag *tag, const char *string);
+    void (*memory_free) (struct t_memory_tag *tag, void *pointer);
+
     /* sorted lists */
     struct t_weelist *(*list_new) ();
     struct t_weelist_item *(*list_add) (struct t_weelist *weelist,
@@ -1124,6 +1133,16 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
 #define weechat_util_version_number(__version)                          \
     (weechat_plugin->util_version_number)(__version)
 
+/* memory */
+#define weechat_memory_tag(__name)                                      \
+    (weechat_plugin->memory_tag)(weechat_plugin, __name)
+#define weechat_memory_malloc(__tag, __size)                            \
+    (weechat_plugin->memory_malloc)(__tag, __size)
+#define weechat_memory_strdup(__tag, __string)                          \
+    (weechat_plugin->memory_strdup)(__tag, __string)
+#define weechat_memory_free(__tag, __pointer)                           \
+    (weechat_plugin->memory_free)(__tag, __pointer)
+
 /* sorted list */
 #define weechat_list_new()                                              \
     (weechat_plugin->list_new)()
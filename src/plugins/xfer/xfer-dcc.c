@@ -19,6 +19,10 @@
  * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -27,6 +31,10 @@
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <time.h>
@@ -37,150 +45,403 @@
 #include "../weechat-plugin.h"
 #include "xfer.h"
 #include "xfer-config.h"
+#include "xfer-dcc.h"
 #include "xfer-file.h"
 #include "xfer-network.h"
+#include "xfer-writer.h"
+
+
+struct t_hook *xfer_dcc_send_hook_timer = NULL; /* timer for files sent     */
+struct timeval xfer_dcc_send_last_refill;      /* last refill of tokens     */
+
+
+/*
+ * Returns speed limit for sending files (in bytes by second), 0 if there is
+ * no limit.
+ */
+
+long long
+xfer_dcc_send_speed_limit ()
+{
+    return (long long)weechat_config_integer (xfer_config_network_speed_limit) * 1024;
+}
+
+/*
+ * Returns size of token bucket used for speed limit: this is the max number
+ * of bytes that can be sent in a burst.
+ */
+
+long long
+xfer_dcc_send_bucket_size (long long speed_limit)
+{
+    long long size;
+
+    size = (speed_limit * XFER_DCC_SEND_BURST) / 1000;
+
+    return (size < XFER_BLOCKSIZE_MIN) ? XFER_BLOCKSIZE_MIN : size;
+}
 
+/*
+ * Converts a DCC ACK (32-bit position, modulo 4GB) to a position in file,
+ * using current position (for files bigger than 4GB).
+ */
+
+unsigned long long
+xfer_dcc_ack_to_pos (unsigned long long pos, uint32_t ack)
+{
+    unsigned long long ack_pos;
+
+    ack_pos = (pos & ~0xFFFFFFFFULL) | (unsigned long long)ack;
+    if ((ack_pos > pos) && (ack_pos >= 0x100000000ULL))
+        ack_pos -= 0x100000000ULL;
+
+    return ack_pos;
+}
 
 /*
- * Child process for sending file with DCC protocol.
+ * Hooks socket of a file sent, with write flag only if data can be sent now
+ * (the socket is not watched for write when we wait for an ACK or for tokens
+ * of speed limit, to prevent a busy loop).
  */
 
 void
-xfer_dcc_send_file_child (struct t_xfer *xfer)
+xfer_dcc_send_file_hook (struct t_xfer *xfer)
 {
-    int num_read, num_sent, blocksize;
-    static char buffer[XFER_BLOCKSIZE_MAX];
-    uint32_t ack;
-    time_t last_sent, new_time, last_second, sent_ok;
-    unsigned long long sent_last_second;
+    int flag_write;
 
-    /* empty file? just return immediately */
-    if (xfer->pos >= xfer->size)
-    {
-        xfer_network_write_pipe (xfer, XFER_STATUS_DONE,
-                                 XFER_NO_ERROR);
+    flag_write = ((xfer->pos < xfer->size)
+                  && (xfer->fast_send || (xfer->pos <= xfer->ack))
+                  && ((xfer_dcc_send_speed_limit () == 0)
+                      || (xfer->send_tokens > 0))) ? 1 : 0;
+
+    if (xfer->hook_fd && (flag_write == xfer->send_write))
         return;
-    }
 
-    blocksize = xfer->blocksize;
-    if (weechat_config_integer (xfer_config_network_speed_limit) > 0)
-    {
-        if (blocksize > weechat_config_integer (xfer_config_network_speed_limit) * 1024)
-            blocksize = weechat_config_integer (xfer_config_network_speed_limit) * 1024;
-    }
+    if (xfer->hook_fd)
+        weechat_unhook (xfer->hook_fd);
+    xfer->send_write = flag_write;
+    xfer->hook_fd = weechat_hook_fd (xfer->sock,
+                                     1, flag_write, 0,
+                                     &xfer_dcc_send_file_cb,
+                                     xfer);
+}
+
+/*
+ * Reads ACKs sent by receiver (non-blocking).
+ *
+ * Returns:
+ *   1: OK
+ *   0: xfer has ended (done or failed)
+ */
+
+int
+xfer_dcc_send_file_read_ack (struct t_xfer *xfer)
+{
+    unsigned char buffer[256];
+    int num_read, i;
+    uint32_t ack;
 
-    last_sent = time (NULL);
-    last_second = time (NULL);
-    sent_ok = 0;
-    sent_last_second = 0;
     while (1)
     {
-        /* read DCC ACK (sent by receiver) */
-        if (xfer->pos > xfer->ack)
+        num_read = recv (xfer->sock, buffer, sizeof (buffer), 0);
+        if (num_read < 0)
         {
-            /* we should receive ACK for packets sent previously */
-            while (1)
-            {
-                num_read = recv (xfer->sock, (char *) &ack, 4, MSG_PEEK);
-                if ((num_read < 1) &&
-                    ((num_read != -1) || ((errno != EAGAIN) && (errno != EWOULDBLOCK))))
-                {
-                    xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                             XFER_ERROR_SEND_BLOCK);
-                    return;
-                }
-                if (num_read == 4)
-                {
-                    recv (xfer->sock, (char *) &ack, 4, 0);
-                    xfer->ack = ntohl (ack);
-
-                    /* DCC send OK? */
-                    if ((xfer->pos >= xfer->size)
-                        && (xfer->ack >= xfer->size))
-                    {
-                        xfer_network_write_pipe (xfer, XFER_STATUS_DONE,
-                                                 XFER_NO_ERROR);
-                        return;
-                    }
-                }
-                else
-                    break;
-            }
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+            xfer_network_update_status (xfer, XFER_STATUS_FAILED,
+                                        XFER_ERROR_READ_ACK);
+            return 0;
         }
-
-        /* send a block to receiver */
-        if ((xfer->pos < xfer->size) &&
-             (xfer->fast_send || (xfer->pos <= xfer->ack)))
+        if (num_read == 0)
         {
-            if ((weechat_config_integer (xfer_config_network_speed_limit) > 0)
-                && (sent_last_second >= (unsigned long long)weechat_config_integer (xfer_config_network_speed_limit) * 1024))
+            /* connection closed by receiver */
+            if (xfer->pos >= xfer->size)
             {
-                /* we're sending too fast (according to speed limit set by user) */
-                usleep (100);
+                xfer_network_update_status (xfer, XFER_STATUS_DONE,
+                                            XFER_NO_ERROR);
             }
             else
             {
-                lseek (xfer->file, xfer->pos, SEEK_SET);
-                num_read = read (xfer->file, buffer, blocksize);
-                if (num_read < 1)
-                {
-                    xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                             XFER_ERROR_READ_LOCAL);
-                    return;
-                }
-                num_sent = send (xfer->sock, buffer, num_read, 0);
-                if (num_sent < 0)
-                {
-                    /*
-                     * socket is temporarily not available (receiver can't
-                     * receive amount of data we sent ?!)
-                     */
-                    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        usleep (1000);
-                    else
-                    {
-                        xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                                 XFER_ERROR_SEND_BLOCK);
-                        return;
-                    }
-                }
-                if (num_sent > 0)
-                {
-                    xfer->pos += (unsigned long long) num_sent;
-                    sent_last_second += (unsigned long long) num_sent;
-                    new_time = time (NULL);
-                    if ((last_sent != new_time)
-                        || ((sent_ok == 0) && (xfer->pos >= xfer->size)))
-                    {
-                        last_sent = new_time;
-                        xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
-                                                 XFER_NO_ERROR);
-                        if (xfer->pos >= xfer->size)
-                            sent_ok = new_time;
-                    }
-                }
+                xfer_network_update_status (xfer, XFER_STATUS_FAILED,
+                                            XFER_ERROR_READ_ACK);
+            }
+            return 0;
+        }
+        for (i = 0; i < num_read; i++)
+        {
+            xfer->ack_buffer[xfer->ack_length++] = buffer[i];
+            if (xfer->ack_length == 4)
+            {
+                memcpy (&ack, xfer->ack_buffer, 4);
+                xfer->ack = xfer_dcc_ack_to_pos (xfer->pos, ntohl (ack));
+                xfer->ack_length = 0;
             }
         }
+    }
+
+    /* DCC send OK? */
+    if ((xfer->pos >= xfer->size) && (xfer->ack >= xfer->size))
+    {
+        xfer_network_update_status (xfer, XFER_STATUS_DONE, XFER_NO_ERROR);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Sends a block of file on socket (at current position in file).
+ *
+ * Returns:
+ *   > 0: number of bytes sent
+ *     0: nothing sent (socket is full)
+ *    -1: error on socket
+ *    -2: error when reading local file
+ */
+
+ssize_t
+xfer_dcc_send_file_block (struct t_xfer *xfer, size_t length)
+{
+#ifdef HAVE_SYS_SENDFILE_H
+    off_t offset;
+    ssize_t num_sent;
+
+    offset = (off_t)xfer->pos;
+    num_sent = sendfile (xfer->sock, xfer->file, &offset, length);
+    if (num_sent > 0)
+        return num_sent;
+    if (num_sent == 0)
+    {
+        /* end of file reached before the expected size */
+        return -2;
+    }
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+        return 0;
+    return ((errno == EIO) || (errno == EOVERFLOW)) ? -2 : -1;
+#else
+    static char buffer[XFER_BLOCKSIZE_MAX];
+    ssize_t num_read, num_sent;
+
+    if (length > sizeof (buffer))
+        length = sizeof (buffer);
+    num_read = pread (xfer->file, buffer, length, (off_t)xfer->pos);
+    if (num_read < 1)
+        return ((num_read < 0) && (errno == EINTR)) ? 0 : -2;
+    num_sent = send (xfer->sock, buffer, num_read, 0);
+    if (num_sent >= 0)
+        return num_sent;
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+        return 0;
+    return -1;
+#endif /* HAVE_SYS_SENDFILE_H */
+}
+
+/*
+ * Sends data to receiver (if allowed by ACK and speed limit), until the socket
+ * is full (at most XFER_DCC_SEND_MAX_LENGTH bytes, so that other events are
+ * not delayed too much).
+ *
+ * Returns:
+ *   1: OK
+ *   0: xfer has ended (failed)
+ */
+
+int
+xfer_dcc_send_file_send (struct t_xfer *xfer)
+{
+    long long speed_limit;
+    unsigned long long length, total_sent;
+    ssize_t num_sent;
+    time_t time_now;
+
+    speed_limit = xfer_dcc_send_speed_limit ();
+    total_sent = 0;
+
+    while ((xfer->pos < xfer->size)
+           && (xfer->fast_send || (xfer->pos <= xfer->ack))
+           && ((speed_limit == 0) || (xfer->send_tokens > 0))
+           && (total_sent < XFER_DCC_SEND_MAX_LENGTH))
+    {
+        length = xfer->size - xfer->pos;
+        if (xfer->fast_send)
+        {
+            if (length > XFER_DCC_SEND_MAX_LENGTH - total_sent)
+                length = XFER_DCC_SEND_MAX_LENGTH - total_sent;
+        }
         else
-            usleep (1000);
+        {
+            /* without fast send, send one block and wait for its ACK */
+            if (length > (unsigned long long)xfer->blocksize)
+                length = xfer->blocksize;
+        }
+        if ((speed_limit > 0)
+            && (length > (unsigned long long)xfer->send_tokens))
+        {
+            length = xfer->send_tokens;
+        }
+
+        num_sent = xfer_dcc_send_file_block (xfer, length);
+        if (num_sent < 0)
+        {
+            xfer_network_update_status (xfer, XFER_STATUS_FAILED,
+                                        (num_sent == -2) ?
+                                        XFER_ERROR_READ_LOCAL :
+                                        XFER_ERROR_SEND_BLOCK);
+            return 0;
+        }
+        if (num_sent == 0)
+            break;
+
+        xfer->pos += (unsigned long long)num_sent;
+        total_sent += (unsigned long long)num_sent;
+        if (speed_limit > 0)
+            xfer->send_tokens -= num_sent;
+    }
+
+    if (total_sent == 0)
+        return 1;
+
+    /* update status of xfer (at most once per second, and at end of file) */
+    time_now = time (NULL);
+    if ((time_now != xfer->last_activity) || (xfer->pos >= xfer->size))
+    {
+        xfer->last_activity = time_now;
+        xfer_file_calculate_speed (xfer, 0);
+        xfer_network_update_status (xfer, XFER_STATUS_ACTIVE, XFER_NO_ERROR);
+    }
+    if ((xfer->pos >= xfer->size) && (xfer->sent_ok == 0))
+        xfer->sent_ok = time_now;
+
+    return 1;
+}
+
+/*
+ * Callback called when socket of a file sent is ready (ACK received and/or
+ * data can be sent).
+ */
+
+int
+xfer_dcc_send_file_cb (void *arg_xfer, int fd)
+{
+    struct t_xfer *xfer;
+
+    /* make C compiler happy */
+    (void) fd;
+
+    xfer = (struct t_xfer *)arg_xfer;
+
+    if (xfer->status != XFER_STATUS_ACTIVE)
+        return WEECHAT_RC_OK;
+
+    if (!xfer_dcc_send_file_read_ack (xfer))
+        return WEECHAT_RC_OK;
+
+    if (!xfer_dcc_send_file_send (xfer))
+        return WEECHAT_RC_OK;
+
+    xfer_dcc_send_file_hook (xfer);
 
-        new_time = time (NULL);
-        if (new_time > last_second)
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Timer callback for files sent: refills tokens of speed limit and ends the
+ * transfers without final ACK.
+ *
+ * The timer is removed when there is no more file being sent.
+ */
+
+int
+xfer_dcc_send_timer_cb (void *data, int remaining_calls)
+{
+    struct t_xfer *ptr_xfer;
+    struct timeval tv_now;
+    long long speed_limit, bucket_size, tokens;
+    long elapsed;
+    int files_sent;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    gettimeofday (&tv_now, NULL);
+    elapsed = weechat_util_timeval_diff (&xfer_dcc_send_last_refill, &tv_now);
+    xfer_dcc_send_last_refill = tv_now;
+
+    speed_limit = xfer_dcc_send_speed_limit ();
+    bucket_size = xfer_dcc_send_bucket_size (speed_limit);
+    tokens = (speed_limit * elapsed) / 1000;
+
+    files_sent = 0;
+    for (ptr_xfer = xfer_list; ptr_xfer; ptr_xfer = ptr_xfer->next_xfer)
+    {
+        if ((ptr_xfer->type != XFER_TYPE_FILE_SEND)
+            || (ptr_xfer->status != XFER_STATUS_ACTIVE)
+            || (ptr_xfer->file < 0))
         {
-            last_second = new_time;
-            sent_last_second = 0;
+            continue;
         }
 
         /*
-         * if send if OK since 2 seconds or more, and that no ACK was received,
+         * if send is OK since 2 seconds or more, and that no ACK was received,
          * then consider it's OK
          */
-        if ((sent_ok != 0) && (new_time > sent_ok + 2))
+        if ((ptr_xfer->sent_ok != 0) && (tv_now.tv_sec > ptr_xfer->sent_ok + 2))
         {
-            xfer_network_write_pipe (xfer, XFER_STATUS_DONE,
-                                     XFER_NO_ERROR);
-            return;
+            xfer_network_update_status (ptr_xfer, XFER_STATUS_DONE,
+                                        XFER_NO_ERROR);
+            continue;
+        }
+
+        files_sent++;
+        if (speed_limit > 0)
+        {
+            ptr_xfer->send_tokens += tokens;
+            if (ptr_xfer->send_tokens > bucket_size)
+                ptr_xfer->send_tokens = bucket_size;
         }
+        xfer_dcc_send_file_hook (ptr_xfer);
+    }
+
+    if (files_sent == 0)
+    {
+        weechat_unhook (xfer_dcc_send_hook_timer);
+        xfer_dcc_send_hook_timer = NULL;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Starts sending a file with DCC protocol (socket is connected and file is
+ * opened).
+ */
+
+void
+xfer_dcc_send_file_start (struct t_xfer *xfer)
+{
+    /* empty file? just return immediately */
+    if (xfer->pos >= xfer->size)
+    {
+        xfer_network_update_status (xfer, XFER_STATUS_DONE, XFER_NO_ERROR);
+        return;
+    }
+
+    xfer->ack_length = 0;
+    xfer->sent_ok = 0;
+    xfer->send_tokens = xfer_dcc_send_bucket_size (xfer_dcc_send_speed_limit ());
+
+    xfer_dcc_send_file_hook (xfer);
+
+    if (!xfer_dcc_send_hook_timer)
+    {
+        gettimeofday (&xfer_dcc_send_last_refill, NULL);
+        xfer_dcc_send_hook_timer = weechat_hook_timer (XFER_DCC_SEND_TIMER_INTERVAL,
+                                                       0, 0,
+                                                       &xfer_dcc_send_timer_cb,
+                                                       NULL);
     }
 }
 
@@ -229,110 +490,131 @@ xfer_dcc_recv_file_send_ack (struct t_xfer *xfer)
 }
 
 /*
- * Reads a resumed xfer from disk for hashing.
- *
- * Returns:
- *   1: OK
- *   0: error
+ * Checks CRC32 of file received (hash is complete) and reports result to
+ * parent process.
  */
 
-int
-xfer_dcc_resume_hash (struct t_xfer *xfer)
+void
+xfer_dcc_recv_file_check_hash (struct t_xfer *xfer)
 {
-    char *buf;
-    unsigned long long total_read;
-    ssize_t length_buf, to_read, num_read;
-    int ret, fd;
-
-    total_read = 0;
-    ret = 1;
-    fd = 0;
-
-    length_buf = 1024 * 1024;
-    buf = malloc (length_buf);
-    if (!buf)
-        return 0;
+    unsigned char *bin_hash;
+    char hash[9];
 
-    while (fd <= 0)
+    gcry_md_final (*xfer->hash_handle);
+    bin_hash = gcry_md_read (*xfer->hash_handle, 0);
+    if (bin_hash)
     {
-        fd = open (xfer->local_filename, O_RDONLY);
-        if (fd < 0)
+        snprintf (hash, sizeof (hash), "%.2X%.2X%.2X%.2X",
+                  bin_hash[0], bin_hash[1], bin_hash[2], bin_hash[3]);
+        if (weechat_strcasecmp (hash, xfer->hash_target) == 0)
         {
-            if (errno == EINTR)
-                continue;
-            fd = 0;
-            ret = 0;
-            break;
+            xfer_network_write_pipe (xfer, XFER_STATUS_HASHED,
+                                     XFER_NO_ERROR);
         }
-    }
-
-    if (fd)
-    {
-        while (total_read < xfer->start_resume)
+        else
         {
-            to_read = xfer->start_resume - total_read;
-            if (to_read > length_buf)
-                num_read = read (fd, buf, length_buf);
-            else
-                num_read = read (fd, buf, to_read);
-            if (num_read > 0)
-            {
-                gcry_md_write (*xfer->hash_handle, buf, num_read);
-                total_read += num_read;
-            }
-            else if (num_read < 0)
-            {
-                if (errno == EINTR)
-                    continue;
-                ret = 0;
-                break;
-            }
+            xfer_network_write_pipe (xfer, XFER_STATUS_HASHED,
+                                     XFER_ERROR_HASH_MISMATCH);
         }
+    }
+}
 
-        while (close (fd) < 0)
-        {
-            if (errno != EINTR)
-                break;
-        }
+/*
+ * Disables hash of file received (after an error when hashing the resumed
+ * file) and reports error to parent process.
+ */
+
+void
+xfer_dcc_recv_file_hash_error (struct t_xfer *xfer)
+{
+    gcry_md_close (*xfer->hash_handle);
+    free (xfer->hash_handle);
+    xfer->hash_handle = NULL;
+    xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
+                             XFER_ERROR_HASH_RESUME_ERROR);
+}
+
+/*
+ * Sends ACK to sender (receive) and saves position of last ACK sent.
+ *
+ * Returns:
+ *   1: OK (or ACK not sent, but it's not a problem: ACKs are disabled)
+ *   0: send error (error is reported to parent process)
+ */
+
+int
+xfer_dcc_recv_file_ack (struct t_xfer *xfer, int *ack_enabled,
+                        unsigned long long *pos_last_ack)
+{
+    switch (xfer_dcc_recv_file_send_ack (xfer))
+    {
+        case 0:
+            /* send error, socket down? */
+            xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
+                                     XFER_ERROR_SEND_ACK);
+            return 0;
+        case 1:
+            /* send error, not fatal (buffer full?): disable ACKs */
+            *ack_enabled = 0;
+            *pos_last_ack = xfer->pos;
+            break;
+        case 2:
+            /* send OK: save position in file as last ACK sent */
+            *pos_last_ack = xfer->pos;
+            break;
     }
 
-    free (buf);
+    return 1;
+}
+
+/*
+ * Reports progress of receive to parent process, at most once every
+ * XFER_DCC_RECV_PROGRESS_INTERVAL milliseconds.
+ */
+
+void
+xfer_dcc_recv_file_progress (struct t_xfer *xfer,
+                             struct t_xfer_writer *writer,
+                             struct timeval *tv_last_progress)
+{
+    struct timeval tv_now;
 
-    return ret;
+    gettimeofday (&tv_now, NULL);
+    if (weechat_util_timeval_diff (tv_last_progress,
+                                   &tv_now) < XFER_DCC_RECV_PROGRESS_INTERVAL)
+    {
+        return;
+    }
+
+    *tv_last_progress = tv_now;
+    if (xfer->hash_handle && xfer_writer_hash_error (writer))
+        xfer_dcc_recv_file_hash_error (xfer);
+    xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE, XFER_NO_ERROR);
 }
 
 /*
  * Child process for receiving file with DCC protocol.
+ *
+ * Data received is stored in large buffers written by a writer thread (see
+ * xfer-writer.c), which also computes the CRC32 as data arrives (and hashes
+ * the resumed part of file in background).
+ *
+ * An ACK is sent each time the socket is empty, unless the sender does not
+ * wait for ACKs (fast send, detected when more than one block is received
+ * without ACK): then ACKs are coalesced and sent every
+ * XFER_DCC_RECV_ACK_INTERVAL bytes, or when no data was received during
+ * XFER_DCC_RECV_ACK_DELAY milliseconds.
  */
 
 void
 xfer_dcc_recv_file_child (struct t_xfer *xfer)
 {
-    int flags, num_read, ack_enabled, ready;
-    static char buffer[XFER_BLOCKSIZE_MAX];
-    time_t last_sent, new_time;
+    struct t_xfer_writer *writer;
+    int flags, num_read, ack_enabled, ack_coalesce, ready, size;
+    char *ptr_buffer;
     unsigned long long pos_last_ack;
+    struct timeval tv_timeout, tv_last_progress;
     fd_set read_fds, write_fds, except_fds;
-    ssize_t written, total_written;
-    unsigned char *bin_hash;
-    char hash[9];
-
-    /* if resuming, hash the portion of the file we have */
-    if ((xfer->start_resume > 0) && xfer->hash_handle)
-    {
-        xfer_network_write_pipe (xfer, XFER_STATUS_HASHING,
-                                 XFER_NO_ERROR);
-        if (!xfer_dcc_resume_hash (xfer))
-        {
-            gcry_md_close (*xfer->hash_handle);
-            free (xfer->hash_handle);
-            xfer->hash_handle = NULL;
-            xfer_network_write_pipe (xfer, XFER_STATUS_HASHING,
-                                     XFER_ERROR_HASH_RESUME_ERROR);
-        }
-        xfer_network_write_pipe (xfer, XFER_STATUS_CONNECTING,
-                                 XFER_NO_ERROR);
-    }
 
     /* first connect to sender (blocking) */
     xfer->sock = weechat_network_connect_to (xfer->proxy,
@@ -345,6 +627,22 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
         return;
     }
 
+    /*
+     * start writer: if resuming, the portion of the file we have is hashed
+     * by writer thread, while data is received
+     */
+    writer = xfer_writer_new (xfer->file, xfer->pos, XFER_WRITER_BUFFER_SIZE,
+                              xfer->hash_handle,
+                              (xfer->start_resume > 0) ?
+                              xfer->local_filename : NULL,
+                              xfer->start_resume);
+    if (!writer)
+    {
+        xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
+                                 XFER_ERROR_WRITE_LOCAL);
+        return;
+    }
+
     /* connection is OK, change DCC status (inform parent process) */
     xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
                              XFER_NO_ERROR);
@@ -355,36 +653,44 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
         flags = 0;
     fcntl (xfer->sock, F_SETFL, flags | O_NONBLOCK);
 
-    last_sent = time (NULL);
+    gettimeofday (&tv_last_progress, NULL);
     ack_enabled = 1;
-    pos_last_ack = 0;
+    ack_coalesce = -1;
+    pos_last_ack = xfer->pos;
 
     while (1)
     {
-        /* wait until there is something to read on socket (or error) */
+        /*
+         * wait until there is something to read on socket (or error), with a
+         * timeout if an ACK is delayed
+         */
         FD_ZERO (&read_fds);
         FD_ZERO (&write_fds);
         FD_ZERO (&except_fds);
         FD_SET (xfer->sock, &read_fds);
-        ready = select (xfer->sock + 1, &read_fds, &write_fds, &except_fds, NULL);
-        if (ready == 0)
+        tv_timeout.tv_sec = 0;
+        tv_timeout.tv_usec = XFER_DCC_RECV_ACK_DELAY * 1000;
+        ready = select (xfer->sock + 1, &read_fds, &write_fds, &except_fds,
+                        (xfer->pos > pos_last_ack) ? &tv_timeout : NULL);
+        if ((ready < 0) && (errno != EINTR))
         {
             xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
                                      XFER_ERROR_RECV_BLOCK);
-            return;
+            goto end;
         }
 
         /* read maximum data on socket (until nothing is available) */
-        while (1)
+        while (ready > 0)
         {
-            num_read = recv (xfer->sock, buffer, sizeof (buffer), 0);
+            ptr_buffer = xfer_writer_get_buffer (writer, &size);
+            num_read = recv (xfer->sock, ptr_buffer, size, 0);
             if (num_read == -1)
             {
                 if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
                 {
                     xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
                                              XFER_ERROR_RECV_BLOCK);
-                    return;
+                    goto end;
                 }
                 /*
                  * no more data available on socket: exit loop, send ACK, and
@@ -392,120 +698,99 @@ xfer_dcc_recv_file_child (struct t_xfer *xfer)
                  */
                 break;
             }
-            else
+
+            if ((num_read == 0) && (xfer->pos < xfer->size))
             {
-                if ((num_read == 0) && (xfer->pos < xfer->size))
+                xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
+                                         XFER_ERROR_RECV_BLOCK);
+                goto end;
+            }
+
+            /* bytes received, write to disk (by writer thread) */
+            if (xfer_writer_add (writer, num_read) != 0)
+            {
+                xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
+                                         XFER_ERROR_WRITE_LOCAL);
+                goto end;
+            }
+
+            xfer->pos += (unsigned long long) num_read;
+
+            /* file received OK? */
+            if (xfer->pos >= xfer->size)
+            {
+                if (xfer_writer_wait (writer) != 0)
                 {
                     xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                             XFER_ERROR_RECV_BLOCK);
-                    return;
+                                             XFER_ERROR_WRITE_LOCAL);
+                    goto end;
                 }
 
-                /* bytes received, write to disk */
-                total_written = 0;
-                while (total_written < num_read)
+                /* check hash and report result to pipe */
+                if (xfer->hash_handle)
                 {
-                    written = write (xfer->file,
-                                     buffer + total_written,
-                                     num_read - total_written);
-                    if (written < 0)
-                    {
-                        if (errno == EINTR)
-                            continue;
-                        xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                                 XFER_ERROR_WRITE_LOCAL);
-                        return;
-                    }
+                    if (xfer_writer_hash_error (writer))
+                        xfer_dcc_recv_file_hash_error (xfer);
                     else
-                    {
-                        if (xfer->hash_handle)
-                        {
-                            gcry_md_write (*xfer->hash_handle,
-                                           buffer + total_written,
-                                           written);
-                        }
-                        total_written += written;
-                    }
+                        xfer_dcc_recv_file_check_hash (xfer);
                 }
 
-                xfer->pos += (unsigned long long) num_read;
+                fsync (xfer->file);
 
-                /* file received OK? */
-                if (xfer->pos >= xfer->size)
-                {
-                    /* check hash and report result to pipe */
-                    if (xfer->hash_handle)
-                    {
-                        gcry_md_final (*xfer->hash_handle);
-                        bin_hash = gcry_md_read (*xfer->hash_handle, 0);
-                        if (bin_hash)
-                        {
-                            snprintf (hash, sizeof (hash), "%.2X%.2X%.2X%.2X",
-                                      bin_hash[0], bin_hash[1], bin_hash[2],
-                                      bin_hash[3]);
-                            if (weechat_strcasecmp (hash,
-                                                    xfer->hash_target) == 0)
-                            {
-                                xfer_network_write_pipe (xfer,
-                                                         XFER_STATUS_HASHED,
-                                                         XFER_NO_ERROR);
-                            }
-                            else
-                            {
-                                xfer_network_write_pipe (xfer,
-                                                         XFER_STATUS_HASHED,
-                                                         XFER_ERROR_HASH_MISMATCH);
-                            }
-                        }
-                    }
-
-                    fsync (xfer->file);
-
-                    /*
-                     * extra delay before sending ACK, otherwise the send of ACK
-                     * may fail
-                     */
-                    usleep (100000);
-
-                    /* send ACK to sender without checking return code (file OK) */
-                    xfer_dcc_recv_file_send_ack (xfer);
-
-                    /* set status done and return */
-                    xfer_network_write_pipe (xfer, XFER_STATUS_DONE,
-                                             XFER_NO_ERROR);
-                    return;
-                }
+                /*
+                 * extra delay before sending ACK, otherwise the send of ACK
+                 * may fail
+                 */
+                usleep (100000);
+
+                /* send ACK to sender without checking return code (file OK) */
+                xfer_dcc_recv_file_send_ack (xfer);
 
-                /* update status of DCC (parent process) */
-                new_time = time (NULL);
-                if (last_sent != new_time)
+                /* set status done and return */
+                xfer_network_write_pipe (xfer, XFER_STATUS_DONE,
+                                         XFER_NO_ERROR);
+                goto end;
+            }
+
+            /*
+             * if we received more than a block since last ACK, the sender
+             * does not wait for our ACKs (fast send): ACKs can be coalesced
+             */
+            if (xfer->pos - pos_last_ack > XFER_BLOCKSIZE_MAX)
+                ack_coalesce = 1;
+
+            /* with fast send, the socket may never be empty: ACK now */
+            if (ack_enabled && (ack_coalesce > 0)
+                && (xfer->pos - pos_last_ack >= XFER_DCC_RECV_ACK_INTERVAL))
+            {
+                if (!xfer_dcc_recv_file_ack (xfer, &ack_enabled,
+                                             &pos_last_ack))
                 {
-                    last_sent = new_time;
-                    xfer_network_write_pipe (xfer, XFER_STATUS_ACTIVE,
-                                             XFER_NO_ERROR);
+                    goto end;
                 }
             }
+
+            xfer_dcc_recv_file_progress (xfer, writer, &tv_last_progress);
         }
 
-        /* send ACK to sender (if needed) */
-        if (ack_enabled && (xfer->pos > pos_last_ack))
+        /*
+         * socket is empty (or no data received during a delay): send ACK to
+         * sender if needed; if we don't know yet if the sender waits for ACKs
+         * (or if it does not wait), the ACK is delayed: if no data is received
+         * during the delay, then the sender is waiting for our ACK
+         */
+        if (ack_enabled && (xfer->pos > pos_last_ack)
+            && ((ack_coalesce == 0) || (ready == 0)))
         {
-            switch (xfer_dcc_recv_file_send_ack (xfer))
-            {
-                case 0:
-                    /* send error, socket down? */
-                    xfer_network_write_pipe (xfer, XFER_STATUS_FAILED,
-                                             XFER_ERROR_SEND_ACK);
-                    return;
-                case 1:
-                    /* send error, not fatal (buffer full?): disable ACKs */
-                    ack_enabled = 0;
-                    break;
-                case 2:
-                    /* send OK: save position in file as last ACK sent */
-                    pos_last_ack = xfer->pos;
-                    break;
-            }
+            if (ack_coalesce < 0)
+                ack_coalesce = 0;
+            if (!xfer_dcc_recv_file_ack (xfer, &ack_enabled, &pos_last_ack))
+                goto end;
         }
+
+        xfer_dcc_recv_file_progress (xfer, writer, &tv_last_progress);
     }
+
+end:
+    xfer_writer_free (writer);
 }
@@ -20,7 +20,27 @@
 #ifndef WEECHAT_XFER_DCC_H
 #define WEECHAT_XFER_DCC_H 1
 
-extern void xfer_dcc_send_file_child (struct t_xfer *xfer);
+/* timer for files sent: refill of tokens (speed limit), in milliseconds */
+#define XFER_DCC_SEND_TIMER_INTERVAL 100
+
+/* max burst allowed by speed limit (in milliseconds of transfer) */
+#define XFER_DCC_SEND_BURST 200
+
+/*
+ * max bytes sent each time the socket is ready for write (socket stays
+ * watched for write, so the file is sent on next calls)
+ */
+#define XFER_DCC_SEND_MAX_LENGTH (256 * 1024)
+
+/* receive: max delay and interval (in bytes) for ACKs with fast send */
+#define XFER_DCC_RECV_ACK_DELAY 50
+#define XFER_DCC_RECV_ACK_INTERVAL (256 * 1024)
+
+/* receive: interval for progress sent to parent (in milliseconds) */
+#define XFER_DCC_RECV_PROGRESS_INTERVAL 1000
+
+extern int xfer_dcc_send_file_cb (void *arg_xfer, int fd);
+extern void xfer_dcc_send_file_start (struct t_xfer *xfer);
 extern void xfer_dcc_recv_file_child (struct t_xfer *xfer);
 
 #endif /* WEECHAT_XFER_DCC_H */
@@ -88,6 +88,110 @@ xfer_network_write_pipe (struct t_xfer *xfer, int status, int error)
     (void) num_written;
 }
 
+/*
+ * Updates status of a xfer file: displays error (if any) and sets new status.
+ *
+ * This function is called with the status received from child process, or
+ * directly when the file is sent in WeeChat process.
+ */
+
+void
+xfer_network_update_status (struct t_xfer *xfer, int status, int error)
+{
+    /* display error */
+    switch (error)
+    {
+        /* errors for sender */
+        case XFER_ERROR_READ_LOCAL:
+            weechat_printf (NULL,
+                            _("%s%s: unable to read local file"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        case XFER_ERROR_SEND_BLOCK:
+            weechat_printf (NULL,
+                            _("%s%s: unable to send block to receiver"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        case XFER_ERROR_READ_ACK:
+            weechat_printf (NULL,
+                            _("%s%s: unable to read ACK from receiver"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        /* errors for receiver */
+        case XFER_ERROR_CONNECT_SENDER:
+            weechat_printf (NULL,
+                            _("%s%s: unable to connect to sender"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        case XFER_ERROR_RECV_BLOCK:
+            weechat_printf (NULL,
+                            _("%s%s: unable to receive block from sender"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        case XFER_ERROR_WRITE_LOCAL:
+            weechat_printf (NULL,
+                            _("%s%s: unable to write local file"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        case XFER_ERROR_SEND_ACK:
+            weechat_printf (NULL,
+                            _("%s%s: unable to send ACK to sender"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            break;
+        case XFER_ERROR_HASH_MISMATCH:
+            weechat_printf (NULL,
+                            _("%s%s: wrong CRC32 for file %s"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME,
+                            xfer->filename);
+            xfer->hash_status = XFER_HASH_STATUS_MISMATCH;
+            break;
+        case XFER_ERROR_HASH_RESUME_ERROR:
+            weechat_printf (NULL,
+                            _("%s%s: CRC32 error while resuming"),
+                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
+            xfer->hash_status = XFER_HASH_STATUS_RESUME_ERROR;
+            break;
+    }
+
+    /* set new status */
+    switch (status)
+    {
+        case XFER_STATUS_CONNECTING:
+            xfer->status = XFER_STATUS_CONNECTING;
+            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+            break;
+        case XFER_STATUS_ACTIVE:
+            if (xfer->status == XFER_STATUS_CONNECTING)
+            {
+                /* connection was successful by child, init transfer times */
+                xfer->status = XFER_STATUS_ACTIVE;
+                xfer->start_transfer = time (NULL);
+                xfer->last_check_time = time (NULL);
+                xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+            }
+            else
+                xfer_buffer_refresh (WEECHAT_HOTLIST_LOW);
+            break;
+        case XFER_STATUS_DONE:
+            xfer_close (xfer, XFER_STATUS_DONE);
+            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+            break;
+        case XFER_STATUS_FAILED:
+            xfer_close (xfer, XFER_STATUS_FAILED);
+            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+            break;
+        case XFER_STATUS_HASHING:
+            xfer->status = XFER_STATUS_HASHING;
+            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+            break;
+        case XFER_STATUS_HASHED:
+            if (error == XFER_NO_ERROR)
+                xfer->hash_status = XFER_HASH_STATUS_MATCH;
+            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
+            break;
+    }
+}
+
 /*
  * Reads data from child via pipe.
  */
@@ -111,145 +215,22 @@ xfer_network_child_read_cb (void *arg_xfer, int fd)
         xfer->last_activity = time (NULL);
         xfer_file_calculate_speed (xfer, 0);
 
-        /* read error code */
-        switch (bufpipe[1] - '0')
-        {
-            /* errors for sender */
-            case XFER_ERROR_READ_LOCAL:
-                weechat_printf (NULL,
-                                _("%s%s: unable to read local file"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            case XFER_ERROR_SEND_BLOCK:
-                weechat_printf (NULL,
-                                _("%s%s: unable to send block to receiver"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            case XFER_ERROR_READ_ACK:
-                weechat_printf (NULL,
-                                _("%s%s: unable to read ACK from receiver"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            /* errors for receiver */
-            case XFER_ERROR_CONNECT_SENDER:
-                weechat_printf (NULL,
-                                _("%s%s: unable to connect to sender"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            case XFER_ERROR_RECV_BLOCK:
-                weechat_printf (NULL,
-                                _("%s%s: unable to receive block from sender"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            case XFER_ERROR_WRITE_LOCAL:
-                weechat_printf (NULL,
-                                _("%s%s: unable to write local file"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            case XFER_ERROR_SEND_ACK:
-                weechat_printf (NULL,
-                                _("%s%s: unable to send ACK to sender"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                break;
-            case XFER_ERROR_HASH_MISMATCH:
-                weechat_printf (NULL,
-                                _("%s%s: wrong CRC32 for file %s"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME,
-                                xfer->filename);
-                xfer->hash_status = XFER_HASH_STATUS_MISMATCH;
-                break;
-            case XFER_ERROR_HASH_RESUME_ERROR:
-                weechat_printf (NULL,
-                                _("%s%s: CRC32 error while resuming"),
-                                weechat_prefix ("error"), XFER_PLUGIN_NAME);
-                xfer->hash_status = XFER_HASH_STATUS_RESUME_ERROR;
-                break;
-        }
-
-        /* read new DCC status */
-        switch (bufpipe[0] - '0')
-        {
-            case XFER_STATUS_CONNECTING:
-                xfer->status = XFER_STATUS_CONNECTING;
-                xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-                break;
-            case XFER_STATUS_ACTIVE:
-                if (xfer->status == XFER_STATUS_CONNECTING)
-                {
-                    /* connection was successful by child, init transfer times */
-                    xfer->status = XFER_STATUS_ACTIVE;
-                    xfer->start_transfer = time (NULL);
-                    xfer->last_check_time = time (NULL);
-                    xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-                }
-                else
-                    xfer_buffer_refresh (WEECHAT_HOTLIST_LOW);
-                break;
-            case XFER_STATUS_DONE:
-                xfer_close (xfer, XFER_STATUS_DONE);
-                xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-                break;
-            case XFER_STATUS_FAILED:
-                xfer_close (xfer, XFER_STATUS_FAILED);
-                xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-                break;
-            case XFER_STATUS_HASHING:
-                xfer->status = XFER_STATUS_HASHING;
-                xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-                break;
-            case XFER_STATUS_HASHED:
-                if (bufpipe[1] - '0' == XFER_NO_ERROR)
-                    xfer->hash_status = XFER_HASH_STATUS_MATCH;
-                xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-                break;
-        }
+        xfer_network_update_status (xfer, bufpipe[0] - '0', bufpipe[1] - '0');
     }
 
     return WEECHAT_RC_OK;
 }
 
 /*
- * Forks process for sending file.
+ * Starts sending of file.
+ *
+ * The file is sent in WeeChat process (no child process is created): the
+ * socket is non-blocking and all transfers are handled by fd hooks.
  */
 
 void
-xfer_network_send_file_fork (struct t_xfer *xfer)
+xfer_network_send_file (struct t_xfer *xfer)
 {
-    pid_t pid;
-    int rc;
-
-    if (!xfer_network_create_pipe (xfer))
-        return;
-
-    xfer->file = open (xfer->local_filename, O_RDONLY | O_NONBLOCK, 0644);
-
-    switch (pid = fork ())
-    {
-        case -1:  /* fork failed */
-            weechat_printf (NULL,
-                            _("%s%s: unable to fork"),
-                            weechat_prefix ("error"), XFER_PLUGIN_NAME);
-            xfer_close (xfer, XFER_STATUS_FAILED);
-            xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-            return;
-        case 0:  /* child process */
-            rc = setuid (getuid ());
-            (void) rc;
-            close (xfer->child_read);
-            switch (xfer->protocol)
-            {
-                case XFER_NO_PROTOCOL:
-                    _exit (EXIT_SUCCESS);
-                    break;
-                case XFER_PROTOCOL_DCC:
-                    xfer_dcc_send_file_child (xfer);
-                    break;
-                case XFER_NUM_PROTOCOLS:
-                    break;
-            }
-            _exit (EXIT_SUCCESS);
-    }
-
     weechat_printf (NULL,
                     _("%s: sending file to %s (%s, %s.%s), "
                       "name: %s (local filename: %s), %llu bytes (protocol: %s)"),
@@ -263,14 +244,26 @@ xfer_network_send_file_fork (struct t_xfer *xfer)
                     xfer->size,
                     xfer_protocol_string[xfer->protocol]);
 
-    /* parent process */
-    xfer->child_pid = pid;
-    close (xfer->child_write);
-    xfer->child_write = -1;
-    xfer->hook_fd = weechat_hook_fd (xfer->child_read,
-                                     1, 0, 0,
-                                     &xfer_network_child_read_cb,
-                                     xfer);
+    xfer->file = open (xfer->local_filename, O_RDONLY | O_NONBLOCK, 0644);
+    if (xfer->file < 0)
+    {
+        xfer_network_update_status (xfer, XFER_STATUS_FAILED,
+                                    XFER_ERROR_READ_LOCAL);
+        return;
+    }
+
+    switch (xfer->protocol)
+    {
+        case XFER_NO_PROTOCOL:
+            xfer_network_update_status (xfer, XFER_STATUS_DONE,
+                                        XFER_NO_ERROR);
+            break;
+        case XFER_PROTOCOL_DCC:
+            xfer_dcc_send_file_start (xfer);
+            break;
+        case XFER_NUM_PROTOCOLS:
+            break;
+    }
 }
 
 /*
@@ -286,9 +279,10 @@ xfer_network_recv_file_fork (struct t_xfer *xfer)
     if (!xfer_network_create_pipe (xfer))
         return;
 
+    /* data is written at its position in file (with pwrite) */
     if (xfer->start_resume > 0)
         xfer->file = open (xfer->local_filename,
-                           O_APPEND | O_WRONLY | O_NONBLOCK);
+                           O_WRONLY | O_NONBLOCK);
     else
         xfer->file = open (xfer->local_filename,
                            O_CREAT | O_TRUNC | O_WRONLY | O_NONBLOCK,
@@ -429,7 +423,7 @@ xfer_network_fd_cb (void *arg_xfer, int fd)
             xfer->status = XFER_STATUS_ACTIVE;
             xfer->start_transfer = time (NULL);
             xfer_buffer_refresh (WEECHAT_HOTLIST_MESSAGE);
-            xfer_network_send_file_fork (xfer);
+            xfer_network_send_file (xfer);
         }
     }
 
@@ -22,6 +22,8 @@
 
 extern void xfer_network_write_pipe (struct t_xfer *xfer, int status,
                                      int error);
+extern void xfer_network_update_status (struct t_xfer *xfer, int status,
+                                        int error);
 extern void xfer_network_connect_init (struct t_xfer *xfer);
 extern void xfer_network_child_kill (struct t_xfer *xfer);
 extern int xfer_network_connect (struct t_xfer *xfer);
@@ -0,0 +1,461 @@
+/*
+ * xfer-writer.c - background writer for files received
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Data received is stored directly in a large aligned buffer; when the buffer
+ * is full, it is sent to a writer thread which writes it with pwrite and adds
+ * it to the CRC32 hash, while data is received in the other buffer.
+ *
+ * When a file is resumed, the writer thread first hashes the part of file
+ * already received, so the receive starts immediately (data received is
+ * hashed after, in order).
+ *
+ * The writer thread does not call any WeeChat function (it is used in the
+ * child process receiving the file).
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <gcrypt.h>
+
+#include "xfer-writer.h"
+
+
+/*
+ * Hashes the beginning of a file (part of a resumed file already received).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+xfer_writer_hash_file (const char *filename, unsigned long long size,
+                       gcry_md_hd_t *hash_handle)
+{
+    char *buf;
+    unsigned long long total_read;
+    ssize_t length_buf, to_read, num_read;
+    int ret, fd;
+
+    total_read = 0;
+    ret = 1;
+
+    length_buf = 1024 * 1024;
+    buf = malloc (length_buf);
+    if (!buf)
+        return 0;
+
+    while (1)
+    {
+        fd = open (filename, O_RDONLY);
+        if ((fd >= 0) || (errno != EINTR))
+            break;
+    }
+
+    if (fd < 0)
+    {
+        free (buf);
+        return 0;
+    }
+
+    while (total_read < size)
+    {
+        to_read = size - total_read;
+        if (to_read > length_buf)
+            to_read = length_buf;
+        num_read = read (fd, buf, to_read);
+        if (num_read > 0)
+        {
+            gcry_md_write (*hash_handle, buf, num_read);
+            total_read += num_read;
+        }
+        else
+        {
+            if ((num_read < 0) && (errno == EINTR))
+                continue;
+            ret = 0;
+            break;
+        }
+    }
+
+    while (close (fd) < 0)
+    {
+        if (errno != EINTR)
+            break;
+    }
+
+    free (buf);
+
+    return ret;
+}
+
+/*
+ * Writes data in file at an offset (partial writes are retried).
+ *
+ * Returns 0 if OK, errno value if error.
+ */
+
+int
+xfer_writer_pwrite (int fd, const char *data, int length,
+                    unsigned long long offset)
+{
+    ssize_t num_written;
+
+    while (length > 0)
+    {
+        num_written = pwrite (fd, data, length, (off_t)offset);
+        if (num_written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        data += num_written;
+        length -= num_written;
+        offset += num_written;
+    }
+
+    return 0;
+}
+
+/*
+ * Writes a buffer in file and adds it to the hash.
+ *
+ * Returns 0 if OK, errno value if error.
+ */
+
+int
+xfer_writer_process (struct t_xfer_writer *writer, int index, int length,
+                     unsigned long long offset)
+{
+    int rc;
+
+    rc = xfer_writer_pwrite (writer->fd, writer->buffer[index], length,
+                             offset);
+
+    if (writer->hash_handle && !writer->hash_error)
+        gcry_md_write (*writer->hash_handle, writer->buffer[index], length);
+
+    return rc;
+}
+
+/*
+ * Main function of writer thread.
+ */
+
+void *
+xfer_writer_thread (void *arg)
+{
+    struct t_xfer_writer *writer;
+    int index, length, rc;
+    unsigned long long offset;
+
+    writer = (struct t_xfer_writer *)arg;
+
+    if (writer->resume_filename && writer->hash_handle)
+    {
+        rc = xfer_writer_hash_file (writer->resume_filename,
+                                    writer->resume_size,
+                                    writer->hash_handle);
+        pthread_mutex_lock (&writer->mutex);
+        if (!rc)
+            writer->hash_error = 1;
+        writer->resume_done = 1;
+        pthread_cond_broadcast (&writer->cond);
+        pthread_mutex_unlock (&writer->mutex);
+    }
+
+    pthread_mutex_lock (&writer->mutex);
+    while (1)
+    {
+        while ((writer->pending < 0) && !writer->stop)
+        {
+            pthread_cond_wait (&writer->cond, &writer->mutex);
+        }
+        if (writer->pending < 0)
+            break;
+
+        index = writer->pending;
+        length = writer->pending_length;
+        offset = writer->pending_offset;
+        pthread_mutex_unlock (&writer->mutex);
+
+        rc = xfer_writer_process (writer, index, length, offset);
+
+        pthread_mutex_lock (&writer->mutex);
+        if ((rc != 0) && (writer->error == 0))
+            writer->error = rc;
+        writer->pending = -1;
+        pthread_cond_broadcast (&writer->cond);
+    }
+    pthread_mutex_unlock (&writer->mutex);
+
+    return NULL;
+}
+
+/*
+ * Creates a writer for a file received and starts writer thread (if the
+ * thread can not be created, data is written by caller, in function
+ * xfer_writer_flush).
+ *
+ * Argument "offset" is the position in file of first byte received.
+ * If "resume_filename" is not NULL, the first "resume_size" bytes of this
+ * file are added to the hash before data received.
+ *
+ * Returns pointer to new writer, NULL if error.
+ */
+
+struct t_xfer_writer *
+xfer_writer_new (int fd, unsigned long long offset, int buffer_size,
+                 gcry_md_hd_t *hash_handle, const char *resume_filename,
+                 unsigned long long resume_size)
+{
+    struct t_xfer_writer *new_writer;
+    int i;
+
+    if ((fd < 0) || (buffer_size <= 0))
+        return NULL;
+
+    new_writer = malloc (sizeof (*new_writer));
+    if (!new_writer)
+        return NULL;
+
+    new_writer->fd = fd;
+    new_writer->hash_handle = hash_handle;
+    new_writer->resume_filename = (resume_filename) ?
+        strdup (resume_filename) : NULL;
+    new_writer->resume_size = resume_size;
+    new_writer->buffer_size = buffer_size;
+    for (i = 0; i < 2; i++)
+    {
+        if (posix_memalign ((void **)&new_writer->buffer[i],
+                            XFER_WRITER_BUFFER_ALIGN, buffer_size) != 0)
+        {
+            new_writer->buffer[i] = NULL;
+        }
+    }
+    if (!new_writer->buffer[0] || !new_writer->buffer[1])
+    {
+        if (new_writer->buffer[0])
+            free (new_writer->buffer[0]);
+        if (new_writer->buffer[1])
+            free (new_writer->buffer[1]);
+        if (new_writer->resume_filename)
+            free (new_writer->resume_filename);
+        free (new_writer);
+        return NULL;
+    }
+    new_writer->current = 0;
+    new_writer->length = 0;
+    new_writer->offset = offset;
+    new_writer->running = 0;
+    pthread_mutex_init (&new_writer->mutex, NULL);
+    pthread_cond_init (&new_writer->cond, NULL);
+    new_writer->pending = -1;
+    new_writer->pending_length = 0;
+    new_writer->pending_offset = 0;
+    new_writer->stop = 0;
+    new_writer->error = 0;
+    new_writer->hash_error = 0;
+    new_writer->resume_done = (new_writer->resume_filename
+                               && new_writer->hash_handle) ? 0 : 1;
+
+    if (pthread_create (&new_writer->thread_id, NULL,
+                        &xfer_writer_thread, new_writer) == 0)
+    {
+        new_writer->running = 1;
+    }
+    else if (new_writer->resume_filename && new_writer->hash_handle)
+    {
+        /* no writer thread: hash resumed file now */
+        if (!xfer_writer_hash_file (new_writer->resume_filename,
+                                    new_writer->resume_size,
+                                    new_writer->hash_handle))
+        {
+            new_writer->hash_error = 1;
+        }
+        new_writer->resume_done = 1;
+    }
+
+    return new_writer;
+}
+
+/*
+ * Returns pointer to free space in current buffer, where data received can
+ * be stored, and size of this space (always greater than 0).
+ */
+
+char *
+xfer_writer_get_buffer (struct t_xfer_writer *writer, int *size)
+{
+    *size = writer->buffer_size - writer->length;
+
+    return writer->buffer[writer->current] + writer->length;
+}
+
+/*
+ * Adds data stored in current buffer (after a call to xfer_writer_get_buffer)
+ * and sends the buffer to writer thread if it is full.
+ *
+ * Returns 0 if OK, errno value if a write error occurred.
+ */
+
+int
+xfer_writer_add (struct t_xfer_writer *writer, int length)
+{
+    writer->length += length;
+
+    if (writer->length >= writer->buffer_size)
+        return xfer_writer_flush (writer);
+
+    return 0;
+}
+
+/*
+ * Sends data of current buffer to writer thread (waits if the other buffer
+ * is still being written), then uses the other buffer for data received.
+ *
+ * Returns 0 if OK, errno value if a write error occurred.
+ */
+
+int
+xfer_writer_flush (struct t_xfer_writer *writer)
+{
+    int error;
+
+    if (!writer->running)
+    {
+        /* no writer thread: write data now */
+        if (writer->length > 0)
+        {
+            error = xfer_writer_process (writer, writer->current,
+                                         writer->length, writer->offset);
+            if ((error != 0) && (writer->error == 0))
+                writer->error = error;
+            writer->offset += writer->length;
+            writer->length = 0;
+        }
+        return writer->error;
+    }
+
+    pthread_mutex_lock (&writer->mutex);
+    if (writer->length > 0)
+    {
+        while (writer->pending >= 0)
+        {
+            pthread_cond_wait (&writer->cond, &writer->mutex);
+        }
+        writer->pending = writer->current;
+        writer->pending_length = writer->length;
+        writer->pending_offset = writer->offset;
+        pthread_cond_broadcast (&writer->cond);
+        writer->offset += writer->length;
+        writer->length = 0;
+        writer->current = 1 - writer->current;
+    }
+    error = writer->error;
+    pthread_mutex_unlock (&writer->mutex);
+
+    return error;
+}
+
+/*
+ * Writes all data received and waits until it is written (and hashed, with
+ * the resumed part of file).
+ *
+ * Returns 0 if OK, errno value if a write error occurred.
+ */
+
+int
+xfer_writer_wait (struct t_xfer_writer *writer)
+{
+    int error;
+
+    error = xfer_writer_flush (writer);
+    if (!writer->running)
+        return error;
+
+    pthread_mutex_lock (&writer->mutex);
+    while ((writer->pending >= 0) || !writer->resume_done)
+    {
+        pthread_cond_wait (&writer->cond, &writer->mutex);
+    }
+    error = writer->error;
+    pthread_mutex_unlock (&writer->mutex);
+
+    return error;
+}
+
+/*
+ * Checks if hash of resumed file failed.
+ *
+ * Returns:
+ *   1: hash of resumed file failed (hash must not be used)
+ *   0: hash OK (or not yet computed)
+ */
+
+int
+xfer_writer_hash_error (struct t_xfer_writer *writer)
+{
+    int hash_error;
+
+    pthread_mutex_lock (&writer->mutex);
+    hash_error = writer->hash_error;
+    pthread_mutex_unlock (&writer->mutex);
+
+    return hash_error;
+}
+
+/*
+ * Stops writer thread (pending data is written) and frees writer.
+ */
+
+void
+xfer_writer_free (struct t_xfer_writer *writer)
+{
+    if (!writer)
+        return;
+
+    if (writer->running)
+    {
+        pthread_mutex_lock (&writer->mutex);
+        writer->stop = 1;
+        pthread_cond_broadcast (&writer->cond);
+        pthread_mutex_unlock (&writer->mutex);
+        pthread_join (writer->thread_id, NULL);
+        writer->running = 0;
+    }
+
+    pthread_mutex_destroy (&writer->mutex);
+    pthread_cond_destroy (&writer->cond);
+    free (writer->buffer[0]);
+    free (writer->buffer[1]);
+    if (writer->resume_filename)
+        free (writer->resume_filename);
+
+    free (writer);
+}
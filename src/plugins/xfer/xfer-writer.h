@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_XFER_WRITER_H
+#define WEECHAT_XFER_WRITER_H 1
+
+#include <pthread.h>
+#include <gcrypt.h>
+
+/* size of each buffer (data received is written when a buffer is full) */
+#define XFER_WRITER_BUFFER_SIZE (1024 * 1024)
+
+/* alignment of buffers in memory */
+#define XFER_WRITER_BUFFER_ALIGN 4096
+
+struct t_xfer_writer
+{
+    int fd;                            /* file descriptor (file received)   */
+    gcry_md_hd_t *hash_handle;         /* CRC32 hash (NULL if no hash)      */
+    char *resume_filename;             /* file hashed before data (resume)  */
+    unsigned long long resume_size;    /* size of file to hash (resume)     */
+    int buffer_size;                   /* size of each buffer               */
+    char *buffer[2];                   /* aligned buffers (filled/written)  */
+    int current;                       /* buffer filled by receiver (0/1)   */
+    int length;                        /* length of data in current buffer  */
+    unsigned long long offset;         /* offset in file of current buffer  */
+    pthread_t thread_id;               /* writer thread                     */
+    int running;                       /* 1 if writer thread is running     */
+    pthread_mutex_t mutex;             /* mutex for data below              */
+    pthread_cond_t cond;               /* signaled when pending changes     */
+    int pending;                       /* buffer being written (-1 if none) */
+    int pending_length;                /* length of data to write           */
+    unsigned long long pending_offset; /* offset in file of data to write   */
+    int stop;                          /* 1 if writer thread must stop      */
+    int error;                         /* errno of write error (0 if OK)    */
+    int hash_error;                    /* 1 if hash of resumed file failed  */
+    int resume_done;                   /* 1 if resumed file has been hashed */
+};
+
+extern struct t_xfer_writer *xfer_writer_new (int fd,
+                                              unsigned long long offset,
+                                              int buffer_size,
+                                              gcry_md_hd_t *hash_handle,
+                                              const char *resume_filename,
+                                              unsigned long long resume_size);
+extern char *xfer_writer_get_buffer (struct t_xfer_writer *writer,
+                                     int *size);
+extern int xfer_writer_add (struct t_xfer_writer *writer, int length);
+extern int xfer_writer_flush (struct t_xfer_writer *writer);
+extern int xfer_writer_wait (struct t_xfer_writer *writer);
+extern int xfer_writer_hash_error (struct t_xfer_writer *writer);
+extern void xfer_writer_free (struct t_xfer_writer *writer);
+
+#endif /* WEECHAT_XFER_WRITER_H */
@@ -485,6 +485,10 @@ xfer_alloc ()
     new_xfer->filename_suffix = -1;
     new_xfer->pos = 0;
     new_xfer->ack = 0;
+    new_xfer->ack_length = 0;
+    new_xfer->send_write = 0;
+    new_xfer->send_tokens = 0;
+    new_xfer->sent_ok = 0;
     new_xfer->start_resume = 0;
     new_xfer->last_check_time = time_now;
     new_xfer->last_check_pos = time_now;
@@ -1585,6 +1589,13 @@ xfer_add_to_infolist (struct t_infolist *infolist, struct t_xfer *xfer)
     snprintf (value, sizeof (value), "%llu", xfer->ack);
     if (!weechat_infolist_new_var_string (ptr_item, "ack", value))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "send_write", xfer->send_write))
+        return 0;
+    snprintf (value, sizeof (value), "%lld", xfer->send_tokens);
+    if (!weechat_infolist_new_var_string (ptr_item, "send_tokens", value))
+        return 0;
+    if (!weechat_infolist_new_var_time (ptr_item, "sent_ok", xfer->sent_ok))
+        return 0;
     snprintf (value, sizeof (value), "%llu", xfer->start_resume);
     if (!weechat_infolist_new_var_string (ptr_item, "start_resume", value))
         return 0;
@@ -1667,6 +1678,10 @@ xfer_print_log ()
         weechat_log_printf ("  filename_suffix . . . . : %d",    ptr_xfer->filename_suffix);
         weechat_log_printf ("  pos . . . . . . . . . . : %llu",  ptr_xfer->pos);
         weechat_log_printf ("  ack . . . . . . . . . . : %llu",  ptr_xfer->ack);
+        weechat_log_printf ("  ack_length. . . . . . . : %d",    ptr_xfer->ack_length);
+        weechat_log_printf ("  send_write. . . . . . . : %d",    ptr_xfer->send_write);
+        weechat_log_printf ("  send_tokens . . . . . . : %lld",  ptr_xfer->send_tokens);
+        weechat_log_printf ("  sent_ok . . . . . . . . : %ld",   ptr_xfer->sent_ok);
         weechat_log_printf ("  start_resume. . . . . . : %llu",  ptr_xfer->start_resume);
         weechat_log_printf ("  last_check_time . . . . : %ld",   ptr_xfer->last_check_time);
         weechat_log_printf ("  last_check_pos. . . . . : %llu",  ptr_xfer->last_check_pos);
@@ -169,6 +169,11 @@ struct t_xfer
     int filename_suffix;               /* suffix (like .1) if renaming file */
     unsigned long long pos;            /* number of bytes received/sent     */
     unsigned long long ack;            /* number of bytes received OK       */
+    unsigned char ack_buffer[4];       /* partial ACK read (file send)      */
+    int ack_length;                    /* length of partial ACK             */
+    int send_write;                    /* 1 if socket is hooked for write   */
+    long long send_tokens;             /* bytes allowed by speed limit      */
+    time_t sent_ok;                    /* time when whole file was sent     */
     unsigned long long start_resume;   /* start of resume (in bytes)        */
     time_t last_check_time;            /* last time we checked bytes snt/rcv*/
     unsigned long long last_check_pos; /* bytes sent/recv at last check     */
@@ -0,0 +1,437 @@
+/*
+ * process-benchmark.c - latency benchmark for process hooks (fork/spawn)
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program starts WeeChat headless (with the fake ncurses library),
+ * grows its memory (resident set size) to the given sizes, and for each size
+ * runs a command many times with hook_process_hashtable, started with fork
+ * then with posix_spawn (option "spawn"). It measures:
+ *   - launch time: time spent in hook_process_hashtable (main loop is
+ *     blocked during this time),
+ *   - total time: time until the end of process is received by callback.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/select.h>
+
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include "src/core/weechat.h"
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-input.h"
+#include "src/gui/gui-main.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/plugin.h"
+
+#define BENCH_MAX_SIZES 16
+
+struct t_bench_result
+{
+    const char *mode;                  /* "fork" or "posix_spawn"           */
+    int runs;                          /* number of processes run           */
+    int errors;                        /* processes ended with an error     */
+    double launch_p50;                 /* launch time percentile 50 (in ms) */
+    double launch_p99;                 /* launch time percentile 99 (in ms) */
+    double total_p50;                  /* total time percentile 50 (in ms)  */
+    double total_p99;                  /* total time percentile 99 (in ms)  */
+};
+
+int bench_num_runs = 50;               /* number of processes per mode      */
+const char *bench_command = "true";    /* command executed                  */
+long bench_sizes[BENCH_MAX_SIZES] =    /* memory sizes (in MB)              */
+{ 100, 1024, 4096 };
+int bench_num_sizes = 3;               /* number of sizes                   */
+
+char *bench_ballast = NULL;            /* memory allocated to grow RSS      */
+long bench_ballast_size = 0;           /* size of ballast (in MB)           */
+volatile int bench_process_done = 0;   /* 1 when process has ended          */
+int bench_process_rc = 0;              /* return code of process            */
+
+extern void gui_main_init ();
+
+
+/*
+ * Returns current time, in microseconds.
+ */
+
+long long
+bench_time ()
+{
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return ((long long)tv.tv_sec * 1000000LL) + (long long)tv.tv_usec;
+}
+
+/*
+ * Returns resident set size of current process (in MB), -1 if error.
+ */
+
+long
+bench_rss ()
+{
+    FILE *f;
+    long size, resident;
+
+    f = fopen ("/proc/self/statm", "r");
+    if (!f)
+        return -1;
+    if (fscanf (f, "%ld %ld", &size, &resident) != 2)
+        resident = -1;
+    fclose (f);
+
+    return (resident < 0) ?
+        -1 : (long)(((long long)resident * sysconf (_SC_PAGESIZE))
+                    / (1024 * 1024));
+}
+
+/*
+ * Grows memory used by the process to "size" MB (all pages are written, so
+ * that they are resident).
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_ballast_grow (long size)
+{
+    char *new_ballast;
+    long i, page_size;
+
+    if (size <= bench_ballast_size)
+        return 1;
+
+    new_ballast = realloc (bench_ballast, (size_t)size * 1024 * 1024);
+    if (!new_ballast)
+        return 0;
+    bench_ballast = new_ballast;
+
+    page_size = sysconf (_SC_PAGESIZE);
+    for (i = bench_ballast_size * 1024 * 1024;
+         i < size * 1024 * 1024; i += page_size)
+    {
+        bench_ballast[i] = (char)i;
+    }
+    bench_ballast_size = size;
+
+    return 1;
+}
+
+/*
+ * Runs main loop once (timers and file descriptors).
+ */
+
+void
+bench_loop_once (long timeout_us)
+{
+    fd_set read_fds, write_fds, except_fds;
+    struct timeval tv_timeout;
+    int max_fd, ready;
+
+    hook_timer_exec ();
+
+    FD_ZERO (&read_fds);
+    FD_ZERO (&write_fds);
+    FD_ZERO (&except_fds);
+    max_fd = hook_fd_set (&read_fds, &write_fds, &except_fds);
+    hook_timer_time_to_next (&tv_timeout);
+    if ((tv_timeout.tv_sec > 0) || (tv_timeout.tv_usec > timeout_us))
+    {
+        tv_timeout.tv_sec = 0;
+        tv_timeout.tv_usec = timeout_us;
+    }
+    ready = select (max_fd + 1, &read_fds, &write_fds, &except_fds,
+                    &tv_timeout);
+    if (ready > 0)
+        hook_fd_exec (&read_fds, &write_fds, &except_fds);
+}
+
+/*
+ * Callback for process hook.
+ */
+
+int
+bench_process_cb (void *data, const char *command, int return_code,
+                  const char *out, const char *err)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) command;
+    (void) out;
+    (void) err;
+
+    if (return_code == WEECHAT_HOOK_PROCESS_RUNNING)
+        return WEECHAT_RC_OK;
+
+    bench_process_rc = return_code;
+    bench_process_done = 1;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Compares two times (for qsort).
+ */
+
+int
+bench_cmp_time (const void *value1, const void *value2)
+{
+    long long time1, time2;
+
+    time1 = *((const long long *)value1);
+    time2 = *((const long long *)value2);
+    if (time1 < time2)
+        return -1;
+    return (time1 > time2) ? 1 : 0;
+}
+
+/*
+ * Runs the command "bench_num_runs" times with a mode ("fork" or
+ * "posix_spawn").
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_run (const char *mode, struct t_bench_result *result)
+{
+    struct t_hashtable *options;
+    long long *launch, *total, time_start, time_launched;
+    int i;
+
+    memset (result, 0, sizeof (*result));
+    result->mode = mode;
+
+    launch = malloc (bench_num_runs * sizeof (launch[0]));
+    total = malloc (bench_num_runs * sizeof (total[0]));
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    if (!launch || !total || !options)
+    {
+        if (launch)
+            free (launch);
+        if (total)
+            free (total);
+        if (options)
+            hashtable_free (options);
+        return 0;
+    }
+    hashtable_set (options, "spawn", mode);
+
+    for (i = 0; i < bench_num_runs; i++)
+    {
+        bench_process_done = 0;
+        time_start = bench_time ();
+        hook_process_hashtable (NULL, bench_command, options, 0,
+                                &bench_process_cb, NULL);
+        time_launched = bench_time ();
+        while (!bench_process_done)
+        {
+            bench_loop_once (10000);
+        }
+        launch[i] = time_launched - time_start;
+        total[i] = bench_time () - time_start;
+        if (bench_process_rc != 0)
+            result->errors++;
+    }
+
+    qsort (launch, bench_num_runs, sizeof (launch[0]), &bench_cmp_time);
+    qsort (total, bench_num_runs, sizeof (total[0]), &bench_cmp_time);
+    result->runs = bench_num_runs;
+    result->launch_p50 = (double)launch[bench_num_runs / 2] / 1000;
+    result->launch_p99 = (double)launch[(bench_num_runs * 99) / 100] / 1000;
+    result->total_p50 = (double)total[bench_num_runs / 2] / 1000;
+    result->total_p99 = (double)total[(bench_num_runs * 99) / 100] / 1000;
+
+    free (launch);
+    free (total);
+    hashtable_free (options);
+
+    return 1;
+}
+
+/*
+ * Displays result of a benchmark.
+ */
+
+void
+bench_display_result (struct t_bench_result *result)
+{
+    printf ("  %-12s launch: p50 = %8.3f ms, p99 = %8.3f ms | "
+            "total: p50 = %8.3f ms, p99 = %8.3f ms",
+            result->mode,
+            result->launch_p50, result->launch_p99,
+            result->total_p50, result->total_p99);
+    if (result->errors > 0)
+        printf (" (%d errors)", result->errors);
+    printf ("\n");
+}
+
+/*
+ * Parses list of sizes (in MB), separated by commas.
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_parse_sizes (const char *sizes)
+{
+    char *error;
+    long number;
+
+    bench_num_sizes = 0;
+    while (sizes && sizes[0])
+    {
+        if (bench_num_sizes >= BENCH_MAX_SIZES)
+            return 0;
+        error = NULL;
+        number = strtol (sizes, &error, 10);
+        if (!error || (error == sizes) || (number < 0)
+            || (error[0] && (error[0] != ',')))
+        {
+            return 0;
+        }
+        bench_sizes[bench_num_sizes++] = number;
+        sizes = (error[0] == ',') ? error + 1 : error;
+    }
+
+    return (bench_num_sizes > 0) ? 1 : 0;
+}
+
+/*
+ * Displays usage of program.
+ */
+
+void
+bench_usage (const char *program)
+{
+    printf ("Usage: %s [options]\n"
+            "\n"
+            "  -m <list>  memory sizes in MB, separated by commas "
+            "(default: 100,1024,4096)\n"
+            "  -n <num>   number of processes per size and mode "
+            "(default: %d)\n"
+            "  -c <cmd>   command executed (default: \"%s\")\n"
+            "  -h         display this help\n",
+            program, bench_num_runs, bench_command);
+}
+
+/*
+ * Initializes GUI for benchmark (Curses calls are made with the fake
+ * ncurses library).
+ */
+
+void
+bench_gui_init ()
+{
+    gui_main_init ();
+}
+
+/*
+ * Runs process benchmark in WeeChat environment.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    struct t_bench_result result;
+    char *weechat_argv[5];
+    int opt, i;
+
+    while ((opt = getopt (argc, argv, "m:n:c:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (!bench_parse_sizes (optarg))
+                {
+                    bench_usage (argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                bench_num_runs = atoi (optarg);
+                break;
+            case 'c':
+                bench_command = optarg;
+                break;
+            default:
+                bench_usage (argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if (bench_num_runs < 1)
+    {
+        bench_usage (argv[0]);
+        return 1;
+    }
+
+    /* setup environment: default language, no specific timezone */
+    setenv ("LANG", "C", 1);
+    setenv ("TZ", "", 1);
+
+    /* init WeeChat (without plugins) */
+    weechat_argv[0] = argv[0];
+    weechat_argv[1] = "--dir";
+    weechat_argv[2] = "./tmp_weechat_benchmark";
+    weechat_argv[3] = "--no-plugin";
+    weechat_argv[4] = NULL;
+    weechat_init (4, weechat_argv, &bench_gui_init);
+
+    input_data (gui_buffer_search_main (),
+                "/set weechat.look.save_config_on_exit off");
+
+    printf ("process benchmark: command \"%s\", %d runs per size and mode\n",
+            bench_command, bench_num_runs);
+
+    for (i = 0; i < bench_num_sizes; i++)
+    {
+        if (!bench_ballast_grow (bench_sizes[i]))
+        {
+            printf ("memory: %ld MB: not enough memory, skipped\n",
+                    bench_sizes[i]);
+            continue;
+        }
+        printf ("memory: %ld MB (RSS: %ld MB)\n",
+                bench_sizes[i], bench_rss ());
+        if (bench_run ("fork", &result))
+            bench_display_result (&result);
+        if (bench_run ("posix_spawn", &result))
+            bench_display_result (&result);
+    }
+
+    if (bench_ballast)
+        free (bench_ballast);
+
+    weechat_end (&gui_main_end);
+
+    return 0;
+}
@@ -0,0 +1,1209 @@
+/*
+ * relay-benchmark.c - throughput and latency benchmark for relay plugin
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program starts WeeChat headless (with the fake ncurses library),
+ * loads the relay plugin with a "weechat" relay on loopback, connects fake
+ * clients (weechat protocol over raw TCP and over websocket), then prints
+ * lines on a buffer and measures on client side:
+ *   - number of lines/s delivered to clients,
+ *   - end-to-end latency (time between print and reception by client),
+ *   - bytes received by clients (without and with zlib compression).
+ * Time spent by main loop in functions relay_weechat_msg_send and
+ * relay_client_send is reported too.
+ *
+ * Clients run in threads, WeeChat runs in main thread with a simplified
+ * main loop (same as Curses main loop, without display).
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include "src/core/weechat.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
+#include "src/plugins/plugin.h"
+#include "src/gui/gui-main.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/plugins/relay/relay.h"
+
+#ifndef RELAY_BENCHMARK_PLUGIN
+#define RELAY_BENCHMARK_PLUGIN "../src/plugins/relay/relay.so"
+#endif
+
+#define BENCH_PASSWORD "bench"
+#define BENCH_LINE_TEXT "the quick brown fox jumps over the lazy dog, " \
+    "lorem ipsum dolor sit amet"
+
+struct t_bench_client
+{
+    int index;                         /* client number                     */
+    int websocket;                     /* 1 if client uses websocket        */
+    const char *compression;           /* compression: "off" or "zlib"      */
+    int sock;                          /* socket connected to relay         */
+    pthread_t thread;                  /* thread reading data from relay    */
+    volatile int ready;                /* 1 when client is synchronized     */
+    volatile int done;                 /* 1 when all lines were received    */
+    long long bytes;                   /* bytes received (after sync)       */
+    int lines;                         /* number of lines received          */
+    long long *latency;                /* latency of each line (in µs)      */
+    long long last_recv;               /* time of last line received (µs)   */
+    unsigned char *frames;             /* websocket data not yet decoded    */
+    int frames_size;                   /* size of websocket data            */
+    unsigned char *stream;             /* weechat messages not yet decoded  */
+    int stream_size;                   /* size of weechat messages data     */
+};
+
+struct t_bench_reader
+{
+    const unsigned char *data;         /* message data                      */
+    int size;                          /* size of data                      */
+    int pos;                           /* current position in data          */
+    int error;                         /* 1 if read beyond end of data      */
+};
+
+struct t_bench_result
+{
+    const char *compression;           /* "off" or "zlib"                   */
+    int lines_sent;                    /* number of lines printed           */
+    long long lines_received;          /* lines received (all clients)      */
+    double lines_per_sec;              /* lines/s delivered (all clients)   */
+    double latency_p50;                /* latency percentile 50 (in ms)     */
+    double latency_p99;                /* latency percentile 99 (in ms)     */
+    long long bytes;                   /* bytes received (all clients)      */
+    long long elapsed;                 /* duration of benchmark (in µs)     */
+    struct t_relay_profile_counter profile[RELAY_NUM_PROFILE];
+};
+
+int bench_port = 19900;                /* port used by relay                */
+int bench_num_weechat = 4;             /* number of weechat clients         */
+int bench_num_websocket = 4;           /* number of websocket clients       */
+int bench_num_lines = 10000;           /* number of lines to print          */
+int bench_burst = 100;                 /* lines printed per loop iteration  */
+int bench_batch = 0;                   /* 1 to sync buffers with "batch"    */
+const char *bench_plugin = RELAY_BENCHMARK_PLUGIN;
+
+struct t_gui_buffer *bench_buffer = NULL;
+volatile int bench_stop = 0;           /* 1 to stop client threads          */
+int *bench_relay_profile = NULL;       /* variable "relay_profile" (plugin) */
+struct t_relay_profile_counter *bench_relay_profile_counters = NULL;
+
+extern void gui_main_init ();
+
+
+/*
+ * Returns current time, in microseconds.
+ */
+
+long long
+bench_time ()
+{
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return ((long long)tv.tv_sec * 1000000LL) + (long long)tv.tv_usec;
+}
+
+/*
+ * Sends all data on a socket.
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_send_all (int sock, const void *data, int size)
+{
+    const char *ptr_data;
+    int num_sent;
+
+    ptr_data = (const char *)data;
+    while (size > 0)
+    {
+        num_sent = send (sock, ptr_data, size, 0);
+        if (num_sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        ptr_data += num_sent;
+        size -= num_sent;
+    }
+    return 1;
+}
+
+/*
+ * Sends text to relay, in a masked websocket frame if client uses websocket.
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_client_send (struct t_bench_client *client, const char *text)
+{
+    unsigned char *frame, mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    int length, pos, i, rc;
+
+    length = strlen (text);
+    if (!client->websocket)
+        return bench_send_all (client->sock, text, length);
+
+    frame = malloc (length + 14);
+    if (!frame)
+        return 0;
+    pos = 0;
+    frame[pos++] = 0x81;               /* FIN + opcode "text" */
+    if (length <= 125)
+    {
+        frame[pos++] = 0x80 | length;
+    }
+    else
+    {
+        frame[pos++] = 0x80 | 126;
+        frame[pos++] = (length >> 8) & 0xFF;
+        frame[pos++] = length & 0xFF;
+    }
+    memcpy (frame + pos, mask, 4);
+    pos += 4;
+    for (i = 0; i < length; i++)
+    {
+        frame[pos++] = text[i] ^ mask[i % 4];
+    }
+    rc = bench_send_all (client->sock, frame, pos);
+    free (frame);
+    return rc;
+}
+
+/*
+ * Appends data to a buffer.
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_append (unsigned char **buffer, int *size, const void *data,
+              int data_size)
+{
+    unsigned char *new_buffer;
+
+    new_buffer = realloc (*buffer, *size + data_size);
+    if (!new_buffer)
+        return 0;
+    memcpy (new_buffer + *size, data, data_size);
+    *buffer = new_buffer;
+    *size += data_size;
+    return 1;
+}
+
+/*
+ * Removes "count" bytes at the beginning of a buffer.
+ */
+
+void
+bench_consume (unsigned char *buffer, int *size, int count)
+{
+    memmove (buffer, buffer + count, *size - count);
+    *size -= count;
+}
+
+/*
+ * Reads bytes in a message.
+ *
+ * Returns pointer to bytes, NULL if end of message is reached.
+ */
+
+const unsigned char *
+bench_read (struct t_bench_reader *reader, int length)
+{
+    const unsigned char *ptr_data;
+
+    if ((length < 0) || (reader->pos + length > reader->size))
+    {
+        reader->error = 1;
+        return NULL;
+    }
+    ptr_data = reader->data + reader->pos;
+    reader->pos += length;
+    return ptr_data;
+}
+
+/*
+ * Reads an integer (4 bytes, big endian) in a message.
+ */
+
+int
+bench_read_int (struct t_bench_reader *reader)
+{
+    const unsigned char *ptr_data;
+
+    ptr_data = bench_read (reader, 4);
+    if (!ptr_data)
+        return 0;
+    return (int)(((unsigned int)ptr_data[0] << 24)
+                 | ((unsigned int)ptr_data[1] << 16)
+                 | ((unsigned int)ptr_data[2] << 8)
+                 | (unsigned int)ptr_data[3]);
+}
+
+/*
+ * Reads a string (length + content) in a message.
+ *
+ * Returns length of string (-1 for a NULL string).
+ */
+
+int
+bench_read_str (struct t_bench_reader *reader, const unsigned char **str)
+{
+    int length;
+
+    *str = NULL;
+    length = bench_read_int (reader);
+    if (length > 0)
+        *str = bench_read (reader, length);
+    return (reader->error) ? -1 : length;
+}
+
+/*
+ * Reads a type (3 chars) in a message.
+ */
+
+void
+bench_read_type (struct t_bench_reader *reader, char *type)
+{
+    const unsigned char *ptr_data;
+
+    ptr_data = bench_read (reader, 3);
+    if (ptr_data)
+        memcpy (type, ptr_data, 3);
+    else
+        memset (type, ' ', 3);
+    type[3] = '\0';
+}
+
+/*
+ * Receives a line message "<seq> <time>" and computes its latency.
+ */
+
+void
+bench_client_line (struct t_bench_client *client, const unsigned char *str,
+                   int length)
+{
+    char message[64];
+    long long time_print;
+    int seq;
+
+    if (!str || (length <= 0))
+        return;
+    if (length >= (int)sizeof (message))
+        length = sizeof (message) - 1;
+    memcpy (message, str, length);
+    message[length] = '\0';
+    if (sscanf (message, "%d %lld", &seq, &time_print) != 2)
+        return;
+    if (client->lines < bench_num_lines)
+    {
+        client->last_recv = bench_time ();
+        client->latency[client->lines] = client->last_recv - time_print;
+        client->lines++;
+        if (client->lines >= bench_num_lines)
+            client->done = 1;
+    }
+}
+
+/*
+ * Skips an object of given type in a message.
+ */
+
+void
+bench_skip_object (struct t_bench_reader *reader, const char *type)
+{
+    const unsigned char *ptr_data;
+    char type_keys[4], type_values[4];
+    int i, count;
+
+    if (strcmp (type, "chr") == 0)
+        bench_read (reader, 1);
+    else if (strcmp (type, "int") == 0)
+        bench_read (reader, 4);
+    else if ((strcmp (type, "lon") == 0)
+             || (strcmp (type, "ptr") == 0)
+             || (strcmp (type, "tim") == 0))
+    {
+        ptr_data = bench_read (reader, 1);
+        if (ptr_data)
+            bench_read (reader, ptr_data[0]);
+    }
+    else if ((strcmp (type, "str") == 0) || (strcmp (type, "buf") == 0))
+        bench_read_str (reader, &ptr_data);
+    else if (strcmp (type, "htb") == 0)
+    {
+        bench_read_type (reader, type_keys);
+        bench_read_type (reader, type_values);
+        count = bench_read_int (reader);
+        for (i = 0; (i < count) && !reader->error; i++)
+        {
+            bench_skip_object (reader, type_keys);
+            bench_skip_object (reader, type_values);
+        }
+    }
+    else if (strcmp (type, "arr") == 0)
+    {
+        bench_read_type (reader, type_values);
+        count = bench_read_int (reader);
+        for (i = 0; (i < count) && !reader->error; i++)
+        {
+            bench_skip_object (reader, type_values);
+        }
+    }
+    else if (strcmp (type, "inf") == 0)
+    {
+        bench_read_str (reader, &ptr_data);
+        bench_read_str (reader, &ptr_data);
+    }
+    else
+        reader->error = 1;
+}
+
+/*
+ * Reads a hdata with lines (message "_buffer_line_added").
+ */
+
+void
+bench_client_read_hdata (struct t_bench_client *client,
+                         struct t_bench_reader *reader)
+{
+    const unsigned char *hpath, *keys, *str;
+    char **list_keys, *str_keys, *pos, type[4];
+    int i, j, k, num_keys, hpath_length, keys_length, count, num_pointers;
+    int length;
+
+    hpath_length = bench_read_str (reader, &hpath);
+    keys_length = bench_read_str (reader, &keys);
+    count = bench_read_int (reader);
+    if (reader->error || (keys_length <= 0))
+        return;
+
+    num_pointers = 1;
+    for (i = 0; i < hpath_length; i++)
+    {
+        if (hpath[i] == '/')
+            num_pointers++;
+    }
+
+    str_keys = malloc (keys_length + 1);
+    if (!str_keys)
+        return;
+    memcpy (str_keys, keys, keys_length);
+    str_keys[keys_length] = '\0';
+    list_keys = string_split (str_keys, ",", 0, 0, &num_keys);
+    free (str_keys);
+    if (!list_keys)
+        return;
+
+    for (i = 0; (i < count) && !reader->error; i++)
+    {
+        for (j = 0; j < num_pointers; j++)
+        {
+            bench_skip_object (reader, "ptr");
+        }
+        for (k = 0; (k < num_keys) && !reader->error; k++)
+        {
+            pos = strchr (list_keys[k], ':');
+            if (!pos)
+                break;
+            snprintf (type, sizeof (type), "%s", pos + 1);
+            if ((strncmp (list_keys[k], "message:", 8) == 0)
+                && (strcmp (type, "str") == 0))
+            {
+                length = bench_read_str (reader, &str);
+                bench_client_line (client, str, length);
+            }
+            else
+                bench_skip_object (reader, type);
+        }
+    }
+
+    string_free_split (list_keys);
+}
+
+/*
+ * Reads columns with lines (message "_buffer_lines_added", sent when buffer
+ * is synchronized with flag "batch").
+ */
+
+void
+bench_client_read_batch (struct t_bench_client *client,
+                         struct t_bench_reader *reader)
+{
+    const unsigned char *schema, *str;
+    char **list_columns, *str_schema, type[4], type_values[4];
+    int i, j, num_columns, schema_length, count, length;
+
+    bench_read_type (reader, type);
+    schema_length = bench_read_str (reader, &schema);
+    bench_read_type (reader, type);
+    bench_read_int (reader);
+    if (reader->error || (schema_length <= 0))
+        return;
+
+    str_schema = malloc (schema_length + 1);
+    if (!str_schema)
+        return;
+    memcpy (str_schema, schema, schema_length);
+    str_schema[schema_length] = '\0';
+    list_columns = string_split (str_schema, ",", 0, 0, &num_columns);
+    free (str_schema);
+    if (!list_columns)
+        return;
+
+    for (i = 0; (i < num_columns) && !reader->error; i++)
+    {
+        bench_read_type (reader, type);
+        if (strcmp (list_columns[i], "message:str") != 0)
+        {
+            bench_skip_object (reader, type);
+            continue;
+        }
+        bench_read_type (reader, type_values);
+        count = bench_read_int (reader);
+        for (j = 0; (j < count) && !reader->error; j++)
+        {
+            length = bench_read_str (reader, &str);
+            bench_client_line (client, str, length);
+        }
+    }
+
+    string_free_split (list_columns);
+}
+
+/*
+ * Reads a weechat message (after decompression).
+ */
+
+void
+bench_client_read_message (struct t_bench_client *client,
+                           const unsigned char *data, int size)
+{
+    struct t_bench_reader reader;
+    const unsigned char *id;
+    char type[4];
+    int id_length;
+
+    reader.data = data;
+    reader.size = size;
+    reader.pos = 0;
+    reader.error = 0;
+
+    id_length = bench_read_str (&reader, &id);
+    if (id_length <= 0)
+        return;
+
+    if ((id_length == 5) && (memcmp (id, "_pong", 5) == 0))
+    {
+        client->ready = 1;
+        return;
+    }
+    if (!client->ready)
+        return;
+
+    if ((id_length == 18) && (memcmp (id, "_buffer_line_added", 18) == 0))
+    {
+        bench_read_type (&reader, type);
+        if (strcmp (type, "hda") == 0)
+            bench_client_read_hdata (client, &reader);
+    }
+    else if ((id_length == 19)
+             && (memcmp (id, "_buffer_lines_added", 19) == 0))
+    {
+        bench_client_read_batch (client, &reader);
+    }
+}
+
+/*
+ * Decodes complete weechat messages received by client.
+ */
+
+void
+bench_client_read_stream (struct t_bench_client *client)
+{
+    unsigned char *data;
+    uLongf data_size;
+    int length, rc;
+
+    while (client->stream_size >= 5)
+    {
+        length = (int)(((unsigned int)client->stream[0] << 24)
+                       | ((unsigned int)client->stream[1] << 16)
+                       | ((unsigned int)client->stream[2] << 8)
+                       | (unsigned int)client->stream[3]);
+        if ((length < 5) || (client->stream_size < length))
+            return;
+        if (client->stream[4] == 1)
+        {
+            /* message compressed with zlib */
+            data_size = (length - 5) * 20 + 1024;
+            while (1)
+            {
+                data = malloc (data_size);
+                if (!data)
+                    break;
+                rc = uncompress (data, &data_size, client->stream + 5,
+                                 length - 5);
+                if (rc == Z_OK)
+                {
+                    bench_client_read_message (client, data, data_size);
+                    free (data);
+                    break;
+                }
+                free (data);
+                if (rc != Z_BUF_ERROR)
+                    break;
+                data_size *= 2;
+            }
+        }
+        else
+        {
+            bench_client_read_message (client, client->stream + 5,
+                                       length - 5);
+        }
+        bench_consume (client->stream, &client->stream_size, length);
+    }
+}
+
+/*
+ * Decodes complete websocket frames received by client (frames from server
+ * are not masked).
+ */
+
+void
+bench_client_read_frames (struct t_bench_client *client)
+{
+    unsigned long long length;
+    int pos, i;
+
+    while (client->frames_size >= 2)
+    {
+        pos = 2;
+        length = client->frames[1] & 0x7F;
+        if (length >= 126)
+        {
+            i = (length == 126) ? 2 : 8;
+            if (client->frames_size < pos + i)
+                return;
+            length = 0;
+            while (i > 0)
+            {
+                length = (length << 8) | client->frames[pos++];
+                i--;
+            }
+        }
+        if ((unsigned long long)client->frames_size < pos + length)
+            return;
+        if ((client->frames[0] & 0x0F) == 2)
+        {
+            /* binary frame: weechat message(s) */
+            bench_append (&client->stream, &client->stream_size,
+                          client->frames + pos, (int)length);
+        }
+        bench_consume (client->frames, &client->frames_size,
+                       pos + (int)length);
+    }
+}
+
+/*
+ * Connects a client to relay.
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_client_connect (struct t_bench_client *client)
+{
+    struct sockaddr_in addr;
+    struct timeval tv;
+    char buffer[4096], commands[512];
+    int length, num_read, flag;
+
+    client->sock = socket (AF_INET, SOCK_STREAM, 0);
+    if (client->sock < 0)
+        return 0;
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (bench_port);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if (connect (client->sock, (struct sockaddr *)&addr, sizeof (addr)) < 0)
+        return 0;
+    flag = 1;
+    setsockopt (client->sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof (flag));
+
+    /* timeout on recv, to check regularly if benchmark is stopped */
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+    setsockopt (client->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+
+    if (client->websocket)
+    {
+        snprintf (buffer, sizeof (buffer),
+                  "GET /weechat HTTP/1.1\r\n"
+                  "Host: 127.0.0.1:%d\r\n"
+                  "Upgrade: websocket\r\n"
+                  "Connection: Upgrade\r\n"
+                  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                  "Sec-WebSocket-Version: 13\r\n"
+                  "\r\n",
+                  bench_port);
+        if (!bench_send_all (client->sock, buffer, strlen (buffer)))
+            return 0;
+        length = 0;
+        while (!bench_stop)
+        {
+            num_read = recv (client->sock, buffer + length,
+                             sizeof (buffer) - 1 - length, 0);
+            if (num_read == 0)
+                return 0;
+            if (num_read < 0)
+            {
+                if ((errno == EAGAIN) || (errno == EINTR))
+                    continue;
+                return 0;
+            }
+            length += num_read;
+            buffer[length] = '\0';
+            if (strstr (buffer, "\r\n\r\n"))
+                break;
+            if (length >= (int)sizeof (buffer) - 1)
+                return 0;
+        }
+    }
+
+    snprintf (commands, sizeof (commands),
+              "init password=%s,compression=%s\n"
+              "sync * buffer%s\n"
+              "ping ready\n",
+              BENCH_PASSWORD,
+              client->compression,
+              (bench_batch) ? ",batch" : "");
+    return bench_client_send (client, commands);
+}
+
+/*
+ * Thread of a client: connects to relay and reads data until all lines are
+ * received or benchmark is stopped.
+ */
+
+void *
+bench_client_thread (void *arg)
+{
+    struct t_bench_client *client;
+    unsigned char buffer[65536];
+    int num_read;
+
+    client = (struct t_bench_client *)arg;
+
+    if (!bench_client_connect (client))
+    {
+        fprintf (stderr, "client %d: unable to connect to relay\n",
+                 client->index);
+        client->done = 1;
+        return NULL;
+    }
+
+    while (!bench_stop)
+    {
+        num_read = recv (client->sock, buffer, sizeof (buffer), 0);
+        if (num_read == 0)
+            break;
+        if (num_read < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                || (errno == EINTR))
+                continue;
+            break;
+        }
+        if (client->ready)
+            client->bytes += num_read;
+        if (client->websocket)
+        {
+            bench_append (&client->frames, &client->frames_size,
+                          buffer, num_read);
+            bench_client_read_frames (client);
+        }
+        else
+        {
+            bench_append (&client->stream, &client->stream_size,
+                          buffer, num_read);
+        }
+        bench_client_read_stream (client);
+    }
+
+    client->done = 1;
+    return NULL;
+}
+
+/*
+ * Runs one iteration of main loop (like the Curses main loop, without
+ * display).
+ */
+
+void
+bench_loop_once (long timeout_us)
+{
+    fd_set read_fds, write_fds, except_fds;
+    struct timeval tv_timeout;
+    int max_fd, ready;
+
+    hook_timer_exec ();
+
+    FD_ZERO (&read_fds);
+    FD_ZERO (&write_fds);
+    FD_ZERO (&except_fds);
+    max_fd = hook_fd_set (&read_fds, &write_fds, &except_fds);
+    hook_timer_time_to_next (&tv_timeout);
+    if ((tv_timeout.tv_sec > 0) || (tv_timeout.tv_usec > timeout_us))
+    {
+        tv_timeout.tv_sec = 0;
+        tv_timeout.tv_usec = timeout_us;
+    }
+    ready = select (max_fd + 1, &read_fds, &write_fds, &except_fds,
+                    &tv_timeout);
+    if (ready > 0)
+        hook_fd_exec (&read_fds, &write_fds, &except_fds);
+}
+
+/*
+ * Runs main loop during a delay (in microseconds).
+ */
+
+void
+bench_loop_delay (long long delay)
+{
+    long long time_end;
+
+    time_end = bench_time () + delay;
+    while (bench_time () < time_end)
+    {
+        bench_loop_once (10000);
+    }
+}
+
+/*
+ * Compares two latencies (for qsort).
+ */
+
+int
+bench_cmp_latency (const void *value1, const void *value2)
+{
+    long long latency1, latency2;
+
+    latency1 = *((const long long *)value1);
+    latency2 = *((const long long *)value2);
+    if (latency1 < latency2)
+        return -1;
+    return (latency1 > latency2) ? 1 : 0;
+}
+
+/*
+ * Runs benchmark with a compression ("off" or "zlib").
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_run (const char *compression, struct t_bench_result *result)
+{
+    struct t_bench_client *clients;
+    long long time_start, time_end, last_recv, *latencies;
+    long long timeout;
+    int i, num_clients, num_ready, num_done, seq, count, num_latencies;
+
+    memset (result, 0, sizeof (*result));
+    result->compression = compression;
+
+    num_clients = bench_num_weechat + bench_num_websocket;
+    clients = calloc (num_clients, sizeof (*clients));
+    if (!clients)
+        return 0;
+
+    bench_stop = 0;
+    for (i = 0; i < num_clients; i++)
+    {
+        clients[i].index = i;
+        clients[i].websocket = (i >= bench_num_weechat) ? 1 : 0;
+        clients[i].sock = -1;
+        clients[i].latency = malloc (bench_num_lines *
+                                     sizeof (clients[i].latency[0]));
+        clients[i].compression = compression;
+        pthread_create (&clients[i].thread, NULL, &bench_client_thread,
+                        &clients[i]);
+    }
+
+    /* wait for all clients connected and synchronized */
+    timeout = bench_time () + 10000000LL;
+    while (bench_time () < timeout)
+    {
+        bench_loop_once (10000);
+        num_ready = 0;
+        for (i = 0; i < num_clients; i++)
+        {
+            if (clients[i].ready || clients[i].done)
+                num_ready++;
+        }
+        if (num_ready == num_clients)
+            break;
+    }
+
+    /* print lines and run main loop until all clients received lines */
+    memset (bench_relay_profile_counters, 0,
+            RELAY_NUM_PROFILE * sizeof (bench_relay_profile_counters[0]));
+    *bench_relay_profile = 1;
+    seq = 0;
+    time_start = bench_time ();
+    timeout = time_start + 60000000LL;
+    while (bench_time () < timeout)
+    {
+        if (seq < bench_num_lines)
+        {
+            count = bench_burst;
+            while ((count > 0) && (seq < bench_num_lines))
+            {
+                gui_chat_printf_date_tags (bench_buffer, 0,
+                                           "bench_line,notify_none",
+                                           "bench\t%d %lld " BENCH_LINE_TEXT,
+                                           seq, bench_time ());
+                seq++;
+                count--;
+            }
+        }
+        bench_loop_once ((seq < bench_num_lines) ? 0 : 10000);
+        num_done = 0;
+        for (i = 0; i < num_clients; i++)
+        {
+            if (clients[i].done)
+                num_done++;
+        }
+        if ((seq >= bench_num_lines) && (num_done == num_clients))
+            break;
+    }
+    time_end = bench_time ();
+    *bench_relay_profile = 0;
+    memcpy (result->profile, bench_relay_profile_counters,
+            RELAY_NUM_PROFILE * sizeof (bench_relay_profile_counters[0]));
+
+    /* stop clients */
+    bench_stop = 1;
+    for (i = 0; i < num_clients; i++)
+    {
+        pthread_join (clients[i].thread, NULL);
+        if (clients[i].sock >= 0)
+            close (clients[i].sock);
+    }
+
+    /* let relay detect disconnection of clients */
+    bench_loop_delay (300000);
+
+    /* compute results */
+    last_recv = time_start;
+    num_latencies = 0;
+    for (i = 0; i < num_clients; i++)
+    {
+        num_latencies += clients[i].lines;
+        if (clients[i].last_recv > last_recv)
+            last_recv = clients[i].last_recv;
+        result->bytes += clients[i].bytes;
+    }
+    latencies = malloc ((num_latencies + 1) * sizeof (latencies[0]));
+    if (latencies)
+    {
+        count = 0;
+        for (i = 0; i < num_clients; i++)
+        {
+            memcpy (latencies + count, clients[i].latency,
+                    clients[i].lines * sizeof (latencies[0]));
+            count += clients[i].lines;
+        }
+        qsort (latencies, num_latencies, sizeof (latencies[0]),
+               &bench_cmp_latency);
+        if (num_latencies > 0)
+        {
+            result->latency_p50 =
+                (double)latencies[(num_latencies - 1) * 50 / 100] / 1000;
+            result->latency_p99 =
+                (double)latencies[(num_latencies - 1) * 99 / 100] / 1000;
+        }
+        free (latencies);
+    }
+    result->lines_sent = seq;
+    result->lines_received = num_latencies;
+    result->lines_per_sec = (last_recv > time_start) ?
+        (double)num_latencies * 1000000 / (last_recv - time_start) : 0;
+    result->elapsed = time_end - time_start;
+
+    for (i = 0; i < num_clients; i++)
+    {
+        free (clients[i].latency);
+        free (clients[i].frames);
+        free (clients[i].stream);
+    }
+    free (clients);
+
+    return 1;
+}
+
+/*
+ * Displays result of a benchmark.
+ */
+
+void
+bench_display_result (struct t_bench_result *result)
+{
+    int i;
+    const char *names[RELAY_NUM_PROFILE] =
+        { "relay_client_send", "relay_weechat_msg_send" };
+
+    printf ("compression: %s\n", result->compression);
+    printf ("  lines received:  %lld / %d (%d clients)\n",
+            result->lines_received,
+            result->lines_sent * (bench_num_weechat + bench_num_websocket),
+            bench_num_weechat + bench_num_websocket);
+    printf ("  throughput:      %.0f lines/s\n", result->lines_per_sec);
+    printf ("  latency:         p50 = %.3f ms, p99 = %.3f ms\n",
+            result->latency_p50, result->latency_p99);
+    printf ("  bytes on wire:   %lld (%.1f bytes/line)\n",
+            result->bytes,
+            (result->lines_received > 0) ?
+            (double)result->bytes / result->lines_received : 0);
+    printf ("  main loop:       %.3f ms\n", (double)result->elapsed / 1000);
+    for (i = 0; i < RELAY_NUM_PROFILE; i++)
+    {
+        printf ("  %-24s %lld calls, %.3f ms (%.1f%% of main loop)\n",
+                names[i],
+                result->profile[i].count,
+                (double)result->profile[i].time / 1000,
+                (result->elapsed > 0) ?
+                (double)result->profile[i].time * 100 / result->elapsed : 0);
+    }
+}
+
+/*
+ * Displays usage of program.
+ */
+
+void
+bench_usage (const char *program)
+{
+    printf ("Usage: %s [options]\n"
+            "\n"
+            "  -c <num>   number of weechat clients (default: %d)\n"
+            "  -w <num>   number of websocket clients (default: %d)\n"
+            "  -l <num>   number of lines printed (default: %d)\n"
+            "  -r <num>   lines printed per main loop iteration "
+            "(default: %d)\n"
+            "  -b         sync buffers with flag \"batch\"\n"
+            "  -p <port>  port used by relay (default: %d)\n"
+            "  -P <path>  path to relay plugin (default: %s)\n"
+            "  -h         display this help\n",
+            program, bench_num_weechat, bench_num_websocket,
+            bench_num_lines, bench_burst, bench_port, bench_plugin);
+}
+
+/*
+ * Callback for messages printed: displays them on stdout until benchmark
+ * starts (to see errors in setup of relay).
+ */
+
+int
+bench_print_cb (void *data, struct t_gui_buffer *buffer,
+                time_t date, int tags_count,
+                const char **tags, int displayed,
+                int highlight, const char *prefix,
+                const char *message)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) buffer;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+
+    if (bench_buffer)
+        return WEECHAT_RC_OK;
+
+    printf ("%s%s%s\n",
+            (prefix && prefix[0]) ? prefix : "",
+            (prefix && prefix[0]) ? " " : "",
+            (message && message[0]) ? message : "");
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Initializes GUI for benchmark (Curses calls are made with the fake
+ * ncurses library).
+ */
+
+void
+bench_gui_init ()
+{
+    hook_print (NULL, NULL, NULL, NULL, 1, &bench_print_cb, NULL);
+    gui_main_init ();
+}
+
+/*
+ * Runs relay benchmark in WeeChat environment.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    struct t_weechat_plugin *ptr_plugin;
+    struct t_bench_result results[2];
+    char *weechat_argv[5], command[4096];
+    int opt, rc;
+
+    while ((opt = getopt (argc, argv, "c:w:l:r:bp:P:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c':
+                bench_num_weechat = atoi (optarg);
+                break;
+            case 'w':
+                bench_num_websocket = atoi (optarg);
+                break;
+            case 'l':
+                bench_num_lines = atoi (optarg);
+                break;
+            case 'r':
+                bench_burst = atoi (optarg);
+                break;
+            case 'b':
+                bench_batch = 1;
+                break;
+            case 'p':
+                bench_port = atoi (optarg);
+                break;
+            case 'P':
+                bench_plugin = optarg;
+                break;
+            default:
+                bench_usage (argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if ((bench_num_weechat < 0) || (bench_num_websocket < 0)
+        || (bench_num_weechat + bench_num_websocket < 1)
+        || (bench_num_lines < 1) || (bench_burst < 1))
+    {
+        bench_usage (argv[0]);
+        return 1;
+    }
+
+    /* setup environment: default language, no specific timezone */
+    setenv ("LANG", "C", 1);
+    setenv ("TZ", "", 1);
+
+    /* relays of a previous run must not be restored */
+    unlink ("./tmp_weechat_benchmark/relay.conf");
+
+    /* init WeeChat (without plugins, relay is loaded below) */
+    weechat_argv[0] = argv[0];
+    weechat_argv[1] = "--dir";
+    weechat_argv[2] = "./tmp_weechat_benchmark";
+    weechat_argv[3] = "--no-plugin";
+    weechat_argv[4] = NULL;
+    weechat_init (4, weechat_argv, &bench_gui_init);
+
+    snprintf (command, sizeof (command), "/plugin load %s", bench_plugin);
+    input_data (gui_buffer_search_main (), command);
+    ptr_plugin = plugin_search ("relay");
+    if (ptr_plugin)
+    {
+        bench_relay_profile = dlsym (ptr_plugin->handle, "relay_profile");
+        bench_relay_profile_counters = dlsym (ptr_plugin->handle,
+                                              "relay_profile_counters");
+    }
+    if (!bench_relay_profile || !bench_relay_profile_counters)
+    {
+        fprintf (stderr, "Unable to load relay plugin \"%s\"\n",
+                 bench_plugin);
+        weechat_end (&gui_main_end);
+        return 1;
+    }
+
+    input_data (gui_buffer_search_main (),
+                "/set weechat.look.save_config_on_exit off");
+    input_data (gui_buffer_search_main (),
+                "/set relay.network.password \"" BENCH_PASSWORD "\"");
+    input_data (gui_buffer_search_main (),
+                "/set relay.network.max_clients 1024");
+    input_data (gui_buffer_search_main (),
+                "/set relay.look.auto_open_buffer off");
+    input_data (gui_buffer_search_main (),
+                "/set relay.network.bind_address \"127.0.0.1\"");
+    snprintf (command, sizeof (command), "/relay add ipv4.weechat %d", bench_port);
+    input_data (gui_buffer_search_main (), command);
+    bench_buffer = gui_buffer_new (NULL, "bench", NULL, NULL, NULL, NULL);
+
+    printf ("relay benchmark: %d weechat + %d websocket clients, "
+            "%d lines (%d per loop), sync: buffer%s\n",
+            bench_num_weechat, bench_num_websocket, bench_num_lines,
+            bench_burst, (bench_batch) ? ",batch" : "");
+
+    rc = 0;
+    if (bench_run ("off", &results[0]) && bench_run ("zlib", &results[1]))
+    {
+        bench_display_result (&results[0]);
+        bench_display_result (&results[1]);
+        printf ("zlib/off bytes ratio: %.3f\n",
+                (results[0].bytes > 0) ?
+                (double)results[1].bytes / results[0].bytes : 0);
+    }
+    else
+    {
+        fprintf (stderr, "Memory error\n");
+        rc = 1;
+    }
+
+    weechat_end (&gui_main_end);
+
+    return rc;
+}
@@ -90,6 +90,28 @@ wattr_off (WINDOW *win, attr_t attrs, void *opts)
     return OK;
 }
 
+int
+wattr_get (WINDOW *win, attr_t *attrs, short *pair, void *opts)
+{
+    (void) win;
+    (void) opts;
+    if (attrs)
+        *attrs = 0;
+    if (pair)
+        *pair = 0;
+    return OK;
+}
+
+int
+wattr_set (WINDOW *win, attr_t attrs, short pair, void *opts)
+{
+    (void) win;
+    (void) attrs;
+    (void) pair;
+    (void) opts;
+    return OK;
+}
+
 int
 waddnstr(WINDOW *win, const char *str, int n)
 {
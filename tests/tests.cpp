@@ -47,15 +47,33 @@ extern "C"
 #include "CppUTest/CommandLineTestRunner.h"
 
 /* import tests from libs */
+IMPORT_TEST_GROUP(ConfigFile);
+IMPORT_TEST_GROUP(Debug);
 IMPORT_TEST_GROUP(Eval);
 IMPORT_TEST_GROUP(Hashtable);
 IMPORT_TEST_GROUP(Hdata);
+IMPORT_TEST_GROUP(Hook);
 IMPORT_TEST_GROUP(Infolist);
 IMPORT_TEST_GROUP(List);
+IMPORT_TEST_GROUP(Memory);
+IMPORT_TEST_GROUP(Network);
 IMPORT_TEST_GROUP(String);
+IMPORT_TEST_GROUP(UpgradeFile);
 IMPORT_TEST_GROUP(Url);
 IMPORT_TEST_GROUP(Utf8);
 IMPORT_TEST_GROUP(Util);
+IMPORT_TEST_GROUP(IrcFlood);
+IMPORT_TEST_GROUP(IrcMessage);
+#ifdef HAVE_GNUTLS
+IMPORT_TEST_GROUP(IrcTls);
+#endif
+IMPORT_TEST_GROUP(LoggerIndex);
+IMPORT_TEST_GROUP(LoggerRotate);
+IMPORT_TEST_GROUP(LoggerWriter);
+IMPORT_TEST_GROUP(RelayWebsocket);
+IMPORT_TEST_GROUP(RelayWeechatBatch);
+IMPORT_TEST_GROUP(RelayWeechatNicklist);
+IMPORT_TEST_GROUP(XferWriter);
 
 
 /*
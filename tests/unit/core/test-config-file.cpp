@@ -0,0 +1,372 @@
+/*
+ * test-config-file.cpp - test configuration file functions
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
+#include "src/plugins/weechat-plugin.h"
+
+extern char *weechat_home;
+}
+
+#define TEST_CONFIG_NAME "test_config"
+#define TEST_CONFIG_BENCH_OPTIONS 50000
+
+struct t_config_file *test_config_file = NULL;
+
+/*
+ * Creates an option (callback called for options read in file).
+ */
+
+int
+test_config_create_option_cb (void *data,
+                              struct t_config_file *config_file,
+                              struct t_config_section *section,
+                              const char *option_name, const char *value)
+{
+    struct t_config_option *ptr_option;
+
+    /* make C compiler happy */
+    (void) data;
+
+    ptr_option = config_file_new_option (
+        config_file, section, option_name, "string", NULL,
+        NULL, 0, 0, "", value, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    return (ptr_option) ?
+        WEECHAT_CONFIG_OPTION_SET_OK_SAME_VALUE : WEECHAT_CONFIG_OPTION_SET_ERROR;
+}
+
+/*
+ * Creates a section (options can be added by user).
+ */
+
+struct t_config_section *
+test_config_new_section (const char *name)
+{
+    return config_file_new_section (test_config_file, name, 1, 1,
+                                    NULL, NULL, NULL, NULL, NULL, NULL,
+                                    &test_config_create_option_cb, NULL,
+                                    NULL, NULL);
+}
+
+/*
+ * Creates a string option in a section.
+ */
+
+struct t_config_option *
+test_config_new_option (struct t_config_section *section, const char *name)
+{
+    return config_file_new_option (test_config_file, section, name, "string",
+                                   NULL, NULL, 0, 0, "", name, 0,
+                                   NULL, NULL, NULL, NULL, NULL, NULL);
+}
+
+/*
+ * Checks that options of a section are sorted by name (links "prev_option"
+ * and "last_option" are checked too).
+ *
+ * Returns number of options in section.
+ */
+
+int
+test_config_check_sorted (struct t_config_section *section)
+{
+    struct t_config_option *ptr_option;
+    int count;
+
+    count = 0;
+    for (ptr_option = section->options; ptr_option;
+         ptr_option = ptr_option->next_option)
+    {
+        if (ptr_option->prev_option)
+        {
+            CHECK(ptr_option->prev_option->next_option == ptr_option);
+            CHECK(string_strcasecmp (ptr_option->prev_option->name,
+                                     ptr_option->name) <= 0);
+        }
+        else
+        {
+            POINTERS_EQUAL(section->options, ptr_option);
+        }
+        if (!ptr_option->next_option)
+            POINTERS_EQUAL(section->last_option, ptr_option);
+        count++;
+    }
+
+    return count;
+}
+
+TEST_GROUP(ConfigFile)
+{
+    void setup ()
+    {
+        test_config_file = config_file_new (NULL, TEST_CONFIG_NAME,
+                                            NULL, NULL);
+    }
+
+    void teardown ()
+    {
+        char *filename;
+        int length;
+
+        config_file_free (test_config_file);
+        test_config_file = NULL;
+
+        length = strlen (weechat_home) + 64;
+        filename = (char *)malloc (length);
+        if (filename)
+        {
+            snprintf (filename, length, "%s/%s.conf",
+                      weechat_home, TEST_CONFIG_NAME);
+            unlink (filename);
+            free (filename);
+        }
+    }
+};
+
+/*
+ * Tests functions:
+ *   config_file_search_section
+ *   config_file_search_option
+ *   config_file_search_section_option
+ */
+
+TEST(ConfigFile, Search)
+{
+    struct t_config_section *section1, *section2, *ptr_section;
+    struct t_config_option *option1, *option2, *ptr_option;
+    char name[64];
+    int i;
+
+    CHECK(test_config_file);
+
+    section1 = test_config_new_section ("section1");
+    section2 = test_config_new_section ("Section2");
+    POINTERS_EQUAL(NULL, test_config_new_section ("section1"));
+
+    POINTERS_EQUAL(NULL, config_file_search_section (test_config_file, NULL));
+    POINTERS_EQUAL(section1, config_file_search_section (test_config_file,
+                                                         "section1"));
+    POINTERS_EQUAL(section1, config_file_search_section (test_config_file,
+                                                         "SECTION1"));
+    POINTERS_EQUAL(section2, config_file_search_section (test_config_file,
+                                                         "section2"));
+    POINTERS_EQUAL(NULL, config_file_search_section (test_config_file,
+                                                     "section3"));
+
+    option1 = test_config_new_option (section1, "option");
+    option2 = test_config_new_option (section2, "option");
+    CHECK(option1);
+    CHECK(option2);
+    POINTERS_EQUAL(NULL, test_config_new_option (section1, "OPTION"));
+
+    POINTERS_EQUAL(option1, config_file_search_option (test_config_file,
+                                                       section1, "Option"));
+    POINTERS_EQUAL(option2, config_file_search_option (test_config_file,
+                                                       section2, "option"));
+    POINTERS_EQUAL(option1, config_file_search_option (test_config_file,
+                                                       NULL, "option"));
+    POINTERS_EQUAL(NULL, config_file_search_option (test_config_file,
+                                                    section1, "xxx"));
+    POINTERS_EQUAL(NULL, config_file_search_option (test_config_file,
+                                                    section1, NULL));
+
+    /* without section: the last option found is returned */
+    config_file_search_section_option (test_config_file, NULL, "option",
+                                       &ptr_section, &ptr_option);
+    POINTERS_EQUAL(section2, ptr_section);
+    POINTERS_EQUAL(option2, ptr_option);
+    config_file_search_section_option (test_config_file, section1, "option",
+                                       &ptr_section, &ptr_option);
+    POINTERS_EQUAL(section1, ptr_section);
+    POINTERS_EQUAL(option1, ptr_option);
+    config_file_search_section_option (test_config_file, section1, "xxx",
+                                       &ptr_section, &ptr_option);
+    POINTERS_EQUAL(NULL, ptr_section);
+    POINTERS_EQUAL(NULL, ptr_option);
+
+    /* many options: index is replaced by a bigger one */
+    for (i = 0; i < CONFIG_FILE_INDEX_SIZE * 10; i++)
+    {
+        snprintf (name, sizeof (name), "opt%d", i);
+        CHECK(test_config_new_option (section1, name));
+    }
+    CHECK(section1->index_options->size > CONFIG_FILE_INDEX_SIZE);
+    LONGS_EQUAL(CONFIG_FILE_INDEX_SIZE * 10 + 1,
+                section1->index_options->items_count);
+    for (i = 0; i < CONFIG_FILE_INDEX_SIZE * 10; i++)
+    {
+        snprintf (name, sizeof (name), "OPT%d", i);
+        ptr_option = config_file_search_option (test_config_file, section1,
+                                                name);
+        CHECK(ptr_option);
+        STRCMP_EQUAL(name + 3, ptr_option->name + 3);
+    }
+
+    /* free a section: it is removed from index */
+    config_file_section_free (section2);
+    POINTERS_EQUAL(NULL, config_file_search_section (test_config_file,
+                                                     "section2"));
+    POINTERS_EQUAL(section1, config_file_search_section (test_config_file,
+                                                         "section1"));
+}
+
+/*
+ * Tests functions:
+ *   config_file_option_insert_in_section
+ *   config_file_section_sort_options
+ *   config_file_option_rename
+ *   config_file_option_free
+ */
+
+TEST(ConfigFile, SortRenameFree)
+{
+    struct t_config_section *section;
+    struct t_config_option *option_b, *option_c;
+
+    section = test_config_new_section ("section");
+
+    /* options added in order: list stays sorted */
+    CHECK(test_config_new_option (section, "a"));
+    option_b = test_config_new_option (section, "b");
+    LONGS_EQUAL(0, section->options_unsorted);
+
+    /* options added in any order: list is sorted when needed */
+    test_config_new_option (section, "e");
+    option_c = test_config_new_option (section, "C");
+    test_config_new_option (section, "d");
+    LONGS_EQUAL(1, section->options_unsorted);
+    config_file_section_sort_options (section);
+    LONGS_EQUAL(0, section->options_unsorted);
+    LONGS_EQUAL(5, test_config_check_sorted (section));
+    STRCMP_EQUAL("a", section->options->name);
+    STRCMP_EQUAL("b", section->options->next_option->name);
+    STRCMP_EQUAL("C", section->options->next_option->next_option->name);
+    STRCMP_EQUAL("e", section->last_option->name);
+
+    /* rename option */
+    config_file_option_rename (option_b, "z");
+    STRCMP_EQUAL("z", option_b->name);
+    POINTERS_EQUAL(NULL, config_file_search_option (test_config_file,
+                                                    section, "b"));
+    POINTERS_EQUAL(option_b, config_file_search_option (test_config_file,
+                                                        section, "Z"));
+    config_file_section_sort_options (section);
+    LONGS_EQUAL(5, test_config_check_sorted (section));
+    POINTERS_EQUAL(option_b, section->last_option);
+
+    /* rename to an existing name is not allowed */
+    config_file_option_rename (option_b, "a");
+    STRCMP_EQUAL("z", option_b->name);
+
+    /* free option */
+    config_file_option_free (option_c);
+    POINTERS_EQUAL(NULL, config_file_search_option (test_config_file,
+                                                    section, "c"));
+    LONGS_EQUAL(4, section->index_options->items_count);
+    LONGS_EQUAL(4, test_config_check_sorted (section));
+    config_file_option_free (option_b);
+    LONGS_EQUAL(3, test_config_check_sorted (section));
+    STRCMP_EQUAL("e", section->last_option->name);
+}
+
+/*
+ * Tests functions:
+ *   config_file_read
+ *   config_file_write
+ *   config_file_search_with_string
+ *
+ * Loads a file with 50000 options (not sorted) and displays time used to
+ * read, search and write options.
+ */
+
+TEST(ConfigFile, BenchmarkLoad)
+{
+    struct t_config_section *section, *ptr_section;
+    struct t_config_option *ptr_option;
+    struct t_config_file *ptr_config;
+    struct timeval tv_start, tv_read, tv_search, tv_write;
+    FILE *file;
+    char *filename, name[128];
+    int i, number, length, found;
+
+    section = test_config_new_section ("bench");
+    CHECK(section);
+
+    /* write file with options in pseudo-random order */
+    length = strlen (weechat_home) + 64;
+    filename = (char *)malloc (length);
+    CHECK(filename);
+    snprintf (filename, length, "%s/%s.conf", weechat_home, TEST_CONFIG_NAME);
+    file = fopen (filename, "w");
+    CHECK(file);
+    fprintf (file, "[bench]\n");
+    for (i = 0; i < TEST_CONFIG_BENCH_OPTIONS; i++)
+    {
+        number = (int)(((long long)i * 7919) % TEST_CONFIG_BENCH_OPTIONS);
+        fprintf (file, "option_%05d = \"value %d\"\n", number, number);
+    }
+    fclose (file);
+    free (filename);
+
+    gettimeofday (&tv_start, NULL);
+    LONGS_EQUAL(WEECHAT_CONFIG_READ_OK, config_file_read (test_config_file));
+    gettimeofday (&tv_read, NULL);
+
+    found = 0;
+    for (i = 0; i < TEST_CONFIG_BENCH_OPTIONS; i++)
+    {
+        snprintf (name, sizeof (name),
+                  TEST_CONFIG_NAME ".bench.option_%05d", i);
+        config_file_search_with_string (name, &ptr_config, &ptr_section,
+                                        &ptr_option, NULL);
+        if (ptr_option && (ptr_section == section))
+            found++;
+    }
+    gettimeofday (&tv_search, NULL);
+
+    LONGS_EQUAL(WEECHAT_CONFIG_WRITE_OK, config_file_write (test_config_file));
+    gettimeofday (&tv_write, NULL);
+
+    LONGS_EQUAL(TEST_CONFIG_BENCH_OPTIONS, found);
+    LONGS_EQUAL(TEST_CONFIG_BENCH_OPTIONS, test_config_check_sorted (section));
+    STRCMP_EQUAL("value 12345",
+                 config_file_option_string (
+                     config_file_search_option (test_config_file, section,
+                                                "option_12345")));
+
+    printf ("\nconfig file with %d options: read: %.3f s, "
+            "search: %.3f s, write: %.3f s\n",
+            TEST_CONFIG_BENCH_OPTIONS,
+            util_timeval_diff (&tv_start, &tv_read) / 1000.0,
+            util_timeval_diff (&tv_read, &tv_search) / 1000.0,
+            util_timeval_diff (&tv_search, &tv_write) / 1000.0);
+}
@@ -0,0 +1,124 @@
+/*
+ * test-debug.cpp - test debug functions
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include "src/core/wee-debug.h"
+}
+
+TEST_GROUP(Debug)
+{
+};
+
+/*
+ * Tests functions:
+ *   debug_histogram_reset
+ *   debug_histogram_add
+ *   debug_histogram_percentile
+ */
+
+TEST(Debug, Histogram)
+{
+    struct t_debug_histogram *histogram;
+    long long value, expected;
+    int i;
+
+    histogram = (struct t_debug_histogram *)malloc (sizeof (*histogram));
+    CHECK(histogram);
+    debug_histogram_reset (histogram);
+
+    LONGS_EQUAL(0, histogram->count);
+    LONGS_EQUAL(0, debug_histogram_percentile (histogram, 50));
+
+    /* small values are exact */
+    for (i = 1; i <= 5; i++)
+    {
+        debug_histogram_add (histogram, i);
+    }
+    LONGS_EQUAL(5, histogram->count);
+    LONGS_EQUAL(15, histogram->total);
+    LONGS_EQUAL(1, histogram->min);
+    LONGS_EQUAL(5, histogram->max);
+    LONGS_EQUAL(1, debug_histogram_percentile (histogram, 0));
+    LONGS_EQUAL(3, debug_histogram_percentile (histogram, 50));
+    LONGS_EQUAL(5, debug_histogram_percentile (histogram, 100));
+
+    /* values 1 to 100000: relative error on percentiles is small */
+    debug_histogram_reset (histogram);
+    for (i = 1; i <= 100000; i++)
+    {
+        debug_histogram_add (histogram, i);
+    }
+    LONGS_EQUAL(100000, histogram->count);
+    LONGS_EQUAL(100000, debug_histogram_percentile (histogram, 100));
+    for (i = 10; i < 100; i += 10)
+    {
+        expected = i * 1000;
+        value = debug_histogram_percentile (histogram, i);
+        CHECK(value >= expected);
+        CHECK(value <= expected + (expected / DEBUG_HISTOGRAM_SUB_COUNT));
+    }
+
+    /* negative and huge values */
+    debug_histogram_reset (histogram);
+    debug_histogram_add (histogram, -5);
+    debug_histogram_add (histogram, 1LL << 50);
+    LONGS_EQUAL(0, histogram->min);
+    CHECK(debug_histogram_percentile (histogram, 100) == (1LL << 50));
+    LONGS_EQUAL(0, debug_histogram_percentile (histogram, 50));
+
+    free (histogram);
+}
+
+/*
+ * Tests functions:
+ *   debug_loop_phase_start
+ *   debug_loop_phase_end
+ *   debug_loop_reset
+ *   debug_loop_info
+ */
+
+TEST(Debug, LoopInfo)
+{
+    debug_loop_reset ();
+    STRCMP_EQUAL("0", debug_loop_info ("timer,count"));
+
+    debug_loop_phase_start (DEBUG_LOOP_PHASE_TIMER);
+    debug_loop_phase_end ();
+    debug_loop_phase_start (DEBUG_LOOP_PHASE_TIMER);
+    debug_loop_phase_end ();
+    STRCMP_EQUAL("2", debug_loop_info ("timer,count"));
+    STRCMP_EQUAL("0", debug_loop_info ("fd,count"));
+    STRCMP_EQUAL("0", debug_loop_info ("busy,stalls"));
+    CHECK(debug_loop_info ("timer,p99.9"));
+    CHECK(debug_loop_info ("timer"));
+    CHECK(debug_loop_info (NULL));
+
+    POINTERS_EQUAL(NULL, debug_loop_info ("invalid"));
+    POINTERS_EQUAL(NULL, debug_loop_info ("timer,invalid"));
+    POINTERS_EQUAL(NULL, debug_loop_info ("timer,p101"));
+    POINTERS_EQUAL(NULL, debug_loop_info ("timer,pabc"));
+
+    debug_loop_reset ();
+}
@@ -0,0 +1,360 @@
+/*
+ * test-hook.cpp - test hook functions
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-hdata.h"
+#include "src/core/wee-hook.h"
+#include "src/core/wee-infolist.h"
+#include "src/core/wee-util.h"
+#include "src/plugins/weechat-plugin.h"
+}
+
+#define TEST_HOOK_SIGNAL "test_hook_stats"
+
+/*
+ * Callback for signal used in tests.
+ */
+
+int
+test_hook_signal_cb (void *data, const char *signal, const char *type_data,
+                     void *signal_data)
+{
+    /* make C compiler happy */
+    (void) signal;
+    (void) type_data;
+    (void) signal_data;
+
+    (*((int *)data))++;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for timer used in tests.
+ */
+
+int
+test_hook_timer_cb (void *data, int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    return WEECHAT_RC_OK;
+}
+
+/* result of a process hook (filled by callback) */
+struct t_test_hook_process
+{
+    int calls;                         /* number of calls to callback       */
+    int return_code;                   /* return code (at end of process)   */
+    int ended;                         /* 1 if end of process received      */
+    char out[1024];                    /* stdout received ("|" after calls) */
+    char err[1024];                    /* stderr received ("|" after calls) */
+};
+
+/*
+ * Callback for process used in tests: output received in each call is
+ * added (followed by "|").
+ */
+
+int
+test_hook_process_cb (void *data, const char *command, int return_code,
+                      const char *out, const char *err)
+{
+    struct t_test_hook_process *result;
+
+    /* make C compiler happy */
+    (void) command;
+
+    result = (struct t_test_hook_process *)data;
+    result->calls++;
+    if (out && out[0])
+    {
+        strncat (result->out, out, sizeof (result->out) - strlen (result->out) - 2);
+        strcat (result->out, "|");
+    }
+    if (err && err[0])
+    {
+        strncat (result->err, err, sizeof (result->err) - strlen (result->err) - 2);
+        strcat (result->err, "|");
+    }
+    if (return_code != WEECHAT_HOOK_PROCESS_RUNNING)
+    {
+        result->return_code = return_code;
+        result->ended = 1;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Runs timers and fd hooks (like the main loop) until end of process is
+ * received by callback (at most 5 seconds).
+ */
+
+void
+test_hook_process_wait (struct t_test_hook_process *result)
+{
+    struct timeval tv_start, tv_now, tv_timeout;
+    fd_set read_fds, write_fds, except_fds;
+    int max_fd, ready;
+
+    gettimeofday (&tv_start, NULL);
+    while (!result->ended)
+    {
+        gettimeofday (&tv_now, NULL);
+        if (util_timeval_diff (&tv_start, &tv_now) > 5000)
+            break;
+        hook_timer_exec ();
+        FD_ZERO (&read_fds);
+        FD_ZERO (&write_fds);
+        FD_ZERO (&except_fds);
+        max_fd = hook_fd_set (&read_fds, &write_fds, &except_fds);
+        tv_timeout.tv_sec = 0;
+        tv_timeout.tv_usec = 100000;
+        ready = select (max_fd + 1, &read_fds, &write_fds, &except_fds,
+                        &tv_timeout);
+        if (ready > 0)
+            hook_fd_exec (&read_fds, &write_fds, &except_fds);
+    }
+}
+
+TEST_GROUP(Hook)
+{
+};
+
+/*
+ * Tests functions:
+ *   hook_stats_enable
+ *   hook_stats_add
+ *   hook_stats_reset
+ *   hook_get_description
+ *   hook_stats_add_to_infolist
+ *   hook_hdata_hook_cb
+ */
+
+TEST(Hook, Stats)
+{
+    struct t_hook *hook;
+    struct t_infolist *infolist;
+    struct t_hdata *hdata;
+    int count, found;
+
+    count = 0;
+    hook = hook_signal (NULL, TEST_HOOK_SIGNAL, &test_hook_signal_cb, &count);
+    CHECK(hook);
+    STRCMP_EQUAL(TEST_HOOK_SIGNAL, hook_get_description (hook));
+    STRCMP_EQUAL("", hook_get_description (NULL));
+
+    /* statistics disabled: nothing is measured */
+    hook_stats_enable (0);
+    hook_signal_send (TEST_HOOK_SIGNAL, WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    LONGS_EQUAL(1, count);
+    LONGS_EQUAL(0, hook->stats_calls);
+
+    /* statistics enabled */
+    hook_stats_enable (1);
+    hook_signal_send (TEST_HOOK_SIGNAL, WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    hook_signal_send (TEST_HOOK_SIGNAL, WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    LONGS_EQUAL(3, count);
+    LONGS_EQUAL(2, hook->stats_calls);
+    CHECK(hook->stats_time_total >= 0);
+    CHECK(hook->stats_time_max <= hook->stats_time_total);
+
+    /* infolist "hook_stats" (only signal hooks) */
+    infolist = infolist_new (NULL);
+    CHECK(infolist);
+    LONGS_EQUAL(1, hook_stats_add_to_infolist (infolist, "signal"));
+    found = 0;
+    while (infolist_next (infolist))
+    {
+        STRCMP_EQUAL("signal", infolist_string (infolist, "type"));
+        if (infolist_pointer (infolist, "pointer") == hook)
+        {
+            found = 1;
+            STRCMP_EQUAL(TEST_HOOK_SIGNAL,
+                         infolist_string (infolist, "description"));
+            LONGS_EQUAL(2, infolist_integer (infolist, "calls"));
+        }
+    }
+    LONGS_EQUAL(1, found);
+    infolist_free (infolist);
+
+    /* hdata "hook" */
+    hdata = hook_hdata_get (NULL, "hook");
+    CHECK(hdata);
+    LONGS_EQUAL(2, hdata_long (hdata, hook, "stats_calls"));
+    LONGS_EQUAL(1, hdata_check_pointer (hdata,
+                                        hdata_get_list (hdata,
+                                                        "weechat_hooks_signal"),
+                                        hook));
+
+    /* reset and disable statistics */
+    hook_stats_reset ();
+    LONGS_EQUAL(0, hook->stats_calls);
+    hook_stats_enable (0);
+    hook_signal_send (TEST_HOOK_SIGNAL, WEECHAT_HOOK_SIGNAL_STRING, NULL);
+    LONGS_EQUAL(0, hook->stats_calls);
+
+    unhook (hook);
+}
+
+/*
+ * Tests functions:
+ *   hook_timer_heap_add
+ *   hook_timer_heap_remove
+ *   hook_timer_time_to_next
+ */
+
+TEST(Hook, TimerHeap)
+{
+    struct t_hook *hooks[8];
+    struct timeval tv_timeout;
+    long intervals[8] = { 50000, 3000, 20000, 1000, 40000, 1500, 10000, 30000 };
+    int i, count;
+
+    count = hook_timer_heap_count;
+
+    for (i = 0; i < 8; i++)
+    {
+        hooks[i] = hook_timer (NULL, intervals[i], 0, 0,
+                               &test_hook_timer_cb, NULL);
+        CHECK(hooks[i]);
+        LONGS_EQUAL(count + i + 1, hook_timer_heap_count);
+        CHECK(HOOK_TIMER(hooks[i], heap_index) >= 0);
+        POINTERS_EQUAL(hooks[i],
+                       hook_timer_heap[HOOK_TIMER(hooks[i], heap_index)]);
+    }
+
+    /* heap property: each timer is executed after its parent */
+    for (i = 1; i < hook_timer_heap_count; i++)
+    {
+        CHECK(util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[(i - 1) / 2], next_exec),
+                                &HOOK_TIMER(hook_timer_heap[i], next_exec)) <= 0);
+    }
+
+    /* next timer is the one with interval of 1 second (or an older one) */
+    hook_timer_time_to_next (&tv_timeout);
+    CHECK(tv_timeout.tv_sec <= 1);
+
+    /* remove timers in the middle of heap */
+    unhook (hooks[3]);
+    unhook (hooks[0]);
+    LONGS_EQUAL(count + 6, hook_timer_heap_count);
+    for (i = 1; i < hook_timer_heap_count; i++)
+    {
+        CHECK(util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[(i - 1) / 2], next_exec),
+                                &HOOK_TIMER(hook_timer_heap[i], next_exec)) <= 0);
+        LONGS_EQUAL(i, HOOK_TIMER(hook_timer_heap[i], heap_index));
+    }
+
+    for (i = 1; i < 8; i++)
+    {
+        if (i != 3)
+            unhook (hooks[i]);
+    }
+    LONGS_EQUAL(count, hook_timer_heap_count);
+}
+
+/*
+ * Tests functions:
+ *   hook_process
+ *   hook_process_sigchld_read_cb
+ *   hook_process_child_end
+ */
+
+TEST(Hook, ProcessEnd)
+{
+    struct t_test_hook_process result;
+    struct t_hook *hook;
+
+    /* end of child is detected with SIGCHLD (no timer without timeout) */
+    memset (&result, 0, sizeof (result));
+    hook = hook_process (NULL, "sh -c 'echo out; echo err >&2; exit 3'", 0,
+                         &test_hook_process_cb, &result);
+    CHECK(hook);
+    POINTERS_EQUAL(NULL, HOOK_PROCESS(hook, hook_timer));
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(1, result.ended);
+    LONGS_EQUAL(3, result.return_code);
+
+    /* data still in pipes is read before the end of process */
+    STRCMP_EQUAL("out\n|", result.out);
+    STRCMP_EQUAL("err\n|", result.err);
+
+    /* command not found */
+    memset (&result, 0, sizeof (result));
+    hook = hook_process (NULL, "./tmp_test_hook_command_not_found", 0,
+                         &test_hook_process_cb, &result);
+    CHECK(hook);
+
+    /* callback is never called before hook_process returns */
+    LONGS_EQUAL(0, hook->deleted);
+    LONGS_EQUAL(0, result.ended);
+
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(1, result.ended);
+    CHECK(result.return_code != 0);
+}
+
+/*
+ * Tests functions:
+ *   hook_process_hashtable (option "line_buffered")
+ */
+
+TEST(Hook, ProcessLineBuffered)
+{
+    struct t_test_hook_process result;
+    struct t_hashtable *options;
+    struct t_hook *hook;
+
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL,
+                             NULL);
+    CHECK(options);
+    hashtable_set (options, "line_buffered", "1");
+
+    /* one line per call, the last line (without "\n") is sent at the end */
+    memset (&result, 0, sizeof (result));
+    hook = hook_process_hashtable (NULL,
+                                   "sh -c 'printf \"line1\\nline2\\nend\"'",
+                                   options, 0,
+                                   &test_hook_process_cb, &result);
+    CHECK(hook);
+    test_hook_process_wait (&result);
+    LONGS_EQUAL(1, result.ended);
+    LONGS_EQUAL(0, result.return_code);
+    STRCMP_EQUAL("line1\n|line2\n|end|", result.out);
+    STRCMP_EQUAL("", result.err);
+
+    hashtable_free (options);
+}
@@ -23,7 +23,44 @@
 
 extern "C"
 {
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
 #include "src/core/wee-infolist.h"
+#include "src/core/wee-util.h"
+}
+
+#define TEST_INFOLIST_BENCH_ITEMS 50000
+#define TEST_INFOLIST_BENCH_VARS 20
+
+/*
+ * Creates an infolist with 3 items (the last one has variables in another
+ * order than schema, and a variable with another type).
+ */
+
+struct t_infolist *
+test_infolist_new ()
+{
+    struct t_infolist *infolist;
+    struct t_infolist_item *item;
+    int i;
+
+    infolist = infolist_new (NULL);
+    for (i = 0; i < 2; i++)
+    {
+        item = infolist_new_item (infolist);
+        infolist_new_var_integer (item, "integer", 10 + i);
+        infolist_new_var_string (item, "string", (i == 0) ? "abc" : NULL);
+        infolist_new_var_pointer (item, "pointer", (void *)0x123);
+        infolist_new_var_buffer (item, "buffer", (void *)"buffer", 7);
+        infolist_new_var_time (item, "time", 1234567890 + i);
+    }
+    item = infolist_new_item (infolist);
+    infolist_new_var_time (item, "time", 42);
+    infolist_new_var_string (item, "integer", "not an integer");
+    infolist_new_var_string (item, "extra", "extra");
+
+    return infolist;
 }
 
 TEST_GROUP(Infolist)
@@ -43,7 +80,50 @@ TEST_GROUP(Infolist)
 
 TEST(Infolist, New)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+    struct t_infolist_item *item;
+    struct t_infolist_var *var;
+
+    POINTERS_EQUAL(NULL, infolist_new_item (NULL));
+
+    infolist = infolist_new (NULL);
+    CHECK(infolist);
+    item = infolist_new_item (infolist);
+    CHECK(item);
+
+    POINTERS_EQUAL(NULL, infolist_new_var_integer (NULL, "integer", 1));
+    POINTERS_EQUAL(NULL, infolist_new_var_integer (item, NULL, 1));
+    POINTERS_EQUAL(NULL, infolist_new_var_integer (item, "", 1));
+    POINTERS_EQUAL(NULL, infolist_new_var_buffer (item, "buffer", NULL, 0));
+
+    var = infolist_new_var_integer (item, "integer", 123);
+    CHECK(var);
+    STRCMP_EQUAL("integer", var->name);
+    LONGS_EQUAL(INFOLIST_INTEGER, var->type);
+    LONGS_EQUAL(123, var->value.integer);
+    var = infolist_new_var_string (item, "string", "abc");
+    CHECK(var);
+    STRCMP_EQUAL("abc", var->value.string);
+    CHECK(infolist_new_var_string (item, "string_null", NULL));
+    CHECK(infolist_new_var_pointer (item, "pointer", (void *)0x123));
+    CHECK(infolist_new_var_buffer (item, "buffer", (void *)"abc", 4));
+    CHECK(infolist_new_var_time (item, "time", 1234567890));
+
+    /* names are shared by items */
+    LONGS_EQUAL(6, infolist->schema_count);
+    LONGS_EQUAL(6, item->vars_count);
+    LONGS_EQUAL(1, item->vars_in_schema_order);
+    item = infolist_new_item (infolist);
+    var = infolist_new_var_integer (item, "integer", 456);
+    POINTERS_EQUAL(infolist->schema[0].name, var->name);
+    LONGS_EQUAL(0, var->index);
+    LONGS_EQUAL(1, item->vars_in_schema_order);
+    var = infolist_new_var_integer (item, "new", 1);
+    LONGS_EQUAL(6, var->index);
+    LONGS_EQUAL(0, item->vars_in_schema_order);
+    LONGS_EQUAL(7, infolist->schema_count);
+
+    infolist_free (infolist);
 }
 
 /*
@@ -53,7 +133,15 @@ TEST(Infolist, New)
 
 TEST(Infolist, Valid)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+
+    LONGS_EQUAL(0, infolist_valid (NULL));
+    LONGS_EQUAL(0, infolist_valid ((struct t_infolist *)0x1));
+
+    infolist = infolist_new (NULL);
+    LONGS_EQUAL(1, infolist_valid (infolist));
+    infolist_free (infolist);
+    LONGS_EQUAL(0, infolist_valid (infolist));
 }
 
 /*
@@ -63,7 +151,40 @@ TEST(Infolist, Valid)
 
 TEST(Infolist, Search)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+    struct t_infolist_var *var;
+
+    infolist = test_infolist_new ();
+
+    /* no current item */
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "integer"));
+
+    infolist_next (infolist);
+    POINTERS_EQUAL(NULL, infolist_search_var (NULL, "integer"));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, NULL));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, ""));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "xxx"));
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "extra"));
+    var = infolist_search_var (infolist, "integer");
+    CHECK(var);
+    LONGS_EQUAL(10, var->value.integer);
+    POINTERS_EQUAL(var, infolist_search_var (infolist, "INTEGER"));
+    var = infolist_search_var (infolist, "Time");
+    CHECK(var);
+    LONGS_EQUAL(1234567890, var->value.time);
+
+    /* item with variables in another order than schema */
+    infolist_next (infolist);
+    infolist_next (infolist);
+    var = infolist_search_var (infolist, "time");
+    CHECK(var);
+    LONGS_EQUAL(42, var->value.time);
+    var = infolist_search_var (infolist, "extra");
+    CHECK(var);
+    STRCMP_EQUAL("extra", var->value.string);
+    POINTERS_EQUAL(NULL, infolist_search_var (infolist, "pointer"));
+
+    infolist_free (infolist);
 }
 
 /*
@@ -75,7 +196,22 @@ TEST(Infolist, Search)
 
 TEST(Infolist, Move)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+
+    infolist = test_infolist_new ();
+
+    POINTERS_EQUAL(infolist->items, infolist_next (infolist));
+    POINTERS_EQUAL(infolist->items->next_item, infolist_next (infolist));
+    POINTERS_EQUAL(infolist->last_item, infolist_next (infolist));
+    POINTERS_EQUAL(NULL, infolist_next (infolist));
+
+    POINTERS_EQUAL(infolist->last_item, infolist_prev (infolist));
+    POINTERS_EQUAL(infolist->items->next_item, infolist_prev (infolist));
+    infolist_reset_item_cursor (infolist);
+    POINTERS_EQUAL(NULL, infolist->ptr_item);
+    POINTERS_EQUAL(infolist->last_item, infolist_prev (infolist));
+
+    infolist_free (infolist);
 }
 
 /*
@@ -89,7 +225,50 @@ TEST(Infolist, Move)
 
 TEST(Infolist, Get)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist;
+    const char *fields;
+    int size;
+
+    infolist = test_infolist_new ();
+
+    /* no current item */
+    LONGS_EQUAL(0, infolist_integer (infolist, "integer"));
+    POINTERS_EQUAL(NULL, infolist_fields (infolist));
+
+    /* first item */
+    infolist_next (infolist);
+    LONGS_EQUAL(10, infolist_integer (infolist, "integer"));
+    LONGS_EQUAL(0, infolist_integer (infolist, "string"));
+    LONGS_EQUAL(0, infolist_integer (infolist, "xxx"));
+    STRCMP_EQUAL("abc", infolist_string (infolist, "string"));
+    POINTERS_EQUAL(NULL, infolist_string (infolist, "integer"));
+    POINTERS_EQUAL(0x123, infolist_pointer (infolist, "pointer"));
+    POINTERS_EQUAL(NULL, infolist_pointer (infolist, "string"));
+    size = 0;
+    STRCMP_EQUAL("buffer", (const char *)infolist_buffer (infolist, "buffer",
+                                                          &size));
+    LONGS_EQUAL(7, size);
+    POINTERS_EQUAL(NULL, infolist_buffer (infolist, "string", &size));
+    LONGS_EQUAL(1234567890, infolist_time (infolist, "time"));
+    LONGS_EQUAL(0, infolist_time (infolist, "integer"));
+    fields = infolist_fields (infolist);
+    STRCMP_EQUAL("i:integer,s:string,p:pointer,b:buffer,t:time", fields);
+
+    /* second item: same fields (shared string) */
+    infolist_next (infolist);
+    LONGS_EQUAL(11, infolist_integer (infolist, "integer"));
+    POINTERS_EQUAL(NULL, infolist_string (infolist, "string"));
+    LONGS_EQUAL(1234567891, infolist_time (infolist, "time"));
+    POINTERS_EQUAL(fields, infolist_fields (infolist));
+
+    /* third item: other fields */
+    infolist_next (infolist);
+    LONGS_EQUAL(0, infolist_integer (infolist, "integer"));
+    STRCMP_EQUAL("not an integer", infolist_string (infolist, "integer"));
+    LONGS_EQUAL(42, infolist_time (infolist, "time"));
+    STRCMP_EQUAL("t:time,s:integer,s:extra", infolist_fields (infolist));
+
+    infolist_free (infolist);
 }
 
 /*
@@ -100,7 +279,20 @@ TEST(Infolist, Get)
 
 TEST(Infolist, Free)
 {
-    /* TODO: write tests */
+    struct t_infolist *infolist1, *infolist2, *infolist3;
+
+    infolist1 = test_infolist_new ();
+    infolist2 = infolist_new ((struct t_weechat_plugin *)0x1);
+    infolist3 = infolist_new ((struct t_weechat_plugin *)0x1);
+    infolist_new_var_integer (infolist_new_item (infolist2), "integer", 1);
+
+    infolist_free_all_plugin ((struct t_weechat_plugin *)0x1);
+    LONGS_EQUAL(1, infolist_valid (infolist1));
+    LONGS_EQUAL(0, infolist_valid (infolist2));
+    LONGS_EQUAL(0, infolist_valid (infolist3));
+
+    infolist_free (infolist1);
+    LONGS_EQUAL(0, infolist_valid (infolist1));
 }
 
 /*
@@ -112,3 +304,78 @@ TEST(Infolist, PrintLog)
 {
     /* TODO: write tests */
 }
+
+/*
+ * Tests functions:
+ *   infolist_new_item
+ *   infolist_new_var_integer
+ *   infolist_new_var_string
+ *   infolist_integer
+ *   infolist_string
+ *
+ * Creates an infolist with 50000 items and 20 variables by item, reads all
+ * variables and displays time used.
+ */
+
+TEST(Infolist, Benchmark)
+{
+    struct t_infolist *infolist;
+    struct t_infolist_item *item;
+    struct timeval tv_start, tv_new, tv_read, tv_free;
+    char names[TEST_INFOLIST_BENCH_VARS][32];
+    int i, j, errors;
+    long long sum;
+
+    for (j = 0; j < TEST_INFOLIST_BENCH_VARS; j++)
+    {
+        snprintf (names[j], sizeof (names[j]), "variable_%d", j);
+    }
+
+    gettimeofday (&tv_start, NULL);
+
+    infolist = infolist_new (NULL);
+    CHECK(infolist);
+    for (i = 0; i < TEST_INFOLIST_BENCH_ITEMS; i++)
+    {
+        item = infolist_new_item (infolist);
+        for (j = 0; j < TEST_INFOLIST_BENCH_VARS; j++)
+        {
+            if (j % 2 == 0)
+                infolist_new_var_integer (item, names[j], i + j);
+            else
+                infolist_new_var_string (item, names[j], names[j]);
+        }
+    }
+
+    gettimeofday (&tv_new, NULL);
+
+    sum = 0;
+    errors = 0;
+    while (infolist_next (infolist))
+    {
+        /* read variables in reverse order (worst case for a list) */
+        for (j = TEST_INFOLIST_BENCH_VARS - 1; j >= 0; j--)
+        {
+            if (j % 2 == 0)
+                sum += infolist_integer (infolist, names[j]);
+            else if (!infolist_string (infolist, names[j]))
+                errors++;
+        }
+    }
+
+    gettimeofday (&tv_read, NULL);
+
+    infolist_free (infolist);
+
+    gettimeofday (&tv_free, NULL);
+
+    LONGS_EQUAL(0, errors);
+    CHECK(sum > 0);
+
+    printf ("\ninfolist with %d items, %d vars: new: %.3f s, read: %.3f s, "
+            "free: %.3f s\n",
+            TEST_INFOLIST_BENCH_ITEMS, TEST_INFOLIST_BENCH_VARS,
+            util_timeval_diff (&tv_start, &tv_new) / 1000.0,
+            util_timeval_diff (&tv_new, &tv_read) / 1000.0,
+            util_timeval_diff (&tv_read, &tv_free) / 1000.0);
+}
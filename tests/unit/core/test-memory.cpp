@@ -0,0 +1,155 @@
+/*
+ * test-memory.cpp - test memory accounting functions
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <string.h>
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-infolist.h"
+#include "src/core/wee-memory.h"
+#include "src/plugins/weechat-plugin.h"
+}
+
+TEST_GROUP(Memory)
+{
+};
+
+/*
+ * Tests functions:
+ *   memory_tag_get
+ *   memory_malloc
+ *   memory_realloc
+ *   memory_strdup
+ *   memory_free
+ */
+
+TEST(Memory, Tag)
+{
+    struct t_memory_tag *tag, *tag2;
+    char *str;
+    void *ptr;
+    int old_memory_accounting;
+
+    old_memory_accounting = memory_accounting;
+
+    /* accounting disabled: no tag */
+    memory_accounting = 0;
+    POINTERS_EQUAL(NULL, memory_tag_get ("test", "tag"));
+    POINTERS_EQUAL(NULL, memory_tag_get_plugin (NULL, "tag"));
+    str = memory_strdup (NULL, "abc");
+    STRCMP_EQUAL("abc", str);
+    memory_free (NULL, str);
+
+    /* accounting enabled */
+    memory_accounting = 1;
+    tag = memory_tag_get ("test", "tag");
+    CHECK(tag);
+    STRCMP_EQUAL("test", tag->plugin_name);
+    STRCMP_EQUAL("tag", tag->name);
+    POINTERS_EQUAL(tag, memory_tag_get ("test", "tag"));
+    tag2 = memory_tag_get_plugin (NULL, "tag");
+    CHECK(tag2);
+    STRCMP_EQUAL("core", tag2->plugin_name);
+    CHECK(tag2 != tag);
+
+    /* tags are sorted by plugin name */
+    CHECK(strcmp (tag2->plugin_name, tag->plugin_name) < 0);
+
+    LONGS_EQUAL(0, tag->objects);
+    ptr = memory_malloc (tag, 100);
+    CHECK(ptr);
+    str = memory_strdup (tag, "test string");
+    STRCMP_EQUAL("test string", str);
+    LONGS_EQUAL(2, tag->objects);
+    CHECK(tag->bytes >= 0);
+    ptr = memory_realloc (tag, ptr, 5000);
+    CHECK(ptr);
+    LONGS_EQUAL(2, tag->objects);
+    CHECK(tag->bytes_peak >= tag->bytes);
+    memory_free (tag, ptr);
+    memory_free (tag, str);
+    memory_free (tag, NULL);
+    LONGS_EQUAL(0, tag->objects);
+    LONGS_EQUAL(0, tag->bytes);
+
+    memory_accounting = old_memory_accounting;
+}
+
+/*
+ * Tests functions:
+ *   memory_tags_total
+ *   memory_add_to_infolist
+ */
+
+TEST(Memory, Hashtable)
+{
+    struct t_memory_tag *tag;
+    struct t_hashtable *hashtable;
+    struct t_infolist *infolist;
+    long objects, objects_before;
+    long long bytes, bytes_before;
+    int old_memory_accounting, found;
+
+    old_memory_accounting = memory_accounting;
+    memory_accounting = 1;
+
+    tag = memory_tag_get (NULL, "hashtable");
+    CHECK(tag);
+    memory_tags_total ("core", &objects_before, &bytes_before);
+
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL, NULL);
+    CHECK(hashtable);
+    POINTERS_EQUAL(tag, hashtable->memory_tag);
+    hashtable_set (hashtable, "key1", "value1");
+    hashtable_set (hashtable, "key2", "value2");
+    memory_tags_total ("core", &objects, &bytes);
+    /* hashtable + htable + 2 items */
+    LONGS_EQUAL(objects_before + 4, objects);
+    CHECK(bytes >= bytes_before);
+
+    /* infolist "memory" */
+    infolist = infolist_new (NULL);
+    CHECK(infolist);
+    LONGS_EQUAL(1, memory_add_to_infolist (infolist, tag));
+    found = 0;
+    while (infolist_next (infolist))
+    {
+        STRCMP_EQUAL("core", infolist_string (infolist, "plugin_name"));
+        STRCMP_EQUAL("hashtable", infolist_string (infolist, "name"));
+        CHECK(infolist_integer (infolist, "objects") >= 4);
+        CHECK(infolist_string (infolist, "bytes"));
+        found = 1;
+    }
+    LONGS_EQUAL(1, found);
+    infolist_free (infolist);
+
+    hashtable_free (hashtable);
+    memory_tags_total ("core", &objects, &bytes);
+    LONGS_EQUAL(objects_before, objects);
+    CHECK(bytes == bytes_before);
+
+    memory_accounting = old_memory_accounting;
+}
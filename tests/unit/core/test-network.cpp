@@ -0,0 +1,162 @@
+/*
+ * test-network.cpp - test network functions
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <string.h>
+#include "src/core/wee-network.h"
+#include "src/core/wee-proxy.h"
+}
+
+TEST_GROUP(Network)
+{
+};
+
+/*
+ * Tests functions:
+ *   network_proxy_dialog_new
+ *   network_proxy_dialog_step
+ *   network_proxy_dialog_free
+ */
+
+TEST(Network, ProxyDialogHttp)
+{
+    struct t_proxy *proxy;
+    struct t_network_proxy_dialog *dialog;
+
+    proxy = proxy_new ("test_http", "http", "off", "127.0.0.1", "8080",
+                       "", "");
+    CHECK(proxy);
+
+    POINTERS_EQUAL(NULL, network_proxy_dialog_new (NULL, "irc.example.org",
+                                                   6667));
+
+    dialog = network_proxy_dialog_new (proxy, "irc.example.org", 6667);
+    CHECK(dialog);
+
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_CONTINUE,
+                network_proxy_dialog_step (dialog));
+    LONGS_EQUAL(strlen ("CONNECT irc.example.org:6667 HTTP/1.0\r\n\r\n"),
+                dialog->send_length);
+    CHECK(memcmp (dialog->buffer,
+                  "CONNECT irc.example.org:6667 HTTP/1.0\r\n\r\n",
+                  dialog->send_length) == 0);
+    LONGS_EQUAL(12, dialog->recv_min);
+
+    /* proxy refuses connection */
+    memcpy (dialog->buffer, "HTTP/1.0 403 Forbidden", 22);
+    dialog->recv_length = 22;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_ERROR, network_proxy_dialog_step (dialog));
+
+    /* proxy accepts connection */
+    memcpy (dialog->buffer, "HTTP/1.0 200 OK", 15);
+    dialog->recv_length = 15;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_OK, network_proxy_dialog_step (dialog));
+
+    network_proxy_dialog_free (dialog);
+    proxy_free (proxy);
+}
+
+/*
+ * Tests functions:
+ *   network_proxy_dialog_step (socks5)
+ */
+
+TEST(Network, ProxyDialogSocks5)
+{
+    struct t_proxy *proxy;
+    struct t_network_proxy_dialog *dialog;
+    const unsigned char auth[] = { 1, 4, 'u', 's', 'e', 'r', 4,
+                                   'p', 'a', 's', 's' };
+    const unsigned char request[] = { 5, 1, 0, 3, 7,
+                                      'e', 'x', 'a', 'm', 'p', 'l', 'e',
+                                      0x1a, 0x0b };
+
+    proxy = proxy_new ("test_socks5", "socks5", "off", "127.0.0.1", "1080",
+                       "user", "pass");
+    CHECK(proxy);
+
+    dialog = network_proxy_dialog_new (proxy, "example", 6667);
+    CHECK(dialog);
+
+    /* greeting: authentication with username/password */
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_CONTINUE,
+                network_proxy_dialog_step (dialog));
+    LONGS_EQUAL(3, dialog->send_length);
+    BYTES_EQUAL(5, dialog->buffer[0]);
+    BYTES_EQUAL(1, dialog->buffer[1]);
+    BYTES_EQUAL(2, dialog->buffer[2]);
+    LONGS_EQUAL(2, dialog->recv_min);
+
+    /* authentication */
+    dialog->buffer[0] = 5;
+    dialog->buffer[1] = 2;
+    dialog->recv_length = 2;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_CONTINUE,
+                network_proxy_dialog_step (dialog));
+    LONGS_EQUAL(sizeof (auth), dialog->send_length);
+    CHECK(memcmp (dialog->buffer, auth, sizeof (auth)) == 0);
+
+    /* connect request */
+    dialog->buffer[0] = 1;
+    dialog->buffer[1] = 0;
+    dialog->recv_length = 2;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_CONTINUE,
+                network_proxy_dialog_step (dialog));
+    LONGS_EQUAL(sizeof (request), dialog->send_length);
+    CHECK(memcmp (dialog->buffer, request, sizeof (request)) == 0);
+    LONGS_EQUAL(4, dialog->recv_min);
+
+    /* reply with a domain name as bound address: length, then name + port */
+    dialog->buffer[0] = 5;
+    dialog->buffer[1] = 0;
+    dialog->buffer[2] = 0;
+    dialog->buffer[3] = 3;
+    dialog->recv_length = 4;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_CONTINUE,
+                network_proxy_dialog_step (dialog));
+    LONGS_EQUAL(0, dialog->send_length);
+    LONGS_EQUAL(1, dialog->recv_min);
+    dialog->buffer[0] = 3;
+    dialog->recv_length = 1;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_CONTINUE,
+                network_proxy_dialog_step (dialog));
+    LONGS_EQUAL(5, dialog->recv_min);
+    LONGS_EQUAL(5, dialog->recv_max);
+    dialog->recv_length = 5;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_OK, network_proxy_dialog_step (dialog));
+
+    network_proxy_dialog_free (dialog);
+
+    /* authentication refused */
+    dialog = network_proxy_dialog_new (proxy, "example", 6667);
+    CHECK(dialog);
+    network_proxy_dialog_step (dialog);
+    dialog->buffer[0] = 5;
+    dialog->buffer[1] = 0xFF;
+    dialog->recv_length = 2;
+    LONGS_EQUAL(NETWORK_PROXY_DIALOG_ERROR, network_proxy_dialog_step (dialog));
+    network_proxy_dialog_free (dialog);
+
+    proxy_free (proxy);
+}
@@ -0,0 +1,298 @@
+/*
+ * test-upgrade-file.cpp - test upgrade file functions
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "src/core/wee-infolist.h"
+#include "src/core/wee-upgrade-file.h"
+#include "src/plugins/weechat-plugin.h"
+
+extern char *weechat_home;
+}
+
+#define TEST_UPGRADE_NAME "test_upgrade"
+#define TEST_UPGRADE_OBJECT 1
+#define TEST_UPGRADE_BLOCK 2
+#define TEST_UPGRADE_ROWS (UPGRADE_BLOCK_MAX_ROWS + 100)
+
+int test_upgrade_objects = 0;
+int test_upgrade_rows = 0;
+int test_upgrade_errors = 0;
+
+/*
+ * Checks values of a row (same values as written in test).
+ */
+
+void
+test_upgrade_check_row (int row, int value, time_t date, const char *message)
+{
+    char str_message[64];
+
+    snprintf (str_message, sizeof (str_message), "message %d", row);
+    if ((value != row)
+        || (date != (time_t)row * 60)
+        || ((row % 10 == 0) && message)
+        || ((row % 10 != 0) && (!message
+                                || (strcmp (message, str_message) != 0))))
+    {
+        test_upgrade_errors++;
+    }
+}
+
+/*
+ * Callback for objects (and rows of blocks if no block callback is set).
+ */
+
+int
+test_upgrade_read_cb (void *data, struct t_upgrade_file *upgrade_file,
+                      int object_id, struct t_infolist *infolist)
+{
+    (void) data;
+    (void) upgrade_file;
+
+    infolist_reset_item_cursor (infolist);
+    while (infolist_next (infolist))
+    {
+        if (object_id == TEST_UPGRADE_OBJECT)
+        {
+            if (strcmp (infolist_string (infolist, "name"), "test") != 0)
+                test_upgrade_errors++;
+            test_upgrade_objects++;
+        }
+        else if (object_id == TEST_UPGRADE_BLOCK)
+        {
+            test_upgrade_check_row (test_upgrade_rows,
+                                    infolist_integer (infolist, "value"),
+                                    infolist_time (infolist, "date"),
+                                    infolist_string (infolist, "message"));
+            test_upgrade_rows++;
+        }
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for blocks.
+ */
+
+int
+test_upgrade_read_block_cb (void *data, struct t_upgrade_file *upgrade_file,
+                            int object_id, struct t_upgrade_block *block)
+{
+    int col_value, col_date, col_message;
+
+    (void) data;
+    (void) upgrade_file;
+
+    if (object_id != TEST_UPGRADE_BLOCK)
+    {
+        test_upgrade_errors++;
+        return WEECHAT_RC_OK;
+    }
+
+    col_value = upgrade_file_block_column (block, "value");
+    col_date = upgrade_file_block_column (block, "date");
+    col_message = upgrade_file_block_column (block, "message");
+    if ((col_value < 0) || (col_date < 0) || (col_message < 0)
+        || (upgrade_file_block_column (block, "unknown") >= 0))
+    {
+        test_upgrade_errors++;
+    }
+
+    while (upgrade_file_block_next_row (block))
+    {
+        test_upgrade_check_row (test_upgrade_rows,
+                                upgrade_file_block_integer (block, col_value),
+                                upgrade_file_block_time (block, col_date),
+                                upgrade_file_block_string (block, col_message));
+        test_upgrade_rows++;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Writes test upgrade file: one object, then a block with
+ * TEST_UPGRADE_ROWS rows, then one object.
+ */
+
+void
+test_upgrade_write ()
+{
+    struct t_upgrade_file *upgrade_file;
+    struct t_upgrade_block *block;
+    struct t_infolist *infolist;
+    struct t_infolist_item *item;
+    char str_message[64];
+    int i;
+
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_NAME, 1);
+    CHECK(upgrade_file);
+
+    infolist = infolist_new (NULL);
+    item = infolist_new_item (infolist);
+    infolist_new_var_string (item, "name", "test");
+    LONGS_EQUAL(1, upgrade_file_write_object (upgrade_file,
+                                              TEST_UPGRADE_OBJECT,
+                                              infolist));
+
+    /* invalid columns */
+    POINTERS_EQUAL(NULL, upgrade_file_block_new (upgrade_file,
+                                                 TEST_UPGRADE_BLOCK,
+                                                 "x:value"));
+    POINTERS_EQUAL(NULL, upgrade_file_block_new (upgrade_file,
+                                                 TEST_UPGRADE_BLOCK,
+                                                 "i:value,s"));
+
+    block = upgrade_file_block_new (upgrade_file, TEST_UPGRADE_BLOCK,
+                                    "i:value,t:date,s:message");
+    CHECK(block);
+    LONGS_EQUAL(3, block->num_columns);
+
+    /* bad type for column */
+    LONGS_EQUAL(0, upgrade_file_block_add_string (block, "test"));
+
+    for (i = 0; i < TEST_UPGRADE_ROWS; i++)
+    {
+        snprintf (str_message, sizeof (str_message), "message %d", i);
+        LONGS_EQUAL(1, upgrade_file_block_add_integer (block, i));
+        LONGS_EQUAL(1, upgrade_file_block_add_time (block, (time_t)i * 60));
+        LONGS_EQUAL(1, upgrade_file_block_add_string (
+                        block, (i % 10 == 0) ? NULL : str_message));
+    }
+
+    /* rows are written when the max number of rows is reached */
+    LONGS_EQUAL(TEST_UPGRADE_ROWS - UPGRADE_BLOCK_MAX_ROWS, block->num_rows);
+    LONGS_EQUAL(1, upgrade_file_block_write (block));
+    LONGS_EQUAL(0, block->num_rows);
+    upgrade_file_block_free (block);
+
+    LONGS_EQUAL(1, upgrade_file_write_object (upgrade_file,
+                                              TEST_UPGRADE_OBJECT,
+                                              infolist));
+    infolist_free (infolist);
+
+    upgrade_file_close (upgrade_file);
+}
+
+TEST_GROUP(UpgradeFile)
+{
+    void setup ()
+    {
+        test_upgrade_objects = 0;
+        test_upgrade_rows = 0;
+        test_upgrade_errors = 0;
+    }
+
+    void teardown ()
+    {
+        char filename[4096];
+
+        snprintf (filename, sizeof (filename), "%s/%s.upgrade",
+                  weechat_home, TEST_UPGRADE_NAME);
+        unlink (filename);
+    }
+};
+
+/*
+ * Tests functions:
+ *   upgrade_file_block_new
+ *   upgrade_file_block_add_integer
+ *   upgrade_file_block_add_time
+ *   upgrade_file_block_add_string
+ *   upgrade_file_block_write
+ *   upgrade_file_block_column
+ *   upgrade_file_block_next_row
+ *   upgrade_file_read
+ */
+
+TEST(UpgradeFile, Block)
+{
+    struct t_upgrade_file *upgrade_file;
+
+    test_upgrade_write ();
+
+    /* read blocks with block callback */
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_NAME, 0);
+    CHECK(upgrade_file);
+    upgrade_file_set_callback_block (upgrade_file,
+                                     &test_upgrade_read_block_cb);
+    LONGS_EQUAL(1, upgrade_file_read (upgrade_file,
+                                      &test_upgrade_read_cb, NULL));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(2, test_upgrade_objects);
+    LONGS_EQUAL(TEST_UPGRADE_ROWS, test_upgrade_rows);
+    LONGS_EQUAL(0, test_upgrade_errors);
+}
+
+/*
+ * Tests functions:
+ *   upgrade_file_read (rows of blocks sent as infolists)
+ */
+
+TEST(UpgradeFile, BlockAsObjects)
+{
+    struct t_upgrade_file *upgrade_file;
+
+    test_upgrade_write ();
+
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_NAME, 0);
+    CHECK(upgrade_file);
+    LONGS_EQUAL(1, upgrade_file_read (upgrade_file,
+                                      &test_upgrade_read_cb, NULL));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(2, test_upgrade_objects);
+    LONGS_EQUAL(TEST_UPGRADE_ROWS, test_upgrade_rows);
+    LONGS_EQUAL(0, test_upgrade_errors);
+}
+
+/*
+ * Tests functions:
+ *   upgrade_file_read (truncated file)
+ */
+
+TEST(UpgradeFile, Truncated)
+{
+    struct t_upgrade_file *upgrade_file;
+    char filename[4096];
+
+    test_upgrade_write ();
+
+    snprintf (filename, sizeof (filename), "%s/%s.upgrade",
+              weechat_home, TEST_UPGRADE_NAME);
+    LONGS_EQUAL(0, truncate (filename, 1000));
+
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_NAME, 0);
+    CHECK(upgrade_file);
+    upgrade_file_set_callback_block (upgrade_file,
+                                     &test_upgrade_read_block_cb);
+    LONGS_EQUAL(0, upgrade_file_read (upgrade_file,
+                                      &test_upgrade_read_cb, NULL));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(1, test_upgrade_objects);
+    LONGS_EQUAL(0, test_upgrade_rows);
+}
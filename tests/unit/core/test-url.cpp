@@ -23,7 +23,10 @@
 
 extern "C"
 {
+#include <stdio.h>
+#include "src/core/wee-hashtable.h"
 #include "src/core/wee-url.h"
+#include "src/plugins/weechat-plugin.h"
 }
 
 TEST_GROUP(Url)
@@ -32,12 +35,47 @@ TEST_GROUP(Url)
 
 /*
  * Tests functions:
- *   weeurl_download
+ *   weeurl_transfer_new
+ *   weeurl_transfer_free
  */
 
-TEST(Url, Download)
+TEST(Url, Transfer)
 {
-    /* TODO: write tests */
+    struct t_url_transfer *transfer;
+    struct t_hashtable *options;
+    int rc;
+
+    /* invalid URL */
+    POINTERS_EQUAL(NULL, weeurl_transfer_new (NULL, NULL, 0, NULL, NULL,
+                                              NULL, &rc));
+    LONGS_EQUAL(1, rc);
+    POINTERS_EQUAL(NULL, weeurl_transfer_new ("", NULL, 0, NULL, NULL,
+                                              NULL, &rc));
+    LONGS_EQUAL(1, rc);
+
+    /* file error */
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+    hashtable_set (options, "file_in", "/nonexistent/file/for/test");
+    POINTERS_EQUAL(NULL, weeurl_transfer_new ("http://localhost/", options, 0,
+                                              NULL, NULL, NULL, &rc));
+    LONGS_EQUAL(4, rc);
+    hashtable_free (options);
+
+    /* transfer created, then cancelled */
+    transfer = weeurl_transfer_new ("http://localhost/", NULL, 1000,
+                                    NULL, NULL, NULL, &rc);
+    CHECK(transfer);
+    LONGS_EQUAL(0, rc);
+    POINTERS_EQUAL(transfer, url_transfers);
+    LONGS_EQUAL(1, transfer->running);
+    LONGS_EQUAL(1, url_transfers_running);
+    weeurl_transfer_free (transfer);
+    POINTERS_EQUAL(NULL, url_transfers);
+    LONGS_EQUAL(0, url_transfers_running);
 }
 
 /*
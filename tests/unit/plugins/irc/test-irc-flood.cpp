@@ -0,0 +1,132 @@
+/*
+ * test-irc-flood.cpp - test anti-flood of IRC plugin
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <string.h>
+#include <sys/time.h>
+#include "src/core/wee-util.h"
+#include "src/plugins/weechat-plugin.h"
+#include "src/plugins/irc/irc-flood.h"
+
+/* the irc plugin is not loaded by tests */
+struct t_weechat_plugin *weechat_irc_plugin = NULL;
+}
+
+/* plugin with the util functions used by anti-flood */
+static struct t_weechat_plugin test_irc_plugin;
+
+TEST_GROUP(IrcFlood)
+{
+    void setup ()
+    {
+        memset (&test_irc_plugin, 0, sizeof (test_irc_plugin));
+        test_irc_plugin.util_timeval_cmp = &util_timeval_cmp;
+        test_irc_plugin.util_timeval_diff = &util_timeval_diff;
+        test_irc_plugin.util_timeval_add = &util_timeval_add;
+        weechat_irc_plugin = &test_irc_plugin;
+    }
+
+    void teardown ()
+    {
+        weechat_irc_plugin = NULL;
+    }
+};
+
+/*
+ * Tests functions:
+ *   irc_flood_delay
+ *   irc_flood_use
+ */
+
+TEST(IrcFlood, Burst)
+{
+    struct timeval tv_next, tv_now;
+    int i;
+
+    tv_next.tv_sec = 0;
+    tv_next.tv_usec = 0;
+    tv_now.tv_sec = 1000000;
+    tv_now.tv_usec = 0;
+
+    /* anti-flood disabled: no delay, bucket not used */
+    LONGS_EQUAL(0, irc_flood_delay (&tv_next, 0, 0, 5, &tv_now));
+    irc_flood_use (&tv_next, 0, &tv_now);
+    LONGS_EQUAL(0, tv_next.tv_sec);
+
+    /* burst of 5 messages (interval: 2 seconds), then a delay */
+    for (i = 0; i < 5; i++)
+    {
+        LONGS_EQUAL(0, irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now));
+        irc_flood_use (&tv_next, 2000, &tv_now);
+    }
+    LONGS_EQUAL(1000000 + 10, tv_next.tv_sec);
+    LONGS_EQUAL(2000, irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now));
+
+    /* 500 ms later: 1.5 seconds to wait */
+    tv_now.tv_usec = 500000;
+    LONGS_EQUAL(1500, irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now));
+
+    /* 2 seconds later: one message can be sent */
+    tv_now.tv_sec += 2;
+    tv_now.tv_usec = 0;
+    LONGS_EQUAL(0, irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now));
+    irc_flood_use (&tv_next, 2000, &tv_now);
+    LONGS_EQUAL(2000, irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now));
+
+    /* after a long time, the bucket is full again */
+    tv_now.tv_sec += 3600;
+    for (i = 0; i < 5; i++)
+    {
+        LONGS_EQUAL(0, irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now));
+        irc_flood_use (&tv_next, 2000, &tv_now);
+    }
+    CHECK(irc_flood_delay (&tv_next, 2000, 2000, 5, &tv_now) > 0);
+}
+
+/*
+ * Tests functions:
+ *   irc_flood_delay (without burst and with change of system clock)
+ */
+
+TEST(IrcFlood, NoBurstAndClockChange)
+{
+    struct timeval tv_next, tv_now;
+
+    tv_next.tv_sec = 0;
+    tv_next.tv_usec = 0;
+    tv_now.tv_sec = 1000000;
+    tv_now.tv_usec = 0;
+
+    /* burst of 1 (or invalid burst): one message, then wait interval */
+    LONGS_EQUAL(0, irc_flood_delay (&tv_next, 2000, 2000, 0, &tv_now));
+    irc_flood_use (&tv_next, 2000, &tv_now);
+    LONGS_EQUAL(2000, irc_flood_delay (&tv_next, 2000, 2000, 1, &tv_now));
+
+    /* system clock set back by one hour: the bucket is reset */
+    tv_now.tv_sec -= 3600;
+    LONGS_EQUAL(0, irc_flood_delay (&tv_next, 2000, 2000, 1, &tv_now));
+    LONGS_EQUAL(tv_now.tv_sec, tv_next.tv_sec);
+    irc_flood_use (&tv_next, 2000, &tv_now);
+    LONGS_EQUAL(2000, irc_flood_delay (&tv_next, 2000, 2000, 1, &tv_now));
+}
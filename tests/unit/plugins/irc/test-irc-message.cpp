@@ -0,0 +1,444 @@
+/*
+ * test-irc-message.cpp - test split of IRC messages with many targets
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-string.h"
+#include "src/plugins/weechat-plugin.h"
+#include "src/plugins/irc/irc-channel.h"
+#include "src/plugins/irc/irc-message.h"
+
+extern struct t_weechat_plugin *weechat_irc_plugin;
+
+/*
+ * functions of IRC plugin used by irc-message.c (other files of the plugin
+ * are not linked with tests)
+ */
+
+int
+irc_channel_is_channel (struct t_irc_server *server, const char *string)
+{
+    (void) server;
+
+    return (string && (string[0] == '#')) ? 1 : 0;
+}
+
+int
+irc_server_get_max_targets (struct t_irc_server *server, const char *command,
+                            int default_max)
+{
+    (void) server;
+    (void) command;
+
+    return default_max;
+}
+}
+
+/* plugin with the string/hashtable functions used to split messages */
+static struct t_weechat_plugin test_irc_message_plugin;
+
+static struct t_hashtable *test_hashtable;
+
+TEST_GROUP(IrcMessage)
+{
+    void setup ()
+    {
+        memset (&test_irc_message_plugin, 0, sizeof (test_irc_message_plugin));
+        test_irc_message_plugin.strndup = &string_strndup;
+        test_irc_message_plugin.strcasecmp = &string_strcasecmp;
+        test_irc_message_plugin.string_split = &string_split;
+        test_irc_message_plugin.string_free_split = &string_free_split;
+        test_irc_message_plugin.hashtable_set = &hashtable_set;
+        weechat_irc_plugin = &test_irc_message_plugin;
+
+        test_hashtable = hashtable_new (32,
+                                        WEECHAT_HASHTABLE_STRING,
+                                        WEECHAT_HASHTABLE_STRING,
+                                        NULL,
+                                        NULL);
+    }
+
+    void teardown ()
+    {
+        hashtable_free (test_hashtable);
+        weechat_irc_plugin = NULL;
+    }
+};
+
+/*
+ * Builds a list of "count" targets: "prefix" + letter + padding up to
+ * "length" chars, separated by commas.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+test_irc_message_targets (const char *prefix, int count, int length)
+{
+    char *targets, *ptr_target;
+    int i, j;
+
+    targets = (char *)malloc (count * (length + 1) + 1);
+    ptr_target = targets;
+    for (i = 0; i < count; i++)
+    {
+        if (i > 0)
+            *(ptr_target++) = ',';
+        strcpy (ptr_target, prefix);
+        ptr_target += strlen (prefix);
+        *(ptr_target++) = 'a' + (i % 26);
+        for (j = strlen (prefix) + 1; j < length; j++)
+        {
+            *(ptr_target++) = 'x';
+        }
+    }
+    ptr_target[0] = '\0';
+
+    return targets;
+}
+
+/*
+ * Checks messages "msg1", "msg2", ... of split: each message is not longer
+ * than 510 bytes and ends with "suffix" (if not NULL).
+ *
+ * Returns number of '#' found in all messages (number of channels).
+ */
+
+int
+test_irc_message_check_split (const char *suffix, int *num_messages)
+{
+    char key[32];
+    const char *ptr_msg, *pos;
+    int count, length;
+
+    count = 0;
+    *num_messages = 0;
+    while (1)
+    {
+        snprintf (key, sizeof (key), "msg%d", *num_messages + 1);
+        ptr_msg = (const char *)hashtable_get (test_hashtable, key);
+        if (!ptr_msg)
+            break;
+        (*num_messages)++;
+        length = strlen (ptr_msg);
+        CHECK(length <= 510);
+        if (suffix)
+            STRCMP_EQUAL(suffix, ptr_msg + length - strlen (suffix));
+        for (pos = strchr (ptr_msg, '#'); pos; pos = strchr (pos + 1, '#'))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Tests functions:
+ *   irc_message_get_max_targets
+ */
+
+TEST(IrcMessage, GetMaxTargets)
+{
+    /* no TARGMAX (or empty) */
+    LONGS_EQUAL(3, irc_message_get_max_targets (NULL, "JOIN", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("", "JOIN", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("JOIN:", NULL, 3));
+
+    /* empty value means no limit */
+    LONGS_EQUAL(0, irc_message_get_max_targets ("JOIN:,WHO:1", "JOIN", 3));
+    LONGS_EQUAL(0, irc_message_get_max_targets ("JOIN:", "JOIN", 3));
+
+    /* value of command (case insensitive) */
+    LONGS_EQUAL(1, irc_message_get_max_targets ("JOIN:,WHO:1", "WHO", 3));
+    LONGS_EQUAL(4, irc_message_get_max_targets ("JOIN:,WHO:1,PRIVMSG:4",
+                                                "privmsg", 3));
+
+    /* command missing */
+    LONGS_EQUAL(3, irc_message_get_max_targets ("JOIN:,WHO:1", "NOTICE", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("JOIN:,WHO:1", "WHOIS", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("JOINWHO", "JOIN", 3));
+
+    /* garbage */
+    LONGS_EQUAL(3, irc_message_get_max_targets ("WHO:abc", "WHO", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("WHO:4x", "WHO", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("WHO:-2", "WHO", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets ("WHO:0", "WHO", 3));
+    LONGS_EQUAL(3, irc_message_get_max_targets (",,:,::", "WHO", 3));
+    LONGS_EQUAL(2, irc_message_get_max_targets (":5,WHO:2", "WHO", 3));
+}
+
+/*
+ * Tests functions:
+ *   irc_message_get_max_modes
+ */
+
+TEST(IrcMessage, GetMaxModes)
+{
+    LONGS_EQUAL(4, irc_message_get_max_modes (NULL));
+    LONGS_EQUAL(4, irc_message_get_max_modes (""));
+    LONGS_EQUAL(4, irc_message_get_max_modes ("abc"));
+    LONGS_EQUAL(1, irc_message_get_max_modes ("0"));
+    LONGS_EQUAL(1, irc_message_get_max_modes ("1"));
+    LONGS_EQUAL(12, irc_message_get_max_modes ("12"));
+    LONGS_EQUAL(128, irc_message_get_max_modes ("1000"));
+}
+
+/*
+ * Tests functions:
+ *   irc_message_build_join_arguments
+ */
+
+TEST(IrcMessage, BuildJoinArguments)
+{
+    struct t_irc_channel channels[5];
+    char *arguments;
+    int i;
+
+    POINTERS_EQUAL(NULL, irc_message_build_join_arguments (NULL));
+
+    memset (channels, 0, sizeof (channels));
+    for (i = 0; i < 4; i++)
+    {
+        channels[i].type = IRC_CHANNEL_TYPE_CHANNEL;
+        channels[i].next_channel = &channels[i + 1];
+    }
+    channels[4].type = IRC_CHANNEL_TYPE_CHANNEL;
+    channels[0].name = (char *)"#a";
+    channels[0].key = (char *)"key_a";
+    channels[1].name = (char *)"nick";
+    channels[1].type = IRC_CHANNEL_TYPE_PRIVATE;
+    channels[2].name = (char *)"#b";
+    channels[2].part = 1;
+    channels[3].name = (char *)"#c";
+    channels[4].name = (char *)"#d";
+    channels[4].key = (char *)"key_d";
+
+    /* only private buffers and channels parted */
+    channels[2].next_channel = NULL;
+    POINTERS_EQUAL(NULL, irc_message_build_join_arguments (&channels[1]));
+    channels[2].next_channel = &channels[3];
+
+    /* channel without key */
+    channels[3].next_channel = NULL;
+    arguments = irc_message_build_join_arguments (&channels[3]);
+    STRCMP_EQUAL("#c", arguments);
+    free (arguments);
+    channels[3].next_channel = &channels[4];
+
+    /* channel with a key is first */
+    arguments = irc_message_build_join_arguments (&channels[3]);
+    STRCMP_EQUAL("#d,#c key_d", arguments);
+    free (arguments);
+
+    /* channels with a key are first */
+    arguments = irc_message_build_join_arguments (channels);
+    STRCMP_EQUAL("#a,#d,#c key_a,key_d", arguments);
+    free (arguments);
+}
+
+/*
+ * Tests functions:
+ *   irc_message_split_join
+ */
+
+TEST(IrcMessage, SplitJoin)
+{
+    char *channels;
+    int num_messages;
+
+    /* no limit */
+    LONGS_EQUAL(1, irc_message_split_join (test_hashtable, NULL, NULL,
+                                           "#a,#b,#c key_a,key_b", 0));
+    STRCMP_EQUAL("JOIN #a,#b,#c key_a,key_b",
+                 (const char *)hashtable_get (test_hashtable, "msg1"));
+    STRCMP_EQUAL("#a,#b,#c key_a,key_b",
+                 (const char *)hashtable_get (test_hashtable, "args1"));
+    POINTERS_EQUAL(NULL, hashtable_get (test_hashtable, "msg2"));
+
+    /* split by count, keys are kept with their channels */
+    hashtable_remove_all (test_hashtable);
+    LONGS_EQUAL(1, irc_message_split_join (test_hashtable, NULL, NULL,
+                                           "#a,#b,#c,#d,#e k_a,k_b,k_c", 2));
+    STRCMP_EQUAL("JOIN #a,#b k_a,k_b",
+                 (const char *)hashtable_get (test_hashtable, "msg1"));
+    STRCMP_EQUAL("JOIN #c,#d k_c",
+                 (const char *)hashtable_get (test_hashtable, "msg2"));
+    STRCMP_EQUAL("JOIN #e",
+                 (const char *)hashtable_get (test_hashtable, "msg3"));
+    POINTERS_EQUAL(NULL, hashtable_get (test_hashtable, "msg4"));
+
+    /* one channel by message */
+    hashtable_remove_all (test_hashtable);
+    LONGS_EQUAL(1, irc_message_split_join (test_hashtable, NULL, NULL,
+                                           "#a,#b k_a", 1));
+    STRCMP_EQUAL("JOIN #a k_a",
+                 (const char *)hashtable_get (test_hashtable, "msg1"));
+    STRCMP_EQUAL("JOIN #b",
+                 (const char *)hashtable_get (test_hashtable, "msg2"));
+
+    /* split by length: 20 channels of 50 chars */
+    hashtable_remove_all (test_hashtable);
+    channels = test_irc_message_targets ("#", 20, 50);
+    LONGS_EQUAL(1, irc_message_split_join (test_hashtable, NULL, NULL,
+                                           channels, 0));
+    LONGS_EQUAL(20, test_irc_message_check_split (NULL, &num_messages));
+    LONGS_EQUAL(3, num_messages);
+    free (channels);
+}
+
+/*
+ * Tests functions:
+ *   irc_message_split_targets
+ */
+
+TEST(IrcMessage, SplitTargets)
+{
+    char *targets;
+    const char *ptr_msg;
+    int length, num_messages;
+
+    /* split by count, suffix is kept in each message */
+    LONGS_EQUAL(1, irc_message_split_targets (test_hashtable, NULL, NULL,
+                                              "WHO", "#a,#b,#c", " o", 2));
+    STRCMP_EQUAL("WHO #a,#b o",
+                 (const char *)hashtable_get (test_hashtable, "msg1"));
+    STRCMP_EQUAL("#a,#b o",
+                 (const char *)hashtable_get (test_hashtable, "args1"));
+    STRCMP_EQUAL("WHO #c o",
+                 (const char *)hashtable_get (test_hashtable, "msg2"));
+    POINTERS_EQUAL(NULL, hashtable_get (test_hashtable, "msg3"));
+
+    /* no suffix, with host */
+    hashtable_remove_all (test_hashtable);
+    LONGS_EQUAL(1, irc_message_split_targets (test_hashtable, NULL,
+                                              ":nick!user@host", "WHO",
+                                              "#a,#b,#c", NULL, 0));
+    STRCMP_EQUAL(":nick!user@host WHO #a,#b,#c",
+                 (const char *)hashtable_get (test_hashtable, "msg1"));
+    POINTERS_EQUAL(NULL, hashtable_get (test_hashtable, "msg2"));
+
+    /* split by length: 10 targets of 100 chars */
+    hashtable_remove_all (test_hashtable);
+    targets = test_irc_message_targets ("#", 10, 100);
+    LONGS_EQUAL(1, irc_message_split_targets (test_hashtable, NULL, NULL,
+                                              "WHO", targets, " o", 0));
+    LONGS_EQUAL(10, test_irc_message_check_split (" o", &num_messages));
+    LONGS_EQUAL(2, num_messages);
+    free (targets);
+
+    /* a target too long for the buffer is sent in its own message */
+    hashtable_remove_all (test_hashtable);
+    targets = test_irc_message_targets ("#", 1, 1500);
+    length = strlen ("#a,") + strlen (targets) + strlen (",#b") + 1;
+    targets = (char *)realloc (targets, length);
+    memmove (targets + 3, targets, strlen (targets) + 1);
+    memcpy (targets, "#a,", 3);
+    strcat (targets, ",#b");
+    LONGS_EQUAL(1, irc_message_split_targets (test_hashtable, NULL, NULL,
+                                              "WHO", targets, " o", 0));
+    STRCMP_EQUAL("WHO #a o",
+                 (const char *)hashtable_get (test_hashtable, "msg1"));
+    ptr_msg = (const char *)hashtable_get (test_hashtable, "msg2");
+    CHECK(ptr_msg);
+    LONGS_EQUAL(4 + 1500 + 2, strlen (ptr_msg));
+    STRCMP_EQUAL("WHO #b o",
+                 (const char *)hashtable_get (test_hashtable, "msg3"));
+    free (targets);
+}
+
+/*
+ * Tests functions:
+ *   irc_message_build_mode_masks
+ */
+
+TEST(IrcMessage, BuildModeMasks)
+{
+    char *masks[16], **messages, *long_masks;
+    int i;
+
+    masks[0] = NULL;
+    POINTERS_EQUAL(NULL, irc_message_build_mode_masks ("#chan", "+b", NULL,
+                                                       4));
+    POINTERS_EQUAL(NULL, irc_message_build_mode_masks ("#chan", "+b", masks,
+                                                       4));
+
+    /* batch at the MODES limit */
+    masks[0] = (char *)"a!*@*";
+    masks[1] = (char *)"b!*@*";
+    masks[2] = (char *)"c!*@*";
+    masks[3] = (char *)"d!*@*";
+    masks[4] = (char *)"e!*@*";
+    masks[5] = NULL;
+    messages = irc_message_build_mode_masks ("#chan", "+b", masks, 4);
+    CHECK(messages);
+    STRCMP_EQUAL("MODE #chan +bbbb a!*@* b!*@* c!*@* d!*@*", messages[0]);
+    STRCMP_EQUAL("MODE #chan +b e!*@*", messages[1]);
+    POINTERS_EQUAL(NULL, messages[2]);
+    string_free_split (messages);
+
+    messages = irc_message_build_mode_masks ("#chan", "-q", masks, 5);
+    CHECK(messages);
+    STRCMP_EQUAL("MODE #chan -qqqqq a!*@* b!*@* c!*@* d!*@* e!*@*",
+                 messages[0]);
+    POINTERS_EQUAL(NULL, messages[1]);
+    string_free_split (messages);
+
+    /* batch at 510 bytes: 12 masks of 100 chars */
+    long_masks = test_irc_message_targets ("", 12, 100);
+    for (i = 0; i < 12; i++)
+    {
+        masks[i] = long_masks + (i * 101);
+        masks[i][100] = '\0';
+    }
+    masks[12] = NULL;
+    messages = irc_message_build_mode_masks ("#chan", "+b", masks, 128);
+    CHECK(messages);
+    for (i = 0; messages[i]; i++)
+    {
+        CHECK(strlen (messages[i]) <= 510);
+        CHECK(strncmp (messages[i], "MODE #chan +bbbb ", 17) == 0);
+    }
+    LONGS_EQUAL(3, i);
+    string_free_split (messages);
+    free (long_masks);
+
+    /* a mask too long for the buffer is sent in its own message */
+    long_masks = test_irc_message_targets ("", 1, 1500);
+    masks[0] = (char *)"a!*@*";
+    masks[1] = long_masks;
+    masks[2] = (char *)"b!*@*";
+    masks[3] = NULL;
+    messages = irc_message_build_mode_masks ("#chan", "+b", masks, 4);
+    CHECK(messages);
+    STRCMP_EQUAL("MODE #chan +b a!*@*", messages[0]);
+    CHECK(messages[1]);
+    LONGS_EQUAL(14 + 1500, strlen (messages[1]));
+    STRCMP_EQUAL("MODE #chan +b b!*@*", messages[2]);
+    POINTERS_EQUAL(NULL, messages[3]);
+    string_free_split (messages);
+    free (long_masks);
+}
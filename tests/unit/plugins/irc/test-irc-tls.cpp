@@ -0,0 +1,197 @@
+/*
+ * test-irc-tls.cpp - test keys for TLS sessions and verified certificates
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_GNUTLS
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include "src/plugins/irc/irc-tls.h"
+}
+
+/* SHA256 of "abc" and "def" */
+#define TEST_SHA256_ABC                                                 \
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+#define TEST_SHA256_DEF                                                 \
+    "cb8379ac2098aa165029e3938a51da0bcecfc008fd6795f401178647f96c5b34"
+
+#define WEE_TEST_SESSION_KEY(__result, __address, __port, __priorities, \
+                             __dhkey_size, __cert, __fingerprint,       \
+                             __verify, __ca_file)                       \
+    key = irc_tls_session_key (__address, __port, __priorities,         \
+                               __dhkey_size, __cert, __fingerprint,     \
+                               __verify, __ca_file);                    \
+    STRCMP_EQUAL(__result, key);                                        \
+    if (key)                                                            \
+        free (key);
+
+TEST_GROUP(IrcTls)
+{
+};
+
+/*
+ * Tests functions:
+ *   irc_tls_session_key
+ */
+
+TEST(IrcTls, SessionKey)
+{
+    char *key;
+
+    /* no address */
+    WEE_TEST_SESSION_KEY(NULL, NULL, 6697, "NORMAL", 2048, "", "", 1, "");
+
+    /* NULL options */
+    WEE_TEST_SESSION_KEY("irc.example.org/6697//2048///1/",
+                         "irc.example.org", 6697, NULL, 2048, NULL, NULL,
+                         1, NULL);
+
+    /* all options */
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/NORMAL/2048/"
+                         "%h/ssl/cert.pem/01ab/1/ca.crt",
+                         "irc.example.org", 6697, "NORMAL", 2048,
+                         "%h/ssl/cert.pem", "01ab", 1, "ca.crt");
+
+    /* key changes when an option changes */
+    WEE_TEST_SESSION_KEY("irc.example.com/6697/NORMAL/2048///1/ca.crt",
+                         "irc.example.com", 6697, "NORMAL", 2048, "", "",
+                         1, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/7000/NORMAL/2048///1/ca.crt",
+                         "irc.example.org", 7000, "NORMAL", 2048, "", "",
+                         1, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/SECURE256/2048///1/ca.crt",
+                         "irc.example.org", 6697, "SECURE256", 2048, "", "",
+                         1, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/NORMAL/4096///1/ca.crt",
+                         "irc.example.org", 6697, "NORMAL", 4096, "", "",
+                         1, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/NORMAL/2048/c.pem//1/ca.crt",
+                         "irc.example.org", 6697, "NORMAL", 2048, "c.pem", "",
+                         1, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/NORMAL/2048//01ab/1/ca.crt",
+                         "irc.example.org", 6697, "NORMAL", 2048, "", "01ab",
+                         1, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/NORMAL/2048///0/ca.crt",
+                         "irc.example.org", 6697, "NORMAL", 2048, "", "",
+                         0, "ca.crt");
+    WEE_TEST_SESSION_KEY("irc.example.org/6697/NORMAL/2048///1/other.crt",
+                         "irc.example.org", 6697, "NORMAL", 2048, "", "",
+                         1, "other.crt");
+}
+
+/*
+ * Tests functions:
+ *   irc_tls_certs_id
+ */
+
+TEST(IrcTls, CertsId)
+{
+    gnutls_datum_t certs[16];
+    char *certs_id, *expected;
+    unsigned int i;
+    int length;
+
+    for (i = 0; i < 16; i++)
+    {
+        certs[i].data = (unsigned char *)((i % 2 == 0) ? "abc" : "def");
+        certs[i].size = 3;
+    }
+
+    /* no address, no certificate */
+    POINTERS_EQUAL(NULL, irc_tls_certs_id (NULL, "", 1, "", certs, 1));
+    POINTERS_EQUAL(NULL, irc_tls_certs_id ("irc.example.org", "", 1, "",
+                                           NULL, 1));
+    POINTERS_EQUAL(NULL, irc_tls_certs_id ("irc.example.org", "", 1, "",
+                                           certs, 0));
+
+    /* one certificate, NULL options */
+    certs_id = irc_tls_certs_id ("irc.example.org", NULL, 1, NULL, certs, 1);
+    STRCMP_EQUAL("irc.example.org//1//" TEST_SHA256_ABC, certs_id);
+    free (certs_id);
+
+    /* two certificates */
+    certs_id = irc_tls_certs_id ("irc.example.org", "01ab", 1, "ca.crt",
+                                 certs, 2);
+    STRCMP_EQUAL("irc.example.org/01ab/1/ca.crt/"
+                 TEST_SHA256_ABC "," TEST_SHA256_DEF, certs_id);
+    free (certs_id);
+
+    /* id changes with options used to verify certificates */
+    certs_id = irc_tls_certs_id ("irc.example.org", "01ab", 0, "ca.crt",
+                                 certs, 2);
+    STRCMP_EQUAL("irc.example.org/01ab/0/ca.crt/"
+                 TEST_SHA256_ABC "," TEST_SHA256_DEF, certs_id);
+    free (certs_id);
+    certs_id = irc_tls_certs_id ("irc.example.org", "01ab", 1, "other.crt",
+                                 certs, 2);
+    STRCMP_EQUAL("irc.example.org/01ab/1/other.crt/"
+                 TEST_SHA256_ABC "," TEST_SHA256_DEF, certs_id);
+    free (certs_id);
+
+    /* many certificates (all fingerprints fit in the id) */
+    length = strlen ("irc.example.org/01ab/1/ca.crt/") + (16 * 64) + 15 + 1;
+    expected = (char *)malloc (length);
+    strcpy (expected, "irc.example.org/01ab/1/ca.crt/");
+    for (i = 0; i < 16; i++)
+    {
+        if (i > 0)
+            strcat (expected, ",");
+        strcat (expected, (i % 2 == 0) ? TEST_SHA256_ABC : TEST_SHA256_DEF);
+    }
+    certs_id = irc_tls_certs_id ("irc.example.org", "01ab", 1, "ca.crt",
+                                 certs, 16);
+    STRCMP_EQUAL(expected, certs_id);
+    LONGS_EQUAL(length - 1, strlen (certs_id));
+    free (certs_id);
+    free (expected);
+}
+
+/*
+ * Tests functions:
+ *   irc_tls_verified_until
+ */
+
+TEST(IrcTls, VerifiedUntil)
+{
+    time_t now;
+
+    now = 1000000;
+
+    /* certificates expired */
+    LONGS_EQUAL(0, irc_tls_verified_until (0, now));
+    LONGS_EQUAL(0, irc_tls_verified_until (now - 1, now));
+    LONGS_EQUAL(0, irc_tls_verified_until (now, now));
+
+    /* certificates expire soon */
+    LONGS_EQUAL(now + 60, irc_tls_verified_until (now + 60, now));
+    LONGS_EQUAL(now + IRC_TLS_VERIFIED_MAX_TIME,
+                irc_tls_verified_until (now + IRC_TLS_VERIFIED_MAX_TIME,
+                                        now));
+
+    /* certificates valid for a long time: max time is used */
+    LONGS_EQUAL(now + IRC_TLS_VERIFIED_MAX_TIME,
+                irc_tls_verified_until (now + (365 * 24 * 3600), now));
+}
+
+#endif /* HAVE_GNUTLS */
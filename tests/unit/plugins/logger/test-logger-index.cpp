@@ -0,0 +1,372 @@
+/*
+ * test-logger-index.cpp - test index of log files (logger plugin)
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "src/plugins/logger/logger-index.h"
+#include "src/plugins/logger/logger-tail.h"
+}
+
+#define TEST_LOGGER_FILE "./tmp_test_logger_index.log"
+#define TEST_LOGGER_INDEX_FILE "./tmp_test_logger_index.log.idx"
+#define TEST_LOGGER_TIME_FORMAT "%Y-%m-%d %H:%M:%S"
+
+/*
+ * Returns date of a test line (one line per minute, first line on
+ * 2014-01-01 at 12:00:00).
+ */
+
+time_t
+test_logger_index_date (int line)
+{
+    struct tm tm_date;
+
+    memset (&tm_date, 0, sizeof (tm_date));
+    tm_date.tm_year = 2014 - 1900;
+    tm_date.tm_mon = 0;
+    tm_date.tm_mday = 1;
+    tm_date.tm_hour = 12;
+    tm_date.tm_min = line;
+    tm_date.tm_isdst = -1;
+
+    return mktime (&tm_date);
+}
+
+/*
+ * Appends lines to test log file.
+ */
+
+void
+test_logger_index_write (int first_line, int count)
+{
+    FILE *file;
+    char str_date[64];
+    time_t date;
+    int i;
+
+    file = fopen (TEST_LOGGER_FILE, "a");
+    CHECK(file);
+    for (i = first_line; i < first_line + count; i++)
+    {
+        date = test_logger_index_date (i);
+        strftime (str_date, sizeof (str_date), TEST_LOGGER_TIME_FORMAT,
+                  localtime (&date));
+        fprintf (file, "%s\tnick\tmessage %d\n", str_date, i);
+    }
+    fclose (file);
+}
+
+/*
+ * Returns number of lines in a list, and checks that lines are
+ * consecutive, starting with "first_line".
+ */
+
+int
+test_logger_index_check_lines (struct t_logger_line *lines, int first_line)
+{
+    struct t_logger_line *ptr_line;
+    char str_message[64];
+    const char *pos;
+    int count;
+
+    count = 0;
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        snprintf (str_message, sizeof (str_message),
+                  "message %d", first_line + count);
+        pos = strrchr (ptr_line->data, '\t');
+        CHECK(pos);
+        STRCMP_EQUAL(str_message, pos + 1);
+        count++;
+    }
+
+    return count;
+}
+
+TEST_GROUP(LoggerIndex)
+{
+    void setup ()
+    {
+        unlink (TEST_LOGGER_FILE);
+        unlink (TEST_LOGGER_INDEX_FILE);
+    }
+
+    void teardown ()
+    {
+        unlink (TEST_LOGGER_FILE);
+        unlink (TEST_LOGGER_INDEX_FILE);
+    }
+};
+
+/*
+ * Tests functions:
+ *   logger_index_get_filename
+ *   logger_index_parse_date
+ */
+
+TEST(LoggerIndex, FilenameAndDate)
+{
+    char *filename;
+    const char *line = "2014-01-01 12:05:00\tnick\tmessage";
+
+    POINTERS_EQUAL(NULL, logger_index_get_filename (NULL));
+    filename = logger_index_get_filename ("/tmp/test.log");
+    STRCMP_EQUAL("/tmp/test.log.idx", filename);
+    free (filename);
+
+    LONGS_EQUAL(test_logger_index_date (5),
+                logger_index_parse_date (line, strlen (line),
+                                         TEST_LOGGER_TIME_FORMAT));
+    LONGS_EQUAL(0, logger_index_parse_date ("no date", 7,
+                                            TEST_LOGGER_TIME_FORMAT));
+    LONGS_EQUAL(0, logger_index_parse_date ("bad\tdate", 8,
+                                            TEST_LOGGER_TIME_FORMAT));
+}
+
+/*
+ * Tests functions:
+ *   logger_index_new
+ *   logger_index_add_line
+ *   logger_index_free
+ */
+
+TEST(LoggerIndex, AddLine)
+{
+    struct t_logger_index *index;
+    int i;
+
+    index = logger_index_new (TEST_LOGGER_FILE);
+    CHECK(index);
+    STRCMP_EQUAL(TEST_LOGGER_INDEX_FILE, index->filename);
+
+    /* entry every LOGGER_INDEX_LINES lines, in the same day */
+    for (i = 0; i < LOGGER_INDEX_LINES * 2; i++)
+    {
+        logger_index_add_line (index, test_logger_index_date (i % 60), 10);
+    }
+    LONGS_EQUAL(LOGGER_INDEX_LINES * 2, index->lines);
+    LONGS_EQUAL(LOGGER_INDEX_LINES * 2 * 10, index->size);
+    LONGS_EQUAL(2, index->num_entries);
+    LONGS_EQUAL(LOGGER_INDEX_LINES * 10, index->entries[1].offset);
+    LONGS_EQUAL(LOGGER_INDEX_LINES, index->entries[1].line);
+
+    /* entry on first line of a new day */
+    logger_index_add_line (index, test_logger_index_date (24 * 60), 10);
+    LONGS_EQUAL(3, index->num_entries);
+    LONGS_EQUAL(LOGGER_INDEX_LINES * 2, index->entries[2].line);
+    LONGS_EQUAL(test_logger_index_date (24 * 60), index->entries[2].date);
+
+    /* line without date: no new entry */
+    logger_index_add_line (index, 0, 10);
+    LONGS_EQUAL(3, index->num_entries);
+
+    logger_index_free (index);
+}
+
+/*
+ * Tests functions:
+ *   logger_index_load
+ *   logger_index_save
+ *   logger_index_tail
+ */
+
+TEST(LoggerIndex, LoadSaveTail)
+{
+    struct t_logger_index *index;
+    struct t_logger_line *lines;
+    FILE *file;
+
+    /* missing log file: empty index */
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+    LONGS_EQUAL(0, index->lines);
+    POINTERS_EQUAL(NULL, logger_index_tail (index, TEST_LOGGER_FILE, 10));
+    logger_index_free (index);
+
+    /* index built from log file (3 days) */
+    test_logger_index_write (0, 3000);
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+    LONGS_EQUAL(3000, index->lines);
+    LONGS_EQUAL(-1, index->num_saved);
+    CHECK(index->num_entries >= 3000 / LOGGER_INDEX_LINES + 2);
+
+    lines = logger_index_tail (index, TEST_LOGGER_FILE, 10);
+    LONGS_EQUAL(10, test_logger_index_check_lines (lines, 2990));
+    logger_tail_free (lines);
+    lines = logger_index_tail (index, TEST_LOGGER_FILE, 5000);
+    LONGS_EQUAL(3000, test_logger_index_check_lines (lines, 0));
+    logger_tail_free (lines);
+
+    LONGS_EQUAL(1, logger_index_save (index));
+    LONGS_EQUAL(index->num_entries, index->num_saved);
+    logger_index_free (index);
+
+    /* index read from index file, then completed with new lines */
+    test_logger_index_write (3000, 300);
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+    LONGS_EQUAL(3300, index->lines);
+    CHECK(index->num_saved > 0);
+    lines = logger_index_tail (index, TEST_LOGGER_FILE, 300);
+    LONGS_EQUAL(300, test_logger_index_check_lines (lines, 3000));
+    logger_tail_free (lines);
+    LONGS_EQUAL(1, logger_index_save (index));
+    LONGS_EQUAL(index->num_entries, index->num_saved);
+    logger_index_free (index);
+
+    /* invalid index file: index is rebuilt */
+    file = fopen (TEST_LOGGER_INDEX_FILE, "w");
+    CHECK(file);
+    fputs ("invalid index", file);
+    fclose (file);
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+    LONGS_EQUAL(3300, index->lines);
+    LONGS_EQUAL(-1, index->num_saved);
+    logger_index_free (index);
+
+    /* log file truncated: index is rebuilt */
+    unlink (TEST_LOGGER_FILE);
+    test_logger_index_write (0, 100);
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+    LONGS_EQUAL(100, index->lines);
+    logger_index_free (index);
+}
+
+/*
+ * Tests functions:
+ *   logger_index_scan (line longer than read buffer)
+ */
+
+TEST(LoggerIndex, LongLine)
+{
+    struct t_logger_index *index;
+    struct t_logger_line *lines;
+    FILE *file;
+    char str_date[64];
+    time_t date;
+    int i;
+
+    /* line 5 is longer than read buffer (about 3 times) */
+    test_logger_index_write (0, 5);
+    file = fopen (TEST_LOGGER_FILE, "a");
+    CHECK(file);
+    date = test_logger_index_date (5);
+    strftime (str_date, sizeof (str_date), TEST_LOGGER_TIME_FORMAT,
+              localtime (&date));
+    fprintf (file, "%s\tnick\t", str_date);
+    for (i = 0; i < 200000; i++)
+    {
+        fputc ('x', file);
+    }
+    fputs ("\tmessage 5\n", file);
+    fclose (file);
+    test_logger_index_write (6, 5);
+
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+    LONGS_EQUAL(11, index->lines);
+    LONGS_EQUAL(date + 5 * 60, index->last_date);
+
+    lines = logger_index_tail (index, TEST_LOGGER_FILE, 6);
+    LONGS_EQUAL(6, test_logger_index_check_lines (lines, 5));
+    logger_tail_free (lines);
+    lines = logger_index_tail (index, TEST_LOGGER_FILE, 100);
+    LONGS_EQUAL(11, test_logger_index_check_lines (lines, 0));
+    logger_tail_free (lines);
+
+    logger_index_free (index);
+}
+
+/*
+ * Tests functions:
+ *   logger_index_range
+ *   logger_index_read_lines
+ */
+
+TEST(LoggerIndex, Range)
+{
+    struct t_logger_index *index;
+    struct t_logger_line *lines, *ptr_line;
+    long long offset_start, offset_end;
+    time_t date;
+    int count;
+
+    test_logger_index_write (0, 3000);
+    index = logger_index_load (TEST_LOGGER_FILE, TEST_LOGGER_TIME_FORMAT);
+    CHECK(index);
+
+    /* no limit: whole file */
+    logger_index_range (index, 0, 0, &offset_start, &offset_end);
+    LONGS_EQUAL(0, offset_start);
+    LONGS_EQUAL(index->size, offset_end);
+
+    /* lines 1000 to 1100: only a small part of file is read */
+    logger_index_range (index,
+                        test_logger_index_date (1000),
+                        test_logger_index_date (1100),
+                        &offset_start, &offset_end);
+    CHECK(offset_start > 0);
+    CHECK(offset_end < index->size);
+    CHECK(offset_end - offset_start < index->size / 5);
+    lines = logger_index_read_lines (TEST_LOGGER_FILE, offset_start,
+                                     offset_end);
+    CHECK(lines);
+    count = 0;
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        date = logger_index_parse_date (ptr_line->data,
+                                        strlen (ptr_line->data),
+                                        TEST_LOGGER_TIME_FORMAT);
+        if ((date >= test_logger_index_date (1000))
+            && (date <= test_logger_index_date (1100)))
+        {
+            count++;
+        }
+    }
+    LONGS_EQUAL(101, count);
+    logger_tail_free (lines);
+
+    /* dates after last line */
+    logger_index_range (index, test_logger_index_date (5000), 0,
+                        &offset_start, &offset_end);
+    lines = logger_index_read_lines (TEST_LOGGER_FILE, offset_start,
+                                     offset_end);
+    CHECK(lines);
+    count = 0;
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        count++;
+    }
+    CHECK(count <= LOGGER_INDEX_LINES);
+    logger_tail_free (lines);
+
+    logger_index_free (index);
+}
@@ -0,0 +1,253 @@
+/*
+ * test-logger-rotate.cpp - test rotation of log files (logger plugin)
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "src/plugins/logger/logger-rotate.h"
+#include "src/plugins/logger/logger-tail.h"
+}
+
+#define TEST_LOGGER_FILE "./tmp_test_logger_rotate.log"
+
+/*
+ * Appends lines "line N" to a file.
+ */
+
+void
+test_logger_rotate_write (const char *filename, int first_line, int count)
+{
+    FILE *file;
+    int i;
+
+    file = fopen (filename, "a");
+    CHECK(file);
+    for (i = first_line; i < first_line + count; i++)
+    {
+        fprintf (file, "line %d\n", i);
+    }
+    fclose (file);
+}
+
+/*
+ * Checks that lines are consecutive (starting with "first_line") and
+ * returns number of lines.
+ */
+
+int
+test_logger_rotate_check_lines (struct t_logger_line *lines, int first_line)
+{
+    struct t_logger_line *ptr_line;
+    char str_line[64];
+    int count;
+
+    count = 0;
+    for (ptr_line = lines; ptr_line; ptr_line = ptr_line->next_line)
+    {
+        snprintf (str_line, sizeof (str_line), "line %d", first_line + count);
+        STRCMP_EQUAL(str_line, ptr_line->data);
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * Checks if a file exists.
+ */
+
+int
+test_logger_rotate_exists (const char *log_filename, int number,
+                           int compressed)
+{
+    char *filename;
+    int rc;
+
+    filename = logger_rotate_segment_filename (log_filename, number,
+                                               compressed);
+    rc = (access (filename, F_OK) == 0);
+    free (filename);
+
+    return rc;
+}
+
+TEST_GROUP(LoggerRotate)
+{
+    void cleanup ()
+    {
+        char *filename;
+        int i, compressed;
+
+        unlink (TEST_LOGGER_FILE);
+        for (i = 1; i <= 5; i++)
+        {
+            for (compressed = 0; compressed <= 1; compressed++)
+            {
+                filename = logger_rotate_segment_filename (TEST_LOGGER_FILE,
+                                                           i, compressed);
+                unlink (filename);
+                free (filename);
+            }
+        }
+    }
+
+    void setup ()
+    {
+        cleanup ();
+    }
+
+    void teardown ()
+    {
+        cleanup ();
+    }
+};
+
+/*
+ * Tests functions:
+ *   logger_rotate_segment_filename
+ *   logger_rotate_search_segment
+ */
+
+TEST(LoggerRotate, SegmentFilename)
+{
+    char *filename;
+
+    POINTERS_EQUAL(NULL, logger_rotate_segment_filename (NULL, 1, 0));
+    POINTERS_EQUAL(NULL, logger_rotate_segment_filename ("test.log", 0, 0));
+
+    filename = logger_rotate_segment_filename ("test.log", 1, 0);
+    STRCMP_EQUAL("test.log.1", filename);
+    free (filename);
+    filename = logger_rotate_segment_filename ("test.log", 12, 1);
+    STRCMP_EQUAL("test.log.12.gz", filename);
+    free (filename);
+
+    POINTERS_EQUAL(NULL, logger_rotate_search_segment (TEST_LOGGER_FILE, 1));
+    test_logger_rotate_write (TEST_LOGGER_FILE ".1", 0, 1);
+    filename = logger_rotate_search_segment (TEST_LOGGER_FILE, 1);
+    STRCMP_EQUAL(TEST_LOGGER_FILE ".1", filename);
+    free (filename);
+
+    /* compressed segment is used first */
+    test_logger_rotate_write (TEST_LOGGER_FILE ".1.gz", 0, 1);
+    filename = logger_rotate_search_segment (TEST_LOGGER_FILE, 1);
+    STRCMP_EQUAL(TEST_LOGGER_FILE ".1.gz", filename);
+    free (filename);
+}
+
+/*
+ * Tests functions:
+ *   logger_rotate_file
+ *   logger_rotate_compress_file
+ */
+
+TEST(LoggerRotate, RotateAndCompress)
+{
+    struct t_logger_line *lines;
+    char *filename;
+
+    /* no log file: no rotation */
+    POINTERS_EQUAL(NULL, logger_rotate_file (TEST_LOGGER_FILE, NULL));
+
+    test_logger_rotate_write (TEST_LOGGER_FILE, 0, 10);
+    filename = logger_rotate_file (TEST_LOGGER_FILE, NULL);
+    STRCMP_EQUAL(TEST_LOGGER_FILE ".1", filename);
+    LONGS_EQUAL(0, access (TEST_LOGGER_FILE, F_OK) == 0);
+    LONGS_EQUAL(1, test_logger_rotate_exists (TEST_LOGGER_FILE, 1, 0));
+
+    /* compress segment */
+    LONGS_EQUAL(0, logger_rotate_compress_file (filename, 9));
+    LONGS_EQUAL(0, test_logger_rotate_exists (TEST_LOGGER_FILE, 1, 0));
+    LONGS_EQUAL(1, test_logger_rotate_exists (TEST_LOGGER_FILE, 1, 1));
+    CHECK(logger_rotate_compress_file (filename, 9) != 0);
+    free (filename);
+
+    /* rotate again: compressed segment is renamed */
+    test_logger_rotate_write (TEST_LOGGER_FILE, 10, 10);
+    filename = logger_rotate_file (TEST_LOGGER_FILE, NULL);
+    STRCMP_EQUAL(TEST_LOGGER_FILE ".1", filename);
+    free (filename);
+    LONGS_EQUAL(1, test_logger_rotate_exists (TEST_LOGGER_FILE, 1, 0));
+    LONGS_EQUAL(1, test_logger_rotate_exists (TEST_LOGGER_FILE, 2, 1));
+    LONGS_EQUAL(0, test_logger_rotate_exists (TEST_LOGGER_FILE, 3, 1));
+
+    /* read compressed segment */
+    lines = logger_rotate_tail_segment (TEST_LOGGER_FILE ".2.gz", 4);
+    LONGS_EQUAL(4, test_logger_rotate_check_lines (lines, 6));
+    logger_tail_free (lines);
+    lines = logger_rotate_tail_segment (TEST_LOGGER_FILE ".2.gz", 100);
+    LONGS_EQUAL(10, test_logger_rotate_check_lines (lines, 0));
+    logger_tail_free (lines);
+
+    /* read segment not compressed */
+    lines = logger_rotate_tail_segment (TEST_LOGGER_FILE ".1", 3);
+    LONGS_EQUAL(3, test_logger_rotate_check_lines (lines, 17));
+    logger_tail_free (lines);
+}
+
+/*
+ * Tests functions:
+ *   logger_rotate_add_previous_lines
+ *   logger_tail_file
+ */
+
+TEST(LoggerRotate, TailSegments)
+{
+    struct t_logger_line *lines;
+    char *filename;
+
+    /* segments: ".2.gz" (lines 0-9), ".1" (lines 10-19), live file (20-29) */
+    test_logger_rotate_write (TEST_LOGGER_FILE, 0, 10);
+    filename = logger_rotate_file (TEST_LOGGER_FILE, NULL);
+    LONGS_EQUAL(0, logger_rotate_compress_file (filename, 1));
+    free (filename);
+    test_logger_rotate_write (TEST_LOGGER_FILE, 10, 10);
+    filename = logger_rotate_file (TEST_LOGGER_FILE, NULL);
+    free (filename);
+    test_logger_rotate_write (TEST_LOGGER_FILE, 20, 10);
+
+    lines = logger_tail_file (TEST_LOGGER_FILE, 5);
+    LONGS_EQUAL(5, test_logger_rotate_check_lines (lines, 25));
+    logger_tail_free (lines);
+
+    lines = logger_tail_file (TEST_LOGGER_FILE, 15);
+    LONGS_EQUAL(15, test_logger_rotate_check_lines (lines, 15));
+    logger_tail_free (lines);
+
+    lines = logger_tail_file (TEST_LOGGER_FILE, 25);
+    LONGS_EQUAL(25, test_logger_rotate_check_lines (lines, 5));
+    logger_tail_free (lines);
+
+    lines = logger_tail_file (TEST_LOGGER_FILE, 100);
+    LONGS_EQUAL(30, test_logger_rotate_check_lines (lines, 0));
+    logger_tail_free (lines);
+
+    /* live file missing (just rotated): lines are read in segments */
+    unlink (TEST_LOGGER_FILE);
+    lines = logger_tail_file (TEST_LOGGER_FILE, 12);
+    LONGS_EQUAL(12, test_logger_rotate_check_lines (lines, 8));
+    logger_tail_free (lines);
+}
@@ -0,0 +1,329 @@
+/*
+ * test-logger-writer.cpp - test background writer of logger plugin
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "src/plugins/logger/logger-rotate.h"
+#include "src/plugins/logger/logger-tail.h"
+#include "src/plugins/logger/logger-writer.h"
+}
+
+#define TEST_LOGGER_FILE "./tmp_test_logger_writer.log"
+
+/*
+ * Opens test log file (truncated).
+ *
+ * Returns file descriptor.
+ */
+
+int
+test_logger_writer_open ()
+{
+    return open (TEST_LOGGER_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,
+                 0600);
+}
+
+/*
+ * Reads content of a file.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+test_logger_writer_read (const char *filename)
+{
+    FILE *file;
+    char *content;
+    long size;
+
+    file = fopen (filename, "r");
+    if (!file)
+        return NULL;
+    fseek (file, 0, SEEK_END);
+    size = ftell (file);
+    fseek (file, 0, SEEK_SET);
+    content = (char *)malloc (size + 1);
+    if (content)
+    {
+        if (fread (content, 1, size, file) != (size_t)size)
+            size = 0;
+        content[size] = '\0';
+    }
+    fclose (file);
+
+    return content;
+}
+
+/*
+ * Reserves space and sends a string to writer.
+ */
+
+void
+test_logger_writer_send (int fd, const char *string, int flags)
+{
+    int size;
+
+    size = strlen (string);
+    LONGS_EQUAL(1, logger_writer_reserve (size, 1024 * 1024, 1));
+    LONGS_EQUAL(0, logger_writer_queue (fd,
+                                        logger_writer_file_id (TEST_LOGGER_FILE),
+                                        strdup (string), size, flags));
+}
+
+TEST_GROUP(LoggerWriter)
+{
+};
+
+/*
+ * Tests functions:
+ *   logger_writer_reserve
+ *   logger_writer_release
+ *   logger_writer_pending_size
+ */
+
+TEST(LoggerWriter, Reserve)
+{
+    LONGS_EQUAL(0, logger_writer_pending_size ());
+
+    LONGS_EQUAL(1, logger_writer_reserve (100, 150, 0));
+    LONGS_EQUAL(100, logger_writer_pending_size ());
+
+    /* max size reached: reserve fails (without wait) */
+    LONGS_EQUAL(0, logger_writer_reserve (100, 150, 0));
+    LONGS_EQUAL(100, logger_writer_pending_size ());
+
+    /* max size reached, but nothing is being written: no wait */
+    LONGS_EQUAL(0, logger_writer_reserve (100, 150, 1));
+
+    logger_writer_release (100);
+    LONGS_EQUAL(0, logger_writer_pending_size ());
+
+    /* a chunk bigger than max size is accepted if nothing is pending */
+    LONGS_EQUAL(1, logger_writer_reserve (200, 150, 0));
+    logger_writer_release (200);
+    LONGS_EQUAL(0, logger_writer_pending_size ());
+}
+
+/*
+ * Tests functions:
+ *   logger_writer_queue (without writer thread)
+ */
+
+TEST(LoggerWriter, QueueWithoutThread)
+{
+    char *content;
+    int fd;
+
+    fd = test_logger_writer_open ();
+    CHECK(fd >= 0);
+
+    /* without thread, data is written immediately */
+    test_logger_writer_send (fd, "line 1\n", 0);
+    LONGS_EQUAL(0, logger_writer_pending_size ());
+    content = test_logger_writer_read (TEST_LOGGER_FILE);
+    STRCMP_EQUAL("line 1\n", content);
+    free (content);
+
+    test_logger_writer_send (fd, "line 2\n", LOGGER_WRITER_CLOSE);
+    content = test_logger_writer_read (TEST_LOGGER_FILE);
+    STRCMP_EQUAL("line 1\nline 2\n", content);
+    free (content);
+
+    /* file is closed by writer */
+    LONGS_EQUAL(-1, fcntl (fd, F_GETFD));
+
+    unlink (TEST_LOGGER_FILE);
+}
+
+/*
+ * Tests functions:
+ *   logger_writer_init
+ *   logger_writer_queue
+ *   logger_writer_wait
+ *   logger_writer_end
+ */
+
+TEST(LoggerWriter, QueueWithThread)
+{
+    char *content, line[64], *expected;
+    int fd, fd2, i, length;
+
+    LONGS_EQUAL(1, logger_writer_init ());
+
+    fd = test_logger_writer_open ();
+    CHECK(fd >= 0);
+    fd2 = open ("/dev/null", O_WRONLY);
+    CHECK(fd2 >= 0);
+
+    /* many requests, interleaved with another file: order is kept */
+    length = 0;
+    expected = (char *)malloc (1000 * 16);
+    expected[0] = '\0';
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (line, sizeof (line), "line %d\n", i);
+        test_logger_writer_send (fd, line, 0);
+        test_logger_writer_send (fd2, "other file\n", 0);
+        strcpy (expected + length, line);
+        length += strlen (line);
+    }
+    test_logger_writer_send (fd, "", LOGGER_WRITER_SYNC);
+
+    logger_writer_wait ();
+    LONGS_EQUAL(0, logger_writer_pending_size ());
+    content = test_logger_writer_read (TEST_LOGGER_FILE);
+    STRCMP_EQUAL(expected, content);
+    free (content);
+    free (expected);
+
+    /* close request is processed after data */
+    test_logger_writer_send (fd, "end\n", LOGGER_WRITER_CLOSE);
+    test_logger_writer_send (fd2, "", LOGGER_WRITER_CLOSE);
+
+    /* stop thread: all data must be written before thread ends */
+    logger_writer_end ();
+    LONGS_EQUAL(0, logger_writer_pending_size ());
+    content = test_logger_writer_read (TEST_LOGGER_FILE);
+    length = strlen (content);
+    CHECK(length > 4);
+    STRCMP_EQUAL("end\n", content + length - 4);
+    free (content);
+    LONGS_EQUAL(-1, fcntl (fd, F_GETFD));
+    LONGS_EQUAL(-1, fcntl (fd2, F_GETFD));
+
+    unlink (TEST_LOGGER_FILE);
+}
+
+/*
+ * Tests functions:
+ *   logger_writer_queue_rotate
+ */
+
+TEST(LoggerWriter, Rotate)
+{
+    struct t_logger_line *lines;
+    char *content, *filename;
+    int fd, i;
+
+    LONGS_EQUAL(1, logger_writer_init ());
+
+    /*
+     * log file is renamed with a temporary name after close (data queued
+     * before is still written), then renamed to "<file>.1" by writer
+     */
+    for (i = 1; i <= 2; i++)
+    {
+        fd = test_logger_writer_open ();
+        CHECK(fd >= 0);
+        test_logger_writer_send (fd, (i == 1) ? "line 1\n" : "line 2\n",
+                                 LOGGER_WRITER_CLOSE);
+        filename = logger_rotate_pending_filename (TEST_LOGGER_FILE, i);
+        LONGS_EQUAL(0, rename (TEST_LOGGER_FILE, filename));
+        LONGS_EQUAL(0, logger_writer_queue_rotate (TEST_LOGGER_FILE,
+                                                   filename, i - 1));
+        free (filename);
+    }
+    fd = test_logger_writer_open ();
+    CHECK(fd >= 0);
+    test_logger_writer_send (fd, "line 3\n", LOGGER_WRITER_CLOSE);
+
+    logger_writer_end ();
+
+    content = test_logger_writer_read (TEST_LOGGER_FILE);
+    STRCMP_EQUAL("line 3\n", content);
+    free (content);
+    content = test_logger_writer_read (TEST_LOGGER_FILE ".2");
+    STRCMP_EQUAL("line 1\n", content);
+    free (content);
+    LONGS_EQUAL(-1, access (TEST_LOGGER_FILE ".1", F_OK));
+    lines = logger_rotate_tail_segment (TEST_LOGGER_FILE ".1.gz", 10);
+    CHECK(lines);
+    STRCMP_EQUAL("line 2", lines->data);
+    POINTERS_EQUAL(NULL, lines->next_line);
+    logger_tail_free (lines);
+    for (i = 1; i <= 2; i++)
+    {
+        filename = logger_rotate_pending_filename (TEST_LOGGER_FILE, i);
+        LONGS_EQUAL(-1, access (filename, F_OK));
+        free (filename);
+    }
+
+    unlink (TEST_LOGGER_FILE);
+    unlink (TEST_LOGGER_FILE ".1.gz");
+    unlink (TEST_LOGGER_FILE ".2");
+}
+
+/*
+ * Tests functions:
+ *   logger_writer_file_id
+ *   logger_writer_wait_file
+ */
+
+TEST(LoggerWriter, WaitFile)
+{
+    char *content, line[64], *expected;
+    int fd, i, length;
+
+    LONGS_EQUAL(0, logger_writer_file_id (NULL));
+    CHECK(logger_writer_file_id ("") != 0);
+    LONGS_EQUAL(logger_writer_file_id (TEST_LOGGER_FILE),
+                logger_writer_file_id (TEST_LOGGER_FILE));
+    CHECK(logger_writer_file_id (TEST_LOGGER_FILE)
+          != logger_writer_file_id (TEST_LOGGER_FILE ".1"));
+
+    LONGS_EQUAL(1, logger_writer_init ());
+
+    fd = test_logger_writer_open ();
+    CHECK(fd >= 0);
+
+    length = 0;
+    expected = (char *)malloc (100 * 16);
+    expected[0] = '\0';
+    for (i = 0; i < 100; i++)
+    {
+        snprintf (line, sizeof (line), "line %d\n", i);
+        test_logger_writer_send (fd, line, 0);
+        strcpy (expected + length, line);
+        length += strlen (line);
+    }
+
+    /* no request for another file: no wait */
+    logger_writer_wait_file (logger_writer_file_id (TEST_LOGGER_FILE ".1"));
+
+    /* all data of file is written after wait */
+    logger_writer_wait_file (logger_writer_file_id (TEST_LOGGER_FILE));
+    content = test_logger_writer_read (TEST_LOGGER_FILE);
+    STRCMP_EQUAL(expected, content);
+    free (content);
+    free (expected);
+
+    test_logger_writer_send (fd, "", LOGGER_WRITER_CLOSE);
+    logger_writer_end ();
+
+    unlink (TEST_LOGGER_FILE);
+}
@@ -0,0 +1,312 @@
+/*
+ * test-relay-websocket.cpp - test websocket functions of relay plugin
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <regex.h>
+#include "src/plugins/weechat-plugin.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/relay-websocket.h"
+
+/*
+ * symbols of relay plugin used by relay-websocket.c (the relay plugin is not
+ * loaded by tests, only the websocket functions are compiled in tests)
+ */
+struct t_weechat_plugin *weechat_relay_plugin = NULL;
+regex_t *relay_config_regex_websocket_allowed_origins = NULL;
+
+int
+relay_client_send (struct t_relay_client *client, const char *data,
+                   int data_size, const char *message_raw_buffer)
+{
+    (void) client;
+    (void) data;
+    (void) message_raw_buffer;
+
+    return data_size;
+}
+}
+
+/* masks used to build frames */
+static const unsigned char test_masks[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+/*
+ * Builds a masked frame sent by a client (with the given opcode and FIN bit).
+ *
+ * Returns length of frame built.
+ */
+
+int
+test_relay_websocket_build_frame (unsigned char *frame, int fin, int opcode,
+                                  const char *data, int length)
+{
+    int i, index;
+
+    frame[0] = ((fin) ? 0x80 : 0) | opcode;
+    if (length <= 125)
+    {
+        frame[1] = 0x80 | length;
+        index = 2;
+    }
+    else if (length <= 65535)
+    {
+        frame[1] = 0x80 | 126;
+        frame[2] = (length >> 8) & 0xFF;
+        frame[3] = length & 0xFF;
+        index = 4;
+    }
+    else
+    {
+        frame[1] = 0x80 | 127;
+        for (i = 0; i < 8; i++)
+        {
+            frame[2 + i] = (i < 4) ? 0 : (length >> ((7 - i) * 8)) & 0xFF;
+        }
+        index = 10;
+    }
+    memcpy (frame + index, test_masks, 4);
+    index += 4;
+    for (i = 0; i < length; i++)
+    {
+        frame[index + i] = data[i] ^ test_masks[i % 4];
+    }
+
+    return index + length;
+}
+
+TEST_GROUP(RelayWebsocket)
+{
+};
+
+/*
+ * Tests functions:
+ *   relay_websocket_is_http_get_weechat
+ */
+
+TEST(RelayWebsocket, IsHttpGetWeechat)
+{
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat (""));
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat ("GET /"));
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat ("GET /weechat2"));
+    LONGS_EQUAL(1, relay_websocket_is_http_get_weechat ("GET /weechat\r\n"));
+    LONGS_EQUAL(1, relay_websocket_is_http_get_weechat ("GET /weechat HTTP/1.1"));
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_decode_frame (complete frames)
+ */
+
+TEST(RelayWebsocket, DecodeFrame)
+{
+    unsigned char frame[256], decoded[256];
+    unsigned long long decoded_length, used_length;
+    int length;
+
+    /* empty buffer */
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame, 0, decoded,
+                                                 &decoded_length,
+                                                 &used_length));
+    LONGS_EQUAL(0, decoded_length);
+    LONGS_EQUAL(0, used_length);
+
+    /* frame not masked */
+    frame[0] = 0x81;
+    frame[1] = 0x01;
+    frame[2] = 'a';
+    LONGS_EQUAL(0, relay_websocket_decode_frame (frame, 3, decoded,
+                                                 &decoded_length,
+                                                 &used_length));
+
+    /* one text frame */
+    length = test_relay_websocket_build_frame (frame, 1, 1, "test\n", 5);
+    LONGS_EQUAL(11, length);
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame, length, decoded,
+                                                 &decoded_length,
+                                                 &used_length));
+    LONGS_EQUAL(5, decoded_length);
+    LONGS_EQUAL(11, used_length);
+    CHECK(memcmp (decoded, "test\n", 5) == 0);
+
+    /* two frames in same buffer */
+    length = test_relay_websocket_build_frame (frame, 1, 1, "abc\n", 4);
+    length += test_relay_websocket_build_frame (frame + length, 1, 1,
+                                                "defg\n", 5);
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame, length, decoded,
+                                                 &decoded_length,
+                                                 &used_length));
+    LONGS_EQUAL(9, decoded_length);
+    LONGS_EQUAL(length, used_length);
+    CHECK(memcmp (decoded, "abc\ndefg\n", 9) == 0);
+
+    /* control frame (pong) is ignored */
+    length = test_relay_websocket_build_frame (frame, 1, 10, "pong", 4);
+    length += test_relay_websocket_build_frame (frame + length, 1, 1,
+                                                "abc\n", 4);
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame, length, decoded,
+                                                 &decoded_length,
+                                                 &used_length));
+    LONGS_EQUAL(4, decoded_length);
+    LONGS_EQUAL(length, used_length);
+    CHECK(memcmp (decoded, "abc\n", 4) == 0);
+
+    /* decode in place */
+    length = test_relay_websocket_build_frame (frame, 1, 1, "abc", 3);
+    length += test_relay_websocket_build_frame (frame + length, 1, 1,
+                                                "def\n", 4);
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame, length, frame,
+                                                 &decoded_length,
+                                                 &used_length));
+    LONGS_EQUAL(7, decoded_length);
+    LONGS_EQUAL(length, used_length);
+    CHECK(memcmp (frame, "abcdef\n", 7) == 0);
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_decode_frame (partial and fragmented frames)
+ */
+
+TEST(RelayWebsocket, DecodeFramePartial)
+{
+    unsigned char frame[256], decoded[256];
+    unsigned long long decoded_length, used_length;
+    int i, length, length1;
+
+    length1 = test_relay_websocket_build_frame (frame, 1, 1, "abc\n", 4);
+    length = length1 + test_relay_websocket_build_frame (frame + length1,
+                                                         1, 1, "def\n", 4);
+
+    /* second frame is partial: only first one is decoded */
+    for (i = length1; i < length; i++)
+    {
+        LONGS_EQUAL(1, relay_websocket_decode_frame (frame, i, decoded,
+                                                     &decoded_length,
+                                                     &used_length));
+        LONGS_EQUAL(4, decoded_length);
+        LONGS_EQUAL(length1, used_length);
+        CHECK(memcmp (decoded, "abc\n", 4) == 0);
+    }
+
+    /* first frame is partial: nothing is decoded */
+    for (i = 0; i < length1; i++)
+    {
+        LONGS_EQUAL(1, relay_websocket_decode_frame (frame, i, decoded,
+                                                     &decoded_length,
+                                                     &used_length));
+        LONGS_EQUAL(0, decoded_length);
+        LONGS_EQUAL(0, used_length);
+    }
+
+    /* fragmented message: text frame without FIN + continuation frame */
+    length = test_relay_websocket_build_frame (frame, 0, 1, "abc", 3);
+    length += test_relay_websocket_build_frame (frame + length, 1, 0,
+                                                "def\n", 4);
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame, length, decoded,
+                                                 &decoded_length,
+                                                 &used_length));
+    LONGS_EQUAL(7, decoded_length);
+    LONGS_EQUAL(length, used_length);
+    CHECK(memcmp (decoded, "abcdef\n", 7) == 0);
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_decode_frame (frames larger than 4096 bytes)
+ */
+
+TEST(RelayWebsocket, DecodeFrameLarge)
+{
+    unsigned char *frame, *decoded;
+    char *data;
+    unsigned long long decoded_length, used_length;
+    int i, length, sizes[2] = { 10000, 100000 }, size;
+
+    for (size = 0; size < 2; size++)
+    {
+        data = (char *)malloc (sizes[size]);
+        frame = (unsigned char *)malloc (sizes[size] + 14);
+        decoded = (unsigned char *)malloc (sizes[size]);
+        for (i = 0; i < sizes[size]; i++)
+        {
+            data[i] = 'a' + (i % 26);
+        }
+        length = test_relay_websocket_build_frame (frame, 1, 1, data,
+                                                   sizes[size]);
+        LONGS_EQUAL(sizes[size] + ((size == 0) ? 8 : 14), length);
+
+        /* frame received in chunks of 4096 bytes */
+        for (i = 4096; i < length; i += 4096)
+        {
+            LONGS_EQUAL(1, relay_websocket_decode_frame (frame, i, decoded,
+                                                         &decoded_length,
+                                                         &used_length));
+            LONGS_EQUAL(0, decoded_length);
+            LONGS_EQUAL(0, used_length);
+        }
+
+        /* complete frame received */
+        LONGS_EQUAL(1, relay_websocket_decode_frame (frame, length, decoded,
+                                                     &decoded_length,
+                                                     &used_length));
+        LONGS_EQUAL(sizes[size], decoded_length);
+        LONGS_EQUAL(length, used_length);
+        CHECK(memcmp (decoded, data, sizes[size]) == 0);
+
+        free (data);
+        free (frame);
+        free (decoded);
+    }
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_encode_frame
+ */
+
+TEST(RelayWebsocket, EncodeFrame)
+{
+    struct t_relay_client client;
+    char *frame, data[300];
+    unsigned long long length_frame;
+
+    memset (&client, 0, sizeof (client));
+    memset (data, 'a', sizeof (data));
+
+    client.send_data_type = RELAY_CLIENT_DATA_TEXT;
+    frame = relay_websocket_encode_frame (&client, data, 5, &length_frame);
+    LONGS_EQUAL(7, length_frame);
+    BYTES_EQUAL(0x81, frame[0]);
+    BYTES_EQUAL(5, frame[1]);
+    free (frame);
+
+    client.send_data_type = RELAY_CLIENT_DATA_BINARY;
+    frame = relay_websocket_encode_frame (&client, data, 300, &length_frame);
+    LONGS_EQUAL(304, length_frame);
+    BYTES_EQUAL(0x82, frame[0]);
+    BYTES_EQUAL(126, frame[1]);
+    BYTES_EQUAL(1, frame[2]);
+    BYTES_EQUAL(44, frame[3]);
+    free (frame);
+}
@@ -0,0 +1,446 @@
+/*
+ * test-relay-weechat-batch.cpp - test batched lines of relay WeeChat protocol
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "src/core/wee-hashtable.h"
+#include "src/plugins/weechat-plugin.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/weechat/relay-weechat-batch.h"
+#include "src/plugins/relay/weechat/relay-weechat-msg.h"
+
+/*
+ * symbols of relay plugin used by relay-weechat-batch.c and
+ * relay-weechat-msg.c (the relay plugin is not loaded by tests)
+ */
+struct t_config_option *relay_config_network_compression_level = NULL;
+struct t_config_option *relay_config_weechat_lines_batch_delay = NULL;
+struct t_config_option *relay_config_weechat_lines_batch_max = NULL;
+int relay_profile = 0;
+
+void
+relay_profile_add (enum t_relay_profile profile, struct timeval *tv_start)
+{
+    (void) profile;
+    (void) tv_start;
+}
+}
+
+/* plugin with the hashtable functions used by batch */
+static struct t_weechat_plugin test_relay_plugin;
+
+/* a line decoded from message "_buffer_lines_added" */
+struct t_test_batch_line
+{
+    long unsigned int buffer;
+    time_t date;
+    time_t date_printed;
+    char displayed;
+    char highlight;
+    int tags_count;
+    char tags[256];
+    char prefix[256];
+    char message[256];
+};
+
+/*
+ * Decoder for a message (as a client would do), reads the binary objects
+ * sent by WeeChat.
+ */
+
+struct t_test_decoder
+{
+    const char *data;
+    int size;
+    int pos;
+};
+
+int
+test_decode_int (struct t_test_decoder *decoder)
+{
+    uint32_t value;
+
+    CHECK(decoder->pos + 4 <= decoder->size);
+    memcpy (&value, decoder->data + decoder->pos, 4);
+    decoder->pos += 4;
+    return (int)ntohl (value);
+}
+
+void
+test_decode_type (struct t_test_decoder *decoder, const char *type)
+{
+    CHECK(decoder->pos + 3 <= decoder->size);
+    CHECK(strncmp (decoder->data + decoder->pos, type, 3) == 0);
+    decoder->pos += 3;
+}
+
+char
+test_decode_char (struct t_test_decoder *decoder)
+{
+    CHECK(decoder->pos + 1 <= decoder->size);
+    return decoder->data[decoder->pos++];
+}
+
+/*
+ * Decodes a string; returns 0 if the string is NULL, 1 otherwise.
+ */
+
+int
+test_decode_string (struct t_test_decoder *decoder, char *string, int size)
+{
+    int length;
+
+    string[0] = '\0';
+    length = test_decode_int (decoder);
+    if (length < 0)
+        return 0;
+    CHECK(length < size);
+    CHECK(decoder->pos + length <= decoder->size);
+    memcpy (string, decoder->data + decoder->pos, length);
+    string[length] = '\0';
+    decoder->pos += length;
+    return 1;
+}
+
+/*
+ * Decodes a pointer or a time (length on one byte + string).
+ */
+
+void
+test_decode_short_string (struct t_test_decoder *decoder, char *string)
+{
+    int length;
+
+    length = (unsigned char)test_decode_char (decoder);
+    CHECK(decoder->pos + length <= decoder->size);
+    memcpy (string, decoder->data + decoder->pos, length);
+    string[length] = '\0';
+    decoder->pos += length;
+}
+
+/*
+ * Decodes header of an array column (type of elements and count).
+ *
+ * Returns number of elements in array.
+ */
+
+int
+test_decode_array (struct t_test_decoder *decoder, const char *type)
+{
+    test_decode_type (decoder, RELAY_WEECHAT_MSG_OBJ_ARRAY);
+    test_decode_type (decoder, type);
+    return test_decode_int (decoder);
+}
+
+/*
+ * Decodes a message "_buffer_lines_added".
+ *
+ * Returns number of lines decoded (stored in "lines").
+ */
+
+int
+test_decode_batch (struct t_relay_weechat_msg *msg,
+                   struct t_test_batch_line *lines, int max_lines)
+{
+    struct t_test_decoder decoder;
+    char str[256], strings[16][256];
+    int i, j, count, strings_count, tags_count, index, tag;
+
+    decoder.data = msg->data;
+    decoder.size = msg->data_size;
+    decoder.pos = 5;  /* skip length and compression */
+
+    /* id and schema */
+    test_decode_string (&decoder, str, sizeof (str));
+    STRCMP_EQUAL("_buffer_lines_added", str);
+    test_decode_type (&decoder, RELAY_WEECHAT_MSG_OBJ_STRING);
+    test_decode_string (&decoder, str, sizeof (str));
+    STRCMP_EQUAL(RELAY_WEECHAT_BATCH_SCHEMA, str);
+
+    /* number of lines */
+    test_decode_type (&decoder, RELAY_WEECHAT_MSG_OBJ_INT);
+    count = test_decode_int (&decoder);
+    CHECK(count <= max_lines);
+    memset (lines, 0, count * sizeof (*lines));
+
+    /* strings */
+    strings_count = test_decode_array (&decoder, RELAY_WEECHAT_MSG_OBJ_STRING);
+    CHECK(strings_count <= 16);
+    for (i = 0; i < strings_count; i++)
+    {
+        test_decode_string (&decoder, strings[i], sizeof (strings[i]));
+    }
+
+    /* buffer */
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_POINTER));
+    for (i = 0; i < count; i++)
+    {
+        test_decode_short_string (&decoder, str);
+        lines[i].buffer = strtoul (str, NULL, 16);
+    }
+
+    /* date, date_printed */
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_TIME));
+    for (i = 0; i < count; i++)
+    {
+        test_decode_short_string (&decoder, str);
+        lines[i].date = strtol (str, NULL, 10);
+    }
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_TIME));
+    for (i = 0; i < count; i++)
+    {
+        test_decode_short_string (&decoder, str);
+        lines[i].date_printed = strtol (str, NULL, 10);
+    }
+
+    /* displayed, highlight */
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_CHAR));
+    for (i = 0; i < count; i++)
+    {
+        lines[i].displayed = test_decode_char (&decoder);
+    }
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_CHAR));
+    for (i = 0; i < count; i++)
+    {
+        lines[i].highlight = test_decode_char (&decoder);
+    }
+
+    /* tags_count, tags (joined with "," for tests) */
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_INT));
+    tags_count = 0;
+    for (i = 0; i < count; i++)
+    {
+        lines[i].tags_count = test_decode_int (&decoder);
+        tags_count += lines[i].tags_count;
+    }
+    LONGS_EQUAL(tags_count, test_decode_array (&decoder,
+                                               RELAY_WEECHAT_MSG_OBJ_INT));
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < lines[i].tags_count; j++)
+        {
+            tag = test_decode_int (&decoder);
+            CHECK((tag >= 0) && (tag < strings_count));
+            if (j > 0)
+                strcat (lines[i].tags, ",");
+            strcat (lines[i].tags, strings[tag]);
+        }
+    }
+
+    /* prefix */
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_INT));
+    for (i = 0; i < count; i++)
+    {
+        index = test_decode_int (&decoder);
+        CHECK((index >= -1) && (index < strings_count));
+        strcpy (lines[i].prefix, (index >= 0) ? strings[index] : "(null)");
+    }
+
+    /* message */
+    LONGS_EQUAL(count, test_decode_array (&decoder,
+                                          RELAY_WEECHAT_MSG_OBJ_STRING));
+    for (i = 0; i < count; i++)
+    {
+        test_decode_string (&decoder, lines[i].message,
+                            sizeof (lines[i].message));
+    }
+
+    /* all data must have been read */
+    LONGS_EQUAL(msg->data_size, decoder.pos);
+
+    return count;
+}
+
+TEST_GROUP(RelayWeechatBatch)
+{
+    void setup ()
+    {
+        memset (&test_relay_plugin, 0, sizeof (test_relay_plugin));
+        test_relay_plugin.hashtable_new = &hashtable_new;
+        test_relay_plugin.hashtable_set = &hashtable_set;
+        test_relay_plugin.hashtable_get = &hashtable_get;
+        test_relay_plugin.hashtable_remove_all = &hashtable_remove_all;
+        test_relay_plugin.hashtable_free = &hashtable_free;
+        weechat_relay_plugin = &test_relay_plugin;
+    }
+
+    void teardown ()
+    {
+        weechat_relay_plugin = NULL;
+    }
+};
+
+/*
+ * Tests functions:
+ *   relay_weechat_batch_new
+ *   relay_weechat_batch_add_line
+ *   relay_weechat_batch_add_tag
+ *   relay_weechat_batch_clear
+ *   relay_weechat_batch_free
+ */
+
+TEST(RelayWeechatBatch, AddLine)
+{
+    struct t_relay_weechat_batch *batch;
+    struct t_relay_weechat_batch_line *line;
+    int i;
+
+    batch = relay_weechat_batch_new ();
+    CHECK(batch);
+    LONGS_EQUAL(0, batch->lines_count);
+    LONGS_EQUAL(0, batch->strings_count);
+
+    /* no line yet: tag can not be added */
+    LONGS_EQUAL(0, relay_weechat_batch_add_tag (batch, "tag"));
+
+    line = relay_weechat_batch_add_line (batch, (struct t_gui_buffer *)0x1234,
+                                         1000, 1001, 1, 0, "alice", "hello");
+    CHECK(line);
+    LONGS_EQUAL(0, line->prefix);
+    STRCMP_EQUAL("hello", line->message);
+    LONGS_EQUAL(1, relay_weechat_batch_add_tag (batch, "irc_privmsg"));
+    LONGS_EQUAL(1, relay_weechat_batch_add_tag (batch, "nick_alice"));
+    LONGS_EQUAL(0, relay_weechat_batch_add_tag (batch, NULL));
+
+    /* same prefix and tag: strings are interned only once */
+    line = relay_weechat_batch_add_line (batch, (struct t_gui_buffer *)0x1234,
+                                         1002, 1002, 1, 1, "alice", "hi");
+    LONGS_EQUAL(0, line->prefix);
+    LONGS_EQUAL(1, relay_weechat_batch_add_tag (batch, "irc_privmsg"));
+
+    /* no prefix */
+    line = relay_weechat_batch_add_line (batch, (struct t_gui_buffer *)0x5678,
+                                         1003, 1003, 0, 0, NULL, "topic");
+    LONGS_EQUAL(-1, line->prefix);
+
+    LONGS_EQUAL(3, batch->lines_count);
+    LONGS_EQUAL(3, batch->strings_count);
+    STRCMP_EQUAL("alice", batch->strings[0]);
+    STRCMP_EQUAL("irc_privmsg", batch->strings[1]);
+    STRCMP_EQUAL("nick_alice", batch->strings[2]);
+    LONGS_EQUAL(3, batch->tags_count);
+    LONGS_EQUAL(2, batch->lines[0].tags_count);
+    LONGS_EQUAL(1, batch->lines[1].tags_count);
+    LONGS_EQUAL(0, batch->lines[2].tags_count);
+
+    /* clear keeps allocated arrays, strings are interned again */
+    relay_weechat_batch_clear (batch);
+    LONGS_EQUAL(0, batch->lines_count);
+    LONGS_EQUAL(0, batch->strings_count);
+    LONGS_EQUAL(0, batch->tags_count);
+    CHECK(batch->lines_size > 0);
+    line = relay_weechat_batch_add_line (batch, NULL, 0, 0, 1, 0,
+                                         "bob", "test");
+    LONGS_EQUAL(0, line->prefix);
+    STRCMP_EQUAL("bob", batch->strings[0]);
+
+    /* many lines (arrays are grown) */
+    for (i = 0; i < 1000; i++)
+    {
+        CHECK(relay_weechat_batch_add_line (batch, NULL, i, i, 1, 0,
+                                            "bob", "test"));
+        LONGS_EQUAL(1, relay_weechat_batch_add_tag (batch, "log1"));
+    }
+    LONGS_EQUAL(1001, batch->lines_count);
+    LONGS_EQUAL(2, batch->strings_count);
+    LONGS_EQUAL(1000, batch->tags_count);
+
+    relay_weechat_batch_free (batch);
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_batch_add_to_msg
+ */
+
+TEST(RelayWeechatBatch, AddToMsg)
+{
+    struct t_relay_weechat_batch *batch;
+    struct t_relay_weechat_msg *msg;
+    struct t_test_batch_line lines[8];
+
+    batch = relay_weechat_batch_new ();
+    CHECK(batch);
+
+    /* empty batch */
+    msg = relay_weechat_msg_new ("_buffer_lines_added");
+    CHECK(msg);
+    relay_weechat_batch_add_to_msg (msg, batch);
+    LONGS_EQUAL(0, test_decode_batch (msg, lines, 8));
+    relay_weechat_msg_free (msg);
+
+    relay_weechat_batch_add_line (batch, (struct t_gui_buffer *)0x1234,
+                                  1362728993, 1362728994, 1, 0,
+                                  "alice", "hello!");
+    relay_weechat_batch_add_tag (batch, "irc_privmsg");
+    relay_weechat_batch_add_tag (batch, "nick_alice");
+    relay_weechat_batch_add_line (batch, (struct t_gui_buffer *)0xabcdef,
+                                  1362728995, 1362728995, 0, 1,
+                                  NULL, "");
+    relay_weechat_batch_add_line (batch, (struct t_gui_buffer *)0x1234,
+                                  1362728996, 1362728997, 1, 1,
+                                  "alice", "alice: ping");
+    relay_weechat_batch_add_tag (batch, "nick_alice");
+    relay_weechat_batch_add_tag (batch, "irc_privmsg");
+
+    msg = relay_weechat_msg_new ("_buffer_lines_added");
+    CHECK(msg);
+    relay_weechat_batch_add_to_msg (msg, batch);
+    LONGS_EQUAL(3, test_decode_batch (msg, lines, 8));
+    relay_weechat_msg_free (msg);
+
+    LONGS_EQUAL(0x1234, lines[0].buffer);
+    LONGS_EQUAL(1362728993, lines[0].date);
+    LONGS_EQUAL(1362728994, lines[0].date_printed);
+    LONGS_EQUAL(1, lines[0].displayed);
+    LONGS_EQUAL(0, lines[0].highlight);
+    STRCMP_EQUAL("irc_privmsg,nick_alice", lines[0].tags);
+    STRCMP_EQUAL("alice", lines[0].prefix);
+    STRCMP_EQUAL("hello!", lines[0].message);
+
+    LONGS_EQUAL(0xabcdef, lines[1].buffer);
+    LONGS_EQUAL(1362728995, lines[1].date);
+    LONGS_EQUAL(0, lines[1].displayed);
+    LONGS_EQUAL(1, lines[1].highlight);
+    LONGS_EQUAL(0, lines[1].tags_count);
+    STRCMP_EQUAL("(null)", lines[1].prefix);
+    STRCMP_EQUAL("", lines[1].message);
+
+    LONGS_EQUAL(0x1234, lines[2].buffer);
+    LONGS_EQUAL(1362728997, lines[2].date_printed);
+    STRCMP_EQUAL("nick_alice,irc_privmsg", lines[2].tags);
+    STRCMP_EQUAL("alice", lines[2].prefix);
+    STRCMP_EQUAL("alice: ping", lines[2].message);
+
+    relay_weechat_batch_free (batch);
+}
@@ -0,0 +1,264 @@
+/*
+ * test-relay-weechat-nicklist.cpp - test nicklist diffs of relay (weechat
+ *                                   protocol)
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-hashtable.h"
+#include "src/plugins/weechat-plugin.h"
+#include "src/plugins/relay/weechat/relay-weechat-nicklist.h"
+
+extern struct t_weechat_plugin *weechat_relay_plugin;
+}
+
+/* a group or nick (read by nicklist functions with hdata) */
+struct t_test_nicklist_item
+{
+    const char *name;
+    int visible;
+    int level;
+};
+
+/* plugin with the hashtable/hdata functions used by nicklist diffs */
+static struct t_weechat_plugin test_relay_nicklist_plugin;
+
+/* fake hdata and buffers (only pointers are used) */
+static char test_hdata;
+static char test_buffer1, test_buffer2;
+
+struct t_hdata *
+test_relay_nicklist_hdata_get (struct t_weechat_plugin *plugin,
+                               const char *hdata_name)
+{
+    (void) plugin;
+    (void) hdata_name;
+
+    return (struct t_hdata *)&test_hdata;
+}
+
+int
+test_relay_nicklist_hdata_integer (struct t_hdata *hdata, void *pointer,
+                                   const char *name)
+{
+    struct t_test_nicklist_item *item;
+
+    (void) hdata;
+
+    item = (struct t_test_nicklist_item *)pointer;
+    if (strcmp (name, "visible") == 0)
+        return item->visible;
+    if (strcmp (name, "level") == 0)
+        return item->level;
+    return 0;
+}
+
+const char *
+test_relay_nicklist_hdata_string (struct t_hdata *hdata, void *pointer,
+                                  const char *name)
+{
+    (void) hdata;
+
+    if (strcmp (name, "name") == 0)
+        return ((struct t_test_nicklist_item *)pointer)->name;
+    return NULL;
+}
+
+int
+test_relay_nicklist_buffer_get_integer (struct t_gui_buffer *buffer,
+                                        const char *property)
+{
+    (void) property;
+
+    return (buffer == (struct t_gui_buffer *)&test_buffer1) ? 3 : 5;
+}
+
+TEST_GROUP(RelayWeechatNicklist)
+{
+    struct t_test_nicklist_item group, nick1, nick2, nick3;
+
+    void setup ()
+    {
+        memset (&test_relay_nicklist_plugin, 0,
+                sizeof (test_relay_nicklist_plugin));
+        test_relay_nicklist_plugin.hashtable_new = &hashtable_new;
+        test_relay_nicklist_plugin.hashtable_set = &hashtable_set;
+        test_relay_nicklist_plugin.hashtable_get = &hashtable_get;
+        test_relay_nicklist_plugin.hashtable_set_pointer = &hashtable_set_pointer;
+        test_relay_nicklist_plugin.hashtable_remove = &hashtable_remove;
+        test_relay_nicklist_plugin.hashtable_free = &hashtable_free;
+        test_relay_nicklist_plugin.hdata_get = &test_relay_nicklist_hdata_get;
+        test_relay_nicklist_plugin.hdata_integer = &test_relay_nicklist_hdata_integer;
+        test_relay_nicklist_plugin.hdata_string = &test_relay_nicklist_hdata_string;
+        test_relay_nicklist_plugin.buffer_get_integer = &test_relay_nicklist_buffer_get_integer;
+        weechat_relay_plugin = &test_relay_nicklist_plugin;
+
+        group.name = "group";
+        group.visible = 1;
+        group.level = 1;
+        nick1.name = "nick1";
+        nick1.visible = 1;
+        nick1.level = 0;
+        nick2.name = "nick2";
+        nick2.visible = 1;
+        nick2.level = 0;
+        nick3.name = "nick3";
+        nick3.visible = 1;
+        nick3.level = 0;
+    }
+
+    void teardown ()
+    {
+        relay_weechat_nicklist_remove_all ();
+        weechat_relay_plugin = NULL;
+    }
+
+    void add_group (struct t_relay_weechat_nicklist *nicklist, char diff,
+                    struct t_test_nicklist_item *item)
+    {
+        relay_weechat_nicklist_add_item (nicklist, diff,
+                                         (struct t_gui_nick_group *)item,
+                                         NULL);
+    }
+
+    void add_nick (struct t_relay_weechat_nicklist *nicklist, char diff,
+                   struct t_test_nicklist_item *item)
+    {
+        relay_weechat_nicklist_add_item (nicklist, diff, NULL,
+                                         (struct t_gui_nick *)item);
+    }
+};
+
+/*
+ * Tests functions:
+ *   relay_weechat_nicklist_add_item
+ *   relay_weechat_nicklist_compact
+ */
+
+TEST(RelayWeechatNicklist, Compact)
+{
+    struct t_relay_weechat_nicklist *nicklist;
+    struct t_relay_weechat_nicklist_diff *diffs;
+
+    nicklist = relay_weechat_nicklist_new ();
+    CHECK(nicklist);
+
+    /* no items */
+    LONGS_EQUAL(0, relay_weechat_nicklist_compact (nicklist, 0, &diffs));
+    POINTERS_EQUAL(NULL, diffs);
+
+    /* nick added then removed: dropped */
+    add_group (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_PARENT, &group);
+    add_nick (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_ADDED, &nick1);
+    add_nick (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_REMOVED, &nick1);
+    LONGS_EQUAL(3, nicklist->items_count);
+    STRCMP_EQUAL("nick1", nicklist->items[1].name);
+    LONGS_EQUAL(0, relay_weechat_nicklist_compact (nicklist, 0, &diffs));
+    POINTERS_EQUAL(NULL, diffs);
+
+    /* same parent group is not added twice in a row */
+    add_group (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_PARENT, &group);
+    LONGS_EQUAL(3, nicklist->items_count);
+
+    /* nick added then changed: sent as added with last values */
+    add_nick (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_ADDED, &nick2);
+    add_nick (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_CHANGED, &nick2);
+
+    /* nick changed then removed: sent as removed */
+    add_nick (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_CHANGED, &nick3);
+    add_nick (nicklist, RELAY_WEECHAT_NICKLIST_DIFF_REMOVED, &nick3);
+
+    LONGS_EQUAL(7, nicklist->items_count);
+    LONGS_EQUAL(3, relay_weechat_nicklist_compact (nicklist, 0, &diffs));
+    CHECK(diffs);
+    LONGS_EQUAL(0, diffs[0].index);
+    BYTES_EQUAL(RELAY_WEECHAT_NICKLIST_DIFF_PARENT, diffs[0].diff);
+    LONGS_EQUAL(4, diffs[1].index);
+    BYTES_EQUAL(RELAY_WEECHAT_NICKLIST_DIFF_ADDED, diffs[1].diff);
+    LONGS_EQUAL(6, diffs[2].index);
+    BYTES_EQUAL(RELAY_WEECHAT_NICKLIST_DIFF_REMOVED, diffs[2].diff);
+    free (diffs);
+
+    /* start after first items: only the diffs of nick3 */
+    LONGS_EQUAL(1, relay_weechat_nicklist_compact (nicklist, 5, &diffs));
+    CHECK(diffs);
+    LONGS_EQUAL(6, diffs[0].index);
+    BYTES_EQUAL(RELAY_WEECHAT_NICKLIST_DIFF_REMOVED, diffs[0].diff);
+    free (diffs);
+
+    /* start after last item */
+    LONGS_EQUAL(0, relay_weechat_nicklist_compact (nicklist, 7, &diffs));
+    POINTERS_EQUAL(NULL, diffs);
+
+    /* items are not changed by compaction */
+    LONGS_EQUAL(7, nicklist->items_count);
+
+    relay_weechat_nicklist_free (nicklist);
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_nicklist_search
+ *   relay_weechat_nicklist_remove
+ */
+
+TEST(RelayWeechatNicklist, SharedDiffs)
+{
+    struct t_relay_weechat_nicklist *nicklist1, *nicklist2;
+    struct t_relay_weechat_nicklist_diff *diffs;
+    struct t_gui_buffer *buffer1, *buffer2;
+
+    buffer1 = (struct t_gui_buffer *)&test_buffer1;
+    buffer2 = (struct t_gui_buffer *)&test_buffer2;
+
+    POINTERS_EQUAL(NULL, relay_weechat_nicklist_search (buffer1, 0));
+
+    nicklist1 = relay_weechat_nicklist_search (buffer1, 1);
+    CHECK(nicklist1);
+    LONGS_EQUAL(3, nicklist1->nicklist_count);
+    nicklist2 = relay_weechat_nicklist_search (buffer2, 1);
+    CHECK(nicklist2);
+    CHECK(nicklist1 != nicklist2);
+    LONGS_EQUAL(5, nicklist2->nicklist_count);
+
+    add_nick (nicklist1, RELAY_WEECHAT_NICKLIST_DIFF_ADDED, &nick1);
+    add_nick (nicklist2, RELAY_WEECHAT_NICKLIST_DIFF_ADDED, &nick2);
+
+    /* diffs are kept after being sent to a client (for other clients) */
+    LONGS_EQUAL(1, relay_weechat_nicklist_compact (nicklist1, 0, &diffs));
+    free (diffs);
+    POINTERS_EQUAL(nicklist1, relay_weechat_nicklist_search (buffer1, 0));
+    LONGS_EQUAL(1, nicklist1->items_count);
+    LONGS_EQUAL(1, relay_weechat_nicklist_compact (nicklist1, 0, &diffs));
+    free (diffs);
+
+    /* diffs are freed when the buffer is closed */
+    relay_weechat_nicklist_remove (buffer1);
+    POINTERS_EQUAL(NULL, relay_weechat_nicklist_search (buffer1, 0));
+    POINTERS_EQUAL(nicklist2, relay_weechat_nicklist_search (buffer2, 0));
+    LONGS_EQUAL(1, nicklist2->items_count);
+
+    relay_weechat_nicklist_remove_all ();
+    POINTERS_EQUAL(NULL, relay_weechat_nicklist_search (buffer2, 0));
+}
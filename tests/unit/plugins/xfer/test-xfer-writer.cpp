@@ -0,0 +1,249 @@
+/*
+ * test-xfer-writer.cpp - test background writer of xfer plugin
+ *
+ * Copyright (C) 2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <gcrypt.h>
+#include "src/plugins/xfer/xfer-writer.h"
+}
+
+#define TEST_XFER_FILE "./tmp_test_xfer_writer.bin"
+#define TEST_XFER_SIZE 100000
+
+/*
+ * Returns byte of test data at a position in file.
+ */
+
+char
+test_xfer_writer_byte (int pos)
+{
+    return (char)((pos * 7) + (pos / 251));
+}
+
+/*
+ * Receives test data from "start" to "end" (excluded) with a writer, in
+ * chunks of "chunk" bytes.
+ */
+
+void
+test_xfer_writer_receive (struct t_xfer_writer *writer, int start, int end,
+                          int chunk)
+{
+    char *ptr_buf;
+    int pos, size, i;
+
+    pos = start;
+    while (pos < end)
+    {
+        ptr_buf = xfer_writer_get_buffer (writer, &size);
+        CHECK(size > 0);
+        if (size > chunk)
+            size = chunk;
+        if (size > end - pos)
+            size = end - pos;
+        for (i = 0; i < size; i++)
+        {
+            ptr_buf[i] = test_xfer_writer_byte (pos + i);
+        }
+        LONGS_EQUAL(0, xfer_writer_add (writer, size));
+        pos += size;
+    }
+}
+
+/*
+ * Checks content of test file (from position 0 to "size").
+ */
+
+void
+test_xfer_writer_check_file (int size)
+{
+    FILE *file;
+    char *content;
+    int i;
+
+    file = fopen (TEST_XFER_FILE, "rb");
+    CHECK(file);
+    fseek (file, 0, SEEK_END);
+    LONGS_EQUAL(size, ftell (file));
+    fseek (file, 0, SEEK_SET);
+    content = (char *)malloc (size);
+    CHECK(content);
+    LONGS_EQUAL(size, fread (content, 1, size, file));
+    fclose (file);
+    for (i = 0; i < size; i++)
+    {
+        if (content[i] != test_xfer_writer_byte (i))
+            break;
+    }
+    LONGS_EQUAL(size, i);
+    free (content);
+}
+
+/*
+ * Returns CRC32 of test data (from position 0 to "size").
+ */
+
+unsigned int
+test_xfer_writer_crc32 (int size)
+{
+    char *data;
+    unsigned char *hash;
+    unsigned int crc32;
+    int i;
+
+    data = (char *)malloc (size);
+    for (i = 0; i < size; i++)
+    {
+        data[i] = test_xfer_writer_byte (i);
+    }
+    hash = (unsigned char *)malloc (gcry_md_get_algo_dlen (GCRY_MD_CRC32));
+    gcry_md_hash_buffer (GCRY_MD_CRC32, hash, data, size);
+    crc32 = ((unsigned int)hash[0] << 24) | ((unsigned int)hash[1] << 16)
+        | ((unsigned int)hash[2] << 8) | (unsigned int)hash[3];
+    free (hash);
+    free (data);
+
+    return crc32;
+}
+
+/*
+ * Returns CRC32 computed with a hash handle.
+ */
+
+unsigned int
+test_xfer_writer_hash_crc32 (gcry_md_hd_t *hash_handle)
+{
+    unsigned char *hash;
+
+    hash = gcry_md_read (*hash_handle, 0);
+    return ((unsigned int)hash[0] << 24) | ((unsigned int)hash[1] << 16)
+        | ((unsigned int)hash[2] << 8) | (unsigned int)hash[3];
+}
+
+TEST_GROUP(XferWriter)
+{
+};
+
+/*
+ * Tests functions:
+ *   xfer_writer_new
+ *   xfer_writer_get_buffer
+ *   xfer_writer_add
+ *   xfer_writer_flush
+ *   xfer_writer_wait
+ *   xfer_writer_free
+ */
+
+TEST(XferWriter, Write)
+{
+    struct t_xfer_writer *writer;
+    gcry_md_hd_t hash_handle;
+    int fd;
+
+    POINTERS_EQUAL(NULL, xfer_writer_new (-1, 0, 4096, NULL, NULL, 0));
+
+    fd = open (TEST_XFER_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    POINTERS_EQUAL(NULL, xfer_writer_new (fd, 0, 0, NULL, NULL, 0));
+
+    LONGS_EQUAL(0, gcry_md_open (&hash_handle, GCRY_MD_CRC32, 0));
+
+    /* small buffers: many flushes with the two buffers */
+    writer = xfer_writer_new (fd, 0, 4096, &hash_handle, NULL, 0);
+    CHECK(writer);
+    test_xfer_writer_receive (writer, 0, TEST_XFER_SIZE, 1000);
+    LONGS_EQUAL(0, xfer_writer_wait (writer));
+    LONGS_EQUAL(0, xfer_writer_hash_error (writer));
+    xfer_writer_free (writer);
+    close (fd);
+
+    test_xfer_writer_check_file (TEST_XFER_SIZE);
+    LONGS_EQUAL(test_xfer_writer_crc32 (TEST_XFER_SIZE),
+                test_xfer_writer_hash_crc32 (&hash_handle));
+
+    gcry_md_close (hash_handle);
+    unlink (TEST_XFER_FILE);
+}
+
+/*
+ * Tests functions:
+ *   xfer_writer_new (with resume)
+ *   xfer_writer_hash_error
+ */
+
+TEST(XferWriter, Resume)
+{
+    struct t_xfer_writer *writer;
+    gcry_md_hd_t hash_handle;
+    int fd, start;
+
+    start = 30000;
+
+    /* first part of file (received before resume) */
+    fd = open (TEST_XFER_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    writer = xfer_writer_new (fd, 0, 8192, NULL, NULL, 0);
+    CHECK(writer);
+    test_xfer_writer_receive (writer, 0, start, 3000);
+    LONGS_EQUAL(0, xfer_writer_wait (writer));
+    xfer_writer_free (writer);
+    close (fd);
+
+    /* resume: the first part is hashed, data is written at its position */
+    LONGS_EQUAL(0, gcry_md_open (&hash_handle, GCRY_MD_CRC32, 0));
+    fd = open (TEST_XFER_FILE, O_WRONLY, 0600);
+    CHECK(fd >= 0);
+    writer = xfer_writer_new (fd, start, 8192, &hash_handle,
+                              TEST_XFER_FILE, start);
+    CHECK(writer);
+    test_xfer_writer_receive (writer, start, TEST_XFER_SIZE, 5000);
+    LONGS_EQUAL(0, xfer_writer_wait (writer));
+    LONGS_EQUAL(0, xfer_writer_hash_error (writer));
+    xfer_writer_free (writer);
+    close (fd);
+
+    test_xfer_writer_check_file (TEST_XFER_SIZE);
+    LONGS_EQUAL(test_xfer_writer_crc32 (TEST_XFER_SIZE),
+                test_xfer_writer_hash_crc32 (&hash_handle));
+    gcry_md_close (hash_handle);
+
+    /* resume with a file too short: hash error */
+    LONGS_EQUAL(0, gcry_md_open (&hash_handle, GCRY_MD_CRC32, 0));
+    fd = open (TEST_XFER_FILE, O_WRONLY, 0600);
+    CHECK(fd >= 0);
+    writer = xfer_writer_new (fd, TEST_XFER_SIZE, 8192, &hash_handle,
+                              TEST_XFER_FILE, TEST_XFER_SIZE * 2);
+    CHECK(writer);
+    LONGS_EQUAL(0, xfer_writer_wait (writer));
+    LONGS_EQUAL(1, xfer_writer_hash_error (writer));
+    xfer_writer_free (writer);
+    close (fd);
+    gcry_md_close (hash_handle);
+
+    unlink (TEST_XFER_FILE);
+}